@@ -32,6 +32,7 @@ static int RG_server_block_get( struct SG_gateway* gateway, struct SG_request_da
    struct RG_core* core = (struct RG_core*)SG_gateway_cls( gateway );
    struct SG_proc_group* group = NULL;
    struct SG_proc* proc = NULL;
+   struct SG_proc_call call;
    struct ms_client* ms = SG_gateway_ms( gateway );
    SG_messages::DriverRequest driver_req;
 
@@ -49,6 +50,13 @@ static int RG_server_block_get( struct SG_gateway* gateway, struct SG_request_da
          rc = -ENODATA;
          goto RG_server_block_get_finish;
       }
+
+      rc = SG_proc_call_init( &call, proc );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_init rc = %d\n", rc );
+         goto RG_server_block_get_finish;
+      }
       
       // ask for the block 
       rc = SG_proc_request_init( ms, reqdat, &driver_req );
@@ -60,7 +68,7 @@ static int RG_server_block_get( struct SG_gateway* gateway, struct SG_request_da
          goto RG_server_block_get_finish;
       }
 
-      rc = SG_proc_write_request( SG_proc_stdin( proc ), &driver_req );
+      rc = SG_proc_call_write_request( &call, &driver_req );
       if( rc != 0 ) {
 
          SG_error("SG_proc_write_request rc = %d\n", rc );
@@ -69,8 +77,18 @@ static int RG_server_block_get( struct SG_gateway* gateway, struct SG_request_da
          goto RG_server_block_get_finish;
       }
      
+      // send it off, and wait for the reply
+      rc = SG_proc_call_send( &call );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_send(%d) rc = %d\n", SG_proc_pid( proc ), rc );
+         rc = -EIO;
+
+         goto RG_server_block_get_finish;
+      }
+
       // get error code 
-      rc = SG_proc_read_int64( SG_proc_stdout_f( proc ), &worker_rc );
+      rc = SG_proc_read_int64( SG_proc_call_reply( &call ), &worker_rc );
       if( rc < 0 ) {
          
          SG_error("SG_proc_read_int64('ERROR') rc = %d\n", rc );
@@ -95,10 +113,10 @@ static int RG_server_block_get( struct SG_gateway* gateway, struct SG_request_da
       }
       
       // get the block 
-      rc = SG_proc_read_chunk( SG_proc_stdout_f( proc ), block );
+      rc = SG_proc_read_chunk( SG_proc_call_reply( &call ), block );
       if( rc < 0 ) {
          
-         SG_error("SG_proc_read_chunk(%d) rc = %d\n", fileno( SG_proc_stdout_f(proc) ), rc );
+         SG_error("SG_proc_read_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          // OOM, EOF, or driver crash (rc is -ENOMEM, -ENODATA, or -EIO, respectively)
          goto RG_server_block_get_finish;
@@ -113,6 +131,7 @@ static int RG_server_block_get( struct SG_gateway* gateway, struct SG_request_da
 RG_server_block_get_finish:
 
    if( group != NULL && proc != NULL ) {
+      SG_proc_call_free( &call );
       SG_proc_group_release( group, proc );
    }
 
@@ -134,6 +153,7 @@ static int RG_server_manifest_get( struct SG_gateway* gateway, struct SG_request
    struct RG_core* core = (struct RG_core*)SG_gateway_cls( gateway );
    struct SG_proc_group* group = NULL;
    struct SG_proc* proc = NULL;
+   struct SG_proc_call call;
    struct SG_chunk chunk;
    size_t manifest_len = 0;
    struct ms_client* ms = SG_gateway_ms( gateway );
@@ -158,6 +178,13 @@ static int RG_server_manifest_get( struct SG_gateway* gateway, struct SG_request
          goto RG_server_manifest_get_finish;
       }
 
+      rc = SG_proc_call_init( &call, proc );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_init rc = %d\n", rc );
+         goto RG_server_manifest_get_finish;
+      }
+
       // ask for the serialized manifest 
       rc = SG_proc_request_init( ms, reqdat, &driver_req );
       if( rc != 0 ) {
@@ -170,17 +197,27 @@ static int RG_server_manifest_get( struct SG_gateway* gateway, struct SG_request
 
       SG_debug("Request get %s\n", (driver_req.request_type() == SG_messages::DriverRequest::MANIFEST ? "manifest" : "block"));
 
-      rc = SG_proc_write_request( SG_proc_stdin( proc ), &driver_req );
+      rc = SG_proc_call_write_request( &call, &driver_req );
       if( rc < 0 ) {
 
-         SG_error("SG_proc_write_request(%d) rc = %d\n", SG_proc_stdin(proc), rc );
+         SG_error("SG_proc_write_request(%d) rc = %d\n", SG_proc_pid( proc ), rc );
+         rc = -EIO;
+
+         goto RG_server_manifest_get_finish;
+      }
+
+      // send it off, and wait for the reply
+      rc = SG_proc_call_send( &call );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_send(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          rc = -EIO;
 
          goto RG_server_manifest_get_finish;
       }
 
       // get error code 
-      rc = SG_proc_read_int64( SG_proc_stdout_f( proc ), &worker_rc );
+      rc = SG_proc_read_int64( SG_proc_call_reply( &call ), &worker_rc );
       if( rc < 0 ) {
          
          SG_error("SG_proc_read_int64('ERROR') rc = %d\n", rc );
@@ -206,11 +243,11 @@ static int RG_server_manifest_get( struct SG_gateway* gateway, struct SG_request
       }
       
       // get the serialized manifest 
-      rc = SG_proc_read_chunk( SG_proc_stdout_f( proc ), &chunk );
+      rc = SG_proc_read_chunk( SG_proc_call_reply( &call ), &chunk );
       if( rc < 0 ) {
          
          // OOM, EOF, or driver crash (error is -ENOMEM, -ENODATA, or -EIO, respectively)
-         SG_error( "SG_proc_read_chunk(%d) rc = %d\n", fileno( SG_proc_stdout_f( proc ) ), rc );
+         SG_error( "SG_proc_read_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          goto RG_server_manifest_get_finish;
       }
       
@@ -250,6 +287,7 @@ static int RG_server_manifest_get( struct SG_gateway* gateway, struct SG_request
 RG_server_manifest_get_finish:
 
    if( group != NULL && proc != NULL ) {
+      SG_proc_call_free( &call );
       SG_proc_group_release( group, proc );
    }
    
@@ -270,6 +308,7 @@ static int RG_server_block_put( struct SG_gateway* gateway, struct SG_request_da
    struct RG_core* core = (struct RG_core*)SG_gateway_cls( gateway );
    struct SG_proc_group* group = NULL;
    struct SG_proc* proc = NULL;
+   struct SG_proc_call call;
    struct ms_client* ms = SG_gateway_ms( gateway );
    SG_messages::DriverRequest driver_req; 
    
@@ -289,6 +328,13 @@ static int RG_server_block_put( struct SG_gateway* gateway, struct SG_request_da
          rc = -ENODATA;
          goto RG_server_block_put_finish;
       }
+
+      rc = SG_proc_call_init( &call, proc );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_init rc = %d\n", rc );
+         goto RG_server_block_put_finish;
+      }
       
       // send request 
       rc = SG_proc_request_init( ms, reqdat, &driver_req );
@@ -302,30 +348,40 @@ static int RG_server_block_put( struct SG_gateway* gateway, struct SG_request_da
 
       SG_debug("Request put %s\n", (driver_req.request_type() == SG_messages::DriverRequest::MANIFEST ? "manifest" : "block"));
 
-      rc = SG_proc_write_request( SG_proc_stdin( proc ), &driver_req );
+      rc = SG_proc_call_write_request( &call, &driver_req );
       if( rc < 0 ) {
 
-         SG_error("SG_proc_write_request(%d) rc = %d\n", SG_proc_stdin( proc ), rc );
+         SG_error("SG_proc_write_request(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -ENODATA;
          goto RG_server_block_put_finish;
       }
 
       // put the block 
-      rc = SG_proc_write_chunk( SG_proc_stdin( proc ), block );
+      rc = SG_proc_call_write_chunk( &call, block );
       if( rc < 0 ) {
        
-         SG_error("SG_proc_write_chunk(%d) rc = %d\n", SG_proc_stdin( proc ), rc );
+         SG_error("SG_proc_write_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -ENODATA;
          goto RG_server_block_put_finish;
       }
       
+      // send it off, and wait for the reply
+      rc = SG_proc_call_send( &call );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_send(%d) rc = %d\n", SG_proc_pid( proc ), rc );
+         rc = -EIO;
+
+         goto RG_server_block_put_finish;
+      }
+
       // get the reply 
-      rc = SG_proc_read_int64( SG_proc_stdout_f( proc ), &worker_rc );
+      rc = SG_proc_read_int64( SG_proc_call_reply( &call ), &worker_rc );
       if( rc < 0 ) {
          
-         SG_error("SG_proc_read_int64(%d) rc = %d\n", fileno(SG_proc_stdout_f( proc )), rc );
+         SG_error("SG_proc_read_int64(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -EIO;
          goto RG_server_block_put_finish;
@@ -351,6 +407,7 @@ static int RG_server_block_put( struct SG_gateway* gateway, struct SG_request_da
 RG_server_block_put_finish:
    
    if( group != NULL && proc != NULL ) {
+      SG_proc_call_free( &call );
       SG_proc_group_release( group, proc );
    }
    
@@ -407,6 +464,7 @@ static int RG_server_block_delete( struct SG_gateway* gateway, struct SG_request
    int rc = 0;
    int64_t worker_rc = 0;
    struct SG_proc* proc = NULL;
+   struct SG_proc_call call;
    struct SG_proc_group* group = NULL;
    struct ms_client* ms = SG_gateway_ms( gateway );
    SG_messages::DriverRequest driver_req;
@@ -428,6 +486,13 @@ static int RG_server_block_delete( struct SG_gateway* gateway, struct SG_request
          rc = -ENODATA;
          goto RG_server_block_delete_finish;
       }
+
+      rc = SG_proc_call_init( &call, proc );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_init rc = %d\n", rc );
+         goto RG_server_block_delete_finish;
+      }
       
       // send the worker the request 
       rc = SG_proc_request_init( ms, reqdat, &driver_req );
@@ -441,20 +506,30 @@ static int RG_server_block_delete( struct SG_gateway* gateway, struct SG_request
 
       SG_debug("Request delete %s\n", (driver_req.request_type() == SG_messages::DriverRequest::MANIFEST ? "manifest" : "block"));
 
-      rc = SG_proc_write_request( SG_proc_stdin( proc ), &driver_req );
+      rc = SG_proc_call_write_request( &call, &driver_req );
       if( rc != 0 ) {
 
-         SG_error("SG_proc_write_request(%d) rc = %d\n", SG_proc_stdin( proc ), rc );
+         SG_error("SG_proc_write_request(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -ENODATA;
          goto RG_server_block_delete_finish;
       }
 
+      // send it off, and wait for the reply
+      rc = SG_proc_call_send( &call );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_send(%d) rc = %d\n", SG_proc_pid( proc ), rc );
+         rc = -EIO;
+
+         goto RG_server_block_delete_finish;
+      }
+
       // get a reply 
-      rc = SG_proc_read_int64( SG_proc_stdout_f( proc ), &worker_rc );
+      rc = SG_proc_read_int64( SG_proc_call_reply( &call ), &worker_rc );
       if( rc < 0 ) {
          
-         SG_error("SG_proc_read_int64(%d) rc = %d\n", SG_proc_stdin( proc ), rc );
+         SG_error("SG_proc_read_int64(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -EIO;
          goto RG_server_block_delete_finish;
@@ -480,6 +555,7 @@ static int RG_server_block_delete( struct SG_gateway* gateway, struct SG_request
 RG_server_block_delete_finish:
     
    if( group != NULL && proc != NULL ) {
+      SG_proc_call_free( &call );
       SG_proc_group_release( group, proc );
    } 
 
@@ -510,6 +586,7 @@ int RG_server_chunk_deserialize( struct SG_gateway* gateway, struct SG_request_d
    struct RG_core* core = (struct RG_core*)SG_gateway_cls( gateway );
    struct SG_proc_group* group = NULL;
    struct SG_proc* proc = NULL;
+   struct SG_proc_call call;
    struct ms_client* ms = SG_gateway_ms( gateway );
    SG_messages::DriverRequest driver_req;
    struct SG_driver* driver = NULL;
@@ -530,6 +607,13 @@ int RG_server_chunk_deserialize( struct SG_gateway* gateway, struct SG_request_d
          rc = -EAGAIN;
          goto RG_server_chunk_deserialize_finish;
       }
+
+      rc = SG_proc_call_init( &call, proc );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_init rc = %d\n", rc );
+         goto RG_server_chunk_deserialize_finish;
+      }
       
       // feed in the metadata for this block
       rc = SG_proc_request_init( ms, reqdat, &driver_req );
@@ -540,7 +624,7 @@ int RG_server_chunk_deserialize( struct SG_gateway* gateway, struct SG_request_d
          goto RG_server_chunk_deserialize_finish;
       }
 
-      rc = SG_proc_write_request( SG_proc_stdin( proc ), &driver_req );
+      rc = SG_proc_call_write_request( &call, &driver_req );
       if( rc != 0 ) {
 
          SG_error("SG_proc_write_request rc = %d\n", rc );
@@ -549,17 +633,27 @@ int RG_server_chunk_deserialize( struct SG_gateway* gateway, struct SG_request_d
       }
 
       // feed in the block itself 
-      rc = SG_proc_write_chunk( SG_proc_stdin( proc ), in_chunk );
+      rc = SG_proc_call_write_chunk( &call, in_chunk );
       if( rc < 0 ) {
 
-         SG_error("SG_proc_write_chunk(%d) rc = %d\n", SG_proc_stdin(proc), rc );
+         SG_error("SG_proc_write_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
+
+         rc = -EIO;
+         goto RG_server_chunk_deserialize_finish;
+      }
+
+      // send it off, and wait for the reply
+      rc = SG_proc_call_send( &call );
+      if( rc != 0 ) {
 
+         SG_error("SG_proc_call_send(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          rc = -EIO;
+
          goto RG_server_chunk_deserialize_finish;
       }
 
       // get error code 
-      rc = SG_proc_read_int64( SG_proc_stdout_f( proc ), &worker_rc );
+      rc = SG_proc_read_int64( SG_proc_call_reply( &call ), &worker_rc );
       if( rc < 0 ) {
          
          SG_error("SG_proc_read_int64('ERROR') rc = %d\n", rc );
@@ -580,10 +674,10 @@ int RG_server_chunk_deserialize( struct SG_gateway* gateway, struct SG_request_d
       }
       
       // get the serialized chunk 
-      rc = SG_proc_read_chunk( SG_proc_stdout_f( proc ), out_chunk );
+      rc = SG_proc_read_chunk( SG_proc_call_reply( &call ), out_chunk );
       if( rc < 0 ) {
          
-         SG_error("SG_proc_read_chunk(%d) rc = %d\n", fileno( SG_proc_stdout_f(proc) ), rc );
+         SG_error("SG_proc_read_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          // OOM, EOF, or driver crash (rc is -ENOMEM, -ENODATA, or -EIO, respectively)
          goto RG_server_chunk_deserialize_finish;
@@ -591,13 +685,14 @@ int RG_server_chunk_deserialize( struct SG_gateway* gateway, struct SG_request_d
    }
    else {
       
-      // no-op deserializer 
-      rc = SG_chunk_dup( out_chunk, in_chunk );
+      // no-op deserializer (the caller frees the result with SG_chunk_free, so it can be a recycled block buffer)
+      rc = SG_chunk_dup_pooled( out_chunk, in_chunk );
    }
   
 RG_server_chunk_deserialize_finish: 
 
    if( group != NULL && proc != NULL ) {
+      SG_proc_call_free( &call );
       SG_proc_group_release( group, proc );
    }
    
@@ -622,6 +717,7 @@ int RG_server_chunk_serialize( struct SG_gateway* gateway, struct SG_request_dat
    struct RG_core* core = (struct RG_core*)SG_gateway_cls( gateway );
    struct SG_proc_group* group = NULL;
    struct SG_proc* proc = NULL;
+   struct SG_proc_call call;
    struct SG_driver* driver = NULL;
    struct ms_client* ms = SG_gateway_ms( gateway );
    SG_messages::DriverRequest driver_req;
@@ -645,6 +741,13 @@ int RG_server_chunk_serialize( struct SG_gateway* gateway, struct SG_request_dat
          goto RG_server_chunk_serialize_finish;
       }
 
+      rc = SG_proc_call_init( &call, proc );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_init rc = %d\n", rc );
+         goto RG_server_chunk_serialize_finish;
+      }
+
       // feed in the metadata for this block
       rc = SG_proc_request_init( ms, reqdat, &driver_req );
       if( rc != 0 ) {
@@ -654,7 +757,7 @@ int RG_server_chunk_serialize( struct SG_gateway* gateway, struct SG_request_dat
          goto RG_server_chunk_serialize_finish;
       }
 
-      rc = SG_proc_write_request( SG_proc_stdin( proc ), &driver_req );
+      rc = SG_proc_call_write_request( &call, &driver_req );
       if( rc != 0 ) {
 
          SG_error("SG_proc_write_request rc = %d\n", rc );
@@ -663,20 +766,30 @@ int RG_server_chunk_serialize( struct SG_gateway* gateway, struct SG_request_dat
       }
 
       // put the block 
-      rc = SG_proc_write_chunk( SG_proc_stdin( proc ), in_chunk );
+      rc = SG_proc_call_write_chunk( &call, in_chunk );
       if( rc < 0 ) {
        
-         SG_error("SG_proc_write_chunk(%d) rc = %d\n", SG_proc_stdin( proc ), rc );
+         SG_error("SG_proc_write_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -EIO;
          goto RG_server_chunk_serialize_finish;
       }
       
+      // send it off, and wait for the reply
+      rc = SG_proc_call_send( &call );
+      if( rc != 0 ) {
+
+         SG_error("SG_proc_call_send(%d) rc = %d\n", SG_proc_pid( proc ), rc );
+         rc = -EIO;
+
+         goto RG_server_chunk_serialize_finish;
+      }
+
       // get the reply 
-      rc = SG_proc_read_int64( SG_proc_stdout_f( proc ), &worker_rc );
+      rc = SG_proc_read_int64( SG_proc_call_reply( &call ), &worker_rc );
       if( rc < 0 ) {
          
-         SG_error("SG_proc_read_int64(%d) rc = %d\n", fileno(SG_proc_stdout_f( proc )), rc );
+         SG_error("SG_proc_read_int64(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          
          rc = -EIO;
          goto RG_server_chunk_serialize_finish;
@@ -693,10 +806,10 @@ int RG_server_chunk_serialize( struct SG_gateway* gateway, struct SG_request_dat
       }
 
       // get the deserialized chunk 
-      rc = SG_proc_read_chunk( SG_proc_stdout_f( proc ), out_chunk );
+      rc = SG_proc_read_chunk( SG_proc_call_reply( &call ), out_chunk );
       if( rc != 0 ) {
 
-         SG_error("SG_proc_read_chunk(%d) rc = %d\n", fileno(SG_proc_stdout_f(proc)), rc );
+         SG_error("SG_proc_read_chunk(%d) rc = %d\n", SG_proc_pid( proc ), rc );
          goto RG_server_chunk_serialize_finish;
       }
    }
@@ -709,6 +822,7 @@ int RG_server_chunk_serialize( struct SG_gateway* gateway, struct SG_request_dat
 RG_server_chunk_serialize_finish:
    
    if( group != NULL && proc != NULL ) {
+      SG_proc_call_free( &call );
       SG_proc_group_release( group, proc );
    }
    
@@ -0,0 +1,474 @@
+/*
+   Copyright 2016 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License" );
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Concurrent writer/reader stress test.
+ *
+ * Each of num_threads threads opens the file and, for num_rounds rounds, overwrites its own block (1 + thread ID)
+ * and the shared block 0 with a block full of (thread ID, round, block ID) stamps.  Between writes it reads back
+ * its own block, the shared block, and its neighbor's block, and checks that each holds exactly one write (never
+ * a mix of two), and that its neighbor's rounds never go backwards.  Once every thread is done, each private block
+ * must hold its owner's last write, and the shared block must hold the last write of one of the threads.
+ *
+ * The file is created if it does not exist.  Exits 1 if any check fails.
+ */
+
+#include "syndicate-stress.h"
+
+// a block's contents: this stamp, over and over
+struct stress_stamp {
+
+   uint32_t thread_id;
+   uint32_t round;              // 1-based, so a hole never looks like a write
+   uint64_t block_id;
+};
+
+// shared test parameters
+struct stress_ctx {
+
+   struct UG_state* ug;
+   char const* path;
+   uint64_t block_size;
+   int num_threads;
+   int num_rounds;
+};
+
+// per-thread state
+struct stress_thread_args {
+
+   struct stress_ctx* ctx;
+   int thread_id;
+   int errors;
+   pthread_t thread;
+};
+
+
+// fill a block with a stamp
+static void stress_fill( char* buf, uint64_t len, struct stress_stamp* stamp ) {
+
+   for( uint64_t off = 0; off < len; off += sizeof(struct stress_stamp) ) {
+      memcpy( buf + off, stamp, MIN( sizeof(struct stress_stamp), len - off ) );
+   }
+}
+
+
+// get the stamp a block was filled with
+// return 0 on success, and set *stamp
+// return -EBADMSG if the block holds more than one stamp (i.e. it's torn)
+static int stress_parse( char const* buf, uint64_t len, struct stress_stamp* stamp ) {
+
+   memset( stamp, 0, sizeof(struct stress_stamp) );
+   memcpy( stamp, buf, MIN( sizeof(struct stress_stamp), len ) );
+
+   for( uint64_t off = 0; off < len; off += sizeof(struct stress_stamp) ) {
+
+      if( memcmp( buf + off, stamp, MIN( sizeof(struct stress_stamp), len - off ) ) != 0 ) {
+         return -EBADMSG;
+      }
+   }
+
+   return 0;
+}
+
+
+// write a whole block
+// return 0 on success
+// return negative on error (from UG_seek or UG_write)
+static int stress_write_block( struct UG_state* ug, UG_handle_t* fh, uint64_t block_id, char const* buf, uint64_t len ) {
+
+   int rc = 0;
+   uint64_t num_written = 0;
+
+   rc = UG_seek( fh, block_id * len, SEEK_SET );
+   if( rc < 0 ) {
+      return rc;
+   }
+
+   while( num_written < len ) {
+
+      rc = UG_write( ug, buf + num_written, len - num_written, fh );
+      if( rc < 0 ) {
+         return rc;
+      }
+
+      num_written += rc;
+   }
+
+   return 0;
+}
+
+
+// read a whole block
+// return the number of bytes read on success (short on EOF)
+// return negative on error (from UG_seek or UG_read)
+static ssize_t stress_read_block( struct UG_state* ug, UG_handle_t* fh, uint64_t block_id, char* buf, uint64_t len ) {
+
+   int rc = 0;
+   uint64_t num_read = 0;
+
+   memset( buf, 0, len );
+
+   rc = UG_seek( fh, block_id * len, SEEK_SET );
+   if( rc < 0 ) {
+      return rc;
+   }
+
+   while( num_read < len ) {
+
+      rc = UG_read( ug, buf + num_read, len - num_read, fh );
+      if( rc < 0 ) {
+         return rc;
+      }
+
+      if( rc == 0 ) {
+         break;
+      }
+
+      num_read += rc;
+   }
+
+   return num_read;
+}
+
+
+// read a block and get its stamp
+// return 0 on success, and set *stamp (all 0's if the block has not been written yet)
+// return -EBADMSG if the block is torn
+// return negative on read error
+static int stress_read_stamp( struct UG_state* ug, UG_handle_t* fh, uint64_t block_id, char* buf, uint64_t len, struct stress_stamp* stamp ) {
+
+   ssize_t nr = stress_read_block( ug, fh, block_id, buf, len );
+   if( nr < 0 ) {
+      return (int)nr;
+   }
+
+   return stress_parse( buf, len, stamp );
+}
+
+
+// writer/reader thread
+static void* stress_thread_main( void* arg ) {
+
+   struct stress_thread_args* args = (struct stress_thread_args*)arg;
+   struct stress_ctx* ctx = args->ctx;
+   struct UG_state* ug = ctx->ug;
+   uint64_t len = ctx->block_size;
+   int rc = 0;
+   UG_handle_t* fh = NULL;
+   char* wbuf = NULL;
+   char* rbuf = NULL;
+   struct stress_stamp stamp;
+   struct stress_stamp seen;
+   uint64_t my_block = 1 + args->thread_id;
+   uint64_t neighbor_block = 1 + ((args->thread_id + 1) % ctx->num_threads);
+   uint32_t neighbor_round = 0;
+
+   wbuf = SG_CALLOC( char, len );
+   rbuf = SG_CALLOC( char, len );
+
+   if( wbuf == NULL || rbuf == NULL ) {
+
+      fprintf(stderr, "[%d] Out of memory\n", args->thread_id );
+      args->errors++;
+      goto stress_thread_end;
+   }
+
+   fh = UG_open( ug, ctx->path, O_RDWR, &rc );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "[%d] Failed to open '%s': %d %s\n", args->thread_id, ctx->path, rc, strerror( abs(rc) ) );
+      args->errors++;
+      goto stress_thread_end;
+   }
+
+   for( int r = 1; r <= ctx->num_rounds; r++ ) {
+
+      // different blocks: write ours, and read it back
+      memset( &stamp, 0, sizeof(stamp) );
+      stamp.thread_id = args->thread_id;
+      stamp.round = r;
+      stamp.block_id = my_block;
+
+      stress_fill( wbuf, len, &stamp );
+
+      rc = stress_write_block( ug, fh, my_block, wbuf, len );
+      if( rc != 0 ) {
+
+         fprintf(stderr, "[%d] write block %" PRIu64 " (round %d): %d %s\n", args->thread_id, my_block, r, rc, strerror( abs(rc) ) );
+         args->errors++;
+         break;
+      }
+
+      rc = stress_read_stamp( ug, fh, my_block, rbuf, len, &seen );
+      if( rc != 0 || memcmp( &seen, &stamp, sizeof(stamp) ) != 0 ) {
+
+         fprintf(stderr, "[%d] block %" PRIu64 " (round %d): rc = %d, expected (%u, %u, %" PRIu64 "), got (%u, %u, %" PRIu64 ")\n",
+                 args->thread_id, my_block, r, rc, stamp.thread_id, stamp.round, stamp.block_id, seen.thread_id, seen.round, seen.block_id );
+         args->errors++;
+      }
+
+      // same block: write the shared block, and read back some thread's whole write
+      stamp.block_id = 0;
+      stress_fill( wbuf, len, &stamp );
+
+      rc = stress_write_block( ug, fh, 0, wbuf, len );
+      if( rc != 0 ) {
+
+         fprintf(stderr, "[%d] write block 0 (round %d): %d %s\n", args->thread_id, r, rc, strerror( abs(rc) ) );
+         args->errors++;
+         break;
+      }
+
+      rc = stress_read_stamp( ug, fh, 0, rbuf, len, &seen );
+      if( rc != 0 || seen.block_id != 0 || seen.thread_id >= (uint32_t)ctx->num_threads || seen.round == 0 || seen.round > (uint32_t)ctx->num_rounds ) {
+
+         fprintf(stderr, "[%d] block 0 (round %d): rc = %d, got (%u, %u, %" PRIu64 ")\n", args->thread_id, r, rc, seen.thread_id, seen.round, seen.block_id );
+         args->errors++;
+      }
+
+      // another writer's block: each read sees one of its writes, and never an older one than last time
+      rc = stress_read_stamp( ug, fh, neighbor_block, rbuf, len, &seen );
+      if( rc == 0 && seen.round == 0 && seen.block_id == 0 ) {
+
+         // not written yet
+         continue;
+      }
+
+      if( rc != 0 || seen.block_id != neighbor_block || seen.thread_id != neighbor_block - 1 || seen.round < neighbor_round || seen.round > (uint32_t)ctx->num_rounds ) {
+
+         fprintf(stderr, "[%d] block %" PRIu64 " (round %d): rc = %d, got (%u, %u, %" PRIu64 ") after round %u\n",
+                 args->thread_id, neighbor_block, r, rc, seen.thread_id, seen.round, seen.block_id, neighbor_round );
+         args->errors++;
+      }
+      else {
+
+         neighbor_round = seen.round;
+      }
+   }
+
+   rc = UG_fsync( ug, fh );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "[%d] Failed to fsync '%s': %d %s\n", args->thread_id, ctx->path, rc, strerror( abs(rc) ) );
+      args->errors++;
+   }
+
+   rc = UG_close( ug, fh );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "[%d] Failed to close '%s': %d %s\n", args->thread_id, ctx->path, rc, strerror( abs(rc) ) );
+      args->errors++;
+   }
+
+stress_thread_end:
+
+   SG_safe_free( wbuf );
+   SG_safe_free( rbuf );
+
+   return NULL;
+}
+
+
+// check the file's final contents: each private block holds its owner's last write,
+// and the shared block holds some thread's last write
+// return the number of bad blocks
+static int stress_verify( struct stress_ctx* ctx ) {
+
+   int rc = 0;
+   int errors = 0;
+   UG_handle_t* fh = NULL;
+   char* buf = NULL;
+   struct stress_stamp seen;
+
+   buf = SG_CALLOC( char, ctx->block_size );
+   if( buf == NULL ) {
+
+      fprintf(stderr, "Out of memory\n");
+      return 1;
+   }
+
+   fh = UG_open( ctx->ug, ctx->path, O_RDONLY, &rc );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "Failed to open '%s': %d %s\n", ctx->path, rc, strerror( abs(rc) ) );
+      SG_safe_free( buf );
+      return 1;
+   }
+
+   rc = stress_read_stamp( ctx->ug, fh, 0, buf, ctx->block_size, &seen );
+   if( rc != 0 || seen.block_id != 0 || seen.thread_id >= (uint32_t)ctx->num_threads || seen.round != (uint32_t)ctx->num_rounds ) {
+
+      fprintf(stderr, "Final block 0: rc = %d, got (%u, %u, %" PRIu64 ")\n", rc, seen.thread_id, seen.round, seen.block_id );
+      errors++;
+   }
+
+   for( int i = 0; i < ctx->num_threads; i++ ) {
+
+      uint64_t block_id = 1 + i;
+
+      rc = stress_read_stamp( ctx->ug, fh, block_id, buf, ctx->block_size, &seen );
+      if( rc != 0 || seen.block_id != block_id || seen.thread_id != (uint32_t)i || seen.round != (uint32_t)ctx->num_rounds ) {
+
+         fprintf(stderr, "Final block %" PRIu64 ": rc = %d, expected (%d, %d, %" PRIu64 "), got (%u, %u, %" PRIu64 ")\n",
+                 block_id, rc, i, ctx->num_rounds, block_id, seen.thread_id, seen.round, seen.block_id );
+         errors++;
+      }
+   }
+
+   UG_close( ctx->ug, fh );
+   SG_safe_free( buf );
+
+   return errors;
+}
+
+
+// entry point
+int main( int argc, char** argv ) {
+
+   int rc = 0;
+   struct UG_state* ug = NULL;
+   struct SG_gateway* gateway = NULL;
+   int args_start = 0;
+   UG_handle_t* fh = NULL;
+   char* tmp = NULL;
+   int errors = 0;
+   struct stress_ctx ctx;
+   struct stress_thread_args* thread_args = NULL;
+   int num_started = 0;
+
+   mode_t um = umask(0);
+   umask( um );
+
+   struct tool_opts opts;
+
+   memset( &opts, 0, sizeof(tool_opts) );
+   memset( &ctx, 0, sizeof(ctx) );
+
+   rc = parse_args( argc, argv, &opts );
+   if( rc != 0 ) {
+
+      usage( argv[0], "syndicate_file num_threads num_rounds" );
+      md_common_usage();
+      exit(1);
+   }
+
+   // setup...
+   ug = UG_init( argc, argv, opts.anonymous );
+   if( ug == NULL ) {
+
+      SG_error("%s", "UG_init failed\n" );
+      exit(1);
+   }
+
+   gateway = UG_state_gateway( ug );
+
+   // sanity check
+   args_start = SG_gateway_first_arg_optind( gateway );
+   if( argc - args_start != 3 ) {
+
+      usage( argv[0], "syndicate_file num_threads num_rounds" );
+      UG_shutdown( ug );
+      exit(1);
+   }
+
+   ctx.ug = ug;
+   ctx.path = argv[args_start];
+   ctx.block_size = ms_client_get_volume_blocksize( SG_gateway_ms( gateway ) );
+
+   ctx.num_threads = (int)strtol( argv[args_start+1], &tmp, 10 );
+   if( *tmp != '\0' || ctx.num_threads <= 0 ) {
+
+      fprintf(stderr, "Failed to parse num_threads '%s'\n", argv[args_start+1] );
+      UG_shutdown( ug );
+      exit(1);
+   }
+
+   ctx.num_rounds = (int)strtol( argv[args_start+2], &tmp, 10 );
+   if( *tmp != '\0' || ctx.num_rounds <= 0 ) {
+
+      fprintf(stderr, "Failed to parse num_rounds '%s'\n", argv[args_start+2] );
+      UG_shutdown( ug );
+      exit(1);
+   }
+
+   // make sure the file exists
+   fh = UG_create( ug, ctx.path, 0600, &rc );
+   if( rc == 0 ) {
+
+      rc = UG_close( ug, fh );
+      if( rc != 0 ) {
+
+         fprintf(stderr, "Failed to close '%s': %d %s\n", ctx.path, rc, strerror( abs(rc) ) );
+         rc = 1;
+         goto stress_end;
+      }
+   }
+   else if( rc != -EEXIST ) {
+
+      fprintf(stderr, "Failed to create '%s': %d %s\n", ctx.path, rc, strerror( abs(rc) ) );
+      rc = 1;
+      goto stress_end;
+   }
+
+   thread_args = SG_CALLOC( struct stress_thread_args, ctx.num_threads );
+   if( thread_args == NULL ) {
+
+      fprintf(stderr, "Out of memory\n");
+      rc = 1;
+      goto stress_end;
+   }
+
+   // go!
+   for( num_started = 0; num_started < ctx.num_threads; num_started++ ) {
+
+      thread_args[num_started].ctx = &ctx;
+      thread_args[num_started].thread_id = num_started;
+
+      rc = pthread_create( &thread_args[num_started].thread, NULL, stress_thread_main, &thread_args[num_started] );
+      if( rc != 0 ) {
+
+         fprintf(stderr, "pthread_create rc = %d\n", rc );
+         errors++;
+         break;
+      }
+   }
+
+   for( int i = 0; i < num_started; i++ ) {
+
+      pthread_join( thread_args[i].thread, NULL );
+      errors += thread_args[i].errors;
+   }
+
+   if( errors == 0 ) {
+      errors += stress_verify( &ctx );
+   }
+
+   printf("%d threads, %d rounds, %" PRIu64 "-byte blocks: %d error(s)\n", ctx.num_threads, ctx.num_rounds, ctx.block_size, errors );
+
+   rc = (errors == 0 ? 0 : 1);
+
+stress_end:
+
+   SG_safe_free( thread_args );
+   UG_shutdown( ug );
+
+   if( rc != 0 ) {
+      exit(1);
+   }
+   else {
+      exit(0);
+   }
+}
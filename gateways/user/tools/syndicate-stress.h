@@ -0,0 +1,25 @@
+/*
+   Copyright 2016 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License" );
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef _SYNDICATE_STRESS_H_
+#define _SYNDICATE_STRESS_H_
+
+#include <libsyndicate-ug/client.h>
+#include <libsyndicate-ug/core.h>
+
+#include "common.h"
+
+#endif
@@ -34,13 +34,14 @@ int UG_dirty_block_init_ram( struct UG_dirty_block* dirty_block, struct SG_manif
       return rc;
    }
    
-   buf_dup = SG_CALLOC( char, buflen );
+   buf_dup = md_bufpool_alloc( buflen );
    if( buf_dup == NULL ) {
       
       SG_manifest_block_free( &dirty_block->info );
       return -ENOMEM;
    }
    
+   memcpy( buf_dup, buf, buflen );
    SG_chunk_init( &dirty_block->buf, buf_dup, buflen );
    
    dirty_block->block_fd = -1;
@@ -120,7 +121,7 @@ int UG_dirty_block_deepcopy( struct UG_dirty_block* dest, struct UG_dirty_block*
    
    if( src->buf.data != NULL ) {
       
-      char* buf_dup = SG_CALLOC( char, src->buf.len );
+      char* buf_dup = md_bufpool_alloc( src->buf.len );
       if( buf_dup == NULL ) {
          
          SG_manifest_block_free( &dest->info );
@@ -623,7 +624,7 @@ int UG_dirty_block_buf_unshare( struct UG_dirty_block* dirty_block ) {
       return -EINVAL;
    }
    
-   rc = SG_chunk_dup( &chunk_dup, &dirty_block->buf );
+   rc = SG_chunk_dup_pooled( &chunk_dup, &dirty_block->buf );
    if( rc != 0 ) {
       
       return rc;
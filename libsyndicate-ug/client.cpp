@@ -193,29 +193,24 @@ static int UG_update_propagate_local( struct UG_inode* inode, struct md_entry* i
 }
 
 
-// ask the MS to update inode metadata
-// NULL data will be ignored.
+// snapshot an inode we coordinate, in order to send its metadata to the MS with the given changes applied.
+// on success, *inode_data holds the entry to send (its xattr hash points to xattr_hash), *write_nonce holds the inode's write nonce as of the snapshot,
+// and *ret_fent holds a reference to the inode's entry.  Pass them to UG_update_local_finish once the MS replies.
 // the associated inode must be unlocked or read-locked
 // return 0 on success 
-// return -EINVAL if all data are NULL
 // return -ENOMEM on OOM
-static int UG_update_local( struct UG_state* state, char const* path, struct SG_client_WRITE_data* write_data ) {
+// return -errno on failure to resolve the path
+static int UG_update_local_begin( struct UG_state* state, char const* path, struct SG_client_WRITE_data* write_data,
+                                  struct md_entry* inode_data, unsigned char* xattr_hash, int64_t* write_nonce, struct fskit_entry** ret_fent ) {
    
    int rc = 0;
-   struct md_entry inode_data;
    
    struct fskit_core* fs = UG_state_fs( state );
    struct SG_gateway* gateway = UG_state_gateway( state );
-   struct ms_client* ms = SG_gateway_ms( gateway );
-   
-   int64_t write_nonce = 0;
-   struct md_entry inode_data_out;
-   memset( &inode_data_out, 0, sizeof(struct md_entry) );
    
    struct fskit_entry* fent = NULL;
    struct UG_inode* inode = NULL;
    
-   unsigned char xattr_hash[SHA256_DIGEST_LENGTH];
    memset( xattr_hash, 0, SHA256_DIGEST_LENGTH );
    
    // keep this around...
@@ -229,9 +224,9 @@ static int UG_update_local( struct UG_state* state, char const* path, struct SG_
    
    inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
    
-   write_nonce = UG_inode_write_nonce( inode );
+   *write_nonce = UG_inode_write_nonce( inode );
    
-   rc = UG_inode_export( &inode_data, inode, 0 );
+   rc = UG_inode_export( inode_data, inode, 0 );
    if( rc != 0 ) {
       
       fskit_entry_unlock( fent );
@@ -244,14 +239,84 @@ static int UG_update_local( struct UG_state* state, char const* path, struct SG_
        
       fskit_entry_unlock( fent );
       fskit_entry_unref( fs, path, fent );
+      md_entry_free( inode_data );
       return rc;
    }
    
    fskit_entry_unlock( fent );
    
    // apply changes to the inode we'll send
-   SG_client_WRITE_data_merge( write_data, &inode_data );
-   inode_data.xattr_hash = xattr_hash;
+   SG_client_WRITE_data_merge( write_data, inode_data );
+   inode_data->xattr_hash = xattr_hash;
+   
+   *ret_fent = fent;
+   return 0;
+}
+
+
+// apply the MS's copy of an inode we coordinate (if given) to the inode, and release the reference from UG_update_local_begin.
+// if the inode was written since UG_update_local_begin, it is marked stale instead.
+// the associated inode must be unlocked
+// always succeeds
+static int UG_update_local_finish( struct UG_state* state, char const* path, struct fskit_entry* fent, int64_t write_nonce, struct md_entry* inode_data_out ) {
+   
+   struct fskit_core* fs = UG_state_fs( state );
+   struct UG_inode* inode = NULL;
+   
+   if( inode_data_out != NULL ) {
+      
+      fskit_entry_wlock( fent );
+      
+      inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
+      
+      // propagate information back to the inode
+      if( write_nonce == UG_inode_write_nonce( inode ) ) {
+          
+          // haven't written in the mean time, so apply changes to local copy as well
+          // to keep it coherent with the MS
+          UG_update_propagate_local( inode, inode_data_out );
+      }
+      else {
+          
+          // data has since changed; will need to pull latest 
+          UG_inode_set_read_stale( inode, true );
+      }
+     
+      fskit_entry_unlock( fent );
+   }
+   
+   fskit_entry_unref( fs, path, fent );
+   return 0;
+}
+
+
+// ask the MS to update inode metadata
+// NULL data will be ignored.
+// the associated inode must be unlocked or read-locked
+// return 0 on success 
+// return -EINVAL if all data are NULL
+// return -ENOMEM on OOM
+static int UG_update_local( struct UG_state* state, char const* path, struct SG_client_WRITE_data* write_data ) {
+   
+   int rc = 0;
+   struct md_entry inode_data;
+   
+   struct SG_gateway* gateway = UG_state_gateway( state );
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   
+   int64_t write_nonce = 0;
+   struct md_entry inode_data_out;
+   memset( &inode_data_out, 0, sizeof(struct md_entry) );
+   
+   struct fskit_entry* fent = NULL;
+   
+   unsigned char xattr_hash[SHA256_DIGEST_LENGTH];
+   
+   rc = UG_update_local_begin( state, path, write_data, &inode_data, xattr_hash, &write_nonce, &fent );
+   if( rc != 0 ) {
+      
+      return rc;
+   }
    
    // send the update along
    rc = ms_client_update( ms, &inode_data_out, &inode_data );
@@ -263,30 +328,12 @@ static int UG_update_local( struct UG_state* state, char const* path, struct SG_
       
       SG_error("ms_client_update('%s') rc = %d\n", path, rc );
       
-      fskit_entry_unref( fs, path, fent );
+      UG_update_local_finish( state, path, fent, write_nonce, NULL );
       md_entry_free( &inode_data_out );
       return rc;
    }
    
-   fskit_entry_wlock( fent );
-   
-   inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
-   
-   // propagate information back to the inode
-   if( write_nonce == UG_inode_write_nonce( inode ) ) {
-       
-       // haven't written in the mean time, so apply changes to local copy as well
-       // to keep it coherent with the MS
-       UG_update_propagate_local( inode, &inode_data_out );
-   }
-   else {
-       
-       // data has since changed; will need to pull latest 
-       UG_inode_set_read_stale( inode, true );
-   }
-  
-   fskit_entry_unlock( fent );
-   fskit_entry_unref( fs, path, fent );
+   UG_update_local_finish( state, path, fent, write_nonce, &inode_data_out );
    
    md_entry_free( &inode_data_out ); 
    return 0;
@@ -377,6 +424,208 @@ int UG_update( struct UG_state* state, char const* path, struct SG_client_WRITE_
 }
 
 
+// update a batch of inodes' metadata.  The updates to inodes we coordinate are sent to the MS together, in as few requests as we can.
+// the others--and any whose batched update never reached the MS (i.e. transport errors, or an MS that rejects batches)--are run 
+// one at a time through UG_update, which can forward them to their coordinators (or make us the coordinator).
+// an update the MS tried and rejected is not retried; its error is reported in rcs.
+// rcs[i] is set to the outcome of applying write_datas[i] to paths[i] (see UG_update).
+// return 0 if every update succeeded 
+// return -EIO if at least one update failed (check rcs)
+// return -ENOMEM on OOM, in which case the whole batch should be treated as failed (some updates may have been applied)
+// NOTE: the associated inodes must be unlocked!
+int UG_update_multi( struct UG_state* state, char const** paths, struct SG_client_WRITE_data** write_datas, size_t num_updates, int* rcs ) {
+   
+   int rc = 0;
+   struct SG_gateway* gateway = UG_state_gateway( state );
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   struct fskit_core* fs = UG_state_fs( state );
+   
+   struct md_entry* ents = NULL;                // entries to send for the inodes we coordinate 
+   struct md_entry* ents_out = NULL;            // MS's copies of them
+   unsigned char* xattr_hashes = NULL;          // SHA256_DIGEST_LENGTH bytes per entry
+   int64_t* write_nonces = NULL;
+   struct fskit_entry** fents = NULL;
+   size_t* idxs = NULL;                         // ents[j] updates paths[ idxs[j] ]
+   int* ms_rcs = NULL;
+   size_t num_local = 0;
+   bool* local = NULL;
+   
+   ents = SG_CALLOC( struct md_entry, num_updates );
+   ents_out = SG_CALLOC( struct md_entry, num_updates );
+   xattr_hashes = SG_CALLOC( unsigned char, num_updates * SHA256_DIGEST_LENGTH );
+   write_nonces = SG_CALLOC( int64_t, num_updates );
+   fents = SG_CALLOC( struct fskit_entry*, num_updates );
+   idxs = SG_CALLOC( size_t, num_updates );
+   ms_rcs = SG_CALLOC( int, num_updates );
+   local = SG_CALLOC( bool, num_updates );
+   
+   if( ents == NULL || ents_out == NULL || xattr_hashes == NULL || write_nonces == NULL || fents == NULL || idxs == NULL || ms_rcs == NULL || local == NULL ) {
+      
+      rc = -ENOMEM;
+      goto UG_update_multi_out;
+   }
+   
+   // snapshot each inode we coordinate 
+   for( size_t i = 0; i < num_updates; i++ ) {
+      
+      struct fskit_entry* fent = NULL;
+      struct UG_inode* inode = NULL;
+      uint64_t coordinator_id = 0;
+      
+      rcs[i] = 0;
+      
+      // ensure fresh first
+      rc = UG_consistency_path_ensure_fresh( gateway, paths[i] );
+      if( rc != 0 ) {
+         
+         SG_error("UG_consistency_path_ensure_fresh('%s') rc = %d\n", paths[i], rc );
+         if( rc == -ENOMEM ) {
+            break;
+         }
+         
+         rcs[i] = rc;
+         rc = 0;
+         continue;
+      }
+      
+      // look up coordinator 
+      fent = fskit_entry_ref( fs, paths[i], &rc );
+      if( fent == NULL ) {
+         
+         if( rc == -ENOMEM ) {
+            break;
+         }
+         
+         rcs[i] = rc;
+         rc = 0;
+         continue;
+      }
+      
+      fskit_entry_rlock( fent );
+      
+      inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
+      coordinator_id = UG_inode_coordinator_id( inode );
+      
+      fskit_entry_unlock( fent );
+      fskit_entry_unref( fs, paths[i], fent );
+      
+      if( coordinator_id != SG_gateway_id( gateway ) ) {
+         
+         // not ours; send it individually
+         continue;
+      }
+      
+      rc = UG_update_local_begin( state, paths[i], write_datas[i], &ents[num_local], &xattr_hashes[ num_local * SHA256_DIGEST_LENGTH ], &write_nonces[num_local], &fents[num_local] );
+      if( rc != 0 ) {
+         
+         SG_error("UG_update_local_begin('%s') rc = %d\n", paths[i], rc );
+         if( rc == -ENOMEM ) {
+            break;
+         }
+         
+         rcs[i] = rc;
+         rc = 0;
+         continue;
+      }
+      
+      local[i] = true;
+      idxs[num_local] = i;
+      num_local++;
+   }
+   
+   // send updates for all the inodes we coordinate (unless we already ran out of memory)
+   for( size_t j = 0; j < num_local; j++ ) {
+      ms_rcs[j] = -EAGAIN;
+   }
+   
+   if( rc == 0 && num_local > 0 ) {
+      
+      rc = ms_client_update_multi( ms, ents_out, ents, num_local, ms_rcs );
+      if( rc != 0 ) {
+         
+         // unsent updates have ms_rcs[j] == -EAGAIN, and will be retried individually
+         SG_error("ms_client_update_multi(%zu updates) rc = %d\n", num_local, rc );
+         if( rc != -ENOMEM ) {
+            rc = 0;
+         }
+      }
+   }
+   
+   for( size_t j = 0; j < num_local; j++ ) {
+      
+      size_t i = idxs[j];
+      
+      ents[j].xattr_hash = NULL;
+      md_entry_free( &ents[j] );
+      
+      if( ms_rcs[j] == 0 ) {
+         
+         UG_update_local_finish( state, paths[i], fents[j], write_nonces[j], &ents_out[j] );
+         md_entry_free( &ents_out[j] );
+      }
+      else if( ms_rcs[j] == -EAGAIN ) {
+         
+         // never reached the MS
+         SG_error("Batched update of '%s' was not delivered; retrying individually\n", paths[i] );
+         UG_update_local_finish( state, paths[i], fents[j], write_nonces[j], NULL );
+         
+         local[i] = false;
+      }
+      else {
+         
+         // the MS rejected it
+         SG_error("Batched update of '%s' rc = %d\n", paths[i], ms_rcs[j] );
+         UG_update_local_finish( state, paths[i], fents[j], write_nonces[j], NULL );
+         
+         rcs[i] = ms_rcs[j];
+      }
+   }
+   
+   if( rc == -ENOMEM ) {
+      goto UG_update_multi_out;
+   }
+   
+   // everything else, one at a time 
+   for( size_t i = 0; i < num_updates; i++ ) {
+      
+      if( local[i] || rcs[i] != 0 ) {
+         continue;
+      }
+      
+      rcs[i] = UG_update( state, paths[i], write_datas[i] );
+      if( rcs[i] != 0 ) {
+         
+         SG_error("UG_update('%s') rc = %d\n", paths[i], rcs[i] );
+         if( rcs[i] == -ENOMEM ) {
+            
+            rc = -ENOMEM;
+            goto UG_update_multi_out;
+         }
+      }
+   }
+   
+   for( size_t i = 0; i < num_updates; i++ ) {
+      
+      if( rcs[i] != 0 ) {
+         rc = -EIO;
+      }
+   }
+   
+UG_update_multi_out:
+
+   SG_safe_free( ents );
+   SG_safe_free( ents_out );
+   SG_safe_free( xattr_hashes );
+   SG_safe_free( write_nonces );
+   SG_safe_free( fents );
+   SG_safe_free( idxs );
+   SG_safe_free( ms_rcs );
+   SG_safe_free( local );
+   
+   return rc;
+}
+
+
 // stat(2)
 // forward to fskit, which will take care of refreshing the inode metadata
 int UG_stat( struct UG_state* state, char const* path, struct stat *statbuf ) {
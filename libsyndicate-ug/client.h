@@ -134,6 +134,7 @@ int UG_refresh( struct UG_state* state, char const* path );
 
 // low-level metadata API
 int UG_update( struct UG_state* state, char const* path, struct SG_client_WRITE_data* write_data );
+int UG_update_multi( struct UG_state* state, char const** paths, struct SG_client_WRITE_data** write_datas, size_t num_updates, int* rcs );
 
 // high-level file data API
 UG_handle_t* UG_create( struct UG_state* state, char const* path, mode_t mode, int* rc  );
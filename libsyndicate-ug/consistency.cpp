@@ -16,6 +16,7 @@
 
 #include "consistency.h"
 #include "read.h"
+#include "mdcache.h"
 
 // ms path entry context 
 struct UG_path_ent_ctx {
@@ -245,9 +246,13 @@ int UG_consistency_manifest_ensure_fresh( struct SG_gateway* gateway, char const
    int64_t file_version = 0;
    uint64_t coordinator_id = 0;
    bool local_coordinator = false;
+   bool restored = false;
+   struct UG_mdcache_update mdcache_update;
 
    memset( &now, 0, sizeof(struct timespec) );
    memset( &manifest_refresh_mtime, 0, sizeof(struct timespec) );
+   memset( &reqdat, 0, sizeof(struct SG_request_data) );
+   memset( &mdcache_update, 0, sizeof(struct UG_mdcache_update) );
    
    // keep around...
    fent = fskit_entry_ref( fs, fs_path, &rc );
@@ -311,48 +316,62 @@ int UG_consistency_manifest_ensure_fresh( struct SG_gateway* gateway, char const
    }
    
    // manifest is stale--must refresh.
-   // get list of gateways to try
-   rc = UG_read_download_gateway_list( gateway, coordinator_id, &gateway_ids_buf, &num_gateway_ids );
-   if( rc != 0 ) {
+   // did we cache this exact manifest before?
+   rc = UG_mdcache_manifest_load( gateway, file_id, file_version, manifest_mtime_sec, manifest_mtime_nsec, &new_manifest );
+   if( rc == 0 ) {
       
-      fskit_entry_unlock( fent );
-      fskit_entry_unref( fs, fs_path, fent );
-      return rc;
+      SG_debug("Restored manifest %" PRIX64 ".%" PRId64 "/manifest.%" PRId64 ".%d from the metadata cache\n", file_id, file_version, manifest_mtime_sec, manifest_mtime_nsec );
+      restored = true;
    }
+   else {
+      
+      // get list of gateways to try
+      rc = UG_read_download_gateway_list( gateway, coordinator_id, &gateway_ids_buf, &num_gateway_ids );
+      if( rc != 0 ) {
+         
+         fskit_entry_unlock( fent );
+         fskit_entry_unref( fs, fs_path, fent );
+         return rc;
+      }
 
-   if( num_gateway_ids == 0 ) {
+      if( num_gateway_ids == 0 ) {
 
-      // no gateways
-      SG_error("%s", "No replica gateways exist; cannot fetch manifest\n");
-      SG_safe_free( gateway_ids_buf );
-      fskit_entry_unlock( fent );
-      fskit_entry_unref( fs, fs_path, fent );
-      return -ENODATA;
-   }
-   
-   // set up a request 
-   rc = SG_request_data_init_manifest( gateway, fs_path, file_id, file_version, manifest_mtime_sec, manifest_mtime_nsec, &reqdat );
-   if( rc != 0 ) {
-   
+         // no gateways
+         SG_error("%s", "No replica gateways exist; cannot fetch manifest\n");
+         SG_safe_free( gateway_ids_buf );
+         fskit_entry_unlock( fent );
+         fskit_entry_unref( fs, fs_path, fent );
+         return -ENODATA;
+      }
+      
+      // set up a request 
+      rc = SG_request_data_init_manifest( gateway, fs_path, file_id, file_version, manifest_mtime_sec, manifest_mtime_nsec, &reqdat );
+      if( rc != 0 ) {
+      
+         SG_safe_free( gateway_ids_buf );
+         fskit_entry_unlock( fent );
+         fskit_entry_unref( fs, fs_path, fent );
+         return rc;
+      }
+      
+      // get the manifest 
+      rc = UG_consistency_manifest_download( gateway, &reqdat, gateway_ids_buf, num_gateway_ids, &new_manifest );
       SG_safe_free( gateway_ids_buf );
-      fskit_entry_unlock( fent );
-      fskit_entry_unref( fs, fs_path, fent );
-      return rc;
-   }
-   
-   // get the manifest 
-   rc = UG_consistency_manifest_download( gateway, &reqdat, gateway_ids_buf, num_gateway_ids, &new_manifest );
-   SG_safe_free( gateway_ids_buf );
-   
-   if( rc != 0 ) {
       
-      SG_error("UG_consistency_manifest_download( %" PRIX64 ".%" PRId64 "/manifest.%ld.%ld ) rc = %d\n", 
-               reqdat.file_id, reqdat.file_version, reqdat.manifest_timestamp.tv_sec, reqdat.manifest_timestamp.tv_nsec, rc );
+      if( rc != 0 ) {
+         
+         SG_error("UG_consistency_manifest_download( %" PRIX64 ".%" PRId64 "/manifest.%ld.%ld ) rc = %d\n", 
+                  reqdat.file_id, reqdat.file_version, reqdat.manifest_timestamp.tv_sec, reqdat.manifest_timestamp.tv_nsec, rc );
+         
+         SG_request_data_free( &reqdat );
+         fskit_entry_unlock( fent ); 
+         fskit_entry_unref( fs, fs_path, fent );
+         return rc;
+      }
       
-      SG_request_data_free( &reqdat );
-      fskit_entry_unlock( fent ); 
-      fskit_entry_unref( fs, fs_path, fent );
-      return rc;
+      // remember it for next time (not fatal if this fails).
+      // serialize it now, before merging, but write it once we've released the inode
+      UG_mdcache_manifest_serialize( gateway, &new_manifest, &mdcache_update );
    }
    
    // merge in new blocks (but keep locally-dirty ones)
@@ -391,8 +410,8 @@ int UG_consistency_manifest_ensure_fresh( struct SG_gateway* gateway, char const
    }
    else {
  
-      SG_error("UG_inode_manifest_merge_blocks( %" PRIX64 ".%" PRId64 "/manifest.%ld.%ld ) rc = %d\n", 
-                reqdat.file_id, reqdat.file_version, reqdat.manifest_timestamp.tv_sec, reqdat.manifest_timestamp.tv_nsec, rc );
+      SG_error("UG_inode_manifest_merge_blocks( %" PRIX64 ".%" PRId64 "/manifest.%" PRId64 ".%d ) rc = %d\n", 
+                file_id, file_version, manifest_mtime_sec, manifest_mtime_nsec, rc );
 
    }
 
@@ -401,7 +420,13 @@ int UG_consistency_manifest_ensure_fresh( struct SG_gateway* gateway, char const
    fskit_entry_unlock( fent );
    fskit_entry_unref( fs, fs_path, fent );
    SG_manifest_free( &new_manifest );
-   SG_request_data_free( &reqdat );
+
+   UG_mdcache_update_write( gateway, &mdcache_update );
+   UG_mdcache_update_free( &mdcache_update );
+   
+   if( !restored ) {
+      SG_request_data_free( &reqdat );
+   }
    
    return rc;
 }
@@ -460,6 +485,7 @@ static int UG_consistency_fskit_entry_replace( struct SG_gateway* gateway, char
    // blow away the inode's cached data
    // (NOTE: don't care if this fails--it'll get reaped eventually)
    md_cache_evict_file( cache, fskit_entry_get_file_id( fent ), UG_inode_file_version( inode ) );
+   UG_mdcache_remove( gateway, fskit_entry_get_file_id( fent ) );
    
    UG_inode_free( inode );
    inode = NULL;
@@ -570,6 +596,7 @@ int UG_consistency_inode_reload( struct SG_gateway* gateway, char const* fs_path
       
       // NOTE: don't really care if cache reversioning fails--it'll get reaped eventually
       md_cache_reversion_file( cache, inode_data->file_id, UG_inode_file_version( inode ), inode_data->version );
+      UG_mdcache_manifest_remove( gateway, inode_data->file_id );
       SG_manifest_set_file_version( UG_inode_manifest( inode ), inode_data->version );
    }
    else {
@@ -1862,6 +1889,179 @@ static int UG_consistency_dir_merge( struct SG_gateway* gateway, char const* fs_
 }
 
 
+// restore a directory's children from the metadata cache, and fetch only the ones created since we cached them.
+// restored children are marked stale, so each will be revalidated (by write nonce) the next time it is accessed.
+// num_children must be the MS's current child count (i.e. dent was just refreshed).
+// return 0 on success
+// return -ENOENT if we have nothing cached for this directory 
+// return -ESTALE if the cached listing no longer matches the MS (i.e. children were removed); the caller should list the directory
+// return -ENOMEM on OOM 
+// return -errno on failure to talk to the MS
+static int UG_consistency_dir_restore( struct SG_gateway* gateway, char const* fs_path, struct fskit_entry* dent, uint64_t file_id, int64_t num_children, struct timespec* now ) {
+   
+   int rc = 0;
+   struct md_entry* ents = NULL;
+   size_t num_ents = 0;
+   int64_t max_generation = 0;
+   int64_t max_new_generation = 0;
+   size_t num_new = 0;
+   set<uint64_t> cached_ids;
+   
+   struct ms_client_multi_result results;
+   struct ms_client_multi_result probe;
+   struct UG_mdcache_update mdcache_update;
+   
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   
+   memset( &results, 0, sizeof(struct ms_client_multi_result) );
+   memset( &probe, 0, sizeof(struct ms_client_multi_result) );
+   memset( &mdcache_update, 0, sizeof(struct UG_mdcache_update) );
+   
+   rc = UG_mdcache_dir_load( gateway, file_id, &ents, &num_ents, &max_generation );
+   if( rc != 0 ) {
+      
+      if( rc != -ENOENT ) {
+         SG_warn("UG_mdcache_dir_load('%s') rc = %d\n", fs_path, rc );
+      }
+      
+      return rc;
+   }
+   
+   if( (int64_t)num_ents > num_children ) {
+      
+      // children were removed
+      rc = -ESTALE;
+      goto UG_consistency_dir_restore_out;
+   }
+   
+   try {
+      for( size_t i = 0; i < num_ents; i++ ) {
+         cached_ids.insert( ents[i].file_id );
+      }
+   }
+   catch( bad_alloc& ba ) {
+      
+      rc = -ENOMEM;
+      goto UG_consistency_dir_restore_out;
+   }
+   
+   // get the children created since we cached the listing
+   rc = ms_client_diffdir( ms, file_id, num_children - num_ents, max_generation + 1, &results );
+   if( rc != 0 || results.reply_error != 0 ) {
+      
+      SG_error("ms_client_diffdir('%s', %" PRId64 ") rc = %d, reply_error = %d\n", fs_path, max_generation + 1, rc, results.reply_error );
+      
+      if( rc == 0 ) {
+         rc = -EREMOTEIO;
+      }
+      
+      goto UG_consistency_dir_restore_out;
+   }
+   
+   for( size_t i = 0; i < results.num_ents; i++ ) {
+      
+      if( cached_ids.count( results.ents[i].file_id ) == 0 ) {
+         num_new++;
+      }
+      
+      max_new_generation = MAX( max_new_generation, results.ents[i].generation );
+   }
+   
+   if( results.num_ents > 0 && (int64_t)(num_ents + num_new) == num_children ) {
+      
+      // diffdir stops once it has as many children as we asked for, so make sure there are no more
+      rc = ms_client_diffdir( ms, file_id, 0, max_new_generation + 1, &probe );
+      if( rc != 0 || probe.reply_error != 0 ) {
+         
+         SG_error("ms_client_diffdir('%s', %" PRId64 ") rc = %d, reply_error = %d\n", fs_path, max_new_generation + 1, rc, probe.reply_error );
+         
+         if( rc == 0 ) {
+            rc = -EREMOTEIO;
+         }
+         
+         goto UG_consistency_dir_restore_out;
+      }
+      
+      num_new += probe.num_ents;
+   }
+   
+   if( (int64_t)(num_ents + num_new) != num_children ) {
+      
+      // children were removed, or moved away
+      SG_debug("'%s': %zu cached + %zu new children, but the MS has %" PRId64 "\n", fs_path, num_ents, num_new, num_children );
+      rc = -ESTALE;
+      goto UG_consistency_dir_restore_out;
+   }
+   
+   fskit_entry_wlock( dent );
+   
+   // restore the cached children we don't already have.
+   // the ones we have are at least as fresh as the cache, so don't let UG_consistency_dir_merge reload them.
+   for( size_t i = 0; i < num_ents; i++ ) {
+      
+      if( ents[i].name != NULL && fskit_dir_find_by_name( dent, ents[i].name ) != NULL ) {
+         
+         SG_safe_free( ents[i].name );
+      }
+   }
+   
+   rc = UG_consistency_dir_merge( gateway, fs_path, dent, ents, num_ents, now );
+   if( rc == 0 ) {
+      
+      for( size_t i = 0; i < num_ents; i++ ) {
+         
+         if( ents[i].name == NULL ) {
+            continue;
+         }
+         
+         struct fskit_entry* child = fskit_dir_find_by_name( dent, ents[i].name );
+         if( child == NULL ) {
+            continue;
+         }
+         
+         fskit_entry_wlock( child );
+         UG_inode_set_read_stale( (struct UG_inode*)fskit_entry_get_user_data( child ), true );
+         fskit_entry_unlock( child );
+      }
+      
+      // merge in the new children 
+      rc = UG_consistency_dir_merge( gateway, fs_path, dent, results.ents, results.num_ents, now );
+   }
+   
+   if( rc == 0 ) {
+      
+      UG_inode_set_children_refresh_time_now( (struct UG_inode*)fskit_entry_get_user_data( dent ) );
+      
+      // remember the new children too, once we've released the directory (not fatal if this fails; we'll just list the directory next time)
+      UG_mdcache_dir_serialize( gateway, file_id, results.ents, results.num_ents, true, &mdcache_update );
+      
+      SG_debug("'%s': restored %zu cached children, fetched %zu new ones\n", fs_path, num_ents, results.num_ents );
+   }
+   else {
+      
+      SG_error("UG_consistency_dir_merge('%s') rc = %d\n", fs_path, rc );
+   }
+   
+   fskit_entry_unlock( dent );
+   
+   UG_mdcache_update_write( gateway, &mdcache_update );
+   
+UG_consistency_dir_restore_out:
+   
+   for( size_t i = 0; i < num_ents; i++ ) {
+      md_entry_free( &ents[i] );
+   }
+   
+   SG_safe_free( ents );
+   
+   ms_client_multi_result_free( &results );
+   ms_client_multi_result_free( &probe );
+   UG_mdcache_update_free( &mdcache_update );
+   
+   return rc;
+}
+
+
 // ensure that a directory has a fresh listing of children
 // if not, fetch the immediate children the named directory, and attach them all
 // return 0 on success
@@ -1884,11 +2084,14 @@ int UG_consistency_dir_ensure_fresh( struct SG_gateway* gateway, char const* fs_
    struct timespec children_refresh_time;
    
    struct ms_client_multi_result results;
+   struct UG_mdcache_update mdcache_update;
    
    char const* method = NULL;
    
    struct ms_client* ms = SG_gateway_ms( gateway );
    
+   memset( &mdcache_update, 0, sizeof(struct UG_mdcache_update) );
+   
    struct fskit_entry* dent = fskit_entry_resolve_path( fs, fs_path, 0, 0, true, &rc );
    if( dent == NULL ) {
       
@@ -1931,6 +2134,27 @@ int UG_consistency_dir_ensure_fresh( struct SG_gateway* gateway, char const* fs_
    fskit_entry_ref_entry( dent );
    
    fskit_entry_unlock( dent );
+   
+   // first listing since we started, and we know the MS's current child count?
+   // try to pick up where the metadata cache left off, instead of listing everything again.
+   if( children_refresh_time.tv_sec == 0 && children_refresh_time.tv_nsec == 0 && md_timespec_diff_ms( &now, &dir_refresh_time ) <= max_read_freshness ) {
+      
+      rc = UG_consistency_dir_restore( gateway, fs_path, dent, file_id, num_children, &now );
+      if( rc == 0 ) {
+         
+         fskit_entry_unref( fs, fs_path, dent );
+         return 0;
+      }
+      
+      if( rc != -ENOENT && rc != -ESTALE ) {
+         
+         SG_warn("UG_consistency_dir_restore('%s') rc = %d; listing instead\n", fs_path, rc );
+      }
+      
+      // list everything
+      least_unknown_generation = 0;
+      rc = 0;
+   }
 
    // have we listed before?
    if( least_unknown_generation <= 1 ) {
@@ -1975,10 +2199,16 @@ int UG_consistency_dir_ensure_fresh( struct SG_gateway* gateway, char const* fs_
       
       // set refresh time 
       UG_inode_set_children_refresh_time_now( inode );
+      
+      // remember the listing for next time, once we've released the directory (not fatal if this fails)
+      UG_mdcache_dir_serialize( gateway, file_id, results.ents, results.num_ents, (least_unknown_generation > 1), &mdcache_update );
    }
    
    fskit_entry_unlock( dent );
    
+   UG_mdcache_update_write( gateway, &mdcache_update );
+   UG_mdcache_update_free( &mdcache_update );
+   
    ms_client_multi_result_free( &results );
    
    if( rc != 0 ) {
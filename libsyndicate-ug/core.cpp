@@ -19,6 +19,9 @@
 #include "impl.h"
 #include "fs.h"
 #include "vacuumer.h"
+#include "sync.h"
+
+#include <algorithm>
 
 #define UG_DRIVER_NUM_ROLES  3
 char const* UG_DRIVER_ROLES[ UG_DRIVER_NUM_ROLES ] = {
@@ -39,6 +42,10 @@ struct UG_state {
    
    struct UG_vacuumer* vacuumer;        // vacuumer instance 
    
+   struct UG_sync_committer* sync_committer;    // fsync group committer (NULL if disabled)
+   
+   UG_gateway_read_stats_map_t* read_stats;     // per-gateway block download latency and error rates (guarded by lock)
+   
    pthread_rwlock_t lock;               // lock governing access to this structure
   
    // fskit route handles
@@ -137,6 +144,110 @@ int UG_state_reload_replica_gateway_ids( struct UG_state* state ) {
 }
 
 
+// record the outcome of a block download from a gateway.
+// latency_ns is ignored if the download failed.
+// return 0 on success
+// return -ENOMEM on OOM
+int UG_state_read_stats_update( struct UG_state* state, uint64_t gateway_id, int64_t latency_ns, bool failed ) {
+   
+   struct UG_gateway_read_stats* stats = NULL;
+   
+   UG_state_wlock( state );
+   
+   if( state->read_stats == NULL ) {
+      
+      state->read_stats = SG_safe_new( UG_gateway_read_stats_map_t() );
+      if( state->read_stats == NULL ) {
+         
+         UG_state_unlock( state );
+         return -ENOMEM;
+      }
+   }
+   
+   try {
+      
+      stats = &(*state->read_stats)[ gateway_id ];
+   }
+   catch( bad_alloc& ba ) {
+      
+      UG_state_unlock( state );
+      return -ENOMEM;
+   }
+   
+   if( failed ) {
+      
+      stats->error_rate += UG_READ_STATS_EWMA_ALPHA * (1.0 - stats->error_rate);
+      stats->num_failures++;
+   }
+   else {
+      
+      stats->error_rate -= UG_READ_STATS_EWMA_ALPHA * stats->error_rate;
+      
+      if( stats->num_successes == 0 ) {
+         stats->latency_ns = latency_ns;
+      }
+      else {
+         stats->latency_ns += (int64_t)(UG_READ_STATS_EWMA_ALPHA * (latency_ns - stats->latency_ns));
+      }
+      
+      stats->samples[ stats->num_successes % UG_READ_STATS_NUM_SAMPLES ] = latency_ns;
+      stats->num_successes++;
+   }
+   
+   UG_state_unlock( state );
+   return 0;
+}
+
+
+// get a copy of a gateway's block download statistics
+// return 0 on success, and fill in *stats
+// return -ENOENT if we have not downloaded anything from this gateway yet
+int UG_state_read_stats_get( struct UG_state* state, uint64_t gateway_id, struct UG_gateway_read_stats* stats ) {
+   
+   int rc = -ENOENT;
+   
+   UG_state_rlock( state );
+   
+   if( state->read_stats != NULL ) {
+      
+      UG_gateway_read_stats_map_t::iterator itr = state->read_stats->find( gateway_id );
+      if( itr != state->read_stats->end() ) {
+         
+         *stats = itr->second;
+         rc = 0;
+      }
+   }
+   
+   UG_state_unlock( state );
+   return rc;
+}
+
+
+// get the given percentile (0 to 100) of a gateway's recent download latencies
+// return the latency in nanoseconds on success
+// return -1 if there are fewer than min_samples samples
+int64_t UG_gateway_read_stats_percentile( struct UG_gateway_read_stats* stats, int percentile, uint64_t min_samples ) {
+   
+   int64_t sorted[ UG_READ_STATS_NUM_SAMPLES ];
+   size_t num_samples = MIN( stats->num_successes, (uint64_t)UG_READ_STATS_NUM_SAMPLES );
+   size_t idx = 0;
+   
+   if( num_samples == 0 || stats->num_successes < min_samples ) {
+      return -1;
+   }
+   
+   memcpy( sorted, stats->samples, num_samples * sizeof(int64_t) );
+   std::sort( sorted, sorted + num_samples );
+   
+   idx = (num_samples * MAX( MIN( percentile, 100 ), 0 )) / 100;
+   if( idx >= num_samples ) {
+      idx = num_samples - 1;
+   }
+   
+   return sorted[ idx ];
+}
+
+
 // make an RG context 
 struct UG_RG_context* UG_RG_context_new() {
    return SG_CALLOC( struct UG_RG_context, 1 );
@@ -202,27 +313,68 @@ int UG_RG_context_set_status( struct UG_RG_context* rctx, int i, int status ) {
    return 0;
 }
 
-// send a request (controlplane/dataplane) to all RGs.
-// individual RG statuses will be recorded in rctx.
+// how many RGs have acknowledged the last request sent with this context?
+size_t UG_RG_context_num_succeeded( struct UG_RG_context* rctx ) {
+   
+   size_t num_succeeded = 0;
+   
+   for( size_t i = 0; i < rctx->num_rgs; i++ ) {
+      
+      if( rctx->rg_status[i] == UG_RG_REQUEST_SUCCESS ) {
+         num_succeeded++;
+      }
+   }
+   
+   return num_succeeded;
+}
+
+// send a batch of requests (controlplane/dataplane) to all RGs over a single download loop, so that the requests run concurrently
+// and the ones to the same RG can share its pooled connections.
+// the kth request is controlplane_requests[k] and dataplane_requests[k] (which may be NULL), sent to the RGs in rctxs[k].
+// each dataplane (if given) is streamed to each RG from the same source.
+// individual RG statuses will be recorded in each rctxs[k], and rcs[k] will be 0 if the kth request succeeded on every RG, or -EIO if not.
+// a request failing on one RG does not stop the others.
+// if quorum_cb is given, it is called (from this thread) as soon as the kth request has succeeded on quorum RGs (or on every RG, if quorum is 0 or exceeds the
+// number of RGs).  The remaining sends keep going in the downloader while it runs, so it can overlap follow-on work (like the MS update) with them.
 // return 0 if all requests succeeded
-// return -EPERM if at least one request failed.
-int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_messages::Request* controlplane_request, struct SG_chunk* dataplane_request ) {
+// return -EIO if at least one request failed.
+// return -ENOMEM on OOM
+int UG_RG_send_all_multi_ex( struct SG_gateway* gateway, struct UG_RG_context** rctxs, SG_messages::Request** controlplane_requests, struct SG_client_stream** dataplane_requests, size_t num_requests,
+                             size_t quorum, UG_RG_quorum_func_t quorum_cb, void* quorum_cls, int* rcs ) {
 
    int rc = 0;
+   int worst_rc = 0;
    size_t i = 0;
+   size_t k = 0;
+   size_t num_sends = 0;
    struct md_download_loop* dlloop = NULL;
    struct md_download_context* dlctx = NULL;
    int num_started = 0;
    int num_finished = 0;
+   bool loop_full = false;
    SG_messages::Reply reply;
-   map< struct md_download_context*, int > download_idxs;
+   map< struct md_download_context*, pair<size_t, size_t> > download_idxs;
+
+   for( k = 0; k < num_requests; k++ ) {
+      
+      rcs[k] = 0;
+      num_sends += rctxs[k]->num_rgs;
+      
+      for( i = 0; i < rctxs[k]->num_rgs; i++ ) {
+         rctxs[k]->rg_status[i] = UG_RG_REQUEST_NOT_STARTED;
+      }
+   }
+   
+   if( num_sends == 0 ) {
+      return 0;
+   }
 
    dlloop = md_download_loop_new();
    if( dlloop == NULL ) {
       return -ENOMEM;
    }
 
-   rc = md_download_loop_init( dlloop, SG_gateway_dl( gateway ), rctx->num_rgs );
+   rc = md_download_loop_init( dlloop, SG_gateway_dl( gateway ), num_sends );
    if( rc != 0 ) {
 
       SG_error("md_download_loop_init rc = %d\n", rc );
@@ -230,54 +382,58 @@ int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_m
       return rc;
    }
 
-   for( i = 0; i < rctx->num_rgs; i++ ) {
-      rctx->rg_status[i] = UG_RG_REQUEST_NOT_STARTED;
-   }
-
-   SG_debug("Send to %zu RGs\n", rctx->num_rgs );
+   SG_debug("Send %zu request(s) to RGs (%zu sends)\n", num_requests, num_sends );
 
    // try to send to each RG 
    do {
  
-       // start sending to the next UG_RG_REQUEST_NOT_STARTED-tagged RG 
-       for( i = 0; i < rctx->num_rgs; i++ ) {
-
-           if( rctx->rg_status[i] == UG_RG_REQUEST_NOT_STARTED ) {
+       // start sending each UG_RG_REQUEST_NOT_STARTED-tagged request, as long as the loop has room
+       loop_full = false;
+       for( k = 0; k < num_requests && rc == 0 && !loop_full; k++ ) {
+          for( i = 0; i < rctxs[k]->num_rgs; i++ ) {
+
+              if( rctxs[k]->rg_status[i] != UG_RG_REQUEST_NOT_STARTED ) {
+                 continue;
+              }
               
-               rc = md_download_loop_next( dlloop, &dlctx );
-               if( rc == 0 ) { 
-
-                  SG_debug("RG request %" PRIu64 ": %p\n", rctx->rg_ids[i], dlctx );
-               
-                  try {
-                     download_idxs[dlctx] = i;
-                  }
-                  catch( bad_alloc& ba ) {
-                     rc = -ENOMEM;
-                     break;
-                  }
-
-                  rc = SG_client_request_send_async( gateway, rctx->rg_ids[i], controlplane_request, dataplane_request, dlloop, dlctx );
-                  if( rc != 0 ) {
-
-                     SG_error("SG_client_request_send_async(to %" PRIu64 ") rc = %d\n", rctx->rg_ids[i], rc );
-                     break;
-                  }
-
-                  rctx->rg_status[i] = UG_RG_REQUEST_IN_PROGRESS;
-                  num_started++;
-                  break;
-               }
-               else if( rc == -EAGAIN ) {
-                  rc = 0;
-                  break;
-               }
-               else {
-                  // fatal error 
-                  SG_error("md_download_loop_next(%p) rc = %d\n", dlloop, rc );
-                  break;
-               }
-           }
+              rc = md_download_loop_next( dlloop, &dlctx );
+              if( rc == -EAGAIN ) {
+                 
+                 rc = 0;
+                 loop_full = true;
+                 break;
+              }
+              else if( rc != 0 ) {
+                 
+                 // fatal error 
+                 SG_error("md_download_loop_next(%p) rc = %d\n", dlloop, rc );
+                 break;
+              }
+
+              SG_debug("RG request %" PRIu64 ": %p\n", rctxs[k]->rg_ids[i], dlctx );
+           
+              try {
+                 download_idxs[dlctx] = make_pair( k, i );
+              }
+              catch( bad_alloc& ba ) {
+                 rc = -ENOMEM;
+                 break;
+              }
+
+              rc = SG_client_request_send_stream_async( gateway, rctxs[k]->rg_ids[i], controlplane_requests[k], dataplane_requests[k], dlloop, dlctx );
+              if( rc != 0 ) {
+
+                 SG_error("SG_client_request_send_stream_async(to %" PRIu64 ") rc = %d\n", rctxs[k]->rg_ids[i], rc );
+                 break;
+              }
+
+              rctxs[k]->rg_status[i] = UG_RG_REQUEST_IN_PROGRESS;
+              num_started++;
+          }
+       }
+       
+       if( rc != 0 ) {
+          break;
        }
 
        // run until at least one finishes 
@@ -293,53 +449,59 @@ int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_m
 
            // next finished
            rc = md_download_loop_finished( dlloop, &dlctx );
-           if( rc == 0 ) {
-
-             // one finished
-             rc = SG_client_request_send_finish( gateway, dlctx, &reply );
-             if( rc != 0 ) {
-         
-                 SG_error("SG_client_request_send_finish rc = %d\n", rc );
-                 break;
-             }
-
-             num_finished++;
+           if( rc == -EAGAIN ) {
 
-             auto itr = download_idxs.find( dlctx );
-             if( itr == download_idxs.end() ) {
-
-                SG_error("BUG: no download context %p\n", dlctx );
-                exit(1);
-             }
+              // all finished 
+              rc = 0;
+              break;
+           }
+           else if( rc != 0 ) {
 
-             i = itr->second;
+              // error 
+              SG_error("md_download_loop_finished rc = %d\n", rc );
+              break;
+           }
 
-             // did the request succeed?
-             if( reply.error_code() != 0 ) {
+           auto itr = download_idxs.find( dlctx );
+           if( itr == download_idxs.end() ) {
 
-                SG_error("RG request %p failed: %d\n", dlctx, reply.error_code());
-                rc = reply.error_code();
+              SG_error("BUG: no download context %p\n", dlctx );
+              exit(1);
+           }
 
-                rctx->rg_status[i] = -abs(rc);
-                break;
-             }
-             else {
+           k = itr->second.first;
+           i = itr->second.second;
+           download_idxs.erase( itr );
 
-                rctx->rg_status[i] = UG_RG_REQUEST_SUCCESS;
-             }
+           // one finished
+           num_finished++;
+           rc = SG_client_request_send_finish( gateway, dlctx, &reply );
+           if( rc != 0 ) {
+       
+              SG_error("SG_client_request_send_finish(to %" PRIu64 ") rc = %d\n", rctxs[k]->rg_ids[i], rc );
+              rctxs[k]->rg_status[i] = -abs(rc);
+              rcs[k] = -EIO;
+              rc = 0;
+              continue;
            }
-        
-           else if( rc == -EAGAIN ) {
 
-              // all finished 
-              rc = 0;
-              break;
+           // did the request succeed?
+           if( reply.error_code() != 0 ) {
+
+              SG_error("RG request %p (to %" PRIu64 ") failed: %d\n", dlctx, rctxs[k]->rg_ids[i], reply.error_code());
+              rctxs[k]->rg_status[i] = -abs(reply.error_code());
+              rcs[k] = -EIO;
            }
            else {
 
-              // error 
-              SG_error("md_download_loop_finished rc = %d\n", rc );
-              break;
+              rctxs[k]->rg_status[i] = UG_RG_REQUEST_SUCCESS;
+              
+              // just reached a quorum?
+              if( quorum_cb != NULL && UG_RG_context_num_succeeded( rctxs[k] ) == ( quorum == 0 || quorum > rctxs[k]->num_rgs ? rctxs[k]->num_rgs : quorum ) ) {
+                 
+                 SG_debug("Request %zu has a write quorum of %zu RGs\n", k, UG_RG_context_num_succeeded( rctxs[k] ) );
+                 (*quorum_cb)( rctxs[k], k, quorum_cls );
+              }
            }
        }
 
@@ -349,23 +511,62 @@ int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_m
 
        SG_debug("%d started, %d finished\n", num_started, num_finished );
 
-   } while( md_download_loop_running( dlloop ) || (unsigned)num_finished < rctx->num_rgs );
+   } while( md_download_loop_running( dlloop ) || (unsigned)num_finished < num_sends );
 
    if( rc != 0 ) {
       
-      // request failed failed. terminate.
+      // can't go on.  terminate.
       SG_error("Terminating RG requests, rc = %d\n", rc );
       md_download_loop_abort( dlloop );
 
-      rc = -EIO;
+      // everything that didn't finish failed 
+      for( k = 0; k < num_requests; k++ ) {
+         for( i = 0; i < rctxs[k]->num_rgs; i++ ) {
+            
+            if( rctxs[k]->rg_status[i] != UG_RG_REQUEST_SUCCESS ) {
+               rcs[k] = -EIO;
+            }
+         }
+      }
+   }
+   
+   for( k = 0; k < num_requests; k++ ) {
+      
+      if( rcs[k] != 0 ) {
+         worst_rc = -EIO;
+      }
+   }
+   
+   if( rc == -ENOMEM ) {
+      worst_rc = -ENOMEM;
    }
 
-   md_download_loop_cleanup( dlloop, NULL, NULL );
+   md_download_loop_cleanup( dlloop, md_curl_pool_release_func, SG_gateway_curl_pool( gateway ) );
    md_download_loop_free( dlloop );
    SG_safe_free( dlloop );
 
-   return rc;
+   return worst_rc;
+}
 
+
+// send a batch of requests (controlplane/dataplane) to all RGs over a single download loop.
+// see UG_RG_send_all_multi_ex
+int UG_RG_send_all_multi( struct SG_gateway* gateway, struct UG_RG_context** rctxs, SG_messages::Request** controlplane_requests, struct SG_client_stream** dataplane_requests, size_t num_requests, int* rcs ) {
+   
+   return UG_RG_send_all_multi_ex( gateway, rctxs, controlplane_requests, dataplane_requests, num_requests, 0, NULL, NULL, rcs );
+}
+
+
+// send a request (controlplane/dataplane) to all RGs.
+// the dataplane (if given) is streamed to each RG from the same source.
+// individual RG statuses will be recorded in rctx.
+// return 0 if all requests succeeded
+// return -EIO if at least one request failed.
+// return -ENOMEM on OOM
+int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_messages::Request* controlplane_request, struct SG_client_stream* dataplane_request ) {
+   
+   int send_rc = 0;
+   return UG_RG_send_all_multi( gateway, &rctx, &controlplane_request, &dataplane_request, 1, &send_rc );
 }
 
 
@@ -667,6 +868,34 @@ struct UG_state* UG_init_ex( int argc, char** argv, struct md_opts* overrides, v
       UG_shutdown( state );
       return NULL;
    }
+   
+   // set up fsync group commit, if enabled
+   if( conf->fsync_group_commit_window > 0 ) {
+      
+      SG_debug("Starting fsync group committer (window %" PRId64 " ms)\n", conf->fsync_group_commit_window );
+      
+      state->sync_committer = UG_sync_committer_new();
+      if( state->sync_committer == NULL ) {
+         
+         UG_shutdown( state );
+         return NULL;
+      }
+      
+      rc = UG_sync_committer_init( state->sync_committer, state->gateway, conf->fsync_group_commit_window );
+      if( rc != 0 ) {
+         
+         SG_safe_free( state->sync_committer );
+         UG_shutdown( state );
+         return NULL;
+      }
+      
+      rc = UG_sync_committer_start( state->sync_committer );
+      if( rc != 0 ) {
+         
+         UG_shutdown( state );
+         return NULL;
+      }
+   }
   
    SG_debug("%s", "Starting deferred workqueue\n");
    
@@ -760,12 +989,30 @@ int UG_shutdown( struct UG_state* state ) {
       UG_fs_uninstall_methods( state->fs );
    }
    
+   // commit outstanding fsyncs 
+   if( state->sync_committer != NULL ) {
+      
+      SG_debug("%s", "Shut down fsync group commit\n");
+      UG_sync_committer_stop( state->sync_committer );
+      UG_sync_committer_shutdown( state->sync_committer );
+      SG_safe_free( state->sync_committer );
+   }
+   
+   // where did fsync time go?
+   UG_replica_stats_log();
+   
    // stop the vacuumer
    if( state->vacuumer != NULL ) {
    
+       struct UG_vacuumer_stats vstats;
+       
        SG_debug("%s", "Quiesce vacuuming\n");
        UG_vacuumer_quiesce( state->vacuumer );
        UG_vacuumer_wait_all( state->vacuumer ); 
+       
+       UG_vacuumer_get_stats( state->vacuumer, &vstats );
+       SG_debug("Vacuumed: %" PRIu64 " batches, %" PRIu64 " DELETECHUNKS, %" PRIu64 " vacuum log entries cleared, %" PRIu64 " left (%" PRIu64 " bytes)\n",
+                vstats.batches, vstats.deletechunks, vstats.log_removals, vstats.backlog, vstats.bytes_pending );
       
        SG_debug("%s", "Shut down vacuuming\n");
        UG_vacuumer_stop( state->vacuumer );
@@ -820,6 +1067,7 @@ int UG_shutdown( struct UG_state* state ) {
    }
    
    SG_safe_free( state->replica_gateway_ids );
+   SG_safe_delete( state->read_stats );
    
    pthread_rwlock_destroy( &state->lock );
    
@@ -848,6 +1096,11 @@ struct UG_vacuumer* UG_state_vacuumer( struct UG_state* state ) {
    return state->vacuumer;
 }
 
+// get a pointer to the fsync group committer (NULL if group commit is disabled)
+struct UG_sync_committer* UG_state_sync_committer( struct UG_state* state ) {
+   return state->sync_committer;
+}
+
 // get the owner ID of the gateway 
 uint64_t UG_state_owner_id( struct UG_state* state ) {
    return SG_gateway_user_id( UG_state_gateway( state ) );
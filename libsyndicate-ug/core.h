@@ -32,8 +32,27 @@
 #define UG_RG_REQUEST_IN_PROGRESS     1
 #define UG_RG_REQUEST_SUCCESS         2
 
+// number of recent block download latencies remembered per gateway
+#define UG_READ_STATS_NUM_SAMPLES     64
+
+// weight of a new observation in a gateway's moving averages
+#define UG_READ_STATS_EWMA_ALPHA      0.125
+
+// per-gateway block download statistics, used to decide where to read blocks from
+struct UG_gateway_read_stats {
+   
+   int64_t latency_ns;                                  // moving average of successful download latency
+   double error_rate;                                   // moving average of the failure rate (0.0 to 1.0)
+   uint64_t num_successes;                              // number of successful downloads
+   uint64_t num_failures;                               // number of failed downloads
+   int64_t samples[ UG_READ_STATS_NUM_SAMPLES ];        // latencies of the most recent successful downloads (ring buffer)
+};
+
+typedef map< uint64_t, struct UG_gateway_read_stats > UG_gateway_read_stats_map_t;
+
 // prototypes...
 struct UG_vacuumer;
+struct UG_sync_committer;
 
 // global UG state
 struct UG_state;
@@ -41,11 +60,18 @@ struct UG_state;
 // RG RPC state (for replication and vacuuming)
 struct UG_RG_context;
 
+// called once a request has been acknowledged by a write quorum of RGs (see UG_RG_send_all_multi_ex)
+typedef int (*UG_RG_quorum_func_t)( struct UG_RG_context* rctx, size_t request_idx, void* cls );
+
 extern "C" {
    
 int UG_state_list_replica_gateway_ids( struct UG_state* state, uint64_t** replica_gateway_ids, size_t* num_replica_gateway_ids );
 int UG_state_reload_replica_gateway_ids( struct UG_state* state );
 
+int UG_state_read_stats_update( struct UG_state* state, uint64_t gateway_id, int64_t latency_ns, bool failed );
+int UG_state_read_stats_get( struct UG_state* state, uint64_t gateway_id, struct UG_gateway_read_stats* stats );
+int64_t UG_gateway_read_stats_percentile( struct UG_gateway_read_stats* stats, int percentile, uint64_t min_samples );
+
 struct UG_RG_context* UG_RG_context_new();
 int UG_RG_context_init( struct UG_state* state, struct UG_RG_context* rctx );
 int UG_RG_context_free( struct UG_RG_context* rctx );
@@ -53,7 +79,11 @@ uint64_t* UG_RG_context_RG_ids( struct UG_RG_context* rctx );
 size_t UG_RG_context_num_RGs( struct UG_RG_context* rctx );
 int UG_RG_context_get_status( struct UG_RG_context* rctx, int i );
 int UG_RG_context_set_status( struct UG_RG_context* rctx, int i, int status );
-int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_messages::Request* controlplane_request, struct SG_chunk* dataplane_request );
+int UG_RG_send_all( struct SG_gateway* gateway, struct UG_RG_context* rctx, SG_messages::Request* controlplane_request, struct SG_client_stream* dataplane_request );
+int UG_RG_send_all_multi( struct SG_gateway* gateway, struct UG_RG_context** rctxs, SG_messages::Request** controlplane_requests, struct SG_client_stream** dataplane_requests, size_t num_requests, int* rcs );
+int UG_RG_send_all_multi_ex( struct SG_gateway* gateway, struct UG_RG_context** rctxs, SG_messages::Request** controlplane_requests, struct SG_client_stream** dataplane_requests, size_t num_requests,
+                             size_t quorum, UG_RG_quorum_func_t quorum_cb, void* quorum_cls, int* rcs );
+size_t UG_RG_context_num_succeeded( struct UG_RG_context* rctx );
 
 int UG_state_rlock( struct UG_state* state );
 int UG_state_wlock( struct UG_state* state );
@@ -70,6 +100,7 @@ int UG_shutdown( struct UG_state* state );
 struct SG_gateway* UG_state_gateway( struct UG_state* state );
 struct fskit_core* UG_state_fs( struct UG_state* state );
 struct UG_vacuumer* UG_state_vacuumer( struct UG_state* state );
+struct UG_sync_committer* UG_state_sync_committer( struct UG_state* state );
 uint64_t UG_state_owner_id( struct UG_state* state );
 uint64_t UG_state_volume_id( struct UG_state* state );
 struct md_wq* UG_state_wq( struct UG_state* state );
@@ -23,6 +23,7 @@
 #include "inode.h"
 #include "sync.h"
 #include "vacuumer.h"
+#include "mdcache.h"
 
 // export an fskit_entry to an md_entry, i.e. to create it on the MS.  Use the given gateway to get the coordinator, volume, and read/write freshness values.
 // only set fields in dest that can be filled in from src
@@ -946,6 +947,9 @@ static int UG_fs_detach_and_destroy( struct fskit_core* fs, struct fskit_route_m
    if( rc == 0 ) {
       
       // success!
+      // forget its cached listing or manifest (not fatal if this fails)
+      UG_mdcache_remove( gateway, file_id );
+      
       UG_inode_free( inode );
       SG_safe_free( inode );
    }
@@ -16,6 +16,7 @@
 
 #include "inode.h"
 #include "block.h"
+#include "mdcache.h"
 
 // UG-specific inode information, for fskit
 struct UG_inode {
@@ -58,6 +59,12 @@ struct UG_inode {
    bool renaming;                       // if true, then this inode is in the process of getting renamed.  Concurrent renames will fail with EBUSY
    bool deleting;                       // if true, then this inode is in the process of being deleted.  Concurrent opens and stats will fail
    bool creating;                       // if true, then this inode is in the process of being created.  Truncate will be a no-op in this case.
+   
+   int64_t layout_version;              // incremented whenever the manifest changes by any means other than a local write (i.e. truncate, refresh, remote write)
+   
+   pthread_mutex_t block_range_lock;            // guards block_ranges
+   pthread_cond_t block_range_cond;             // signaled when a block range is released
+   UG_inode_block_range_map_t* block_ranges;    // block ranges locked by in-progress writes
 };
 
 // initialize common inode data 
@@ -96,7 +103,19 @@ static int UG_inode_init_common( struct UG_inode* inode, char const* name, int t
          SG_safe_delete( inode->sync_queue );
          return -ENOMEM;
       }
+      
+      // locked block ranges 
+      inode->block_ranges = SG_safe_new( UG_inode_block_range_map_t() );
+      if( inode->block_ranges == NULL ) {
+         
+         SG_safe_delete( inode->dirty_blocks );
+         SG_safe_delete( inode->sync_queue );
+         return -ENOMEM;
+      }
    }
+   
+   pthread_mutex_init( &inode->block_range_lock, NULL );
+   pthread_cond_init( &inode->block_range_cond, NULL );
 
    return 0;
 }
@@ -383,6 +402,10 @@ int UG_inode_free( struct UG_inode* inode ) {
        SG_safe_delete( inode->dirty_blocks );
    }
 
+   SG_safe_delete( inode->block_ranges );
+   pthread_mutex_destroy( &inode->block_range_lock );
+   pthread_cond_destroy( &inode->block_range_cond );
+
    SG_manifest_free( &inode->manifest );
    SG_manifest_free( &inode->replaced_blocks );
    memset( inode, 0, sizeof(struct UG_inode) );
@@ -407,9 +430,21 @@ int UG_file_handle_init( struct UG_file_handle* fh, struct UG_inode* inode, int
       return -ENOMEM;
    }
    
+   if( pthread_mutex_init( &fh->prefetch_lock, NULL ) != 0 ) {
+      
+      SG_safe_delete( fh->evicts );
+      return -ENOMEM;
+   }
+   
    fh->inode_ref = inode;
    fh->flags = flags;
    
+   fh->prefetch_next_offset = 0;
+   fh->prefetch_last_block = 0;
+   fh->prefetch_window = 0;
+   fh->prefetch_end = 0;
+   fh->prefetch_io_context = md_random64();
+   
    return 0;
 }
 
@@ -420,6 +455,7 @@ int UG_file_handle_init( struct UG_file_handle* fh, struct UG_inode* inode, int
 int UG_file_handle_free( struct UG_file_handle* fh ) {
    
    SG_safe_delete( fh->evicts );
+   pthread_mutex_destroy( &fh->prefetch_lock );
    
    memset( fh, 0, sizeof(struct UG_file_handle) );
    
@@ -1028,6 +1064,9 @@ int UG_inode_manifest_merge_blocks( struct SG_gateway* gateway, struct UG_inode*
          break;
       }
       
+      // writes in progress must re-read this block 
+      inode->layout_version++;
+      
       // clear cached block (idempotent)
       if( existing_block != NULL ) {
           md_cache_evict_block( cache, UG_inode_file_id( inode ), UG_inode_file_version( inode ), block_id, existing_block_version );
@@ -1416,6 +1455,7 @@ int UG_inode_manifest_replace( struct UG_inode* inode, struct SG_manifest* manif
    
    old_manifest = inode->manifest;
    inode->manifest = *manifest;
+   inode->layout_version++;
    
    SG_manifest_free( &old_manifest );
    
@@ -1423,6 +1463,89 @@ int UG_inode_manifest_replace( struct UG_inode* inode, struct SG_manifest* manif
 }
 
 
+// does a block range overlap one that is already locked?
+// NOTE: inode->block_range_lock must be held
+static bool UG_inode_block_range_conflicts( struct UG_inode* inode, uint64_t first_block_id, uint64_t last_block_id ) {
+   
+   for( UG_inode_block_range_map_t::iterator itr = inode->block_ranges->begin(); itr != inode->block_ranges->end(); itr++ ) {
+      
+      // ranges are sorted by first block
+      if( itr->first > last_block_id ) {
+         break;
+      }
+      
+      if( itr->second >= first_block_id ) {
+         return true;
+      }
+   }
+   
+   return false;
+}
+
+
+// lock a range of an inode's blocks (inclusive), waiting for any in-progress writes to overlapping blocks to release theirs.
+// this lets a writer drop inode->entry's lock while it fetches, merges, and flushes blocks, without racing other writers to the same blocks.
+// return 0 on success
+// return -EINVAL if the inode is not a regular file
+// return -ENOMEM on OOM 
+// NOTE: inode->entry must NOT be locked, since the holder of the range may need it to finish
+int UG_inode_block_range_lock( struct UG_inode* inode, uint64_t first_block_id, uint64_t last_block_id ) {
+   
+   int rc = 0;
+   
+   if( inode->block_ranges == NULL ) {
+      return -EINVAL;
+   }
+   
+   pthread_mutex_lock( &inode->block_range_lock );
+   
+   while( UG_inode_block_range_conflicts( inode, first_block_id, last_block_id ) ) {
+      pthread_cond_wait( &inode->block_range_cond, &inode->block_range_lock );
+   }
+   
+   try {
+      inode->block_ranges->insert( UG_inode_block_range_map_t::value_type( first_block_id, last_block_id ) );
+   }
+   catch( bad_alloc& ba ) {
+      rc = -ENOMEM;
+   }
+   
+   pthread_mutex_unlock( &inode->block_range_lock );
+   
+   return rc;
+}
+
+
+// release a range of blocks locked with UG_inode_block_range_lock, and wake up any writers waiting on it
+// return 0 on success
+// return -ENOENT if the range is not locked
+int UG_inode_block_range_unlock( struct UG_inode* inode, uint64_t first_block_id, uint64_t last_block_id ) {
+   
+   int rc = -ENOENT;
+   
+   if( inode->block_ranges == NULL ) {
+      return -ENOENT;
+   }
+   
+   pthread_mutex_lock( &inode->block_range_lock );
+   
+   for( UG_inode_block_range_map_t::iterator itr = inode->block_ranges->lower_bound( first_block_id ); itr != inode->block_ranges->end() && itr->first == first_block_id; itr++ ) {
+      
+      if( itr->second == last_block_id ) {
+         
+         inode->block_ranges->erase( itr );
+         rc = 0;
+         break;
+      }
+   }
+   
+   pthread_cond_broadcast( &inode->block_range_cond );
+   pthread_mutex_unlock( &inode->block_range_lock );
+   
+   return rc;
+}
+
+
 // find all blocks in the inode that would be removed by a truncation
 // return 0 on success, and populate *removed 
 // return -ENOMEM on OOM 
@@ -1491,6 +1614,9 @@ int UG_inode_truncate( struct SG_gateway* gateway, struct UG_inode* inode, off_t
    int64_t old_version = UG_inode_file_version( inode );
    struct md_syndicate_cache* cache = SG_gateway_cache( gateway );
    
+   // writes in progress must start over 
+   inode->layout_version++;
+   
    // go through the manifest and drop locally-cached blocks
    for( uint64_t dead_block_id = drop_block_id; dead_block_id <= max_block_id; dead_block_id++ ) {
       
@@ -1522,6 +1648,7 @@ int UG_inode_truncate( struct SG_gateway* gateway, struct UG_inode* inode, off_t
       
       // reversion 
       md_cache_reversion_file( cache, UG_inode_file_id( inode ), old_version, new_version );
+      UG_mdcache_manifest_remove( gateway, UG_inode_file_id( inode ) );
    }
   
    // drop extra manifest blocks 
@@ -1537,6 +1664,9 @@ int UG_inode_truncate( struct SG_gateway* gateway, struct UG_inode* inode, off_t
    if( write_nonce != 0 ) {
        UG_inode_set_write_nonce( inode, write_nonce );
    }
+   
+   // don't serve the old signed manifest
+   SG_server_manifest_cache_invalidate( gateway, UG_inode_file_id( inode ) );
 
    return 0;
 }
@@ -1760,6 +1890,10 @@ int64_t UG_inode_generation( struct UG_inode* inode ) {
    return inode->generation;
 }
 
+int64_t UG_inode_layout_version( struct UG_inode* inode ) {
+   return inode->layout_version;
+}
+
 struct timespec UG_inode_refresh_time( struct UG_inode* inode ) {
    return inode->refresh_time;
 }
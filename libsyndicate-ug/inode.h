@@ -19,6 +19,7 @@
 
 #include <libsyndicate/libsyndicate.h>
 #include <libsyndicate/gateway.h>
+#include <libsyndicate/server.h>
 #include <libsyndicate/manifest.h>
 #include <libsyndicate/util.h>
 #include <libsyndicate/ms/ms-client.h>
@@ -36,6 +37,9 @@ typedef queue< struct UG_sync_context* > UG_inode_fsync_queue_t;
 // map block IDs to their versions, so we know which block to evict on close 
 typedef map< uint64_t, int64_t > UG_inode_block_eviction_map_t;
 
+// block ranges held by in-progress writes (first block ID --> last block ID)
+typedef multimap< uint64_t, uint64_t > UG_inode_block_range_map_t;
+
 // UG-specific inode information, for fskit
 struct UG_inode;
 
@@ -49,6 +53,14 @@ struct UG_file_handle {
    struct fskit_file_handle* handle_ref;        // refernece to the parent fskit file handle 
    
    UG_inode_block_eviction_map_t* evicts;       // non-dirty blocks to evict on close 
+   
+   // sequential read-ahead state (see UG_read_prefetch_plan)
+   pthread_mutex_t prefetch_lock;
+   uint64_t prefetch_next_offset;       // where the next read starts, if the reader is sequential
+   uint64_t prefetch_last_block;        // last block the reader has touched 
+   uint64_t prefetch_window;            // number of blocks to read ahead (0 if the reader is not sequential)
+   uint64_t prefetch_end;               // ID of the block after the last one we've asked to prefetch
+   uint64_t prefetch_io_context;        // identifies this handle's prefetches to the driver
 };
 
 
@@ -106,6 +118,10 @@ int UG_file_handle_evict_blocks( struct UG_file_handle* fh );
 // manifest 
 int UG_inode_manifest_replace( struct UG_inode* inode, struct SG_manifest* manifest );
 
+// block range locks 
+int UG_inode_block_range_lock( struct UG_inode* inode, uint64_t first_block_id, uint64_t last_block_id );
+int UG_inode_block_range_unlock( struct UG_inode* inode, uint64_t first_block_id, uint64_t last_block_id );
+
 // truncate 
 int UG_inode_truncate_find_removed( struct SG_gateway* gateway, struct UG_inode* inode, off_t new_size, struct SG_manifest* removed );
 int UG_inode_truncate( struct SG_gateway* gateway, struct UG_inode* inode, off_t new_size, int64_t new_version, int64_t write_nonce, struct timespec* new_manifest_timestamp );
@@ -145,6 +161,7 @@ int64_t UG_inode_ms_capacity( struct UG_inode* inode );
 uint32_t UG_inode_max_read_freshness( struct UG_inode* inode );
 uint32_t UG_inode_max_write_freshness( struct UG_inode* inode );
 int64_t UG_inode_generation( struct UG_inode* inode );
+int64_t UG_inode_layout_version( struct UG_inode* inode );
 struct timespec UG_inode_refresh_time( struct UG_inode* inode );
 struct timespec UG_inode_manifest_refresh_time( struct UG_inode* inode );
 struct timespec UG_inode_children_refresh_time( struct UG_inode* inode );
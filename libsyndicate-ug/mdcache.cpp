@@ -0,0 +1,776 @@
+/*
+   Copyright 2015 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "mdcache.h"
+
+#include <libsyndicate/storage.h>
+
+// number of cache writes so far, for deciding when to check the size cap
+static uint64_t UG_mdcache_num_writes = 0;
+
+// a cache file we might trim
+struct UG_mdcache_trim_entry {
+
+   struct timespec mtime;
+   off_t size;
+   string name;
+};
+
+typedef vector<struct UG_mdcache_trim_entry> UG_mdcache_trim_list_t;
+
+// path to a metadata cache file: <data_root>/<volume>/metadata/<subdir>/<ID><suffix>
+// return a malloc'ed path on success
+// return NULL on OOM
+static char* UG_mdcache_path( struct SG_gateway* gateway, char const* subdir, uint64_t file_id, char const* suffix ) {
+
+   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+
+   char* path = SG_CALLOC( char, strlen(conf->data_root) + 1 + 25 + 1 + strlen(UG_MDCACHE_DIR) + 1 + strlen(subdir) + 1 + 25 + strlen(suffix) + 1 );
+   if( path == NULL ) {
+      return NULL;
+   }
+
+   sprintf( path, "%s/%" PRIu64 "/%s/%s/%" PRIX64 "%s", conf->data_root, conf->volume, UG_MDCACHE_DIR, subdir, file_id, suffix );
+   return path;
+}
+
+
+// path to a metadata cache subdirectory: <data_root>/<volume>/metadata/<subdir>
+// return a malloc'ed path on success
+// return NULL on OOM
+static char* UG_mdcache_subdir_path( struct SG_gateway* gateway, char const* subdir ) {
+
+   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+
+   char* path = SG_CALLOC( char, strlen(conf->data_root) + 1 + 25 + 1 + strlen(UG_MDCACHE_DIR) + 1 + strlen(subdir) + 1 );
+   if( path == NULL ) {
+      return NULL;
+   }
+
+   sprintf( path, "%s/%" PRIu64 "/%s/%s", conf->data_root, conf->volume, UG_MDCACHE_DIR, subdir );
+   return path;
+}
+
+
+// set up a header
+// always succeeds
+static void UG_mdcache_header_init( struct SG_gateway* gateway, struct UG_mdcache_header* hdr, uint32_t type, uint64_t file_id ) {
+
+   memset( hdr, 0, sizeof(struct UG_mdcache_header) );
+
+   hdr->magic = UG_MDCACHE_MAGIC;
+   hdr->version = UG_MDCACHE_VERSION;
+   hdr->type = type;
+   hdr->volume_id = SG_gateway_conf( gateway )->volume;
+   hdr->file_id = file_id;
+}
+
+
+// check a header we read back
+// return true if it's one of ours, of the right type, for the right file
+static bool UG_mdcache_header_valid( struct SG_gateway* gateway, struct UG_mdcache_header* hdr, uint32_t type, uint64_t file_id ) {
+
+   return hdr->magic == UG_MDCACHE_MAGIC && hdr->version == UG_MDCACHE_VERSION && hdr->type == type &&
+          hdr->volume_id == SG_gateway_conf( gateway )->volume && hdr->file_id == file_id;
+}
+
+
+// serialize directory entries as length-prefixed ms_entry records, and append them to buf
+// return 0 on success
+// return -ENOMEM on OOM
+static int UG_mdcache_dir_records_serialize( struct md_entry* ents, size_t num_ents, string* buf ) {
+
+   int rc = 0;
+
+   for( size_t i = 0; i < num_ents; i++ ) {
+
+      ms::ms_entry msent;
+      string msent_bits;
+      uint32_t len = 0;
+
+      rc = md_entry_to_ms_entry( &msent, &ents[i] );
+      if( rc != 0 ) {
+         return rc;
+      }
+
+      try {
+
+         msent.SerializeToString( &msent_bits );
+
+         len = msent_bits.size();
+         buf->append( (char*)&len, sizeof(uint32_t) );
+         buf->append( msent_bits );
+      }
+      catch( bad_alloc& ba ) {
+         return -ENOMEM;
+      }
+   }
+
+   return 0;
+}
+
+
+// write a metadata cache file, atomically replacing the old one
+// this is only a cache, so it is not fsync'ed; a torn file will fail the header or record checks on load.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int UG_mdcache_write( struct SG_gateway* gateway, char const* subdir, uint64_t file_id, struct UG_mdcache_header* hdr, char const* data, size_t len ) {
+
+   int rc = 0;
+   int fd = -1;
+   ssize_t nw = 0;
+   char* path = NULL;
+   char* tmp_path = NULL;
+   char* dir = NULL;
+
+   path = UG_mdcache_path( gateway, subdir, file_id, "" );
+   tmp_path = UG_mdcache_path( gateway, subdir, file_id, ".tmp" );
+
+   if( path == NULL || tmp_path == NULL ) {
+
+      rc = -ENOMEM;
+      goto UG_mdcache_write_out;
+   }
+
+   dir = md_dirname( path, NULL );
+   if( dir == NULL ) {
+
+      rc = -ENOMEM;
+      goto UG_mdcache_write_out;
+   }
+
+   rc = md_mkdirs3( dir, 0700 );
+   if( rc != 0 && rc != -EEXIST ) {
+
+      SG_error("md_mkdirs3('%s') rc = %d\n", dir, rc );
+      goto UG_mdcache_write_out;
+   }
+
+   rc = 0;
+
+   fd = open( tmp_path, O_CREAT | O_TRUNC | O_WRONLY, 0600 );
+   if( fd < 0 ) {
+
+      rc = -errno;
+      SG_error("open('%s') rc = %d\n", tmp_path, rc );
+      goto UG_mdcache_write_out;
+   }
+
+   nw = md_write_uninterrupted( fd, (char const*)hdr, sizeof(struct UG_mdcache_header) );
+   if( nw == (ssize_t)sizeof(struct UG_mdcache_header) && len > 0 ) {
+
+      nw = md_write_uninterrupted( fd, data, len );
+      if( nw >= 0 && (size_t)nw != len ) {
+         nw = -EIO;
+      }
+   }
+   else if( nw >= 0 && nw != (ssize_t)sizeof(struct UG_mdcache_header) ) {
+      nw = -EIO;
+   }
+
+   if( nw < 0 ) {
+
+      rc = (int)nw;
+      SG_error("write('%s') rc = %d\n", tmp_path, rc );
+      goto UG_mdcache_write_out;
+   }
+
+   rc = rename( tmp_path, path );
+   if( rc != 0 ) {
+
+      rc = -errno;
+      SG_error("rename('%s', '%s') rc = %d\n", tmp_path, path, rc );
+      goto UG_mdcache_write_out;
+   }
+
+UG_mdcache_write_out:
+
+   if( fd >= 0 ) {
+      close( fd );
+   }
+
+   if( rc != 0 && tmp_path != NULL ) {
+      unlink( tmp_path );
+   }
+
+   SG_safe_free( dir );
+   SG_safe_free( path );
+   SG_safe_free( tmp_path );
+
+   return rc;
+}
+
+
+// order trim candidates oldest-first
+static bool UG_mdcache_trim_entry_older( const struct UG_mdcache_trim_entry& a, const struct UG_mdcache_trim_entry& b ) {
+
+   return a.mtime.tv_sec < b.mtime.tv_sec || (a.mtime.tv_sec == b.mtime.tv_sec && a.mtime.tv_nsec < b.mtime.tv_nsec);
+}
+
+
+// if a cache subdirectory holds more than UG_MDCACHE_MAX_BYTES, remove its least-recently-written files until it is down to 3/4 of that.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on failure to list the directory
+static int UG_mdcache_trim( struct SG_gateway* gateway, char const* subdir ) {
+
+   int rc = 0;
+   char* dir_path = NULL;
+   DIR* dir = NULL;
+   struct dirent* dent = NULL;
+   struct stat sb;
+   off_t total = 0;
+   int num_removed = 0;
+   UG_mdcache_trim_list_t ents;
+
+   dir_path = UG_mdcache_subdir_path( gateway, subdir );
+   if( dir_path == NULL ) {
+      return -ENOMEM;
+   }
+
+   dir = opendir( dir_path );
+   if( dir == NULL ) {
+
+      rc = -errno;
+      SG_safe_free( dir_path );
+      return (rc == -ENOENT ? 0 : rc);
+   }
+
+   try {
+
+      while( (dent = readdir( dir )) != NULL ) {
+
+         // skip ., .., and in-progress writes
+         if( dent->d_name[0] == '.' || strstr( dent->d_name, ".tmp" ) != NULL ) {
+            continue;
+         }
+
+         if( fstatat( dirfd( dir ), dent->d_name, &sb, 0 ) != 0 || !S_ISREG( sb.st_mode ) ) {
+            continue;
+         }
+
+         struct UG_mdcache_trim_entry ent;
+         ent.mtime = sb.st_mtim;
+         ent.size = sb.st_size;
+         ent.name = string( dent->d_name );
+
+         ents.push_back( ent );
+         total += sb.st_size;
+      }
+
+      if( total > UG_MDCACHE_MAX_BYTES ) {
+
+         sort( ents.begin(), ents.end(), UG_mdcache_trim_entry_older );
+
+         for( size_t i = 0; i < ents.size() && total > (UG_MDCACHE_MAX_BYTES / 4) * 3; i++ ) {
+
+            if( unlinkat( dirfd( dir ), ents[i].name.c_str(), 0 ) == 0 ) {
+
+               total -= ents[i].size;
+               num_removed++;
+            }
+         }
+
+         SG_debug("Metadata cache '%s': removed %d old entries\n", dir_path, num_removed );
+      }
+   }
+   catch( bad_alloc& ba ) {
+      rc = -ENOMEM;
+   }
+
+   closedir( dir );
+   SG_safe_free( dir_path );
+
+   return rc;
+}
+
+
+// remove a metadata cache file, if it exists
+// return 0 on success, or if it did not exist
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int UG_mdcache_unlink( struct SG_gateway* gateway, char const* subdir, uint64_t file_id ) {
+
+   int rc = 0;
+   char* path = UG_mdcache_path( gateway, subdir, file_id, "" );
+
+   if( path == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = unlink( path );
+   if( rc != 0 ) {
+
+      rc = -errno;
+      if( rc == -ENOENT ) {
+         rc = 0;
+      }
+      else {
+         SG_error("unlink('%s') rc = %d\n", path, rc );
+      }
+   }
+
+   SG_safe_free( path );
+   return rc;
+}
+
+
+// forget everything cached for a file or directory (i.e. it was unlinked or rmdir'ed)
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_remove( struct SG_gateway* gateway, uint64_t file_id ) {
+
+   int rc = UG_mdcache_unlink( gateway, UG_MDCACHE_DIRS_DIR, file_id );
+   int manifest_rc = UG_mdcache_unlink( gateway, UG_MDCACHE_MANIFESTS_DIR, file_id );
+
+   return (rc != 0 ? rc : manifest_rc);
+}
+
+
+// forget a file's cached manifest (i.e. the file was reversioned, so the manifest can no longer be used)
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_manifest_remove( struct SG_gateway* gateway, uint64_t file_id ) {
+
+   return UG_mdcache_unlink( gateway, UG_MDCACHE_MANIFESTS_DIR, file_id );
+}
+
+
+// load a metadata cache file, and check its header
+// return 0 on success, and set *data and *len to the malloc'ed file contents and its length (including the header)
+// return -ENOENT if there is no such file
+// return -EINVAL if the file is malformed, or belongs to a different volume or file
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int UG_mdcache_read( struct SG_gateway* gateway, char const* subdir, uint32_t type, uint64_t file_id, char** data, off_t* len ) {
+
+   char* path = NULL;
+   char* buf = NULL;
+   off_t buf_len = 0;
+
+   path = UG_mdcache_path( gateway, subdir, file_id, "" );
+   if( path == NULL ) {
+      return -ENOMEM;
+   }
+
+   buf = md_load_file( path, &buf_len );
+   if( buf == NULL ) {
+
+      if( buf_len != -ENOENT ) {
+         SG_error("md_load_file('%s') rc = %d\n", path, (int)buf_len );
+      }
+
+      SG_safe_free( path );
+      return (int)buf_len;
+   }
+
+   if( (size_t)buf_len < sizeof(struct UG_mdcache_header) || !UG_mdcache_header_valid( gateway, (struct UG_mdcache_header*)buf, type, file_id ) ) {
+
+      SG_warn("Ignoring malformed metadata cache file '%s'\n", path );
+
+      SG_safe_free( buf );
+      SG_safe_free( path );
+      return -EINVAL;
+   }
+
+   SG_safe_free( path );
+
+   *data = buf;
+   *len = buf_len;
+   return 0;
+}
+
+
+// load a directory's cached children.
+// if a child appears more than once, its last record wins.
+// a truncated record at the end (i.e. from an interrupted append) is ignored.
+// return 0 on success, and set *ents (malloc'ed), *num_ents, and *max_generation (the largest child generation; 0 if there are no children)
+// return -ENOENT if we have nothing cached for this directory
+// return -EINVAL if the cached listing is malformed
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_dir_load( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry** ents, size_t* num_ents, int64_t* max_generation ) {
+
+   int rc = 0;
+   char* buf = NULL;
+   off_t len = 0;
+   off_t off = sizeof(struct UG_mdcache_header);
+   int64_t max_gen = 0;
+
+   struct md_entry* ret = NULL;
+   map< uint64_t, struct md_entry > children;
+   size_t i = 0;
+
+   rc = UG_mdcache_read( gateway, UG_MDCACHE_DIRS_DIR, UG_MDCACHE_TYPE_DIR, dir_id, &buf, &len );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   while( off + (off_t)sizeof(uint32_t) <= len ) {
+
+      uint32_t rec_len = 0;
+      ms::ms_entry msent;
+      struct md_entry ent;
+
+      memcpy( &rec_len, buf + off, sizeof(uint32_t) );
+      off += sizeof(uint32_t);
+
+      if( off + (off_t)rec_len > len ) {
+
+         // interrupted append
+         SG_warn("Directory %" PRIX64 ": ignoring truncated record at offset %jd\n", dir_id, (intmax_t)(off - sizeof(uint32_t)) );
+         break;
+      }
+
+      rc = md_parse< ms::ms_entry >( &msent, buf + off, rec_len );
+      if( rc != 0 ) {
+
+         SG_error("Directory %" PRIX64 ": invalid record at offset %jd\n", dir_id, (intmax_t)(off - sizeof(uint32_t)) );
+         rc = -EINVAL;
+         break;
+      }
+
+      off += rec_len;
+
+      rc = ms_entry_to_md_entry( msent, &ent );
+      if( rc != 0 ) {
+         break;
+      }
+
+      try {
+
+         map< uint64_t, struct md_entry >::iterator itr = children.find( ent.file_id );
+         if( itr != children.end() ) {
+
+            md_entry_free( &itr->second );
+            itr->second = ent;
+         }
+         else {
+
+            children[ ent.file_id ] = ent;
+         }
+      }
+      catch( bad_alloc& ba ) {
+
+         md_entry_free( &ent );
+         rc = -ENOMEM;
+         break;
+      }
+   }
+
+   SG_safe_free( buf );
+
+   if( rc == 0 ) {
+
+      ret = SG_CALLOC( struct md_entry, MAX( children.size(), 1 ) );
+      if( ret == NULL ) {
+         rc = -ENOMEM;
+      }
+   }
+
+   if( rc != 0 ) {
+
+      for( map< uint64_t, struct md_entry >::iterator itr = children.begin(); itr != children.end(); itr++ ) {
+         md_entry_free( &itr->second );
+      }
+
+      return rc;
+   }
+
+   for( map< uint64_t, struct md_entry >::iterator itr = children.begin(); itr != children.end(); itr++ ) {
+
+      ret[i] = itr->second;
+      max_gen = MAX( max_gen, itr->second.generation );
+      i++;
+   }
+
+   *ents = ret;
+   *num_ents = children.size();
+   *max_generation = max_gen;
+
+   return 0;
+}
+
+
+// append records to a directory's cached listing.
+// only works if we already cached a complete listing.
+// return 0 on success
+// return -ENOENT if we have no cached listing for this directory
+// return -EINVAL if the cached listing is malformed
+// return -errno on I/O error
+static int UG_mdcache_append( struct SG_gateway* gateway, uint64_t dir_id, char const* data, size_t len ) {
+
+   int rc = 0;
+   int fd = -1;
+   ssize_t nr = 0;
+   ssize_t nw = 0;
+   char* path = NULL;
+   struct UG_mdcache_header hdr;
+
+   path = UG_mdcache_path( gateway, UG_MDCACHE_DIRS_DIR, dir_id, "" );
+   if( path == NULL ) {
+      return -ENOMEM;
+   }
+
+   fd = open( path, O_RDWR | O_APPEND );
+   if( fd < 0 ) {
+
+      rc = -errno;
+      if( rc != -ENOENT ) {
+         SG_error("open('%s') rc = %d\n", path, rc );
+      }
+
+      SG_safe_free( path );
+      return rc;
+   }
+
+   nr = md_read_uninterrupted( fd, (char*)&hdr, sizeof(struct UG_mdcache_header) );
+   if( nr != (ssize_t)sizeof(struct UG_mdcache_header) || !UG_mdcache_header_valid( gateway, &hdr, UG_MDCACHE_TYPE_DIR, dir_id ) ) {
+
+      SG_warn("Not appending to malformed metadata cache file '%s'\n", path );
+      rc = (nr < 0 ? (int)nr : -EINVAL);
+   }
+   else {
+
+      nw = md_write_uninterrupted( fd, data, len );
+      if( nw < 0 || (size_t)nw != len ) {
+
+         rc = (nw < 0 ? (int)nw : -EIO);
+         SG_error("write('%s') rc = %d\n", path, rc );
+      }
+   }
+
+   close( fd );
+   SG_safe_free( path );
+
+   return rc;
+}
+
+
+// serialize a directory's children into a cache update, to be written later with UG_mdcache_update_write.
+// if append is false, the update replaces the cached listing; otherwise, it adds newly-discovered children to it.
+// return 0 on success, and populate *update
+// return -ENOMEM on OOM
+int UG_mdcache_dir_serialize( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry* ents, size_t num_ents, bool append, struct UG_mdcache_update* update ) {
+
+   int rc = 0;
+   string buf;
+
+   memset( update, 0, sizeof(struct UG_mdcache_update) );
+
+   if( append && num_ents == 0 ) {
+
+      // nothing to do
+      return 0;
+   }
+
+   rc = UG_mdcache_dir_records_serialize( ents, num_ents, &buf );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   update->data = SG_CALLOC( char, MAX( buf.size(), 1 ) );
+   if( update->data == NULL ) {
+      return -ENOMEM;
+   }
+
+   memcpy( update->data, buf.data(), buf.size() );
+   update->len = buf.size();
+
+   UG_mdcache_header_init( gateway, &update->hdr, UG_MDCACHE_TYPE_DIR, dir_id );
+   update->subdir = UG_MDCACHE_DIRS_DIR;
+   update->file_id = dir_id;
+   update->append = append;
+
+   return 0;
+}
+
+
+// serialize a file's manifest into a cache update, to be written later with UG_mdcache_update_write.
+// return 0 on success, and populate *update
+// return -ENOMEM on OOM
+int UG_mdcache_manifest_serialize( struct SG_gateway* gateway, struct SG_manifest* manifest, struct UG_mdcache_update* update ) {
+
+   int rc = 0;
+   char* bits = NULL;
+   size_t bits_len = 0;
+   uint64_t file_id = SG_manifest_get_file_id( manifest );
+   SG_messages::Manifest mmsg;
+
+   memset( update, 0, sizeof(struct UG_mdcache_update) );
+
+   rc = SG_manifest_serialize_to_protobuf( manifest, &mmsg );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   rc = md_serialize< SG_messages::Manifest >( &mmsg, &bits, &bits_len );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   UG_mdcache_header_init( gateway, &update->hdr, UG_MDCACHE_TYPE_MANIFEST, file_id );
+   update->subdir = UG_MDCACHE_MANIFESTS_DIR;
+   update->file_id = file_id;
+   update->data = bits;
+   update->len = bits_len;
+
+   return 0;
+}
+
+
+// write a serialized cache update, and enforce the size cap now and then.
+// does nothing if the update is empty.
+// return 0 on success
+// return -ENOENT if this appends to a directory listing we don't have
+// return -EINVAL if it appends to a malformed listing
+// return -ENOMEM on OOM
+// return -errno on I/O error
+// NOTE: don't hold any inode locks when calling this
+int UG_mdcache_update_write( struct SG_gateway* gateway, struct UG_mdcache_update* update ) {
+
+   int rc = 0;
+
+   if( update->subdir == NULL ) {
+      return 0;
+   }
+
+   if( update->append ) {
+      rc = UG_mdcache_append( gateway, update->file_id, update->data, update->len );
+   }
+   else {
+      rc = UG_mdcache_write( gateway, update->subdir, update->file_id, &update->hdr, update->data, update->len );
+   }
+
+   if( rc == 0 && __sync_add_and_fetch( &UG_mdcache_num_writes, 1 ) % UG_MDCACHE_TRIM_INTERVAL == 0 ) {
+
+      UG_mdcache_trim( gateway, UG_MDCACHE_DIRS_DIR );
+      UG_mdcache_trim( gateway, UG_MDCACHE_MANIFESTS_DIR );
+   }
+
+   return rc;
+}
+
+
+// free a cache update
+// always succeeds
+void UG_mdcache_update_free( struct UG_mdcache_update* update ) {
+
+   SG_safe_free( update->data );
+   memset( update, 0, sizeof(struct UG_mdcache_update) );
+}
+
+
+// cache a directory's complete listing of children, replacing whatever we had
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_dir_save( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry* ents, size_t num_ents ) {
+
+   int rc = 0;
+   struct UG_mdcache_update update;
+
+   rc = UG_mdcache_dir_serialize( gateway, dir_id, ents, num_ents, false, &update );
+   if( rc == 0 ) {
+      rc = UG_mdcache_update_write( gateway, &update );
+   }
+
+   UG_mdcache_update_free( &update );
+   return rc;
+}
+
+
+// add newly-discovered children to a directory's cached listing.
+// only works if we already cached a complete listing with UG_mdcache_dir_save.
+// return 0 on success
+// return -ENOENT if we have no cached listing for this directory
+// return -EINVAL if the cached listing is malformed
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_dir_append( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry* ents, size_t num_ents ) {
+
+   int rc = 0;
+   struct UG_mdcache_update update;
+
+   rc = UG_mdcache_dir_serialize( gateway, dir_id, ents, num_ents, true, &update );
+   if( rc == 0 ) {
+      rc = UG_mdcache_update_write( gateway, &update );
+   }
+
+   UG_mdcache_update_free( &update );
+   return rc;
+}
+
+
+// load a file's cached manifest, but only if it has the given version and modification time
+// return 0 on success, and populate *manifest
+// return -ENOENT if we have no cached manifest for this file
+// return -ESTALE if the cached manifest is for a different version or modification time
+// return -EINVAL if the cached manifest is malformed
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_manifest_load( struct SG_gateway* gateway, uint64_t file_id, int64_t file_version, int64_t mtime_sec, int32_t mtime_nsec, struct SG_manifest* manifest ) {
+
+   int rc = 0;
+   char* buf = NULL;
+   off_t len = 0;
+   SG_messages::Manifest mmsg;
+
+   rc = UG_mdcache_read( gateway, UG_MDCACHE_MANIFESTS_DIR, UG_MDCACHE_TYPE_MANIFEST, file_id, &buf, &len );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   rc = md_parse< SG_messages::Manifest >( &mmsg, buf + sizeof(struct UG_mdcache_header), len - sizeof(struct UG_mdcache_header) );
+   SG_safe_free( buf );
+
+   if( rc != 0 ) {
+
+      SG_error("Manifest %" PRIX64 ": invalid cached manifest\n", file_id );
+      return -EINVAL;
+   }
+
+   if( mmsg.file_id() != file_id || mmsg.file_version() != file_version || mmsg.mtime_sec() != mtime_sec || mmsg.mtime_nsec() != mtime_nsec ) {
+
+      SG_debug("Manifest %" PRIX64 ": cached %" PRId64 "/manifest.%" PRId64 ".%d, need %" PRId64 "/manifest.%" PRId64 ".%d\n",
+               file_id, mmsg.file_version(), mmsg.mtime_sec(), mmsg.mtime_nsec(), file_version, mtime_sec, mtime_nsec );
+      return -ESTALE;
+   }
+
+   return SG_manifest_load_from_protobuf( manifest, &mmsg );
+}
+
+
+// cache a file's manifest, replacing whatever we had
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int UG_mdcache_manifest_save( struct SG_gateway* gateway, struct SG_manifest* manifest ) {
+
+   int rc = 0;
+   struct UG_mdcache_update update;
+
+   rc = UG_mdcache_manifest_serialize( gateway, manifest, &update );
+   if( rc == 0 ) {
+      rc = UG_mdcache_update_write( gateway, &update );
+   }
+
+   UG_mdcache_update_free( &update );
+   return rc;
+}
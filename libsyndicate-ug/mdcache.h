@@ -0,0 +1,102 @@
+/*
+   Copyright 2015 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Persistent metadata cache.
+ *
+ * Directory listings and manifests we got from the MS and the RGs are kept under <data_root>/<volume>/metadata,
+ * so a restarted UG can revalidate them instead of downloading them again.
+ *
+ * * metadata/dirs/<dir ID> holds a directory's children, as a header followed by length-prefixed ms_entry records.
+ *   New children are appended; the file is rewritten whenever we get a full listing.  Later records for a file ID replace earlier ones.
+ * * metadata/manifests/<file ID> holds a file's last-known manifest, as a header followed by the serialized Manifest.
+ *
+ * Nothing here is trusted to be fresh:  restored children are marked stale (so they get revalidated with their write nonces),
+ * and restored manifests are only used if they match the version and manifest timestamp the MS gave us.
+ *
+ * Entries are removed when their inode is unlinked or reversioned.  Each subdirectory is also capped at UG_MDCACHE_MAX_BYTES;
+ * once it grows past that, the least-recently-written entries are removed.
+ *
+ * Callers holding inode locks should serialize an update with UG_mdcache_*_serialize while locked, and write it with
+ * UG_mdcache_update_write once they have unlocked, so no file I/O happens under the lock.
+ */
+
+#ifndef _UG_MDCACHE_H_
+#define _UG_MDCACHE_H_
+
+#include <libsyndicate/libsyndicate.h>
+#include <libsyndicate/gateway.h>
+#include <libsyndicate/manifest.h>
+
+#define UG_MDCACHE_DIR                  "metadata"              // directory under the volume's data root that holds the metadata cache
+#define UG_MDCACHE_DIRS_DIR             "dirs"
+#define UG_MDCACHE_MANIFESTS_DIR        "manifests"
+
+#define UG_MDCACHE_MAGIC                0x55474d44              // "UGMD"
+#define UG_MDCACHE_VERSION              1
+
+#define UG_MDCACHE_TYPE_DIR             1
+#define UG_MDCACHE_TYPE_MANIFEST        2
+
+#define UG_MDCACHE_MAX_BYTES            (64 * 1024 * 1024)      // most bytes to keep in each of the dirs and manifests directories
+#define UG_MDCACHE_TRIM_INTERVAL        256                     // check the size cap once every this many writes
+
+// on-disk header for both directory listings and manifests
+struct UG_mdcache_header {
+
+   uint32_t magic;              // UG_MDCACHE_MAGIC
+   uint32_t version;            // UG_MDCACHE_VERSION
+   uint32_t type;               // UG_MDCACHE_TYPE_DIR or UG_MDCACHE_TYPE_MANIFEST
+   uint32_t unused;
+   uint64_t volume_id;
+   uint64_t file_id;            // ID of the directory or file
+};
+
+// a serialized update to the metadata cache, waiting to be written
+struct UG_mdcache_update {
+
+   char const* subdir;          // UG_MDCACHE_DIRS_DIR or UG_MDCACHE_MANIFESTS_DIR; NULL if there is nothing to write
+   uint64_t file_id;
+   bool append;                 // if true, append the records to a cached listing instead of replacing the file
+   struct UG_mdcache_header hdr;
+   char* data;                  // records or serialized manifest (malloc'ed)
+   size_t len;
+};
+
+extern "C" {
+
+// deferred updates
+int UG_mdcache_dir_serialize( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry* ents, size_t num_ents, bool append, struct UG_mdcache_update* update );
+int UG_mdcache_manifest_serialize( struct SG_gateway* gateway, struct SG_manifest* manifest, struct UG_mdcache_update* update );
+int UG_mdcache_update_write( struct SG_gateway* gateway, struct UG_mdcache_update* update );
+void UG_mdcache_update_free( struct UG_mdcache_update* update );
+
+// cleanup
+int UG_mdcache_remove( struct SG_gateway* gateway, uint64_t file_id );
+int UG_mdcache_manifest_remove( struct SG_gateway* gateway, uint64_t file_id );
+
+// directory listings
+int UG_mdcache_dir_load( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry** ents, size_t* num_ents, int64_t* max_generation );
+int UG_mdcache_dir_save( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry* ents, size_t num_ents );
+int UG_mdcache_dir_append( struct SG_gateway* gateway, uint64_t dir_id, struct md_entry* ents, size_t num_ents );
+
+// manifests
+int UG_mdcache_manifest_load( struct SG_gateway* gateway, uint64_t file_id, int64_t file_version, int64_t mtime_sec, int32_t mtime_nsec, struct SG_manifest* manifest );
+int UG_mdcache_manifest_save( struct SG_gateway* gateway, struct SG_manifest* manifest );
+
+}
+
+#endif
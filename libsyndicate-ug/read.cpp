@@ -20,8 +20,37 @@
 #include "consistency.h"
 #include "client.h"
 
-// track which gateway to download a given block from
-typedef map< uint64_t, int > UG_block_gateway_map_t;
+// track which gateways (indexes into the download gateway list) we have asked for a given block
+typedef map< uint64_t, set<int> > UG_block_gateway_map_t;
+
+// a block request in flight 
+struct UG_read_download {
+   
+   uint64_t block_id;           // block being fetched
+   int64_t block_version;
+   int gateway_idx;             // index into the download gateway list 
+   struct timespec start;       // when we sent the request (CLOCK_MONOTONIC)
+   bool hedge;                  // if true, this is a duplicate request for a block that was slow to arrive
+};
+
+typedef map< struct md_download_context*, struct UG_read_download > UG_read_download_map_t;
+
+// receive buffer for each download slot, so responses land in place instead of being copied out of the download context
+typedef map< struct md_download_context*, char* > UG_read_direct_buf_map_t;
+
+// what to do with each block UG_read_download_blocks_ex fetches.
+// the block is deserialized, unless it was fetched raw--in which case the callback owns the (serialized) data.
+// return 0 on success; return negative to stop downloading
+typedef int (*UG_read_download_block_func_t)( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* block_requests, uint64_t block_id, int64_t block_version, struct SG_chunk* block, void* cls );
+
+// a read-ahead request, carried out by one of the gateway's I/O workers
+struct UG_read_prefetch_ctx {
+   
+   struct SG_gateway* gateway;
+   char* fs_path;
+   struct SG_manifest blocks;           // blocks to fetch into the cache
+   struct SG_IO_hints io_hints;         // tells the driver these are prefetches
+};
 
 // set up a manifest and dirty block map to receive a block into a particular buffer 
 // the block put into *blocks takes ownership of buf, so the caller must not free it
@@ -137,7 +166,7 @@ int UG_read_unaligned_setup( struct SG_gateway* gateway, char const* fs_path, st
       
       // head is unaligned 
       // make a head buffer 
-      buf = SG_CALLOC( char, block_size );
+      buf = md_bufpool_calloc( block_size );
       if( buf == NULL ) {
          
          return -ENOMEM;
@@ -147,7 +176,7 @@ int UG_read_unaligned_setup( struct SG_gateway* gateway, char const* fs_path, st
       rc = UG_read_setup_block_buffer( inode, first_block, buf, block_size, &unaligned_blocks );
       if( rc != 0 ) {
          
-         SG_safe_free( buf ); 
+         SG_pool_safe_free( buf ); 
          UG_dirty_block_map_free( &unaligned_blocks );
          
          return rc;
@@ -177,7 +206,7 @@ int UG_read_unaligned_setup( struct SG_gateway* gateway, char const* fs_path, st
       
       // tail unaligned 
       // make a tail buffer 
-      buf = SG_CALLOC( char, block_size );
+      buf = md_bufpool_calloc( block_size );
       if( buf == NULL ) {
          
          return -ENOMEM;
@@ -187,7 +216,7 @@ int UG_read_unaligned_setup( struct SG_gateway* gateway, char const* fs_path, st
       rc = UG_read_setup_block_buffer( inode, last_block, buf, block_size, &unaligned_blocks );
       if( rc != 0 ) {
          
-         SG_safe_free( buf );
+         SG_pool_safe_free( buf );
          UG_dirty_block_map_free( &unaligned_blocks );
          return rc;
       }
@@ -362,64 +391,228 @@ int UG_read_download_gateway_list( struct SG_gateway* gateway, uint64_t coordina
 }
 
 
-// download multiple blocks at once.
-// return 0 on success, and populate *blocks and *num_blocks with the blocks requested in the block_requests manifest.
-// return -EINVAL if blocks has reserved chunk data that is unallocated, or does not have enough space
+// rank a gateway by how long we expect to wait to get a block from it: its average latency, inflated by its failure rate.
+// gateways we have not heard from yet rank first, so we learn about them.
+// return the score (lower is better)
+static double UG_read_download_gateway_score( struct UG_state* ug, uint64_t gateway_id ) {
+   
+   int rc = 0;
+   struct UG_gateway_read_stats stats;
+   double latency = 0;
+   
+   rc = UG_state_read_stats_get( ug, gateway_id, &stats );
+   if( rc != 0 ) {
+      return 0.0;
+   }
+   
+   if( stats.num_successes > 0 ) {
+      latency = (double)stats.latency_ns;
+   }
+   else {
+      latency = (double)UG_READ_FAILED_LATENCY_MS * 1000000.0;
+   }
+   
+   return latency / MAX( 1.0 - stats.error_rate, 0.01 );
+}
+
+
+// how long to wait on a gateway for a block before asking another gateway as well
+// return the delay in nanoseconds
+// return -1 if we don't know enough about the gateway to tell
+static int64_t UG_read_download_gateway_hedge_delay( struct UG_state* ug, uint64_t gateway_id ) {
+   
+   int rc = 0;
+   struct UG_gateway_read_stats stats;
+   int64_t delay = 0;
+   
+   rc = UG_state_read_stats_get( ug, gateway_id, &stats );
+   if( rc != 0 ) {
+      return -1;
+   }
+   
+   delay = UG_gateway_read_stats_percentile( &stats, UG_READ_HEDGE_PERCENTILE, UG_READ_HEDGE_MIN_SAMPLES );
+   if( delay < 0 ) {
+      return -1;
+   }
+   
+   return MAX( delay, (int64_t)UG_READ_HEDGE_MIN_DELAY_MS * 1000000L );
+}
+
+
+// pick the best-ranked gateway we haven't asked for a block yet.
+// ties go to the gateway earlier in the list.
+// return the index into the gateway list on success
+// return -1 if we've asked all of them
+static int UG_read_download_gateway_pick( double* scores, size_t num_gateway_ids, set<int>* tried ) {
+   
+   int best = -1;
+   
+   for( size_t i = 0; i < num_gateway_ids; i++ ) {
+      
+      if( tried->count( i ) > 0 ) {
+         continue;
+      }
+      
+      if( best < 0 || scores[i] < scores[best] ) {
+         best = i;
+      }
+   }
+   
+   return best;
+}
+
+
+// get (or allocate) the receive buffer for a download slot.
+// slots are only reused once their previous download has been processed, so the buffer is free.
+// return the buffer on success
+// return NULL on OOM
+static char* UG_read_download_direct_buf( UG_read_direct_buf_map_t* direct_bufs, struct md_download_context* dlctx, size_t len ) {
+   
+   char* buf = NULL;
+   
+   UG_read_direct_buf_map_t::iterator itr = direct_bufs->find( dlctx );
+   if( itr != direct_bufs->end() ) {
+      return itr->second;
+   }
+   
+   buf = md_bufpool_alloc( len );
+   if( buf == NULL ) {
+      return NULL;
+   }
+   
+   try {
+      (*direct_bufs)[ dlctx ] = buf;
+   }
+   catch( bad_alloc& ba ) {
+      
+      SG_pool_safe_free( buf );
+      return NULL;
+   }
+   
+   return buf;
+}
+
+
+// start downloading a block from a gateway, and remember that we did so
+// if direct_buf is not NULL, the response is received into it (see SG_client_get_block_async_direct)
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on failure to start the download
+static int UG_read_download_start( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* block_requests, uint64_t block_id, int64_t block_version, struct SG_IO_hints* io_hints,
+                                   uint64_t* gateway_ids, int gateway_idx, bool hedge, struct md_download_loop* dlloop, struct md_download_context* dlctx, char* direct_buf, off_t direct_buf_len,
+                                   UG_block_gateway_map_t* block_gateways, map<uint64_t, int>* block_inflight, UG_read_download_map_t* inflight ) {
+   
+   int rc = 0;
+   struct SG_request_data reqdat;
+   struct UG_read_download dl;
+   
+   dl.block_id = block_id;
+   dl.block_version = block_version;
+   dl.gateway_idx = gateway_idx;
+   dl.hedge = hedge;
+   clock_gettime( CLOCK_MONOTONIC, &dl.start );
+   
+   try {
+      
+      // reserve our bookkeeping first, so we can't fail once the download starts
+      (*block_gateways)[ block_id ].insert( gateway_idx );
+      (*block_inflight)[ block_id ];
+      (*inflight)[ dlctx ];
+   }
+   catch( bad_alloc& ba ) {
+      
+      inflight->erase( dlctx );
+      return -ENOMEM;
+   }
+   
+   rc = SG_request_data_init_block( gateway, fs_path, block_requests->file_id, block_requests->file_version, block_id, block_version, &reqdat );
+   if( rc != 0 ) {
+      
+      inflight->erase( dlctx );
+      return rc;
+   }
+   
+   if( io_hints != NULL ) {
+      SG_request_data_set_IO_hints( &reqdat, io_hints );
+   }
+
+   rc = SG_client_get_block_async_direct( gateway, &reqdat, gateway_ids[ gateway_idx ], dlloop, dlctx, direct_buf, direct_buf_len );
+   SG_request_data_free( &reqdat );
+
+   if( rc != 0 ) {
+      
+      if( rc == -EAGAIN ) {
+         // gateway ID is not found--we should reload the cert bundle 
+         SG_gateway_start_reload( gateway );
+      }
+
+      SG_error("SG_client_get_block_async( %" PRIu64 " ) rc = %d\n", gateway_ids[ gateway_idx ], rc );
+      
+      inflight->erase( dlctx );
+      return rc;
+   }
+   
+   (*inflight)[ dlctx ] = dl;
+   (*block_inflight)[ block_id ]++;
+   
+   SG_debug("Will download %" PRIX64 "[%" PRIu64 ".%" PRId64 "] from %" PRIu64 "%s\n", block_requests->file_id, block_id, block_version, gateway_ids[ gateway_idx ], hedge ? " (hedged)" : "" );
+   return 0;
+}
+
+
+// download multiple blocks at once, and hand each one to block_cb (if given) as it arrives.
+// if raw is true, the blocks are not deserialized (i.e. they are in the form they take in the cache).
+// otherwise, each response is received into a per-slot buffer, verified there, and deserialized straight into
+// the block's buffer in blocks_out (which must be RAM-mapped and at least a volume block long).
+// each block is fetched from the gateway we expect to answer fastest (by moving-average latency and error rate).
+// if a request takes longer than that gateway's UG_READ_HEDGE_PERCENTILE latency, the block is requested from 
+// the next-best gateway as well, and whichever request loses is cancelled.  A failed request is retried on the next-best gateway.
+// return 0 on success
 // return -ENOMEM on OOM 
 // return -errno on failure to download
-int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* block_requests, UG_dirty_block_map_t* blocks ) {
+static int UG_read_download_blocks_ex( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* block_requests, struct SG_IO_hints* io_hints, bool raw, UG_dirty_block_map_t* blocks_out, UG_read_download_block_func_t block_cb, void* cls ) {
    
    int rc = 0;
    struct ms_client* ms = SG_gateway_ms( gateway );
+   struct UG_state* ug = (struct UG_state*)SG_gateway_cls( gateway );
    
    uint64_t* gateway_ids = NULL;
    size_t num_gateway_ids = 0;
+   double* gateway_scores = NULL;                   // expected time to get a block from each gateway
+   int64_t* gateway_hedge_delays = NULL;            // how long to wait on each gateway before hedging (-1 for never)
    
    struct md_download_context* dlctx = NULL;
    struct md_download_loop* dlloop = NULL;
    
-   struct SG_request_data reqdat;
-   
    uint64_t block_id = 0;
    uint64_t next_block_id = 0;
 
    struct SG_chunk next_block;
+   struct SG_chunk raw_block;
    struct SG_manifest_block* block_info = NULL;
 
-   UG_block_gateway_map_t block_gateway_idx;        // map block ID to the index into gateway_ids for the next gateway to try
+   UG_block_gateway_map_t block_gateways;           // map block ID to the gateways we've asked for it; erased once we have it
+   map<uint64_t, int> block_inflight;               // map block ID to the number of requests for it in flight 
+   set<uint64_t> blocks_hedged;                     // blocks we've sent a duplicate request for 
+   UG_read_download_map_t inflight;                 // requests in flight 
+   UG_read_direct_buf_map_t direct_bufs;            // receive buffer for each download slot (not used for raw downloads)
+   UG_dirty_block_map_t::iterator block_out_itr;
+   char* direct_buf = NULL;
+   
    int gateway_idx = 0;
-   SG_manifest_block_iterator itr;
    uint64_t block_size = ms_client_get_volume_blocksize( ms );
-
-   set<uint64_t> blocks_in_flight;                  // set of blocks being downloaded right now (keyed by ID)
-   bool cycled_through = false;                     // set to true once the maximum number of in-flight blocks has been started
+   off_t direct_buf_len = block_size + UG_READ_DIRECT_HEADER_SLACK;
+   
+   struct timespec now;
+   int64_t elapsed = 0;
+   int64_t timeout_ms = -1;
+   struct UG_read_download dl;
 
    memset( &next_block, 0, sizeof(struct SG_chunk) );
+   memset( &raw_block, 0, sizeof(struct SG_chunk) );
    
-   next_block.len = block_size;
-   next_block.data = SG_CALLOC( char, block_size );
-   if( next_block.data == NULL ) {
-      return -ENOMEM;
-   }
-   
-   // sanity check--every block in blocks must be RAM-mapped to the reader's buffer
-   for( UG_dirty_block_map_t::iterator block_itr = blocks->begin(); block_itr != blocks->end(); block_itr++ ) {
-      
-      if( !UG_dirty_block_in_RAM( &block_itr->second ) ) {
-
-         SG_error("BUG: block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] not RAM-mapped\n",
-               SG_manifest_get_file_id( block_requests ), UG_dirty_block_id( &block_itr->second ), UG_dirty_block_version( &block_itr->second ) );
-
-         exit(1);
-      }
-
-      // need a full buffer
-      if( (unsigned)UG_dirty_block_buf( &block_itr->second )->len < block_size ) {
-         SG_error("BUG: block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] has insufficient space (%zu)\n",
-               SG_manifest_get_file_id( block_requests ), UG_dirty_block_id( &block_itr->second ), UG_dirty_block_version( &block_itr->second ), (size_t)UG_dirty_block_buf( &block_itr->second )->len );
-
-         exit(1);
-      }
+   if( !raw && blocks_out == NULL ) {
+      return -EINVAL;
    }
    
    // what are the gateways?
@@ -427,84 +620,81 @@ int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, st
    if( rc != 0 ) {
       
       // OOM
-      SG_chunk_free( &next_block );
       return rc;
    }
    
-   // seed block <--> gateway index
+   // how fast are they?
+   gateway_scores = SG_CALLOC( double, num_gateway_ids + 1 );
+   gateway_hedge_delays = SG_CALLOC( int64_t, num_gateway_ids + 1 );
+   if( gateway_scores == NULL || gateway_hedge_delays == NULL ) {
+      
+      SG_safe_free( gateway_scores );
+      SG_safe_free( gateway_hedge_delays );
+      SG_safe_free( gateway_ids );
+      return -ENOMEM;
+   }
+   
+   for( size_t i = 0; i < num_gateway_ids; i++ ) {
+      
+      gateway_scores[i] = UG_read_download_gateway_score( ug, gateway_ids[i] );
+      gateway_hedge_delays[i] = UG_read_download_gateway_hedge_delay( ug, gateway_ids[i] );
+   }
+   
+   // seed the set of blocks to get
    for( SG_manifest_block_iterator seed_itr = SG_manifest_block_iterator_begin( block_requests ); seed_itr != SG_manifest_block_iterator_end( block_requests ); seed_itr++ ) {
      
       try {
          block_id = SG_manifest_block_iterator_id( seed_itr );
-         block_gateway_idx[ block_id ] = 0;
+         block_gateways[ block_id ];
+         block_inflight[ block_id ] = 0;
       }
       catch( bad_alloc& ba ) {
          
+         SG_safe_free( gateway_scores );
+         SG_safe_free( gateway_hedge_delays );
          SG_safe_free( gateway_ids ); 
-         SG_chunk_free( &next_block );
          return -ENOMEM;
       }
    }
    
-   // prepare to download blocks 
+   // prepare to download blocks (leaving room for hedged requests)
    dlloop = md_download_loop_new();
    if( dlloop == NULL ) {
+      SG_safe_free( gateway_scores );
+      SG_safe_free( gateway_hedge_delays );
       SG_safe_free( gateway_ids );
-      SG_chunk_free( &next_block );
       return -ENOMEM;
    }
 
-   rc = md_download_loop_init( dlloop, SG_gateway_dl( gateway ), MIN( (unsigned)ms->max_connections, SG_manifest_get_block_count( block_requests ) ) );
+   rc = md_download_loop_init( dlloop, SG_gateway_dl( gateway ), MIN( (unsigned)ms->max_connections, 2 * SG_manifest_get_block_count( block_requests ) ) );
    if( rc != 0 ) {
       
       SG_error("md_download_loop_init rc = %d\n", rc );
       SG_safe_free( dlloop );
+      SG_safe_free( gateway_scores );
+      SG_safe_free( gateway_hedge_delays );
       SG_safe_free( gateway_ids );
-      SG_chunk_free( &next_block );
    
       return rc;
    }
    
-   itr = SG_manifest_block_iterator_begin( block_requests );
-
    // download each block 
-   do {
+   while( block_gateways.size() > 0 ) {
       
-      // start as many downloads as we can 
-      while( block_gateway_idx.size() > 0 ) {
-        
-         // cycle through the manifest of blocks to fetch 
-         if( itr == SG_manifest_block_iterator_end( block_requests ) ) {
-            itr = SG_manifest_block_iterator_begin( block_requests );
-
-            if( cycled_through ) {
-               // all download slots are filled 
-               cycled_through = false;
-               break;
-            }
-
-            cycled_through = true;
-         }
+      // start a request for each block that doesn't have one, as long as we have download slots
+      for( SG_manifest_block_iterator itr = SG_manifest_block_iterator_begin( block_requests ); itr != SG_manifest_block_iterator_end( block_requests ); itr++ ) {
          
          block_id = SG_manifest_block_iterator_id( itr );
          block_info = SG_manifest_block_iterator_block( itr );
          
-         // did we get this block already?
-         if( block_gateway_idx.find( block_id ) == block_gateway_idx.end() ) {
-            
-            itr++;
+         // did we get this block already, or are we getting it now?
+         if( block_gateways.find( block_id ) == block_gateways.end() || block_inflight[ block_id ] > 0 ) {
             continue;
          }
-
-         // are we getting this block already?
-         if( blocks_in_flight.count( block_id ) > 0 ) {
-
-            itr++;
-            continue;
-         }
-
-         // have we tried each gateway?
-         if( (unsigned)(block_gateway_idx[ block_id ]) >= num_gateway_ids ) {
+         
+         // next-best gateway 
+         gateway_idx = UG_read_download_gateway_pick( gateway_scores, num_gateway_ids, &block_gateways[ block_id ] );
+         if( gateway_idx < 0 ) {
 
             SG_error("Tried all RGs for block %" PRIX64 "[%" PRIu64 ".%" PRId64 "]\n", SG_manifest_get_file_id( block_requests ), block_id, SG_manifest_block_version( block_info ) );
             rc = -ENODATA;
@@ -516,6 +706,7 @@ int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, st
          if( rc != 0 ) {
             
             if( rc == -EAGAIN ) {
+               // all download slots are filled
                rc = 0;
                break;
             }
@@ -524,58 +715,111 @@ int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, st
             break;
          }
          
-         // next gateway 
-         gateway_idx = block_gateway_idx[ block_id ];
+         direct_buf = NULL;
+         if( !raw ) {
+            
+            direct_buf = UG_read_download_direct_buf( &direct_bufs, dlctx, direct_buf_len );
+            if( direct_buf == NULL ) {
+               
+               rc = -ENOMEM;
+               break;
+            }
+         }
          
-         // start this block
-         rc = SG_request_data_init_block( gateway, fs_path, block_requests->file_id, block_requests->file_version, block_id, SG_manifest_block_version( block_info ), &reqdat );
+         rc = UG_read_download_start( gateway, fs_path, block_requests, block_id, SG_manifest_block_version( block_info ), io_hints, gateway_ids, gateway_idx, false, dlloop, dlctx, direct_buf, direct_buf_len, &block_gateways, &block_inflight, &inflight );
          if( rc != 0 ) {
             break;
          }
-
-         rc = SG_client_get_block_async( gateway, &reqdat, gateway_ids[ gateway_idx ], dlloop, dlctx );
-         SG_request_data_free( &reqdat );
-
+      }
+     
+      if( rc != 0 ) {
+         break;
+      }
+      
+      // hedge requests that are taking too long, and find out when to check again 
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      timeout_ms = -1;
+      
+      for( UG_read_download_map_t::iterator itr = inflight.begin(); itr != inflight.end(); itr++ ) {
+         
+         dl = itr->second;
+         
+         // already hedged, already have it, or don't know enough about the gateway?
+         if( dl.hedge || blocks_hedged.count( dl.block_id ) > 0 || block_gateways.find( dl.block_id ) == block_gateways.end() || gateway_hedge_delays[ dl.gateway_idx ] < 0 ) {
+            continue;
+         }
+         
+         elapsed = md_timespec_diff( &now, &dl.start );
+         if( elapsed < gateway_hedge_delays[ dl.gateway_idx ] ) {
+            
+            // not yet
+            int64_t remaining_ms = (gateway_hedge_delays[ dl.gateway_idx ] - elapsed) / 1000000L + 1;
+            if( timeout_ms < 0 || remaining_ms < timeout_ms ) {
+               timeout_ms = remaining_ms;
+            }
+            
+            continue;
+         }
+         
+         gateway_idx = UG_read_download_gateway_pick( gateway_scores, num_gateway_ids, &block_gateways[ dl.block_id ] );
+         if( gateway_idx < 0 ) {
+            
+            // nowhere else to ask
+            blocks_hedged.insert( dl.block_id );
+            continue;
+         }
+         
+         rc = md_download_loop_next( dlloop, &dlctx );
          if( rc != 0 ) {
             
             if( rc == -EAGAIN ) {
-               // gateway ID is not found--we should reload the cert bundle 
-               SG_gateway_start_reload( gateway );
+               // no free slots; try again when something finishes
+               rc = 0;
+               break;
             }
-
-            SG_error("SG_client_get_block_async( %" PRIu64 " ) rc = %d\n", gateway_ids[ gateway_idx ], rc );
+            
+            SG_error("md_download_loop_next rc = %d\n", rc );
             break;
          }
          
-         try {
+         SG_debug("Block %" PRIX64 "[%" PRIu64 "] slow from %" PRIu64 " (%" PRId64 " ms); asking %" PRIu64 " too\n",
+                  SG_manifest_get_file_id( block_requests ), dl.block_id, gateway_ids[ dl.gateway_idx ], elapsed / 1000000L, gateway_ids[ gateway_idx ] );
          
-             // next block
-             itr++;
-
-             // next gateway for this block
-             block_gateway_idx[ block_id ]++;
+         direct_buf = NULL;
+         if( !raw ) {
+            
+            direct_buf = UG_read_download_direct_buf( &direct_bufs, dlctx, direct_buf_len );
+            if( direct_buf == NULL ) {
+               
+               rc = -ENOMEM;
+               break;
+            }
+         }
          
-             // in-flight!
-             blocks_in_flight.insert( block_id );
+         rc = UG_read_download_start( gateway, fs_path, block_requests, dl.block_id, dl.block_version, io_hints, gateway_ids, gateway_idx, true, dlloop, dlctx, direct_buf, direct_buf_len, &block_gateways, &block_inflight, &inflight );
+         if( rc != 0 ) {
+            break;
+         }
+         
+         try {
+            blocks_hedged.insert( dl.block_id );
          }
          catch( bad_alloc& ba ) {
-             rc = -ENOMEM;
-             break;
+            rc = -ENOMEM;
+            break;
          }
-
-         SG_debug("Will download %" PRIX64 "[%" PRIu64 ".%" PRId64 "]\n", block_requests->file_id, block_id, SG_manifest_block_version( block_info ) );
-
-         // started at least one block; try to start more 
-         cycled_through = false;
       }
-     
+      
       if( rc != 0 ) {
          break;
       }
       
-      // wait for at least one of the downloads to finish 
-      rc = md_download_loop_run( dlloop );
-      if( rc != 0 ) {
+      // wait for at least one of the downloads to finish, or until it's time to hedge
+      rc = md_download_loop_run_timeout( dlloop, timeout_ms );
+      if( rc == -ETIMEDOUT || rc == 1 ) {
+         rc = 0;
+      }
+      else if( rc != 0 ) {
          
          SG_error("md_download_loop_run rc = %d\n", rc );
          break;
@@ -599,38 +843,111 @@ int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, st
             break;
          }
          
+         if( inflight.find( dlctx ) == inflight.end() ) {
+            
+            SG_error("BUG: unknown download %p\n", dlctx );
+            exit(1);
+         }
+         
+         dl = inflight[ dlctx ];
+         inflight.erase( dlctx );
+         block_inflight[ dl.block_id ]--;
+         
+         // lost the race to another gateway?
+         if( block_gateways.find( dl.block_id ) == block_gateways.end() || md_download_context_cancelled( dlctx ) ) {
+            
+            SG_client_get_block_discard( dlctx );
+            continue;
+         }
+         
          // process the block and free up the download handle
-         memset( next_block.data, 0, next_block.len ); 
-         rc = SG_client_get_block_finish( gateway, block_requests, dlctx, &next_block_id, &next_block );
+         if( raw ) {
+            rc = SG_client_get_block_finish_raw( gateway, block_requests, dlctx, &next_block_id, &raw_block );
+         }
+         else {
+            
+            // deserialize right into the reader's buffer
+            block_out_itr = blocks_out->find( dl.block_id );
+            if( block_out_itr == blocks_out->end() ) {
+               
+               SG_error("BUG: no buffer for block %" PRIX64 "[%" PRIu64 "]\n", SG_manifest_get_file_id( block_requests ), dl.block_id );
+               SG_client_get_block_discard( dlctx );
+               rc = -EINVAL;
+               break;
+            }
+            
+            next_block.data = UG_dirty_block_buf( &block_out_itr->second )->data;
+            next_block.len = block_size;
+            
+            memset( next_block.data, 0, next_block.len ); 
+            rc = SG_client_get_block_finish( gateway, block_requests, dlctx, &next_block_id, &next_block );
+            if( rc == 0 ) {
+               UG_dirty_block_buf( &block_out_itr->second )->len = next_block.len;
+            }
+         }
+         
+         clock_gettime( CLOCK_MONOTONIC, &now );
+         UG_state_read_stats_update( ug, gateway_ids[ dl.gateway_idx ], md_timespec_diff( &now, &dl.start ), (rc != 0) );
+         
          if( rc != 0 ) {
             
-            SG_error("SG_client_get_block_finish rc = %d\n", rc );
-            break;
+            SG_error("SG_client_get_block_finish( %" PRIX64 "[%" PRIu64 "] from %" PRIu64 " ) rc = %d\n", SG_manifest_get_file_id( block_requests ), dl.block_id, gateway_ids[ dl.gateway_idx ], rc );
+            
+            if( rc == -ENOMEM ) {
+               break;
+            }
+            
+            // try another gateway, once the other request (if any) finishes
+            if( block_inflight[ dl.block_id ] == 0 ) {
+               blocks_hedged.erase( dl.block_id );
+            }
+            
+            rc = 0;
+            continue;
          }
          
-         // copy the data in
-         // NOTE: we do not emplace the data, since this method is used to directly copy
-         // downloaded data into a client reader's read buffer
-         SG_chunk_copy( &(*blocks)[ next_block_id ].buf, &next_block );
-        
-         try { 
-             // finished this block 
-             block_gateway_idx.erase( next_block_id );
-             blocks_in_flight.erase( next_block_id );
+         // finished this block 
+         block_gateways.erase( next_block_id );
+         
+         if( block_cb != NULL ) {
+            rc = (*block_cb)( gateway, fs_path, block_requests, next_block_id, dl.block_version, (raw ? &raw_block : &next_block), cls );
          }
-         catch( bad_alloc& ba ) {
-             rc = -ENOMEM;
-             break;
+         
+         memset( &raw_block, 0, sizeof(struct SG_chunk) );
+         memset( &next_block, 0, sizeof(struct SG_chunk) );
+         
+         if( rc != 0 ) {
+            
+            SG_error("block callback( %" PRIX64 "[%" PRIu64 "] ) rc = %d\n", SG_manifest_get_file_id( block_requests ), next_block_id, rc );
+            break;
+         }
+         
+         // cancel the other request for it, if there is one.  It will show up as finished, and we'll throw it away.
+         for( UG_read_download_map_t::iterator itr = inflight.begin(); itr != inflight.end(); itr++ ) {
+            
+            if( itr->second.block_id == next_block_id ) {
+               
+               SG_debug("Cancel request for %" PRIu64 " to %" PRIu64 "\n", next_block_id, gateway_ids[ itr->second.gateway_idx ] );
+               md_download_context_cancel( SG_gateway_dl( gateway ), itr->first );
+            }
          }
 
-         SG_debug("Downloaded block %" PRIu64 "\n", next_block_id );
+         SG_debug("Downloaded block %" PRIu64 " from %" PRIu64 "\n", next_block_id, gateway_ids[ dl.gateway_idx ] );
       }
       
       if( rc != 0 ) {
          break;
       }
+   }
+   
+   // throw away the requests that are still outstanding (e.g. hedges that lost)
+   for( UG_read_download_map_t::iterator itr = inflight.begin(); itr != inflight.end(); itr++ ) {
       
-   } while( md_download_loop_running( dlloop ) );
+      md_download_context_cancel( SG_gateway_dl( gateway ), itr->first );
+      SG_client_get_block_discard( itr->first );
+   }
+   
+   inflight.clear();
    
    // failure?
    if( rc != 0 ) {
@@ -644,14 +961,278 @@ int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, st
    md_download_loop_free( dlloop );
    SG_safe_free( dlloop );
    
+   SG_safe_free( gateway_scores );
+   SG_safe_free( gateway_hedge_delays );
    SG_safe_free( gateway_ids );
-   SG_chunk_free( &next_block );
    
-   // blocks is (partially) populated with chunks 
+   for( UG_read_direct_buf_map_t::iterator itr = direct_bufs.begin(); itr != direct_bufs.end(); itr++ ) {
+      SG_pool_safe_free( itr->second );
+   }
+   
    return rc;
 }
 
 
+// download multiple blocks at once (see UG_read_download_blocks_ex).
+// return 0 on success, and populate *blocks and *num_blocks with the blocks requested in the block_requests manifest.
+// return -EINVAL if blocks has reserved chunk data that is unallocated, or does not have enough space
+// return -ENOMEM on OOM 
+// return -errno on failure to download
+int UG_read_download_blocks( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* block_requests, UG_dirty_block_map_t* blocks ) {
+   
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   uint64_t block_size = ms_client_get_volume_blocksize( ms );
+   
+   // sanity check--every block in blocks must be RAM-mapped to the reader's buffer
+   for( UG_dirty_block_map_t::iterator block_itr = blocks->begin(); block_itr != blocks->end(); block_itr++ ) {
+      
+      if( !UG_dirty_block_in_RAM( &block_itr->second ) ) {
+
+         SG_error("BUG: block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] not RAM-mapped\n",
+               SG_manifest_get_file_id( block_requests ), UG_dirty_block_id( &block_itr->second ), UG_dirty_block_version( &block_itr->second ) );
+
+         exit(1);
+      }
+
+      // need a full buffer
+      if( (unsigned)UG_dirty_block_buf( &block_itr->second )->len < block_size ) {
+         SG_error("BUG: block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] has insufficient space (%zu)\n",
+               SG_manifest_get_file_id( block_requests ), UG_dirty_block_id( &block_itr->second ), UG_dirty_block_version( &block_itr->second ), (size_t)UG_dirty_block_buf( &block_itr->second )->len );
+
+         exit(1);
+      }
+   }
+   
+   // blocks will be (partially) populated with chunks, even on error
+   return UG_read_download_blocks_ex( gateway, fs_path, block_requests, NULL, false, blocks, NULL, NULL );
+}
+
+
+// put a prefetched (still serialized) block into the cache, where the reader will find it.
+// the cache takes ownership of the block data.
+// always succeeds (failing to cache a prefetched block is not fatal)
+static int UG_read_prefetch_cache_block( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* block_requests, uint64_t block_id, int64_t block_version, struct SG_chunk* block, void* cls ) {
+   
+   int rc = 0;
+   struct SG_request_data reqdat;
+   struct md_cache_block_future* fut = NULL;
+   
+   rc = SG_request_data_init_block( gateway, fs_path, block_requests->file_id, block_requests->file_version, block_id, block_version, &reqdat );
+   if( rc != 0 ) {
+      
+      SG_chunk_free( block );
+      return 0;
+   }
+   
+   rc = SG_gateway_cached_block_put_raw_async( gateway, &reqdat, block, SG_CACHE_FLAG_DETACHED | SG_CACHE_FLAG_UNSHARED, &fut );
+   SG_request_data_free( &reqdat );
+   
+   if( rc != 0 ) {
+      
+      SG_error("SG_gateway_cached_block_put_raw_async( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", 
+               block_requests->file_id, block_requests->file_version, block_id, block_version, rc );
+      
+      SG_chunk_free( block );
+      return 0;
+   }
+   
+   SG_debug("Prefetched %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "]\n", block_requests->file_id, block_requests->file_version, block_id, block_version );
+   return 0;
+}
+
+
+// free a read-ahead request 
+// always succeeds
+static void UG_read_prefetch_free( struct UG_read_prefetch_ctx* ctx ) {
+   
+   SG_safe_free( ctx->fs_path );
+   SG_manifest_free( &ctx->blocks );
+   SG_safe_free( ctx );
+}
+
+
+// I/O worker callback to carry out a read-ahead request
+// always succeeds
+static int UG_read_prefetch_work( struct md_wreq* wreq, void* cls ) {
+   
+   int rc = 0;
+   struct UG_read_prefetch_ctx* ctx = (struct UG_read_prefetch_ctx*)cls;
+   
+   rc = UG_read_download_blocks_ex( ctx->gateway, ctx->fs_path, &ctx->blocks, &ctx->io_hints, true, NULL, UG_read_prefetch_cache_block, NULL );
+   if( rc != 0 ) {
+      
+      // the reader will fetch them itself
+      SG_error("UG_read_download_blocks_ex( '%s' (%" PRIX64 ".%" PRId64 "), prefetch ) rc = %d\n", ctx->fs_path, SG_manifest_get_file_id( &ctx->blocks ), SG_manifest_get_file_version( &ctx->blocks ), rc );
+   }
+   
+   UG_read_prefetch_free( ctx );
+   return 0;
+}
+
+
+// update a file handle's read-ahead state with a read of [offset, offset + len), and decide which blocks (if any) to read ahead.
+// the window starts at UG_READ_PREFETCH_MIN_BLOCKS once the reader is sequential, doubles (up to UG_READ_PREFETCH_MAX_BLOCKS) 
+// each time the reader moves on to a new block, and halves each time the reader seeks.
+// return true, and set *start_id and *end_id (exclusive), if the caller should prefetch those blocks
+// return false if not
+static bool UG_read_prefetch_plan( struct UG_file_handle* fh, uint64_t offset, uint64_t len, uint64_t block_size, uint64_t file_size, uint64_t* start_id, uint64_t* end_id ) {
+   
+   bool ret = false;
+   uint64_t last_id = (offset + len - 1) / block_size;
+   uint64_t max_id = (file_size - 1) / block_size;
+   
+   if( len == 0 || file_size == 0 ) {
+      return false;
+   }
+   
+   pthread_mutex_lock( &fh->prefetch_lock );
+   
+   if( (uint64_t)offset == fh->prefetch_next_offset ) {
+      
+      // sequential
+      if( fh->prefetch_window == 0 ) {
+         fh->prefetch_window = UG_READ_PREFETCH_MIN_BLOCKS;
+      }
+      else if( last_id > fh->prefetch_last_block ) {
+         fh->prefetch_window = MIN( fh->prefetch_window * 2, (uint64_t)UG_READ_PREFETCH_MAX_BLOCKS );
+      }
+   }
+   else {
+      
+      // seek.  anything we prefetched is probably not going to be read.
+      fh->prefetch_window /= 2;
+      fh->prefetch_end = 0;
+   }
+   
+   fh->prefetch_next_offset = offset + len;
+   fh->prefetch_last_block = last_id;
+   
+   if( fh->prefetch_window > 0 && last_id < max_id ) {
+      
+      *start_id = MAX( last_id + 1, fh->prefetch_end );
+      *end_id = MIN( last_id + 1 + fh->prefetch_window, max_id + 1 );
+      
+      if( *start_id < *end_id ) {
+         
+         fh->prefetch_end = *end_id;
+         ret = true;
+      }
+   }
+   
+   pthread_mutex_unlock( &fh->prefetch_lock );
+   
+   return ret;
+}
+
+
+// set up a read-ahead request for the blocks in [start_id, end_id) that are worth fetching: 
+// those that exist, and are neither dirty nor cached.
+// return a new read-ahead request on success
+// return NULL if there is nothing to fetch, or on OOM
+// NOTE: inode->entry must be read-locked
+static struct UG_read_prefetch_ctx* UG_read_prefetch_new( struct SG_gateway* gateway, char const* fs_path, struct UG_inode* inode, uint64_t start_id, uint64_t end_id, uint64_t io_context ) {
+   
+   int rc = 0;
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   uint64_t block_size = ms_client_get_volume_blocksize( ms );
+   struct UG_read_prefetch_ctx* ctx = NULL;
+   struct SG_manifest_block* block_info = NULL;
+   struct stat sb;
+   
+   ctx = SG_CALLOC( struct UG_read_prefetch_ctx, 1 );
+   if( ctx == NULL ) {
+      return NULL;
+   }
+   
+   ctx->fs_path = SG_strdup_or_null( fs_path );
+   if( ctx->fs_path == NULL ) {
+      
+      SG_safe_free( ctx );
+      return NULL;
+   }
+   
+   rc = SG_manifest_init( &ctx->blocks, UG_inode_volume_id( inode ), UG_inode_coordinator_id( inode ), UG_inode_file_id( inode ), UG_inode_file_version( inode ) );
+   if( rc != 0 ) {
+      
+      SG_safe_free( ctx->fs_path );
+      SG_safe_free( ctx );
+      return NULL;
+   }
+   
+   for( uint64_t block_id = start_id; block_id < end_id; block_id++ ) {
+      
+      block_info = SG_manifest_block_lookup( UG_inode_manifest( inode ), block_id );
+      if( block_info == NULL ) {
+         
+         // hole
+         continue;
+      }
+      
+      if( UG_inode_dirty_blocks( inode )->find( block_id ) != UG_inode_dirty_blocks( inode )->end() ) {
+         
+         // have it in RAM
+         continue;
+      }
+      
+      if( md_cache_stat_block_by_id( SG_gateway_cache( gateway ), UG_inode_file_id( inode ), UG_inode_file_version( inode ), block_id, SG_manifest_block_version( block_info ), &sb ) == 0 ) {
+         
+         // already cached
+         continue;
+      }
+      
+      rc = SG_manifest_put_block( &ctx->blocks, block_info, true );
+      if( rc != 0 ) {
+         
+         UG_read_prefetch_free( ctx );
+         return NULL;
+      }
+   }
+   
+   if( SG_manifest_get_block_count( &ctx->blocks ) == 0 ) {
+      
+      UG_read_prefetch_free( ctx );
+      return NULL;
+   }
+   
+   ctx->gateway = gateway;
+   
+   SG_IO_hints_init( &ctx->io_hints, SG_IO_PREFETCH, start_id * block_size, (end_id - start_id) * block_size );
+   ctx->io_hints.io_context = io_context;
+   
+   return ctx;
+}
+
+
+// start a read-ahead request on one of the gateway's I/O workers.
+// the worker takes ownership of ctx; it is freed here on error.
+// return 0 on success
+// return -errno on failure to enqueue
+static int UG_read_prefetch_start( struct SG_gateway* gateway, struct UG_read_prefetch_ctx* ctx ) {
+   
+   int rc = 0;
+   struct md_wreq wreq;
+   
+   SG_debug("Prefetch %" PRIX64 ".%" PRId64 ": %" PRIu64 " blocks\n", SG_manifest_get_file_id( &ctx->blocks ), SG_manifest_get_file_version( &ctx->blocks ), SG_manifest_get_block_count( &ctx->blocks ) );
+   
+   rc = md_wreq_init( &wreq, UG_read_prefetch_work, ctx, 0 );
+   if( rc != 0 ) {
+      
+      UG_read_prefetch_free( ctx );
+      return rc;
+   }
+   
+   rc = SG_gateway_io_start( gateway, &wreq );
+   if( rc != 0 ) {
+      
+      SG_error("SG_gateway_io_start rc = %d\n", rc );
+      UG_read_prefetch_free( ctx );
+      return rc;
+   }
+   
+   return 0;
+}
+
+
 // read a set of blocks from the cache, but optionally keep a tally of those that were *not* cached
 // every block in *blocks should be mapped to the read buffer
 // return 0 on success, and populate *blocks with the requested data and optionally *absent with data we didn't find.
@@ -972,6 +1553,10 @@ int UG_read_impl( struct fskit_core* core, struct fskit_route_metadata* route_me
    struct UG_dirty_block* last_block_read = NULL;
    UG_dirty_block_map_t::iterator last_block_read_itr;
    
+   uint64_t prefetch_start = 0;
+   uint64_t prefetch_end = 0;
+   struct UG_read_prefetch_ctx* prefetch = NULL;
+   
    struct SG_manifest blocks_to_download;
    memset( &blocks_to_download, 0, sizeof(struct SG_manifest) );
 
@@ -1183,7 +1768,23 @@ int UG_read_impl( struct fskit_core* core, struct fskit_route_metadata* route_me
       }
    }
    
+   // read ahead, if the reader is sequential
+   if( UG_read_prefetch_plan( fh, offset, buf_len, block_size, UG_inode_size( inode ), &prefetch_start, &prefetch_end ) ) {
+      prefetch = UG_read_prefetch_new( gateway, fs_path, inode, prefetch_start, prefetch_end, fh->prefetch_io_context );
+   }
+   
    fskit_entry_unlock( fent );
+   
+   if( prefetch != NULL ) {
+      
+      rc = UG_read_prefetch_start( gateway, prefetch );
+      if( rc != 0 ) {
+         
+         // not fatal
+         SG_error("UG_read_prefetch_start( %s ) rc = %d\n", fs_path, rc );
+         rc = 0;
+      }
+   }
 
 UG_read_impl_fail:
 
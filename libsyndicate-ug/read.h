@@ -25,6 +25,27 @@
 #include "inode.h"
 #include "core.h"
 
+// send a duplicate block request to another gateway once a request has taken longer than this percentile of its gateway's recent latencies
+#define UG_READ_HEDGE_PERCENTILE        95
+
+// need at least this many latency samples from a gateway before hedging its requests
+#define UG_READ_HEDGE_MIN_SAMPLES       16
+
+// never hedge a request sooner than this
+#define UG_READ_HEDGE_MIN_DELAY_MS      10
+
+// assumed latency of a gateway that has only ever failed
+#define UG_READ_FAILED_LATENCY_MS       10000
+
+// read-ahead window (in blocks) for a reader that just turned sequential
+#define UG_READ_PREFETCH_MIN_BLOCKS     2
+
+// largest read-ahead window (in blocks)
+#define UG_READ_PREFETCH_MAX_BLOCKS     32
+
+// room, beyond one volume block, in each direct download buffer for the signed block header (larger responses spill over)
+#define UG_READ_DIRECT_HEADER_SLACK     4096
+
 extern "C" {
    
 // set up a request for a block
@@ -45,6 +66,9 @@ int UG_read_dirty_blocks( struct SG_gateway* gateway, struct UG_inode* inode, UG
 // read locally-cached blocks 
 int UG_read_blocks_local( struct SG_gateway* gateway, char const* fs_path, struct UG_inode* inode, UG_dirty_block_map_t* blocks, uint64_t offset, uint64_t len, struct SG_manifest* blocks_not_local );
 
+// download blocks that are not available locally 
+int UG_read_blocks_remote( struct SG_gateway* gateway, char const* fs_path, struct SG_manifest* blocks_not_local, UG_dirty_block_map_t* blocks );
+
 // read individual blocks at once 
 int UG_read_blocks( struct SG_gateway* gateway, char const* fs_path, struct UG_inode* inode, UG_dirty_block_map_t* blocks, uint64_t offset, uint64_t len );
 
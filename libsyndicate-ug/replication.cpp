@@ -24,6 +24,30 @@
 #define REPLICA_IN_PROGRESS     1
 #define REPLICA_SUCCESS         2
 
+// per-stage fsync timing, across all files
+static struct UG_replica_stats UG_replica_stats_global;
+static pthread_mutex_t UG_replica_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// one contiguous range of the data-plane message
+struct UG_replica_dataplane_segment {
+
+   uint64_t offset;                     // offset of this segment in the data plane
+   uint64_t len;                        // length of this segment
+   int fd;                              // dup'ed fd to the flushed block, or -1 if the segment is in RAM
+   char* buf;                           // segment data, if in RAM (not owned)
+};
+
+// state for overlapping the MS update with the RG uploads in UG_replicate
+struct UG_replica_quorum_state {
+   
+   struct SG_gateway* gateway;
+   struct UG_replica_context* rctx;
+   struct timespec start;               // when the uploads began
+   bool ms_update;                      // if true, send the MS update as soon as we have a quorum
+   bool tried_ms_update;                // if true, we tried sending the MS update from the quorum callback
+   int ms_update_rc;                    // result of doing so
+};
+
 // snapshot of inode fields needed for replication and garbage collection 
 struct UG_replica_context {
   
@@ -31,8 +55,11 @@ struct UG_replica_context {
 
    char* fs_path;                       // path to the file to replicate
    SG_messages::Request* controlplane_request;  // control-plane component 
-   int dataplane_fd;                            // data-plane component
-   struct SG_chunk dataplane_mmap;              // mmap'ed data-plane component 
+   
+   struct SG_chunk dataplane_manifest;                  // serialized manifest (if we're the coordinator)
+   struct UG_replica_dataplane_segment* dataplane;      // data-plane component: the manifest and flushed blocks, in order
+   size_t num_dataplane_segments;                       // length of the above list
+   struct SG_client_stream dataplane_stream;            // data-plane stream, shared by all RG uploads
 
    struct md_entry inode_data;          // exported inode
    uint64_t* affected_blocks;           // block IDs affected by the write
@@ -334,34 +361,97 @@ UG_replica_context_make_controlplane_message_fail:
 }
 
 
+// read from the replica data plane, starting at offset.
+// stops at the end of the first segment it reads from, so each call does at most one pread.
+// return the number of bytes read (0 at EOF)
+// return -errno on read error
+static ssize_t UG_replica_dataplane_read( void* cls, char* buf, size_t len, uint64_t offset ) {
+
+   struct UG_replica_context* rctx = (struct UG_replica_context*)cls;
+   struct UG_replica_dataplane_segment* seg = NULL;
+   size_t lo = 0;
+   size_t hi = rctx->num_dataplane_segments;
+   uint64_t seg_off = 0;
+   ssize_t nr = 0;
+
+   // find the segment containing offset
+   while( lo < hi ) {
+
+      size_t mid = lo + (hi - lo) / 2;
+      if( rctx->dataplane[mid].offset + rctx->dataplane[mid].len <= offset ) {
+         lo = mid + 1;
+      }
+      else {
+         hi = mid;
+      }
+   }
+
+   if( lo >= rctx->num_dataplane_segments ) {
+
+      // EOF
+      return 0;
+   }
+
+   seg = &rctx->dataplane[lo];
+   seg_off = offset - seg->offset;
+   len = MIN( len, seg->len - seg_off );
+
+   if( seg->fd < 0 ) {
+
+      memcpy( buf, seg->buf + seg_off, len );
+      return len;
+   }
+
+   while( 1 ) {
+
+      nr = pread( seg->fd, buf, len, seg_off );
+      if( nr < 0 ) {
+
+         nr = -errno;
+         if( nr == -EINTR ) {
+            continue;
+         }
+
+         SG_error("pread(%d) rc = %zd\n", seg->fd, nr );
+      }
+      else if( nr == 0 ) {
+
+         // block got truncated out from under us
+         SG_error("pread(%d): unexpected EOF at %" PRIu64 "\n", seg->fd, seg_off );
+         nr = -ENODATA;
+      }
+
+      break;
+   }
+
+   return nr;
+}
+
+
 // create the replica data-plane message, using an already-initialized control-plane request.
-// write out the serialized data-plane message to disk, and add chunk information (size, offset, type) to the control-plane request.
+// the data plane is the manifest chunk (if given), followed by each flushed block.  It is streamed to the RGs straight from 
+// the manifest chunk and the flushed blocks' fds, so we just record where each piece comes from and add chunk information 
+// (size, offset, type) to the control-plane request.
 // NOTE: each block in flushed_blocks must be dirty and already flushed to disk (i.e. it must have a file descriptor)
-// return 0 on success, and populate the size and offset fields for each block in the control-plane request *request, and populate *dataplane_fd
+// NOTE: rctx takes ownership of manifest_chunk's data on success
+// return 0 on success, and populate the size and offset fields for each block in the control-plane request *request, and populate rctx's data plane
+// return -ENOMEM on OOM
 // return -errno on fs-related errors.
-// return -ENAMETOOLONG on temporary path overflow
-static int UG_replica_context_make_dataplane_message( struct UG_state* ug, SG_messages::Request* request, struct SG_chunk* manifest_chunk, UG_dirty_block_map_t* flushed_blocks, int* dataplane_fd ) {
+static int UG_replica_context_make_dataplane_message( struct UG_replica_context* rctx, struct UG_state* ug, SG_messages::Request* request, struct SG_chunk* manifest_chunk, UG_dirty_block_map_t* flushed_blocks ) {
 
    int rc = 0;
-   int fd = -1;
    int manifest_count = 0;
    uint64_t off = 0;
    struct SG_gateway* gateway = UG_state_gateway( ug );
-   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
-   char* data_root = md_conf_get_data_root( conf );
-   char tmppath[PATH_MAX];
    struct stat sb;
    SG_messages::ManifestBlock* block_info = NULL;
+   struct UG_replica_dataplane_segment* segments = NULL;
+   size_t num_segments = 0;
 
    if( manifest_chunk != NULL && manifest_chunk->data != NULL ) {
       manifest_count = 1;
    }
 
-   rc = snprintf( tmppath, PATH_MAX-1, "%s/.replica-XXXXXX", data_root );
-   if( rc >= PATH_MAX-1 ) {
-      return -ENAMETOOLONG;
-   }
-
    // sanity check: all blocks must exist in flushed_blocks and be flushed to disk (i.e. we need a file descriptor)
    // however, the first block_info in the controlplane message refers to the *manifest* chunk, so we will not consider it here.
    if( flushed_blocks != NULL ) {
@@ -397,24 +487,12 @@ static int UG_replica_context_make_dataplane_message( struct UG_state* ug, SG_me
       exit(1);
    }
 
-   // flush to disk
-   fd = mkostemp( tmppath, O_CLOEXEC );
-   if( fd < 0 ) {
-      rc = -errno;
-      
-      SG_error("mkostemp: %s\n", strerror(-rc));
-      goto UG_replica_context_make_dataplane_message_fail;
-   }
-
-   rc = unlink( tmppath );
-   if( rc < 0 ) {
-      rc = -errno;
-
-      SG_error("unlink(%s) rc = %d\n", tmppath, rc );
-      goto UG_replica_context_make_dataplane_message_fail;
+   segments = SG_CALLOC( struct UG_replica_dataplane_segment, request->blocks_size() );
+   if( segments == NULL ) {
+      return -ENOMEM;
    }
 
-   // flush manifest, if we're the coordinator  
+   // manifest, if we're the coordinator  
    if( manifest_count == 1 ) {
 
        // sanity check.... 
@@ -423,16 +501,12 @@ static int UG_replica_context_make_dataplane_message( struct UG_state* ug, SG_me
           exit(1);
        }
 
-       rc = md_write_uninterrupted( fd, manifest_chunk->data, manifest_chunk->len );
-       if( rc < 0 ) {
+       segments[num_segments].offset = 0;
+       segments[num_segments].len = manifest_chunk->len;
+       segments[num_segments].fd = -1;
+       segments[num_segments].buf = manifest_chunk->data;
+       num_segments++;
 
-          SG_error("md_write_uninterrupted rc = %d\n", rc );
-          goto UG_replica_context_make_dataplane_message_fail;
-       }
-       else {
-          rc = 0;
-       }
-   
        // put manifest chunk data 
        block_info = request->mutable_blocks(0);
        block_info->set_offset( 0 );
@@ -441,7 +515,7 @@ static int UG_replica_context_make_dataplane_message( struct UG_state* ug, SG_me
        off += manifest_chunk->len;
    }
 
-   // flush each block
+   // each block
    // NOTE: if we're the coordinator, blocks[0] should be the manifest info; blocks[1..n] are the block info
    // otherwise, blocks[0...n] are all blocks
    for( int i = (manifest_count); i < request->blocks_size(); i++ ) {
@@ -450,41 +524,57 @@ static int UG_replica_context_make_dataplane_message( struct UG_state* ug, SG_me
       struct UG_dirty_block* block = &(*flushed_blocks)[ block_info->block_id() ];
       int block_fd = UG_dirty_block_fd( block );
 
-      // fetch data from the serialized block on disk
+      // how big is the serialized on-disk block?
       rc = fstat( block_fd, &sb );
       if( rc != 0 ) {
          rc = -errno;
          SG_error("fstat(%d) rc = %d\n", block_fd, rc );
          goto UG_replica_context_make_dataplane_message_fail;
       }
+
+      // keep our own reference to it, since the dirty block can be freed while we replicate
+      segments[num_segments].fd = dup( block_fd );
+      if( segments[num_segments].fd < 0 ) {
+         rc = -errno;
+         SG_error("dup(%d) rc = %d\n", block_fd, rc );
+         goto UG_replica_context_make_dataplane_message_fail;
+      }
+
+      segments[num_segments].offset = off;
+      segments[num_segments].len = sb.st_size;
+      num_segments++;
       
       // extend with info
       block_info->set_offset( off );
       block_info->set_size( sb.st_size );
 
-      // transfer the serialized on-disk block chunk
-      rc = md_transfer( block_fd, fd, sb.st_size );
-      if( rc != 0 ) {
-
-         SG_error("md_transfer rc = %d\n", rc );
-         goto UG_replica_context_make_dataplane_message_fail;
-      }
-
       off += sb.st_size;
    }
 
    // success!
-   *dataplane_fd = fd;
+   if( manifest_count == 1 ) {
+      rctx->dataplane_manifest = *manifest_chunk;
+      memset( manifest_chunk, 0, sizeof(struct SG_chunk) );
+   }
+
+   rctx->dataplane = segments;
+   rctx->num_dataplane_segments = num_segments;
+
+   rctx->dataplane_stream.len = off;
+   rctx->dataplane_stream.read = UG_replica_dataplane_read;
+   rctx->dataplane_stream.cls = rctx;
    return 0;
 
 UG_replica_context_make_dataplane_message_fail:
 
    // clean up
-   if( fd >= 0 ) {
-      close( fd );
-      fd = -1;
+   for( size_t i = 0; i < num_segments; i++ ) {
+      if( segments[i].fd >= 0 ) {
+         close( segments[i].fd );
+      }
    }
 
+   SG_safe_free( segments );
    return rc;
 }
 
@@ -501,9 +591,6 @@ int UG_replica_context_init( struct UG_replica_context* rctx, struct UG_state* u
    int rc = 0;
    SG_messages::Request* controlplane = NULL;
    struct SG_chunk serialized_manifest;
-   int dataplane_fd = -1;
-   char* fd_buf = NULL;
-   struct stat sb;
    uint64_t* affected_blocks = NULL;
    size_t num_affected_blocks = 0;
    struct SG_gateway* gateway = UG_state_gateway( ug );
@@ -601,7 +688,7 @@ int UG_replica_context_init( struct UG_replica_context* rctx, struct UG_state* u
    }
 
    // make data-plane component
-   rc = UG_replica_context_make_dataplane_message( ug, controlplane, &serialized_manifest, flushed_blocks, &dataplane_fd );
+   rc = UG_replica_context_make_dataplane_message( rctx, ug, controlplane, &serialized_manifest, flushed_blocks );
    SG_chunk_free( &serialized_manifest );
    if( rc != 0 ) {
 
@@ -622,29 +709,7 @@ int UG_replica_context_init( struct UG_replica_context* rctx, struct UG_state* u
       return rc;
    }
 
-   rctx->dataplane_fd = dataplane_fd;
    rctx->controlplane_request = controlplane;
-
-   // mmap data-plane component so we can send it 
-   rc = fstat( dataplane_fd, &sb );
-   if( rc != 0 ) {
-
-      rc = -errno;
-      UG_replica_context_free( rctx );
-      SG_error("fstat: %s\n", strerror(-rc) );
-      return rc;
-   }
-
-   fd_buf = (char*)mmap( NULL, sb.st_size, PROT_READ, MAP_SHARED, dataplane_fd, 0 );
-   if( fd_buf == MAP_FAILED ) {
-
-      rc = -errno;
-      UG_replica_context_free( rctx );
-      SG_error("mmap: %s\n", strerror(-rc) );
-      return rc;
-   }
-
-   SG_chunk_init( &rctx->dataplane_mmap, fd_buf, sb.st_size );
    return rc;
 }
 
@@ -660,16 +725,40 @@ int UG_replica_context_free( struct UG_replica_context* rctx ) {
    UG_RG_context_free( rctx->rg_context );
    SG_safe_free( rctx->rg_context );
    SG_safe_free( rctx->affected_blocks );
-   if( rctx->dataplane_fd >= 0 ) {
-      close( rctx->dataplane_fd );
-      rctx->dataplane_fd = -1;
+   
+   for( size_t i = 0; i < rctx->num_dataplane_segments; i++ ) {
+      if( rctx->dataplane[i].fd >= 0 ) {
+         close( rctx->dataplane[i].fd );
+      }
    }
+   SG_safe_free( rctx->dataplane );
+   SG_chunk_free( &rctx->dataplane_manifest );
    
    memset( rctx, 0, sizeof(struct UG_replica_context) );
    
    return 0;
 }
 
+// set up the vacuum log entry for a replica context's write 
+// return 0 on success
+// return -ENOMEM on OOM
+static int UG_replica_context_vacuum_entry( struct SG_gateway* gateway, struct UG_replica_context* rctx, struct ms_vacuum_entry* ve ) {
+   
+   int rc = 0;
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   
+   rc = ms_client_vacuum_entry_init( ve, rctx->inode_data.volume, ms_client_get_gateway_id( ms ), rctx->inode_data.file_id, rctx->inode_data.version,
+                                     rctx->inode_data.manifest_mtime_sec, rctx->inode_data.manifest_mtime_nsec, rctx->affected_blocks, rctx->num_affected_blocks );
+   
+   if( rc != 0 ) {
+      
+      SG_error("ms_client_vacuum_entry_init( %" PRIX64 ".%" PRId64 " (%zu blocks) ) rc = %d\n", rctx->inode_data.file_id, rctx->inode_data.version, rctx->num_affected_blocks, rc );
+   }
+   
+   return rc;
+}
+
+
 // append a file's vacuum log on the MS
 // does *NOT* set rctx->sent_vacuum_log
 // return 0 on success
@@ -682,12 +771,9 @@ static int UG_replicate_vacuum_log( struct SG_gateway* gateway, struct UG_replic
    struct ms_client* ms = SG_gateway_ms( gateway );
    
    // set up the vacuum entry
-   rc = ms_client_vacuum_entry_init( &ve, rctx->inode_data.volume, ms_client_get_gateway_id( ms ), rctx->inode_data.file_id, rctx->inode_data.version,
-                                     rctx->inode_data.manifest_mtime_sec, rctx->inode_data.manifest_mtime_nsec, rctx->affected_blocks, rctx->num_affected_blocks );
-   
+   rc = UG_replica_context_vacuum_entry( gateway, rctx, &ve );
    if( rc != 0 ) {
       
-      SG_error("ms_client_vacuum_entry_init( %" PRIX64 ".%" PRId64 " (%zu blocks) ) rc = %d\n", rctx->inode_data.file_id, rctx->inode_data.version, rctx->num_affected_blocks, rc );
       return rc;
    }
     
@@ -704,11 +790,137 @@ static int UG_replicate_vacuum_log( struct SG_gateway* gateway, struct UG_replic
 }
 
 
+// how many RGs must have a file's data before we can tell the MS about it?
+// return the configured write quorum, clamped to the number of RGs (0 or too many means all of them)
+static size_t UG_replica_context_write_quorum( struct SG_gateway* gateway, struct UG_replica_context* rctx ) {
+   
+   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   size_t num_rgs = UG_RG_context_num_RGs( rctx->rg_context );
+   
+   if( conf->replica_write_quorum <= 0 || (unsigned)conf->replica_write_quorum > num_rgs ) {
+      return num_rgs;
+   }
+   
+   return conf->replica_write_quorum;
+}
+
+
+// did enough RGs acknowledge the last upload to consider the blocks and manifest replicated?
+static bool UG_replica_context_has_quorum( struct SG_gateway* gateway, struct UG_replica_context* rctx ) {
+   
+   return UG_RG_context_num_succeeded( rctx->rg_context ) >= UG_replica_context_write_quorum( gateway, rctx );
+}
+
+
+// make the inode update to send once a replica context's blocks and manifest have been replicated
+// return the write data on success (free with SG_safe_free)
+// return NULL on OOM
+static struct SG_client_WRITE_data* UG_replica_context_write_data( struct SG_gateway* gateway, struct UG_replica_context* rctx ) {
+   
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   uint64_t volume_id = ms_client_get_volume_id( ms );
+   struct SG_client_WRITE_data* write_data = SG_client_WRITE_data_new();
+   struct timespec mtime;
+   
+   if( write_data == NULL ) {
+      return NULL;
+   }
+   
+   mtime.tv_sec = rctx->inode_data.mtime_sec;
+   mtime.tv_nsec = rctx->inode_data.mtime_nsec;
+   
+   SG_client_WRITE_data_init( write_data );
+   SG_client_WRITE_data_set_mtime( write_data, &mtime );
+   SG_client_WRITE_data_set_write_delta( write_data, &rctx->write_delta );
+   SG_client_WRITE_data_set_routing_info( write_data, volume_id, rctx->inode_data.coordinator, rctx->inode_data.file_id, rctx->inode_data.version );
+   
+   return write_data;
+}
+
+
+// send a replica context's new inode metadata to the MS if we're the coordinator, or to the coordinator otherwise.
+// sets rctx->sent_ms_update on success.
+// return 0 on success
+// return -ENOMEM on OOM 
+// return other -errno on failure (see UG_update)
+static int UG_replicate_ms_update( struct SG_gateway* gateway, struct UG_replica_context* rctx ) {
+   
+   int rc = 0;
+   struct timespec start, end;
+   struct SG_client_WRITE_data* write_data = NULL;
+   
+   SG_debug("%" PRIX64 ": begin sending MS updates\n", rctx->inode_data.file_id );
+   
+   clock_gettime( CLOCK_MONOTONIC, &start );
+
+   write_data = UG_replica_context_write_data( gateway, rctx );
+   if( write_data == NULL ) {
+       return -ENOMEM;
+   }
+  
+   // NOTE: this could turn us into the coordinator 
+   rc = UG_update( rctx->state, rctx->fs_path, write_data );
+   if( rc != 0 ) {
+       
+      SG_error("UG_update('%s') rc = %d\n", rctx->fs_path, rc );
+   }
+   else {
+
+      rctx->sent_ms_update = true;
+      SG_debug("%" PRIX64 ": sent MS updates!\n", rctx->inode_data.file_id );
+   }
+   
+   SG_safe_free( write_data );
+   
+   clock_gettime( CLOCK_MONOTONIC, &end );
+   UG_replica_stats_record( UG_REPLICA_STAGE_MS_UPDATE, &start, &end );
+   
+   return rc;
+}
+
+
+// called once a write quorum of RGs has a file's blocks and manifest.
+// time the quorum, and if we only need a quorum, send the MS update now while the other RGs finish.
+// always succeeds; the MS update's result is recorded in the quorum state
+static int UG_replicate_on_quorum( struct UG_RG_context* rg_context, size_t request_idx, void* cls ) {
+   
+   struct UG_replica_quorum_state* qs = (struct UG_replica_quorum_state*)cls;
+   struct timespec now;
+   
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   UG_replica_stats_record( UG_REPLICA_STAGE_RG_QUORUM, &qs->start, &now );
+   
+   if( qs->ms_update && !qs->rctx->sent_ms_update ) {
+      
+      qs->tried_ms_update = true;
+      qs->ms_update_rc = UG_replicate_ms_update( qs->gateway, qs->rctx );
+   }
+   
+   return 0;
+}
+
+
+// called once a write quorum of RGs has one file's blocks and manifest in a batch.
+// just time the quorum
+static int UG_replicate_multi_on_quorum( struct UG_RG_context* rg_context, size_t request_idx, void* cls ) {
+   
+   struct timespec* start = (struct timespec*)cls;
+   struct timespec now;
+   
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   UG_replica_stats_record( UG_REPLICA_STAGE_RG_QUORUM, start, &now );
+   
+   return 0;
+}
+
+
 // replicate the blocks and manifest to a given gateway.
 // (0) make sure all blocks are flushed to disk cache
 // (1) if we're the coordinator, append to this file's vacuum log on the MS 
 // (2) replicate the blocks and manifest to each replica gateway
 // (3) if we're the coordinator, send the new inode information to the MS
+// if a write quorum smaller than the number of RGs is configured, (3) starts as soon as that many RGs have acknowledged (2), and (2) succeeds once 
+// they have, even if other RGs fail.
 // free up blocks and manifest information as they succeed, so the caller can try a different gateway on a subsequent call resulting from a partial replication failure.
 // return 0 on success
 // return -EIO if this method failed to flush data to disk
@@ -722,15 +934,20 @@ static int UG_replicate_vacuum_log( struct SG_gateway* gateway, struct UG_replic
 int UG_replicate( struct SG_gateway* gateway, struct UG_replica_context* rctx ) {
    
    int rc = 0;
-   struct ms_client* ms = SG_gateway_ms( gateway );
-   uint64_t volume_id = ms_client_get_volume_id( ms );
+   struct timespec start, end;
       
    // (1) make sure the MS knows about this replication request
    if( !rctx->sent_vacuum_log ) {
       
       SG_debug("%" PRIX64 ": begin replicating vacuum log\n", rctx->inode_data.file_id );
 
+      clock_gettime( CLOCK_MONOTONIC, &start );
+      
       rc = UG_replicate_vacuum_log( gateway, rctx );
+      
+      clock_gettime( CLOCK_MONOTONIC, &end );
+      UG_replica_stats_record( UG_REPLICA_STAGE_VACUUM_LOG, &start, &end );
+      
       if( rc != 0 ) {
          
          SG_error("UG_replicate_vacuum_log( %" PRIX64 ".%" PRId64 " (%s) ) rc = %d\n", rctx->inode_data.file_id, rctx->inode_data.version, rctx->fs_path, rc );
@@ -755,20 +972,52 @@ int UG_replicate( struct SG_gateway* gateway, struct UG_replica_context* rctx )
    // (2) replicate the manifest and each block to each replica gateway
    if( !rctx->replicated_blocks ) {
       
+      struct UG_replica_quorum_state qs;
+      struct SG_client_stream* dataplane = &rctx->dataplane_stream;
+      int send_rc = 0;
+      
+      memset( &qs, 0, sizeof(struct UG_replica_quorum_state) );
+      qs.gateway = gateway;
+      qs.rctx = rctx;
+      qs.ms_update = ( UG_replica_context_write_quorum( gateway, rctx ) < UG_RG_context_num_RGs( rctx->rg_context ) );
+      
       SG_debug("%" PRIX64 ": begin replicating manifest and blocks\n", rctx->inode_data.file_id );
 
-      // send off to all RGs
-      rc = UG_RG_send_all( gateway, rctx->rg_context, rctx->controlplane_request, &rctx->dataplane_mmap );
-      if( rc != 0 ) {
+      clock_gettime( CLOCK_MONOTONIC, &qs.start );
+      
+      // send off to all RGs, and do (3) once a write quorum has it
+      rc = UG_RG_send_all_multi_ex( gateway, &rctx->rg_context, &rctx->controlplane_request, &dataplane, 1, 
+                                    UG_replica_context_write_quorum( gateway, rctx ), UG_replicate_on_quorum, &qs, &send_rc );
+      
+      clock_gettime( CLOCK_MONOTONIC, &end );
+      UG_replica_stats_record( UG_REPLICA_STAGE_RG_ALL, &qs.start, &end );
+      
+      if( rc == -ENOMEM ) {
+         
+         return rc;
+      }
+      
+      if( rc != 0 && !UG_replica_context_has_quorum( gateway, rctx ) ) {
          
          SG_error("UG_RG_send_all() rc = %d\n", rc );
          
          return rc;
       }
-      else {
+      
+      if( rc != 0 ) {
+         
+         SG_warn("%" PRIX64 ": replicated to %zu of %zu RGs (write quorum is %zu)\n", rctx->inode_data.file_id,
+                 UG_RG_context_num_succeeded( rctx->rg_context ), UG_RG_context_num_RGs( rctx->rg_context ), UG_replica_context_write_quorum( gateway, rctx ) );
+         rc = 0;
+      }
+      
+      rctx->replicated_blocks = true;
+      SG_debug("%" PRIX64 ": replicated manifest and blocks!\n", rctx->inode_data.file_id );
+      
+      if( qs.tried_ms_update && qs.ms_update_rc != 0 ) {
          
-         rctx->replicated_blocks = true;
-         SG_debug("%" PRIX64 ": replicated manifest and blocks!\n", rctx->inode_data.file_id );
+         // already tried (3), and it failed 
+         return qs.ms_update_rc;
       }
    }
    
@@ -776,41 +1025,246 @@ int UG_replicate( struct SG_gateway* gateway, struct UG_replica_context* rctx )
    // or send it to the coordinator directly.
    if( !rctx->sent_ms_update ) {
       
-      SG_debug("%" PRIX64 ": begin sending MS updates\n", rctx->inode_data.file_id );
+      rc = UG_replicate_ms_update( gateway, rctx );
+   }
 
-      // send it to the MS if we're the coordinator, 
-      // or send it to the coordinator itself.
-      struct SG_client_WRITE_data* write_data = SG_client_WRITE_data_new();
-      struct timespec mtime;
+   // done!
+   return rc;
+}
+
+
+// replicate a batch of files at once (i.e. for a group commit).
+// this runs the same stages as UG_replicate on each replica context, but each stage is run for the whole batch before the next:
+// (1) the vacuum log entries are appended to the MS in as few requests as possible
+// (2) the manifests and blocks are sent to all RGs concurrently, over one download loop
+// (3) the inode updates for the files we coordinate are sent to the MS in as few requests as possible 
+// a file only advances to the next stage if it completed the previous one (a write quorum of RGs counts as completing (2)), so each file's durability 
+// guarantees are the same as with UG_replicate.
+// rcs[i] is set to what UG_replicate would have returned for rctxs[i], so the caller can retry or restore each file individually.
+// return 0 if every file was replicated
+// return -EIO if at least one file was not (check rcs)
+// return -ENOMEM on OOM
+int UG_replicate_multi( struct SG_gateway* gateway, struct UG_replica_context** rctxs, size_t num_rctxs, int* rcs ) {
+   
+   int rc = 0;
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   
+   // per-stage scratch space, indexed by position in the stage
+   struct ms_vacuum_entry* ves = SG_CALLOC( struct ms_vacuum_entry, num_rctxs );
+   struct UG_RG_context** rg_contexts = SG_CALLOC( struct UG_RG_context*, num_rctxs );
+   SG_messages::Request** controlplane_requests = SG_CALLOC( SG_messages::Request*, num_rctxs );
+   struct SG_client_stream** dataplane_streams = SG_CALLOC( struct SG_client_stream*, num_rctxs );
+   struct SG_client_WRITE_data** write_datas = SG_CALLOC( struct SG_client_WRITE_data*, num_rctxs );
+   char const** paths = SG_CALLOC( char const*, num_rctxs );
+   int* stage_rcs = SG_CALLOC( int, num_rctxs );
+   size_t* idxs = SG_CALLOC( size_t, num_rctxs );
+   size_t num_stage = 0;
+   size_t quorum = SG_gateway_conf( gateway )->replica_write_quorum;
+   struct timespec start, end;
+   
+   if( ves == NULL || rg_contexts == NULL || controlplane_requests == NULL || dataplane_streams == NULL || write_datas == NULL || paths == NULL || stage_rcs == NULL || idxs == NULL ) {
       
-      if( write_data == NULL ) {
-          return -ENOMEM;
+      rc = -ENOMEM;
+      goto UG_replicate_multi_out;
+   }
+   
+   for( size_t i = 0; i < num_rctxs; i++ ) {
+      rcs[i] = 0;
+   }
+   
+   // (1) make sure the MS knows about these replication requests
+   for( size_t i = 0; i < num_rctxs; i++ ) {
+      
+      if( rctxs[i]->sent_vacuum_log ) {
+         continue;
       }
       
-      mtime.tv_sec = rctx->inode_data.mtime_sec;
-      mtime.tv_nsec = rctx->inode_data.mtime_nsec;
+      rc = UG_replica_context_vacuum_entry( gateway, rctxs[i], &ves[num_stage] );
+      if( rc != 0 ) {
+         
+         // free the ones we set up 
+         for( size_t j = 0; j < num_stage; j++ ) {
+            ms_client_vacuum_entry_free( &ves[j] );
+         }
+         
+         goto UG_replicate_multi_out;
+      }
+      
+      idxs[num_stage] = i;
+      num_stage++;
+   }
+   
+   if( num_stage > 0 ) {
+      
+      SG_debug("begin replicating %zu vacuum logs\n", num_stage );
+      
+      clock_gettime( CLOCK_MONOTONIC, &start );
+      
+      rc = ms_client_append_vacuum_log_entries( ms, ves, num_stage, stage_rcs );
+      
+      clock_gettime( CLOCK_MONOTONIC, &end );
+      UG_replica_stats_record( UG_REPLICA_STAGE_VACUUM_LOG, &start, &end );
       
-      SG_client_WRITE_data_init( write_data );
-      SG_client_WRITE_data_set_mtime( write_data, &mtime );
-      SG_client_WRITE_data_set_write_delta( write_data, &rctx->write_delta );
-      SG_client_WRITE_data_set_routing_info( write_data, volume_id, rctx->inode_data.coordinator, rctx->inode_data.file_id, rctx->inode_data.version );
-     
-      // NOTE: this could turn us into the coordinator 
-      rc = UG_update( rctx->state, rctx->fs_path, write_data );
       if( rc != 0 ) {
-          
-         SG_error("UG_update('%s') rc = %d\n", rctx->fs_path, rc );
+         
+         // unsent entries have stage_rcs[j] == -EAGAIN
+         SG_error("ms_client_append_vacuum_log_entries(%zu entries) rc = %d\n", num_stage, rc );
       }
-      else {
-
-         rctx->sent_ms_update = true;
-         SG_debug("%" PRIX64 ": sent MS updates!\n", rctx->inode_data.file_id );
+      
+      if( rc == -ENOMEM ) {
+         
+         // fail the whole batch 
+         for( size_t j = 0; j < num_stage; j++ ) {
+            ms_client_vacuum_entry_free( &ves[j] );
+         }
+         
+         goto UG_replicate_multi_out;
+      }
+      
+      rc = 0;
+      for( size_t j = 0; j < num_stage; j++ ) {
+         
+         struct UG_replica_context* rctx = rctxs[ idxs[j] ];
+         
+         ms_client_vacuum_entry_free( &ves[j] );
+         
+         if( stage_rcs[j] != 0 ) {
+            
+            SG_error("Append vacuum log for %" PRIX64 ".%" PRId64 " (%s) rc = %d\n", rctx->inode_data.file_id, rctx->inode_data.version, rctx->fs_path, stage_rcs[j] );
+            
+            // same as UG_replicate 
+            rcs[ idxs[j] ] = -EAGAIN;
+         }
+         else {
+            
+            rctx->sent_vacuum_log = true;
+         }
+      }
+   }
+   
+   // (2) replicate the manifests and blocks to each replica gateway
+   num_stage = 0;
+   for( size_t i = 0; i < num_rctxs; i++ ) {
+      
+      if( rcs[i] != 0 || rctxs[i]->replicated_blocks ) {
+         continue;
+      }
+      
+      rg_contexts[num_stage] = rctxs[i]->rg_context;
+      controlplane_requests[num_stage] = rctxs[i]->controlplane_request;
+      dataplane_streams[num_stage] = &rctxs[i]->dataplane_stream;
+      idxs[num_stage] = i;
+      num_stage++;
+   }
+   
+   if( num_stage > 0 ) {
+      
+      SG_debug("begin replicating manifests and blocks for %zu files\n", num_stage );
+      
+      clock_gettime( CLOCK_MONOTONIC, &start );
+      
+      rc = UG_RG_send_all_multi_ex( gateway, rg_contexts, controlplane_requests, dataplane_streams, num_stage, quorum, UG_replicate_multi_on_quorum, &start, stage_rcs );
+      
+      clock_gettime( CLOCK_MONOTONIC, &end );
+      UG_replica_stats_record( UG_REPLICA_STAGE_RG_ALL, &start, &end );
+      
+      if( rc == -ENOMEM ) {
+         
+         goto UG_replicate_multi_out;
+      }
+      
+      rc = 0;
+      for( size_t j = 0; j < num_stage; j++ ) {
+         
+         struct UG_replica_context* rctx = rctxs[ idxs[j] ];
+         
+         if( stage_rcs[j] != 0 && !UG_replica_context_has_quorum( gateway, rctx ) ) {
+            
+            SG_error("Replicate %" PRIX64 ".%" PRId64 " (%s) rc = %d\n", rctx->inode_data.file_id, rctx->inode_data.version, rctx->fs_path, stage_rcs[j] );
+            rcs[ idxs[j] ] = stage_rcs[j];
+         }
+         else {
+            
+            rctx->replicated_blocks = true;
+         }
+      }
+   }
+   
+   // (3) update the records on the MS
+   num_stage = 0;
+   for( size_t i = 0; i < num_rctxs; i++ ) {
+      
+      if( rcs[i] != 0 || rctxs[i]->sent_ms_update ) {
+         continue;
+      }
+      
+      write_datas[num_stage] = UG_replica_context_write_data( gateway, rctxs[i] );
+      if( write_datas[num_stage] == NULL ) {
+         
+         rc = -ENOMEM;
+         goto UG_replicate_multi_out;
       }
       
-      SG_safe_free( write_data );
+      paths[num_stage] = rctxs[i]->fs_path;
+      idxs[num_stage] = i;
+      num_stage++;
    }
+   
+   if( num_stage > 0 ) {
+      
+      SG_debug("begin sending MS updates for %zu files\n", num_stage );
+      
+      clock_gettime( CLOCK_MONOTONIC, &start );
+      
+      // NOTE: this could turn us into the coordinator of some of these files
+      rc = UG_update_multi( rctxs[ idxs[0] ]->state, paths, write_datas, num_stage, stage_rcs );
+      
+      clock_gettime( CLOCK_MONOTONIC, &end );
+      UG_replica_stats_record( UG_REPLICA_STAGE_MS_UPDATE, &start, &end );
+      
+      if( rc == -ENOMEM ) {
+         
+         goto UG_replicate_multi_out;
+      }
+      
+      rc = 0;
+      for( size_t j = 0; j < num_stage; j++ ) {
+         
+         if( stage_rcs[j] != 0 ) {
+            
+            rcs[ idxs[j] ] = stage_rcs[j];
+         }
+         else {
+            
+            rctxs[ idxs[j] ]->sent_ms_update = true;
+         }
+      }
+   }
+   
+   for( size_t i = 0; i < num_rctxs; i++ ) {
+      
+      if( rcs[i] != 0 ) {
+         rc = -EIO;
+      }
+   }
+   
+UG_replicate_multi_out:
 
-   // done!
+   if( write_datas != NULL ) {
+      for( size_t j = 0; j < num_rctxs; j++ ) {
+         SG_safe_free( write_datas[j] );
+      }
+   }
+   
+   SG_safe_free( ves );
+   SG_safe_free( rg_contexts );
+   SG_safe_free( controlplane_requests );
+   SG_safe_free( dataplane_streams );
+   SG_safe_free( write_datas );
+   SG_safe_free( paths );
+   SG_safe_free( stage_rcs );
+   SG_safe_free( idxs );
+   
    return rc;
 }
 
@@ -836,3 +1290,123 @@ int UG_replica_context_hint( struct UG_replica_context* rctx, uint64_t flags ) {
 
    return 0;
 }
+
+
+// record how long one fsync stage took 
+// return 0 on success
+// return -EINVAL if the stage is not known
+int UG_replica_stats_record( int stage, struct timespec* start, struct timespec* end ) {
+   
+   int64_t us = 0;
+   int64_t b_us = 0;
+   int b = 0;
+   struct UG_replica_stage_stats* stage_stats = NULL;
+   
+   if( stage < 0 || stage >= UG_REPLICA_NUM_STAGES ) {
+      return -EINVAL;
+   }
+   
+   us = md_timespec_diff( end, start ) / 1000;
+   if( us < 0 ) {
+      us = 0;
+   }
+   
+   // find the bucket
+   for( b_us = us; b_us >= 2 && b < UG_REPLICA_HISTOGRAM_BUCKETS - 1; b_us >>= 1 ) {
+      b++;
+   }
+   
+   pthread_mutex_lock( &UG_replica_stats_lock );
+   
+   stage_stats = &UG_replica_stats_global.stages[ stage ];
+   stage_stats->count++;
+   stage_stats->total_us += us;
+   stage_stats->max_us = MAX( stage_stats->max_us, us );
+   stage_stats->buckets[b]++;
+   
+   pthread_mutex_unlock( &UG_replica_stats_lock );
+   
+   return 0;
+}
+
+
+// get a copy of the fsync stage timings 
+// always succeeds
+int UG_replica_stats_get( struct UG_replica_stats* stats ) {
+   
+   pthread_mutex_lock( &UG_replica_stats_lock );
+   
+   *stats = UG_replica_stats_global;
+   
+   pthread_mutex_unlock( &UG_replica_stats_lock );
+   
+   return 0;
+}
+
+
+// get the upper bound, in microseconds, of the histogram bucket containing the given percentile of a stage's samples
+static int64_t UG_replica_stage_stats_percentile( struct UG_replica_stage_stats* stage_stats, int percentile ) {
+   
+   uint64_t seen = 0;
+   uint64_t target = (stage_stats->count * percentile + 99) / 100;
+   
+   for( int b = 0; b < UG_REPLICA_HISTOGRAM_BUCKETS; b++ ) {
+      
+      seen += stage_stats->buckets[b];
+      if( seen >= target ) {
+         
+         return MIN( (int64_t)1 << (b + 1), stage_stats->max_us );
+      }
+   }
+   
+   return stage_stats->max_us;
+}
+
+
+// log the fsync stage timings, so we can see where fsync time goes
+void UG_replica_stats_log(void) {
+   
+   static char const* stage_names[ UG_REPLICA_NUM_STAGES ] = {
+      "flush",
+      "snapshot",
+      "vacuum-log",
+      "rg-quorum",
+      "rg-all",
+      "ms-update",
+      "fsync"
+   };
+   
+   struct UG_replica_stats stats;
+   char histogram[ UG_REPLICA_HISTOGRAM_BUCKETS * 24 + 1 ];
+   size_t off = 0;
+   
+   UG_replica_stats_get( &stats );
+   
+   for( int i = 0; i < UG_REPLICA_NUM_STAGES; i++ ) {
+      
+      struct UG_replica_stage_stats* stage_stats = &stats.stages[i];
+      
+      if( stage_stats->count == 0 ) {
+         continue;
+      }
+      
+      // non-empty buckets, as <upper bound in us>:<count>
+      off = 0;
+      histogram[0] = '\0';
+      for( int b = 0; b < UG_REPLICA_HISTOGRAM_BUCKETS; b++ ) {
+         
+         if( stage_stats->buckets[b] == 0 ) {
+            continue;
+         }
+         
+         off += snprintf( histogram + off, sizeof(histogram) - off, " <%" PRId64 ":%" PRIu64, (int64_t)1 << (b + 1), stage_stats->buckets[b] );
+         if( off >= sizeof(histogram) ) {
+            break;
+         }
+      }
+      
+      SG_info("fsync stage %s: n=%" PRIu64 " avg=%" PRId64 "us p50<=%" PRId64 "us p99<=%" PRId64 "us max=%" PRId64 "us histogram(us):%s\n",
+              stage_names[i], stage_stats->count, stage_stats->total_us / (int64_t)stage_stats->count,
+              UG_replica_stage_stats_percentile( stage_stats, 50 ), UG_replica_stage_stats_percentile( stage_stats, 99 ), stage_stats->max_us, histogram );
+   }
+}
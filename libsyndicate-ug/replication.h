@@ -34,6 +34,33 @@ struct UG_replica_context;
 #define UG_REPLICA_HINT_NO_RG_BLOCKS      0x2
 #define UG_REPLICA_HINT_NO_MS_VACUUM      0x4
 
+// fsync stages, for timing
+#define UG_REPLICA_STAGE_FLUSH            0     // flush dirty blocks to the disk cache
+#define UG_REPLICA_STAGE_SNAPSHOT         1     // snapshot the inode, and serialize and sign the manifest and block list
+#define UG_REPLICA_STAGE_VACUUM_LOG       2     // append to the file's vacuum log on the MS
+#define UG_REPLICA_STAGE_RG_QUORUM        3     // upload until a write quorum of RGs has the data
+#define UG_REPLICA_STAGE_RG_ALL           4     // upload until every RG has finished
+#define UG_REPLICA_STAGE_MS_UPDATE        5     // send the new inode metadata to the MS (or coordinator)
+#define UG_REPLICA_STAGE_FSYNC            6     // the whole fsync
+#define UG_REPLICA_NUM_STAGES             7
+
+// bucket b counts durations in [2^b, 2^(b+1)) microseconds (bucket 0 also counts shorter ones, and the last bucket counts all longer ones)
+#define UG_REPLICA_HISTOGRAM_BUCKETS      26
+
+// timing histogram for one fsync stage 
+struct UG_replica_stage_stats {
+   
+   uint64_t count;                                      // number of samples 
+   int64_t total_us;                                    // sum of all samples
+   int64_t max_us;                                      // longest sample 
+   uint64_t buckets[ UG_REPLICA_HISTOGRAM_BUCKETS ];    // log2 histogram of samples
+};
+
+struct UG_replica_stats {
+   
+   struct UG_replica_stage_stats stages[ UG_REPLICA_NUM_STAGES ];
+};
+
 extern "C" {
    
 // context setup/teardown
@@ -44,10 +71,16 @@ int UG_replica_context_free( struct UG_replica_context* rctx );
 
 // send a manifest and a of dirty blocks to a given gateway
 int UG_replicate( struct SG_gateway* gateway, struct UG_replica_context* rctx );
+int UG_replicate_multi( struct SG_gateway* gateway, struct UG_replica_context** rctxs, size_t num_rctxs, int* rcs );
 
 // control replication state 
 int UG_replica_context_hint( struct UG_replica_context* rctx, uint64_t flags );
 
+// per-stage timing 
+int UG_replica_stats_record( int stage, struct timespec* start, struct timespec* end );
+int UG_replica_stats_get( struct UG_replica_stats* stats );
+void UG_replica_stats_log(void);
+
 }
 
 #endif
@@ -22,6 +22,23 @@
 #include "inode.h"
 #include "core.h"
 
+// group committer state
+struct UG_sync_committer {
+   
+   pthread_t thread;                    // committer thread 
+   
+   UG_sync_commit_queue_t* pending;     // fsyncs waiting to be committed 
+   pthread_mutex_t lock;                // lock governing access to pending and running
+   
+   sem_t sem;                           // posted once per pending fsync, and on stop
+   
+   int64_t window_ms;                   // how long to wait for more fsyncs once one arrives 
+   
+   volatile bool running;               // is the thread running?
+   
+   struct SG_gateway* gateway;          // parent gateway
+};
+
 // begin flushing an inode's in-RAM dirty blocks to disk, asynchronously.
 // fails fast, in which case some (but not all) of the blocks in dirty_blocks are written.  The caller should call UG_write_blocks_wait() on failure, before cleaning up.
 // However, this method is also idempotent--it can be called multiple times on the same dirty_blocks, and each block will flush to disk cache at most once.
@@ -217,6 +234,252 @@ int UG_sync_context_free( struct UG_sync_context* sctx ) {
    return 0;
 }
 
+struct UG_sync_committer* UG_sync_committer_new() {
+   return SG_CALLOC( struct UG_sync_committer, 1 );
+}
+
+
+// set up a group committer, which will wait up to window_ms for other fsyncs to join one before replicating them together.
+// return 0 on success
+// return -ENOMEM on OOM
+int UG_sync_committer_init( struct UG_sync_committer* committer, struct SG_gateway* gateway, int64_t window_ms ) {
+   
+   int rc = 0;
+   
+   memset( committer, 0, sizeof(struct UG_sync_committer) );
+   
+   committer->pending = SG_safe_new( UG_sync_commit_queue_t() );
+   if( committer->pending == NULL ) {
+      return -ENOMEM;
+   }
+   
+   rc = pthread_mutex_init( &committer->lock, NULL );
+   if( rc != 0 ) {
+      
+      SG_safe_delete( committer->pending );
+      return -ENOMEM;
+   }
+   
+   sem_init( &committer->sem, 0, 0 );
+   
+   committer->window_ms = window_ms;
+   committer->gateway = gateway;
+   
+   return 0;
+}
+
+
+// replicate up to UG_SYNC_GROUP_COMMIT_MAX_BATCH pending fsyncs, and wake up their callers.
+// always succeeds; each caller gets its own file's result in its sync context.
+static int UG_sync_committer_run_batch( struct UG_sync_committer* committer ) {
+   
+   int rc = 0;
+   struct UG_sync_context* batch[ UG_SYNC_GROUP_COMMIT_MAX_BATCH ];
+   struct UG_replica_context* rctxs[ UG_SYNC_GROUP_COMMIT_MAX_BATCH ];
+   int rcs[ UG_SYNC_GROUP_COMMIT_MAX_BATCH ];
+   size_t num_batch = 0;
+   
+   pthread_mutex_lock( &committer->lock );
+   
+   while( committer->pending->size() > 0 && num_batch < UG_SYNC_GROUP_COMMIT_MAX_BATCH ) {
+      
+      batch[num_batch] = committer->pending->front();
+      rctxs[num_batch] = batch[num_batch]->rctx;
+      committer->pending->pop_front();
+      
+      num_batch++;
+   }
+   
+   pthread_mutex_unlock( &committer->lock );
+   
+   if( num_batch == 0 ) {
+      return 0;
+   }
+   
+   SG_debug("Group commit %zu fsyncs\n", num_batch );
+   
+   rc = UG_replicate_multi( committer->gateway, rctxs, num_batch, rcs );
+   if( rc != 0 ) {
+      
+      SG_error("UG_replicate_multi(%zu files) rc = %d\n", num_batch, rc );
+   }
+   
+   for( size_t i = 0; i < num_batch; i++ ) {
+      
+      if( rc == -ENOMEM ) {
+         
+         // nothing got recorded; have the caller try again
+         batch[i]->rc = -ENOMEM;
+      }
+      else {
+         
+         batch[i]->rc = rcs[i];
+      }
+      
+      sem_post( &batch[i]->sem );
+   }
+   
+   return 0;
+}
+
+
+// group committer thread: once an fsync arrives, wait for the window to let others join it, and replicate them all at once.
+// don't wait if a full batch is already pending.
+// on stop, commit whatever is left before exiting.
+static void* UG_sync_committer_main( void* arg ) {
+   
+   struct UG_sync_committer* committer = (struct UG_sync_committer*)arg;
+   size_t num_pending = 0;
+   bool running = false;
+   
+   SG_debug("%s", "Group committer thread start\n");
+   
+   while( true ) {
+      
+      // wait for work 
+      sem_wait( &committer->sem );
+      
+      // once stopped, no more fsyncs can be added, so an empty queue means we're done
+      pthread_mutex_lock( &committer->lock );
+      num_pending = committer->pending->size();
+      running = committer->running;
+      pthread_mutex_unlock( &committer->lock );
+      
+      if( num_pending == 0 ) {
+         
+         if( !running ) {
+            break;
+         }
+         
+         // already committed with an earlier batch
+         continue;
+      }
+      
+      // let other fsyncs join this one
+      if( running && committer->window_ms > 0 && num_pending < UG_SYNC_GROUP_COMMIT_MAX_BATCH ) {
+         usleep( committer->window_ms * 1000 );
+      }
+      
+      UG_sync_committer_run_batch( committer );
+   }
+   
+   SG_debug("%s", "Group committer thread exit\n");
+   
+   return NULL;
+}
+
+
+// start the group committer 
+// return 0 on success
+// return -EPERM if we couldn't start the thread
+int UG_sync_committer_start( struct UG_sync_committer* committer ) {
+   
+   int rc = 0;
+   
+   if( committer->running ) {
+      return 0;
+   }
+   
+   committer->running = true;
+   
+   rc = md_start_thread( &committer->thread, UG_sync_committer_main, committer, false );
+   if( rc < 0 ) {
+      
+      SG_error("md_start_thread rc = %d\n", rc );
+      committer->running = false;
+      return -EPERM;
+   }
+   
+   return 0;
+}
+
+
+// replicate a sync context's file as part of the next group commit, and wait for it to finish.
+// the caller must already be first in line to sync its inode.
+// on return, sctx->rc holds what UG_replicate would have returned for sctx->rctx.
+// return 0 if the file was committed (successfully or not)
+// return -ENOTCONN if the committer is not running, in which case the caller should replicate the file itself
+// return -ENOMEM on OOM
+int UG_sync_committer_commit( struct UG_sync_committer* committer, struct UG_sync_context* sctx ) {
+   
+   if( committer == NULL ) {
+      return -ENOTCONN;
+   }
+   
+   pthread_mutex_lock( &committer->lock );
+   
+   if( !committer->running ) {
+      
+      // the thread may have already drained the queue and exited
+      pthread_mutex_unlock( &committer->lock );
+      return -ENOTCONN;
+   }
+   
+   try {
+      committer->pending->push_back( sctx );
+   }
+   catch( bad_alloc& ba ) {
+      
+      pthread_mutex_unlock( &committer->lock );
+      return -ENOMEM;
+   }
+   
+   pthread_mutex_unlock( &committer->lock );
+   
+   sem_post( &committer->sem );
+   
+   // wait for the batch to finish 
+   sem_wait( &sctx->sem );
+   
+   return 0;
+}
+
+
+// stop the group committer, once it has committed every pending fsync 
+// return 0 on success
+// return -errno if we failed to join the thread
+int UG_sync_committer_stop( struct UG_sync_committer* committer ) {
+   
+   int rc = 0;
+   
+   if( committer == NULL || !committer->running ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &committer->lock );
+   committer->running = false;
+   pthread_mutex_unlock( &committer->lock );
+   
+   sem_post( &committer->sem );
+   
+   rc = pthread_join( committer->thread, NULL );
+   if( rc != 0 ) {
+      
+      SG_error("pthread_join rc = %d\n", rc );
+      return -abs(rc);
+   }
+   
+   return 0;
+}
+
+
+// free up a group committer 
+// return 0 on success 
+// return -EINVAL if it's still running, or NULL
+int UG_sync_committer_shutdown( struct UG_sync_committer* committer ) {
+   
+   if( committer == NULL || committer->running ) {
+      return -EINVAL;
+   }
+   
+   SG_safe_delete( committer->pending );
+   pthread_mutex_destroy( &committer->lock );
+   sem_destroy( &committer->sem );
+   
+   return 0;
+}
+
+
 // indefinitely try to return dirty blocks to the inode
 // this does *NOT* affect the inode's manifest; it simply restores the inode's dirty block map
 // sleep a bit between attempts, in the hope that some memory gets freed up 
@@ -348,6 +611,10 @@ int UG_sync_fsync_ex( struct fskit_core* core, char const* path, struct fskit_en
    struct timespec manifest_modtime;
    struct timespec old_manifest_modtime;
    
+   struct timespec fsync_start, stage_start, stage_end;
+   
+   clock_gettime( CLOCK_MONOTONIC, &fsync_start );
+   
    vctx = UG_vacuum_context_new();
    rctx = UG_replica_context_new();
 
@@ -371,7 +638,13 @@ int UG_sync_fsync_ex( struct fskit_core* core, char const* path, struct fskit_en
    old_manifest_modtime.tv_nsec = SG_manifest_get_modtime_nsec( UG_inode_replaced_blocks( inode ) );
  
    // flush all dirty blocks
+   clock_gettime( CLOCK_MONOTONIC, &stage_start );
+   
    rc = UG_sync_blocks_flush( gateway, path, inode );
+   
+   clock_gettime( CLOCK_MONOTONIC, &stage_end );
+   UG_replica_stats_record( UG_REPLICA_STAGE_FLUSH, &stage_start, &stage_end );
+   
    if( rc != 0 ) {
        
        fskit_entry_unlock( fent );
@@ -399,7 +672,12 @@ int UG_sync_fsync_ex( struct fskit_core* core, char const* path, struct fskit_en
    }
 
    // make a replica context, snapshotting this inode's dirty blocks and manifest.
+   clock_gettime( CLOCK_MONOTONIC, &stage_start );
+   
    rc = UG_replica_context_init( rctx, ug, path, inode, UG_inode_manifest( inode ), dirty_blocks );
+   
+   clock_gettime( CLOCK_MONOTONIC, &stage_end );
+   UG_replica_stats_record( UG_REPLICA_STAGE_SNAPSHOT, &stage_start, &stage_end );
  
    // success?
    if( rc != 0 ) {
@@ -501,8 +779,16 @@ int UG_sync_fsync_ex( struct fskit_core* core, char const* path, struct fskit_en
       sem_wait( &sctx.sem );
    }
    
-   // replicate!
-   rc = UG_replicate( gateway, rctx );
+   // replicate!  batch this fsync with others, if we're group-committing
+   rc = UG_sync_committer_commit( UG_state_sync_committer( ug ), &sctx );
+   if( rc == 0 ) {
+      
+      rc = sctx.rc;
+   }
+   else {
+      
+      rc = UG_replicate( gateway, rctx );
+   }
    
    // reacquire
    fskit_entry_wlock( fent );
@@ -585,6 +871,10 @@ int UG_sync_fsync_ex( struct fskit_core* core, char const* path, struct fskit_en
    fskit_entry_unref( core, path, fent );
    UG_dirty_block_map_free( dirty_blocks );
    SG_safe_delete( dirty_blocks );
+   
+   clock_gettime( CLOCK_MONOTONIC, &stage_end );
+   UG_replica_stats_record( UG_REPLICA_STAGE_FSYNC, &fsync_start, &stage_end );
+   
    return rc;
 }
 
@@ -22,15 +22,26 @@
 #include "replication.h"
 #include "vacuumer.h"
 
+// maximum number of fsyncs to replicate in one group commit 
+#define UG_SYNC_GROUP_COMMIT_MAX_BATCH          64
+
 struct UG_sync_context {
    
    struct UG_replica_context* rctx;      // replication information 
    
    struct UG_vacuum_context* vctx;       // vacuum information 
    
-   sem_t sem;                           // ensure all calls to sync(2) happen in order
+   sem_t sem;                           // ensure all calls to sync(2) happen in order, and signals the end of a group commit
+   
+   int rc;                              // result of replicating rctx in a group commit
 };
 
+// fsyncs waiting to be group-committed
+typedef list<struct UG_sync_context*> UG_sync_commit_queue_t;
+
+// group committer: replicates fsyncs for many files together
+struct UG_sync_committer;
+
 extern "C" {
    
 // sync blocks to cache   
@@ -41,6 +52,14 @@ int UG_sync_blocks_flush_finish( struct SG_gateway* gateway, struct UG_inode* in
 int UG_sync_context_init( struct UG_sync_context* sctx, struct UG_replica_context* rctx );
 int UG_sync_context_free( struct UG_sync_context* sctx );
 
+// group commit 
+struct UG_sync_committer* UG_sync_committer_new();
+int UG_sync_committer_init( struct UG_sync_committer* committer, struct SG_gateway* gateway, int64_t window_ms );
+int UG_sync_committer_start( struct UG_sync_committer* committer );
+int UG_sync_committer_commit( struct UG_sync_committer* committer, struct UG_sync_context* sctx );
+int UG_sync_committer_stop( struct UG_sync_committer* committer );
+int UG_sync_committer_shutdown( struct UG_sync_committer* committer );
+
 // fskit sync
 int UG_sync_fsync_ex( struct fskit_core* core, char const* path, struct fskit_entry* fent );
 int UG_sync_fsync( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent );
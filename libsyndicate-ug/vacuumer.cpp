@@ -28,8 +28,8 @@ struct UG_vacuum_context {
    struct SG_manifest* old_blocks;              // blocks to remove
 
    struct UG_RG_context* rg_context;            // connection to all RGs
-   SG_messages::Request* vacuum_request;        // request to send to all RGs
    bool sent_delete;                            // did we send the request successfully? 
+   bool sent_clear;                             // did we ask the MS to clear our vacuum log entry on a prior attempt?
 
    int64_t delay;                               // delay delta for retry_deadline
    struct timespec retry_deadline;              // earliest time in the future when we can try this context again (if it failed)
@@ -38,25 +38,38 @@ struct UG_vacuum_context {
    volatile bool wait;                          // if set, the caller will wait for the context to finish
 
    bool unlinking;                              // delete *everything*, including the current manifest
+   bool peeks;                                  // do we get our blocks from the head of the MS vacuum log (i.e. no replaced blocks were given)?
    bool result_clean;                           // set to true if there's no more data to vacuum
 
    int64_t manifest_modtime_sec;                // manifest timestamp being vacuumed 
    int32_t manifest_modtime_nsec;
+
+   uint64_t pending_bytes;                      // how much this context contributes to the vacuumer's bytes_pending (guarded by the vacuumer's lock)
 };
 
 // global vacuum state 
 struct UG_vacuumer {
    
-   pthread_t thread;
+   pthread_t* threads;                          // worker threads
+   int num_threads;
+   int num_exited;                              // number of workers that have exited (updated atomically)
    
    UG_vacuum_queue_t* vacuum_queue;             // queue of vacuum requests to perform
-   pthread_rwlock_t lock;                       // lock governing access to the vacuum queue 
+   pthread_rwlock_t lock;                       // lock governing access to the vacuum queue and the counters below
+   
+   uint64_t num_in_flight;                      // number of vacuum contexts taken off the queue by workers
+   struct UG_vacuumer_stats stats;              // counters (backlog is computed when read)
    
    sem_t sem;                                   // used to wake up the vacuumer when there's work to be done
    
-   volatile bool running;                       // is this thread running?
+   set<uint64_t>* busy_files;                   // IDs of files with a peeking vacuum context running.  Contexts that look up their blocks from the MS
+                                                // all get the head of the file's vacuum log, so only one of them per file may run at a time.
+   pthread_mutex_t busy_lock;                   // lock governing access to busy_files
+   pthread_cond_t busy_cond;                    // signaled when a file is no longer busy
+   
+   volatile bool running;                       // are the threads running?
    volatile bool quiesce;                       // stop taking requests?
-   volatile bool exited;                        // set to true if exited
+   volatile bool exited;                        // set to true once every worker has exited
    
    struct SG_gateway* gateway;                  // parent gateway
 };
@@ -125,6 +138,7 @@ int UG_vacuum_context_init( struct UG_vacuum_context* vctx, struct UG_state* ug,
 
    vctx->rg_context = rg_context;
    vctx->fs_path = path;
+   vctx->peeks = (replaced_blocks == NULL);
    sem_init( &vctx->sem, 0, 0 );
    
    if( replaced_blocks != NULL ) {
@@ -174,7 +188,6 @@ int UG_vacuum_context_free( struct UG_vacuum_context* vctx ) {
    md_entry_free( &vctx->inode_data );
    UG_RG_context_free( vctx->rg_context );
    SG_safe_free( vctx->rg_context );
-   SG_safe_delete( vctx->vacuum_request ); 
    SG_safe_free( vctx->fs_path );
    sem_destroy( &vctx->sem );
    
@@ -212,6 +225,28 @@ int UG_vacuum_context_restore( struct UG_vacuum_context* vctx, struct UG_inode*
 }
 
 
+// how many bytes of blocks does a vacuum context have left to vacuum?
+// this is 0 until we know which blocks it will vacuum, and once it has sent its DELETECHUNKS request.
+static uint64_t UG_vacuum_context_pending_bytes( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx ) {
+   
+   if( vctx->old_blocks == NULL || vctx->sent_delete ) {
+      return 0;
+   }
+   
+   return SG_manifest_get_block_count( vctx->old_blocks ) * ms_client_get_volume_blocksize( SG_gateway_ms( vacuumer->gateway ) );
+}
+
+
+// update the vacuumer's bytes_pending with a vacuum context's new contribution
+// NOTE: vacuumer->lock must be write-locked
+static void UG_vacuumer_account( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx, uint64_t pending_bytes ) {
+   
+   vacuumer->stats.bytes_pending -= vctx->pending_bytes;
+   vacuumer->stats.bytes_pending += pending_bytes;
+   vctx->pending_bytes = pending_bytes;
+}
+
+
 // start vacuuming data.  It will be retried indefinitely until it succeeds.
 // return 0 on successful enqueue 
 // return -ENOMEM on OOM
@@ -220,6 +255,7 @@ int UG_vacuum_context_restore( struct UG_vacuum_context* vctx, struct UG_inode*
 static int UG_vacuumer_enqueue_ex( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx, bool wait ) {
    
    int rc = 0;
+   uint64_t pending_bytes = UG_vacuum_context_pending_bytes( vacuumer, vctx );
    
    pthread_rwlock_wrlock( &vacuumer->lock );
 
@@ -232,7 +268,7 @@ static int UG_vacuumer_enqueue_ex( struct UG_vacuumer* vacuumer, struct UG_vacuu
    vctx->wait = wait;
    
    try {
-      vacuumer->vacuum_queue->push( vctx );
+      vacuumer->vacuum_queue->push_back( vctx );
    }
    catch( bad_alloc& ba ) {
       rc = -ENOMEM;
@@ -240,7 +276,9 @@ static int UG_vacuumer_enqueue_ex( struct UG_vacuumer* vacuumer, struct UG_vacuu
    
    if( rc == 0 ) {
       
-      // wake up the work thread 
+      UG_vacuumer_account( vacuumer, vctx, pending_bytes );
+      
+      // wake up a worker 
       sem_post( &vacuumer->sem );
    }
    
@@ -438,23 +476,6 @@ static int UG_vacuumer_get_block_data( struct UG_vacuumer* vacuumer, struct UG_v
 }
 
 
-// clear the vacuum log for this write
-// return 0 on success
-// return -EINVAL if we're not done vacuuming
-// return -errno on failure to contact the MS
-static int UG_vacuumer_clear_vacuum_log( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx, uint64_t writer_id, int64_t old_mtime_sec, int32_t old_mtime_nsec ) {
-   
-   int rc = 0;
-   struct SG_gateway* gateway = vacuumer->gateway;
-   struct ms_client* ms = SG_gateway_ms( gateway );
-   uint64_t volume_id = ms_client_get_volume_id( ms );
-   
-   rc = ms_client_remove_vacuum_log_entry( ms, volume_id, writer_id, vctx->inode_data.file_id, vctx->inode_data.version, old_mtime_sec, old_mtime_nsec );
-   
-   return rc;
-}
-
-
 // increase delay factor by exponentially backing off with random jitter
 // always succeeds
 int UG_vacuumer_set_delay( struct UG_vacuum_context* vctx ) {
@@ -480,58 +501,63 @@ int UG_vacuumer_set_delay( struct UG_vacuum_context* vctx ) {
 }
 
 
-// given a write delta (as a manifest), create a DELETECHUNKS request for both the write delta and its associated blocks
+// given a set of vacuum contexts for the same file version, create a single DELETECHUNKS request for all of their write deltas and associated blocks
 // return 0 on success, and populate *request
 // return -ENOMEM on OOM
 // return -EPERM otherwise
-static int UG_vacuum_create_request( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx, struct SG_manifest* write_delta, SG_messages::Request* request ) {
+static int UG_vacuum_create_request( struct UG_vacuumer* vacuumer, struct UG_vacuum_context** vctxs, size_t num_vctxs, SG_messages::Request* request ) {
 
    int rc = 0;
    struct SG_manifest_block* chunk_info = NULL;
-   size_t num_chunks = SG_manifest_get_block_count( write_delta ) + 1;
+   size_t num_chunks = 0;
    int i = 0;
    struct SG_request_data reqdat;
    unsigned char dummy_hash[SHA256_DIGEST_LENGTH];
    
    memset( dummy_hash, 0, SHA256_DIGEST_LENGTH );
+   memset( &reqdat, 0, sizeof(struct SG_request_data) );
+
+   for( size_t j = 0; j < num_vctxs; j++ ) {
+      num_chunks += SG_manifest_get_block_count( vctxs[j]->old_blocks ) + 1;
+   }
 
    chunk_info = SG_manifest_block_alloc( num_chunks );
    if( chunk_info == NULL ) {
       return -ENOMEM;
    }
-    
-   // create manifest chunk info 
-   rc = SG_manifest_block_init( &chunk_info[i], vctx->manifest_modtime_sec, vctx->manifest_modtime_nsec, dummy_hash, SHA256_DIGEST_LENGTH );
-   if( rc != 0 ) {
-      SG_safe_free( chunk_info );
-
-      if( rc != -ENOMEM ) {
-         rc = -EPERM;
-      }
-
-      return rc;
-   }
    
-   SG_manifest_block_set_type( &chunk_info[i], SG_MANIFEST_BLOCK_TYPE_MANIFEST );
-
-   i++;
-
-   // create chunk infos from manifest
-   for( SG_manifest_block_iterator itr = SG_manifest_block_iterator_begin( write_delta ); itr != SG_manifest_block_iterator_end( write_delta ); itr++ ) {
-    
-      rc = SG_manifest_block_dup( &chunk_info[i], SG_manifest_block_iterator_block( itr ) );
+   for( size_t j = 0; j < num_vctxs; j++ ) {
+      
+      struct UG_vacuum_context* vctx = vctxs[j];
+      
+      // create manifest chunk info 
+      rc = SG_manifest_block_init( &chunk_info[i], vctx->manifest_modtime_sec, vctx->manifest_modtime_nsec, dummy_hash, SHA256_DIGEST_LENGTH );
       if( rc != 0 ) {
          
          goto UG_vacuum_create_request_fail;
       }
-
-      SG_manifest_block_set_type( &chunk_info[i], SG_MANIFEST_BLOCK_TYPE_BLOCK );
+      
+      SG_manifest_block_set_type( &chunk_info[i], SG_MANIFEST_BLOCK_TYPE_MANIFEST );
 
       i++;
+
+      // create chunk infos from manifest
+      for( SG_manifest_block_iterator itr = SG_manifest_block_iterator_begin( vctx->old_blocks ); itr != SG_manifest_block_iterator_end( vctx->old_blocks ); itr++ ) {
+       
+         rc = SG_manifest_block_dup( &chunk_info[i], SG_manifest_block_iterator_block( itr ) );
+         if( rc != 0 ) {
+            
+            goto UG_vacuum_create_request_fail;
+         }
+
+         SG_manifest_block_set_type( &chunk_info[i], SG_MANIFEST_BLOCK_TYPE_BLOCK );
+
+         i++;
+      }
    }
 
    // set up request header
-   rc = SG_request_data_init_common( vacuumer->gateway, vctx->fs_path, vctx->inode_data.file_id, vctx->inode_data.version, &reqdat );
+   rc = SG_request_data_init_common( vacuumer->gateway, vctxs[0]->fs_path, vctxs[0]->inode_data.file_id, vctxs[0]->inode_data.version, &reqdat );
    if( rc != 0 ) {
 
       goto UG_vacuum_create_request_fail;
@@ -563,256 +589,612 @@ UG_vacuum_create_request_fail:
 }
 
 
-// run a single vacuum context 
+// find out which blocks a vacuum context will vacuum, if we don't know already.
+// on success, vctx->old_blocks and the manifest timestamp will be set, unless there is nothing to vacuum (in which case, vctx->result_clean will be set)
 // return 0 on success
-// return negative on error
-// NOTE: this method is idempotent, and should be retried continuously until it succeeds
-int UG_vacuum_run( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx ) {
+// return -EAGAIN if we should try again
+// return negative on failure to peek the vacuum log
+static int UG_vacuum_prepare( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx ) {
    
    int rc = 0;
    struct SG_manifest* old_write_delta = NULL;
-   SG_messages::Request* vacuum_request = NULL;
-   struct SG_gateway* gateway = vacuumer->gateway;
    
-   if( vctx->delay > 0 ) {
+   if( vctx->sent_delete ) {
       
-      // try to wait until the deadline comes (don't worry if interrupted or if passed)
-      clock_nanosleep( CLOCK_REALTIME, TIMER_ABSTIME, &vctx->retry_deadline, NULL );
+      // just need to clear the vacuum log 
+      return 0;
    }
-  
-   if( vctx->vacuum_request == NULL && !vctx->sent_delete ) {
-      
-      // generate a vacuum request 
-      vacuum_request = SG_safe_new( SG_messages::Request() );
-      if( vacuum_request == NULL ) {
-         // always try again
+   
+   if( vctx->old_blocks == NULL ) {
+
+      old_write_delta = SG_manifest_new();
+      if( old_write_delta == NULL ) {
+         // always try again 
          return -EAGAIN;
       }
 
-      if( vctx->old_blocks == NULL ) {
-
-         old_write_delta = SG_manifest_new();
-         if( old_write_delta == NULL ) {
-            // always try again 
-            return -EAGAIN;
-         }
+      // will vacuum everything, except for the current manifest
+      // peek and get the set of affected blocks
+      rc = UG_vacuumer_peek_vacuum_log( vacuumer, vctx, old_write_delta );
+      if( rc != 0 ) {
+      
+          SG_error("UG_vacuumer_peek_vacuum_log( %" PRIX64 ".%" PRId64 " ) rc = %d\n",
+                   vctx->inode_data.file_id, vctx->inode_data.version, rc );
+      
+          SG_safe_free( old_write_delta );
 
-         // will vacuum everything, except for the current manifest
-         // peek and get the set of affected blocks
-         rc = UG_vacuumer_peek_vacuum_log( vacuumer, vctx, old_write_delta );
-         if( rc != 0 ) {
-         
-             SG_error("UG_vacuumer_peek_vacuum_log( %" PRIX64 ".%" PRId64 " ) rc = %d\n",
-                      vctx->inode_data.file_id, vctx->inode_data.version, rc );
-         
-             SG_safe_free( old_write_delta );
-             SG_safe_delete( vacuum_request );
-
-             if( rc != -EPROTO && rc != -ENODATA ) {
-                return rc;
-             }
-             else {
-                // not our place to vacuum in the first place,
-                // or we're up-to-date
-                vctx->result_clean = true;
-                return 0;
-             }
+          if( rc != -EPROTO && rc != -ENODATA ) {
+             return rc;
           }
+          else {
+             // not our place to vacuum in the first place,
+             // or we're up-to-date
+             vctx->result_clean = true;
+             return 0;
+          }
+       }
+
+       // skip if this is the current manifest, and if we're not unlinking 
+       if( !vctx->unlinking &&
+           SG_manifest_get_modtime_sec( old_write_delta ) == vctx->inode_data.manifest_mtime_sec &&
+           SG_manifest_get_modtime_nsec( old_write_delta ) == vctx->inode_data.manifest_mtime_nsec ) {
+
+          SG_debug("Will not vacuum current manifest %" PRIX64 "/manifest.%" PRId64 ".%d\n",
+                   vctx->inode_data.file_id, vctx->inode_data.manifest_mtime_sec, vctx->inode_data.manifest_mtime_nsec );
+
+          SG_manifest_free( old_write_delta );
+          SG_safe_free( old_write_delta );
+
+          vctx->result_clean = true;
+          return 0;
+       }
+       
+       // get old block data at this timestamp
+       rc = UG_vacuumer_get_block_data( vacuumer, vctx, old_write_delta );
+       if( rc != 0 ) {
+      
+          SG_error("UG_vacuumer_get_block_data( %" PRIX64 ".%" PRId64 "/manifest.%ld.%d ) rc = %d\n",
+                   vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec, rc );
+      
+          SG_manifest_free( old_write_delta );
+          SG_safe_free( old_write_delta );
+          return -EAGAIN;
+       }
+
+       vctx->old_blocks = old_write_delta;
+       vctx->manifest_modtime_sec = SG_manifest_get_modtime_sec( vctx->old_blocks );
+       vctx->manifest_modtime_nsec = SG_manifest_get_modtime_nsec( vctx->old_blocks );
+   }
+   
+   // sanity check
+   if( vctx->manifest_modtime_sec == 0 && vctx->manifest_modtime_nsec == 0 ) {
+
+      SG_error("%s", "BUG: did not set manifest timestamp\n");
+      exit(1);
+   }
+   
+   return 0;
+}
 
-          // skip if this is the current manifest, and if we're not unlinking 
-          if( !vctx->unlinking &&
-              SG_manifest_get_modtime_sec( old_write_delta ) == vctx->inode_data.manifest_mtime_sec &&
-              SG_manifest_get_modtime_nsec( old_write_delta ) == vctx->inode_data.manifest_mtime_nsec ) {
 
-             SG_debug("Will not vacuum current manifest %" PRIX64 "/manifest.%" PRId64 ".%d\n",
-                      vctx->inode_data.file_id, vctx->inode_data.manifest_mtime_sec, vctx->inode_data.manifest_mtime_nsec );
+// send one DELETECHUNKS request to all RGs for a set of vacuum contexts of the same file version.
+// on success, each context is marked as having sent its delete.
+// return 0 on success
+// return -EAGAIN if we should try again
+static int UG_vacuum_send_delete( struct UG_vacuumer* vacuumer, struct UG_vacuum_context** vctxs, size_t num_vctxs ) {
+   
+   int rc = 0;
+   SG_messages::Request* vacuum_request = NULL;
+   
+   vacuum_request = SG_safe_new( SG_messages::Request() );
+   if( vacuum_request == NULL ) {
+      // always try again
+      return -EAGAIN;
+   }
+   
+   // prepare to delete
+   rc = UG_vacuum_create_request( vacuumer, vctxs, num_vctxs, vacuum_request );
+   if( rc != 0 ) {
 
-             SG_manifest_free( old_write_delta );
-             SG_safe_free( old_write_delta );
-             SG_safe_delete( vacuum_request );
+      SG_error("UG_vacuum_create_request( %" PRIX64 ".%" PRId64 ", %zu manifests ) rc = %d\n",
+               vctxs[0]->inode_data.file_id, vctxs[0]->inode_data.version, num_vctxs, rc );
 
-             vctx->result_clean = true;
-             return 0;
-          }
-          
-          // get old block data at this timestamp
-          rc = UG_vacuumer_get_block_data( vacuumer, vctx, old_write_delta );
-          if( rc != 0 ) {
-         
-             SG_error("UG_vacuumer_get_block_data( %" PRIX64 ".%" PRId64 "/manifest.%ld.%d ) rc = %d\n",
-                      vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec, rc );
-         
-             SG_manifest_free( old_write_delta );
-             SG_safe_free( old_write_delta );
-             SG_safe_delete( vacuum_request );
-             return -EAGAIN;
-          }
+      SG_safe_delete( vacuum_request );
+      return -EAGAIN;
+   }
+   
+   // run the deletion.  All contexts in the volume have the same RGs, so any of their RG contexts will do.
+   rc = UG_RG_send_all( vacuumer->gateway, vctxs[0]->rg_context, vacuum_request, NULL );
+   SG_safe_delete( vacuum_request );
+   
+   if( rc != 0 ) {
 
-          vctx->old_blocks = old_write_delta;
-          vctx->manifest_modtime_sec = SG_manifest_get_modtime_sec( vctx->old_blocks );
-          vctx->manifest_modtime_nsec = SG_manifest_get_modtime_nsec( vctx->old_blocks );
+      // need to try again!
+      SG_error("UG_RG_send_all rc = %d\n", rc );
+
+      // TODO: record vacuum into to disk, so we can try again across gateway stop/start
+      return -EAGAIN;
+   }
+   
+   // success!
+   for( size_t i = 0; i < num_vctxs; i++ ) {
+      vctxs[i]->sent_delete = true;
+   }
+   
+   pthread_rwlock_wrlock( &vacuumer->lock );
+   vacuumer->stats.deletechunks++;
+   pthread_rwlock_unlock( &vacuumer->lock );
+   
+   return 0;
+}
+
+
+// clear the vacuum log entries for each vacuum context that has sent its delete, in as few requests to the MS as we can.
+// rcs[i] is set to the outcome for vctxs[i], for each context that had sent its delete:  0 if cleared, -EAGAIN if we should try again,
+// or -ENOENT if the entry was already gone and we had never asked to clear it (i.e. someone else vacuumed it).
+// return 0 on success
+// return -ENOMEM on OOM
+static int UG_vacuum_clear_vacuum_logs( struct UG_vacuumer* vacuumer, struct UG_vacuum_context** vctxs, size_t num_vctxs, int* rcs ) {
+   
+   int rc = 0;
+   struct ms_client* ms = SG_gateway_ms( vacuumer->gateway );
+   uint64_t volume_id = ms_client_get_volume_id( ms );
+   struct ms_vacuum_entry* ves = NULL;
+   int* ve_rcs = NULL;
+   size_t* ve_idxs = NULL;
+   bool* ve_resent = NULL;
+   size_t num_ves = 0;
+   uint64_t num_cleared = 0;
+   
+   ves = SG_CALLOC( struct ms_vacuum_entry, num_vctxs );
+   ve_rcs = SG_CALLOC( int, num_vctxs );
+   ve_idxs = SG_CALLOC( size_t, num_vctxs );
+   ve_resent = SG_CALLOC( bool, num_vctxs );
+   
+   if( ves == NULL || ve_rcs == NULL || ve_idxs == NULL || ve_resent == NULL ) {
+      
+      SG_safe_free( ves );
+      SG_safe_free( ve_rcs );
+      SG_safe_free( ve_idxs );
+      SG_safe_free( ve_resent );
+      return -ENOMEM;
+   }
+   
+   for( size_t i = 0; i < num_vctxs; i++ ) {
+      
+      struct UG_vacuum_context* vctx = vctxs[i];
+      
+      if( rcs[i] != 0 || !vctx->sent_delete ) {
+         continue;
       }
       
-      // sanity check
+      // sanity check 
       if( vctx->manifest_modtime_sec == 0 && vctx->manifest_modtime_nsec == 0 ) {
-
-         SG_error("%s", "BUG: did not set manifest timestamp\n");
+         SG_error("BUG: did not set an old manifest timestamp for vacuum context %p\n", vctx );
          exit(1);
       }
-
-      // prepare to delete
-      rc = UG_vacuum_create_request( vacuumer, vctx, vctx->old_blocks, vacuum_request );
+      
+      // no affected blocks needed to clear the log
+      ves[num_ves].volume_id = volume_id;
+      ves[num_ves].writer_id = SG_manifest_get_coordinator( vctx->old_blocks );
+      ves[num_ves].file_id = vctx->inode_data.file_id;
+      ves[num_ves].file_version = vctx->inode_data.version;
+      ves[num_ves].manifest_mtime_sec = vctx->manifest_modtime_sec;
+      ves[num_ves].manifest_mtime_nsec = vctx->manifest_modtime_nsec;
+      
+      ve_idxs[num_ves] = i;
+      ve_resent[num_ves] = vctx->sent_clear;
+      num_ves++;
+   }
+   
+   if( num_ves > 0 ) {
+      
+      // dequeue vacuum logs 
+      for( size_t i = 0; i < num_ves; i++ ) {
+         vctxs[ ve_idxs[i] ]->sent_clear = true;
+      }
+      
+      rc = ms_client_remove_vacuum_log_entries( ms, ves, num_ves, ve_rcs );
       if( rc != 0 ) {
-
-         SG_error("UG_vacuum_create_request( %" PRIX64 ".%" PRId64 "/manifest.%ld.%d ) rc = %d\n",
-                  vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec, rc );
-
-         SG_safe_delete( vacuum_request );
-         return -EAGAIN;
+         
+         // entries not sent are marked -EAGAIN
+         SG_error("ms_client_remove_vacuum_log_entries(%zu entries) rc = %d\n", num_ves, rc );
+         rc = 0;
       }
-
-      vctx->vacuum_request = vacuum_request;
    }
+   
+   for( size_t i = 0; i < num_ves; i++ ) {
+      
+      struct UG_vacuum_context* vctx = vctxs[ ve_idxs[i] ];
+      
+      if( ve_rcs[i] == -ENOENT ) {
+         
+         if( ve_resent[i] ) {
+            
+            // we cleared it on a prior attempt, but didn't hear back
+            ve_rcs[i] = 0;
+         }
+         else {
+            
+            // not ours to count
+            SG_warn("Vacuum log ( %" PRIX64 ".%" PRId64 "/manifest.%ld.%d ) was already cleared\n",
+                    vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec );
+            
+            rcs[ ve_idxs[i] ] = -ENOENT;
+            continue;
+         }
+      }
+      
+      if( ve_rcs[i] != 0 ) {
+        
+         SG_error("Clear vacuum log ( %" PRIX64 ".%" PRId64 "/manifest.%ld.%d ) rc = %d\n",
+                  vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec, ve_rcs[i] );
+         
+         // try again 
+         rcs[ ve_idxs[i] ] = -EAGAIN;
+      }
+      else {
+         
+         num_cleared++;
+      }
+   }
+   
+   if( num_cleared > 0 ) {
+      
+      pthread_rwlock_wrlock( &vacuumer->lock );
+      vacuumer->stats.log_removals += num_cleared;
+      pthread_rwlock_unlock( &vacuumer->lock );
+   }
+   
+   SG_safe_free( ves );
+   SG_safe_free( ve_rcs );
+   SG_safe_free( ve_idxs );
+   SG_safe_free( ve_resent );
+   
+   return rc;
+}
 
-   if( vctx->vacuum_request != NULL ) {
 
-      // run the deletion 
-      rc = UG_RG_send_all( gateway, vctx->rg_context, vctx->vacuum_request, NULL );
+// run a batch of vacuum contexts:  find out what each one will vacuum, send one DELETECHUNKS request to all RGs per file version, 
+// and clear the vacuum log entries for everything we deleted in as few requests to the MS as we can.
+// rcs[i] is set to the outcome for vctxs[i]:  0 on success, -EAGAIN if it should be tried again, or negative on error
+// return 0 on success
+// return -ENOMEM on OOM 
+// NOTE: this method is idempotent, and each context should be retried continuously until it succeeds
+// NOTE: the caller must have claimed each context (see UG_vacuumer_claim_locked), so no two of them peek the same vacuum log entry
+static int UG_vacuum_run_batch( struct UG_vacuumer* vacuumer, struct UG_vacuum_context** vctxs, size_t num_vctxs, int* rcs ) {
+   
+   int rc = 0;
+   bool* grouped = NULL;
+   struct UG_vacuum_context** group = NULL;
+   size_t* group_idxs = NULL;
+   
+   grouped = SG_CALLOC( bool, num_vctxs );
+   group = SG_CALLOC( struct UG_vacuum_context*, num_vctxs );
+   group_idxs = SG_CALLOC( size_t, num_vctxs );
+   
+   if( grouped == NULL || group == NULL || group_idxs == NULL ) {
+      
+      SG_safe_free( grouped );
+      SG_safe_free( group );
+      SG_safe_free( group_idxs );
+      return -ENOMEM;
+   }
+   
+   for( size_t i = 0; i < num_vctxs; i++ ) {
+      rcs[i] = UG_vacuum_prepare( vacuumer, vctxs[i] );
+   }
+   
+   // send one DELETECHUNKS for each file version 
+   for( size_t i = 0; i < num_vctxs; i++ ) {
+      
+      size_t group_size = 0;
+      
+      if( grouped[i] || rcs[i] != 0 || vctxs[i]->result_clean || vctxs[i]->sent_delete ) {
+         continue;
+      }
+      
+      for( size_t j = i; j < num_vctxs; j++ ) {
+         
+         if( grouped[j] || rcs[j] != 0 || vctxs[j]->result_clean || vctxs[j]->sent_delete ) {
+            continue;
+         }
+         
+         if( vctxs[j]->inode_data.file_id != vctxs[i]->inode_data.file_id || vctxs[j]->inode_data.version != vctxs[i]->inode_data.version ) {
+            continue;
+         }
+         
+         grouped[j] = true;
+         group[ group_size ] = vctxs[j];
+         group_idxs[ group_size ] = j;
+         group_size++;
+      }
+      
+      rc = UG_vacuum_send_delete( vacuumer, group, group_size );
       if( rc != 0 ) {
+         
+         for( size_t j = 0; j < group_size; j++ ) {
+            rcs[ group_idxs[j] ] = rc;
+         }
+         
+         rc = 0;
+      }
+   }
+   
+   SG_safe_free( grouped );
+   SG_safe_free( group );
+   SG_safe_free( group_idxs );
+   
+   // clear the vacuum log for everything we deleted (including on prior attempts)
+   rc = UG_vacuum_clear_vacuum_logs( vacuumer, vctxs, num_vctxs, rcs );
+   if( rc != 0 ) {
+      
+      return rc;
+   }
+   
+   pthread_rwlock_wrlock( &vacuumer->lock );
+   vacuumer->stats.batches++;
+   pthread_rwlock_unlock( &vacuumer->lock );
+   
+   return 0;
+}
 
-         // need to try again!
-         SG_error("UG_RG_send_all rc = %d\n", rc );
 
-         // TODO: record vacuum into to disk, so we can try again across gateway stop/start
-         return -EAGAIN;
+// claim a vacuum context's file, if it peeks the vacuum log, so no other peeking context for the file runs until it is released.
+// contexts with their own replaced blocks don't need claiming, and always succeed.
+// return 0 on success
+// return -EBUSY if another peeking context has the file
+// return -ENOMEM on OOM
+// NOTE: vacuumer->busy_lock must be held
+static int UG_vacuumer_claim_locked( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx ) {
+   
+   if( !vctx->peeks ) {
+      return 0;
+   }
+   
+   try {
+      
+      if( !vacuumer->busy_files->insert( vctx->inode_data.file_id ).second ) {
+         return -EBUSY;
       }
+   }
+   catch( bad_alloc& ba ) {
+      return -ENOMEM;
+   }
+   
+   return 0;
+}
+
 
-      // success!
-      vctx->sent_delete = true;
-      SG_safe_delete( vctx->vacuum_request );
-      vctx->vacuum_request = NULL;
+// release a context claimed with UG_vacuumer_claim_locked, and wake up anyone waiting to vacuum its file 
+static void UG_vacuumer_release( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx ) {
+   
+   if( !vctx->peeks ) {
+      return;
    }
+   
+   pthread_mutex_lock( &vacuumer->busy_lock );
+   
+   vacuumer->busy_files->erase( vctx->inode_data.file_id );
+   pthread_cond_broadcast( &vacuumer->busy_cond );
+   
+   pthread_mutex_unlock( &vacuumer->busy_lock );
+   
+   // workers may have skipped this file's queued contexts 
+   sem_post( &vacuumer->sem );
+}
 
-   if( vctx->sent_delete ) {
 
-      // sanity check 
-      if( vctx->manifest_modtime_sec == 0 && vctx->manifest_modtime_nsec == 0 ) {
-         SG_error("BUG: did not set an old manifest timestamp for vacuum context %p\n", vctx );
-         exit(1);
-      }
+// run a single vacuum context 
+// if it peeks the vacuum log, wait for any other peeking context for the same file to finish first
+// return 0 on success
+// return negative on error
+// NOTE: this method is idempotent, and should be retried continuously until it succeeds
+int UG_vacuum_run( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx ) {
+   
+   int rc = 0;
+   int vctx_rc = 0;
+   
+   if( vctx->delay > 0 ) {
+      
+      // try to wait until the deadline comes (don't worry if interrupted or if passed)
+      clock_nanosleep( CLOCK_REALTIME, TIMER_ABSTIME, &vctx->retry_deadline, NULL );
+   }
+   
+   pthread_mutex_lock( &vacuumer->busy_lock );
+   
+   while( (rc = UG_vacuumer_claim_locked( vacuumer, vctx )) == -EBUSY ) {
+      pthread_cond_wait( &vacuumer->busy_cond, &vacuumer->busy_lock );
+   }
+   
+   pthread_mutex_unlock( &vacuumer->busy_lock );
+   
+   if( rc != 0 ) {
+      
+      // OOM; try again 
+      return -EAGAIN;
+   }
+   
+   rc = UG_vacuum_run_batch( vacuumer, &vctx, 1, &vctx_rc );
+   
+   UG_vacuumer_release( vacuumer, vctx );
+   
+   if( rc != 0 ) {
+      
+      // always try again 
+      return -EAGAIN;
+   }
+   
+   return vctx_rc;
+}
 
-      // dequeue vacuum log 
-      rc = UG_vacuumer_clear_vacuum_log( vacuumer, vctx, SG_manifest_get_coordinator( vctx->old_blocks ), vctx->manifest_modtime_sec, vctx->manifest_modtime_nsec );
-      if( rc == -ENOENT ) {
-         // cleared already 
-         rc = 0;
-      }
 
-      if( rc != 0 ) {
-     
-        SG_error("UG_vacuumer_clear_vacuum_log( %" PRIX64 ".%" PRId64 "/manifest.%ld.%d ) rc = %d\n",
-                  vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec, rc );
+// is a vacuum context ready to run, as of now?
+static bool UG_vacuum_context_is_due( struct UG_vacuum_context* vctx, struct timespec* now ) {
+   
+   if( vctx->delay <= 0 ) {
+      return true;
+   }
+   
+   return vctx->retry_deadline.tv_sec < now->tv_sec || (vctx->retry_deadline.tv_sec == now->tv_sec && vctx->retry_deadline.tv_nsec <= now->tv_nsec);
+}
+
+
+// finish up with a vacuum context that a worker ran, and release it
+// put it back in the queue if it needs to be retried; otherwise free it or wake up its waiter 
+static void UG_vacuumer_finish( struct UG_vacuumer* vacuumer, struct UG_vacuum_context* vctx, int rc ) {
+   
+   UG_vacuumer_release( vacuumer, vctx );
+   
+   if( rc == -EAGAIN ) {
       
-        // try again 
-        return -EAGAIN;
+      // try again, but later 
+      SG_debug("Try to vacuum %" PRIX64 " again\n", vctx->inode_data.file_id);
+      UG_vacuumer_set_delay( vctx );
+      
+      rc = UG_vacuumer_enqueue_ex( vacuumer, vctx, vctx->wait );
+      if( rc == 0 ) {
+         
+         pthread_rwlock_wrlock( &vacuumer->lock );
+         vacuumer->num_in_flight--;
+         pthread_rwlock_unlock( &vacuumer->lock );
+         return;
+      }
+      
+      if( rc == -ENOTCONN ) {
+         
+         // shutting down.  The MS still has this vacuum log entry, so the next vacuum of this file will pick it up.
+         SG_warn("Abandoning vacuum of %" PRIX64 ".%" PRId64 " (manifest.%ld.%d) on shutdown; its blocks remain until the file is vacuumed again\n",
+                 vctx->inode_data.file_id, vctx->inode_data.version, (long)vctx->manifest_modtime_sec, (int)vctx->manifest_modtime_nsec );
+      }
+      else {
+         
+         SG_error("UG_vacuumer_enqueue_ex( %" PRIX64 " ) rc = %d\n", vctx->inode_data.file_id, rc );
       }
    }
+   else if( rc != 0 ) {
+      SG_error("UG_vacuum_run( %" PRIX64 " ) rc = %d\n", vctx->inode_data.file_id, rc);
+   }
+   
+   pthread_rwlock_wrlock( &vacuumer->lock );
+   UG_vacuumer_account( vacuumer, vctx, 0 );
+   vacuumer->num_in_flight--;
+   pthread_rwlock_unlock( &vacuumer->lock );
    
    // done!
-   return rc;
+   if( !vctx->wait ) {
+       UG_vacuum_context_free( vctx );
+       SG_safe_free( vctx );
+   }
+   else {
+      // caller will free
+      sem_post( &vctx->sem );
+   }
 }
 
 
-// main vacuumer loop 
+// main vacuumer loop: take batches of due vacuum contexts off the queue and run them.
+// each worker runs this.
 static void* UG_vacuumer_main( void* arg ) {
    
    int rc = 0;
    struct UG_vacuumer* vacuumer = (struct UG_vacuumer*)arg; 
-   struct UG_vacuum_context* vctx = NULL;
+   struct UG_vacuum_context* batch[ UG_VACUUMER_MAX_BATCH ];
+   int rcs[ UG_VACUUMER_MAX_BATCH ];
+   size_t num_batch = 0;
+   bool done = false;
+   struct timespec deadline;
+   struct timespec now;
    
    while( vacuumer->running ) {
       
-      // wait for vacuum requests
-      while( true ) {
-         
-         rc = sem_wait( &vacuumer->sem );
+      // wait for vacuum requests, or for a delayed one to come due
+      clock_gettime( CLOCK_REALTIME, &deadline );
+      deadline.tv_sec += UG_VACUUMER_POLL_INTERVAL;
+      
+      rc = sem_timedwait( &vacuumer->sem, &deadline );
+      if( rc != 0 ) {
          
-         if( rc != 0 ) {
+         rc = -errno;
+         if( rc != -EINTR && rc != -ETIMEDOUT ) {
             
-            rc = -errno;
-            if( rc == -EINTR ) {
-               
-               rc = 0;
-               continue;
-            }
-            else {
-               
-               SG_error("sem_wait rc = %d\n", rc );
-               break;
-            }
+            SG_error("sem_timedwait rc = %d\n", rc );
+            break;
          }
          
-         break;
+         rc = 0;
       }
       
       // signaled?
-      if( !vacuumer->running || rc != 0 ) {
+      if( !vacuumer->running ) {
          break;
       }
       
-      // next context 
+      clock_gettime( CLOCK_REALTIME, &now );
+      num_batch = 0;
+      
+      // next batch of contexts that are due, in queue order, with at most one peeking context per file.
+      // skip peeking contexts for files that another worker (or UG_vacuum_run) is peeking; they get picked up once it's done.
       pthread_rwlock_wrlock( &vacuumer->lock );
+      pthread_mutex_lock( &vacuumer->busy_lock );
       
-      if( vacuumer->vacuum_queue->size() == 0 ) {
+      for( UG_vacuum_queue_t::iterator itr = vacuumer->vacuum_queue->begin(); itr != vacuumer->vacuum_queue->end() && num_batch < UG_VACUUMER_MAX_BATCH; ) {
          
-         // nothing to do 
-         pthread_rwlock_unlock( &vacuumer->lock );
-         if( vacuumer->quiesce ) {
+         if( UG_vacuum_context_is_due( *itr, &now ) && UG_vacuumer_claim_locked( vacuumer, *itr ) == 0 ) {
+            
+            batch[ num_batch ] = *itr;
+            num_batch++;
+            
+            itr = vacuumer->vacuum_queue->erase( itr );
+         }
+         else {
+            
+            itr++;
+         }
+      }
+      
+      pthread_mutex_unlock( &vacuumer->busy_lock );
+      
+      vacuumer->num_in_flight += num_batch;
+      done = (vacuumer->quiesce && vacuumer->vacuum_queue->size() == 0);
+      
+      pthread_rwlock_unlock( &vacuumer->lock );
+      
+      if( num_batch == 0 ) {
+         
+         if( done ) {
             // done!
             break;
          }
          else {
+            // nothing to do
             continue;
          }
       }
       
-      vctx = vacuumer->vacuum_queue->front();
-      pthread_rwlock_unlock( &vacuumer->lock );
-      
       // run it
-      rc = UG_vacuum_run( vacuumer, vctx );
-
-      // remove it 
-      pthread_rwlock_wrlock( &vacuumer->lock );
-      vacuumer->vacuum_queue->pop();
-      pthread_rwlock_unlock( &vacuumer->lock );
-
-      if( rc == -EAGAIN ) {
+      rc = UG_vacuum_run_batch( vacuumer, batch, num_batch, rcs );
+      if( rc != 0 ) {
+         
+         SG_error("UG_vacuum_run_batch(%zu) rc = %d\n", num_batch, rc );
+         for( size_t i = 0; i < num_batch; i++ ) {
+            rcs[i] = -EAGAIN;
+         }
          
-         // try again, but later 
-         SG_debug("Try to vacuum %" PRIX64 " again\n", vctx->inode_data.file_id);
-         UG_vacuumer_set_delay( vctx );
-         UG_vacuumer_enqueue( vacuumer, vctx );
          rc = 0;
-         continue;
-      }
-      else if( rc != 0 ) {
-         SG_error("UG_vacuum_run rc = %d\n", rc);
       }
       
-      // done!
-      if( !vctx->wait ) {
-          UG_vacuum_context_free( vctx );
-          SG_safe_free( vctx );
-      }
-      else {
-         // caller will free
-         sem_post( &vctx->sem );
+      for( size_t i = 0; i < num_batch; i++ ) {
+         UG_vacuumer_finish( vacuumer, batch[i], rcs[i] );
       }
    }
   
    SG_debug("%s", "Vacuumer thread exited\n");
-   vacuumer->exited = true; 
+   
+   if( __sync_add_and_fetch( &vacuumer->num_exited, 1 ) == vacuumer->num_threads ) {
+      vacuumer->exited = true; 
+   }
+   
    return NULL;
 }
 
@@ -839,13 +1221,65 @@ int UG_vacuumer_init( struct UG_vacuumer* vacuumer, struct SG_gateway* gateway )
       return -ENOMEM;
    }
    
+   vacuumer->busy_files = SG_safe_new( set<uint64_t>() );
+   if( vacuumer->busy_files == NULL ) {
+      
+      SG_safe_delete( vacuumer->vacuum_queue );
+      pthread_rwlock_destroy( &vacuumer->lock );
+      return -ENOMEM;
+   }
+   
+   vacuumer->threads = SG_CALLOC( pthread_t, UG_VACUUMER_NUM_WORKERS );
+   if( vacuumer->threads == NULL ) {
+      
+      SG_safe_delete( vacuumer->busy_files );
+      SG_safe_delete( vacuumer->vacuum_queue );
+      pthread_rwlock_destroy( &vacuumer->lock );
+      return -ENOMEM;
+   }
+   
+   pthread_mutex_init( &vacuumer->busy_lock, NULL );
+   pthread_cond_init( &vacuumer->busy_cond, NULL );
    sem_init( &vacuumer->sem, 0, 0 );
    
    return 0;
 }
 
+
+// stop and join the first num_threads workers 
+// return 0 on success
+// return the first pthread error encountered, as a negative errno, on failure
+static int UG_vacuumer_join_workers( struct UG_vacuumer* vacuumer, int num_threads ) {
+   
+   int rc = 0;
+   int worst_rc = 0;
+   
+   for( int i = 0; i < num_threads; i++ ) {
+      
+      rc = pthread_cancel( vacuumer->threads[i] );
+      if( rc != 0 ) {
+         
+         // -ESRCH
+         if( worst_rc == 0 ) {
+            worst_rc = -abs(rc);
+         }
+         
+         continue;
+      }
+      
+      rc = pthread_join( vacuumer->threads[i], NULL );
+      if( rc != 0 && worst_rc == 0 ) {
+         
+         worst_rc = -abs(rc);
+      }
+   }
+   
+   return worst_rc;
+}
+
+
 // start vacuuming 
-// return 0 if we started a thread 
+// return 0 if we started the workers
 // return -EPERM if not
 int UG_vacuumer_start( struct UG_vacuumer* vacuumer ) {
    
@@ -856,13 +1290,23 @@ int UG_vacuumer_start( struct UG_vacuumer* vacuumer ) {
    }
    
    vacuumer->running = true;
+   vacuumer->num_threads = UG_VACUUMER_NUM_WORKERS;
+   vacuumer->num_exited = 0;
+   vacuumer->exited = false;
    
-   rc = md_start_thread( &vacuumer->thread, UG_vacuumer_main, vacuumer, false );
-   if( rc < 0 ) {
+   for( int i = 0; i < UG_VACUUMER_NUM_WORKERS; i++ ) {
       
-      SG_error("md_start_thread rc = %d\n", rc );
-      vacuumer->running = false;
-      return -EPERM;
+      rc = md_start_thread( &vacuumer->threads[i], UG_vacuumer_main, vacuumer, false );
+      if( rc < 0 ) {
+         
+         SG_error("md_start_thread rc = %d\n", rc );
+         
+         vacuumer->running = false;
+         UG_vacuumer_join_workers( vacuumer, i );
+         
+         vacuumer->num_threads = 0;
+         return -EPERM;
+      }
    }
    
    return 0;
@@ -895,7 +1339,7 @@ int UG_vacuumer_wait_all( struct UG_vacuumer* vacuumer ) {
       again = false;
       pthread_rwlock_rdlock( &vacuumer->lock );
       
-      count = vacuumer->vacuum_queue->size();
+      count = vacuumer->vacuum_queue->size() + vacuumer->num_in_flight;
       if( count > 0 ) {
          again = true;
       }
@@ -918,15 +1362,29 @@ int UG_vacuumer_wait_all( struct UG_vacuumer* vacuumer ) {
 }
 
 
+// get the vacuumer's counters 
+// always succeeds
+int UG_vacuumer_get_stats( struct UG_vacuumer* vacuumer, struct UG_vacuumer_stats* stats ) {
+   
+   pthread_rwlock_rdlock( &vacuumer->lock );
+   
+   *stats = vacuumer->stats;
+   stats->backlog = vacuumer->vacuum_queue->size() + vacuumer->num_in_flight;
+   
+   pthread_rwlock_unlock( &vacuumer->lock );
+   
+   return 0;
+}
+
+
 // stop vacuuming 
-// return 0 if we stopped the thread
-// return -ESRCH if the thread isn't running (indicates a bug)
+// return 0 if we stopped the threads
+// return -ESRCH if a thread isn't running (indicates a bug)
 // return -EDEADLK if we would deadlock 
-// return -EINVAL if the thread ID is invalid (this is a bug; it should never happen)
+// return -EINVAL if a thread ID is invalid (this is a bug; it should never happen)
 // return -EINVAL if the vacuumer is NULL
 int UG_vacuumer_stop( struct UG_vacuumer* vacuumer ) {
    
-   int rc = 0;
    if( vacuumer == NULL ) {
       return -EINVAL;
    }
@@ -938,20 +1396,7 @@ int UG_vacuumer_stop( struct UG_vacuumer* vacuumer ) {
    vacuumer->quiesce = true;
    vacuumer->running = false;
    
-   rc = pthread_cancel( vacuumer->thread );
-   if( rc != 0 ) {
-      
-      // -ESRCH
-      return -abs(rc);
-   }
-   
-   rc = pthread_join( vacuumer->thread, NULL );
-   if( rc != 0 ) {
-      
-      return -abs(rc);
-   }
-   
-   return 0;
+   return UG_vacuumer_join_workers( vacuumer, vacuumer->num_threads );
 }
 
 
@@ -969,9 +1414,12 @@ int UG_vacuumer_shutdown( struct UG_vacuumer* vacuumer ) {
    }
    
    SG_safe_delete( vacuumer->vacuum_queue );
+   SG_safe_delete( vacuumer->busy_files );
+   SG_safe_free( vacuumer->threads );
    pthread_rwlock_destroy( &vacuumer->lock );
+   pthread_mutex_destroy( &vacuumer->busy_lock );
+   pthread_cond_destroy( &vacuumer->busy_cond );
    sem_destroy( &vacuumer->sem );
    
    return 0;
 }
-
@@ -28,8 +28,29 @@ struct UG_state;
 struct UG_vacuum_context;
 struct UG_vacuumer;
 
+// number of threads that vacuum concurrently
+#define UG_VACUUMER_NUM_WORKERS         4
+
+// maximum number of vacuum contexts a worker takes at once.
+// contexts in a batch that vacuum the same file version share one DELETECHUNKS request, and all of the batch's vacuum log entries are cleared together.
+// contexts that look up their blocks from the MS vacuum log run one per file at a time; contexts with their own replaced blocks are batched freely.
+#define UG_VACUUMER_MAX_BATCH           64
+
+// how often (in seconds) idle workers look for vacuum contexts whose retry deadline has passed
+#define UG_VACUUMER_POLL_INTERVAL       1
+
 // queue of vacuum requests 
-typedef queue<struct UG_vacuum_context*> UG_vacuum_queue_t;
+typedef list<struct UG_vacuum_context*> UG_vacuum_queue_t;
+
+// vacuumer counters
+struct UG_vacuumer_stats {
+
+   uint64_t backlog;            // vacuum contexts queued or being worked on
+   uint64_t bytes_pending;      // bytes of blocks known to need vacuuming, across the backlog
+   uint64_t batches;            // batches run
+   uint64_t deletechunks;       // DELETECHUNKS requests sent (each goes to every RG)
+   uint64_t log_removals;       // vacuum log entries cleared from the MS
+};
 
 extern "C" {
 
@@ -51,6 +72,9 @@ int UG_vacuumer_stop( struct UG_vacuumer* vacuumer );
 // shut down a vacuumer 
 int UG_vacuumer_shutdown( struct UG_vacuumer* vacuumer );
 
+// get vacuumer counters 
+int UG_vacuumer_get_stats( struct UG_vacuumer* vacuumer, struct UG_vacuumer_stats* stats );
+
 // set up a vacuum context
 int UG_vacuum_context_init( struct UG_vacuum_context* vctx, struct UG_state* ug, char const* fs_path, struct UG_inode* inode, struct SG_manifest* replaced_blocks );
 int UG_vacuum_context_set_unlinking( struct UG_vacuum_context* vctx, bool unlinking );
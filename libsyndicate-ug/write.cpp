@@ -124,7 +124,7 @@ int UG_write_read_partial_setup( struct SG_gateway* gateway, char const* fs_path
       block_id = offset / block_size;
       
       // make a head buffer 
-      buf = SG_CALLOC( char, block_size );
+      buf = md_bufpool_calloc( block_size );
       if( buf == NULL ) {
          
          return -ENOMEM;
@@ -136,7 +136,7 @@ int UG_write_read_partial_setup( struct SG_gateway* gateway, char const* fs_path
       rc = UG_write_setup_partial_block_buffer( inode, block_id, buf, block_size, &partial_blocks );
       if( rc != 0 ) {
          
-         SG_safe_free( buf ); 
+         SG_pool_safe_free( buf ); 
          UG_dirty_block_map_free( &partial_blocks );
          
          return rc;
@@ -152,7 +152,7 @@ int UG_write_read_partial_setup( struct SG_gateway* gateway, char const* fs_path
       block_id = (offset + buf_len) / block_size;
       
       // make a tail buffer 
-      buf = SG_CALLOC( char, block_size );
+      buf = md_bufpool_calloc( block_size );
       if( buf == NULL ) {
          
          return -ENOMEM;
@@ -164,7 +164,7 @@ int UG_write_read_partial_setup( struct SG_gateway* gateway, char const* fs_path
       rc = UG_write_setup_partial_block_buffer( inode, block_id, buf, block_size, &partial_blocks );
       if( rc != 0 ) {
          
-         SG_safe_free( buf );
+         SG_pool_safe_free( buf );
          
          UG_dirty_block_map_free( &partial_blocks );
          
@@ -197,69 +197,39 @@ int UG_write_read_partial_setup( struct SG_gateway* gateway, char const* fs_path
    return 0;
 }
 
-// allocate and download the existing but partially-overwitten blocks of the write.
-// merge the relevant portions of buf into them.
+// set up the existing but partially-overwritten blocks of the write, and fill in the ones we have locally (i.e. dirty or cached).
 // dirty_blocks must NOT contain the affected blocks--they will be allocated and put in place by this method.
+// the blocks that must be downloaded are put into *blocks_not_local (pass it to UG_read_blocks_remote once inode->entry is unlocked)
 // return 0 on success 
-// return -EINVAL if we don't have block info in the inode's block manifest for the unaligned blocks
 // return -errno on failure 
 // NOTE: inode->entry must be read-locked
-static int UG_write_read_partial_blocks( struct SG_gateway* gateway, char const* fs_path, struct UG_inode* inode, size_t buf_len, off_t offset, UG_dirty_block_map_t* dirty_blocks ) {
+// NOTE: the caller must free dirty_blocks, even if this method fails
+static int UG_write_read_partial_blocks_local( struct SG_gateway* gateway, char const* fs_path, struct UG_inode* inode, size_t buf_len, off_t offset, UG_dirty_block_map_t* dirty_blocks, struct SG_manifest* blocks_not_local ) {
    
    int rc = 0;
-   UG_dirty_block_map_t partial_blocks;
 
    // set up read on partial blocks
-   rc = UG_write_read_partial_setup( gateway, fs_path, inode, buf_len, offset, &partial_blocks );
+   rc = UG_write_read_partial_setup( gateway, fs_path, inode, buf_len, offset, dirty_blocks );
    if( rc < 0 ) {
 
       SG_error("UG_read_unaligned_setup( %" PRIX64 ".%" PRId64 " (%s) ) rc = %d\n", UG_inode_file_id( inode ), UG_inode_file_version( inode ), fs_path, rc );
       return rc;
    }
 
-   if( partial_blocks.size() == 0 ) {
+   if( dirty_blocks->size() == 0 ) {
       // no existing partial blocks 
       SG_debug("%s", "No existing partial blocks to fetch\n");
       return 0;
    }
  
-   // get the blocks
-   rc = UG_read_blocks( gateway, fs_path, inode, &partial_blocks, offset, buf_len );
+   // get the blocks we have 
+   rc = UG_read_blocks_local( gateway, fs_path, inode, dirty_blocks, offset, buf_len, blocks_not_local );
    if( rc != 0 ) {
    
-      SG_error("UG_read_blocks( %" PRIX64 ".%" PRId64 " (%s) ) rc = %d\n", UG_inode_file_id( inode ), UG_inode_file_version( inode ), fs_path, rc );
-      
-      UG_dirty_block_map_free( &partial_blocks );
-      
+      SG_error("UG_read_blocks_local( %" PRIX64 ".%" PRId64 " (%s) ) rc = %d\n", UG_inode_file_id( inode ), UG_inode_file_version( inode ), fs_path, rc );
       return rc;
    }
    
-   // transfer data over 
-   for( UG_dirty_block_map_t::iterator itr = partial_blocks.begin(); itr != partial_blocks.end(); ) {
-      
-      char data[21];
-      memset( data, 0, 21 );
-      memcpy( data, UG_dirty_block_buf( &itr->second )->data, 20 );
-
-      SG_debug("Partial: %" PRIX64 "[%" PRId64 "], data = '%s'\n", UG_inode_file_id( inode ), itr->first, data );
-
-      try {
-         (*dirty_blocks)[ itr->first ] = itr->second;
-      }
-      catch( bad_alloc& ba ) {
-         
-         rc = -ENOMEM;
-         
-         UG_dirty_block_map_free( &partial_blocks );
-         break;
-      }
-      
-      UG_dirty_block_map_t::iterator old_itr = itr;
-      itr++;
-      
-      partial_blocks.erase( old_itr );
-   }
-   
    return rc;
 }
 
@@ -309,7 +279,7 @@ static int UG_write_partial_merge_data( char* buf, size_t buf_len, off_t offset,
 
           memset( &head_data, 0, sizeof(struct SG_chunk) );
           head_data.len = block_size;
-          head_data.data = SG_CALLOC( char, block_size );
+          head_data.data = md_bufpool_calloc( block_size );
           if( head_data.data == NULL ) {
 
              return -ENOMEM;
@@ -381,7 +351,7 @@ static int UG_write_partial_merge_data( char* buf, size_t buf_len, off_t offset,
 
           memset( &tail_data, 0, sizeof(struct SG_chunk) );
           tail_data.len = block_size;
-          tail_data.data = SG_CALLOC( char, block_size );
+          tail_data.data = md_bufpool_calloc( block_size );
           if( tail_data.data == NULL ) {
 
              return -ENOMEM;
@@ -526,8 +496,94 @@ static int UG_write_aligned_setup( struct UG_inode* inode, char* buf, size_t buf
 }
 
 
+// flush a write's dirty blocks to the cache, so their hashes can be merged into the inode's manifest later (i.e. by UG_write_dirty_blocks_merge).
+// blocks that are already flushed are skipped.
+// return 0 on success
+// return -ENOMEM on OOM 
+// return -errno on failure to flush; blocks that were flushed before the failure stay flushed
+// NOTE: inode->entry does not need to be locked, but the caller must hold the block range lock on dirty_blocks (see UG_inode_block_range_lock)
+static int UG_write_dirty_blocks_flush( struct SG_gateway* gateway, char const* fs_path, uint64_t file_id, int64_t file_version, UG_dirty_block_map_t* dirty_blocks, uint64_t offset, uint64_t len ) {
+   
+   int rc = 0;
+   int flush_rc = 0;
+   struct SG_IO_hints io_hints;
+   
+   SG_IO_hints_init( &io_hints, SG_IO_WRITE, offset, len );
+   
+   // start flushing 
+   for( UG_dirty_block_map_t::iterator itr = dirty_blocks->begin(); itr != dirty_blocks->end(); itr++ ) {
+      
+      struct UG_dirty_block* block = &itr->second;
+      
+      if( UG_dirty_block_is_flushed( block ) ) {
+         continue;
+      }
+      
+      // make sure this dirty block has its own copy of the RAM buffer
+      if( !UG_dirty_block_unshared( block ) ) {
+         
+         rc = UG_dirty_block_buf_unshare( block );
+         if( rc != 0 ) {
+            
+            // OOM 
+            break;
+         }
+      }
+      
+      // serialize and send to disk
+      // NOTE: this will update the block's hash 
+      rc = UG_dirty_block_flush_async( gateway, fs_path, file_id, file_version, block, &io_hints );
+      if( rc != 0 ) {
+         
+         SG_error("UG_dirty_block_flush_async( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", 
+                  file_id, file_version, UG_dirty_block_id( block ), UG_dirty_block_version( block ), rc );
+         break;
+      }
+   }
+   
+   // finish flushing whatever we started, even on error, so no block is freed while the cache still writes it
+   for( UG_dirty_block_map_t::iterator itr = dirty_blocks->begin(); itr != dirty_blocks->end(); itr++ ) {
+      
+      struct UG_dirty_block* block = &itr->second;
+      
+      if( !UG_dirty_block_is_flushing( block ) ) {
+         continue;
+      }
+      
+      // NOTE: regenerates block hash 
+      flush_rc = UG_dirty_block_flush_finish( block );
+      if( flush_rc != 0 ) {
+         
+         SG_error("UG_dirty_block_flush_finish( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", 
+                  file_id, file_version, UG_dirty_block_id( block ), UG_dirty_block_version( block ), flush_rc );
+         
+         if( rc == 0 ) {
+            rc = flush_rc;
+         }
+      }
+   }
+   
+   return rc;
+}
+
+
+// evict a write's flushed blocks from the cache, i.e. if they could not be merged into the inode
+// always succeeds
+static int UG_write_dirty_blocks_evict( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, UG_dirty_block_map_t* dirty_blocks ) {
+   
+   for( UG_dirty_block_map_t::iterator itr = dirty_blocks->begin(); itr != dirty_blocks->end(); itr++ ) {
+      
+      if( UG_dirty_block_is_flushed( &itr->second ) ) {
+         md_cache_evict_block( cache, file_id, file_version, itr->first, UG_dirty_block_version( &itr->second ) );
+      }
+   }
+   
+   return 0;
+}
+
+
 // merge dirty blocks back into an inode, i.e. on write, or on failure to replicate.
-// this flushes each block to disk, and updates its hash in the inode's manifest.
+// this flushes each block to disk (unless it was already flushed with UG_write_dirty_blocks_flush), and updates its hash in the inode's manifest.
 // coalesce while we do it--free up blocks that do not have to be replicated.
 // (i.e. file was reversioned --> drop all blocks beyond the size; block was overwritten --> drop old block).
 // preserve vacuum information for every block we overwrite (NOTE: blocks will only be overwritten on conflict if overwrite is true)
@@ -556,34 +612,6 @@ int UG_write_dirty_blocks_merge( struct SG_gateway* gateway, char const* fs_path
       uint64_t block_id = itr->first;
       struct UG_dirty_block* block = &itr->second;
 
-      // sanity check: block must be dirty
-      if( !UG_dirty_block_dirty( block ) ) {
-         
-         SG_error("FATAL BUG: dirty block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] is not dirty\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version(block) );
-         exit(1); 
-      }
-      
-      // sanity check: block must be in RAM
-      if( !UG_dirty_block_in_RAM( block ) ) {
-
-         SG_error("FATAL BUG: Not in RAM: %" PRIX64 "[%" PRId64 ".%" PRId64 "]\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version( block ) );
-         exit(1);
-      }
-
-      // sanity check: block must not be flushing 
-      if( UG_dirty_block_is_flushing( block ) ) {
-
-         SG_error("FATAL BUG: dirty block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] is already flushed\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version( block ) );
-         exit(1);
-      }
-
-      // sanity check: block must not be mmaped 
-      if( UG_dirty_block_mmaped( block ) ) {
-
-         SG_error("FATAL BUG: dirty block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] is mmaped\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version( block ) );
-         exit(1);
-      }
-
       // don't include if the file was truncated before we could merge dirty data 
       if( file_version != UG_inode_file_version( inode ) ) {
          
@@ -613,6 +641,41 @@ int UG_write_dirty_blocks_merge( struct SG_gateway* gateway, char const* fs_path
          continue;
       }
 
+      // already flushed (i.e. by the writer, outside of the inode lock)?
+      if( UG_dirty_block_is_flushed( block ) ) {
+         
+         itr++;
+         continue;
+      }
+      
+      // sanity check: block must be dirty
+      if( !UG_dirty_block_dirty( block ) ) {
+         
+         SG_error("FATAL BUG: dirty block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] is not dirty\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version(block) );
+         exit(1); 
+      }
+      
+      // sanity check: block must be in RAM
+      if( !UG_dirty_block_in_RAM( block ) ) {
+
+         SG_error("FATAL BUG: Not in RAM: %" PRIX64 "[%" PRId64 ".%" PRId64 "]\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version( block ) );
+         exit(1);
+      }
+
+      // sanity check: block must not be flushing 
+      if( UG_dirty_block_is_flushing( block ) ) {
+
+         SG_error("FATAL BUG: dirty block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] is already flushed\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version( block ) );
+         exit(1);
+      }
+
+      // sanity check: block must not be mmaped 
+      if( UG_dirty_block_mmaped( block ) ) {
+
+         SG_error("FATAL BUG: dirty block %" PRIX64 "[%" PRIu64 ".%" PRId64 "] is mmaped\n", UG_inode_file_id( inode ), block_id, UG_dirty_block_version( block ) );
+         exit(1);
+      }
+
       // make sure the block has a private copy of its RAM buffer, if it has one at all
       if( !UG_dirty_block_unshared( block ) ) {
          
@@ -646,13 +709,16 @@ int UG_write_dirty_blocks_merge( struct SG_gateway* gateway, char const* fs_path
       struct UG_dirty_block* block = &itr->second;
 
       // finish flushing (NOTE: regenerates block hash)
-      rc = UG_dirty_block_flush_finish( block );
-      if( rc != 0 ) {
+      if( !UG_dirty_block_is_flushed( block ) ) {
          
-         SG_error("UG_dirty_block_flush_finish( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", 
-                  UG_inode_file_id( inode ), UG_inode_file_version( inode ), UG_dirty_block_id( block ), UG_dirty_block_version( block ), rc );
-        
-         return rc; 
+         rc = UG_dirty_block_flush_finish( block );
+         if( rc != 0 ) {
+            
+            SG_error("UG_dirty_block_flush_finish( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", 
+                     UG_inode_file_id( inode ), UG_inode_file_version( inode ), UG_dirty_block_id( block ), UG_dirty_block_version( block ), rc );
+         
+            return rc; 
+         }
       }
  
       // insert this dirty block into the manifest, and retain info from the old version of this block so we can garbage-collect it later. 
@@ -684,7 +750,7 @@ int UG_write_dirty_blocks_merge( struct SG_gateway* gateway, char const* fs_path
 // return 0 on success
 // return -ENOMEM on OOM
 // return -errno on failure to read unaligned blocks or flush data to cache
-// NOTE: fent should not be locked
+// NOTE: fent should not be locked.  It is only held while we set up and merge blocks; fetching and flushing them happens under the inode's block range lock instead.
 int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_metadata, struct fskit_entry* fent, char* buf, size_t buf_len, off_t offset, void* handle_data ) {
   
    SG_debug("Write %zu bytes at %jd\n", buf_len, offset );
@@ -695,12 +761,20 @@ int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_m
    struct SG_gateway* gateway = (struct SG_gateway*)fskit_core_get_user_data( core );
    
    UG_dirty_block_map_t write_blocks;                   // all the blocks we'll write.
+   UG_dirty_block_map_t aligned_blocks;                 // blocks wholly overwritten by buf
+   UG_dirty_block_map_t last_block;                     // the last block written, which we keep in RAM
+   struct SG_manifest blocks_to_download;               // unaligned blocks we don't have locally
    
    uint64_t gateway_id = SG_gateway_id( gateway );
    struct ms_client* ms = SG_gateway_ms( gateway );
    uint64_t block_size = ms_client_get_volume_blocksize( ms );
+   struct md_syndicate_cache* cache = SG_gateway_cache( gateway );
+   uint64_t coordinator_id = 0;
+   int64_t layout_version = 0;
    
    struct timespec ts;
+   
+   memset( &blocks_to_download, 0, sizeof(struct SG_manifest) );
 
    char* fs_path = fskit_route_metadata_get_path( route_metadata );
    
@@ -716,7 +790,8 @@ int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_m
 
    fskit_entry_unlock(fent);
   
-   // ID of the last block written 
+   // IDs of the first and last blocks written 
+   uint64_t first_block_id = offset / block_size;
    uint64_t last_block_id = (offset + buf_len) / block_size;
    
    // handle supports write?
@@ -783,64 +858,171 @@ int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_m
       fskit_entry_unlock( fent );
    }
    
-   fskit_entry_wlock( fent );
-   
-   inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
-   uint64_t coordinator_id = UG_inode_coordinator_id( inode );
-   
-   // get unaligned blocks 
-   // TODO: is there a way we can avoid keeping fent locked through all of this?
-   rc = UG_write_read_partial_blocks( gateway, fs_path, inode, buf_len, offset, &write_blocks );
+   // serialize with other writes to these blocks, so we can drop the inode lock while we fetch, merge, and flush them.
+   // non-overlapping writes and reads proceed in parallel.
+   rc = UG_inode_block_range_lock( inode, first_block_id, last_block_id );
    if( rc != 0 ) {
       
-      fskit_entry_unlock( fent );
-      SG_error("UG_write_read_unaligned_blocks( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
-      
+      SG_error("UG_inode_block_range_lock( %" PRIX64 "[%" PRIu64 " - %" PRIu64 "] ) rc = %d\n", file_id, first_block_id, last_block_id, rc );
       return rc;
    }
-
-   // merge data into unaligned blocks 
-   rc = UG_write_partial_merge_data( buf, buf_len, offset, block_size, &write_blocks );
-   if( rc != 0 ) {
-       
-      fskit_entry_unlock( fent );
-      
-      // bug 
-      SG_error("BUG: UG_write_unaligned_merge_data( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
-      exit(1);
-   }
    
-   // direct buf to aligned block writes
-   rc = UG_write_aligned_setup( inode, buf, buf_len, offset, block_size, &write_blocks );
-   if( rc != 0 ) {
-       
+   while( true ) {
+      
+      fskit_entry_rlock( fent );
+      
+      inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
+      file_version = UG_inode_file_version( inode );
+      layout_version = UG_inode_layout_version( inode );
+      
+      rc = SG_manifest_init( &blocks_to_download, UG_inode_volume_id( inode ), UG_inode_coordinator_id( inode ), file_id, file_version );
+      if( rc != 0 ) {
+         
+         fskit_entry_unlock( fent );
+         goto UG_write_impl_out;
+      }
+      
+      // get unaligned blocks, as far as we have them locally 
+      rc = UG_write_read_partial_blocks_local( gateway, fs_path, inode, buf_len, offset, &write_blocks, &blocks_to_download );
+      if( rc != 0 ) {
+         
+         fskit_entry_unlock( fent );
+         SG_error("UG_write_read_partial_blocks_local( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
+         
+         goto UG_write_impl_out;
+      }
+      
+      // direct buf to aligned block writes
+      rc = UG_write_aligned_setup( inode, buf, buf_len, offset, block_size, &aligned_blocks );
+      if( rc != 0 ) {
+         
+         fskit_entry_unlock( fent );
+         SG_error("UG_write_aligned_setup( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
+         
+         goto UG_write_impl_out;
+      }
+      
+      // don't hold the lock during network or disk I/O
       fskit_entry_unlock( fent );
       
-      SG_error("UG_write_aligned_setup( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
+      // get the rest of the unaligned blocks 
+      if( SG_manifest_get_block_count( &blocks_to_download ) > 0 ) {
+         
+         rc = UG_read_blocks_remote( gateway, fs_path, &blocks_to_download, &write_blocks );
+         if( rc != 0 ) {
+            
+            SG_error("UG_read_blocks_remote( %" PRIX64 ".%" PRId64 "[%" PRIu64 " - %" PRIu64 "] ) rc = %d\n", file_id, file_version, first_block_id, last_block_id, rc );
+            goto UG_write_impl_out;
+         }
+      }
+      
+      SG_manifest_free( &blocks_to_download );
+      
+      // merge data into unaligned blocks 
+      rc = UG_write_partial_merge_data( buf, buf_len, offset, block_size, &write_blocks );
+      if( rc != 0 ) {
+         
+         // bug 
+         SG_error("BUG: UG_write_unaligned_merge_data( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
+         exit(1);
+      }
+      
+      // combine with aligned blocks 
+      for( UG_dirty_block_map_t::iterator itr = aligned_blocks.begin(); itr != aligned_blocks.end(); ) {
+         
+         try {
+            write_blocks[ itr->first ] = itr->second;
+         }
+         catch( bad_alloc& ba ) {
+            
+            rc = -ENOMEM;
+            goto UG_write_impl_out;
+         }
+         
+         UG_dirty_block_map_t::iterator old_itr = itr;
+         itr++;
+         
+         aligned_blocks.erase( old_itr );
+      }
+      
+      SG_debug("%s: write blocks %" PRIu64 " through %" PRIu64 "\n", fs_path, write_blocks.begin()->first, write_blocks.rbegin()->first );
+      
+      // mark all modified blocks as dirty...
+      for( UG_dirty_block_map_t::iterator itr = write_blocks.begin(); itr != write_blocks.end(); itr++ ) {
+         UG_dirty_block_set_dirty( &itr->second, true );
+      }
+      
+      // don't flush the last block; keep it in RAM, so a subsequent write does not need to fetch it from disk.
+      UG_dirty_block_map_t::iterator itr = write_blocks.find( last_block_id );
+      if( itr != write_blocks.end() && UG_dirty_block_in_RAM( &itr->second ) ) {
+         
+         try {
+            last_block[ itr->first ] = itr->second;
+         }
+         catch( bad_alloc& ba ) {
+            
+            rc = -ENOMEM;
+            goto UG_write_impl_out;
+         }
+         
+         write_blocks.erase( itr );
+      }
+      
+      // flush the rest of the written blocks, so only their hashes need to be merged under the lock
+      while( true ) {
+         
+         rc = UG_write_dirty_blocks_flush( gateway, fs_path, file_id, file_version, &write_blocks, offset, buf_len );
+         if( rc == -ENOMEM ) {
+            
+            // try again 
+            continue;
+         }
+         
+         break;
+      }
+      
+      if( rc != 0 ) {
+         
+         SG_error("UG_write_dirty_blocks_flush( %s, %zu, %jd ) rc = %d\n", fs_path, buf_len, offset, rc );
+         
+         UG_write_dirty_blocks_evict( cache, file_id, file_version, &write_blocks );
+         rc = -EIO;
+         goto UG_write_impl_out;
+      }
+      
+      fskit_entry_wlock( fent );
+      
+      // was the file truncated, reversioned, or its manifest reloaded while we were unlocked?
+      if( file_version == UG_inode_file_version( inode ) && layout_version == UG_inode_layout_version( inode ) ) {
+         
+         // nope 
+         break;
+      }
+      
+      // start over, from the new manifest.
+      // (the reversion may have moved our flushed blocks along with the rest of the file)
+      SG_debug("%" PRIX64 ": changed during write of %" PRIu64 " - %" PRIu64 "; retrying\n", file_id, first_block_id, last_block_id );
+      
+      UG_write_dirty_blocks_evict( cache, file_id, file_version, &write_blocks );
+      UG_write_dirty_blocks_evict( cache, file_id, UG_inode_file_version( inode ), &write_blocks );
+      
+      fskit_entry_unlock( fent );
       
       UG_dirty_block_map_free( &write_blocks );
-      return rc;
+      UG_dirty_block_map_free( &last_block );
    }
-  
-   SG_debug("%s: write blocks %" PRIu64 " through %" PRIu64 "\n", fs_path, write_blocks.begin()->first, write_blocks.rbegin()->first );
-
-   // mark all modified blocks as dirty...
-   for( UG_dirty_block_map_t::iterator itr = write_blocks.begin(); itr != write_blocks.end(); itr++ ) {
-      UG_dirty_block_set_dirty( &itr->second, true );
-   }
-
-   // don't flush the last block; keep it in RAM, so a subsequent write does not need to fetch it from disk.
-   // Instead, just add it to the inode's set of dirty blocks.
-   // Do not commit it.
-   UG_dirty_block_map_t::iterator itr = write_blocks.find( last_block_id );
-   if( itr != write_blocks.end() && UG_dirty_block_in_RAM( &itr->second ) ) {
+   
+   // inode->entry is write-locked
+   coordinator_id = UG_inode_coordinator_id( inode );
+   
+   // put the last block into the inode's set of dirty blocks, but do not commit it.
+   if( last_block.size() > 0 ) {
       
-      struct UG_dirty_block* last_dirty_block = &itr->second;
+      struct UG_dirty_block* last_dirty_block = &last_block.begin()->second;
    
       SG_debug("Keep in RAM block %" PRIX64 "[%" PRIu64 ".%" PRId64 "]\n",
              UG_inode_file_id( inode ), UG_dirty_block_id( last_dirty_block ), UG_dirty_block_version( last_dirty_block ) );
 
-      // put into dirty blocks
       rc = UG_inode_dirty_block_put( gateway, inode, last_dirty_block, true );
       if( rc != 0 ) {
 
@@ -848,14 +1030,16 @@ int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_m
              UG_inode_file_id( inode ), UG_dirty_block_id( last_dirty_block ), UG_dirty_block_version( last_dirty_block ), rc );
 
         fskit_entry_unlock( fent );
-        UG_dirty_block_map_free( &write_blocks );
-        return -EIO;
+        
+        UG_write_dirty_blocks_evict( cache, file_id, file_version, &write_blocks );
+        rc = -EIO;
+        goto UG_write_impl_out;
       }
 
-      write_blocks.erase( itr );
+      last_block.clear();
    }
 
-   // flush the rest of the written blocks, and synchronize them with the manifest.
+   // synchronize the flushed blocks with the manifest.
    // back up the old dirty block and old replicated block data, so we can evict and vacuum them (respectively)
    while( write_blocks.size() > 0 ) {
       
@@ -884,8 +1068,10 @@ int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_m
    if( rc != 0 ) {
 
       fskit_entry_unlock( fent );
-      UG_dirty_block_map_free( &write_blocks );
-      return -EIO;
+      
+      UG_write_dirty_blocks_evict( cache, file_id, file_version, &write_blocks );
+      rc = -EIO;
+      goto UG_write_impl_out;
    }
 
    // update timestamps
@@ -908,10 +1094,23 @@ int UG_write_impl( struct fskit_core* core, struct fskit_route_metadata* route_m
 
    // will need to contact MS with new metadata
    UG_inode_set_dirty( inode, true );
+   
+   // don't serve the old signed manifest
+   SG_server_manifest_cache_invalidate( gateway, UG_inode_file_id( inode ) );
 
    SG_debug("%" PRIX64 " has %zu dirty blocks, and is now %" PRIu64 " bytes\n", UG_inode_file_id( inode ), UG_inode_dirty_blocks( inode )->size(), fskit_entry_get_size( fent ) );
    
    fskit_entry_unlock( fent );
+   
+UG_write_impl_out:
+   
+   UG_inode_block_range_unlock( inode, first_block_id, last_block_id );
+   
+   UG_dirty_block_map_free( &write_blocks );
+   UG_dirty_block_map_free( &aligned_blocks );
+   UG_dirty_block_map_free( &last_block );
+   SG_manifest_free( &blocks_to_download );
+   
    if( rc >= 0 ) {
       return buf_len;
    }
@@ -1019,6 +1218,9 @@ int UG_write_patch_manifest( struct SG_gateway* gateway, struct SG_request_data*
 
    rc = UG_inode_manifest_merge_blocks( gateway, inode, &new_manifest );
    SG_manifest_free( &new_manifest );
+   
+   // don't serve the old signed manifest
+   SG_server_manifest_cache_invalidate( gateway, file_id );
 
    if( rc != 0 ) {
 
@@ -176,9 +176,7 @@ static ssize_t UG_xattr_get_cached_blocks( struct fskit_core* core, struct fskit
    struct SG_gateway* gateway = (struct SG_gateway*)fskit_core_get_user_data( core );
    struct ms_client* ms = SG_gateway_ms( gateway );
    uint64_t block_size = ms_client_get_volume_blocksize( ms );
-   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
    struct UG_inode* inode = (struct UG_inode*)fskit_entry_get_user_data( fent );
-   uint64_t volume_id = ms_client_get_volume_id( ms );
    
    off_t num_blocks = (fskit_entry_get_size( fent ) / block_size) + ((fskit_entry_get_size( fent ) % block_size) == 0 ? 0 : 1);
    
@@ -196,17 +194,8 @@ static ssize_t UG_xattr_get_cached_blocks( struct fskit_core* core, struct fskit
       }
    }
    
-   char* cached_file_path = NULL;
    ssize_t rc = 0;
    
-   char* cached_file_url = md_url_local_file_url( conf->data_root, volume_id, UG_inode_file_id( inode ), UG_inode_file_version( inode ) );
-   if( cached_file_url == NULL ) {
-      
-      return -ENOMEM;
-   }
-   
-   cached_file_path = SG_URL_LOCAL_PATH( cached_file_url );
-   
    // enough space...
    if( buf_len > 0 ) {
       
@@ -214,9 +203,7 @@ static ssize_t UG_xattr_get_cached_blocks( struct fskit_core* core, struct fskit
       buf[buf_len - 1] = '\0';
    }
    
-   rc = md_cache_file_blocks_apply( cached_file_path, local::xattr_stat_block, buf );
-   
-   free( cached_file_url );
+   rc = md_cache_file_blocks_apply_by_id( SG_gateway_cache( gateway ), UG_inode_file_id( inode ), UG_inode_file_version( inode ), local::xattr_stat_block, buf );
    
    if( rc == 0 ) {
       
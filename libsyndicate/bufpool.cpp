@@ -0,0 +1,512 @@
+/*
+   Copyright 2014 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "libsyndicate/bufpool.h"
+
+#include <sys/mman.h>
+
+typedef map<uintptr_t, struct md_bufpool_slab*> md_bufpool_slab_map_t;
+typedef vector<struct md_bufpool*> md_bufpool_list_t;
+
+// all pools and slabs, so any buffer can be traced back to its pool
+static md_bufpool_list_t* md_bufpool_pools = NULL;
+static md_bufpool_slab_map_t* md_bufpool_slabs = NULL;
+static pthread_rwlock_t md_bufpool_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+// which free list the calling thread uses
+static __thread int md_bufpool_thread_shard = -1;
+static int md_bufpool_next_shard = 0;
+
+
+// get the calling thread's free list index
+static int md_bufpool_shard_id(void) {
+
+   if( md_bufpool_thread_shard < 0 ) {
+      md_bufpool_thread_shard = __sync_fetch_and_add( &md_bufpool_next_shard, 1 ) % MD_BUFPOOL_NUM_SHARDS;
+   }
+
+   return md_bufpool_thread_shard;
+}
+
+
+// find the pool whose buffers best fit len bytes.
+// a pool fits if len is no bigger than its buffers, but more than half their size (so we don't waste most of a block on a small allocation)
+// md_bufpool_lock must be read-locked
+// return the pool on success
+// return NULL if no pool fits
+static struct md_bufpool* md_bufpool_find( size_t len ) {
+
+   struct md_bufpool* best = NULL;
+
+   if( md_bufpool_pools == NULL ) {
+      return NULL;
+   }
+
+   for( md_bufpool_list_t::iterator itr = md_bufpool_pools->begin(); itr != md_bufpool_pools->end(); itr++ ) {
+
+      struct md_bufpool* pool = *itr;
+      if( len <= pool->buf_size && len > pool->buf_size / 2 && (best == NULL || pool->buf_size < best->buf_size) ) {
+         best = pool;
+      }
+   }
+
+   return best;
+}
+
+
+// find the slab that holds a buffer
+// md_bufpool_lock must be read-locked
+// return the slab on success
+// return NULL if the buffer is not pooled
+static struct md_bufpool_slab* md_bufpool_slab_lookup( char const* buf ) {
+
+   if( md_bufpool_slabs == NULL || md_bufpool_slabs->size() == 0 ) {
+      return NULL;
+   }
+
+   md_bufpool_slab_map_t::iterator itr = md_bufpool_slabs->upper_bound( (uintptr_t)buf );
+   if( itr == md_bufpool_slabs->begin() ) {
+      return NULL;
+   }
+
+   itr--;
+
+   struct md_bufpool_slab* slab = itr->second;
+   if( (uintptr_t)buf >= (uintptr_t)slab->base + slab->len ) {
+      return NULL;
+   }
+
+   return slab;
+}
+
+
+// register a pool for blocks of a given size.  Its buffers are big enough to hold a block plus MD_BUFPOOL_SLACK bytes.
+// registering the same block size again just raises the pool's limit, if max_bufs is bigger.
+// if max_bufs is 0, do nothing (pooling is disabled).
+// return 0 on success
+// return -ENOMEM on OOM
+int md_bufpool_register( size_t block_size, int max_bufs ) {
+
+   struct md_bufpool* pool = NULL;
+   long page_size = sysconf( _SC_PAGESIZE );
+   size_t buf_size = block_size + MD_BUFPOOL_SLACK;
+
+   if( max_bufs <= 0 ) {
+      return 0;
+   }
+
+   // page-align, so each buffer starts on its own page
+   buf_size = ((buf_size + page_size - 1) / page_size) * page_size;
+
+   pthread_rwlock_wrlock( &md_bufpool_lock );
+
+   if( md_bufpool_pools == NULL ) {
+
+      md_bufpool_pools = SG_safe_new( md_bufpool_list_t() );
+      md_bufpool_slabs = SG_safe_new( md_bufpool_slab_map_t() );
+
+      if( md_bufpool_pools == NULL || md_bufpool_slabs == NULL ) {
+
+         SG_safe_delete( md_bufpool_pools );
+         SG_safe_delete( md_bufpool_slabs );
+
+         pthread_rwlock_unlock( &md_bufpool_lock );
+         return -ENOMEM;
+      }
+   }
+
+   for( md_bufpool_list_t::iterator itr = md_bufpool_pools->begin(); itr != md_bufpool_pools->end(); itr++ ) {
+
+      if( (*itr)->buf_size == buf_size ) {
+
+         // already have it
+         pthread_mutex_lock( &(*itr)->lock );
+         (*itr)->max_bufs = MAX( (*itr)->max_bufs, max_bufs );
+         pthread_mutex_unlock( &(*itr)->lock );
+
+         pthread_rwlock_unlock( &md_bufpool_lock );
+         return 0;
+      }
+   }
+
+   pool = SG_CALLOC( struct md_bufpool, 1 );
+   if( pool == NULL ) {
+
+      pthread_rwlock_unlock( &md_bufpool_lock );
+      return -ENOMEM;
+   }
+
+   pool->buf_size = buf_size;
+   pool->max_bufs = max_bufs;
+
+   for( int i = 0; i < MD_BUFPOOL_NUM_SHARDS; i++ ) {
+
+      pool->shards[i].free_bufs = SG_safe_new( vector<char*>() );
+      if( pool->shards[i].free_bufs == NULL ) {
+
+         for( int j = 0; j < i; j++ ) {
+            SG_safe_delete( pool->shards[j].free_bufs );
+         }
+
+         SG_safe_free( pool );
+         pthread_rwlock_unlock( &md_bufpool_lock );
+         return -ENOMEM;
+      }
+
+      pthread_mutex_init( &pool->shards[i].lock, NULL );
+   }
+
+   pthread_mutex_init( &pool->lock, NULL );
+
+   try {
+      md_bufpool_pools->push_back( pool );
+   }
+   catch( bad_alloc& ba ) {
+
+      for( int i = 0; i < MD_BUFPOOL_NUM_SHARDS; i++ ) {
+
+         pthread_mutex_destroy( &pool->shards[i].lock );
+         SG_safe_delete( pool->shards[i].free_bufs );
+      }
+
+      pthread_mutex_destroy( &pool->lock );
+      SG_safe_free( pool );
+
+      pthread_rwlock_unlock( &md_bufpool_lock );
+      return -ENOMEM;
+   }
+
+   pthread_rwlock_unlock( &md_bufpool_lock );
+
+   SG_debug("Buffer pool: %d buffers of %zu bytes\n", max_bufs, buf_size );
+   return 0;
+}
+
+
+// take a free buffer from a pool, preferring the calling thread's free list
+// return the buffer on success
+// return NULL if there are no free buffers
+static char* md_bufpool_take( struct md_bufpool* pool ) {
+
+   char* buf = NULL;
+   int shard_id = md_bufpool_shard_id();
+
+   for( int i = 0; i < MD_BUFPOOL_NUM_SHARDS && buf == NULL; i++ ) {
+
+      struct md_bufpool_shard* shard = &pool->shards[ (shard_id + i) % MD_BUFPOOL_NUM_SHARDS ];
+
+      pthread_mutex_lock( &shard->lock );
+
+      if( shard->free_bufs->size() > 0 ) {
+
+         buf = shard->free_bufs->back();
+         shard->free_bufs->pop_back();
+      }
+
+      pthread_mutex_unlock( &shard->lock );
+   }
+
+   return buf;
+}
+
+
+// put a buffer on the calling thread's free list.
+// never fails, since each free list reserves room for every buffer in the pool when the buffer is mapped
+static void md_bufpool_put( struct md_bufpool* pool, char* buf ) {
+
+   struct md_bufpool_shard* shard = &pool->shards[ md_bufpool_shard_id() ];
+
+   pthread_mutex_lock( &shard->lock );
+   shard->free_bufs->push_back( buf );
+   pthread_mutex_unlock( &shard->lock );
+}
+
+
+// map a new slab of buffers, if the pool is below its limit.
+// keep one buffer for the caller, and put the rest on the calling thread's free list.
+// return the caller's buffer on success
+// return NULL if the pool is at its limit, or on OOM
+static char* md_bufpool_grow( struct md_bufpool* pool ) {
+
+   int num_bufs = 0;
+   struct md_bufpool_slab* slab = NULL;
+   char* base = NULL;
+
+   pthread_mutex_lock( &pool->lock );
+
+   num_bufs = MIN( MD_BUFPOOL_BUFS_PER_SLAB, pool->max_bufs - pool->num_bufs );
+   if( num_bufs <= 0 ) {
+
+      pthread_mutex_unlock( &pool->lock );
+      return NULL;
+   }
+
+   slab = SG_CALLOC( struct md_bufpool_slab, 1 );
+   if( slab == NULL ) {
+
+      pthread_mutex_unlock( &pool->lock );
+      return NULL;
+   }
+
+   base = (char*)mmap( NULL, num_bufs * pool->buf_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+   if( base == MAP_FAILED ) {
+
+      SG_error("mmap(%zu) rc = %d\n", num_bufs * pool->buf_size, -errno );
+
+      SG_safe_free( slab );
+      pthread_mutex_unlock( &pool->lock );
+      return NULL;
+   }
+
+   slab->base = base;
+   slab->len = num_bufs * pool->buf_size;
+   slab->num_bufs = num_bufs;
+   slab->pool = pool;
+
+   // make sure every free list can hold every buffer, so returning a buffer never allocates
+   try {
+
+      for( int i = 0; i < MD_BUFPOOL_NUM_SHARDS; i++ ) {
+
+         pthread_mutex_lock( &pool->shards[i].lock );
+         pool->shards[i].free_bufs->reserve( pool->num_bufs + num_bufs );
+         pthread_mutex_unlock( &pool->shards[i].lock );
+      }
+
+      pthread_rwlock_wrlock( &md_bufpool_lock );
+      (*md_bufpool_slabs)[ (uintptr_t)base ] = slab;
+      pthread_rwlock_unlock( &md_bufpool_lock );
+   }
+   catch( bad_alloc& ba ) {
+
+      munmap( base, slab->len );
+      SG_safe_free( slab );
+
+      pthread_mutex_unlock( &pool->lock );
+      return NULL;
+   }
+
+   pool->num_bufs += num_bufs;
+
+   pthread_mutex_unlock( &pool->lock );
+
+   __sync_fetch_and_add( &pool->stats.slabs, 1 );
+
+   for( int i = 1; i < num_bufs; i++ ) {
+      md_bufpool_put( pool, base + i * pool->buf_size );
+   }
+
+   return base;
+}
+
+
+// allocate a buffer of at least len bytes.  Its contents are undefined.
+// if a pool fits len, the buffer comes from it; otherwise (or if the pool is exhausted) it comes from calloc.
+// either way, release it with md_bufpool_free.
+// return the buffer on success
+// return NULL on OOM
+char* md_bufpool_alloc( size_t len ) {
+
+   struct md_bufpool* pool = NULL;
+   char* buf = NULL;
+   bool reused = false;
+
+   pthread_rwlock_rdlock( &md_bufpool_lock );
+   pool = md_bufpool_find( len );
+   pthread_rwlock_unlock( &md_bufpool_lock );
+
+   if( pool == NULL ) {
+      return SG_CALLOC( char, MAX( len, 1 ) );
+   }
+
+   buf = md_bufpool_take( pool );
+   if( buf != NULL ) {
+      reused = true;
+   }
+   else {
+      buf = md_bufpool_grow( pool );
+   }
+
+   if( buf == NULL ) {
+
+      // exhausted
+      __sync_fetch_and_add( &pool->stats.fallbacks, 1 );
+      return SG_CALLOC( char, len );
+   }
+
+   __sync_fetch_and_add( &pool->stats.allocs, 1 );
+   __sync_fetch_and_add( &pool->stats.in_use, 1 );
+
+   if( reused ) {
+      __sync_fetch_and_add( &pool->stats.reuses, 1 );
+   }
+
+   return buf;
+}
+
+
+// allocate a zero-filled buffer of at least len bytes (see md_bufpool_alloc)
+// return the buffer on success
+// return NULL on OOM
+char* md_bufpool_calloc( size_t len ) {
+
+   char* buf = md_bufpool_alloc( len );
+   if( buf != NULL && md_bufpool_owns( buf ) ) {
+
+      // recycled buffers hold old data
+      memset( buf, 0, len );
+   }
+
+   return buf;
+}
+
+
+// recycle a buffer.
+// buffers that did not come from a pool are freed.
+void md_bufpool_free( char* buf ) {
+
+   struct md_bufpool_slab* slab = NULL;
+   struct md_bufpool* pool = NULL;
+
+   if( buf == NULL ) {
+      return;
+   }
+
+   pthread_rwlock_rdlock( &md_bufpool_lock );
+   slab = md_bufpool_slab_lookup( buf );
+   pthread_rwlock_unlock( &md_bufpool_lock );
+
+   if( slab == NULL ) {
+
+      free( buf );
+      return;
+   }
+
+   pool = slab->pool;
+   buf = slab->base + ((buf - slab->base) / pool->buf_size) * pool->buf_size;
+
+   md_bufpool_put( pool, buf );
+
+   __sync_fetch_and_add( &pool->stats.frees, 1 );
+   __sync_fetch_and_sub( &pool->stats.in_use, 1 );
+}
+
+
+// did a buffer come from a pool?
+bool md_bufpool_owns( char const* buf ) {
+
+   struct md_bufpool_slab* slab = NULL;
+
+   pthread_rwlock_rdlock( &md_bufpool_lock );
+   slab = md_bufpool_slab_lookup( buf );
+   pthread_rwlock_unlock( &md_bufpool_lock );
+
+   return (slab != NULL);
+}
+
+
+// get the allocation counters for the pool that would serve len bytes
+// return 0 on success
+// return -ENOENT if no pool serves len bytes
+int md_bufpool_get_stats( size_t len, struct md_bufpool_stats* stats ) {
+
+   struct md_bufpool* pool = NULL;
+
+   pthread_rwlock_rdlock( &md_bufpool_lock );
+   pool = md_bufpool_find( len );
+   pthread_rwlock_unlock( &md_bufpool_lock );
+
+   if( pool == NULL ) {
+      return -ENOENT;
+   }
+
+   stats->allocs = __sync_fetch_and_add( &pool->stats.allocs, 0 );
+   stats->reuses = __sync_fetch_and_add( &pool->stats.reuses, 0 );
+   stats->fallbacks = __sync_fetch_and_add( &pool->stats.fallbacks, 0 );
+   stats->frees = __sync_fetch_and_add( &pool->stats.frees, 0 );
+   stats->slabs = __sync_fetch_and_add( &pool->stats.slabs, 0 );
+   stats->in_use = __sync_fetch_and_add( &pool->stats.in_use, 0 );
+
+   return 0;
+}
+
+
+// log each pool's counters, and unmap their slabs.
+// if any buffer is still in use, everything is left in place, since someone still holds a pointer into a slab
+// (and may yet free it).
+// always succeeds
+int md_bufpool_shutdown(void) {
+
+   bool in_use = false;
+
+   pthread_rwlock_wrlock( &md_bufpool_lock );
+
+   if( md_bufpool_pools == NULL ) {
+
+      pthread_rwlock_unlock( &md_bufpool_lock );
+      return 0;
+   }
+
+   for( md_bufpool_list_t::iterator itr = md_bufpool_pools->begin(); itr != md_bufpool_pools->end(); itr++ ) {
+
+      struct md_bufpool* pool = *itr;
+
+      SG_debug("Buffer pool (%zu bytes): %" PRIu64 " allocs, %" PRIu64 " reused, %" PRIu64 " fallbacks, %" PRIu64 " frees, %" PRIu64 " slabs, %" PRIu64 " in use\n",
+               pool->buf_size, pool->stats.allocs, pool->stats.reuses, pool->stats.fallbacks, pool->stats.frees, pool->stats.slabs, pool->stats.in_use );
+
+      if( pool->stats.in_use > 0 ) {
+         in_use = true;
+      }
+   }
+
+   if( in_use ) {
+
+      SG_warn("%s", "Buffer pool buffers still in use; leaving pools in place\n");
+
+      pthread_rwlock_unlock( &md_bufpool_lock );
+      return 0;
+   }
+
+   for( md_bufpool_slab_map_t::iterator itr = md_bufpool_slabs->begin(); itr != md_bufpool_slabs->end(); itr++ ) {
+
+      struct md_bufpool_slab* slab = itr->second;
+
+      munmap( slab->base, slab->len );
+      SG_safe_free( slab );
+   }
+
+   SG_safe_delete( md_bufpool_slabs );
+
+   for( md_bufpool_list_t::iterator itr = md_bufpool_pools->begin(); itr != md_bufpool_pools->end(); itr++ ) {
+
+      struct md_bufpool* pool = *itr;
+
+      for( int i = 0; i < MD_BUFPOOL_NUM_SHARDS; i++ ) {
+
+         pthread_mutex_destroy( &pool->shards[i].lock );
+         SG_safe_delete( pool->shards[i].free_bufs );
+      }
+
+      pthread_mutex_destroy( &pool->lock );
+      SG_safe_free( pool );
+   }
+
+   SG_safe_delete( md_bufpool_pools );
+
+   pthread_rwlock_unlock( &md_bufpool_lock );
+
+   return 0;
+}
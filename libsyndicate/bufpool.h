@@ -0,0 +1,100 @@
+/*
+   Copyright 2014 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Process-wide pools of block-sized buffers.
+ * A pool is registered per block size, and hands out buffers carved from large anonymous mappings (slabs)
+ * that stay mapped, so a recycled buffer costs neither a malloc nor a round of page faults.
+ * Free buffers are kept on per-thread-group free lists, so threads rarely contend for them.
+ * Each buffer has a single owner, who returns it with md_bufpool_free.
+ * md_bufpool_free also accepts memory that did not come from a pool (i.e. allocations that fell back
+ * to calloc), and frees it, so callers never need to know where a buffer came from.
+ */
+
+#ifndef _LIBSYNDICATE_BUFPOOL_H_
+#define _LIBSYNDICATE_BUFPOOL_H_
+
+#include <map>
+#include <vector>
+
+#include "libsyndicate/libsyndicate.h"
+
+#define MD_BUFPOOL_SLACK                8192    // room past the block size, for serialization overhead and response headers
+#define MD_BUFPOOL_NUM_SHARDS           16      // number of free lists per pool
+#define MD_BUFPOOL_BUFS_PER_SLAB        4       // number of buffers mapped at once
+#define MD_BUFPOOL_DEFAULT_MAX_BUFS     32      // default number of buffers a pool may map
+
+// free a buffer that may or may not have come from a pool, and NULL it
+#define SG_pool_safe_free( buf ) if( (buf) != NULL ) { md_bufpool_free(buf); buf = NULL; }
+
+// allocation counters
+struct md_bufpool_stats {
+
+   uint64_t allocs;             // buffers handed out of the pool
+   uint64_t reuses;             // ...that were recycled, instead of freshly mapped
+   uint64_t fallbacks;          // allocations that fell back to calloc, because the pool was exhausted
+   uint64_t frees;              // buffers returned to the pool
+   uint64_t slabs;              // slabs mapped
+   uint64_t in_use;             // buffers currently handed out
+};
+
+struct md_bufpool;
+
+// a contiguous mapping of buffers
+struct md_bufpool_slab {
+
+   char* base;
+   size_t len;
+   int num_bufs;
+   struct md_bufpool* pool;
+};
+
+// a free list
+struct md_bufpool_shard {
+
+   pthread_mutex_t lock;
+   vector<char*>* free_bufs;
+};
+
+// pool of same-sized buffers
+struct md_bufpool {
+
+   size_t buf_size;             // size of each buffer (page-aligned)
+   int max_bufs;                // maximum number of buffers to map
+   int num_bufs;                // number of buffers mapped so far (guarded by lock)
+
+   pthread_mutex_t lock;        // guards slab creation
+
+   struct md_bufpool_shard shards[ MD_BUFPOOL_NUM_SHARDS ];
+
+   struct md_bufpool_stats stats;       // updated atomically
+};
+
+extern "C" {
+
+int md_bufpool_register( size_t block_size, int max_bufs );
+int md_bufpool_shutdown(void);
+
+char* md_bufpool_alloc( size_t len );
+char* md_bufpool_calloc( size_t len );
+void md_bufpool_free( char* buf );
+bool md_bufpool_owns( char const* buf );
+
+int md_bufpool_get_stats( size_t len, struct md_bufpool_stats* stats );
+
+}
+
+#endif
@@ -17,18 +17,26 @@
 #include "libsyndicate/cache.h"
 #include "libsyndicate/url.h"
 #include "libsyndicate/storage.h"
+#include "libsyndicate/segstore.h"
+#include "libsyndicate/uring.h"
+#include "libsyndicate/bufpool.h"
 
 struct md_cache_block_future {
    
    // ID of this chunk
    struct md_cache_entry_key key;
    
+   // cache this chunk goes to
+   struct md_syndicate_cache* cache;
+   
    // chunk of data to write
    char* block_data;
    size_t data_len;
    
    // fd to receive writes
+   // (for packed caches, this is -1 until the caller asks for it; the data goes to a segment)
    int block_fd;
+   bool packed;
    
    // asynchronous disk I/O structures
    struct aiocb aio;
@@ -226,8 +234,8 @@ int md_cache_block_future_clean( struct md_cache_block_future* f ) {
    
    if( (f->flags & SG_CACHE_FLAG_UNSHARED) != 0 ) {
       
-      // we own this data
-      SG_safe_free( f->block_data );
+      // we own this data (it may have come from a buffer pool)
+      SG_pool_safe_free( f->block_data );
    }
    
    SG_safe_free( f->aio.aio_sigevent.sigev_value.sival_ptr );
@@ -279,7 +287,7 @@ int md_cache_block_future_free_all( vector<struct md_cache_block_future*>* futs,
          
          if( !(*close_fds_ptr) ) {
             // release the file FD from the future, so we can use it later 
-            md_cache_block_future_release_fd( fut );
+            fut->block_fd = -1;
          }
          md_cache_block_future_free( fut );
       }
@@ -405,15 +413,37 @@ int md_cache_is_block_readable( struct md_syndicate_cache* cache, uint64_t file_
 }
 
 // open a block in the cache
+// if the cache is packed, the file descriptor refers to a private copy of the block (and O_CREAT is not allowed)
 // return a file descriptor >= 0 on success
 // return -ENOMEM if OOM
+// return -EINVAL if the cache is packed and O_CREAT is given
 // return negative on error
 int md_cache_open_block( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version, int flags ) {
    
    int rc = 0;
    int fd = 0;
    char* block_path = NULL;
-   char* block_url = md_url_local_block_url( cache->conf->data_root, cache->conf->volume, file_id, file_version, block_id, block_version );
+   char* block_url = NULL;
+   
+   if( cache->segstore != NULL ) {
+      
+      // packed blocks are only created through md_cache_write_block_async
+      if( flags & O_CREAT ) {
+         return -EINVAL;
+      }
+      
+      struct md_cache_entry_key k;
+      md_cache_entry_key_init( &k, file_id, file_version, block_id, block_version );
+      
+      fd = md_segstore_open( cache->segstore, &k );
+      if( fd < 0 && fd != -ENOENT ) {
+         SG_error("md_segstore_open( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", file_id, file_version, block_id, block_version, fd );
+      }
+      
+      return fd;
+   }
+   
+   block_url = md_url_local_block_url( cache->conf->data_root, cache->conf->volume, file_id, file_version, block_id, block_version );
    if( block_url == NULL ) {
       
       return -ENOMEM;
@@ -445,6 +475,7 @@ int md_cache_open_block( struct md_syndicate_cache* cache, uint64_t file_id, int
 
 
 // stat a block in the cache (system use only)
+// if the cache is packed, only the block's size and type are filled in
 // return 0 on success 
 // return -ENOMEM if OOM
 // return negative (from stat(2) errno) on error
@@ -454,6 +485,14 @@ int md_cache_stat_block_by_id( struct md_syndicate_cache* cache, uint64_t file_i
    int rc = 0;
    char* block_url = NULL;
    
+   if( cache->segstore != NULL ) {
+      
+      struct md_cache_entry_key k;
+      md_cache_entry_key_init( &k, file_id, file_version, block_id, block_version );
+      
+      return md_segstore_stat( cache->segstore, &k, sb );
+   }
+   
    block_url = md_url_local_block_url( cache->conf->data_root, cache->conf->volume, file_id, file_version, block_id, block_version );
    if( block_url == NULL ) {
       return -ENOMEM;
@@ -474,6 +513,7 @@ int md_cache_stat_block_by_id( struct md_syndicate_cache* cache, uint64_t file_i
 // delete a block in the cache
 // return 0 on success
 // return -ENOMEM on OOM 
+// return -ENOENT if the cache is packed and the block is not present
 // return negative (from unlink) on error
 static int md_cache_evict_block_internal( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version ) {
    
@@ -483,6 +523,23 @@ static int md_cache_evict_block_internal( struct md_syndicate_cache* cache, uint
    char* local_file_url = NULL;
    char* local_file_path = NULL;
    
+   if( cache->segstore != NULL ) {
+      
+      struct md_cache_entry_key k;
+      md_cache_entry_key_init( &k, file_id, file_version, block_id, block_version );
+      
+      // space gets reclaimed by compaction
+      rc = md_segstore_evict( cache->segstore, &k );
+      
+      if( rc == 0 || rc == -ENOENT ) {
+         
+         // let another block get queued
+         sem_post( &cache->sem_write_hard_limit );
+      }
+      
+      return rc;
+   }
+   
    block_url = md_url_local_block_url( cache->conf->data_root, cache->conf->volume, file_id, file_version, block_id, block_version );
    if( block_url == NULL ) {
       return -ENOMEM;
@@ -629,6 +686,63 @@ int md_cache_file_blocks_apply( char const* local_path, int (*block_func)( char
 }
 
 
+// apply a function over a file's cached blocks, given the file's ID and version.
+// block_func receives the path each block would have in an unpacked cache (so its name encodes the block ID and version)
+// keep applying it even if the callback fails on some of them
+// return 0 on success 
+// return -ENOMEM on OOM 
+// return -ENOENT if no blocks of this file are cached 
+// return negative on opendir(2) failure 
+// return non-zero if the block_func callback does not return 0
+int md_cache_file_blocks_apply_by_id( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, int (*block_func)( char const*, void* ), void* cls ) {
+   
+   int rc = 0;
+   int worst_rc = 0;
+   char* url = NULL;
+   
+   if( cache->segstore != NULL ) {
+      
+      md_cache_lru_t blocks;
+      
+      rc = md_segstore_file_blocks( cache->segstore, file_id, file_version, &blocks );
+      if( rc != 0 ) {
+         return rc;
+      }
+      
+      for( md_cache_lru_t::iterator itr = blocks.begin(); itr != blocks.end(); itr++ ) {
+         
+         url = md_url_local_block_url( cache->conf->data_root, cache->conf->volume, itr->file_id, itr->file_version, itr->block_id, itr->block_version );
+         if( url == NULL ) {
+            
+            worst_rc = -ENOMEM;
+            break;
+         }
+         
+         rc = (*block_func)( SG_URL_LOCAL_PATH( url ), cls );
+         if( rc != 0 ) {
+            
+            SG_error( "block_func(%s) rc = %d\n", SG_URL_LOCAL_PATH( url ), rc );
+            worst_rc = rc;
+         }
+         
+         SG_safe_free( url );
+      }
+      
+      return worst_rc;
+   }
+   
+   url = md_url_local_file_url( cache->conf->data_root, cache->conf->volume, file_id, file_version );
+   if( url == NULL ) {
+      return -ENOMEM;
+   }
+   
+   rc = md_cache_file_blocks_apply( SG_URL_LOCAL_PATH( url ), block_func, cls );
+   
+   SG_safe_free( url );
+   return rc;
+}
+
+
 // evict a file from the cache
 // return 0 on success
 // return -ENOMEM on OOM
@@ -670,6 +784,20 @@ int md_cache_evict_file( struct md_syndicate_cache* cache, uint64_t file_id, int
       }
    };
    
+   if( cache->segstore != NULL ) {
+      
+      int num_evicted = md_segstore_evict_file( cache->segstore, file_id, file_version );
+      
+      __sync_fetch_and_sub( &cache->num_blocks_written, num_evicted );
+      
+      // let more blocks get queued
+      for( int i = 0; i < num_evicted; i++ ) {
+         sem_post( &cache->sem_write_hard_limit );
+      }
+      
+      return 0;
+   }
+   
    // path to the file...
    local_file_url = md_url_local_file_url( cache->conf->data_root, cache->conf->volume, file_id, file_version );
    if( local_file_url == NULL ) {
@@ -691,6 +819,31 @@ int md_cache_evict_file( struct md_syndicate_cache* cache, uint64_t file_id, int
 }
 
 
+// queue a list of blocks for promotion 
+// return 0 on success
+// return -ENOMEM on OOM
+static int md_cache_promote_all( struct md_syndicate_cache* cache, md_cache_lru_t* lru ) {
+   
+   int rc = 0;
+   
+   md_cache_promotes_wlock( cache );
+   
+   for( md_cache_lru_t::iterator itr = lru->begin(); itr != lru->end(); itr++ ) {
+      try {
+         cache->promotes->push_back( *itr );
+      }
+      catch( bad_alloc& ba ) {
+         rc = -ENOMEM;
+         break;
+      }
+   }
+   
+   md_cache_promotes_unlock( cache );
+   
+   return rc;
+}
+
+
 // reversion a file.
 // move it into place, and then insert the new cache_entry_key records for it to the cache_lru list.
 // don't bother removing the old cache_entry_key records; they will be removed from the cache_lru list automatically.
@@ -700,6 +853,19 @@ int md_cache_evict_file( struct md_syndicate_cache* cache, uint64_t file_id, int
 // return negative if stat(2) on the new path fails for some reason besides -ENOENT
 int md_cache_reversion_file( struct md_syndicate_cache* cache, uint64_t file_id, int64_t old_file_version, int64_t new_file_version ) {
    
+   if( cache->segstore != NULL ) {
+      
+      // rename the blocks in place
+      md_cache_lru_t new_keys;
+      
+      int rc = md_segstore_reversion_file( cache->segstore, file_id, old_file_version, new_file_version, &new_keys );
+      if( rc == 0 ) {
+         rc = md_cache_promote_all( cache, &new_keys );
+      }
+      
+      return rc;
+   }
+   
    char* cur_local_url = md_url_local_file_url( cache->conf->data_root, cache->conf->volume, file_id, old_file_version );
    if( cur_local_url == NULL ) {
       return -ENOMEM;
@@ -779,18 +945,7 @@ int md_cache_reversion_file( struct md_syndicate_cache* cache, uint64_t file_id,
    
    if( rc == 0 ) {
       // promote these blocks in the cache
-      md_cache_promotes_wlock( cache );
-      
-      for( md_cache_lru_t::iterator itr = lru.begin(); itr != lru.end(); itr++ ) {
-         try {
-            cache->promotes->push_back( *itr );
-         }
-         catch( bad_alloc& ba ) {
-            rc = -ENOMEM;
-            break;
-         }
-      }
-      md_cache_promotes_unlock( cache );
+      rc = md_cache_promote_all( cache, &lru );
    }
    
    SG_safe_free( cur_local_url );
@@ -800,138 +955,667 @@ int md_cache_reversion_file( struct md_syndicate_cache* cache, uint64_t file_id,
 }
 
 
-// initialize the cache 
-// return 0 on success
-// return -ENOMEM if OOM 
-// return -EINVAL if soft_limit and hard_limit are both 0
-int md_cache_init( struct md_syndicate_cache* cache, struct md_syndicate_conf* conf, size_t soft_limit, size_t hard_limit ) {
-   
-   int rc = 0;
+// path to the volume's LRU snapshot
+// return a malloc'ed path on success
+// return NULL on OOM
+static char* md_cache_snapshot_path( struct md_syndicate_cache* cache, char const* suffix ) {
    
-   if( soft_limit == 0 && hard_limit == 0 ) {
-      return -EINVAL;
+   char* path = SG_CALLOC( char, strlen(cache->conf->data_root) + 1 + 25 + 1 + strlen(MD_CACHE_SNAPSHOT_NAME) + strlen(suffix) + 1 );
+   if( path == NULL ) {
+      return NULL;
    }
    
-   memset( cache, 0, sizeof(struct md_syndicate_cache) );
+   sprintf( path, "%s/%" PRIu64 "/%s%s", cache->conf->data_root, cache->conf->volume, MD_CACHE_SNAPSHOT_NAME, suffix );
+   return path;
+}
+
+
+// write out an LRU snapshot, atomically replacing the old one.
+// the keys are written least-recently-used first.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int md_cache_snapshot_write( struct md_syndicate_cache* cache, struct md_cache_entry_key* keys, size_t num_keys ) {
    
-   pthread_rwlock_t* locks[] = {
-      &cache->pending_lock,
-      &cache->completed_lock,
-      &cache->cache_lru_lock,
-      &cache->promotes_lock,
-      &cache->ongoing_writes_lock,
-      NULL
-   };
+   int rc = 0;
+   int fd = -1;
+   ssize_t nw = 0;
+   char* path = NULL;
+   char* tmp_path = NULL;
+   char* dir = NULL;
+   struct md_cache_snapshot_header hdr;
    
-   cache->conf = conf;
+   path = md_cache_snapshot_path( cache, "" );
+   tmp_path = md_cache_snapshot_path( cache, ".tmp" );
    
-   for( int i = 0; locks[i] != NULL; i++ ) {
-      rc = pthread_rwlock_init( locks[i], NULL );
-      if( rc != 0 ) {
-         
-         rc = -errno;
-         
-         // free up and return 
-         for( int j = 0; j < i; j++ ) {
-            pthread_rwlock_destroy( locks[i] );
-         }
-         
-         return rc;
-      }
+   if( path == NULL || tmp_path == NULL ) {
+      
+      SG_safe_free( path );
+      SG_safe_free( tmp_path );
+      return -ENOMEM;
    }
    
-   SG_debug("Soft limit: %zu blocks.  Hard limit: %zu blocks\n", soft_limit, hard_limit );
+   // the volume directory won't exist if we have never cached anything
+   dir = md_dirname( path, NULL );
+   if( dir == NULL ) {
+      
+      rc = -ENOMEM;
+      goto md_cache_snapshot_write_out;
+   }
    
-   cache->hard_max_size = hard_limit;
-   cache->soft_max_size = soft_limit;
+   rc = md_mkdirs3( dir, 0700 );
+   if( rc != 0 && rc != -EEXIST ) {
+      
+      SG_error("md_mkdirs3('%s') rc = %d\n", dir, rc );
+      goto md_cache_snapshot_write_out;
+   }
    
-   sem_init( &cache->sem_write_hard_limit, 0, hard_limit );
-   sem_init( &cache->sem_blocks_writing, 0, 0 );
+   fd = open( tmp_path, O_CREAT | O_TRUNC | O_WRONLY, 0600 );
+   if( fd < 0 ) {
+      
+      rc = -errno;
+      SG_error("open('%s') rc = %d\n", tmp_path, rc );
+      goto md_cache_snapshot_write_out;
+   }
    
-   cache->pending_1 = SG_safe_new( md_cache_block_buffer_t() );
-   cache->pending_2 = SG_safe_new( md_cache_block_buffer_t() );
-   cache->pending = cache->pending_1;
+   memset( &hdr, 0, sizeof(hdr) );
+   hdr.magic = MD_CACHE_SNAPSHOT_MAGIC;
+   hdr.version = MD_CACHE_SNAPSHOT_VERSION;
+   hdr.volume_id = cache->conf->volume;
+   hdr.num_keys = num_keys;
    
-   cache->completed_1 = SG_safe_new( md_cache_completion_buffer_t() );
-   cache->completed_2 = SG_safe_new( md_cache_completion_buffer_t() );
-   cache->completed = cache->completed_1;
+   nw = md_write_uninterrupted( fd, (char const*)&hdr, sizeof(hdr) );
+   if( nw == (ssize_t)sizeof(hdr) && num_keys > 0 ) {
+      nw = md_write_uninterrupted( fd, (char const*)keys, num_keys * sizeof(struct md_cache_entry_key) );
+      
+      if( nw >= 0 && (size_t)nw != num_keys * sizeof(struct md_cache_entry_key) ) {
+         nw = -EIO;
+      }
+   }
+   else if( nw >= 0 && nw != (ssize_t)sizeof(hdr) ) {
+      nw = -EIO;
+   }
    
-   cache->cache_lru = SG_safe_new( md_cache_lru_t() );
+   if( nw < 0 ) {
+      
+      rc = (int)nw;
+      SG_error("write('%s') rc = %d\n", tmp_path, rc );
+      goto md_cache_snapshot_write_out;
+   }
    
-   cache->promotes_1 = SG_safe_new( md_cache_lru_t() );
-   cache->promotes_2 = SG_safe_new( md_cache_lru_t() );
-   cache->promotes = cache->promotes_1;
+   // make sure the new snapshot is durable before it replaces the old one
+   rc = fsync( fd );
+   if( rc != 0 ) {
+      
+      rc = -errno;
+      SG_error("fsync('%s') rc = %d\n", tmp_path, rc );
+      goto md_cache_snapshot_write_out;
+   }
    
-   cache->evicts_1 = SG_safe_new( md_cache_lru_t() );
-   cache->evicts_2 = SG_safe_new( md_cache_lru_t() );
-   cache->evicts = cache->evicts_1;
+   rc = rename( tmp_path, path );
+   if( rc != 0 ) {
+      
+      rc = -errno;
+      SG_error("rename('%s', '%s') rc = %d\n", tmp_path, path, rc );
+      goto md_cache_snapshot_write_out;
+   }
    
-   cache->ongoing_writes = SG_safe_new( md_cache_ongoing_writes_t() );
+md_cache_snapshot_write_out:
    
-   // verify all alloc's succeeded
-   if( cache->pending_1 == NULL || cache->pending_2 == NULL ||
-       cache->completed_1 == NULL || cache->completed_2 == NULL ||
-       cache->promotes_1 == NULL || cache->promotes_2 == NULL ||
-       cache->evicts_1 == NULL || cache->evicts_2 == NULL ||
-       cache->ongoing_writes == NULL ) {
-      
-      cache->running = false;
-      md_cache_destroy( cache );
-      return -ENOMEM;
+   if( fd >= 0 ) {
+      close( fd );
    }
    
-   return 0;
+   if( rc != 0 ) {
+      unlink( tmp_path );
+   }
+   
+   SG_safe_free( dir );
+   SG_safe_free( path );
+   SG_safe_free( tmp_path );
+   
+   return rc;
 }
 
-// start the cache thread
+
+// save a snapshot of the LRU.
+// copies the LRU under its lock, and writes it out without holding it.
+// if wait is false, give up if the LRU lock is held
 // return 0 on success
-// return -1 if we failed to start the thread
-int md_cache_start( struct md_syndicate_cache* cache ) {
+// return -EAGAIN if wait is false and the LRU is locked
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int md_cache_snapshot_save_internal( struct md_syndicate_cache* cache, bool wait ) {
    
    int rc = 0;
+   size_t num_keys = 0;
+   struct md_cache_entry_key* keys = NULL;
+   struct timespec start, end;
    
-   // start the thread up 
-   struct md_syndicate_cache_thread_args* args = SG_CALLOC( struct md_syndicate_cache_thread_args, 1 );
-   args->cache = cache;
+   clock_gettime( CLOCK_MONOTONIC, &start );
    
-   cache->running = true;
+   if( wait ) {
+      md_cache_lru_rlock( cache );
+   }
+   else if( pthread_rwlock_tryrdlock( &cache->cache_lru_lock ) != 0 ) {
+      return -EAGAIN;
+   }
    
-   rc = md_start_thread( &cache->thread, md_cache_main_loop, (void*)args, false );
-   if( rc < 0 ) {
+   num_keys = cache->cache_lru->size();
+   
+   keys = SG_CALLOC( struct md_cache_entry_key, MAX( num_keys, 1 ) );
+   if( keys == NULL ) {
       
-      SG_error("md_start_thread rc = %d\n", rc );
-      return -1;
+      md_cache_lru_unlock( cache );
+      return -ENOMEM;
    }
    
-   return 0;
-}
-
-// stop the cache thread 
-// always succeeds
-int md_cache_stop( struct md_syndicate_cache* cache ) {
+   size_t i = 0;
+   for( md_cache_lru_t::iterator itr = cache->cache_lru->begin(); itr != cache->cache_lru->end(); itr++ ) {
+      
+      keys[i] = *itr;
+      i++;
+   }
    
-   cache->running = false;
+   md_cache_lru_unlock( cache );
    
-   // wake up the writer
-   sem_post( &cache->sem_blocks_writing );
+   rc = md_cache_snapshot_write( cache, keys, num_keys );
    
-   // wait for cache thread to finish 
-   pthread_cancel( cache->thread );
-   pthread_join( cache->thread, NULL );
+   SG_safe_free( keys );
    
-   return 0;
+   clock_gettime( CLOCK_MONOTONIC, &end );
+   cache->last_snapshot = end;
+   
+   if( rc == 0 ) {
+      SG_debug("Cache LRU snapshot: %zu entries in %" PRId64 " ns\n", num_keys, md_timespec_diff( &end, &start ) );
+   }
+   
+   return rc;
 }
 
 
-// destroy the cache
+// save a snapshot of the LRU, so the next md_cache_init can restore it.
 // return 0 on success
-// return -EINVAL if the cache is still running
-int md_cache_destroy( struct md_syndicate_cache* cache ) {
-   
-   if( cache->running ) {
-      // have to stop it first
-      return -EINVAL;
-   }
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int md_cache_snapshot_save( struct md_syndicate_cache* cache ) {
+   return md_cache_snapshot_save_internal( cache, true );
+}
+
+
+// load the LRU snapshot, least-recently-used key first.
+// return 0 on success, and populate *keys
+// return -ENOENT if there is no snapshot
+// return -EINVAL if the snapshot is malformed, or belongs to a different volume
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int md_cache_snapshot_load( struct md_syndicate_cache* cache, md_cache_lru_t* keys ) {
+   
+   int rc = 0;
+   int fd = -1;
+   ssize_t nr = 0;
+   char* path = NULL;
+   struct stat sb;
+   struct md_cache_snapshot_header hdr;
+   struct md_cache_entry_key* batch = NULL;
+   size_t batch_len = 4096;
+   uint64_t num_read = 0;
+   
+   path = md_cache_snapshot_path( cache, "" );
+   if( path == NULL ) {
+      return -ENOMEM;
+   }
+   
+   fd = open( path, O_RDONLY );
+   if( fd < 0 ) {
+      
+      rc = -errno;
+      if( rc != -ENOENT ) {
+         SG_error("open('%s') rc = %d\n", path, rc );
+      }
+      
+      SG_safe_free( path );
+      return rc;
+   }
+   
+   rc = fstat( fd, &sb );
+   if( rc != 0 ) {
+      
+      rc = -errno;
+      goto md_cache_snapshot_load_out;
+   }
+   
+   nr = md_read_uninterrupted( fd, (char*)&hdr, sizeof(hdr) );
+   if( nr < 0 ) {
+      
+      rc = (int)nr;
+      goto md_cache_snapshot_load_out;
+   }
+   
+   if( nr != (ssize_t)sizeof(hdr) || hdr.magic != MD_CACHE_SNAPSHOT_MAGIC || hdr.version != MD_CACHE_SNAPSHOT_VERSION || hdr.volume_id != cache->conf->volume ||
+       (uint64_t)sb.st_size != sizeof(hdr) + hdr.num_keys * sizeof(struct md_cache_entry_key) ) {
+      
+      SG_warn("Ignoring malformed LRU snapshot '%s'\n", path );
+      rc = -EINVAL;
+      goto md_cache_snapshot_load_out;
+   }
+   
+   batch = SG_CALLOC( struct md_cache_entry_key, batch_len );
+   if( batch == NULL ) {
+      
+      rc = -ENOMEM;
+      goto md_cache_snapshot_load_out;
+   }
+   
+   while( num_read < hdr.num_keys ) {
+      
+      size_t n = MIN( batch_len, hdr.num_keys - num_read );
+      
+      nr = md_read_uninterrupted( fd, (char*)batch, n * sizeof(struct md_cache_entry_key) );
+      if( nr < 0 ) {
+         
+         rc = (int)nr;
+         goto md_cache_snapshot_load_out;
+      }
+      
+      if( (size_t)nr != n * sizeof(struct md_cache_entry_key) ) {
+         
+         rc = -EINVAL;
+         goto md_cache_snapshot_load_out;
+      }
+      
+      try {
+         keys->insert( keys->end(), batch, batch + n );
+      }
+      catch( bad_alloc& ba ) {
+         
+         rc = -ENOMEM;
+         goto md_cache_snapshot_load_out;
+      }
+      
+      num_read += n;
+   }
+   
+md_cache_snapshot_load_out:
+   
+   if( rc != 0 && rc != -EINVAL ) {
+      SG_error("Failed to load LRU snapshot '%s', rc = %d\n", path, rc );
+   }
+   
+   if( rc != 0 ) {
+      keys->clear();
+   }
+   
+   close( fd );
+   SG_safe_free( batch );
+   SG_safe_free( path );
+   
+   return rc;
+}
+
+
+// restore the LRU from the last snapshot, and account for the blocks it holds.
+// if the cache is packed, the segment store's recovered blocks are authoritative: snapshot entries it does not have are dropped,
+// and recovered blocks missing from the snapshot (i.e. written after it) become the most-recently-used.
+// otherwise, the snapshot entries are trusted until the cache thread checks them (see md_cache_validate_restored).
+// the restored blocks enter the LRU once the cache starts.
+// return 0 on success
+// return -ENOMEM on OOM
+static int md_cache_restore_lru( struct md_syndicate_cache* cache, md_cache_lru_t* recovered ) {
+   
+   int rc = 0;
+   md_cache_lru_t snapshot;
+   md_cache_lru_t restored;
+   
+   rc = md_cache_snapshot_load( cache, &snapshot );
+   if( rc == -ENOMEM ) {
+      return rc;
+   }
+   
+   // other errors just mean we start cold
+   rc = 0;
+   
+   try {
+      
+      if( cache->segstore != NULL ) {
+         
+         unordered_set<struct md_cache_entry_key, md_cache_entry_key_hash, md_cache_entry_key_eq> seen;
+         
+         for( md_cache_lru_t::iterator itr = snapshot.begin(); itr != snapshot.end(); itr++ ) {
+            
+            struct stat sb;
+            if( seen.count( *itr ) > 0 || md_segstore_stat( cache->segstore, &(*itr), &sb ) != 0 ) {
+               continue;
+            }
+            
+            seen.insert( *itr );
+            restored.push_back( *itr );
+         }
+         
+         for( md_cache_lru_t::iterator itr = recovered->begin(); itr != recovered->end(); itr++ ) {
+            
+            if( seen.count( *itr ) == 0 ) {
+               restored.push_back( *itr );
+            }
+         }
+      }
+      else {
+         
+         *cache->unvalidated = snapshot;
+         restored.swap( snapshot );
+      }
+   }
+   catch( bad_alloc& ba ) {
+      
+      cache->unvalidated->clear();
+      return -ENOMEM;
+   }
+   
+   SG_debug("Restored %zu cached blocks\n", restored.size() );
+   
+   // restored blocks count against the limits
+   cache->num_blocks_written = restored.size();
+   
+   for( size_t i = 0; i < restored.size(); i++ ) {
+      
+      if( sem_trywait( &cache->sem_write_hard_limit ) != 0 ) {
+         break;
+      }
+   }
+   
+   cache->promotes->splice( cache->promotes->end(), restored );
+   
+   return 0;
+}
+
+
+// check a batch of blocks restored from the LRU snapshot, and forget the ones that are no longer on disk.
+// only call from the cache thread.
+// return 0 on success
+// return -ENOMEM on OOM
+static int md_cache_validate_restored( struct md_syndicate_cache* cache ) {
+   
+   md_cache_lru_t missing;
+   int num_removed = 0;
+   
+   for( int i = 0; i < MD_CACHE_SNAPSHOT_VALIDATE_BATCH && cache->unvalidated->size() > 0; i++ ) {
+      
+      struct md_cache_entry_key c = cache->unvalidated->front();
+      struct stat sb;
+      
+      cache->unvalidated->pop_front();
+      
+      int rc = md_cache_stat_block_by_id( cache, c.file_id, c.file_version, c.block_id, c.block_version, &sb );
+      if( rc == -ENOENT ) {
+         
+         try {
+            missing.push_back( c );
+         }
+         catch( bad_alloc& ba ) {
+            return -ENOMEM;
+         }
+      }
+   }
+   
+   if( missing.size() == 0 ) {
+      return 0;
+   }
+   
+   md_cache_lru_wlock( cache );
+   
+   for( md_cache_lru_t::iterator itr = missing.begin(); itr != missing.end(); itr++ ) {
+      
+      // might have been evicted already
+      md_cache_lru_index_t::iterator idx_itr = cache->cache_lru_index->find( *itr );
+      if( idx_itr == cache->cache_lru_index->end() ) {
+         continue;
+      }
+      
+      cache->cache_lru->erase( idx_itr->second );
+      cache->cache_lru_index->erase( idx_itr );
+      
+      sem_post( &cache->sem_write_hard_limit );
+      num_removed++;
+   }
+   
+   __sync_fetch_and_sub( &cache->num_blocks_written, num_removed );
+   
+   md_cache_lru_unlock( cache );
+   
+   SG_debug("Forgot %d restored blocks that are no longer cached\n", num_removed );
+   
+   return 0;
+}
+
+
+// set up a packed cache's segment store.
+// the blocks it already holds are put into *recovered, in the order they were written.
+// return 0 on success
+// return -ENOMEM on OOM
+// return negative if the segment store could not be initialized (see md_segstore_init)
+static int md_cache_segstore_init( struct md_syndicate_cache* cache, md_cache_lru_t* recovered ) {
+   
+   int rc = 0;
+   char* root = NULL;
+   
+   root = SG_CALLOC( char, strlen(cache->conf->data_root) + 1 + 25 + 1 + strlen(MD_CACHE_SEGMENT_DIR) + 1 );
+   if( root == NULL ) {
+      return -ENOMEM;
+   }
+   
+   sprintf( root, "%s/%" PRIu64 "/%s", cache->conf->data_root, cache->conf->volume, MD_CACHE_SEGMENT_DIR );
+   
+   cache->segstore = SG_CALLOC( struct md_segstore, 1 );
+   if( cache->segstore == NULL ) {
+      
+      SG_safe_free( root );
+      return -ENOMEM;
+   }
+   
+   rc = md_segstore_init( cache->segstore, root, cache->conf->cache_segment_size, recovered );
+   if( rc != 0 ) {
+      
+      SG_error("md_segstore_init(%s) rc = %d\n", root, rc );
+      
+      SG_safe_free( cache->segstore );
+      SG_safe_free( root );
+      return rc;
+   }
+   
+   SG_safe_free( root );
+   
+   return 0;
+}
+
+
+// initialize the cache 
+// if conf->cache_segment_size is positive, blocks are packed into segment files of about that size.
+// the LRU is restored from the last snapshot, if there is one.
+// return 0 on success
+// return -ENOMEM if OOM 
+// return -EINVAL if soft_limit and hard_limit are both 0
+// return negative if we could not set up the packed block store (see md_segstore_init)
+int md_cache_init( struct md_syndicate_cache* cache, struct md_syndicate_conf* conf, size_t soft_limit, size_t hard_limit ) {
+   
+   int rc = 0;
+   md_cache_lru_t recovered;
+   
+   if( soft_limit == 0 && hard_limit == 0 ) {
+      return -EINVAL;
+   }
+   
+   memset( cache, 0, sizeof(struct md_syndicate_cache) );
+   
+   pthread_rwlock_t* locks[] = {
+      &cache->pending_lock,
+      &cache->completed_lock,
+      &cache->cache_lru_lock,
+      &cache->promotes_lock,
+      &cache->ongoing_writes_lock,
+      NULL
+   };
+   
+   cache->conf = conf;
+   
+   for( int i = 0; locks[i] != NULL; i++ ) {
+      rc = pthread_rwlock_init( locks[i], NULL );
+      if( rc != 0 ) {
+         
+         rc = -errno;
+         
+         // free up and return 
+         for( int j = 0; j < i; j++ ) {
+            pthread_rwlock_destroy( locks[i] );
+         }
+         
+         return rc;
+      }
+   }
+   
+   SG_debug("Soft limit: %zu blocks.  Hard limit: %zu blocks\n", soft_limit, hard_limit );
+   
+   cache->hard_max_size = hard_limit;
+   cache->soft_max_size = soft_limit;
+   
+   sem_init( &cache->sem_write_hard_limit, 0, hard_limit );
+   sem_init( &cache->sem_blocks_writing, 0, 0 );
+   
+   cache->pending_1 = SG_safe_new( md_cache_block_buffer_t() );
+   cache->pending_2 = SG_safe_new( md_cache_block_buffer_t() );
+   cache->pending = cache->pending_1;
+   
+   cache->completed_1 = SG_safe_new( md_cache_completion_buffer_t() );
+   cache->completed_2 = SG_safe_new( md_cache_completion_buffer_t() );
+   cache->completed = cache->completed_1;
+   
+   cache->cache_lru = SG_safe_new( md_cache_lru_t() );
+   cache->cache_lru_index = SG_safe_new( md_cache_lru_index_t() );
+   
+   cache->promotes_1 = SG_safe_new( md_cache_lru_t() );
+   cache->promotes_2 = SG_safe_new( md_cache_lru_t() );
+   cache->promotes = cache->promotes_1;
+   
+   cache->evicts_1 = SG_safe_new( md_cache_lru_t() );
+   cache->evicts_2 = SG_safe_new( md_cache_lru_t() );
+   cache->evicts = cache->evicts_1;
+   
+   cache->ongoing_writes = SG_safe_new( md_cache_ongoing_writes_t() );
+   
+   cache->unvalidated = SG_safe_new( md_cache_lru_t() );
+   
+   // verify all alloc's succeeded
+   if( cache->pending_1 == NULL || cache->pending_2 == NULL ||
+       cache->completed_1 == NULL || cache->completed_2 == NULL ||
+       cache->cache_lru == NULL || cache->cache_lru_index == NULL ||
+       cache->promotes_1 == NULL || cache->promotes_2 == NULL ||
+       cache->evicts_1 == NULL || cache->evicts_2 == NULL ||
+       cache->ongoing_writes == NULL || cache->unvalidated == NULL ) {
+      
+      cache->running = false;
+      md_cache_destroy( cache );
+      return -ENOMEM;
+   }
+   
+   if( conf->cache_segment_size > 0 ) {
+      
+      rc = md_cache_segstore_init( cache, &recovered );
+      if( rc != 0 ) {
+         
+         cache->running = false;
+         md_cache_destroy( cache );
+         return rc;
+      }
+   }
+   
+   rc = md_cache_restore_lru( cache, &recovered );
+   if( rc != 0 ) {
+      
+      cache->running = false;
+      md_cache_destroy( cache );
+      return rc;
+   }
+   
+   clock_gettime( CLOCK_MONOTONIC, &cache->last_snapshot );
+   
+   if( conf->cache_io_uring ) {
+      
+      cache->uring = SG_CALLOC( struct md_uring, 1 );
+      if( cache->uring == NULL ) {
+         
+         cache->running = false;
+         md_cache_destroy( cache );
+         return -ENOMEM;
+      }
+      
+      rc = md_uring_init( cache->uring, MD_URING_DEFAULT_ENTRIES );
+      if( rc != 0 ) {
+         
+         // not fatal
+         SG_warn("md_uring_init rc = %d; falling back to POSIX AIO\n", rc );
+         SG_safe_free( cache->uring );
+      }
+   }
+   
+   return 0;
+}
+
+// start the cache thread
+// return 0 on success
+// return -1 if we failed to start the thread
+int md_cache_start( struct md_syndicate_cache* cache ) {
+   
+   int rc = 0;
+   
+   // start the thread up 
+   struct md_syndicate_cache_thread_args* args = SG_CALLOC( struct md_syndicate_cache_thread_args, 1 );
+   args->cache = cache;
+   
+   cache->running = true;
+   
+   rc = md_start_thread( &cache->thread, md_cache_main_loop, (void*)args, false );
+   if( rc < 0 ) {
+      
+      SG_error("md_start_thread rc = %d\n", rc );
+      return -1;
+   }
+   
+   return 0;
+}
+
+// stop the cache thread, and save a snapshot of the LRU for the next md_cache_init
+// always succeeds
+int md_cache_stop( struct md_syndicate_cache* cache ) {
+   
+   int rc = 0;
+   
+   cache->running = false;
+   
+   // wake up the writer
+   sem_post( &cache->sem_blocks_writing );
+   
+   // wait for cache thread to finish 
+   pthread_cancel( cache->thread );
+   pthread_join( cache->thread, NULL );
+   
+   // the thread may have been cancelled while holding the LRU lock
+   rc = md_cache_snapshot_save_internal( cache, false );
+   if( rc != 0 ) {
+      SG_warn("Failed to save LRU snapshot, rc = %d\n", rc );
+   }
+   
+   return 0;
+}
+
+
+// destroy the cache
+// return 0 on success
+// return -EINVAL if the cache is still running
+int md_cache_destroy( struct md_syndicate_cache* cache ) {
+   
+   if( cache->running ) {
+      // have to stop it first
+      return -EINVAL;
+   }
    
    cache->pending = NULL;
    cache->completed = NULL;
@@ -980,7 +1664,22 @@ int md_cache_destroy( struct md_syndicate_cache* cache ) {
       SG_safe_delete( lrus[i] );
    }
    
+   SG_safe_delete( cache->cache_lru_index );
+   
    SG_safe_delete( cache->ongoing_writes );
+   SG_safe_delete( cache->unvalidated );
+   
+   if( cache->segstore != NULL ) {
+      
+      md_segstore_shutdown( cache->segstore );
+      SG_safe_free( cache->segstore );
+   }
+   
+   if( cache->uring != NULL ) {
+      
+      md_uring_shutdown( cache->uring );
+      SG_safe_free( cache->uring );
+   }
    
    pthread_rwlock_t* locks[] = {
       &cache->pending_lock,
@@ -1024,6 +1723,7 @@ int md_cache_block_future_init( struct md_syndicate_cache* cache, struct md_cach
    f->key.block_id = block_id;
    f->key.block_version = block_version;
    
+   f->cache = cache;
    f->block_fd = block_fd;
    f->block_data = data;
    f->data_len = data_len;
@@ -1090,17 +1790,38 @@ static int md_cache_aio_write( struct md_syndicate_cache* cache, struct md_cache
    // allow external clients to keep track of pending writes for this file
    md_cache_ongoing_writes_wlock( cache );
    
-   int rc = aio_write( &f->aio );
-   
+   int rc = aio_write( &f->aio );
+   
+   if( rc == 0 ) {
+      // put one new block
+      md_cache_add_ongoing( cache, f );
+   }
+   else {
+      
+      rc = -errno;
+      SG_error("aio_write(%p) rc = %d\n", &f->aio, rc );
+   }
+   
+   md_cache_ongoing_writes_unlock( cache );
+   
+   return rc;
+}
+
+
+// queue a block write on the cache's io_uring.  It gets submitted with the rest of the batch in md_cache_begin_writes.
+// only the cache thread may call this.
+// return 0 on success
+// return -EAGAIN if the ring is full
+static int md_cache_uring_write( struct md_syndicate_cache* cache, struct md_cache_block_future* f ) {
+   
+   // allow external clients to keep track of pending writes for this file
+   md_cache_ongoing_writes_wlock( cache );
+   
+   int rc = md_uring_prep_write( cache->uring, f->aio.aio_fildes, (char const*)f->aio.aio_buf, f->aio.aio_nbytes, f->aio.aio_offset, (uint64_t)(uintptr_t)f );
    if( rc == 0 ) {
       // put one new block
       md_cache_add_ongoing( cache, f );
    }
-   else {
-      
-      rc = -errno;
-      SG_error("aio_write(%p) rc = %d\n", &f->aio, rc );
-   }
    
    md_cache_ongoing_writes_unlock( cache );
    
@@ -1108,6 +1829,39 @@ static int md_cache_aio_write( struct md_syndicate_cache* cache, struct md_cache
 }
 
 
+// record the outcome of a block write, and enqueue it to be reaped
+// always succeeds
+static void md_cache_write_finished( struct md_syndicate_cache* cache, struct md_cache_block_future* future, int aio_rc, int write_rc ) {
+   
+   if( aio_rc == 0 && write_rc >= 0 && future->block_fd >= 0 ) {
+      // rewind file handle, so other clients can access it
+      lseek( future->block_fd, 0, SEEK_SET );
+   }
+   
+   future->aio_rc = aio_rc;
+   future->write_rc = write_rc;
+   
+   // enqueue for reaping
+   md_cache_completed_wlock( cache );
+   
+   cache->completed->push_back( future );
+   
+   md_cache_completed_unlock( cache );
+}
+
+
+// handle a completed io_uring write.  res is the number of bytes written, or -errno.
+// cls is the cache.
+// always succeeds
+static void md_cache_uring_write_completion( uint64_t user_data, int res, void* cls ) {
+   
+   struct md_syndicate_cache* cache = (struct md_syndicate_cache*)cls;
+   struct md_cache_block_future* future = (struct md_cache_block_future*)(uintptr_t)user_data;
+   
+   md_cache_write_finished( cache, future, res < 0 ? -res : 0, res );
+}
+
+
 // handle a completed write operation
 // put error codes into future->aio_rc and future->write_rc
 // always succeeds
@@ -1129,34 +1883,26 @@ void md_cache_aio_write_completion( sigval_t sigval ) {
       if( write_rc == -1 ) {
          write_rc = -errno;
       }
-      else {
-         // rewind file handle, so other clients can access it
-         lseek( future->block_fd, 0, SEEK_SET );
-      }
    }
    else {
       write_rc = -aio_rc;
    }
    
-   future->aio_rc = aio_rc;
-   future->write_rc = write_rc;
-   
-   // enqueue for reaping
-   md_cache_completed_wlock( cache );
-   
-   cache->completed->push_back( future );
-   
-   md_cache_completed_unlock( cache );
+   md_cache_write_finished( cache, future, aio_rc, write_rc );
 }
 
 
 // start pending writes.  keep trying even if some fail to start
+// with io_uring, the whole batch goes to the kernel in one system call, and writes that don't fit in the ring wait for the next batch.
 // NOTE: we assume that only one thread calls this, for a given cache
 // return 0 on success
-// return negative on failure (see md_cache_aio_write)
+// return negative on failure (see md_cache_aio_write, md_uring_submit)
 int md_cache_begin_writes( struct md_syndicate_cache* cache ) {
    
    int worst_rc = 0;
+   int rc = 0;
+   unsigned queued = 0;
+   md_cache_block_buffer_t deferred;
    
    // get the pending set, and switch the cache over to the other one
    md_cache_block_buffer_t* pending = NULL;
@@ -1180,7 +1926,30 @@ int md_cache_begin_writes( struct md_syndicate_cache* cache ) {
       struct md_cache_block_future* f = *itr;
       struct md_cache_entry_key* c = &f->key;
       
-      int rc = md_cache_aio_write( cache, f );
+      if( cache->uring != NULL ) {
+         
+         // keep the number of writes in flight within the ring, so completions can't overflow it
+         if( md_uring_inflight( cache->uring ) + queued >= cache->uring->sq_entries ) {
+            rc = -EAGAIN;
+         }
+         else {
+            rc = md_cache_uring_write( cache, f );
+         }
+         
+         if( rc == -EAGAIN ) {
+            
+            // try again next batch
+            deferred.push_back( f );
+            continue;
+         }
+         
+         queued++;
+      }
+      else {
+         
+         rc = md_cache_aio_write( cache, f );
+      }
+      
       if( rc < 0 ) {
          SG_error("md_cache_aio_write( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ), rc = %d\n", c->file_id, c->file_version, c->block_id, c->block_version, rc );
          worst_rc = rc;
@@ -1189,10 +1958,74 @@ int md_cache_begin_writes( struct md_syndicate_cache* cache ) {
    
    pending->clear();
    
+   if( cache->uring != NULL ) {
+      
+      // one system call for the batch.  On failure, the queued writes stay in the ring for the next batch.
+      rc = md_uring_submit( cache->uring, 0 );
+      if( rc < 0 ) {
+         
+         SG_error("md_uring_submit rc = %d\n", rc );
+         worst_rc = rc;
+      }
+      
+      if( deferred.size() > 0 ) {
+         
+         // put them back, ahead of anything queued since
+         md_cache_pending_wlock( cache );
+         
+         cache->pending->splice( cache->pending->begin(), deferred );
+         
+         md_cache_pending_unlock( cache );
+      }
+   }
+   
    return worst_rc;
 }
 
 
+// commit a packed block once its data has been appended, checking that all of it was written 
+// return 0 on success
+// return -EIO on a short write
+// return negative on commit failure (see md_segstore_commit)
+static int md_cache_segstore_commit( struct md_syndicate_cache* cache, struct md_cache_block_future* f ) {
+   
+   if( (size_t)f->write_rc != f->data_len ) {
+      
+      SG_error("Short write on %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "]: %d of %zu bytes\n", 
+               f->key.file_id, f->key.file_version, f->key.block_id, f->key.block_version, f->write_rc, f->data_len );
+      return -EIO;
+   }
+   
+   int rc = md_segstore_commit( cache->segstore, &f->key );
+   if( rc != 0 ) {
+      
+      SG_error("md_segstore_commit( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", 
+               f->key.file_id, f->key.file_version, f->key.block_id, f->key.block_version, rc );
+   }
+   
+   return rc;
+}
+
+
+// remove the remains of a failed write from the cache
+// always succeeds
+static void md_cache_write_cleanup( struct md_syndicate_cache* cache, struct md_cache_block_future* f ) {
+   
+   if( f->packed ) {
+      
+      // the reserved space becomes dead 
+      md_segstore_abort( cache->segstore, &f->key );
+      
+      // let another block get queued
+      sem_post( &cache->sem_write_hard_limit );
+   }
+   else {
+      
+      md_cache_evict_block_internal( cache, f->key.file_id, f->key.file_version, f->key.block_id, f->key.block_version );
+   }
+}
+
+
 // reap completed writes
 // if a write failed, remove the data from the cache.
 // NOTE: we assume that only one thread calls this at a time, for a given cache
@@ -1201,6 +2034,12 @@ void md_cache_complete_writes( struct md_syndicate_cache* cache, md_cache_lru_t*
    
    md_cache_completion_buffer_t* completed = NULL;
    
+   if( cache->uring != NULL ) {
+      
+      // pull in whatever the kernel has finished
+      md_uring_reap( cache->uring, md_cache_uring_write_completion, cache );
+   }
+   
    // get the current completed buffer, and switch to the other
    md_cache_completed_wlock( cache );
    
@@ -1231,17 +2070,26 @@ void md_cache_complete_writes( struct md_syndicate_cache* cache, md_cache_lru_t*
       
       md_cache_ongoing_writes_unlock( cache );
       
+      if( f->packed && f->aio_rc == 0 && f->write_rc >= 0 ) {
+         
+         // data is in the segment; make it readable
+         int commit_rc = md_cache_segstore_commit( cache, f );
+         if( commit_rc != 0 ) {
+            f->write_rc = commit_rc;
+         }
+      }
+      
       if( f->aio_rc != 0 ) {
          SG_error("WARN: write aio %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] rc = %d\n", c->file_id, c->file_version, c->block_id, c->block_version, f->aio_rc );
          
          // clean up 
-         md_cache_evict_block_internal( cache, c->file_id, c->file_version, c->block_id, c->block_version );
+         md_cache_write_cleanup( cache, f );
       }
       else if( f->write_rc < 0 ) {
          SG_error("WARN: write %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] rc = %d\n", c->file_id, c->file_version, c->block_id, c->block_version, f->write_rc );
          
          // clean up 
-         md_cache_evict_block_internal( cache, c->file_id, c->file_version, c->block_id, c->block_version );
+         md_cache_write_cleanup( cache, f );
       }
       else {
          // finished!
@@ -1278,69 +2126,114 @@ void md_cache_complete_writes( struct md_syndicate_cache* cache, md_cache_lru_t*
 
 
 
-// promote blocks in a cache LRU
+// move a block to the most-recently-used end of a cache LRU, adding it if it isn't present 
 // return 0 on success
 // return -ENOMEM on OOM
-int md_cache_promote_blocks( md_cache_lru_t* cache_lru, md_cache_lru_t* promotes ) {
+static int md_cache_lru_move_back( md_cache_lru_t* cache_lru, md_cache_lru_index_t* cache_lru_index, md_cache_lru_t* src, md_cache_lru_t::iterator src_itr ) {
    
-   try {
-      // process block promotions
-      // we can (probably) afford to be linear here, since we won't have millions of entries.
-      // TODO: investigate boost biamp if not
-      for( md_cache_lru_t::iterator pitr = promotes->begin(); pitr != promotes->end(); pitr++ ) {
-         
-         // search from the back first, since we might be hitting blocks that were recently read.
-         md_cache_lru_t::iterator citr = cache_lru->end();
-         citr--;
-         for( ; citr != cache_lru->begin(); citr-- ) {
-            
-            if( md_cache_entry_key_comp::equal( *pitr, *citr ) ) {
-               // promote this entry--take it out of the LRU and splice it at the end (below)
-               citr = cache_lru->erase( citr );
-            }
-         }
-      }
-      
-      // add the newly-promoted blocks to the end of the LRU (i.e. they are most-recently-used)
-      cache_lru->splice( cache_lru->end(), *promotes );
+   md_cache_lru_index_t::iterator idx = cache_lru_index->find( *src_itr );
+   if( idx != cache_lru_index->end() ) {
       
+      // already present; move it to the end (invalidates no iterators)
+      cache_lru->splice( cache_lru->end(), *cache_lru, idx->second );
+      src->erase( src_itr );
       return 0;
    }
+   
+   // new entry--take the node from src and index it 
+   cache_lru->splice( cache_lru->end(), *src, src_itr );
+   
+   md_cache_lru_t::iterator new_itr = cache_lru->end();
+   new_itr--;
+   
+   try {
+      (*cache_lru_index)[ *new_itr ] = new_itr;
+   }
    catch( bad_alloc& ba ) {
       
+      cache_lru->erase( new_itr );
       return -ENOMEM;
    }
+   
+   return 0;
 }
 
 
-// demote blocks in a cache LRU 
+// move a block to the least-recently-used end of a cache LRU, adding it if it isn't present 
 // return 0 on success
-// return -ENOMEM on OOM 
-int md_cache_demote_blocks( md_cache_lru_t* cache_lru, md_cache_lru_t* demotes ) {
+// return -ENOMEM on OOM
+static int md_cache_lru_move_front( md_cache_lru_t* cache_lru, md_cache_lru_index_t* cache_lru_index, md_cache_lru_t* src, md_cache_lru_t::iterator src_itr ) {
    
-   try {
-      // process block demotions
-      // we can (probably) afford to be linear here, since we won't have millions of entries.
-      // TODO: investigate boost biamp if not
-      for( md_cache_lru_t::iterator pitr = demotes->begin(); pitr != demotes->end(); pitr++ ) {
-         // search from the beginning, since we might be hitting blocks that are close to eviction anyway
-         for( md_cache_lru_t::iterator citr = cache_lru->begin(); citr != cache_lru->end(); citr++ ) {   
-            if( md_cache_entry_key_comp::equal( *pitr, *citr ) ) {
-               // demote this entry--take it out of the LRU and splite it at the beginning (below)
-               citr = cache_lru->erase( citr );
-            }
-         }
-      }
-      
-      // add the newly-dmoted blocks to the beginning of the LRU (i.e. they are now the least-recently-used)
-      cache_lru->splice( cache_lru->begin(), *demotes );
+   md_cache_lru_index_t::iterator idx = cache_lru_index->find( *src_itr );
+   if( idx != cache_lru_index->end() ) {
       
+      // already present; move it to the front (invalidates no iterators)
+      cache_lru->splice( cache_lru->begin(), *cache_lru, idx->second );
+      src->erase( src_itr );
       return 0;
    }
+   
+   // new entry--take the node from src and index it 
+   cache_lru->splice( cache_lru->begin(), *src, src_itr );
+   
+   md_cache_lru_t::iterator new_itr = cache_lru->begin();
+   
+   try {
+      (*cache_lru_index)[ *new_itr ] = new_itr;
+   }
    catch( bad_alloc& ba ) {
       
+      cache_lru->erase( new_itr );
       return -ENOMEM;
    }
+   
+   return 0;
+}
+
+
+// promote blocks in a cache LRU, in constant time per block.
+// promotes will be emptied.
+// return 0 on success
+// return -ENOMEM on OOM
+int md_cache_promote_blocks( md_cache_lru_t* cache_lru, md_cache_lru_index_t* cache_lru_index, md_cache_lru_t* promotes ) {
+   
+   int rc = 0;
+   
+   // add the newly-promoted blocks to the end of the LRU (i.e. they are most-recently-used)
+   while( promotes->size() > 0 ) {
+      
+      rc = md_cache_lru_move_back( cache_lru, cache_lru_index, promotes, promotes->begin() );
+      if( rc != 0 ) {
+         
+         promotes->clear();
+         return rc;
+      }
+   }
+   
+   return 0;
+}
+
+
+// demote blocks in a cache LRU, in constant time per block.
+// demotes will be emptied.
+// return 0 on success
+// return -ENOMEM on OOM 
+int md_cache_demote_blocks( md_cache_lru_t* cache_lru, md_cache_lru_index_t* cache_lru_index, md_cache_lru_t* demotes ) {
+   
+   int rc = 0;
+   
+   // add the newly-demoted blocks to the beginning of the LRU (i.e. they are now the least-recently-used)
+   while( demotes->size() > 0 ) {
+      
+      rc = md_cache_lru_move_front( cache_lru, cache_lru_index, demotes, demotes->begin() );
+      if( rc != 0 ) {
+         
+         demotes->clear();
+         return rc;
+      }
+   }
+   
+   return 0;
 }
 
 
@@ -1377,18 +2270,28 @@ int md_cache_evict_blocks( struct md_syndicate_cache* cache, md_cache_lru_t* new
    
    // safe access to the promote and evicts buffers, as long as no one performs the above swap
    
+   // number of blocks to eagerly evict
+   int eager_evictions = evicts->size();
+   
+   // how much LRU work are we doing?  (for tuning)
+   size_t num_lru_updates = promotes->size() + evicts->size() + (new_writes != NULL ? new_writes->size() : 0);
+   struct timespec lru_start;
+   struct timespec lru_end;
+   
+   clock_gettime( CLOCK_MONOTONIC, &lru_start );
+   
    md_cache_lru_wlock( cache );
    
    // merge in the new writes, as the most-recently-used
    if( new_writes ) {
-      cache->cache_lru->splice( cache->cache_lru->end(), *new_writes );
+      md_cache_promote_blocks( cache->cache_lru, cache->cache_lru_index, new_writes );
    }
    
    // process promotions
-   md_cache_promote_blocks( cache->cache_lru, promotes );
+   md_cache_promote_blocks( cache->cache_lru, cache->cache_lru_index, promotes );
    
    // process demotions 
-   md_cache_demote_blocks( cache->cache_lru, evicts );
+   md_cache_demote_blocks( cache->cache_lru, cache->cache_lru_index, evicts );
    
    // NOTE: all blocks scheduled for eager eviction are at the beginning of cache_lru.
    // we will evict them here, even if the cache is not full.
@@ -1396,7 +2299,6 @@ int md_cache_evict_blocks( struct md_syndicate_cache* cache, md_cache_lru_t* new
    // see if we should start erasing blocks
    int num_blocks_written = cache->num_blocks_written;
    int blocks_removed = 0;
-   int eager_evictions = evicts->size();        // number of blocks to eagerly evict
    
    // work to do?
    if( cache->cache_lru->size() > 0 && ((unsigned)num_blocks_written > cache->soft_max_size || eager_evictions > 0) ) {
@@ -1406,6 +2308,7 @@ int md_cache_evict_blocks( struct md_syndicate_cache* cache, md_cache_lru_t* new
          
          // least-recently-used block
          struct md_cache_entry_key c = cache->cache_lru->front();
+         cache->cache_lru_index->erase( c );
          cache->cache_lru->pop_front();
          
          int rc = md_cache_evict_block_internal( cache, c.file_id, c.file_version, c.block_id, c.block_version );
@@ -1430,6 +2333,12 @@ int md_cache_evict_blocks( struct md_syndicate_cache* cache, md_cache_lru_t* new
       SG_debug("Cache now has %d blocks\n", cache->num_blocks_written );
    }
    
+   if( num_lru_updates > 0 || blocks_removed > 0 ) {
+      
+      clock_gettime( CLOCK_MONOTONIC, &lru_end );
+      SG_debug("Cache LRU: %zu entries, %zu updates, %d evictions in %" PRId64 " ns\n", cache->cache_lru->size(), num_lru_updates, blocks_removed, md_timespec_diff( &lru_end, &lru_start ) );
+   }
+   
    md_cache_lru_unlock( cache );
    
    // done with this
@@ -1444,6 +2353,7 @@ int md_cache_evict_blocks( struct md_syndicate_cache* cache, md_cache_lru_t* new
 // * start new writes
 // * reap completed writes
 // * evict blocks after the soft size limit has been exceeded
+// * check blocks restored from the LRU snapshot, and periodically save a new snapshot
 void* md_cache_main_loop( void* arg ) {
    struct md_syndicate_cache_thread_args* args = (struct md_syndicate_cache_thread_args*)arg;
    
@@ -1456,10 +2366,24 @@ void* md_cache_main_loop( void* arg ) {
    
    while( cache->running ) {
       
-      // wait for there to be blocks, if there are none
-      if( cache->ongoing_writes->size() == 0 ) {
+      // wait for there to be blocks, if there are none (and we're not still checking restored blocks)
+      if( cache->ongoing_writes->size() == 0 && cache->unvalidated->size() == 0 ) {
          sem_wait( &cache->sem_blocks_writing );
       }
+      else if( cache->uring != NULL && md_uring_inflight( cache->uring ) > 0 ) {
+         
+         bool have_pending = false;
+         
+         md_cache_pending_rlock( cache );
+         have_pending = (cache->pending->size() > 0);
+         md_cache_pending_unlock( cache );
+         
+         if( !have_pending || md_uring_inflight( cache->uring ) >= cache->uring->sq_entries ) {
+            
+            // nothing new to start, or the ring is full and pending writes have to wait; sleep until a write finishes
+            md_uring_submit( cache->uring, 1 );
+         }
+      }
       
       // waken up to die?
       if( !cache->running ) {
@@ -1482,6 +2406,49 @@ void* md_cache_main_loop( void* arg ) {
       
       // evict blocks 
       md_cache_evict_blocks( cache, &new_writes );
+      
+      // reclaim evicted blocks' space
+      if( cache->segstore != NULL ) {
+         
+         pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+         
+         int rc = md_segstore_compact( cache->segstore, cache->conf->cache_soft_limit, cache->conf->cache_hard_limit );
+         if( rc < 0 ) {
+            SG_warn("md_segstore_compact rc = %d\n", rc );
+         }
+         
+         pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
+      }
+      
+      pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+      
+      // forget restored blocks that are gone
+      if( cache->unvalidated->size() > 0 ) {
+         
+         int rc = md_cache_validate_restored( cache );
+         if( rc != 0 ) {
+            
+            SG_warn("md_cache_validate_restored rc = %d\n", rc );
+            cache->unvalidated->clear();
+         }
+      }
+      
+      // time for a new snapshot?
+      if( cache->conf->cache_snapshot_interval > 0 ) {
+         
+         struct timespec now;
+         clock_gettime( CLOCK_MONOTONIC, &now );
+         
+         if( (uint64_t)(now.tv_sec - cache->last_snapshot.tv_sec) >= cache->conf->cache_snapshot_interval ) {
+            
+            int rc = md_cache_snapshot_save( cache );
+            if( rc != 0 ) {
+               SG_warn("md_cache_snapshot_save rc = %d\n", rc );
+            }
+         }
+      }
+      
+      pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
    }
    
    // wait for remaining writes to finish 
@@ -1544,18 +2511,56 @@ struct md_cache_block_future* md_cache_write_block_async( struct md_syndicate_ca
       return NULL;
    }
    
-   // create the block to cache
-   int block_fd = md_cache_open_block( cache, file_id, file_version, block_id, block_version, O_CREAT | O_EXCL | O_RDWR | O_TRUNC );
-   if( block_fd < 0 ) {
+   if( cache->segstore != NULL ) {
       
-      *_rc = block_fd;
-      SG_error("md_cache_open_block( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", file_id, file_version, block_id, block_version, block_fd );
+      // append to the log 
+      struct md_cache_entry_key k;
+      int segment_fd = -1;
+      off_t data_offset = 0;
       
-      SG_safe_free( f );
-      return NULL;
+      md_cache_entry_key_init( &k, file_id, file_version, block_id, block_version );
+      
+      int rc = md_segstore_reserve( cache->segstore, &k, data, data_len, &segment_fd, &data_offset );
+      if( rc != 0 ) {
+         
+         *_rc = rc;
+         SG_error("md_segstore_reserve( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", file_id, file_version, block_id, block_version, rc );
+         
+         sem_post( &cache->sem_write_hard_limit );
+         SG_safe_free( f );
+         return NULL;
+      }
+      
+      rc = md_cache_block_future_init( cache, f, file_id, file_version, block_id, block_version, -1, data, data_len, flags );
+      if( rc != 0 ) {
+         
+         *_rc = rc;
+         
+         md_segstore_abort( cache->segstore, &k );
+         sem_post( &cache->sem_write_hard_limit );
+         SG_safe_free( f );
+         return NULL;
+      }
+      
+      f->packed = true;
+      f->aio.aio_fildes = segment_fd;
+      f->aio.aio_offset = data_offset;
+   }
+   else {
+      
+      // create the block to cache
+      int block_fd = md_cache_open_block( cache, file_id, file_version, block_id, block_version, O_CREAT | O_EXCL | O_RDWR | O_TRUNC );
+      if( block_fd < 0 ) {
+         
+         *_rc = block_fd;
+         SG_error("md_cache_open_block( %" PRIX64 ".%" PRId64 "[%" PRIu64 ".%" PRId64 "] ) rc = %d\n", file_id, file_version, block_id, block_version, block_fd );
+         
+         SG_safe_free( f );
+         return NULL;
+      }
+      
+      md_cache_block_future_init( cache, f, file_id, file_version, block_id, block_version, block_fd, data, data_len, flags );
    }
-   
-   md_cache_block_future_init( cache, f, file_id, file_version, block_id, block_version, block_fd, data, data_len, flags );
    
    md_cache_pending_wlock( cache );
    
@@ -1629,8 +2634,34 @@ int md_cache_block_future_get_write_error( struct md_cache_block_future* f ) {
    return f->write_rc;
 }
 
+// make sure a finished packed block's future has a file descriptor to the block, opening a private copy if need be 
+// return 0 on success (or if there's nothing to do)
+// return negative on error (see md_cache_open_block)
+static int md_cache_block_future_open_packed( struct md_cache_block_future* f ) {
+   
+   if( !f->packed || f->block_fd >= 0 || !f->finalized || md_cache_block_future_has_error( f ) != 0 ) {
+      return 0;
+   }
+   
+   int fd = md_cache_open_block( f->cache, f->key.file_id, f->key.file_version, f->key.block_id, f->key.block_version, O_RDONLY );
+   if( fd < 0 ) {
+      return fd;
+   }
+   
+   f->block_fd = fd;
+   return 0;
+}
+
 // get the block future's file descriptor 
+// return the fd on success
+// return negative if the cache is packed and the block could not be opened (see md_cache_open_block)
 int md_cache_block_future_get_fd( struct md_cache_block_future* f ) {
+   
+   int rc = md_cache_block_future_open_packed( f );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
    return f->block_fd;
 }
 
@@ -1658,8 +2689,14 @@ int64_t md_cache_block_future_block_version( struct md_cache_block_future* fut )
 // caller must close and clean up.
 // NOTE: only call this after the future has finished!
 // return the file descriptor (>= 0)
+// return negative if the cache is packed and the block could not be opened (see md_cache_open_block)
 int md_cache_block_future_release_fd( struct md_cache_block_future* f ) {
    
+   int rc = md_cache_block_future_open_packed( f );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
    int fd = f->block_fd;
    f->block_fd = -1;
    return fd;
@@ -1753,3 +2790,43 @@ ssize_t md_cache_read_block( int block_fd, char** buf ) {
    
    return nr;
 }
+
+
+// read a block from the cache, in its entirety, given its ID 
+// for packed caches, this reads straight from the block's segment, and evicts the block if it is corrupt
+// return the number of bytes read on success (>= 0), and set *buf to a newly-allocated buffer with the data 
+// return -ENOENT if the block is not cached (or was corrupt)
+// return -ENOMEM if OOM 
+// return negative on I/O error
+ssize_t md_cache_read_block_by_id( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version, char** buf ) {
+   
+   ssize_t nr = 0;
+   int block_fd = -1;
+   
+   if( cache->segstore != NULL ) {
+      
+      struct md_cache_entry_key k;
+      md_cache_entry_key_init( &k, file_id, file_version, block_id, block_version );
+      
+      nr = md_segstore_read( cache->segstore, &k, buf );
+      if( nr == -EBADMSG ) {
+         
+         // corrupt (i.e. torn by a crash); drop it, and treat this as a miss
+         md_cache_evict_block( cache, file_id, file_version, block_id, block_version );
+         nr = -ENOENT;
+      }
+      
+      return nr;
+   }
+   
+   block_fd = md_cache_open_block( cache, file_id, file_version, block_id, block_version, O_RDONLY );
+   if( block_fd < 0 ) {
+      return block_fd;
+   }
+   
+   nr = md_cache_read_block( block_fd, buf );
+   
+   close( block_fd );
+   
+   return nr;
+}
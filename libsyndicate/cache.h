@@ -20,6 +20,7 @@
  * * synchronous, thread-safe reads
  * * asynchronous, thread-safe writes and evictions, via a "write future" abstraction
  * * soft and hard limits
+ * * either one file per block, or blocks packed into large log-structured segment files (see segstore.h)
  * * no locks held during I/O, promotion, or LRU eviction
  * * minimal dependency on Syndicate--it only needs its URL-generation code (in url.cpp) and configuration structure (in libsyndicate.h)
  */
@@ -29,6 +30,8 @@
 
 #include <set>
 #include <list>
+#include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <locale>
 #include <iostream>
@@ -45,6 +48,13 @@
 
 #define MD_CACHE_DEFAULT_SOFT_LIMIT        50000000        // 50 MB
 #define MD_CACHE_DEFAULT_HARD_LIMIT       100000000        // 100 MB
+#define MD_CACHE_DEFAULT_SNAPSHOT_INTERVAL      300     // seconds between LRU snapshots
+
+#define MD_CACHE_SEGMENT_DIR            "segments"      // directory under the volume's data root that holds packed segments
+#define MD_CACHE_SNAPSHOT_NAME          "lru.snapshot"  // file under the volume's data root that holds the last LRU snapshot
+#define MD_CACHE_SNAPSHOT_MAGIC         0x53474c52      // "SGLR"
+#define MD_CACHE_SNAPSHOT_VERSION       1
+#define MD_CACHE_SNAPSHOT_VALIDATE_BATCH 1024           // number of restored blocks to check for per pass of the cache thread
 
 #define SG_CACHE_FLAG_DETACHED          0x1             // caller won't wait for a future to finish (so the cache should reap it)
 #define SG_CACHE_FLAG_UNSHARED          0x2             // cache can free the block data when it frees the block future--it's unshared from the caller
@@ -53,6 +63,8 @@ using namespace std;
 
 // prototypes 
 struct md_syndicate_conf;
+struct md_segstore;
+struct md_uring;
 
 struct md_cache_entry_key {
    uint64_t file_id;
@@ -66,7 +78,7 @@ bool md_cache_entry_key_comp_func( const struct md_cache_entry_key& c1, const st
 
 struct md_cache_entry_key_comp {
    
-   bool operator()( const struct md_cache_entry_key& c1, const struct md_cache_entry_key& c2 ) {
+   bool operator()( const struct md_cache_entry_key& c1, const struct md_cache_entry_key& c2 ) const {
       return md_cache_entry_key_comp_func( c1, c2 );
    }
    
@@ -76,6 +88,27 @@ struct md_cache_entry_key_comp {
    }
 };
 
+// hash a cache_entry_key
+struct md_cache_entry_key_hash {
+   
+   size_t operator()( const struct md_cache_entry_key& c ) const {
+      
+      uint64_t h = c.file_id;
+      h = (h * 0x100000001B3ULL) ^ (uint64_t)c.file_version;
+      h = (h * 0x100000001B3ULL) ^ c.block_id;
+      h = (h * 0x100000001B3ULL) ^ (uint64_t)c.block_version;
+      return (size_t)(h ^ (h >> 32));
+   }
+};
+
+// equality functor for cache_entry_keys
+struct md_cache_entry_key_eq {
+   
+   bool operator()( const struct md_cache_entry_key& c1, const struct md_cache_entry_key& c2 ) const {
+      return md_cache_entry_key_comp::equal( c1, c2 );
+   }
+};
+
 // ongoing cache write for a file
 struct md_cache_block_future;
 
@@ -83,6 +116,16 @@ typedef list<struct md_cache_block_future*> md_cache_block_buffer_t;
 typedef md_cache_block_buffer_t md_cache_completion_buffer_t;
 typedef set<struct md_cache_block_future*> md_cache_ongoing_writes_t;
 typedef list<struct md_cache_entry_key> md_cache_lru_t;
+typedef unordered_map<struct md_cache_entry_key, md_cache_lru_t::iterator, md_cache_entry_key_hash, md_cache_entry_key_eq> md_cache_lru_index_t;
+
+// on-disk LRU snapshot header.  It is followed by num_keys md_cache_entry_keys, least-recently-used first.
+struct md_cache_snapshot_header {
+   
+   uint32_t magic;              // MD_CACHE_SNAPSHOT_MAGIC
+   uint32_t version;            // MD_CACHE_SNAPSHOT_VERSION
+   uint64_t volume_id;
+   uint64_t num_keys;
+};
 
 struct md_syndicate_cache {
    
@@ -93,6 +136,12 @@ struct md_syndicate_cache {
    // reference to global configuration 
    struct md_syndicate_conf* conf;
    
+   // if not NULL, blocks are packed into segment files instead of stored one per file
+   struct md_segstore* segstore;
+   
+   // if not NULL, writes are submitted and reaped through io_uring by the cache thread, instead of through POSIX AIO
+   struct md_uring* uring;
+   
    int num_blocks_written;                  // how many blocks have been successfully written to disk?
    
    // data to cache that is scheduled to be written to disk 
@@ -119,6 +168,9 @@ struct md_syndicate_cache {
    md_cache_lru_t* cache_lru;
    pthread_rwlock_t cache_lru_lock;
    
+   // where each block is in cache_lru, so we can promote/demote/evict in constant time (guarded by cache_lru_lock)
+   md_cache_lru_index_t* cache_lru_index;
+   
    // blocks to be promoted in the current lru 
    md_cache_lru_t* promotes;
    pthread_rwlock_t promotes_lock;
@@ -134,6 +186,12 @@ struct md_syndicate_cache {
    md_cache_lru_t* evicts_1;
    md_cache_lru_t* evicts_2;
    
+   // blocks restored from the last LRU snapshot that we have not yet confirmed are on disk (only accessed by the cache thread)
+   md_cache_lru_t* unvalidated;
+   
+   // when we last saved an LRU snapshot
+   struct timespec last_snapshot;
+   
    // thread for processing writes and evictions
    pthread_t thread;
    bool running;
@@ -164,6 +222,9 @@ int md_cache_start( struct md_syndicate_cache* cache );
 int md_cache_stop( struct md_syndicate_cache* cache );
 int md_cache_destroy( struct md_syndicate_cache* cache );
 
+// LRU snapshots
+int md_cache_snapshot_save( struct md_syndicate_cache* cache );
+
 // asynchronous writes
 struct md_cache_block_future* md_cache_write_block_async( struct md_syndicate_cache* cache,
                                                           uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version,
@@ -184,6 +245,7 @@ int md_cache_flush_writes( vector<struct md_cache_block_future*>* futs );
 int md_cache_is_block_readable( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version );
 int md_cache_open_block( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version, int flags );
 ssize_t md_cache_read_block( int block_fd, char** buf );
+ssize_t md_cache_read_block_by_id( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version, char** buf );
 
 int md_cache_stat_block_by_id( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version, struct stat* sb );
 
@@ -195,11 +257,16 @@ int md_cache_evict_block_async( struct md_syndicate_cache* cache, uint64_t file_
 // allow external client to promote data in the cache (i.e. move it up the LRU)
 int md_cache_promote_block( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, uint64_t block_id, int64_t block_version );
 
+// LRU maintenance, as done by the cache thread (exposed for benchmarking)
+int md_cache_promote_blocks( md_cache_lru_t* cache_lru, md_cache_lru_index_t* cache_lru_index, md_cache_lru_t* promotes );
+int md_cache_demote_blocks( md_cache_lru_t* cache_lru, md_cache_lru_index_t* cache_lru_index, md_cache_lru_t* demotes );
+
 // allow external client to reversion a file 
 int md_cache_reversion_file( struct md_syndicate_cache* cache, uint64_t file_id, int64_t old_file_version, int64_t new_file_version );
 
 // allow external client to scan a file's cached blocks
 int md_cache_file_blocks_apply( char const* local_path, int (*block_func)( char const*, void* ), void* cls );
+int md_cache_file_blocks_apply_by_id( struct md_syndicate_cache* cache, uint64_t file_id, int64_t file_version, int (*block_func)( char const*, void* ), void* cls );
 
 // check a cache write future for I/O errors 
 int md_cache_block_future_has_error( struct md_cache_block_future* f );
@@ -54,9 +54,18 @@ struct SG_client_request_cls {
    SG_messages::Request* message;       // the original control-plane message (if uploading)
    uint64_t dest_gateway_id;            // gateway that was supposed to receive the message
    char* serialized_message;            // serialized control-plane message (if uploading)
-   struct curl_httppost* form_begin;    // curl forms (if uploading)
+   size_t serialized_message_len;       // length of serialized_message
+   curl_mime* form;                     // curl form (if uploading)
    char* url;                           // target URL 
    
+   struct SG_chunk* data_plane;         // buffered data plane (if uploading from RAM)
+   struct SG_client_stream* stream;     // streamed data plane (if uploading from a stream)
+   uint64_t stream_off;                 // how much of the data plane we have sent so far
+   
+   struct md_curl_pool* curl_pool;      // pool the request's curl handle came from
+   bool direct;                         // if true, the response lands in a caller-owned buffer
+   struct curl_slist* headers;          // extra request headers (if any)
+   
    void* cls;                           // user-given download state
 };
 
@@ -67,10 +76,16 @@ void SG_client_request_cls_free( struct SG_client_request_cls* cls ) {
    SG_safe_free( cls->url );
    SG_safe_free( cls->serialized_message );
    
-   if( cls->form_begin != NULL ) {
+   if( cls->form != NULL ) {
+      
+      curl_mime_free( cls->form );
+      cls->form = NULL;
+   }
+   
+   if( cls->headers != NULL ) {
       
-      curl_formfree( cls->form_begin );
-      cls->form_begin = NULL;
+      curl_slist_free_all( cls->headers );
+      cls->headers = NULL;
    }
 }
 
@@ -164,7 +179,9 @@ static int SG_client_get_manifest_curl( struct SG_gateway* gateway, struct SG_re
 
    // parse 
    rc = md_parse< SG_messages::Manifest >( &mmsg, manifest_str, manifest_strlen );
-   SG_safe_free( manifest_str );
+   
+   // the deserializer may have handed back a pooled buffer
+   SG_pool_safe_free( manifest_str );
    
    if( rc != 0 ) {
       
@@ -213,6 +230,7 @@ int SG_client_get_manifest( struct SG_gateway* gateway, struct SG_request_data*
    CURL* curl = NULL;
    struct ms_client* ms = SG_gateway_ms( gateway );
    struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   struct md_curl_pool* curl_pool = SG_gateway_curl_pool( gateway );
    
    uint64_t volume_id = ms_client_get_volume_id( ms );
    
@@ -251,8 +269,7 @@ int SG_client_get_manifest( struct SG_gateway* gateway, struct SG_request_data*
       return rc;
    }
    
-   // TODO: connection pool 
-   curl = curl_easy_init();
+   curl = md_curl_pool_get( curl_pool, manifest_url );
    
    if( curl == NULL ) {
       
@@ -273,7 +290,7 @@ int SG_client_get_manifest( struct SG_gateway* gateway, struct SG_request_data*
       // failed 
       SG_error("SG_gateway_impl_connect_cache('%s') rc = %d\n", manifest_url, rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       SG_safe_free( manifest_url );
       
       return rc;
@@ -285,7 +302,7 @@ int SG_client_get_manifest( struct SG_gateway* gateway, struct SG_request_data*
       // failed 
       SG_error("SG_client_get_manifest_curl( '%s' ) rc = %d\n", manifest_url, rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       SG_safe_free( manifest_url );
    
       return rc;
@@ -303,29 +320,32 @@ int SG_client_get_manifest( struct SG_gateway* gateway, struct SG_request_data*
                reqdat->fs_path, volume_id, reqdat->file_id, reqdat->file_version, reqdat->manifest_timestamp.tv_sec, reqdat->manifest_timestamp.tv_nsec,
                SG_manifest_get_volume_id( manifest ), SG_manifest_get_file_id( manifest ), SG_manifest_get_file_version( manifest ), (long)SG_manifest_get_modtime_sec( manifest ), (long)SG_manifest_get_modtime_nsec( manifest ) );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       SG_safe_free( manifest_url );
    
       return -EBADMSG;
    }
    
-   curl_easy_cleanup( curl );
+   md_curl_pool_release( curl_pool, curl );
    SG_safe_free( manifest_url );
    
    return rc;
 }
 
 
-// set up and start a download context used for transferring data asynchronously 
+// set up and start a download context used for transferring data asynchronously.
+// if buf is not NULL, the response is received directly into it (see md_download_context_init_direct)
+// if io_type is not SG_IO_NONE, it is sent to the remote gateway in the SG_IO_TYPE_HEADER header
 // return 0 on success 
 // return -ENOMEM on OOM 
-int SG_client_download_async_start( struct SG_gateway* gateway, struct md_download_loop* dlloop, struct md_download_context* dlctx, uint64_t chunk_id, char* url, off_t max_size, void* cls ) {
+static int SG_client_download_async_start_ex( struct SG_gateway* gateway, struct md_download_loop* dlloop, struct md_download_context* dlctx, uint64_t chunk_id, char* url, off_t max_size, char* buf, off_t buf_len, int io_type, void* cls ) {
    
    int rc = 0;
    CURL* curl = NULL;
    uint64_t block_size = 0;
    
    struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   struct md_curl_pool* curl_pool = SG_gateway_curl_pool( gateway );
    struct ms_client* ms = SG_gateway_ms( gateway );
    block_size = ms_client_get_volume_blocksize( ms );
    
@@ -335,8 +355,7 @@ int SG_client_download_async_start( struct SG_gateway* gateway, struct md_downlo
       return -ENOMEM;
    }
    
-   // TODO: connection pool 
-   curl = curl_easy_init();
+   curl = md_curl_pool_get( curl_pool, url );
    if( curl == NULL ) {
       
       SG_safe_free( reqcls );
@@ -355,7 +374,7 @@ int SG_client_download_async_start( struct SG_gateway* gateway, struct md_downlo
       // failed 
       SG_error("SG_gateway_impl_connect_cache('%s') rc = %d\n", url, rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       SG_safe_free( reqcls );
       
       return rc;
@@ -365,16 +384,42 @@ int SG_client_download_async_start( struct SG_gateway* gateway, struct md_downlo
    reqcls->url = url;
    reqcls->chunk_id = chunk_id;
    reqcls->cls = cls;
+   reqcls->curl_pool = curl_pool;
+   reqcls->direct = (buf != NULL);
+   
+   if( io_type != SG_IO_NONE ) {
+      
+      // tell the remote gateway what kind of I/O this is 
+      char io_type_header[100];
+      snprintf( io_type_header, 99, "%s: %d", SG_IO_TYPE_HEADER, io_type );
+      
+      reqcls->headers = curl_slist_append( NULL, io_type_header );
+      if( reqcls->headers == NULL ) {
+         
+         md_curl_pool_release( curl_pool, curl );
+         SG_safe_free( reqcls );
+         return -ENOMEM;
+      }
+      
+      curl_easy_setopt( curl, CURLOPT_HTTPHEADER, reqcls->headers );
+   }
    
    // set up 
-   rc = md_download_context_init( dlctx, curl, block_size * SG_MAX_BLOCK_LEN_MULTIPLIER, reqcls );
+   if( buf != NULL ) {
+      rc = md_download_context_init_direct( dlctx, curl, buf, buf_len, block_size * SG_MAX_BLOCK_LEN_MULTIPLIER, reqcls );
+   }
+   else {
+      rc = md_download_context_init( dlctx, curl, block_size * SG_MAX_BLOCK_LEN_MULTIPLIER, reqcls );
+   }
+   
    if( rc != 0 ) {
       
       // failed 
       SG_error("md_download_init('%s') rc = %d\n", url, rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       
+      curl_slist_free_all( reqcls->headers );
       SG_safe_free( reqcls );
       
       return rc;
@@ -391,8 +436,9 @@ int SG_client_download_async_start( struct SG_gateway* gateway, struct md_downlo
       SG_error("md_download_loop_watch rc = %d\n", rc );
       
       md_download_context_free( dlctx, NULL );
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       
+      curl_slist_free_all( reqcls->headers );
       SG_safe_free( reqcls );
       
       return rc;
@@ -407,9 +453,9 @@ int SG_client_download_async_start( struct SG_gateway* gateway, struct md_downlo
       
       md_download_context_free( dlctx, NULL );
       
-      // TODO: connection pool
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       
+      curl_slist_free_all( reqcls->headers );
       SG_safe_free( reqcls );
       
       return rc;
@@ -420,8 +466,17 @@ int SG_client_download_async_start( struct SG_gateway* gateway, struct md_downlo
 }
 
 
-// clean up a download context used for transfering data asynchronously, including the associated state
-// TODO: release the curl handle into the connection pool 
+// set up and start a download context used for transferring data asynchronously 
+// return 0 on success 
+// return -ENOMEM on OOM 
+int SG_client_download_async_start( struct SG_gateway* gateway, struct md_download_loop* dlloop, struct md_download_context* dlctx, uint64_t chunk_id, char* url, off_t max_size, void* cls ) {
+   
+   return SG_client_download_async_start_ex( gateway, dlloop, dlctx, chunk_id, url, max_size, NULL, 0, SG_IO_NONE, cls );
+}
+
+
+// clean up a download context used for transfering data asynchronously, including the associated state.
+// the curl handle goes back to the connection pool it came from 
 void SG_client_download_async_cleanup( struct md_download_context* dlctx ) {
    
    CURL* curl = NULL;
@@ -435,10 +490,7 @@ void SG_client_download_async_cleanup( struct md_download_context* dlctx ) {
       SG_debug("Will free download context %p\n", dlctx );
       md_download_context_free( dlctx, &curl );
       
-      if( curl != NULL ) {
-         // TODO: connection pool 
-         curl_easy_cleanup( curl );
-      }
+      md_curl_pool_release( reqcls != NULL ? reqcls->curl_pool : NULL, curl );
    
       if( reqcls != NULL ) {
          SG_client_request_cls_free( reqcls );
@@ -471,11 +523,14 @@ void SG_client_download_async_cleanup_loop( struct md_download_loop* dlloop ) {
 
 
 // wait for a download to finish, get the buffer, and free the download handle
+// if the download was received directly into a caller-owned buffer, *chunk_buf may point into that buffer, in which case
+// *chunk_owned is set to false.  Otherwise, *chunk_owned is set to true and the caller must free *chunk_buf.
+// *cls is set even if the download failed, so the caller can free it
 // return 0 on success 
 // return -ENODATA if the download did not suceeed with HTTP 200
 // return -errno if we failed to wait for the download, somehow 
 // return -ENOMEM on OOM
-int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t* chunk_id, char** chunk_buf, off_t* chunk_len, void** cls ) {
+static int SG_client_download_async_wait_ex( struct md_download_context* dlctx, uint64_t* chunk_id, char** chunk_buf, off_t* chunk_len, bool* chunk_owned, void** cls ) {
    
    int rc = 0;
    int http_status = 0;
@@ -487,6 +542,10 @@ int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t*
       exit(1);
    }
    
+   if( cls != NULL ) {
+      *cls = reqcls->cls;
+   }
+   
    // are we ready?
    if( !md_download_context_finalized( dlctx ) ) {
       
@@ -513,7 +572,21 @@ int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t*
    }
    
    // get the chunk from the download context 
-   rc = md_download_context_get_buffer( dlctx, chunk_buf, chunk_len );
+   if( reqcls->direct ) {
+      
+      rc = md_download_context_get_direct_buffer( dlctx, chunk_buf, chunk_len );
+      if( rc >= 0 ) {
+         
+         *chunk_owned = (rc > 0);
+         rc = 0;
+      }
+   }
+   else {
+      
+      rc = md_download_context_get_buffer( dlctx, chunk_buf, chunk_len );
+      *chunk_owned = true;
+   }
+   
    if( rc != 0 ) {
       
       // OOM 
@@ -524,10 +597,6 @@ int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t*
    // get the chunk ID from the download's driver
    *chunk_id = reqcls->chunk_id;
    
-   if( cls != NULL ) {
-      *cls = reqcls->cls;
-   }
-   
    // done!
    SG_client_download_async_cleanup( dlctx );
    
@@ -535,13 +604,52 @@ int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t*
 }
 
 
-// begin downloading a block 
+// wait for a download to finish, get the buffer (which the caller must free), and free the download handle
+// *cls is set even if the download failed, so the caller can free it
+// return 0 on success 
+// return -ENODATA if the download did not suceeed with HTTP 200
+// return -errno if we failed to wait for the download, somehow 
+// return -ENOMEM on OOM
+int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t* chunk_id, char** chunk_buf, off_t* chunk_len, void** cls ) {
+   
+   int rc = 0;
+   bool chunk_owned = false;
+   char* buf = NULL;
+   
+   rc = SG_client_download_async_wait_ex( dlctx, chunk_id, &buf, chunk_len, &chunk_owned, cls );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
+   if( !chunk_owned ) {
+      
+      *chunk_buf = SG_CALLOC( char, *chunk_len + 1 );
+      if( *chunk_buf == NULL ) {
+         return -ENOMEM;
+      }
+      
+      memcpy( *chunk_buf, buf, *chunk_len );
+   }
+   else {
+      
+      *chunk_buf = buf;
+   }
+   
+   return 0;
+}
+
+
+// begin downloading a block.
+// if buf is not NULL, the signed block will be received directly into it for as long as it fits (the remainder spills into
+// the download context's own buffer), so SG_client_get_block_finish can verify and deserialize it without first copying it.
+// buf must remain valid until the download is finished and the block is retrieved.
+// reqdat's io_type hint (if set) is sent along to the remote gateway.
 // NOTE: reqdat must be a block request
 // return 0 on success, and set up *dlctx to refer to the downloading context
 // return -ENOMEM if OOM
 // return -ENOMEM if reqdat isn't a block request
 // return -ENOENT if the remote gateway cannot be looked up 
-int SG_client_get_block_async( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t remote_gateway_id, struct md_download_loop* dlloop, struct md_download_context* dlctx ) {
+int SG_client_get_block_async_direct( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t remote_gateway_id, struct md_download_loop* dlloop, struct md_download_context* dlctx, char* buf, off_t buf_len ) {
    
    int rc = 0;
    char* block_url = NULL;
@@ -583,7 +691,8 @@ int SG_client_get_block_async( struct SG_gateway* gateway, struct SG_request_dat
    }
    
    // GOGOO!
-   rc = SG_client_download_async_start( gateway, dlloop, dlctx, reqdat->block_id, block_url, block_size * SG_MAX_BLOCK_LEN_MULTIPLIER, reqdat_dup );
+   // pass along the I/O type, so the remote driver can tell prefetches from reads 
+   rc = SG_client_download_async_start_ex( gateway, dlloop, dlctx, reqdat->block_id, block_url, block_size * SG_MAX_BLOCK_LEN_MULTIPLIER, buf, buf_len, reqdat->io_hints.io_type, reqdat_dup );
    if( rc != 0 ) {
       
       SG_error("SG_client_download_async_start('%s') rc = %d\n", block_url, rc );
@@ -595,6 +704,18 @@ int SG_client_get_block_async( struct SG_gateway* gateway, struct SG_request_dat
 }
 
 
+// begin downloading a block 
+// NOTE: reqdat must be a block request
+// return 0 on success, and set up *dlctx to refer to the downloading context
+// return -ENOMEM if OOM
+// return -ENOMEM if reqdat isn't a block request
+// return -ENOENT if the remote gateway cannot be looked up 
+int SG_client_get_block_async( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t remote_gateway_id, struct md_download_loop* dlloop, struct md_download_context* dlctx ) {
+   
+   return SG_client_get_block_async_direct( gateway, reqdat, remote_gateway_id, dlloop, dlctx, NULL, 0 );
+}
+
+
 // log a hash mismatch
 // always succeeds
 static void SG_client_log_hash_mismatch( unsigned char* expected_block_hash, unsigned char* block_hash ) {
@@ -869,30 +990,38 @@ static int SG_client_block_authenticate( struct SG_gateway* gateway, struct SG_m
    return 0;
 } 
 
-// parse a block from a download context, and use the manifest to verify it's integrity 
-// if the block is still downloading, wait for it to finish (indefinitely). Otherwise, load right away.
-// deserialize the block once we have it.
-// return 0 on success, and populate *block with its contents 
+// get a block from a download context, and use the manifest to verify its integrity.
+// if the block is still downloading, wait for it to finish (indefinitely).
+// on success, *serialized_block is the block as the writer's driver serialized it (without its signed header),
+// and *ret_reqdat is the request that fetched it.  The caller must free *ret_reqdat.
+// If the block was received directly into a caller-owned buffer, serialized_block->data points into that buffer
+// and *block_owned is set to false; otherwise *block_owned is set to true and the caller must free serialized_block.
+// return 0 on success
 // return -ENOMEM on OOM 
-// return -EINVAL if the request is not for a block
 // return -ENODATA if the download context did not successfully finish
 // return -EBADMSG if the block's authenticity could not be verified with the manifest
-int SG_client_get_block_finish( struct SG_gateway* gateway, struct SG_manifest* manifest, struct md_download_context* dlctx, uint64_t* block_id, struct SG_chunk* deserialized_block ) {
+static int SG_client_get_block_finish_serialized( struct SG_gateway* gateway, struct SG_manifest* manifest, struct md_download_context* dlctx, uint64_t* block_id, struct SG_chunk* serialized_block, bool* block_owned, struct SG_request_data** ret_reqdat ) {
    
    int rc = 0;
    char* block_buf = NULL;
    off_t block_len = 0;
    uint64_t block_data_offset = 0;
+   bool owned = false;
 
    struct SG_request_data* reqdat = NULL;
    struct SG_chunk block_chunk;
    
    // get the data; recover the original reqdat
-   rc = SG_client_download_async_wait( dlctx, block_id, &block_buf, &block_len, (void**)&reqdat );
+   rc = SG_client_download_async_wait_ex( dlctx, block_id, &block_buf, &block_len, &owned, (void**)&reqdat );
    if( rc != 0 ) {
       
       SG_error("SG_client_download_async_wait( %p ) rc = %d\n", dlctx, rc );
       
+      if( reqdat != NULL ) {
+         SG_request_data_free( reqdat );
+         SG_safe_free( reqdat );
+      }
+      
       return rc;
    }
   
@@ -908,7 +1037,9 @@ int SG_client_get_block_finish( struct SG_gateway* gateway, struct SG_manifest*
          rc = -EBADMSG;
       }
 
-      SG_safe_free( block_buf );
+      if( owned ) {
+         SG_safe_free( block_buf );
+      }
       memset( &block_chunk, 0, sizeof(struct SG_chunk) );
 
       SG_request_data_free( reqdat );
@@ -918,14 +1049,53 @@ int SG_client_get_block_finish( struct SG_gateway* gateway, struct SG_manifest*
    }
 
    // does the actual block data start somewhere else?
-   block_chunk.data = block_chunk.data + block_data_offset;
-   block_chunk.len -= block_data_offset; 
+   if( !owned ) {
+      
+      // caller's buffer; just point past the header
+      block_buf += block_data_offset;
+   }
+   else if( block_data_offset > 0 ) {
+      memmove( block_buf, block_buf + block_data_offset, block_len - block_data_offset );
+   }
+   
+   serialized_block->data = block_buf;
+   serialized_block->len = block_len - block_data_offset;
+   
+   *block_owned = owned;
+   *ret_reqdat = reqdat;
+   return 0;
+}
+
+
+// parse a block from a download context, and use the manifest to verify it's integrity 
+// if the block is still downloading, wait for it to finish (indefinitely). Otherwise, load right away.
+// deserialize the block once we have it.
+// return 0 on success, and populate *block with its contents 
+// return -ENOMEM on OOM 
+// return -EINVAL if the request is not for a block
+// return -ENODATA if the download context did not successfully finish
+// return -EBADMSG if the block's authenticity could not be verified with the manifest
+int SG_client_get_block_finish( struct SG_gateway* gateway, struct SG_manifest* manifest, struct md_download_context* dlctx, uint64_t* block_id, struct SG_chunk* deserialized_block ) {
+   
+   int rc = 0;
+   struct SG_request_data* reqdat = NULL;
+   struct SG_chunk block_chunk;
+   bool block_owned = false;
+   
+   memset( &block_chunk, 0, sizeof(struct SG_chunk) );
+   
+   rc = SG_client_get_block_finish_serialized( gateway, manifest, dlctx, block_id, &block_chunk, &block_owned, &reqdat );
+   if( rc != 0 ) {
+      return rc;
+   }
 
    // deserialize
    rc = SG_gateway_impl_deserialize( gateway, reqdat, &block_chunk, deserialized_block );
 
-   SG_safe_free( block_buf );
-   memset( &block_chunk, 0, sizeof(struct SG_chunk) );
+   if( block_owned ) {
+      SG_chunk_free( &block_chunk );
+   }
+
    SG_request_data_free( reqdat );
    SG_safe_free( reqdat );
 
@@ -938,6 +1108,45 @@ int SG_client_get_block_finish( struct SG_gateway* gateway, struct SG_manifest*
 }
 
 
+// get a block from a download context and verify it against the manifest, like SG_client_get_block_finish, 
+// but do not deserialize it.  This is the form the block takes in the cache.
+// return 0 on success, and set *serialized_block (which the caller must free)
+// return -ENOMEM on OOM 
+// return -ENODATA if the download context did not successfully finish
+// return -EBADMSG if the block's authenticity could not be verified with the manifest
+int SG_client_get_block_finish_raw( struct SG_gateway* gateway, struct SG_manifest* manifest, struct md_download_context* dlctx, uint64_t* block_id, struct SG_chunk* serialized_block ) {
+   
+   int rc = 0;
+   struct SG_request_data* reqdat = NULL;
+   bool block_owned = false;
+   char* block_buf = NULL;
+   
+   rc = SG_client_get_block_finish_serialized( gateway, manifest, dlctx, block_id, serialized_block, &block_owned, &reqdat );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
+   SG_request_data_free( reqdat );
+   SG_safe_free( reqdat );
+   
+   if( !block_owned ) {
+      
+      // the caller gets its own copy
+      block_buf = SG_CALLOC( char, serialized_block->len + 1 );
+      if( block_buf == NULL ) {
+         
+         memset( serialized_block, 0, sizeof(struct SG_chunk) );
+         return -ENOMEM;
+      }
+      
+      memcpy( block_buf, serialized_block->data, serialized_block->len );
+      serialized_block->data = block_buf;
+   }
+   
+   return 0;
+}
+
+
 // clean up an aborted download loop used for getting blocks 
 // return 0 on success 
 int SG_client_get_block_cleanup_loop( struct md_download_loop* dlloop ) {
@@ -952,8 +1161,16 @@ int SG_client_get_block_cleanup_loop( struct md_download_loop* dlloop ) {
          break;
       }
       
-      struct SG_request_data* reqdat = (struct SG_request_data*)md_download_context_get_cls( dlctx );
-      md_download_context_set_cls( dlctx, NULL );
+      struct SG_client_request_cls* reqcls = (struct SG_client_request_cls*)md_download_context_get_cls( dlctx );
+      struct SG_request_data* reqdat = NULL;
+      
+      if( reqcls == NULL ) {
+         continue;
+      }
+      
+      // the download state is freed by SG_client_download_async_cleanup_loop; we just free the request data
+      reqdat = (struct SG_request_data*)reqcls->cls;
+      reqcls->cls = NULL;
 
       if( reqdat != NULL ) { 
          SG_request_data_free( reqdat );
@@ -965,6 +1182,29 @@ int SG_client_get_block_cleanup_loop( struct md_download_loop* dlloop ) {
 }
 
 
+// throw away a block download without processing it (e.g. the loser of a hedged request).
+// the download should be finalized (i.e. it finished or was cancelled).
+// always succeeds
+void SG_client_get_block_discard( struct md_download_context* dlctx ) {
+   
+   struct SG_client_request_cls* reqcls = (struct SG_client_request_cls*)md_download_context_get_cls( dlctx );
+   struct SG_request_data* reqdat = NULL;
+   
+   if( reqcls != NULL ) {
+      
+      reqdat = (struct SG_request_data*)reqcls->cls;
+      reqcls->cls = NULL;
+      
+      if( reqdat != NULL ) {
+         SG_request_data_free( reqdat );
+         SG_safe_free( reqdat );
+      }
+   }
+   
+   SG_client_download_async_cleanup( dlctx );
+}
+
+
 // get an xattr by name 
 // return 0 on success, and set *xattr_value and *xattr_value_len
 // return -ENOMEM on OOM 
@@ -1003,23 +1243,23 @@ int SG_client_getxattr( struct SG_gateway* gateway, uint64_t gateway_id, char co
     
     gateway_cert = NULL;
     
-    // TODO: connection pool 
-    curl = curl_easy_init();
-    if( curl == NULL ) {
-        return -ENOMEM;
-    }
-    
     rc = md_url_make_getxattr_url( ms, fs_path, gateway_id, file_id, file_version, xattr_name, xattr_nonce, &xattr_url );
     if( rc != 0 ) {
         
-        curl_easy_cleanup( curl );
         return rc;
     }
     
+    curl = md_curl_pool_get( SG_gateway_curl_pool( gateway ), xattr_url );
+    if( curl == NULL ) {
+        
+        SG_safe_free( xattr_url );
+        return -ENOMEM;
+    }
+    
     md_init_curl_handle( conf, curl, xattr_url, conf->connect_timeout );
     
     rc = md_download_run( curl, SG_MAX_XATTR_LEN, &buf, &len );
-    curl_easy_cleanup( curl );
+    md_curl_pool_release( SG_gateway_curl_pool( gateway ), curl );
     
     if( rc != 0 ) {
         
@@ -1137,23 +1377,23 @@ int SG_client_listxattrs( struct SG_gateway* gateway, uint64_t gateway_id, char
     
     gateway_cert = NULL;
     
-    // TODO: connection pool 
-    curl = curl_easy_init();
-    if( curl == NULL ) {
-        return -ENOMEM;
-    }
-    
     rc = md_url_make_listxattr_url( ms, fs_path, gateway_id, file_id, file_version, xattr_nonce, &xattr_url );
     if( rc != 0 ) {
         
-        curl_easy_cleanup( curl );
         return rc;
     }
     
+    curl = md_curl_pool_get( SG_gateway_curl_pool( gateway ), xattr_url );
+    if( curl == NULL ) {
+        
+        SG_safe_free( xattr_url );
+        return -ENOMEM;
+    }
+    
     md_init_curl_handle( conf, curl, xattr_url, conf->connect_timeout );
     
     rc = md_download_run( curl, SG_MAX_XATTR_LEN, &buf, &len );
-    curl_easy_cleanup( curl );
+    md_curl_pool_release( SG_gateway_curl_pool( gateway ), curl );
     
     if( rc != 0 ) {
         
@@ -1934,13 +2174,14 @@ int SG_client_request_REMOVEXATTR_setup( struct SG_gateway* gateway, SG_messages
 
 
 // begin sending a request 
-// serialize the given message, and set up a request cls.
+// serialize the given message, and set up a request cls.  The form is built later by SG_client_request_form_init.
+// at most one of data_plane and data_stream may be non-NULL; the data plane will be pulled by SG_client_request_data_read
 // NOTE: the download takes ownership of control_plane--the caller should not manipulate it in any way while the download is proceeding
 // NOTE: control_plane should be signed beforehand
 // return 0 on success, and set up *reqcls
 // return -ENOMEM on OOM 
 // return -EAGAIN if the destination gateway is not known to us, but could become known if we reloaded our volumeconfiguration
-static int SG_client_request_begin( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, struct SG_client_request_cls* reqcls ) {
+static int SG_client_request_begin( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, struct SG_client_stream* data_stream, struct SG_client_request_cls* reqcls ) {
    
    int rc = 0;
    char* gateway_url = NULL;
@@ -1948,9 +2189,6 @@ static int SG_client_request_begin( struct SG_gateway* gateway, uint64_t dest_ga
    char* serialized_message = NULL;
    size_t serialized_message_len = 0;
    
-   struct curl_httppost* form_begin = NULL;
-   struct curl_httppost* form_end = NULL;
-   
    struct ms_client* ms = SG_gateway_ms( gateway );
    
    // look up gateway 
@@ -1973,54 +2211,160 @@ static int SG_client_request_begin( struct SG_gateway* gateway, uint64_t dest_ga
       return rc;
    }
    
-   // control-plane
-   rc = curl_formadd( &form_begin, &form_end, CURLFORM_PTRNAME, SG_post_field_control,
-                                              CURLFORM_CONTENTSLENGTH, serialized_message_len, 
-                                              CURLFORM_PTRCONTENTS, serialized_message,
-                                              CURLFORM_CONTENTTYPE, "application/octet-stream",
-                                              CURLFORM_END );
+   // success!
+   memset( reqcls, 0, sizeof(struct SG_client_request_cls) );
    
-   if( rc != 0 ) {
+   reqcls->url = gateway_url;
+   reqcls->serialized_message = serialized_message;
+   reqcls->serialized_message_len = serialized_message_len;
+   reqcls->message = control_plane;
+   reqcls->dest_gateway_id = dest_gateway_id;
+   reqcls->data_plane = data_plane;
+   reqcls->stream = data_stream;
+   reqcls->stream_off = 0;
+   
+   return 0;
+}
+
+
+// length of a request's data plane 
+static uint64_t SG_client_request_data_len( struct SG_client_request_cls* reqcls ) {
+   
+   if( reqcls->stream != NULL ) {
+      return reqcls->stream->len;
+   }
+   
+   return reqcls->data_plane->len;
+}
+
+
+// curl read callback for a request's data plane.
+// pulls the next bytes from the request's buffer or stream, at the request's own offset.
+// return the number of bytes read on success (0 on EOF)
+// return CURL_READFUNC_ABORT on error
+static size_t SG_client_request_data_read( char* buf, size_t size, size_t nmemb, void* userp ) {
+   
+   struct SG_client_request_cls* reqcls = (struct SG_client_request_cls*)userp;
+   struct SG_client_stream* stream = reqcls->stream;
+   uint64_t data_len = SG_client_request_data_len( reqcls );
+   size_t len = size * nmemb;
+   ssize_t nr = 0;
+   
+   if( reqcls->stream_off >= data_len ) {
       
-      SG_error("curl_formadd rc = %d\n", rc );
+      // EOF
+      return 0;
+   }
+   
+   len = MIN( len, data_len - reqcls->stream_off );
+   
+   if( stream == NULL ) {
       
-      SG_safe_free( gateway_url );
-      SG_safe_free( serialized_message );
+      // buffered 
+      memcpy( buf, reqcls->data_plane->data + reqcls->stream_off, len );
+      reqcls->stream_off += len;
+      return len;
+   }
+   
+   nr = (*stream->read)( stream->cls, buf, len, reqcls->stream_off );
+   if( nr < 0 ) {
       
+      SG_error("stream read(%p, %zu, %" PRIu64 ") rc = %zd\n", stream, len, reqcls->stream_off, nr );
+      return CURL_READFUNC_ABORT;
+   }
+   
+   reqcls->stream_off += nr;
+   return (size_t)nr;
+}
+
+
+// curl seek callback for a request's data plane, so the upload can be rewound (e.g. on redirect or auth retry)
+// return CURL_SEEKFUNC_OK on success
+// return CURL_SEEKFUNC_FAIL if the offset is invalid
+static int SG_client_request_data_seek( void* userp, curl_off_t offset, int origin ) {
+   
+   struct SG_client_request_cls* reqcls = (struct SG_client_request_cls*)userp;
+   uint64_t data_len = SG_client_request_data_len( reqcls );
+   curl_off_t new_off = offset;
+   
+   if( origin == SEEK_CUR ) {
+      new_off += reqcls->stream_off;
+   }
+   else if( origin == SEEK_END ) {
+      new_off += data_len;
+   }
+   
+   if( new_off < 0 || (uint64_t)new_off > data_len ) {
+      return CURL_SEEKFUNC_FAIL;
+   }
+   
+   reqcls->stream_off = new_off;
+   return CURL_SEEKFUNC_OK;
+}
+
+
+// build a request's multipart form on the curl handle that will send it, and have the handle POST it.
+// the control plane is copied into the form; the data plane (if any) is pulled by SG_client_request_data_read, 
+// and can be rewound with SG_client_request_data_seek.  reqcls must not move until the transfer is done.
+// return 0 on success 
+// return -ENOMEM on OOM 
+static int SG_client_request_form_init( CURL* curl, struct SG_client_request_cls* reqcls ) {
+   
+   int rc = 0;
+   curl_mime* form = NULL;
+   curl_mimepart* part = NULL;
+   
+   form = curl_mime_init( curl );
+   if( form == NULL ) {
       return -ENOMEM;
    }
    
-   // do we have a data plane?
-   if( data_plane != NULL ) {
+   // control-plane
+   part = curl_mime_addpart( form );
+   if( part == NULL ) {
+      
+      rc = -ENOMEM;
+      goto SG_client_request_form_init_fail;
+   }
+   
+   if( curl_mime_name( part, SG_post_field_control ) != CURLE_OK ||
+       curl_mime_data( part, reqcls->serialized_message, reqcls->serialized_message_len ) != CURLE_OK ||
+       curl_mime_type( part, "application/octet-stream" ) != CURLE_OK ) {
       
-      rc = curl_formadd( &form_begin, &form_end, CURLFORM_PTRNAME, SG_post_field_data,
-                                                 CURLFORM_CONTENTSLENGTH, data_plane->len,
-                                                 CURLFORM_PTRCONTENTS, data_plane->data,
-                                                 CURLFORM_CONTENTTYPE, "application/octet-stream",
-                                                 CURLFORM_END );
+      rc = -ENOMEM;
+      goto SG_client_request_form_init_fail;
+   }
+   
+   // do we have a data plane?
+   if( reqcls->data_plane != NULL || reqcls->stream != NULL ) {
       
-      if( rc != 0 ) {
+      part = curl_mime_addpart( form );
+      if( part == NULL ) {
          
-         SG_error("curl_formadd rc = %d\n", rc );
-         
-         curl_formfree( form_begin );
-         SG_safe_free( gateway_url );
-         SG_safe_free( serialized_message );
+         rc = -ENOMEM;
+         goto SG_client_request_form_init_fail;
+      }
+      
+      // curl will pass reqcls to the read and seek callbacks; it owns nothing, so there is no free callback
+      if( curl_mime_name( part, SG_post_field_data ) != CURLE_OK ||
+          curl_mime_data_cb( part, (curl_off_t)SG_client_request_data_len( reqcls ), SG_client_request_data_read, SG_client_request_data_seek, NULL, reqcls ) != CURLE_OK ||
+          curl_mime_type( part, "application/octet-stream" ) != CURLE_OK ) {
          
-         return -ENOMEM;
+         rc = -ENOMEM;
+         goto SG_client_request_form_init_fail;
       }
    }
    
-   // success!
-   memset( reqcls, 0, sizeof(struct SG_client_request_cls) );
-   
-   reqcls->url = gateway_url;
-   reqcls->form_begin = form_begin;
-   reqcls->serialized_message = serialized_message;
-   reqcls->message = control_plane;
-   reqcls->dest_gateway_id = dest_gateway_id;
+   curl_easy_setopt( curl, CURLOPT_MIMEPOST, form );
+   reqcls->form = form;
    
    return 0;
+   
+SG_client_request_form_init_fail:
+   
+   SG_error("Failed to build form for '%s'\n", reqcls->url );
+   curl_mime_free( form );
+   return rc;
 }
 
 
@@ -2099,27 +2443,34 @@ int SG_client_request_send( struct SG_gateway* gateway, uint64_t dest_gateway_id
    struct SG_chunk serialized_reply;
    
    struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   struct md_curl_pool* curl_pool = SG_gateway_curl_pool( gateway );
    
-   // TODO: connection pool
-   curl = curl_easy_init();
-   if( curl == NULL ) {
-      
-      return -ENOMEM;
-   }
-   
-   rc = SG_client_request_begin( gateway, dest_gateway_id, control_plane, data_plane, &reqcls );
+   rc = SG_client_request_begin( gateway, dest_gateway_id, control_plane, data_plane, NULL, &reqcls );
    if( rc != 0 ) {
       
-      curl_easy_cleanup( curl );
       SG_error("SG_client_request_begin( %" PRIu64 " ) rc = %d\n", dest_gateway_id, rc );
       return rc;
    }
    
+   curl = md_curl_pool_get( curl_pool, reqcls.url );
+   if( curl == NULL ) {
+      
+      SG_client_request_cls_free( &reqcls );
+      return -ENOMEM;
+   }
+   
    // set up curl handle 
    md_init_curl_handle( conf, curl, reqcls.url, conf->connect_timeout );
    
    curl_easy_setopt( curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL );    // force POST on redirect
-   curl_easy_setopt( curl, CURLOPT_HTTPPOST, reqcls.form_begin );
+   
+   rc = SG_client_request_form_init( curl, &reqcls );
+   if( rc != 0 ) {
+      
+      md_curl_pool_release( curl_pool, curl );
+      SG_client_request_cls_free( &reqcls );
+      return rc;
+   }
    
    // run the transfer 
    rc = md_download_run( curl, SG_CLIENT_MAX_REPLY_LEN, &serialized_reply.data, &serialized_reply.len );
@@ -2129,7 +2480,7 @@ int SG_client_request_send( struct SG_gateway* gateway, uint64_t dest_gateway_id
       // 400-level HTTP error 
       SG_error("md_download_run('%s') HTTP status %d\n", reqcls.url, -rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       
       SG_client_request_cls_free( &reqcls );
 
@@ -2157,7 +2508,7 @@ int SG_client_request_send( struct SG_gateway* gateway, uint64_t dest_gateway_id
       // failed 
       SG_error("md_download_run('%s') rc = %d\n", reqcls.url, rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       
       SG_client_request_cls_free( &reqcls );
       
@@ -2172,7 +2523,7 @@ int SG_client_request_send( struct SG_gateway* gateway, uint64_t dest_gateway_id
       SG_error("SG_client_request_end('%s') rc = %d\n", reqcls.url, rc );
    }
    
-   curl_easy_cleanup( curl );
+   md_curl_pool_release( curl_pool, curl );
    SG_client_request_cls_free( &reqcls );
    SG_chunk_free( &serialized_reply );
    
@@ -2180,18 +2531,20 @@ int SG_client_request_send( struct SG_gateway* gateway, uint64_t dest_gateway_id
 }
 
 
-// send a message asynchronously to another gateway 
-// NOTE: the caller must NOT free *data_plane until freeing the download context!
+// send a message asynchronously to another gateway, with either a buffered or a streamed data plane (or neither)
+// NOTE: the caller must NOT free *data_plane or *data_stream until freeing the download context!
 // NOTE: the download context takes ownership of control_plane for the duration of the download!
 // return 0 on success, and set up *dlctx as an upload future
 // return -ENOMEM on OOM
-int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, struct md_download_loop* dlloop, struct md_download_context* dlctx ) {
+static int SG_client_request_send_async_ex( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, struct SG_client_stream* data_stream,
+                                            struct md_download_loop* dlloop, struct md_download_context* dlctx ) {
    
    int rc = 0;
    
    CURL* curl = NULL;
    struct md_downloader* dl = SG_gateway_dl( gateway );
    struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   struct md_curl_pool* curl_pool = SG_gateway_curl_pool( gateway );
    
    struct SG_client_request_cls* reqcls = SG_CALLOC( struct SG_client_request_cls, 1 );
    if( reqcls == NULL ) {
@@ -2199,29 +2552,39 @@ int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gate
       return -ENOMEM;
    }
    
-   // TODO: connection pool
-   curl = curl_easy_init();
-   if( curl == NULL ) {
-      
-      SG_safe_free( reqcls );
-      return -ENOMEM;
-   }
-   
-   rc = SG_client_request_begin( gateway, dest_gateway_id, control_plane, data_plane, reqcls );
+   rc = SG_client_request_begin( gateway, dest_gateway_id, control_plane, data_plane, data_stream, reqcls );
    if( rc != 0 ) {
       
       SG_error("SG_client_request_begin( %" PRIu64 " ) rc = %d\n", dest_gateway_id, rc );
       
-      curl_easy_cleanup( curl );
       SG_safe_free( reqcls );
       return rc;
    }
    
+   curl = md_curl_pool_get( curl_pool, reqcls->url );
+   if( curl == NULL ) {
+      
+      SG_client_request_cls_free( reqcls );
+      SG_safe_free( reqcls );
+      return -ENOMEM;
+   }
+   
+   reqcls->curl_pool = curl_pool;
+   
    // set up curl handle 
    md_init_curl_handle( conf, curl, reqcls->url, conf->connect_timeout );
    
    curl_easy_setopt( curl, CURLOPT_POSTREDIR, CURL_REDIR_POST_ALL );    // force POST on redirect
-   curl_easy_setopt( curl, CURLOPT_HTTPPOST, reqcls->form_begin );
+   
+   // the data plane is pulled from the buffer or stream, at this request's offset
+   rc = SG_client_request_form_init( curl, reqcls );
+   if( rc != 0 ) {
+      
+      md_curl_pool_release( curl_pool, curl );
+      SG_client_request_cls_free( reqcls );
+      SG_safe_free( reqcls );
+      return rc;
+   }
    
    // set up the download handle 
    rc = md_download_context_init( dlctx, curl, SG_CLIENT_MAX_REPLY_LEN, reqcls );
@@ -2232,7 +2595,7 @@ int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gate
       SG_client_request_cls_free( reqcls );
       SG_safe_free( reqcls );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       return rc;
    }
    
@@ -2244,9 +2607,11 @@ int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gate
       
       md_download_context_free( dlctx, NULL );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       SG_client_request_cls_free( reqcls );
       SG_safe_free( reqcls );
+      
+      return rc;
    }
    
    // start the download 
@@ -2257,7 +2622,7 @@ int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gate
       
       md_download_context_free( dlctx, NULL );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( curl_pool, curl );
       SG_client_request_cls_free( reqcls );
       SG_safe_free( reqcls );
       
@@ -2268,6 +2633,30 @@ int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gate
 }
 
 
+// send a message asynchronously to another gateway 
+// NOTE: the caller must NOT free *data_plane until freeing the download context!
+// NOTE: the download context takes ownership of control_plane for the duration of the download!
+// return 0 on success, and set up *dlctx as an upload future
+// return -ENOMEM on OOM
+int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, struct md_download_loop* dlloop, struct md_download_context* dlctx ) {
+   
+   return SG_client_request_send_async_ex( gateway, dest_gateway_id, control_plane, data_plane, NULL, dlloop, dlctx );
+}
+
+
+// send a message asynchronously to another gateway, streaming the data plane from *data_plane instead of buffering it.
+// the same stream may be given to many concurrent requests; each request reads it at its own offset.
+// NOTE: the caller must NOT free *data_plane until freeing the download context!
+// NOTE: the download context takes ownership of control_plane for the duration of the download!
+// NOTE: data_plane->read will be called from the downloader thread
+// return 0 on success, and set up *dlctx as an upload future
+// return -ENOMEM on OOM
+int SG_client_request_send_stream_async( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_client_stream* data_plane, struct md_download_loop* dlloop, struct md_download_context* dlctx ) {
+   
+   return SG_client_request_send_async_ex( gateway, dest_gateway_id, control_plane, NULL, data_plane, dlloop, dlctx );
+}
+
+
 // finish sending a message to another gateway
 // return 0 on success, and set up *reply with the validated reply
 // return -EINVAL if the download context was not used in a previous call to SG_client_request_send_async
@@ -28,6 +28,18 @@
 #define SG_CLIENT_MAX_REPLY_LEN         1024000
 
 extern "C" {
+
+// read up to len bytes of a streamed data plane into buf, starting at offset.
+// return the number of bytes read (0 at EOF), or -errno on error
+typedef ssize_t (*SG_client_stream_read_func_t)( void* cls, char* buf, size_t len, uint64_t offset );
+
+// read-only data plane that gets streamed to the remote gateway, instead of being buffered in RAM.
+// reads are positional, so a single stream can feed any number of concurrent requests.
+struct SG_client_stream {
+   uint64_t len;                        // total length of the data plane
+   SG_client_stream_read_func_t read;   // positional read method
+   void* cls;                           // read method state
+};
     
 // extra data to include in a write
 struct SG_client_WRITE_data;
@@ -45,8 +57,11 @@ int SG_client_WRITE_data_merge( struct SG_client_WRITE_data* dat, struct md_entr
 // GET operations
 int SG_client_get_manifest( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t remote_gateway_id, struct SG_manifest* manifest );
 int SG_client_get_block_async( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t remote_gateway_id, struct md_download_loop* dlloop, struct md_download_context* dlctx );
+int SG_client_get_block_async_direct( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t remote_gateway_id, struct md_download_loop* dlloop, struct md_download_context* dlctx, char* buf, off_t buf_len );
 int SG_client_get_block_finish( struct SG_gateway* gateway, struct SG_manifest* manifest, struct md_download_context* dlctx, uint64_t* block_id, struct SG_chunk* block );
+int SG_client_get_block_finish_raw( struct SG_gateway* gateway, struct SG_manifest* manifest, struct md_download_context* dlctx, uint64_t* block_id, struct SG_chunk* serialized_block );
 int SG_client_get_block_cleanup_loop( struct md_download_loop* dlloop );
+void SG_client_get_block_discard( struct md_download_context* dlctx );
 int SG_client_getxattr( struct SG_gateway* gateway, uint64_t gateway_id, char const* fs_path, uint64_t file_id, int64_t file_version, char const* xattr_name, uint64_t xattr_nonce, char** xattr_value, size_t* xattr_len );
 int SG_client_listxattrs( struct SG_gateway* gateway, uint64_t gateway_id, char const* fs_path, uint64_t file_id, int64_t file_version, uint64_t xattr_nonce, char** xattr_list, size_t* xattr_list_len );
 
@@ -69,11 +84,12 @@ int SG_client_request_REMOVEXATTR_setup( struct SG_gateway* gateway, SG_messages
 // gateway-to-gateway messaging.  The corresponding driver methods will be run 
 int SG_client_request_send( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, SG_messages::Reply* reply );
 int SG_client_request_send_async( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_chunk* data_plane, struct md_download_loop* dlloop, struct md_download_context* dlctx );
+int SG_client_request_send_stream_async( struct SG_gateway* gateway, uint64_t dest_gateway_id, SG_messages::Request* control_plane, struct SG_client_stream* data_plane, struct md_download_loop* dlloop, struct md_download_context* dlctx );
 int SG_client_request_send_finish( struct SG_gateway* gateway, struct md_download_context* dlctx, SG_messages::Reply* reply );
 
 // low-level download logic 
 int SG_client_download_async_start( struct SG_gateway* gateway, struct md_download_loop* dlloop, struct md_download_context* dlctx, uint64_t chunk_id, char* url, off_t max_size, void* cls );
-int SG_client_download_async_wait( struct md_download_context* dlctx, char** chunk_buf, off_t* chunk_len, void** cls );
+int SG_client_download_async_wait( struct md_download_context* dlctx, uint64_t* chunk_id, char** chunk_buf, off_t* chunk_len, void** cls );
 void SG_client_download_async_cleanup( struct md_download_context* dlctx );
 void SG_client_download_async_cleanup_loop( struct md_download_loop* dlloop );
 
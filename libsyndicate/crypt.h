@@ -92,14 +92,20 @@ size_t md_decrypt_symmetric_ex_plaintext_len( size_t ciphertext_len );
 }
 
 
+// pluggable signing and verification methods, so callers can choose where the RSA work happens.
+// they have the same semantics as md_sign_message and md_verify_signature, respectively.
+typedef int (*md_sign_message_func_t)( void* cls, EVP_PKEY* pkey, char const* data, size_t len, char** sigb64, size_t* sigb64_len );
+typedef int (*md_verify_signature_func_t)( void* cls, EVP_PKEY* public_key, char const* data, size_t len, char* sigb64, size_t sigb64_len );
+
 // signature verifier
 // have to put this here, since C++ forbids separating the declaration and definition of template functions across multiple files???
 // NOTE:  class T should be a protobuf, and should have a string signature field
+// if verify_func is not NULL, it will be used to check the signature (otherwise, md_verify_signature is used)
 // return 0 on successful verification 
 // return -ENOMEM on OOM 
 // return -EINVAL if the signature length is invalid
 // return -EINVAL if the signature itself does not match
-template <class T> int md_verify( EVP_PKEY* pkey, T* protobuf ) {
+template <class T> int md_verify_ex( EVP_PKEY* pkey, T* protobuf, md_verify_signature_func_t verify_func, void* verify_cls ) {
    // get the signature
    size_t sigb64_len = protobuf->signature().size();
    int rc = 0;
@@ -145,7 +151,12 @@ template <class T> int md_verify( EVP_PKEY* pkey, T* protobuf ) {
    }
    
    // verify the signature
-   rc = md_verify_signature( pkey, bits.data(), bits.size(), sigb64, sigb64_len );
+   if( verify_func != NULL ) {
+      rc = (*verify_func)( verify_cls, pkey, bits.data(), bits.size(), sigb64, sigb64_len );
+   }
+   else {
+      rc = md_verify_signature( pkey, bits.data(), bits.size(), sigb64, sigb64_len );
+   }
    
    // revert
    try {
@@ -166,10 +177,21 @@ template <class T> int md_verify( EVP_PKEY* pkey, T* protobuf ) {
 }
 
 
+// signature verifier, using md_verify_signature
+// return 0 on successful verification 
+// return -ENOMEM on OOM 
+// return -EINVAL if the signature length is invalid
+// return -EINVAL if the signature itself does not match
+template <class T> int md_verify( EVP_PKEY* pkey, T* protobuf ) {
+   return md_verify_ex< T >( pkey, protobuf, NULL, NULL );
+}
+
+
 // signature generator
 // have to put this here, since C++ forbids separating the declaration and definition of template functions across multiple files???
 // NOTE: class T should be a protobuf, and should have a string signature field 
-template <class T> int md_sign( EVP_PKEY* pkey, T* protobuf ) {
+// if sign_func is not NULL, it will be used to generate the signature (otherwise, md_sign_message is used)
+template <class T> int md_sign_ex( EVP_PKEY* pkey, T* protobuf, md_sign_message_func_t sign_func, void* sign_cls ) {
    
    try {
       protobuf->set_signature( "" );
@@ -198,7 +220,15 @@ template <class T> int md_sign( EVP_PKEY* pkey, T* protobuf ) {
    char* sigb64 = NULL;
    size_t sigb64_len = 0;
 
-   int rc = md_sign_message( pkey, bits.data(), bits.size(), &sigb64, &sigb64_len );
+   int rc = 0;
+   
+   if( sign_func != NULL ) {
+      rc = (*sign_func)( sign_cls, pkey, bits.data(), bits.size(), &sigb64, &sigb64_len );
+   }
+   else {
+      rc = md_sign_message( pkey, bits.data(), bits.size(), &sigb64, &sigb64_len );
+   }
+   
    if( rc != 0 ) {
       
       SG_error("md_sign_message rc = %d\n", rc );
@@ -218,4 +248,10 @@ template <class T> int md_sign( EVP_PKEY* pkey, T* protobuf ) {
    return 0;
 }
 
+
+// signature generator, using md_sign_message
+template <class T> int md_sign( EVP_PKEY* pkey, T* protobuf ) {
+   return md_sign_ex< T >( pkey, protobuf, NULL, NULL );
+}
+
 #endif
@@ -16,6 +16,12 @@
 
 #include "libsyndicate/download.h"
 
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// maximum number of socket events to process per epoll_wait() 
+#define MD_DOWNLOADER_MAX_EVENTS        64
+
 // download set
 struct md_download_set {
    
@@ -48,6 +54,8 @@ struct md_download_context {
    
    struct md_download_set* dlset;       // parent group containing this context
    
+   struct md_downloader* dl;            // downloader (shard) that is running this context
+   
    sem_t sem;   // client holds this to be woken up when the download finishes 
    
    void* cls;   // associated download state
@@ -73,6 +81,14 @@ struct md_downloader {
    
    CURLM* curlm;        // multi-download
    
+   int epoll_fd;        // epoll set of the sockets curl is waiting on, plus event_fd
+   int event_fd;        // written to wake up the downloader thread (new pending/cancelling contexts, or stop)
+   int64_t timer_deadline_ms;   // absolute time (CLOCK_MONOTONIC, in millis) at which curl wants a timeout action, or -1 for none
+   
+   struct md_downloader* shards;        // if non-NULL, then this downloader only dispatches contexts to these downloaders 
+   int num_shards;
+   uint64_t next_shard;                 // round-robin counter for picking a shard
+   
    bool running;        // if true, then this downloader is running
    bool inited;         // if true, then this downloader is fully initialized
 };
@@ -149,6 +165,99 @@ int md_downloader_cancelling_unlock( struct md_downloader* dl ) {
 }
 
 
+// current monotonic time, in millis 
+static int64_t md_downloader_now_ms() {
+   
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   
+   return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// wake up the downloader thread, so it will re-check pending and cancelling contexts and its running state
+// return 0 on success
+// return -errno if we failed to write the eventfd
+static int md_downloader_wakeup( struct md_downloader* dl ) {
+   
+   uint64_t one = 1;
+   ssize_t nw = write( dl->event_fd, &one, sizeof(uint64_t) );
+   
+   if( nw < 0 ) {
+      
+      int rc = -errno;
+      if( rc == -EAGAIN ) {
+         // counter is saturated, so the thread will wake up anyway 
+         return 0;
+      }
+      
+      SG_error("%s: write(eventfd) rc = %d\n", dl->name, rc );
+      return rc;
+   }
+   
+   return 0;
+}
+
+// curl socket callback: keep the epoll set in sync with the sockets curl is interested in
+// return 0 on success
+// return -1 if we failed to update the epoll set (aborts curl_multi_socket_action)
+static int md_downloader_socket_cb( CURL* curl, curl_socket_t sockfd, int what, void* userp, void* socketp ) {
+   
+   struct md_downloader* dl = (struct md_downloader*)userp;
+   struct epoll_event ev;
+   int rc = 0;
+   
+   memset( &ev, 0, sizeof(struct epoll_event) );
+   
+   if( what == CURL_POLL_REMOVE ) {
+      
+      // curl may have closed the socket already, in which case it's gone from the epoll set too
+      epoll_ctl( dl->epoll_fd, EPOLL_CTL_DEL, sockfd, &ev );
+      return 0;
+   }
+   
+   if( what == CURL_POLL_IN || what == CURL_POLL_INOUT ) {
+      ev.events |= EPOLLIN;
+   }
+   
+   if( what == CURL_POLL_OUT || what == CURL_POLL_INOUT ) {
+      ev.events |= EPOLLOUT;
+   }
+   
+   ev.data.fd = sockfd;
+   
+   rc = epoll_ctl( dl->epoll_fd, EPOLL_CTL_MOD, sockfd, &ev );
+   if( rc != 0 && errno == ENOENT ) {
+      
+      // not yet watched
+      rc = epoll_ctl( dl->epoll_fd, EPOLL_CTL_ADD, sockfd, &ev );
+   }
+   
+   if( rc != 0 ) {
+      
+      rc = -errno;
+      SG_error("%s: epoll_ctl(%d) rc = %d\n", dl->name, sockfd, rc );
+      return -1;
+   }
+   
+   return 0;
+}
+
+// curl timer callback: remember when curl next wants a timeout action 
+// always succeeds
+static int md_downloader_timer_cb( CURLM* curlm, long timeout_ms, void* userp ) {
+   
+   struct md_downloader* dl = (struct md_downloader*)userp;
+   
+   if( timeout_ms < 0 ) {
+      dl->timer_deadline_ms = -1;
+   }
+   else {
+      dl->timer_deadline_ms = md_downloader_now_ms() + timeout_ms;
+   }
+   
+   return 0;
+}
+
 // alloc a downloader 
 struct md_downloader* md_downloader_new() {
    return SG_CALLOC( struct md_downloader, 1 );
@@ -184,6 +293,53 @@ int md_downloader_init( struct md_downloader* dl, char const* name ) {
       return -rc;
    }
    
+   dl->epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+   if( dl->epoll_fd < 0 ) {
+      
+      rc = -errno;
+      SG_error("epoll_create1 rc = %d\n", rc );
+      
+      pthread_rwlock_destroy( &dl->downloading_lock );
+      pthread_rwlock_destroy( &dl->pending_lock );
+      pthread_rwlock_destroy( &dl->cancelling_lock );
+      return rc;
+   }
+   
+   dl->event_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+   if( dl->event_fd < 0 ) {
+      
+      rc = -errno;
+      SG_error("eventfd rc = %d\n", rc );
+      
+      close( dl->epoll_fd );
+      pthread_rwlock_destroy( &dl->downloading_lock );
+      pthread_rwlock_destroy( &dl->pending_lock );
+      pthread_rwlock_destroy( &dl->cancelling_lock );
+      return rc;
+   }
+   
+   struct epoll_event ev;
+   memset( &ev, 0, sizeof(struct epoll_event) );
+   
+   ev.events = EPOLLIN;
+   ev.data.fd = dl->event_fd;
+   
+   rc = epoll_ctl( dl->epoll_fd, EPOLL_CTL_ADD, dl->event_fd, &ev );
+   if( rc != 0 ) {
+      
+      rc = -errno;
+      SG_error("epoll_ctl(eventfd) rc = %d\n", rc );
+      
+      close( dl->event_fd );
+      close( dl->epoll_fd );
+      pthread_rwlock_destroy( &dl->downloading_lock );
+      pthread_rwlock_destroy( &dl->pending_lock );
+      pthread_rwlock_destroy( &dl->cancelling_lock );
+      return rc;
+   }
+   
+   dl->timer_deadline_ms = -1;
+   
    dl->curlm = curl_multi_init();
    
    dl->name = SG_strdup_or_null( name );
@@ -194,14 +350,16 @@ int md_downloader_init( struct md_downloader* dl, char const* name ) {
    if( dl->name == NULL || dl->downloading == NULL || dl->pending == NULL || dl->cancelling == NULL || dl->curlm == NULL ) {
       
       SG_safe_free( dl->name );
-      SG_safe_free( dl->downloading );
-      SG_safe_free( dl->pending );
-      SG_safe_free( dl->cancelling );
+      SG_safe_delete( dl->downloading );
+      SG_safe_delete( dl->pending );
+      SG_safe_delete( dl->cancelling );
       
       if( dl->curlm != NULL ) {
          curl_multi_cleanup( dl->curlm );
       }
       
+      close( dl->event_fd );
+      close( dl->epoll_fd );
       pthread_rwlock_destroy( &dl->downloading_lock );
       pthread_rwlock_destroy( &dl->pending_lock );
       pthread_rwlock_destroy( &dl->cancelling_lock );
@@ -209,16 +367,96 @@ int md_downloader_init( struct md_downloader* dl, char const* name ) {
       return -ENOMEM;
    }
    
+   // drive curl from our epoll set
+   curl_multi_setopt( dl->curlm, CURLMOPT_SOCKETFUNCTION, md_downloader_socket_cb );
+   curl_multi_setopt( dl->curlm, CURLMOPT_SOCKETDATA, dl );
+   curl_multi_setopt( dl->curlm, CURLMOPT_TIMERFUNCTION, md_downloader_timer_cb );
+   curl_multi_setopt( dl->curlm, CURLMOPT_TIMERDATA, dl );
+   
    dl->inited = true;
    return 0;
 }
 
+
+// set up a downloader that spreads its downloads across num_shards downloader threads.
+// each shard has its own curl multi handle and epoll set; download contexts are assigned to shards round-robin when started.
+// num_shards <= 1 is the same as md_downloader_init
+// return 0 on success
+// return -ENOMEM on OOM
+int md_downloader_init_sharded( struct md_downloader* dl, char const* name, int num_shards ) {
+   
+   int rc = 0;
+   char* shard_name = NULL;
+   
+   rc = md_downloader_init( dl, name );
+   if( rc != 0 || num_shards <= 1 ) {
+      return rc;
+   }
+   
+   dl->shards = SG_CALLOC( struct md_downloader, num_shards );
+   shard_name = SG_CALLOC( char, strlen(name) + 50 );
+   
+   if( dl->shards == NULL || shard_name == NULL ) {
+      
+      SG_safe_free( dl->shards );
+      SG_safe_free( shard_name );
+      md_downloader_shutdown( dl );
+      return -ENOMEM;
+   }
+   
+   for( int i = 0; i < num_shards; i++ ) {
+      
+      sprintf( shard_name, "%s-%d", name, i );
+      
+      rc = md_downloader_init( &dl->shards[i], shard_name );
+      if( rc != 0 ) {
+         
+         SG_error("md_downloader_init('%s') rc = %d\n", shard_name, rc );
+         
+         for( int j = 0; j < i; j++ ) {
+            md_downloader_shutdown( &dl->shards[j] );
+         }
+         
+         SG_safe_free( dl->shards );
+         SG_safe_free( shard_name );
+         md_downloader_shutdown( dl );
+         return rc;
+      }
+   }
+   
+   SG_safe_free( shard_name );
+   
+   dl->num_shards = num_shards;
+   return 0;
+}
+
 // start up a downloader 
 // return 0 on success
 // return -1 if we failed to start the thread, or if we're already running 
 int md_downloader_start( struct md_downloader* dl ) {
    
    int rc = 0;
+   
+   if( !dl->running && dl->shards != NULL ) {
+      
+      // the shards do the downloading
+      for( int i = 0; i < dl->num_shards; i++ ) {
+         
+         rc = md_downloader_start( &dl->shards[i] );
+         if( rc != 0 ) {
+            
+            for( int j = 0; j < i; j++ ) {
+               md_downloader_stop( &dl->shards[j] );
+            }
+            
+            return rc;
+         }
+      }
+      
+      dl->running = true;
+      return 0;
+   }
+   
    if( !dl->running ) {
       
       dl->running = true;
@@ -240,9 +478,28 @@ int md_downloader_start( struct md_downloader* dl ) {
 // return negative if we failed to join with the downloader thread
 int md_downloader_stop( struct md_downloader* dl ) {
    
+   if( dl->running && dl->shards != NULL ) {
+      
+      int rc = 0;
+      dl->running = false;
+      
+      for( int i = 0; i < dl->num_shards; i++ ) {
+         
+         int stop_rc = md_downloader_stop( &dl->shards[i] );
+         if( stop_rc != 0 ) {
+            rc = stop_rc;
+         }
+      }
+      
+      return rc;
+   }
+   
    if( dl->running ) {
       dl->running = false;
       
+      // kick the thread out of epoll_wait()
+      md_downloader_wakeup( dl );
+      
       int rc = pthread_join( dl->thread, NULL );
       if( rc != 0 ) {
          SG_error("%s: pthread_join rc = %d\n", dl->name, rc );
@@ -288,6 +545,16 @@ int md_downloader_shutdown( struct md_downloader* dl ) {
       return -EINVAL;
    }
    
+   if( dl->shards != NULL ) {
+      
+      for( int i = 0; i < dl->num_shards; i++ ) {
+         md_downloader_shutdown( &dl->shards[i] );
+      }
+      
+      SG_safe_free( dl->shards );
+      dl->num_shards = 0;
+   }
+   
    // destroy downloading
    md_downloader_downloading_wlock( dl );
    
@@ -354,6 +621,17 @@ int md_downloader_shutdown( struct md_downloader* dl ) {
       dl->name = NULL;
    }
    
+   // curl_multi_cleanup() is done with the epoll set by now
+   if( dl->event_fd >= 0 ) {
+      close( dl->event_fd );
+      dl->event_fd = -1;
+   }
+   
+   if( dl->epoll_fd >= 0 ) {
+      close( dl->epoll_fd );
+      dl->epoll_fd = -1;
+   }
+   
    pthread_rwlock_destroy( &dl->downloading_lock );
    pthread_rwlock_destroy( &dl->pending_lock );
    pthread_rwlock_destroy( &dl->cancelling_lock );
@@ -424,6 +702,8 @@ int md_downloader_insert_pending( struct md_downloader* dl, struct md_download_c
       dl->has_pending = true;
    
       SG_debug("Start download context %p\n", dlctx );
+      
+      md_downloader_wakeup( dl );
    }
    
    return rc;
@@ -488,6 +768,8 @@ int md_downloader_insert_cancelling( struct md_downloader* dl, struct md_downloa
    
    md_downloader_cancelling_unlock( dl );
    
+   md_downloader_wakeup( dl );
+   
    return rc;
 }
 
@@ -701,6 +983,17 @@ size_t md_get_callback_bound_response_buffer( void* stream, size_t size, size_t
       }
    }
    
+   if( brb->direct_buf != NULL && brb->direct_used == brb->size && brb->direct_used + realsize <= brb->direct_len ) {
+      
+      // fits in the caller's buffer
+      memcpy( brb->direct_buf + brb->direct_used, stream, realsize );
+      
+      brb->direct_used += realsize;
+      brb->size += realsize;
+      
+      return realsize;
+   }
+   
    char* buf = SG_CALLOC( char, realsize );
    if( buf == NULL ) {
       return 0;
@@ -768,6 +1061,27 @@ int md_download_context_init( struct md_download_context* dlctx, CURL* curl, off
 }
 
 
+// set up a download context that writes the received data directly into a caller-owned buffer, instead of
+// accumulating it in heap-allocated segments.  Data that does not fit in buf (up to max_len bytes in total) spills
+// into segments, so an over-long response is not lost.
+// the caller must not free or reuse buf until the download context is freed.
+// return 0 on success
+// return -ENOMEM on OOM
+int md_download_context_init_direct( struct md_download_context* dlctx, CURL* curl, char* buf, off_t buf_len, off_t max_len, void* cls ) {
+   
+   int rc = md_download_context_init( dlctx, curl, MAX( buf_len, max_len ), cls );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
+   dlctx->brb.direct_buf = buf;
+   dlctx->brb.direct_len = buf_len;
+   dlctx->brb.direct_used = 0;
+   
+   return 0;
+}
+
+
 // reset a download context.
 // don't call this until it's finalized
 // return 0 on success
@@ -787,6 +1101,7 @@ int md_download_context_reset( struct md_download_context* dlctx, CURL** old_cur
    
    md_response_buffer_free( dlctx->brb.rb );
    dlctx->brb.size = 0;
+   dlctx->brb.direct_used = 0;
    
    curl_easy_setopt( dlctx->curl, CURLOPT_WRITEDATA, (void*)&dlctx->brb );
    curl_easy_setopt( dlctx->curl, CURLOPT_WRITEFUNCTION, md_get_callback_bound_response_buffer );
@@ -800,6 +1115,7 @@ int md_download_context_reset( struct md_download_context* dlctx, CURL** old_cur
    dlctx->cancelling = false;
    dlctx->running = false;
    dlctx->cls = NULL;
+   dlctx->dl = NULL;
    dlctx->ref_count = 0;
    SG_debug("download %p ref-set %d\n", dlctx, dlctx->ref_count );
    
@@ -938,7 +1254,7 @@ int md_download_sem_wait( sem_t* sem, int64_t timeout_ms ) {
       struct timespec abs_ts;
       clock_gettime( CLOCK_REALTIME, &abs_ts );
       abs_ts.tv_sec += timeout_ms / 1000L;
-      abs_ts.tv_nsec += timeout_ms / 1000000L;
+      abs_ts.tv_nsec += (timeout_ms % 1000L) * 1000000L;
       
       if( abs_ts.tv_nsec >= 1000000000L) {
          
@@ -957,7 +1273,9 @@ int md_download_sem_wait( sem_t* sem, int64_t timeout_ms ) {
          else if( errno != EINTR ) {
             
             rc = -errno;
-            SG_error("sem_timedwait errno = %d\n", rc );
+            if( rc != -ETIMEDOUT ) {
+               SG_error("sem_timedwait errno = %d\n", rc );
+            }
             break;
          }
          
@@ -1174,6 +1492,15 @@ struct md_download_context* md_download_set_iterator_get_context( const md_downl
 // return non-zero if we failed to insert the download into the downloader 
 int md_download_context_start( struct md_downloader* dl, struct md_download_context* dlctx ) {
    
+   if( dl->shards != NULL ) {
+      
+      // pick a shard to run it 
+      uint64_t shard = __sync_fetch_and_add( &dl->next_shard, 1 );
+      dl = &dl->shards[ shard % dl->num_shards ];
+   }
+   
+   dlctx->dl = dl;
+   
    md_download_context_ref( dlctx );
 
    // enqueue the context into the downloader 
@@ -1194,6 +1521,12 @@ int md_download_context_start( struct md_downloader* dl, struct md_download_cont
 // return negative if we failed to wait for the download to get cancelled
 int md_download_context_cancel( struct md_downloader* dl, struct md_download_context* dlctx ) {
    
+   if( dlctx->dl != NULL ) {
+      
+      // cancel on the shard that is running it 
+      dl = dlctx->dl;
+   }
+   
    if( !dl->running ) {
       return -EPERM;
    }
@@ -1256,77 +1589,103 @@ int md_download_set_wakeup( struct md_download_set* dlset ) {
    return rc;
 }
 
-// run multiple downloads for a bit
-// dl must be write-locked for downloading 
-// return positive non-zero if curl failed somehow 
-// return negative if select() failed
-int md_downloader_run_multi( struct md_downloader* dl ) {
-   
-   int still_running = 0;
-   int rc = 0;
-   struct timeval timeout;
-
-   fd_set fdread;
-   fd_set fdwrite;
-   fd_set fdexcep;
+// wait for socket activity, a curl timeout, or a wakeup.
+// drains the wakeup eventfd, so pending and cancelling contexts inserted after this returns will wake us up again.
+// does not need the downloading lock
+// return the number of events in events on success
+// return negative if epoll_wait() failed
+static int md_downloader_wait( struct md_downloader* dl, struct epoll_event* events, int max_events ) {
    
-   FD_ZERO( &fdread );
-   FD_ZERO( &fdwrite );
-   FD_ZERO( &fdexcep );
-
-   int maxfd = -1;
-
-   long curl_timeo = -1;
+   int timeout_ms = -1;         // wait until curl or a client needs us
+   int64_t deadline = dl->timer_deadline_ms;
    
-   // download for a bit
-   rc = curl_multi_perform( dl->curlm, &still_running );
-   if( rc != 0 ) {
+   if( deadline >= 0 ) {
       
-      SG_error("%s: curl_multi_perform rc = %d\n", dl->name, rc );
-      return rc;
+      int64_t now = md_downloader_now_ms();
+      timeout_ms = (int)MAX( deadline - now, 0 );
    }
-
-   // don't wait more than 5ms
-   timeout.tv_sec = 0;
-   timeout.tv_usec = 5000;      // 5ms
-
-   rc = curl_multi_timeout( dl->curlm, &curl_timeo );
-   if( rc != 0 ) {
+   
+   int num_events = epoll_wait( dl->epoll_fd, events, max_events, timeout_ms );
+   if( num_events < 0 ) {
+      
+      int rc = -errno;
+      if( rc == -EINTR ) {
+         return 0;
+      }
       
-      SG_error("%s: curl_multi_timeout rc = %d\n", dl->name, rc );
+      SG_error("%s: epoll_wait rc = %d\n", dl->name, rc );
       return rc;
    }
    
-   if( curl_timeo > 0 ) {
-      timeout.tv_sec = curl_timeo / 1000;
-      if( timeout.tv_sec > 0 ) {
-         timeout.tv_sec = 0;
-      }
+   for( int i = 0; i < num_events; i++ ) {
       
-      // no more than 5ms
-      timeout.tv_usec = MIN( (curl_timeo % 1000) * 1000, 5000 );
+      if( events[i].data.fd == dl->event_fd ) {
+         
+         uint64_t count = 0;
+         ssize_t nr = read( dl->event_fd, &count, sizeof(uint64_t) );
+         if( nr < 0 && errno != EAGAIN ) {
+            
+            SG_error("%s: read(eventfd) rc = %d\n", dl->name, -errno );
+         }
+      }
    }
+   
+   return num_events;
+}
 
-   // get fd set
-   rc = curl_multi_fdset( dl->curlm, &fdread, &fdwrite, &fdexcep, &maxfd );
-   if( rc != 0 ) {
-      
-      SG_error("%s: curl_multi_fdset rc = %d\n", dl->name, rc );
-      return rc;
-   }
 
-   // select on them
-   rc = select( maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout );
-   if( rc < 0 ) {
+// run multiple downloads for a bit: act on the sockets that are ready, and on curl's timer if it expired.
+// dl must be write-locked for downloading 
+// return 0 on success
+// return positive non-zero if curl failed somehow 
+int md_downloader_run_multi( struct md_downloader* dl, struct epoll_event* events, int num_events ) {
+   
+   int still_running = 0;
+   int rc = 0;
+   
+   for( int i = 0; i < num_events; i++ ) {
       
-      rc = -errno;
-      SG_error("%s: select rc = %d\n", dl->name, rc );
-      return rc;
+      int fd = events[i].data.fd;
+      int flags = 0;
+      
+      if( fd == dl->event_fd ) {
+         continue;
+      }
+      
+      if( events[i].events & EPOLLIN ) {
+         flags |= CURL_CSELECT_IN;
+      }
+      
+      if( events[i].events & EPOLLOUT ) {
+         flags |= CURL_CSELECT_OUT;
+      }
+      
+      if( events[i].events & (EPOLLERR | EPOLLHUP) ) {
+         flags |= CURL_CSELECT_ERR;
+      }
+      
+      rc = curl_multi_socket_action( dl->curlm, fd, flags, &still_running );
+      if( rc != 0 ) {
+         
+         SG_error("%s: curl_multi_socket_action(%d) rc = %d\n", dl->name, fd, rc );
+         return rc;
+      }
    }
-   else {
-      rc = 0;
+   
+   if( dl->timer_deadline_ms >= 0 && md_downloader_now_ms() >= dl->timer_deadline_ms ) {
+      
+      // curl will re-arm the timer if it needs to 
+      dl->timer_deadline_ms = -1;
+      
+      rc = curl_multi_socket_action( dl->curlm, CURL_SOCKET_TIMEOUT, 0, &still_running );
+      if( rc != 0 ) {
+         
+         SG_error("%s: curl_multi_socket_action(timeout) rc = %d\n", dl->name, rc );
+         return rc;
+      }
    }
-   return rc;
+   
+   return 0;
 }
 
 
@@ -1535,18 +1894,33 @@ int md_downloader_finalize_download_contexts( struct md_downloader* dl ) {
 }
 
 
-// main downloader loop
+// main downloader loop.
+// sleeps in epoll_wait() until curl has socket activity or a timeout to process, or until a client wakes us up
+// to start or cancel downloads (or to stop).  The downloading lock is only held while there is work to do.
 // return NULL
 static void* md_downloader_main( void* arg ) {
    
    struct md_downloader* dl = (struct md_downloader*)arg;
+   struct epoll_event events[ MD_DOWNLOADER_MAX_EVENTS ];
    
    SG_debug("%s: starting\n", dl->name );
    
    int rc = 0;
+   int num_events = 0;
    
    while( dl->running ) {
       
+      num_events = md_downloader_wait( dl, events, MD_DOWNLOADER_MAX_EVENTS );
+      if( num_events < 0 ) {
+         
+         SG_error("%s: md_downloader_wait rc = %d\n", dl->name, num_events );
+         num_events = 0;
+      }
+      
+      if( !dl->running ) {
+         break;
+      }
+      
       md_downloader_downloading_wlock( dl );
       
       // add all pending downloads to this downloader 
@@ -1562,7 +1936,7 @@ static void* md_downloader_main( void* arg ) {
       }
       
       // download for a bit 
-      rc = md_downloader_run_multi( dl );
+      rc = md_downloader_run_multi( dl, events, num_events );
       if( rc != 0 ) {
          SG_error("%s: md_downloader_run_multi rc = %d\n", dl->name, rc );
       }
@@ -1574,8 +1948,6 @@ static void* md_downloader_main( void* arg ) {
       }
       
       md_downloader_downloading_unlock( dl );
-      
-      // give the md_downloader_stop() method a chance to preempt the main method
    }
    
    SG_debug("%s: exiting\n", dl->name );
@@ -1588,16 +1960,83 @@ static void* md_downloader_main( void* arg ) {
 // return -ENOMEM on OOM
 int md_download_context_get_buffer( struct md_download_context* dlctx, char** buf, off_t* buf_len ) {
    
-   *buf = md_response_buffer_to_string( dlctx->brb.rb );
-   *buf_len = md_response_buffer_size( dlctx->brb.rb );
-   
-   if( *buf == NULL ) {
-      return -ENOMEM;
-   }
+   if( dlctx->brb.direct_buf != NULL ) {
+      
+      // caller wants a copy 
+      int rc = md_download_context_get_direct_buffer( dlctx, buf, buf_len );
+      if( rc == 0 ) {
+         
+         char* buf_dup = SG_CALLOC( char, *buf_len + 1 );
+         if( buf_dup == NULL ) {
+            return -ENOMEM;
+         }
+         
+         memcpy( buf_dup, *buf, *buf_len );
+         *buf = buf_dup;
+      }
+      
+      return (rc >= 0 ? 0 : rc);
+   }
+   
+   *buf = md_response_buffer_to_string( dlctx->brb.rb );
+   *buf_len = md_response_buffer_size( dlctx->brb.rb );
+   
+   if( *buf == NULL ) {
+      return -ENOMEM;
+   }
    
    return 0;
 }
 
+// get the data received by a download context set up with md_download_context_init_direct.
+// if it all fit into the caller's buffer, *buf is set to that buffer (no copy is made).
+// otherwise, *buf is set to a newly-allocated buffer with all of the data, which the caller must free.
+// return 0 if *buf is the caller's buffer
+// return 1 if *buf was allocated
+// return -EINVAL if this is not a direct download
+// return -ENOMEM on OOM
+int md_download_context_get_direct_buffer( struct md_download_context* dlctx, char** buf, off_t* buf_len ) {
+   
+   struct md_bound_response_buffer* brb = &dlctx->brb;
+   
+   if( brb->direct_buf == NULL ) {
+      return -EINVAL;
+   }
+   
+   if( brb->direct_used == brb->size ) {
+      
+      *buf = brb->direct_buf;
+      *buf_len = brb->direct_used;
+      return 0;
+   }
+   
+   // spilled over; put it all together 
+   char* spill = md_response_buffer_to_string( brb->rb );
+   off_t spill_len = md_response_buffer_size( brb->rb );
+   
+   char* ret = SG_CALLOC( char, brb->direct_used + spill_len + 1 );
+   if( spill == NULL || ret == NULL ) {
+      
+      SG_safe_free( spill );
+      SG_safe_free( ret );
+      return -ENOMEM;
+   }
+   
+   memcpy( ret, brb->direct_buf, brb->direct_used );
+   memcpy( ret + brb->direct_used, spill, spill_len );
+   
+   SG_safe_free( spill );
+   
+   *buf = ret;
+   *buf_len = brb->direct_used + spill_len;
+   return 1;
+}
+
+// does this download context write into a caller-owned buffer?
+bool md_download_context_is_direct( struct md_download_context* dlctx ) {
+   return (dlctx->brb.direct_buf != NULL);
+}
+
 // get the http status
 // return the positive HTTP status on success
 // return -EAGAIN if the download context was not finalized 
@@ -1986,6 +2425,36 @@ int md_download_loop_run( struct md_download_loop* dlloop ) {
 }
 
 
+// run the download loop until at least one download completes, or until timeout_ms milliseconds pass.
+// a negative timeout_ms means wait indefinitely (like md_download_loop_run).
+// return 0 on success
+// return 1 if there are no more downloads
+// return -ETIMEDOUT if no download completed in time
+// return -errno on critical failure to wait
+int md_download_loop_run_timeout( struct md_download_loop* dlloop, int64_t timeout_ms ) {
+   
+   int rc = 0;
+   
+   if( timeout_ms < 0 ) {
+      return md_download_loop_run( dlloop );
+   }
+   
+   dlloop->started = true;
+   
+   if( dlloop->dlset.waiting->size() == 0 ) {
+      return 1;
+   }
+   
+   rc = md_download_sem_wait( &dlloop->dlset.sem, MAX( timeout_ms, 1 ) );
+   if( rc != 0 && rc != -ETIMEDOUT ) {
+      
+      SG_error("md_download_sem_wait(%p) rc = %d\n", &dlloop->dlset, rc );
+   }
+   
+   return rc;
+}
+
+
 // find a finished download
 // caller must unref and free when done with it
 // return 0 on success, and set *dlctx to point to the finished download 
@@ -2220,7 +2689,7 @@ int md_bound_response_buffer_init( struct md_bound_response_buffer* brb, off_t m
    memset( brb, 0, sizeof(struct md_bound_response_buffer) );
    
    brb->rb = SG_safe_new( md_response_buffer_t() );
-   if( brb == NULL ) {
+   if( brb->rb == NULL ) {
       return -ENOMEM;
    }
    
@@ -2244,3 +2713,449 @@ int md_bound_response_buffer_free( struct md_bound_response_buffer* brb ) {
    return 0;
 }
 
+
+
+// idle curl handle in a connection pool 
+struct md_curl_pool_entry {
+   
+   CURL* curl;
+   int64_t idle_since;          // when it was released (seconds)
+};
+
+typedef list<struct md_curl_pool_entry> md_curl_pool_idle_list_t;
+typedef map<string, md_curl_pool_idle_list_t> md_curl_pool_idle_map_t;
+typedef map<CURL*, string> md_curl_pool_leased_map_t;
+
+// pool of reusable curl handles, keyed by peer (scheme://host:port).
+// all handles share DNS, TLS session, and connection caches, so a reused handle picks up the
+// connection its last request left open, and even a fresh handle skips DNS and TLS setup to a known peer.
+struct md_curl_pool {
+   
+   md_curl_pool_idle_map_t* idle;       // peer --> idle handles, most-recently-released last
+   md_curl_pool_leased_map_t* leased;   // handle --> peer it was handed out for
+   
+   int max_idle_per_peer;               // maximum number of idle handles kept per peer
+   int64_t idle_timeout;                // seconds a handle may sit idle before it gets closed
+   int64_t last_sweep;                  // last time (seconds) we closed expired handles
+   
+   uint64_t hits;                       // number of md_curl_pool_get calls satisfied from the pool 
+   uint64_t misses;                     // number of md_curl_pool_get calls that needed a new handle
+   
+   CURLSH* share;                       // shared DNS/TLS/connection state
+   pthread_mutex_t share_locks[ CURL_LOCK_DATA_LAST ];
+   
+   bool closing;                        // if true, the pool is being freed; released handles are closed, and new ones are not shared
+   pthread_cond_t released;             // signaled when a leased handle is released while closing
+   
+   pthread_mutex_t lock;                // guards the above
+};
+
+
+// lock shared curl state 
+static void md_curl_pool_share_lock( CURL* curl, curl_lock_data data, curl_lock_access access, void* userp ) {
+   
+   struct md_curl_pool* pool = (struct md_curl_pool*)userp;
+   pthread_mutex_lock( &pool->share_locks[ data ] );
+}
+
+// unlock shared curl state 
+static void md_curl_pool_share_unlock( CURL* curl, curl_lock_data data, void* userp ) {
+   
+   struct md_curl_pool* pool = (struct md_curl_pool*)userp;
+   pthread_mutex_unlock( &pool->share_locks[ data ] );
+}
+
+
+// get the peer a URL refers to: its scheme, host, and port 
+// return the peer on success 
+// throw bad_alloc on OOM
+static string md_curl_pool_peer( char const* url ) {
+   
+   char const* host = strstr( url, "://" );
+   if( host == NULL ) {
+      host = url;
+   }
+   else {
+      host += 3;
+   }
+   
+   char const* path = strchr( host, '/' );
+   if( path == NULL ) {
+      return string( url );
+   }
+   
+   return string( url, path - url );
+}
+
+
+// alloc a connection pool
+struct md_curl_pool* md_curl_pool_new() {
+   return SG_CALLOC( struct md_curl_pool, 1 );
+}
+
+
+// set up a connection pool 
+// max_idle_per_peer is the number of idle handles to keep for each peer (0 disables pooling)
+// idle_timeout is the number of seconds an idle handle is kept (0 means forever)
+// return 0 on success
+// return -ENOMEM on OOM
+int md_curl_pool_init( struct md_curl_pool* pool, int max_idle_per_peer, int64_t idle_timeout ) {
+   
+   int rc = 0;
+   
+   memset( pool, 0, sizeof(struct md_curl_pool) );
+   
+   pool->idle = SG_safe_new( md_curl_pool_idle_map_t() );
+   pool->leased = SG_safe_new( md_curl_pool_leased_map_t() );
+   pool->share = curl_share_init();
+   
+   if( pool->idle == NULL || pool->leased == NULL || pool->share == NULL ) {
+      
+      SG_safe_delete( pool->idle );
+      SG_safe_delete( pool->leased );
+      
+      if( pool->share != NULL ) {
+         curl_share_cleanup( pool->share );
+      }
+      
+      memset( pool, 0, sizeof(struct md_curl_pool) );
+      return -ENOMEM;
+   }
+   
+   rc = pthread_mutex_init( &pool->lock, NULL );
+   if( rc != 0 ) {
+      
+      SG_safe_delete( pool->idle );
+      SG_safe_delete( pool->leased );
+      curl_share_cleanup( pool->share );
+      
+      memset( pool, 0, sizeof(struct md_curl_pool) );
+      return -rc;
+   }
+   
+   for( int i = 0; i < CURL_LOCK_DATA_LAST; i++ ) {
+      pthread_mutex_init( &pool->share_locks[i], NULL );
+   }
+   
+   pthread_cond_init( &pool->released, NULL );
+   
+   curl_share_setopt( pool->share, CURLSHOPT_LOCKFUNC, md_curl_pool_share_lock );
+   curl_share_setopt( pool->share, CURLSHOPT_UNLOCKFUNC, md_curl_pool_share_unlock );
+   curl_share_setopt( pool->share, CURLSHOPT_USERDATA, pool );
+   
+   curl_share_setopt( pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+   curl_share_setopt( pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+   
+#if LIBCURL_VERSION_NUM >= 0x073900
+   // connection cache sharing needs curl 7.57.0
+   curl_share_setopt( pool->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT );
+#endif
+   
+   pool->max_idle_per_peer = MAX( max_idle_per_peer, 0 );
+   pool->idle_timeout = MAX( idle_timeout, 0 );
+   pool->last_sweep = md_current_time_seconds();
+   
+   return 0;
+}
+
+
+// close idle handles that have been idle for too long.
+// pool must be locked 
+static void md_curl_pool_sweep_locked( struct md_curl_pool* pool, int64_t now ) {
+   
+   if( pool->idle_timeout <= 0 ) {
+      return;
+   }
+   
+   for( md_curl_pool_idle_map_t::iterator itr = pool->idle->begin(); itr != pool->idle->end(); ) {
+      
+      md_curl_pool_idle_list_t* handles = &itr->second;
+      
+      // oldest handles are at the front 
+      while( handles->size() > 0 && handles->front().idle_since + pool->idle_timeout <= now ) {
+         
+         curl_easy_cleanup( handles->front().curl );
+         handles->pop_front();
+      }
+      
+      if( handles->size() == 0 ) {
+         pool->idle->erase( itr++ );
+      }
+      else {
+         itr++;
+      }
+   }
+   
+   pool->last_sweep = now;
+}
+
+
+// free up a connection pool.
+// handles that are still leased out share its DNS/TLS/connection state, so wait up to MD_CURL_POOL_DRAIN_TIMEOUT seconds
+// for them to be released (they get closed when they are) before tearing down the share.
+// return 0 on success 
+// return -EBUSY if handles are still leased out, or the share is still in use.  The pool is then left intact, and 
+// the caller must not free it.
+int md_curl_pool_free( struct md_curl_pool* pool ) {
+   
+   int rc = 0;
+   struct timespec deadline;
+   CURLSHcode share_rc = CURLSHE_OK;
+   
+   if( pool->idle == NULL ) {
+      
+      // never initialized 
+      memset( pool, 0, sizeof(struct md_curl_pool) );
+      return 0;
+   }
+   
+   pthread_mutex_lock( &pool->lock );
+   
+   pool->closing = true;
+   
+   for( md_curl_pool_idle_map_t::iterator itr = pool->idle->begin(); itr != pool->idle->end(); itr++ ) {
+      for( md_curl_pool_idle_list_t::iterator hitr = itr->second.begin(); hitr != itr->second.end(); hitr++ ) {
+         
+         curl_easy_cleanup( hitr->curl );
+      }
+   }
+   
+   pool->idle->clear();
+   
+   // wait for leased handles to come back 
+   if( pool->leased->size() > 0 ) {
+      
+      SG_warn("Waiting for %zu curl handles to be released\n", pool->leased->size() );
+      
+      clock_gettime( CLOCK_REALTIME, &deadline );
+      deadline.tv_sec += MD_CURL_POOL_DRAIN_TIMEOUT;
+      
+      while( pool->leased->size() > 0 ) {
+         
+         rc = pthread_cond_timedwait( &pool->released, &pool->lock, &deadline );
+         if( rc == ETIMEDOUT ) {
+            break;
+         }
+      }
+   }
+   
+   if( pool->leased->size() > 0 ) {
+      
+      SG_error("%zu curl handles still in use; not freeing curl pool %p\n", pool->leased->size(), pool );
+      
+      pthread_mutex_unlock( &pool->lock );
+      return -EBUSY;
+   }
+   
+   share_rc = curl_share_cleanup( pool->share );
+   if( share_rc != CURLSHE_OK ) {
+      
+      SG_error("curl_share_cleanup rc = %d (%s); not freeing curl pool %p\n", share_rc, curl_share_strerror( share_rc ), pool );
+      
+      pthread_mutex_unlock( &pool->lock );
+      return -EBUSY;
+   }
+   
+   pthread_mutex_unlock( &pool->lock );
+   
+   SG_debug("curl pool %p: %" PRIu64 " hits, %" PRIu64 " misses\n", pool, pool->hits, pool->misses );
+   
+   SG_safe_delete( pool->idle );
+   SG_safe_delete( pool->leased );
+   
+   for( int i = 0; i < CURL_LOCK_DATA_LAST; i++ ) {
+      pthread_mutex_destroy( &pool->share_locks[i] );
+   }
+   
+   pthread_cond_destroy( &pool->released );
+   pthread_mutex_destroy( &pool->lock );
+   
+   memset( pool, 0, sizeof(struct md_curl_pool) );
+   return 0;
+}
+
+
+// get a curl handle for talking to the peer that serves url.
+// reuses an idle handle to that peer if there is one, and makes a new one otherwise.
+// the handle is in its default state (plus the pool's share), so the caller sets it up as if it were new.
+// if pool is NULL, this is the same as curl_easy_init()
+// return the handle on success
+// return NULL on OOM
+CURL* md_curl_pool_get( struct md_curl_pool* pool, char const* url ) {
+   
+   CURL* curl = NULL;
+   
+   if( pool == NULL || pool->idle == NULL ) {
+      return curl_easy_init();
+   }
+   
+   try {
+      
+      string peer = md_curl_pool_peer( url );
+      
+      pthread_mutex_lock( &pool->lock );
+      
+      if( pool->closing ) {
+         
+         // going away; don't share 
+         pthread_mutex_unlock( &pool->lock );
+         return curl_easy_init();
+      }
+      
+      md_curl_pool_idle_map_t::iterator itr = pool->idle->find( peer );
+      if( itr != pool->idle->end() && itr->second.size() > 0 ) {
+         
+         // most-recently-used handle is most likely to have a live connection
+         curl = itr->second.back().curl;
+         itr->second.pop_back();
+         
+         if( itr->second.size() == 0 ) {
+            pool->idle->erase( itr );
+         }
+         
+         pool->hits++;
+      }
+      else {
+         
+         curl = curl_easy_init();
+         if( curl == NULL ) {
+            
+            pthread_mutex_unlock( &pool->lock );
+            return NULL;
+         }
+         
+         curl_easy_setopt( curl, CURLOPT_SHARE, pool->share );
+         pool->misses++;
+      }
+      
+      try {
+         (*pool->leased)[ curl ] = peer;
+      }
+      catch( bad_alloc& ba ) {
+         
+         // can't track it, so don't pool it 
+         curl_easy_setopt( curl, CURLOPT_SHARE, NULL );
+      }
+      
+      pthread_mutex_unlock( &pool->lock );
+   }
+   catch( bad_alloc& ba ) {
+      return NULL;
+   }
+   
+   return curl;
+}
+
+
+// give a curl handle back to the pool.
+// the handle gets reset, and is either kept for the next request to the same peer, or closed
+// (if the peer already has max_idle_per_peer idle handles, or if the handle did not come from this pool).
+// if pool is NULL, this is the same as curl_easy_cleanup()
+// always succeeds
+int md_curl_pool_release( struct md_curl_pool* pool, CURL* curl ) {
+   
+   if( curl == NULL ) {
+      return 0;
+   }
+   
+   if( pool == NULL || pool->idle == NULL ) {
+      
+      curl_easy_cleanup( curl );
+      return 0;
+   }
+   
+   int64_t now = md_current_time_seconds();
+   
+   pthread_mutex_lock( &pool->lock );
+   
+   md_curl_pool_leased_map_t::iterator itr = pool->leased->find( curl );
+   if( itr == pool->leased->end() ) {
+      
+      // not ours 
+      pthread_mutex_unlock( &pool->lock );
+      
+      curl_easy_cleanup( curl );
+      return 0;
+   }
+   
+   if( pool->closing ) {
+      
+      // close it before md_curl_pool_free tears down the share it uses 
+      curl_easy_cleanup( curl );
+      pool->leased->erase( itr );
+      
+      pthread_cond_broadcast( &pool->released );
+      pthread_mutex_unlock( &pool->lock );
+      return 0;
+   }
+   
+   string peer = itr->second;
+   pool->leased->erase( itr );
+   
+   if( pool->idle_timeout > 0 && pool->last_sweep + pool->idle_timeout <= now ) {
+      md_curl_pool_sweep_locked( pool, now );
+   }
+   
+   bool pooled = false;
+   
+   if( pool->max_idle_per_peer > 0 ) {
+      
+      try {
+         
+         md_curl_pool_idle_list_t* handles = &(*pool->idle)[ peer ];
+         
+         if( handles->size() < (unsigned)pool->max_idle_per_peer ) {
+            
+            struct md_curl_pool_entry ent;
+            
+            // forget everything about the last request (callbacks, buffers, forms), but keep the connection and share 
+            curl_easy_reset( curl );
+            curl_easy_setopt( curl, CURLOPT_SHARE, pool->share );
+            
+            ent.curl = curl;
+            ent.idle_since = now;
+            
+            handles->push_back( ent );
+            pooled = true;
+         }
+      }
+      catch( bad_alloc& ba ) {
+         pooled = false;
+      }
+   }
+   
+   pthread_mutex_unlock( &pool->lock );
+   
+   if( !pooled ) {
+      curl_easy_cleanup( curl );
+   }
+   
+   return 0;
+}
+
+
+// md_download_curl_release_func adapter for md_curl_pool_release, for md_download_loop_cleanup
+void md_curl_pool_release_func( CURL* curl, void* pool ) {
+   
+   md_curl_pool_release( (struct md_curl_pool*)pool, curl );
+}
+
+
+// get the pool's hit and miss counts 
+// return 0 on success
+// return -EINVAL if the pool is not initialized
+int md_curl_pool_get_stats( struct md_curl_pool* pool, uint64_t* hits, uint64_t* misses ) {
+   
+   if( pool == NULL || pool->idle == NULL ) {
+      return -EINVAL;
+   }
+   
+   pthread_mutex_lock( &pool->lock );
+   
+   *hits = pool->hits;
+   *misses = pool->misses;
+   
+   pthread_mutex_unlock( &pool->lock );
+   
+   return 0;
+}
@@ -21,6 +21,7 @@
 #include "libsyndicate/util.h"
 
 #include <set>
+#include <list>
 
 using namespace std;
 
@@ -36,6 +37,10 @@ struct md_bound_response_buffer {
    off_t max_size;
    off_t size;
    md_response_buffer_t* rb;
+   
+   char* direct_buf;    // if non-NULL, a caller-owned buffer that received data lands in directly
+   off_t direct_len;    // size of direct_buf
+   off_t direct_used;   // number of bytes written to direct_buf (anything past direct_len spills into rb)
 };
 
 // download set 
@@ -50,6 +55,9 @@ struct md_downloader;
 // download loop 
 struct md_download_loop;
 
+// pool of reusable curl handles
+struct md_curl_pool;
+
 typedef map<CURL*, struct md_download_context*> md_downloading_map_t;
 typedef set<struct md_download_context*> md_pending_set_t;
 typedef md_pending_set_t::iterator md_download_set_iterator;
@@ -60,11 +68,15 @@ typedef void (*md_download_curl_release_func)( CURL*, void* );
 
 #define MD_DOWNLOAD_FINISH                      0x1
 
+#define MD_CURL_POOL_DEFAULT_MAX_IDLE           8       // idle handles kept per peer
+#define MD_CURL_POOL_DEFAULT_IDLE_TIMEOUT       60      // seconds
+
 extern "C" {
    
 // initialization and tear-down
 struct md_downloader* md_downloader_new(); 
 int md_downloader_init( struct md_downloader* dl, char const* name );
+int md_downloader_init_sharded( struct md_downloader* dl, char const* name, int num_shards );
 int md_downloader_start( struct md_downloader* dl );
 int md_downloader_stop( struct md_downloader* dl );
 int md_downloader_shutdown( struct md_downloader* dl );
@@ -73,6 +85,7 @@ bool md_downloader_is_running( struct md_downloader* dl );
 // initialize/tear down a download context.  Takes a CURL handle from the client, and gives it back when its done.
 struct md_download_context* md_download_context_new();
 int md_download_context_init( struct md_download_context* dlctx, CURL* curl, off_t max_len, void* cls );
+int md_download_context_init_direct( struct md_download_context* dlctx, CURL* curl, char* buf, off_t buf_len, off_t max_len, void* cls );
 int md_download_context_reset( struct md_download_context* dlctx, CURL** old_curl );
 int md_download_context_free2( struct md_download_context* dlctx, CURL** curl, char const* filename, int lineno );
 #define md_download_context_free( dlctx, curl ) md_download_context_free2( dlctx, curl, __FILE__, __LINE__ )
@@ -96,6 +109,8 @@ int md_download_context_run( struct md_download_context* dlctx );
 
 // get back data from a download context
 int md_download_context_get_buffer( struct md_download_context* dlctx, char** buf, off_t* buf_len );
+int md_download_context_get_direct_buffer( struct md_download_context* dlctx, char** buf, off_t* buf_len );
+bool md_download_context_is_direct( struct md_download_context* dlctx );
 int md_download_context_get_http_status( struct md_download_context* dlctx );
 int md_download_context_get_errno( struct md_download_context* dlctx );
 int md_download_context_get_curl_rc( struct md_download_context* dlctx );
@@ -136,6 +151,7 @@ int md_download_loop_free( struct md_download_loop* dlloop );
 int md_download_loop_next( struct md_download_loop* dlloop, struct md_download_context** dlctx );
 int md_download_loop_watch( struct md_download_loop* dlloop, struct md_download_context* dlctx );
 int md_download_loop_run( struct md_download_loop* dlloop );
+int md_download_loop_run_timeout( struct md_download_loop* dlloop, int64_t timeout_ms );
 int md_download_loop_num_initialized( struct md_download_loop* dlloop );
 int md_download_loop_num_running( struct md_download_loop* dlloop );
 int md_download_loop_finished( struct md_download_loop* dlloop, struct md_download_context** dlctx );
@@ -153,6 +169,17 @@ int md_download_interpret_errors( int http_status, int curl_rc, int os_err );
 int md_bound_response_buffer_init( struct md_bound_response_buffer* brb, off_t max_size );
 int md_bound_response_buffer_free( struct md_bound_response_buffer* brb );
 
+// connection pooling
+#define MD_CURL_POOL_DRAIN_TIMEOUT 30        // seconds md_curl_pool_free waits for leased handles to be released
+
+struct md_curl_pool* md_curl_pool_new();
+int md_curl_pool_init( struct md_curl_pool* pool, int max_idle_per_peer, int64_t idle_timeout );
+int md_curl_pool_free( struct md_curl_pool* pool );
+CURL* md_curl_pool_get( struct md_curl_pool* pool, char const* url );
+int md_curl_pool_release( struct md_curl_pool* pool, CURL* curl );
+void md_curl_pool_release_func( CURL* curl, void* pool );
+int md_curl_pool_get_stats( struct md_curl_pool* pool, uint64_t* hits, uint64_t* misses );
+
 }
 
 #endif
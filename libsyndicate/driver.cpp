@@ -33,6 +33,11 @@ struct SG_driver {
    // driver processes: map role to group of processes that implement it 
    SG_driver_proc_group_t* groups;
 
+   // stops driver processes that have been idle for too long
+   pthread_t reaper;
+   sem_t reaper_sem;                    // posted to stop the reaper
+   volatile bool reaper_running;
+
    // driver info
    char* exec_str;
    char** roles;
@@ -667,6 +672,90 @@ int SG_driver_init( struct SG_driver* driver, struct md_syndicate_conf* conf,
 }
 
 
+// idle process reaper: every SG_DRIVER_REAP_INTERVAL seconds, stop each group's processes that have been idle too long
+static void* SG_driver_reaper_main( void* arg ) {
+
+   struct SG_driver* driver = (struct SG_driver*)arg;
+   struct timespec deadline;
+   int num_reaped = 0;
+
+   while( driver->reaper_running ) {
+
+      clock_gettime( CLOCK_REALTIME, &deadline );
+      deadline.tv_sec += SG_DRIVER_REAP_INTERVAL;
+
+      sem_timedwait( &driver->reaper_sem, &deadline );
+
+      if( !driver->reaper_running ) {
+         break;
+      }
+
+      SG_driver_rlock( driver );
+
+      if( driver->groups != NULL ) {
+
+         for( SG_driver_proc_group_t::iterator itr = driver->groups->begin(); itr != driver->groups->end(); itr++ ) {
+
+            num_reaped = SG_proc_group_reap_idle( itr->second );
+            if( num_reaped > 0 ) {
+               SG_debug("Stopped %d idle process(es) for role '%s'\n", num_reaped, itr->first.c_str() );
+            }
+         }
+      }
+
+      SG_driver_unlock( driver );
+   }
+
+   return NULL;
+}
+
+
+// start the idle process reaper, if the driver's processes can go idle
+// return 0 on success, or if there is nothing to reap
+// return -EPERM if we could not start the thread
+static int SG_driver_reaper_start( struct SG_driver* driver ) {
+
+   int rc = 0;
+
+   if( driver->reaper_running || driver->groups == NULL || driver->conf->driver_idle_timeout <= 0 ) {
+      return 0;
+   }
+
+   sem_init( &driver->reaper_sem, 0, 0 );
+   driver->reaper_running = true;
+
+   rc = md_start_thread( &driver->reaper, SG_driver_reaper_main, driver, false );
+   if( rc < 0 ) {
+
+      SG_error("md_start_thread rc = %d\n", rc );
+      driver->reaper_running = false;
+      sem_destroy( &driver->reaper_sem );
+      return -EPERM;
+   }
+
+   return 0;
+}
+
+
+// stop the idle process reaper, if it is running
+// always succeeds
+// NOTE: the driver must NOT be locked
+static int SG_driver_reaper_stop( struct SG_driver* driver ) {
+
+   if( !driver->reaper_running ) {
+      return 0;
+   }
+
+   driver->reaper_running = false;
+   sem_post( &driver->reaper_sem );
+
+   pthread_join( driver->reaper, NULL );
+   sem_destroy( &driver->reaper_sem );
+
+   return 0;
+}
+
+
 // convert config/secrets into a JSON object string
 // return 0 on success, and populate *chunk
 // return -ENOMEM on OOM 
@@ -839,6 +928,25 @@ int SG_driver_procs_start( struct SG_driver* driver ) {
               }
           }
       }
+
+      if( SG_proc_group_size( groups[i] ) > 0 ) {
+
+          // let this role's group grow under load, and shrink back when idle
+          rc = SG_proc_group_set_spawn_args( groups[i], driver->exec_str, driver->roles[i], driver->conf->helper_env, &config, &secrets, &driver->driver_text );
+          if( rc != 0 ) {
+
+             SG_error("SG_proc_group_set_spawn_args('%s') rc = %d\n", driver->roles[i], rc );
+             goto SG_driver_procs_start_finish;
+          }
+
+          rc = SG_proc_group_set_limits( groups[i], driver->num_instances, MAX( driver->num_instances, driver->conf->max_driver_instances ),
+                                         (driver->conf->driver_acquire_timeout >= 0 ? driver->conf->driver_acquire_timeout * 1000 : -1), driver->conf->driver_idle_timeout * 1000 );
+          if( rc != 0 ) {
+
+             SG_error("SG_proc_group_set_limits('%s') rc = %d\n", driver->roles[i], rc );
+             goto SG_driver_procs_start_finish;
+          }
+      }
    }
    
 SG_driver_procs_start_finish:
@@ -882,6 +990,14 @@ SG_driver_procs_start_finish:
 
       // install to driver
       SG_driver_init_procs( driver, driver->roles, groups, driver->num_roles );
+
+      // shrink groups back down once they're idle
+      rc = SG_driver_reaper_start( driver );
+      if( rc != 0 ) {
+
+         SG_warn("SG_driver_reaper_start rc = %d; idle driver processes will not be stopped\n", rc );
+         rc = 0;
+      }
    }
    
    // free memory 
@@ -894,6 +1010,36 @@ SG_driver_procs_start_finish:
 }
 
 
+// log the utilization and wait-time statistics of each of a driver's process groups
+// always succeeds 
+// NOT THREAD SAFE--caller must lock the driver
+int SG_driver_procs_stats_log( struct SG_driver* driver ) {
+
+   struct SG_proc_group_stats stats;
+
+   if( driver->groups == NULL ) {
+      return 0;
+   }
+
+   for( SG_driver_proc_group_t::iterator itr = driver->groups->begin(); itr != driver->groups->end(); itr++ ) {
+
+      SG_proc_group_get_stats( itr->second, &stats );
+
+      double utilization = 0.0;
+      if( stats.uptime_ns > 0 && stats.num_procs > 0 ) {
+         utilization = (double)stats.total_busy_ns / ((double)stats.uptime_ns * stats.num_procs);
+      }
+
+      SG_info("Driver role '%s': %d procs (%d busy), %" PRIu64 " acquired, %" PRIu64 " waited (avg %" PRId64 " ns, max %" PRId64 " ns), %" PRIu64 " timed out, %" PRIu64 " spawned, %" PRIu64 " reaped, utilization %.3lf\n",
+              itr->first.c_str(), stats.num_procs, stats.num_busy, stats.num_acquired, stats.num_waited,
+              (stats.num_acquired > 0 ? stats.total_wait_ns / (int64_t)stats.num_acquired : 0), stats.max_wait_ns,
+              stats.num_timeouts, stats.num_spawned, stats.num_reaped, utilization );
+   }
+
+   return 0;
+}
+
+
 // stop a driver's running processes 
 // return 0 on success
 // NOT THREAD SAFE--caller must lock the driver
@@ -907,6 +1053,8 @@ int SG_driver_procs_stop( struct SG_driver* driver ) {
       return 0;
    }
 
+   SG_driver_procs_stats_log( driver );
+
    // ask the workers to stop
    for( size_t i = 0; i < driver->num_roles; i++ ) {
       
@@ -1046,6 +1194,9 @@ int SG_driver_shutdown( struct SG_driver* driver ) {
    // call the driver shutdown...
    int rc = 0;
    
+   // the reaper read-locks the driver
+   SG_driver_reaper_stop( driver );
+   
    SG_driver_wlock( driver );
    
    SG_safe_delete( driver->driver_conf );
@@ -25,6 +25,9 @@ typedef map<string, string> SG_driver_conf_t;
 typedef SG_driver_conf_t SG_driver_secrets_t;
 typedef map<string, struct SG_proc_group*> SG_driver_proc_group_t;
 
+// how often (in seconds) to look for driver processes that have been idle too long
+#define SG_DRIVER_REAP_INTERVAL 1
+
 struct SG_driver;
 
 extern "C" {
@@ -45,6 +48,7 @@ int SG_driver_init( struct SG_driver* driver, struct md_syndicate_conf* conf,
 
 int SG_driver_procs_start( struct SG_driver* driver );
 int SG_driver_procs_stop( struct SG_driver* driver );
+int SG_driver_procs_stats_log( struct SG_driver* driver );
 int SG_driver_reload( struct SG_driver* driver, EVP_PKEY* pubkey, EVP_PKEY* privkey, char const* driver_text, size_t driver_text_len );
 int SG_driver_shutdown( struct SG_driver* driver );
 
@@ -28,6 +28,56 @@
 // gateway for which we are running the main() loop
 static struct SG_gateway* g_main_gateway = NULL;
 
+// a set of crypto jobs submitted together
+struct SG_crypto_batch {
+   
+   sem_t done;          // posted once per completed job
+};
+
+// recently-verified message signatures, keyed by (gateway ID, certificate version, message hash)
+struct SG_gateway_sigcache {
+   
+   set< string >* verified;             // keys of verified messages
+   queue< string >* order;              // insertion order, for eviction 
+   pthread_mutex_t lock;
+};
+
+
+// allocate and set up a signature cache 
+// return the new cache on success 
+// return NULL on OOM 
+static struct SG_gateway_sigcache* SG_gateway_sigcache_new(void) {
+   
+   struct SG_gateway_sigcache* sigcache = SG_CALLOC( struct SG_gateway_sigcache, 1 );
+   if( sigcache == NULL ) {
+      return NULL;
+   }
+   
+   sigcache->verified = SG_safe_new( set< string >() );
+   sigcache->order = SG_safe_new( queue< string >() );
+   
+   if( sigcache->verified == NULL || sigcache->order == NULL ) {
+      
+      SG_safe_delete( sigcache->verified );
+      SG_safe_delete( sigcache->order );
+      SG_safe_free( sigcache );
+      return NULL;
+   }
+   
+   pthread_mutex_init( &sigcache->lock, NULL );
+   return sigcache;
+}
+
+
+// free a signature cache 
+// always succeeds
+static void SG_gateway_sigcache_free( struct SG_gateway_sigcache* sigcache ) {
+   
+   SG_safe_delete( sigcache->verified );
+   SG_safe_delete( sigcache->order );
+   pthread_mutex_destroy( &sigcache->lock );
+}
+
 // alloc a gateway 
 struct SG_gateway* SG_gateway_new(void) {
    return SG_CALLOC( struct SG_gateway, 1 );
@@ -776,6 +826,10 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    struct SG_driver* driver = SG_driver_alloc();
    struct md_downloader* dl = md_downloader_new();
    struct md_wq* iowqs = NULL;
+   struct md_wq* crypto_wqs = NULL;
+   struct SG_gateway_sigcache* sigcache = NULL;
+   struct SG_server_manifest_cache* manifest_cache = NULL;
+   struct md_curl_pool* curl_pool = NULL;
    
    sem_t config_sem;
    
@@ -790,8 +844,11 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    uint64_t block_size = 0;   
    int first_arg_optind = -1;
    
-   int num_iowqs = 0;
-   int max_num_iowqs = 1; // 4 * sysconf( _SC_NPROCESSORS_CONF );       // I/O doesn't take much CPU...
+   bool iowqs_inited = false;
+   int max_num_iowqs = 0;
+   
+   bool crypto_wqs_inited = false;
+   int max_num_crypto_wqs = 0;
    
    if( ms == NULL || conf == NULL || cache == NULL || http == NULL || dl == NULL ) {
       
@@ -840,6 +897,18 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
       goto SG_gateway_init_error;
    }
   
+   // how many I/O workers?  default to one per CPU 
+   max_num_iowqs = conf->num_io_workers;
+   if( max_num_iowqs <= 0 ) {
+      
+      max_num_iowqs = sysconf( _SC_NPROCESSORS_ONLN );
+      if( max_num_iowqs <= 0 ) {
+         max_num_iowqs = 1;
+      }
+   }
+   
+   SG_debug("%d I/O workers\n", max_num_iowqs );
+   
    // allocate I/O work queues 
    iowqs = SG_CALLOC( struct md_wq, max_num_iowqs );
    
@@ -850,6 +919,30 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
       goto SG_gateway_init_error;
    }
    
+   // how many crypto workers?  default to one per CPU 
+   max_num_crypto_wqs = conf->num_crypto_workers;
+   if( max_num_crypto_wqs <= 0 ) {
+      
+      max_num_crypto_wqs = sysconf( _SC_NPROCESSORS_ONLN );
+      if( max_num_crypto_wqs <= 0 ) {
+         max_num_crypto_wqs = 1;
+      }
+   }
+   
+   SG_debug("%d crypto workers\n", max_num_crypto_wqs );
+   
+   crypto_wqs = SG_CALLOC( struct md_wq, max_num_crypto_wqs );
+   sigcache = SG_gateway_sigcache_new();
+   manifest_cache = SG_server_manifest_cache_new();
+   curl_pool = md_curl_pool_new();
+   
+   if( crypto_wqs == NULL || sigcache == NULL || manifest_cache == NULL || curl_pool == NULL ) {
+      
+      // OOM 
+      rc = -ENOMEM;
+      goto SG_gateway_init_error;
+   }
+   
    // initialize library
    if( !opts->client ) {
       
@@ -891,21 +984,41 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    // advance!
    config_inited = true;
    
-   // initialize workqueues 
-   for( num_iowqs = 0; num_iowqs < max_num_iowqs; num_iowqs++ ) {
+   // initialize workqueues, so idle workers can take requests from busy ones
+   rc = md_wq_group_init( iowqs, max_num_iowqs, gateway );
+   if( rc != 0 ) {
       
-      rc = md_wq_init( &iowqs[num_iowqs], gateway );
-      if( rc != 0 ) {
-         
-         SG_error("md_wq_init( iowq[%d] ) rc = %d\n", num_iowqs, rc );
-         
-         goto SG_gateway_init_error;
-      }
+      SG_error("md_wq_group_init( %d ) rc = %d\n", max_num_iowqs, rc );
+      
+      goto SG_gateway_init_error;
    }
    
+   // advance!
+   iowqs_inited = true;
+   
+   rc = md_wq_group_init( crypto_wqs, max_num_crypto_wqs, gateway );
+   if( rc != 0 ) {
+      
+      SG_error("md_wq_group_init( %d ) rc = %d\n", max_num_crypto_wqs, rc );
+      
+      goto SG_gateway_init_error;
+   }
+   
+   // advance!
+   crypto_wqs_inited = true;
+   
    // get block size, now that the MS client is initialized 
    block_size = ms_client_get_volume_blocksize( ms );
    
+   // recycle block buffers 
+   rc = md_bufpool_register( block_size, conf->block_pool_buffers );
+   if( rc != 0 ) {
+      
+      SG_error("md_bufpool_register( %" PRIu64 " ) rc = %d\n", block_size, rc );
+      
+      goto SG_gateway_init_error;
+   }
+   
    // initialize cache
    rc = md_cache_init( cache, conf, conf->cache_soft_limit / block_size, conf->cache_hard_limit / block_size );
    if( rc != 0 ) {
@@ -946,7 +1059,7 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    // load driver 
    if( !opts->ignore_driver ) {
       
-      rc = SG_gateway_driver_init_internal( ms, conf, driver, 1 );
+      rc = SG_gateway_driver_init_internal( ms, conf, driver, conf->num_driver_instances );
       if( rc != 0 && rc != -ENOENT ) {
          
          SG_error("SG_gateway_driver_init_internal rc = %d\n", rc );
@@ -959,10 +1072,10 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    }
    
    // set up the downloader 
-   rc = md_downloader_init( dl, "gateway" );
+   rc = md_downloader_init_sharded( dl, "gateway", conf->num_download_threads );
    if( rc != 0 ) {
       
-      SG_error("md_downloader_init('gateway') rc = %d\n", rc );
+      SG_error("md_downloader_init_sharded('gateway', %d) rc = %d\n", conf->num_download_threads, rc );
       
       goto SG_gateway_init_error;
    }
@@ -970,8 +1083,17 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    // advance!
    dl_inited = true;
    
+   // set up the connection pool to peer gateways 
+   rc = md_curl_pool_init( curl_pool, conf->curl_pool_size, conf->curl_pool_idle_timeout );
+   if( rc != 0 ) {
+      
+      SG_error("md_curl_pool_init rc = %d\n", rc );
+      
+      goto SG_gateway_init_error;
+   }
+   
    // start workqueues 
-   for( int i = 0; i < num_iowqs; i++ ) {
+   for( int i = 0; i < max_num_iowqs; i++ ) {
       
       rc = md_wq_start( &iowqs[i] );
       if( rc != 0 ) {
@@ -982,6 +1104,17 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
       }
    }
    
+   for( int i = 0; i < max_num_crypto_wqs; i++ ) {
+      
+      rc = md_wq_start( &crypto_wqs[i] );
+      if( rc != 0 ) {
+         
+         SG_error("md_wq_start( crypto_wqs[%d] ) rc = %d\n", i, rc );
+         
+         goto SG_gateway_init_error;
+      }
+   }
+   
    // start cache 
    rc = md_cache_start( cache );
    if( rc != 0 ) {
@@ -1024,6 +1157,11 @@ int SG_gateway_init_opts( struct SG_gateway* gateway, struct md_opts* opts ) {
    gateway->config_sem = config_sem;
    gateway->iowqs = iowqs;
    gateway->num_iowqs = max_num_iowqs;
+   gateway->crypto_wqs = crypto_wqs;
+   gateway->num_crypto_wqs = max_num_crypto_wqs;
+   gateway->sigcache = sigcache;
+   gateway->manifest_cache = manifest_cache;
+   gateway->curl_pool = curl_pool;
    gateway->first_arg_optind = first_arg_optind;
    gateway->foreground = opts->foreground;
    
@@ -1109,14 +1247,47 @@ SG_gateway_init_error:
       ms_client_destroy( ms );
    }
    
-   if( iowqs != NULL ) {
-      for( int i = 0; i < num_iowqs; i++ ) {
-        
+   if( iowqs_inited ) {
+      
+      // stop all workers before freeing any of them, since they share work
+      for( int i = 0; i < max_num_iowqs; i++ ) {
           md_wq_stop( &iowqs[i] );
+      }
+      
+      for( int i = 0; i < max_num_iowqs; i++ ) {
           md_wq_free( &iowqs[i], NULL );
       }
+   }
+   
+   SG_safe_free( iowqs );
+   
+   if( crypto_wqs_inited ) {
+      
+      for( int i = 0; i < max_num_crypto_wqs; i++ ) {
+          md_wq_stop( &crypto_wqs[i] );
+      }
       
-      SG_safe_free( iowqs );
+      for( int i = 0; i < max_num_crypto_wqs; i++ ) {
+          md_wq_free( &crypto_wqs[i], NULL );
+      }
+   }
+   
+   SG_safe_free( crypto_wqs );
+   
+   if( sigcache != NULL ) {
+      SG_gateway_sigcache_free( sigcache );
+      SG_safe_free( sigcache );
+   }
+   
+   if( manifest_cache != NULL ) {
+      SG_server_manifest_cache_free( manifest_cache );
+      SG_safe_free( manifest_cache );
+   }
+   
+   if( curl_pool != NULL ) {
+      if( md_curl_pool_free( curl_pool ) == 0 ) {
+         SG_safe_free( curl_pool );
+      }
    }
    
    SG_safe_free( ms );
@@ -1253,14 +1424,59 @@ int SG_gateway_shutdown( struct SG_gateway* gateway ) {
    }
    
    if( gateway->iowqs != NULL ) {
-       for( int i = 0; i < gateway->num_iowqs; i++ ) {
       
+       // stop all workers before freeing any of them, since they share work
+       for( int i = 0; i < gateway->num_iowqs; i++ ) {
           md_wq_stop( &gateway->iowqs[i] );
+       }
+       
+       SG_gateway_io_stats_log( gateway );
+       
+       for( int i = 0; i < gateway->num_iowqs; i++ ) {
           md_wq_free( &gateway->iowqs[i], NULL );
        }
    
        SG_safe_free( gateway->iowqs );
    }
+   
+   if( gateway->crypto_wqs != NULL ) {
+      
+      // stop all workers before freeing any of them, since they share work
+      for( int i = 0; i < gateway->num_crypto_wqs; i++ ) {
+         md_wq_stop( &gateway->crypto_wqs[i] );
+      }
+      
+      for( int i = 0; i < gateway->num_crypto_wqs; i++ ) {
+         md_wq_free( &gateway->crypto_wqs[i], NULL );
+      }
+      
+      SG_safe_free( gateway->crypto_wqs );
+   }
+   
+   if( gateway->sigcache != NULL ) {
+      
+      SG_gateway_sigcache_free( gateway->sigcache );
+      SG_safe_free( gateway->sigcache );
+   }
+   
+   if( gateway->manifest_cache != NULL ) {
+      
+      SG_server_manifest_cache_free( gateway->manifest_cache );
+      SG_safe_free( gateway->manifest_cache );
+   }
+   
+   if( gateway->curl_pool != NULL ) {
+      
+      uint64_t hits = 0, misses = 0;
+      md_curl_pool_get_stats( gateway->curl_pool, &hits, &misses );
+      
+      SG_debug("Connection pool: %" PRIu64 " hits, %" PRIu64 " misses\n", hits, misses );
+      
+      // leak it if it's still in use
+      if( md_curl_pool_free( gateway->curl_pool ) == 0 ) {
+         SG_safe_free( gateway->curl_pool );
+      }
+   }
 
    if( gateway->conf != NULL ) {
        md_free_conf( gateway->conf );
@@ -1692,6 +1908,11 @@ struct md_downloader* SG_gateway_dl( struct SG_gateway* gateway ) {
    return gateway->dl;
 }
 
+// get the gateway's pool of connections to other gateways
+struct md_curl_pool* SG_gateway_curl_pool( struct SG_gateway* gateway ) {
+   return gateway->curl_pool;
+}
+
 // is the gateway running?
 bool SG_gateway_running( struct SG_gateway* gateway ) {
    return gateway->running;
@@ -1753,6 +1974,24 @@ int SG_chunk_dup( struct SG_chunk* dest, struct SG_chunk* src ) {
 }
 
 
+// duplicate a chunk into a buffer that may come from a block buffer pool.
+// only use this if dest will be freed with SG_chunk_free (and its data pointer never handed to anything that calls free(3) on it).
+// return 0 on success
+// return -ENOMEM on OOM
+int SG_chunk_dup_pooled( struct SG_chunk* dest, struct SG_chunk* src ) {
+   
+   dest->data = md_bufpool_alloc( src->len );
+   if( dest->data == NULL ) {
+      return -ENOMEM;
+   }
+   
+   dest->len = src->len;
+   memcpy( dest->data, src->data, src->len );
+   
+   return 0;
+}
+
+
 // copy or duplicate a chunk
 // only copy if we have space; otherwise duplicate
 // return 0 on success
@@ -1792,9 +2031,9 @@ int SG_chunk_copy( struct SG_chunk* dest, struct SG_chunk* src ) {
    return 0;
 }
 
-// free a chunk 
+// free a chunk (its data may have come from a buffer pool)
 void SG_chunk_free( struct SG_chunk* chunk ) {
-   SG_safe_free( chunk->data );
+   SG_pool_safe_free( chunk->data );
    chunk->len = 0;
 }
 
@@ -1808,32 +2047,17 @@ static int SG_gateway_cache_get_raw( struct SG_gateway* gateway, struct SG_reque
    
    char* chunk_buf = NULL;
    ssize_t chunk_len = 0;
-   int block_fd = 0;
    
    // stored on disk?
-   block_fd = md_cache_open_block( gateway->cache, reqdat->file_id, reqdat->file_version, block_id_or_manifest_mtime_sec, block_version_or_manifest_mtime_nsec, O_RDONLY );
-   
-   if( block_fd < 0 ) {
-      
-      SG_warn("md_cache_open_block( %" PRIX64 ".%" PRId64 "[%s %" PRIu64 ".%" PRId64 "] (%s) ) rc = %d\n",
-              reqdat->file_id, reqdat->file_version, SG_request_is_block( reqdat ) ? "block" : "manifest", block_id_or_manifest_mtime_sec, block_version_or_manifest_mtime_nsec, reqdat->fs_path, block_fd );
-      
-      return block_fd;
-   }
-   
-   // chunk opened.
-   // read it 
-   chunk_len = md_cache_read_block( block_fd, &chunk_buf );
+   chunk_len = md_cache_read_block_by_id( gateway->cache, reqdat->file_id, reqdat->file_version, block_id_or_manifest_mtime_sec, block_version_or_manifest_mtime_nsec, &chunk_buf );
    if( chunk_len < 0 ) {
       
-      SG_error("md_cache_read_block( %" PRIX64 ".%" PRId64 "[%s %" PRIu64 ".%" PRId64 "] (%s) ) rc = %d\n",
-               reqdat->file_id, reqdat->file_version, SG_request_is_block( reqdat ) ? "block" : "manifest", block_id_or_manifest_mtime_sec, block_version_or_manifest_mtime_nsec, reqdat->fs_path, (int)chunk_len );
+      SG_warn("md_cache_read_block_by_id( %" PRIX64 ".%" PRId64 "[%s %" PRIu64 ".%" PRId64 "] (%s) ) rc = %d\n",
+              reqdat->file_id, reqdat->file_version, SG_request_is_block( reqdat ) ? "block" : "manifest", block_id_or_manifest_mtime_sec, block_version_or_manifest_mtime_nsec, reqdat->fs_path, (int)chunk_len );
       
       return (int)chunk_len;
    }
    
-   close( block_fd );
-   
    // success! promote!
    md_cache_promote_block( gateway->cache, reqdat->file_id, reqdat->file_version, block_id_or_manifest_mtime_sec, block_version_or_manifest_mtime_nsec );
    
@@ -1984,20 +2208,284 @@ int SG_gateway_cached_manifest_put_raw_async( struct SG_gateway* gateway, struct
 }
 
 
-// start an I/O request on one of the gateway's I/O work queues
+// start an I/O request on one of the gateway's I/O work queues.
+// idle workers will steal it if the chosen worker is busy.
 // return 0 on success 
 // return negative on error
 // NOTE: wreq and all of its data must be heap-allocated.  The gateway will take ownership.
 int SG_gateway_io_start( struct SG_gateway* gateway, struct md_wreq* wreq ) {
    
+   return md_wq_group_add( gateway->iowqs, gateway->num_iowqs, wreq );
+}
+
+
+// carry out a crypto job 
+static void SG_crypto_job_run( struct SG_crypto_job* job ) {
+   
+   if( job->type == SG_CRYPTO_SIGN ) {
+      job->rc = md_sign_message( job->pkey, job->data, job->len, &job->sigb64, &job->sigb64_len );
+   }
+   else if( job->type == SG_CRYPTO_VERIFY ) {
+      job->rc = md_verify_signature( job->pkey, job->data, job->len, job->sigb64, job->sigb64_len );
+   }
+   else if( job->type == SG_CRYPTO_HASH ) {
+      sha256_hash_buf( job->data, job->len, job->hash );
+      job->rc = 0;
+   }
+   else {
+      job->rc = -EINVAL;
+   }
+}
+
+
+// crypto worker: carry out a job, and tell its submitter
+// always succeeds
+static int SG_gateway_crypto_work( struct md_wreq* wreq, void* cls ) {
+   
+   struct SG_crypto_job* job = (struct SG_crypto_job*)wreq->work_data;
+   
+   SG_crypto_job_run( job );
+   sem_post( &job->batch->done );
+   
+   return 0;
+}
+
+
+// carry out a batch of signing, verification, and hashing jobs, and wait for them all to finish.
+// the first job runs on the calling thread, and the rest are spread across the crypto workers, so a batch's jobs run in parallel.
+// a batch of one job never leaves the caller--handing it off would only add two context switches.
+// if there are no crypto workers (or they are stopped), the jobs run on the calling thread.
+// each job's result will be in its rc field.
+// return 0 once all jobs have run
+int SG_gateway_crypto_run( struct SG_gateway* gateway, struct SG_crypto_job* jobs, size_t num_jobs ) {
+   
+   int rc = 0;
+   struct SG_crypto_batch batch;
+   struct md_wreq wreq;
+   size_t num_started = 0;
+   
+   if( gateway == NULL || gateway->crypto_wqs == NULL || num_jobs <= 1 ) {
+      
+      for( size_t i = 0; i < num_jobs; i++ ) {
+         SG_crypto_job_run( &jobs[i] );
+      }
+      
+      return 0;
+   }
+   
+   sem_init( &batch.done, 0, 0 );
+   
+   for( size_t i = 1; i < num_jobs; i++ ) {
+      
+      jobs[i].batch = &batch;
+      
+      md_wreq_init( &wreq, SG_gateway_crypto_work, &jobs[i], 0 );
+      
+      rc = md_wq_group_add( gateway->crypto_wqs, gateway->num_crypto_wqs, &wreq );
+      if( rc != 0 ) {
+         
+         // do it ourselves 
+         SG_crypto_job_run( &jobs[i] );
+         md_wreq_free( &wreq );
+      }
+      else {
+         
+         num_started++;
+      }
+   }
+   
+   // do our share while the workers do theirs
+   SG_crypto_job_run( &jobs[0] );
+   
+   // wait for the workers 
+   for( size_t i = 0; i < num_started; i++ ) {
+      
+      while( sem_wait( &batch.done ) != 0 && errno == EINTR );
+   }
+   
+   sem_destroy( &batch.done );
+   return 0;
+}
+
+
+// sign a message with the given private key (see SG_gateway_crypto_run; a single signature runs on the caller).
+// cls must be the gateway; this has the same signature and semantics as md_sign_message (see md_sign_ex).
+// return 0 on success, and set *sigb64 and *sigb64_len
+// return -ENOMEM on OOM
+// return -EINVAL if the message could not be signed
+int SG_gateway_crypto_sign_message( void* cls, EVP_PKEY* pkey, char const* data, size_t len, char** sigb64, size_t* sigb64_len ) {
+   
+   struct SG_crypto_job job;
+   
+   memset( &job, 0, sizeof(struct SG_crypto_job) );
+   
+   job.type = SG_CRYPTO_SIGN;
+   job.pkey = pkey;
+   job.data = data;
+   job.len = len;
+   
+   SG_gateway_crypto_run( (struct SG_gateway*)cls, &job, 1 );
+   
+   if( job.rc == 0 ) {
+      
+      *sigb64 = job.sigb64;
+      *sigb64_len = job.sigb64_len;
+   }
+   
+   return job.rc;
+}
+
+
+// verify a message's signature with the given public key (see SG_gateway_crypto_run; a single verification runs on the caller).
+// cls must be the gateway; this has the same signature and semantics as md_verify_signature (see md_verify_ex).
+// return 0 if the signature is valid 
+// return -ENOMEM on OOM 
+// return -EINVAL if the signature is invalid
+int SG_gateway_crypto_verify_signature( void* cls, EVP_PKEY* public_key, char const* data, size_t len, char* sigb64, size_t sigb64_len ) {
+   
+   struct SG_crypto_job job;
+   
+   memset( &job, 0, sizeof(struct SG_crypto_job) );
+   
+   job.type = SG_CRYPTO_VERIFY;
+   job.pkey = public_key;
+   job.data = data;
+   job.len = len;
+   job.sigb64 = sigb64;
+   job.sigb64_len = sigb64_len;
+   
+   SG_gateway_crypto_run( (struct SG_gateway*)cls, &job, 1 );
+   
+   return job.rc;
+}
+
+
+// make a signature cache key 
+static string SG_gateway_sigcache_key( uint64_t gateway_id, uint64_t cert_version, unsigned char const* msg_hash ) {
+   
+   string key;
+   
+   key.reserve( 2 * sizeof(uint64_t) + SG_BLOCK_HASH_LEN );
+   key.append( (char const*)&gateway_id, sizeof(uint64_t) );
+   key.append( (char const*)&cert_version, sizeof(uint64_t) );
+   key.append( (char const*)msg_hash, SG_BLOCK_HASH_LEN );
+   
+   return key;
+}
+
+
+// have we already verified a message with the given sha256 (taken over the entire signed message), 
+// from the given gateway, while it had the given certificate version?
+// return true if so
+// return false if not (or on OOM)
+bool SG_gateway_sigcache_lookup( struct SG_gateway* gateway, uint64_t gateway_id, uint64_t cert_version, unsigned char const* msg_hash ) {
+   
+   bool ret = false;
+   struct SG_gateway_sigcache* sigcache = gateway->sigcache;
+   
+   if( sigcache == NULL ) {
+      return false;
+   }
+   
+   try {
+      
+      string key = SG_gateway_sigcache_key( gateway_id, cert_version, msg_hash );
+      
+      pthread_mutex_lock( &sigcache->lock );
+      
+      ret = (sigcache->verified->count( key ) > 0);
+      
+      pthread_mutex_unlock( &sigcache->lock );
+   }
+   catch( bad_alloc& ba ) {
+      
+      return false;
+   }
+   
+   return ret;
+}
+
+
+// remember that we verified a message with the given sha256 (taken over the entire signed message), 
+// from the given gateway, while it had the given certificate version.
+// evicts the oldest entry if there are more than SG_GATEWAY_SIGCACHE_SIZE entries.
+// return 0 on success
+// return -ENOMEM on OOM
+int SG_gateway_sigcache_insert( struct SG_gateway* gateway, uint64_t gateway_id, uint64_t cert_version, unsigned char const* msg_hash ) {
+   
    int rc = 0;
-   int wq_num = md_random64() % gateway->num_iowqs;     // NOTE: this is slightly biased
+   struct SG_gateway_sigcache* sigcache = gateway->sigcache;
+   
+   if( sigcache == NULL ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &sigcache->lock );
+   
+   try {
+      
+      string key = SG_gateway_sigcache_key( gateway_id, cert_version, msg_hash );
+      
+      if( sigcache->verified->count( key ) == 0 ) {
+         
+         sigcache->order->push( key );
+         sigcache->verified->insert( key );
+      }
+      
+      while( sigcache->order->size() > SG_GATEWAY_SIGCACHE_SIZE ) {
+         
+         sigcache->verified->erase( sigcache->order->front() );
+         sigcache->order->pop();
+      }
+   }
+   catch( bad_alloc& ba ) {
+      
+      rc = -ENOMEM;
+   }
+   
+   pthread_mutex_unlock( &sigcache->lock );
    
-   rc = md_wq_add( &gateway->iowqs[wq_num], wreq );
    return rc;
 }
 
 
+// get the statistics for each of the gateway's I/O work queues 
+// stats must have room for at least SG_gateway_num_io_workers() entries
+// return 0 on success 
+int SG_gateway_io_stats( struct SG_gateway* gateway, struct md_wq_stats* stats ) {
+   
+   for( int i = 0; i < gateway->num_iowqs; i++ ) {
+      md_wq_get_stats( &gateway->iowqs[i], &stats[i] );
+   }
+   
+   return 0;
+}
+
+
+// get the number of I/O workers 
+int SG_gateway_num_io_workers( struct SG_gateway* gateway ) {
+   return gateway->num_iowqs;
+}
+
+
+// log the statistics for each of the gateway's I/O work queues 
+void SG_gateway_io_stats_log( struct SG_gateway* gateway ) {
+   
+   struct md_wq_stats stats;
+   
+   for( int i = 0; i < gateway->num_iowqs; i++ ) {
+      
+      md_wq_get_stats( &gateway->iowqs[i], &stats );
+      
+      SG_info("I/O worker %d: added=%" PRIu64 " processed=%" PRIu64 " stolen=%" PRIu64 " depth=%" PRIu64 " max_depth=%" PRIu64 " avg_wait=%" PRId64 "ns max_wait=%" PRId64 "ns avg_run=%" PRId64 "ns\n",
+              i, stats.num_added, stats.num_processed, stats.num_stolen, stats.depth, stats.max_depth,
+              stats.num_added > stats.depth ? stats.total_wait_ns / (int64_t)(stats.num_added - stats.depth) : 0,
+              stats.max_wait_ns,
+              stats.num_processed > 0 ? stats.total_run_ns / (int64_t)stats.num_processed : 0 );
+   }
+}
+
+
 // get thread worker ID
 uint64_t SG_gateway_io_thread_id( struct SG_gateway* gateway ) {
    
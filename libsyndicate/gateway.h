@@ -24,12 +24,13 @@
 #include "libsyndicate/manifest.h"
 #include "libsyndicate/driver.h"
 #include "libsyndicate/cache.h"
+#include "libsyndicate/bufpool.h"
 #include "libsyndicate/workqueue.h"
 #include "libsyndicate/ms/core.h"
 
 // I/O hints for gateway requests
 struct SG_IO_hints {
-   int io_type;             // none, read, write, trunc
+   int io_type;             // none, read, write, sync, delete, prefetch
    uint64_t io_context;     // unique identifier that is consistent across a series of related reads or writes
    uint64_t offset;         // logical offset of the read/write
    uint64_t len;            // logical length of the read/write
@@ -41,6 +42,10 @@ struct SG_IO_hints {
 #define SG_IO_WRITE SG_messages::DriverRequest::WRITE
 #define SG_IO_SYNC  SG_messages::DriverRequest::SYNC
 #define SG_IO_DELETE SG_messages::DriverRequest::DELETE
+#define SG_IO_PREFETCH SG_messages::DriverRequest::PREFETCH
+
+// HTTP header that carries a block GET's io_type to the remote gateway, so its driver can tell prefetches from reads
+#define SG_IO_TYPE_HEADER "X-Syndicate-IO-Type"
 
 // gateway request structure, for a block or a manifest or xattr info
 struct SG_request_data {
@@ -78,6 +83,33 @@ struct SG_request_data {
    uint64_t src_gateway_id;
 };
 
+// crypto offload job types 
+#define SG_CRYPTO_SIGN          1
+#define SG_CRYPTO_VERIFY        2
+#define SG_CRYPTO_HASH          3
+
+// maximum number of verified message signatures to remember
+#define SG_GATEWAY_SIGCACHE_SIZE        4096
+
+struct SG_crypto_batch;
+struct SG_gateway_sigcache;
+struct SG_server_manifest_cache;
+
+// signing, verification, or hashing job, to be carried out by the gateway's crypto workers
+struct SG_crypto_job {
+   
+   int type;                            // SG_CRYPTO_SIGN, SG_CRYPTO_VERIFY, or SG_CRYPTO_HASH
+   EVP_PKEY* pkey;                      // private key (to sign) or public key (to verify)
+   char const* data;                    // message to sign, verify, or hash
+   size_t len;                          // length of data
+   char* sigb64;                        // base64-encoded signature (given if verifying; allocated and set if signing)
+   size_t sigb64_len;                   // length of sigb64
+   unsigned char hash[SG_BLOCK_HASH_LEN];  // sha256 of data (set if hashing)
+   int rc;                              // result of md_sign_message/md_verify_signature
+   
+   struct SG_crypto_batch* batch;       // batch this job was submitted in (set internally)
+};
+
 // gateway chunk of data, with known length
 struct SG_chunk {
    
@@ -97,8 +129,13 @@ struct SG_gateway {
    struct md_syndicate_cache* cache;    // block and manifest cache
    struct md_HTTP* http;                // HTTP server
    struct md_downloader* dl;            // downloader
+   struct md_curl_pool* curl_pool;      // reusable connections to peer gateways
    struct md_wq* iowqs;                 // server I/O work queues
    int num_iowqs;                       // number of I/O work queues
+   struct md_wq* crypto_wqs;            // signing/verification work queues
+   int num_crypto_wqs;                  // number of signing/verification work queues
+   struct SG_gateway_sigcache* sigcache;        // recently-verified message signatures
+   struct SG_server_manifest_cache* manifest_cache;     // recently-served signed manifests
    
    volatile bool running;               // set to true once brought up
    
@@ -237,6 +274,7 @@ struct ms_client* SG_gateway_ms( struct SG_gateway* gateway );
 struct md_syndicate_cache* SG_gateway_cache( struct SG_gateway* gateway );
 struct md_HTTP* SG_gateway_HTTP( struct SG_gateway* gateway );
 struct md_downloader* SG_gateway_dl( struct SG_gateway* gateway );
+struct md_curl_pool* SG_gateway_curl_pool( struct SG_gateway* gateway );
 bool SG_gateway_running( struct SG_gateway* gateway );
 uint64_t SG_gateway_id( struct SG_gateway* gateway );
 uint64_t SG_gateway_user_id( struct SG_gateway* gateway );
@@ -248,6 +286,7 @@ bool SG_gateway_foreground( struct SG_gateway* gateway );
 // block memory management 
 void SG_chunk_init( struct SG_chunk* chunk, char* data, off_t len );
 int SG_chunk_dup( struct SG_chunk* dest, struct SG_chunk* src );
+int SG_chunk_dup_pooled( struct SG_chunk* dest, struct SG_chunk* src );
 int SG_chunk_copy( struct SG_chunk* dest, struct SG_chunk* src );
 int SG_chunk_copy_or_dup( struct SG_chunk* dest, struct SG_chunk* src );
 void SG_chunk_free( struct SG_chunk* chunk );
@@ -276,6 +315,20 @@ int SG_gateway_cached_manifest_put_raw_async( struct SG_gateway* gateway, struct
 // run an I/O request 
 int SG_gateway_io_start( struct SG_gateway* gateway, struct md_wreq* wreq );
 
+// I/O worker statistics 
+int SG_gateway_num_io_workers( struct SG_gateway* gateway );
+int SG_gateway_io_stats( struct SG_gateway* gateway, struct md_wq_stats* stats );
+void SG_gateway_io_stats_log( struct SG_gateway* gateway );
+
+// signing, verification, and hashing, offloaded to the crypto workers
+int SG_gateway_crypto_run( struct SG_gateway* gateway, struct SG_crypto_job* jobs, size_t num_jobs );
+int SG_gateway_crypto_sign_message( void* gateway, EVP_PKEY* pkey, char const* data, size_t len, char** sigb64, size_t* sigb64_len );
+int SG_gateway_crypto_verify_signature( void* gateway, EVP_PKEY* public_key, char const* data, size_t len, char* sigb64, size_t sigb64_len );
+
+// verified signature cache 
+bool SG_gateway_sigcache_lookup( struct SG_gateway* gateway, uint64_t gateway_id, uint64_t cert_version, unsigned char const* msg_hash );
+int SG_gateway_sigcache_insert( struct SG_gateway* gateway, uint64_t gateway_id, uint64_t cert_version, unsigned char const* msg_hash );
+
 // implementation 
 int SG_gateway_impl_connect_cache( struct SG_gateway* gateway, CURL* curl, char const* url );
 int SG_gateway_impl_stat( struct SG_gateway* gateway, struct SG_request_data* reqdat, struct SG_request_data* out_reqdat, mode_t* mode );
@@ -302,4 +355,22 @@ int SG_request_data_from_md_entry( struct SG_request_data* reqdat, char const* f
 
 }
 
+// sign a protobuf with the gateway's private key, via SG_gateway_crypto_run
+// NOTE: class T should be a protobuf, and should have a string signature field 
+// return 0 on success
+// return -ENOMEM on OOM 
+// return -EINVAL if the message could not be serialized
+template <class T> int SG_gateway_sign( struct SG_gateway* gateway, T* protobuf ) {
+   return md_sign_ex< T >( SG_gateway_private_key( gateway ), protobuf, SG_gateway_crypto_sign_message, gateway );
+}
+
+// verify a protobuf's signature with the given public key, via SG_gateway_crypto_run
+// NOTE: class T should be a protobuf, and should have a string signature field 
+// return 0 on successful verification 
+// return -ENOMEM on OOM 
+// return -EINVAL if the signature is invalid
+template <class T> int SG_gateway_verify( struct SG_gateway* gateway, EVP_PKEY* public_key, T* protobuf ) {
+   return md_verify_ex< T >( public_key, protobuf, SG_gateway_crypto_verify_signature, gateway );
+}
+
 #endif
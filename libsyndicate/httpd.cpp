@@ -445,6 +445,7 @@ static void md_free_headers( struct md_HTTP_header** headers ) {
 
 // multiplex uploads by POST field (key), routing them to individual field handlers.
 // "*" is the catch-all field handler, if a more specific match cannot be found.
+// if there is a POST stream handler, it sees the data first, and may consume it instead.
 // return MHD_YES on success
 // return MHD_NO on OOM or field handler error
 int md_HTTP_post_upload_iterator( void *coninfo_cls, enum MHD_ValueKind kind,
@@ -462,6 +463,23 @@ int md_HTTP_post_upload_iterator( void *coninfo_cls, enum MHD_ValueKind kind,
    SG_HTTP_post_field_handler_t handler = NULL;
    struct SG_HTTP_post_field* field = NULL;
    
+   if( http->HTTP_POST_stream != NULL ) {
+      
+      rc = (*http->HTTP_POST_stream)( md_con_data, key, data, off, size );
+      if( rc < 0 ) {
+         
+         SG_error("POST stream handler for '%s': rc = %d\n", key, rc );
+         return MHD_NO;
+      }
+      else if( rc > 0 ) {
+         
+         // consumed 
+         return MHD_YES;
+      }
+      
+      rc = MHD_YES;
+   }
+   
    try {
       
       string field_name(key);
@@ -1425,9 +1443,11 @@ int md_HTTP_connection_resume( struct md_HTTP_connection_data* con_data, struct
    // send this response back once we resume 
    con_data->resume_resp = resp;
    
+   // clear this first: the connection may be handled again as soon as it is resumed
+   con_data->suspended = false;
+   
    // send it back
    MHD_resume_connection( con_data->connection );
-   con_data->suspended = false;
       
    SG_debug("Resume connection %p\n", con_data->connection );
       
@@ -149,6 +149,9 @@ struct md_HTTP_connection_data {
 typedef int (*SG_HTTP_method_t)( struct md_HTTP_connection_data*, struct md_HTTP_response* );
 typedef int (*SG_HTTP_post_field_handler_t)( char const*, char const*, char const*, off_t, size_t, void* );
 
+// (connection, field name, data, offset into field, length): return positive if consumed, 0 to pass to the field handler, negative on error
+typedef int (*SG_HTTP_post_stream_t)( struct md_HTTP_connection_data*, char const*, char const*, uint64_t, size_t );
+
 typedef map<string, SG_HTTP_post_field_handler_t> SG_HTTP_post_field_handler_map_t;
 
 // HTTP callbacks and control code
@@ -175,6 +178,9 @@ struct md_HTTP {
    
    // upload field handlers
    SG_HTTP_post_field_handler_map_t* upload_field_handlers;
+   
+   // sees POST data as it arrives, before the field handlers (optional)
+   SG_HTTP_post_stream_t HTTP_POST_stream;
 
    // maximum RAM upload size per connection
    uint64_t max_ram_upload_size;
@@ -214,6 +220,7 @@ extern char const MD_HTTP_DEFAULT_MSG[128];
 #define md_HTTP_HEAD( http, callback ) (http).HTTP_HEAD_handler = (callback)
 #define md_HTTP_upload_iterator( http, callback ) (http).HTTP_upload_iterator = (callback)
 #define md_HTTP_POST_finish( http, callback ) (http).HTTP_POST_finish = (callback)
+#define md_HTTP_POST_stream( http, callback ) (http).HTTP_POST_stream = (callback)
 #define md_HTTP_PUT_finish( http, callback ) (http).HTTP_PUT_finish = (callback)
 #define md_HTTP_DELETE( http, callback ) (http).HTTP_DELETE_handler = (callback)
 #define md_HTTP_close( http, callback ) (http).HTTP_cleanup = (callback)
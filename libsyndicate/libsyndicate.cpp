@@ -20,6 +20,7 @@
 #include "libsyndicate/private/opts.h"
 #include "libsyndicate/ms/ms-client.h"
 #include "libsyndicate/cache.h"
+#include "libsyndicate/bufpool.h"
 #include "libsyndicate/proc.h"
 
 #define INI_MAX_LINE 4096
@@ -640,6 +641,8 @@ int md_shutdown() {
    
    md_crypt_shutdown();
    
+   md_bufpool_shutdown();
+   
    curl_global_cleanup();
    return 0;
 }
@@ -1105,6 +1108,136 @@ static int md_conf_ini_parser( void* userdata, char const* section, char const*
          }
       }
       
+      else if( strcmp( key, SG_CONFIG_NUM_IO_WORKERS ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->num_io_workers = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_NUM_CRYPTO_WORKERS ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->num_crypto_workers = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_NUM_DOWNLOAD_THREADS ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val > 0 ) {
+            conf->num_download_threads = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_PUTCHUNKS_CONCURRENCY ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val > 0 ) {
+            conf->putchunks_concurrency = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_BLOCK_POOL_BUFFERS ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->block_pool_buffers = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_FSYNC_GROUP_COMMIT_WINDOW ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->fsync_group_commit_window = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_REPLICA_WRITE_QUORUM ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->replica_write_quorum = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_CURL_POOL_SIZE ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->curl_pool_size = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_CURL_POOL_IDLE_TIMEOUT ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->curl_pool_idle_timeout = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_NUM_DRIVER_INSTANCES ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val > 0 ) {
+            conf->num_driver_instances = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_MAX_DRIVER_INSTANCES ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->max_driver_instances = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_DRIVER_ACQUIRE_TIMEOUT ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 ) {
+            conf->driver_acquire_timeout = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_DRIVER_IDLE_TIMEOUT ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->driver_idle_timeout = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
       else if( strcmp( key, SG_CONFIG_CACHE_SOFT_LIMIT ) == 0 ) {
          rc = md_conf_parse_long( value, &val );
          if( rc == 0 ) {
@@ -1125,6 +1258,46 @@ static int md_conf_ini_parser( void* userdata, char const* section, char const*
          }
       }
       
+      else if( strcmp( key, SG_CONFIG_CACHE_IO_URING ) == 0 ) {
+         // use io_uring for cache writes?
+         if( strcasecmp( value, "true" ) == 0 || strcasecmp( value, "yes" ) == 0 || strcasecmp( value, "y" ) == 0 ) {
+            conf->cache_io_uring = true;
+         }
+         else if( strcasecmp( value, "false" ) == 0 || strcasecmp( value, "no" ) == 0 || strcasecmp( value, "n" ) == 0 ) {
+            conf->cache_io_uring = false;
+         }
+         else {
+            
+            rc = md_conf_parse_long( value, &val );
+            if( rc == 0 ) {
+                conf->cache_io_uring = (val != 0);
+            }
+            else {
+                return -EINVAL;
+            }
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_CACHE_SEGMENT_SIZE ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->cache_segment_size = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
+      else if( strcmp( key, SG_CONFIG_CACHE_SNAPSHOT_INTERVAL ) == 0 ) {
+         rc = md_conf_parse_long( value, &val );
+         if( rc == 0 && val >= 0 ) {
+            conf->cache_snapshot_interval = val;
+         }
+         else {
+            return -EINVAL;
+         }
+      }
+      
       else {
          SG_error( "Unrecognized key '%s'\n", key );
          return -EINVAL;
@@ -2823,12 +2996,29 @@ int md_default_conf( struct md_syndicate_conf* conf ) {
    conf->max_read_retry = 3;
    conf->max_write_retry = 3;
    
+   conf->num_io_workers = 0;     // one per CPU
+   conf->num_crypto_workers = 0; // one per CPU
+   conf->num_download_threads = 1;
+   conf->curl_pool_size = MD_CURL_POOL_DEFAULT_MAX_IDLE;
+   conf->curl_pool_idle_timeout = MD_CURL_POOL_DEFAULT_IDLE_TIMEOUT;
+   conf->num_driver_instances = 1;
+   conf->max_driver_instances = 0;       // no more than we start with
+   conf->driver_acquire_timeout = 60;
+   conf->driver_idle_timeout = 60;
+   conf->putchunks_concurrency = 8;
+   conf->block_pool_buffers = MD_BUFPOOL_DEFAULT_MAX_BUFS;
+   conf->fsync_group_commit_window = 0;  // commit each fsync on its own
+   conf->replica_write_quorum = 0;       // every RG
+   
    conf->gateway_version = -1;
    conf->cert_bundle_version = -1;
    conf->volume_version = -1;
    
    conf->cache_soft_limit = MD_CACHE_DEFAULT_SOFT_LIMIT;
    conf->cache_hard_limit = MD_CACHE_DEFAULT_HARD_LIMIT;
+   conf->cache_segment_size = 0;         // one file per block
+   conf->cache_io_uring = true;          // if available
+   conf->cache_snapshot_interval = MD_CACHE_DEFAULT_SNAPSHOT_INTERVAL;
 
    conf->certs_reload_helper = SG_strdup_or_die( SG_DEFAULT_CERTS_RELOAD_HELPER );
    conf->driver_reload_helper = SG_strdup_or_die( SG_DEFAULT_DRIVER_RELOAD_HELPER );
@@ -181,8 +181,24 @@ struct md_syndicate_conf {
    bool verify_peer;                                  // whether or not to verify the gateway server's SSL certificate with peers (if using HTTPS to talk to them)
    uint64_t cache_soft_limit;                         // soft limit on the size in bytes of the cache 
    uint64_t cache_hard_limit;                         // hard limit on the size in bytes of the cache
+   uint64_t cache_segment_size;                       // if positive, pack cached blocks into log-structured segment files of this many bytes (0 means one file per block)
+   bool cache_io_uring;                               // write cached blocks with io_uring, if the kernel supports it (otherwise, POSIX AIO)
+   uint64_t cache_snapshot_interval;                  // how often (in seconds) to save a snapshot of the cache's LRU to disk (0 means only on clean shutdown)
    char* metadata_url;                                // MS url
    uint64_t config_reload_freq;                       // how often do we check for a new configuration from the MS?
+   int num_io_workers;                                // number of server I/O worker threads (0 means one per CPU)
+   int num_crypto_workers;                            // number of threads for batched signing, verification, and hashing (0 means one per CPU)
+   int num_download_threads;                          // number of downloader threads the gateway spreads its transfers across
+   int curl_pool_size;                                // number of idle connections to keep open to each peer gateway or MS (0 disables pooling)
+   int64_t curl_pool_idle_timeout;                    // seconds an idle pooled connection is kept open (0 means forever)
+   int num_driver_instances;                          // number of driver processes to start per role
+   int max_driver_instances;                          // maximum number of driver processes per role (0 means the number started with)
+   int64_t driver_acquire_timeout;                    // seconds to wait for a free driver process (negative means forever)
+   int64_t driver_idle_timeout;                       // seconds an extra driver process may sit idle before it is stopped (0 means never)
+   int putchunks_concurrency;                         // maximum number of chunks from one PUTCHUNKS request handed to the driver at once
+   int block_pool_buffers;                            // maximum number of block buffers to keep mapped for reuse (0 disables pooling)
+   int64_t fsync_group_commit_window;                 // milliseconds to wait for other files' fsyncs to commit alongside one (0 disables group commit)
+   int replica_write_quorum;                          // number of RGs that must acknowledge a write before the MS is updated and fsync succeeds (0 means all of them)
    
    // cert and key processors 
    char* certs_reload_helper;                         // command to go reload and revalidate all certificates
@@ -260,10 +276,26 @@ struct md_syndicate_conf {
 #define SG_CONFIG_TRANSFER_TIMEOUT        "transfer_timeout"
 #define SG_CONFIG_CACHE_SOFT_LIMIT        "cache_soft_limit"
 #define SG_CONFIG_CACHE_HARD_LIMIT        "cache_hard_limit"
+#define SG_CONFIG_CACHE_SEGMENT_SIZE      "cache_segment_size"
+#define SG_CONFIG_CACHE_IO_URING          "cache_io_uring"
+#define SG_CONFIG_CACHE_SNAPSHOT_INTERVAL "cache_snapshot_interval"
 #define SG_CONFIG_MAX_READ_RETRY          "max_read_retry"
 #define SG_CONFIG_MAX_WRITE_RETRY         "max_write_retry"
 #define SG_CONFIG_MAX_METADATA_READ_RETRY "max_metadata_read_retry"
 #define SG_CONFIG_MAX_METADATA_WRITE_RETRY "max_metadata_write_retry"
+#define SG_CONFIG_NUM_IO_WORKERS          "io_workers"
+#define SG_CONFIG_NUM_CRYPTO_WORKERS      "crypto_workers"
+#define SG_CONFIG_NUM_DOWNLOAD_THREADS    "download_threads"
+#define SG_CONFIG_CURL_POOL_SIZE          "connection_pool_size"
+#define SG_CONFIG_CURL_POOL_IDLE_TIMEOUT  "connection_pool_idle_timeout"
+#define SG_CONFIG_NUM_DRIVER_INSTANCES    "driver_instances"
+#define SG_CONFIG_MAX_DRIVER_INSTANCES    "max_driver_instances"
+#define SG_CONFIG_DRIVER_ACQUIRE_TIMEOUT  "driver_acquire_timeout"
+#define SG_CONFIG_DRIVER_IDLE_TIMEOUT     "driver_idle_timeout"
+#define SG_CONFIG_PUTCHUNKS_CONCURRENCY   "putchunks_concurrency"
+#define SG_CONFIG_BLOCK_POOL_BUFFERS      "block_pool_buffers"
+#define SG_CONFIG_FSYNC_GROUP_COMMIT_WINDOW "fsync_group_commit_window"
+#define SG_CONFIG_REPLICA_WRITE_QUORUM    "replica_write_quorum"
 
 
 // some default values
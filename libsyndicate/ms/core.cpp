@@ -234,6 +234,7 @@ int ms_client_init( struct ms_client* client, struct md_syndicate_conf* conf, EV
    client->max_request_async_batch = MS_CLIENT_DEFAULT_MAX_ASYNC_REQUEST_BATCH;
    client->max_connections = MS_CLIENT_DEFAULT_MAX_CONNECTIONS;
    client->ms_transfer_timeout = MS_CLIENT_DEFAULT_MS_TRANSFER_TIMEOUT;
+   client->bulk_listing = true;
    
    // cert bundle 
    client->certs = SG_safe_new( ms_cert_bundle() );
@@ -301,11 +302,40 @@ int ms_client_init( struct ms_client* client, struct md_syndicate_conf* conf, EV
    // NOTE: ms_client_try_load_key will mlock a private key 
    client->gateway_key_pem_mlocked = true;
    
+   // set up the pool of connections to the MS 
+   client->curl_pool = md_curl_pool_new();
+   if( client->curl_pool == NULL ) {
+      
+      rc = -ENOMEM;
+   }
+   else {
+      
+      rc = md_curl_pool_init( client->curl_pool, conf->curl_pool_size, conf->curl_pool_idle_timeout );
+      if( rc != 0 ) {
+         
+         SG_error("md_curl_pool_init rc = %d\n", rc );
+         SG_safe_free( client->curl_pool );
+      }
+   }
+   
    // start downloading
-   rc = md_downloader_start( client->dl );
+   if( rc == 0 ) {
+      
+      rc = md_downloader_start( client->dl );
+      if( rc != 0 ) {
+         
+         SG_error("Failed to start downloader, rc = %d\n", rc );
+      }
+   }
+   
    if( rc != 0 ) {
       
-      SG_error("Failed to start downloader, rc = %d\n", rc );
+      if( client->curl_pool != NULL ) {
+         
+         if( md_curl_pool_free( client->curl_pool ) == 0 ) {
+            SG_safe_free( client->curl_pool );
+         }
+      }
       
       md_downloader_shutdown( client->dl ); 
       SG_safe_free( client->dl );
@@ -407,6 +437,17 @@ int ms_client_destroy( struct ms_client* client ) {
    SG_safe_free( client->dl );
    
    ms_client_unlock( client );
+   
+   // drain the connection pool without the lock held: this can wait up to MD_CURL_POOL_DRAIN_TIMEOUT seconds
+   // for in-flight requests to release their handles, and they may need the lock to finish.
+   if( client->curl_pool != NULL ) {
+      
+      // leak it if it's still in use
+      if( md_curl_pool_free( client->curl_pool ) == 0 ) {
+         SG_safe_free( client->curl_pool );
+      }
+   }
+   
    pthread_rwlock_destroy( &client->lock );
  
    SG_info("%s", "MS client shutdown\n");
@@ -503,8 +544,8 @@ int ms_client_download( struct ms_client* client, char const* url, char** buf, o
    
    memset( &timing, 0, sizeof(struct ms_client_timing) );
    
-   // connect (TODO: connection pool)
-   curl = curl_easy_init();  
+   // connect 
+   curl = md_curl_pool_get( client->curl_pool, url );
    if( curl == NULL ) {
       return -ENOMEM;
    }
@@ -514,7 +555,7 @@ int ms_client_download( struct ms_client* client, char const* url, char** buf, o
    if( rc != 0 ) {
       
       // failed!
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       return -ENOMEM;
    }
    
@@ -526,7 +567,7 @@ int ms_client_download( struct ms_client* client, char const* url, char** buf, o
    // run 
    rc = md_download_run( curl, MS_MAX_MSG_SIZE, buf, buflen );
    
-   curl_easy_cleanup( curl );
+   md_curl_pool_release( client->curl_pool, curl );
    SG_safe_free( auth_header );
    
    if( rc != 0 ) {
@@ -50,6 +50,9 @@
 #define MS_CLIENT_DEFAULT_MAX_CONNECTIONS 100
 #define MS_CLIENT_DEFAULT_MS_TRANSFER_TIMEOUT 25
 
+// response header set by MSs that sent back a bulk listing
+#define MS_CLIENT_BULK_LISTING_HEADER "X-Syndicate-Bulk-Listing"
+
 using namespace std;
 
 // use STRONG TLS crypto.
@@ -74,6 +77,7 @@ struct ms_client {
    char* url;                   // MS URL (read-only; never changes)
    
    struct md_downloader* dl;    // downloader instance
+   struct md_curl_pool* curl_pool;      // reusable connections to the MS
    
    struct md_syndicate_conf* conf;      // reference to syndicate config (read-only, never changes)
    
@@ -98,6 +102,7 @@ struct ms_client {
    int max_request_async_batch;     // maximum number of asynchronous requests we can send in one multi_request
    int max_connections;       // maximum number of open connections to make to the MS
    int ms_transfer_timeout;     // how long to wait for data transfer before failing with -EAGAIN
+   bool bulk_listing;           // if true, try to list directories in bulk first (cleared if the MS turns out not to support it)
    
    //////////////////////////////////////////////////////////////////
    // gateway volume-change structures (represents a consistent view of the Volume control state)
@@ -452,15 +452,14 @@ int ms_client_request_result_free_all( struct ms_client_request_result* results,
    return 0;
 }
 
-// perform a single operation on the MS, synchronously, given the single update to send
-// return 0 on success, which means that we successfully got a response from the MS.  The response will be stored to result (which can encode an error from the MS, albeit successfully transferred).
-// return -EBADMSG if the reply was improperly structured, or contained an entry whose authenticity could not be verified
-// return negative on lower-level errors, like protocol, transport, marshalling problems. (TODO: better documentation)
+// send a batch of requests to the MS in one POST, and get back its (verified) reply.
+// timing information from the MS is logged.
+// return 0 on success, and populate *reply
 // return -ENOMEM on OOM
-int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* request, struct ms_client_request_result* result ) {
+// return negative on lower-level errors, like protocol, transport, marshalling problems (see md_download_run, ms_client_parse_reply)
+static int ms_client_rpc_post( struct ms_client* client, ms_client_request_list* requests, ms::ms_reply* reply ) {
    
    int rc = 0;
-   ms_client_request_list requests;
    CURL* curl = NULL;
    struct curl_httppost *post = NULL, *last = NULL;
    struct ms_client_timing timing;
@@ -470,38 +469,33 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
    size_t serialized_text_len = 0;
    char* buf = NULL;
    off_t buflen = 0;
-   ms::ms_reply reply;
-   struct md_entry* ent = NULL;
    
    memset( &timing, 0, sizeof(struct ms_client_timing) );
    
    uint64_t volume_id = ms_client_get_volume_id( client );
    
-   // generate our update
-   requests.push_back( request );
-   
-   rc = ms_client_requests_serialize( client, &requests, &serialized_text, &serialized_text_len, &post, &last );
+   rc = ms_client_requests_serialize( client, requests, &serialized_text, &serialized_text_len, &post, &last );
    if( rc != 0 ) {
       
       SG_error("ms_client_requests_serialize rc = %d\n", rc );
       return rc;
    }
    
-   // connect (TODO: connection pool)
-   curl = curl_easy_init();
-   if( curl == NULL ) {
+   url = ms_client_file_url( client->url, volume_id, ms_client_volume_version( client ), ms_client_cert_version( client ) );
+   if( url == NULL ) {
       
       SG_safe_free( serialized_text );
       curl_formfree( post );
       return -ENOMEM;
    }
    
-   url = ms_client_file_url( client->url, volume_id, ms_client_volume_version( client ), ms_client_cert_version( client ) );
-   if( url == NULL ) {
+   // connect 
+   curl = md_curl_pool_get( client->curl_pool, url );
+   if( curl == NULL ) {
       
-      curl_easy_cleanup( curl );
       SG_safe_free( serialized_text );
       curl_formfree( post );
+      SG_safe_free( url );
       return -ENOMEM;
    }
    
@@ -510,7 +504,7 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
    if( rc != 0 ) {
       
       // failed!
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       SG_safe_free( serialized_text );
       curl_formfree( post );
       SG_safe_free( url );
@@ -528,7 +522,7 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
    // run 
    rc = md_download_run( curl, MS_MAX_MSG_SIZE, &buf, &buflen );
    
-   curl_easy_cleanup( curl );
+   md_curl_pool_release( client->curl_pool, curl );
    curl_formfree( post );
    SG_safe_free( serialized_text );
    SG_safe_free( url );
@@ -542,7 +536,7 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
    }
    
    // parse and verify
-   rc = ms_client_parse_reply( client, &reply, buf, buflen );
+   rc = ms_client_parse_reply( client, reply, buf, buflen );
    
    SG_safe_free( buf );
    
@@ -553,20 +547,46 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
       return rc;
    }
    
+   ms_client_timing_log( &timing );
+   ms_client_timing_free( &timing );
+   
+   return 0;
+}
+
+
+// perform a single operation on the MS, synchronously, given the single update to send
+// return 0 on success, which means that we successfully got a response from the MS.  The response will be stored to result (which can encode an error from the MS, albeit successfully transferred).
+// return -EBADMSG if the reply was improperly structured, or contained an entry whose authenticity could not be verified
+// return negative on lower-level errors, like protocol, transport, marshalling problems. (TODO: better documentation)
+// return -ENOMEM on OOM
+int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* request, struct ms_client_request_result* result ) {
+   
+   int rc = 0;
+   ms_client_request_list requests;
+   ms::ms_reply reply;
+   struct md_entry* ent = NULL;
+   
+   // generate our update
+   requests.push_back( request );
+   
+   rc = ms_client_rpc_post( client, &requests, &reply );
+   if( rc != 0 ) {
+      
+      return rc;
+   }
+   
    result->reply_error = reply.error();
    
    // ensure we got meaningful data
    if( result->reply_error != 0 ) {
       SG_error("MS RPC error code %d\n", result->reply_error );
       
-      ms_client_timing_free( &timing );
       return 0;
    }
    
    if( reply.errors_size() != 1 ) {
       SG_error("MS replied %d error codes (expected 1)\n", reply.errors_size() );
       
-      ms_client_timing_free( &timing );
       return -EBADMSG;
    }
    
@@ -579,14 +599,12 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
       if( !reply.has_listing() ) {
          SG_error("%s", "MS replied 0 entries (expected 1)\n" );
          
-         ms_client_timing_free( &timing );
          return -EBADMSG;
       }
       
       if( reply.listing().entries_size() != 1 && request->op != ms::ms_request::RENAME ) {
          SG_error("MS replied %d entries (expected 1)\n", reply.listing().entries_size() );
          
-         ms_client_timing_free( &timing );
          return -EBADMSG;
       }
       
@@ -598,7 +616,6 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
          if( rc != 0 ) {
             SG_error("Invalid entry %" PRIX64 "\n", reply.listing().entries(0).file_id() );
                
-            ms_client_timing_free( &timing );
             return -EBADMSG;
          }
             
@@ -606,14 +623,12 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
          ent = SG_CALLOC( struct md_entry, 1 );
          if( ent == NULL ) {
             
-            ms_client_timing_free( &timing );
             return -ENOMEM;
          }
          
          rc = ms_entry_to_md_entry( reply.listing().entries(0), ent );
          if( rc != 0 ) {
             
-            ms_client_timing_free( &timing );
             return rc;
          }
       }
@@ -622,8 +637,139 @@ int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* re
    result->rc = reply.errors(0);
    result->ent = ent;
    
-   ms_client_timing_log( &timing );
-   ms_client_timing_free( &timing );
+   return 0;
+}
+
+
+// free each of a batch of results, but not the array
+static void ms_client_multi_rpc_results_free( struct ms_client_request_result* results, size_t num_results ) {
+   
+   for( size_t i = 0; i < num_results; i++ ) {
+      ms_client_request_result_free( &results[i] );
+   }
+}
+
+
+// perform a batch of operations on the MS, synchronously, in a single POST.
+// return 0 on success, which means that we got a response from the MS.  results[i] will hold the outcome of requests[i] (which can encode an error from the MS), 
+// including the MS's copy of the entry for successful operations that return one.  The caller must free each result with ms_client_request_result_free.
+// return -EINVAL if there are no requests, or if any of them is a RENAME
+// return -EBADMSG if the reply was improperly structured, or contained an entry whose authenticity could not be verified
+// return -ENOMEM on OOM
+// return negative on lower-level errors, like protocol, transport, marshalling problems
+int ms_client_multi_rpc( struct ms_client* client, struct ms_client_request* requests, size_t num_requests, struct ms_client_request_result* results ) {
+   
+   int rc = 0;
+   ms_client_request_list request_list;
+   ms::ms_reply reply;
+   int next_ent = 0;
+   
+   if( num_requests == 0 ) {
+      return -EINVAL;
+   }
+   
+   try {
+      for( size_t i = 0; i < num_requests; i++ ) {
+         
+         if( requests[i].op == ms::ms_request::RENAME ) {
+            
+            // replies with a variable number of entries
+            SG_error("%s", "BUG: cannot batch RENAME\n");
+            return -EINVAL;
+         }
+         
+         request_list.push_back( &requests[i] );
+      }
+   }
+   catch( bad_alloc& ba ) {
+      return -ENOMEM;
+   }
+   
+   rc = ms_client_rpc_post( client, &request_list, &reply );
+   if( rc != 0 ) {
+      
+      return rc;
+   }
+   
+   for( size_t i = 0; i < num_requests; i++ ) {
+      
+      results[i].reply_error = reply.error();
+      results[i].file_id = requests[i].ent->file_id;
+   }
+   
+   if( reply.error() != 0 ) {
+      SG_error("MS RPC error code %d\n", reply.error() );
+      
+      return 0;
+   }
+   
+   if( (size_t)reply.errors_size() > num_requests ) {
+      SG_error("MS replied %d error codes (expected at most %zu)\n", reply.errors_size(), num_requests );
+      
+      return -EBADMSG;
+   }
+   
+   for( size_t i = 0; i < num_requests; i++ ) {
+      
+      if( i >= (size_t)reply.errors_size() ) {
+         
+         // the MS did not get to this one
+         results[i].rc = -EAGAIN;
+         continue;
+      }
+      
+      results[i].rc = reply.errors(i);
+      if( results[i].rc != 0 ) {
+         
+         SG_error("MS operation %d on %" PRIX64 " error %d\n", requests[i].op, results[i].file_id, results[i].rc );
+         continue;
+      }
+      
+      if( !MS_CLIENT_OP_RETURNS_ENTRY( requests[i].op ) ) {
+         continue;
+      }
+      
+      // the MS adds an entry for each successful operation that returns one, in request order
+      if( !reply.has_listing() || next_ent >= reply.listing().entries_size() ) {
+         
+         SG_error("MS replied too few entries (missing %" PRIX64 ")\n", results[i].file_id );
+         ms_client_multi_rpc_results_free( results, num_requests );
+         return -EBADMSG;
+      }
+      
+      ms::ms_entry* msent = reply.mutable_listing()->mutable_entries( next_ent );
+      next_ent++;
+      
+      if( msent->file_id() != results[i].file_id ) {
+         
+         SG_error("MS replied entry %" PRIX64 " (expected %" PRIX64 ")\n", msent->file_id(), results[i].file_id );
+         ms_client_multi_rpc_results_free( results, num_requests );
+         return -EBADMSG;
+      }
+      
+      // verify authenticity
+      rc = ms_entry_verify( client, msent );
+      if( rc != 0 ) {
+         
+         SG_error("Invalid entry %" PRIX64 "\n", msent->file_id() );
+         ms_client_multi_rpc_results_free( results, num_requests );
+         return -EBADMSG;
+      }
+      
+      results[i].ent = SG_CALLOC( struct md_entry, 1 );
+      if( results[i].ent == NULL ) {
+         
+         ms_client_multi_rpc_results_free( results, num_requests );
+         return -ENOMEM;
+      }
+      
+      rc = ms_entry_to_md_entry( *msent, results[i].ent );
+      if( rc != 0 ) {
+         
+         ms_client_multi_rpc_results_free( results, num_requests );
+         return rc;
+      }
+   }
    
    return 0;
 }
@@ -917,6 +1063,150 @@ int ms_client_update( struct ms_client* client, struct md_entry* ent_out, struct
 }
 
 
+// update a batch of file or directory records on the MS, sending up to client->max_request_batch updates per request.
+// Each entry is signed here, as in ms_client_update.
+// On success, rcs[i] is set to the outcome of updating ents[i] (0, or the MS's error, or -EAGAIN if it was not attempted),
+// and each ents_out[i] with rcs[i] == 0 is populated with the data on the MS.  The caller must free them.
+// If the MS rejects a request as a whole (e.g. it does not support batches), its entries were not attempted, so they get -EAGAIN too.
+// return 0 if every request to the MS was sent (check rcs for each entry's outcome)
+// return -ENOMEM on OOM 
+// return negative on RPC error (see ms_client_multi_rpc); entries that were not sent will have rcs[i] == -EAGAIN
+int ms_client_update_multi( struct ms_client* client, struct md_entry* ents_out, struct md_entry* ents, size_t num_ents, int* rcs ) {
+   
+   int rc = 0;
+   size_t batch_size = (client->max_request_batch > 0 ? (size_t)client->max_request_batch : 1);
+   struct ms_client_request* requests = NULL;
+   struct ms_client_request_result* results = NULL;
+   int64_t* write_nonces = NULL;
+   
+   for( size_t i = 0; i < num_ents; i++ ) {
+      rcs[i] = -EAGAIN;
+   }
+   
+   requests = SG_CALLOC( struct ms_client_request, batch_size );
+   results = SG_CALLOC( struct ms_client_request_result, batch_size );
+   write_nonces = SG_CALLOC( int64_t, num_ents );
+   
+   if( requests == NULL || results == NULL || write_nonces == NULL ) {
+      
+      SG_safe_free( requests );
+      SG_safe_free( results );
+      SG_safe_free( write_nonces );
+      return -ENOMEM;
+   }
+   
+   for( size_t start = 0; start < num_ents; start += batch_size ) {
+      
+      size_t num_requests = 0;
+      
+      for( size_t i = start; i < num_ents && i < start + batch_size; i++ ) {
+         
+         unsigned char* sig = NULL;
+         size_t sig_len = 0;
+         
+         write_nonces[i] = ents[i].write_nonce;
+         
+         if( ents[i].type == MD_ENTRY_DIR ) {
+            // for directories, choose a random nonce 
+            ents[i].write_nonce = md_random64();
+         }
+         else {
+            // for files, writes only come from the coordinator, so we can sequentially increment.
+            ents[i].write_nonce = write_nonces[i] + 1;
+         }
+         
+         // sign the request 
+         rc = md_entry_sign( client->gateway_key, &ents[i], &sig, &sig_len );
+         if( rc != 0 ) {
+            
+            rc = -ENOMEM;
+            break;
+         }
+         
+         ents[i].ent_sig = sig;
+         ents[i].ent_sig_len = sig_len;
+         
+         ms_client_update_request( client, &ents[i], &requests[num_requests] );
+         num_requests++;
+      }
+      
+      if( rc == 0 ) {
+         
+         memset( results, 0, sizeof(struct ms_client_request_result) * num_requests );
+         rc = ms_client_multi_rpc( client, requests, num_requests, results );
+      }
+      
+      for( size_t k = 0; k < num_requests; k++ ) {
+         
+         size_t i = start + k;
+         
+         if( rc == 0 ) {
+            
+            if( results[k].reply_error != 0 ) {
+               
+               // the MS did not process the batch at all 
+               rcs[i] = -EAGAIN;
+            }
+            else if( results[k].rc != 0 ) {
+               
+               rcs[i] = results[k].rc;
+            }
+            else if( results[k].ent == NULL ) {
+               
+               SG_error("BUG: No entry given for %" PRIX64 "\n", ents[i].file_id );
+               rcs[i] = -ENODATA;
+            }
+            else {
+               
+               rcs[i] = md_entry_dup2( results[k].ent, &ents_out[i] );
+               if( rcs[i] == 0 ) {
+                  
+                  // advance write nonce 
+                  if( ents[i].type == MD_ENTRY_DIR ) {
+                      
+                      // MS controls directory consistency information 
+                      ents_out[i].write_nonce = results[k].ent->write_nonce;
+                  }
+                  else {
+                      
+                      // we're only calling this because we're the coordinator.
+                      ents_out[i].write_nonce = write_nonces[i] + 1;
+                  }
+               }
+            }
+         }
+         
+         SG_safe_free( ents[i].ent_sig );
+         ents[i].ent_sig_len = 0;
+      }
+      
+      if( rc == 0 ) {
+         ms_client_multi_rpc_results_free( results, num_requests );
+      }
+      
+      // restore the nonces of the entries we signed but didn't get to update
+      for( size_t k = 0; k < num_requests; k++ ) {
+         
+         if( rcs[start + k] == -EAGAIN ) {
+            ents[start + k].write_nonce = write_nonces[start + k];
+         }
+      }
+      
+      if( rc != 0 ) {
+         
+         SG_error("ms_client_multi_rpc(%zu updates) rc = %d\n", num_requests, rc );
+         break;
+      }
+   }
+   
+   SG_safe_free( requests );
+   SG_safe_free( results );
+   SG_safe_free( write_nonces );
+   
+   return rc;
+}
+
+
 // change coordinator ownership of a file on the MS, synchronously
 // Sign the entry if we haven't already.
 // Populate *ent_out with the data on the MS.  The caller must free it.
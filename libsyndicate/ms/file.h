@@ -83,6 +83,7 @@ int ms_client_delete( struct ms_client* client, struct md_entry* ent );
 int ms_client_update( struct ms_client* client, struct md_entry* ent_out, struct md_entry* ent );
 int ms_client_coordinate( struct ms_client* client, struct md_entry* ent_out, struct md_entry* ent, unsigned char* xattr_hash );
 int ms_client_rename( struct ms_client* client, struct md_entry* ent_out, struct md_entry* src, struct md_entry* dest );
+int ms_client_update_multi( struct ms_client* client, struct md_entry* ents_out, struct md_entry* ents, size_t num_ents, int* rcs );
 
 // generate requests to be run
 void ms_client_create_initial_fields( struct md_entry* ent );
@@ -110,6 +111,7 @@ int ms_client_multi_result_free( struct ms_client_multi_result* result );
 
 // low-level RPC
 int ms_client_single_rpc( struct ms_client* client, struct ms_client_request* request, struct ms_client_request_result* result );
+int ms_client_multi_rpc( struct ms_client* client, struct ms_client_request* requests, size_t num_requests, struct ms_client_request_result* results );
 
 // parsing
 int ms_client_parse_reply( struct ms_client* client, ms::ms_reply* src, char const* buf, size_t buf_len );
@@ -87,6 +87,26 @@ uint64_t ms_client_get_gateway_type( struct ms_client* client, uint64_t g_id ) {
 }
 
 
+// get the version of a gateway's certificate
+// return the version on success 
+// return SG_INVALID_GATEWAY_ID if we don't have a certificate for this gateway
+uint64_t ms_client_get_gateway_cert_version( struct ms_client* client, uint64_t g_id ) {
+   
+   ms_client_config_rlock( client );
+   
+   uint64_t ret = SG_INVALID_GATEWAY_ID;
+   
+   ms_cert_bundle::iterator itr = client->certs->find( g_id );
+   if( itr != client->certs->end() ) {
+      
+      ret = itr->second->version;
+   }
+   
+   ms_client_config_unlock( client );
+   return ret;
+}
+
+
 // get the name of the gateway
 // return 0 on success
 // return -ENOTCONN if we aren't connected to a volume
@@ -47,10 +47,11 @@ char* ms_client_get_gateway_url( struct ms_client* client, uint64_t gateway_id )
 
 // have to put this here, since C++ forbids separating the declaration and definition of template functions across multiple files???
 // Verify the authenticity of a gateway message, encoded as a protobuf (class T)
+// if verify_func is not NULL, it will be used to check the signature (see md_verify_ex)
 // return 0 if successfully verified 
 // return -EINVAL if message came from outside the volume
 // return -EAGAIN if we have no certificate for this gateway_id 
-template< class T > int ms_client_verify_gateway_message( struct ms_client* client, uint64_t volume_id, uint64_t gateway_id, T* protobuf ) {
+template< class T > int ms_client_verify_gateway_message_ex( struct ms_client* client, uint64_t volume_id, uint64_t gateway_id, T* protobuf, md_verify_signature_func_t verify_func, void* verify_cls ) {
    
    int rc = 0;
    
@@ -84,16 +85,17 @@ template< class T > int ms_client_verify_gateway_message( struct ms_client* clie
          SG_debug("WARN: No cached certificate for Gateway %" PRIu64 "\n", gateway_id );
          
          // try reloading
+         ms_client_config_unlock( client );
          return -EAGAIN;
       }
       
       // verify the cert
-      rc = md_verify< T >( itr->second->pubkey, protobuf );
+      rc = md_verify_ex< T >( itr->second->pubkey, protobuf, verify_func, verify_cls );
    }
    else {
       
       // verify that this came from the MS
-      rc = md_verify< T >( client->volume->volume_public_key, protobuf );
+      rc = md_verify_ex< T >( client->volume->volume_public_key, protobuf, verify_func, verify_cls );
    }
    
    ms_client_config_unlock( client );
@@ -102,4 +104,13 @@ template< class T > int ms_client_verify_gateway_message( struct ms_client* clie
 }
 
 
+// Verify the authenticity of a gateway message, encoded as a protobuf (class T), using md_verify_signature
+// return 0 if successfully verified 
+// return -EINVAL if message came from outside the volume
+// return -EAGAIN if we have no certificate for this gateway_id 
+template< class T > int ms_client_verify_gateway_message( struct ms_client* client, uint64_t volume_id, uint64_t gateway_id, T* protobuf ) {
+   return ms_client_verify_gateway_message_ex< T >( client, volume_id, gateway_id, protobuf, NULL, NULL );
+}
+
+
 #endif 
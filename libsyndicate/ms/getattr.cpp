@@ -69,8 +69,7 @@ static int ms_client_get_metadata_begin( struct ms_client* client, struct ms_pat
    SG_debug("%s download %p = %d, url %s\n", (do_getchild ? "GETCHILD" : "GETATTR"), dlctx, request_id, url );
    
    // set up curl 
-   // TODO connection pool
-   curl = curl_easy_init();
+   curl = md_curl_pool_get( client->curl_pool, url );
    if( curl == NULL ) {
       
       SG_safe_free( url );
@@ -83,7 +82,7 @@ static int ms_client_get_metadata_begin( struct ms_client* client, struct ms_pat
       
       // failed!
       SG_safe_free( url );
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       return -ENOMEM;
    }
    
@@ -94,7 +93,7 @@ static int ms_client_get_metadata_begin( struct ms_client* client, struct ms_pat
    if( dlstate == NULL ) {
       
       // OOM 
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       SG_safe_free( url );
       SG_safe_free( auth_header );
       return -ENOMEM;
@@ -108,7 +107,7 @@ static int ms_client_get_metadata_begin( struct ms_client* client, struct ms_pat
       
       SG_error("md_download_context_init( '%s' ) rc = %d\n", url, rc );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       ms_client_get_metadata_context_free( dlstate );
       return rc;
    }
@@ -121,7 +120,7 @@ static int ms_client_get_metadata_begin( struct ms_client* client, struct ms_pat
       
       md_download_context_free( dlctx, NULL );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       ms_client_get_metadata_context_free( dlstate );
       return rc;
    }
@@ -134,7 +133,7 @@ static int ms_client_get_metadata_begin( struct ms_client* client, struct ms_pat
       
       md_download_context_free( dlctx, NULL );
       
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       ms_client_get_metadata_context_free( dlstate );
       return rc;
    }
@@ -168,11 +167,8 @@ static int ms_client_get_metadata_end( struct ms_client* client, ms_path_t* path
       
       md_download_context_set_cls( dlctx, NULL );
 
-      // TODO connection pool
       md_download_context_unref_free( dlctx, &curl );
-      if( curl != NULL ) {
-         curl_easy_cleanup( curl );
-      }
+      md_curl_pool_release( client->curl_pool, curl );
 
       ms_client_get_metadata_context_free( dlstate );
       return rc;
@@ -185,12 +181,9 @@ static int ms_client_get_metadata_end( struct ms_client* client, ms_path_t* path
    rc = ms_client_listing_read_entry( client, dlctx, &ent, &listing_error );
    
    // done with the download 
-   // TODO connection pool
    md_download_context_set_cls( dlctx, NULL );
    md_download_context_unref_free( dlctx, &curl );
-   if( curl != NULL ) {
-      curl_easy_cleanup(curl);
-   }
+   md_curl_pool_release( client->curl_pool, curl );
 
    ms_client_get_metadata_context_free( dlstate );
    
@@ -460,7 +453,7 @@ static int ms_client_get_metadata( struct ms_client* client, ms_path_t* path, st
       }
    }
    
-   md_download_loop_cleanup( dlloop, NULL, NULL );
+   md_download_loop_cleanup( dlloop, md_curl_pool_release_func, client->curl_pool );
    md_download_loop_free( dlloop );
    SG_safe_free( dlloop );
    SG_safe_free( attempts );
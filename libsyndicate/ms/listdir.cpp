@@ -90,8 +90,7 @@ static int ms_client_get_dir_metadata_begin( struct ms_client* client, uint64_t
    }
    
    // set up CURL 
-   // TODO: connection pool 
-   curl = curl_easy_init();
+   curl = md_curl_pool_get( client->curl_pool, url );
    if( curl == NULL ) {
       
       SG_safe_free( dlstate );
@@ -104,7 +103,7 @@ static int ms_client_get_dir_metadata_begin( struct ms_client* client, uint64_t
    if( rc != 0 ) {
       
       // failed!
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       SG_safe_free( url );
       SG_safe_free( dlstate );
       return -ENOMEM;
@@ -119,7 +118,7 @@ static int ms_client_get_dir_metadata_begin( struct ms_client* client, uint64_t
       SG_safe_free( dlstate );
       SG_safe_free( url );
       SG_safe_free( auth_header );
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       return rc;
    }
    
@@ -134,7 +133,7 @@ static int ms_client_get_dir_metadata_begin( struct ms_client* client, uint64_t
       SG_safe_free( dlstate );
       SG_safe_free( url );
       SG_safe_free( auth_header );
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       return rc;
    }
    
@@ -149,7 +148,7 @@ static int ms_client_get_dir_metadata_begin( struct ms_client* client, uint64_t
       ms_client_get_dir_download_state_free( dlstate );
       dlstate = NULL;
 
-      curl_easy_cleanup( curl );
+      md_curl_pool_release( client->curl_pool, curl );
       
       return rc;
    }
@@ -158,6 +157,437 @@ static int ms_client_get_dir_metadata_begin( struct ms_client* client, uint64_t
 }
 
 
+// merge downloaded children into a directory listing.
+// duplicates are freed; the rest are moved into dir_listing.  children itself is not freed.
+// return 0 on success, and set *max_gen to the largest generation number merged
+// return -ENOMEM on OOM
+static int ms_client_dir_listing_merge( ms_client_dir_listing* dir_listing, struct md_entry* children, size_t num_children, int64_t* max_gen ) {
+   
+   int rc = 0;
+   int64_t biggest_generation = 0;
+   
+   for( unsigned int i = 0; i < num_children; i++ ) {
+      
+      uint64_t file_id = children[i].file_id;
+      
+      if( dir_listing->count( file_id ) > 0 ) {
+         
+         SG_warn("Duplicate child %" PRIX64 "\n", file_id );
+         md_entry_free( &children[i] );
+         continue;
+      }
+      
+      try {
+         
+         (*dir_listing)[ file_id ] = children[i];
+      }
+      catch( bad_alloc& ba ) {
+         
+         // free the rest
+         for( unsigned int j = i; j < num_children; j++ ) {
+            md_entry_free( &children[j] );
+         }
+         
+         rc = -ENOMEM;
+         break;
+      }
+      
+      // generation?
+      if( children[i].generation > biggest_generation ) {
+         
+         biggest_generation = children[i].generation;
+      }
+   }
+   
+   *max_gen = biggest_generation;
+   return rc;
+}
+
+
+// state for receiving a bulk listing: a stream of signed ms_reply frames, each prefixed with its varint32-encoded length
+struct ms_client_listdir_stream {
+   
+   struct ms_client* client;
+   
+   bool bulk;                           // set if the MS said this is a bulk listing
+   
+   char* buf;                           // unconsumed data (at most one partial frame)
+   size_t len;
+   size_t cap;
+   
+   ms_client_dir_listing* children;     // where to put the children
+   
+   int64_t next_index;                  // directory index to resume from (-1 if there are no more children)
+   int64_t max_gen;                     // largest generation seen
+   int num_frames;                      // number of frames processed
+   
+   int error;                           // first error encountered
+};
+
+
+// look for the bulk listing header in the MS's response 
+// always succeeds
+static size_t ms_client_listdir_stream_header_func( void* ptr, size_t size, size_t nmemb, void* userdata ) {
+   
+   struct ms_client_listdir_stream* stream = (struct ms_client_listdir_stream*)userdata;
+   
+   size_t len = size * nmemb;
+   char* data = (char*)ptr;
+   
+   // new response (i.e. we got redirected); forget what we saw before
+   if( len >= 5 && strncmp( data, "HTTP/", 5 ) == 0 ) {
+      
+      stream->bulk = false;
+      return len;
+   }
+   
+   if( md_header_value_offset( data, len, MS_CLIENT_BULK_LISTING_HEADER ) > 0 ) {
+      
+      stream->bulk = true;
+   }
+   
+   return len;
+}
+
+
+// decode a varint32 frame length at the start of buf
+// return the number of bytes in the varint on success, and set *frame_len
+// return 0 if buf does not yet hold the whole varint 
+// return -EBADMSG if the varint is malformed
+static int ms_client_listdir_stream_frame_len( char const* buf, size_t len, size_t* frame_len ) {
+   
+   uint64_t value = 0;
+   
+   for( size_t i = 0; i < 5; i++ ) {
+      
+      if( i >= len ) {
+         return 0;
+      }
+      
+      value |= ((uint64_t)(buf[i] & 0x7f)) << (7 * i);
+      
+      if( (buf[i] & 0x80) == 0 ) {
+         
+         *frame_len = value;
+         return i + 1;
+      }
+   }
+   
+   return -EBADMSG;
+}
+
+
+// process one bulk listing frame: verify it and merge its children
+// return 0 on success
+// return -ENOMEM on OOM 
+// return -EBADMSG if the frame could not be parsed or verified, or had no listing
+// return the MS's error code if it reported one
+static int ms_client_listdir_stream_frame( struct ms_client_listdir_stream* stream, char const* frame, size_t frame_len ) {
+   
+   int rc = 0;
+   int listing_error = 0;
+   ms::ms_reply reply;
+   struct md_entry* children = NULL;
+   size_t num_children = 0;
+   int64_t max_gen = 0;
+   
+   rc = ms_client_parse_reply( stream->client, &reply, frame, frame_len );
+   if( rc != 0 ) {
+      
+      SG_error("ms_client_parse_reply rc = %d\n", rc );
+      return rc;
+   }
+   
+   if( reply.error() != 0 ) {
+      
+      SG_error("MS RPC error code %d\n", reply.error() );
+      return reply.error() < 0 ? reply.error() : -EREMOTEIO;
+   }
+   
+   if( !reply.has_listing() || !reply.listing().has_next_index() ) {
+      
+      SG_error("%s", "MS replied without a bulk listing\n");
+      return -EBADMSG;
+   }
+   
+   stream->next_index = reply.listing().next_index();
+   
+   rc = ms_client_reply_read_entries( stream->client, &reply, &children, &num_children, &listing_error );
+   if( rc != 0 ) {
+      
+      SG_error("ms_client_reply_read_entries rc = %d\n", rc );
+      return rc;
+   }
+   
+   if( listing_error != MS_LISTING_NEW ) {
+      
+      SG_error("Bulk listing frame has listing_error = %d\n", listing_error );
+      
+      for( size_t i = 0; i < num_children; i++ ) {
+         md_entry_free( &children[i] );
+      }
+      
+      SG_safe_free( children );
+      return -EBADMSG;
+   }
+   
+   rc = ms_client_dir_listing_merge( stream->children, children, num_children, &max_gen );
+   
+   // NOTE: shallow free--we've copied the children into the listing
+   SG_safe_free( children );
+   
+   if( rc != 0 ) {
+      return rc;
+   }
+   
+   stream->max_gen = MAX( stream->max_gen, max_gen );
+   stream->num_frames++;
+   
+   return 0;
+}
+
+
+// consume bulk listing data as it arrives, processing each complete frame
+// return size * nmemb on success 
+// return 0 (aborting the transfer) on error, and record the error in the stream
+static size_t ms_client_listdir_stream_write_func( void* ptr, size_t size, size_t nmemb, void* userdata ) {
+   
+   struct ms_client_listdir_stream* stream = (struct ms_client_listdir_stream*)userdata;
+   
+   int rc = 0;
+   size_t len = size * nmemb;
+   size_t off = 0;
+   size_t frame_len = 0;
+   
+   if( !stream->bulk ) {
+      
+      // not a bulk listing; the caller will fall back to paged listing
+      return len;
+   }
+   
+   // buffer it
+   if( stream->len + len > stream->cap ) {
+      
+      size_t new_cap = MAX( stream->cap * 2, stream->len + len );
+      char* new_buf = (char*)realloc( stream->buf, new_cap );
+      
+      if( new_buf == NULL ) {
+         
+         stream->error = -ENOMEM;
+         return 0;
+      }
+      
+      stream->buf = new_buf;
+      stream->cap = new_cap;
+   }
+   
+   memcpy( stream->buf + stream->len, ptr, len );
+   stream->len += len;
+   
+   // process all complete frames 
+   while( off < stream->len ) {
+      
+      rc = ms_client_listdir_stream_frame_len( stream->buf + off, stream->len - off, &frame_len );
+      if( rc == 0 ) {
+         
+         // need more data 
+         break;
+      }
+      
+      if( rc < 0 || frame_len > MS_MAX_MSG_SIZE ) {
+         
+         SG_error("Invalid bulk listing frame (rc = %d, length = %zu)\n", rc, frame_len );
+         stream->error = -EBADMSG;
+         return 0;
+      }
+      
+      if( off + rc + frame_len > stream->len ) {
+         
+         // need more data 
+         break;
+      }
+      
+      off += rc;
+      
+      rc = ms_client_listdir_stream_frame( stream, stream->buf + off, frame_len );
+      if( rc != 0 ) {
+         
+         SG_error("ms_client_listdir_stream_frame rc = %d\n", rc );
+         stream->error = rc;
+         return 0;
+      }
+      
+      off += frame_len;
+   }
+   
+   // keep the partial frame
+   memmove( stream->buf, stream->buf + off, stream->len - off );
+   stream->len -= off;
+   
+   return len;
+}
+
+
+// fetch one bulk listing of a directory, starting at start_index, and merge the children into children.
+// frames are verified and merged as they arrive, so only one frame is buffered at a time.
+// return 0 on success, and set *next_index to the directory index to resume from (-1 if there are no more children) and *max_gen to the largest generation seen
+// return -ENOTSUP if the MS does not support bulk listings
+// return -ENOMEM on OOM 
+// return -EBADMSG if the MS sent back a malformed or unverifiable listing 
+// return -EPROTO on HTTP 400-level error 
+// return -EREMOTEIO on HTTP 500-level error
+// return other negative on download failure, or the MS's error code
+static int ms_client_listdir_bulk_download( struct ms_client* client, uint64_t parent_id, int64_t start_index, ms_client_dir_listing* children, int64_t* next_index, int64_t* max_gen ) {
+   
+   int rc = 0;
+   CURL* curl = NULL;
+   char* url = NULL;
+   char* auth_header = NULL;
+   long http_status = 0;
+   long os_errno = 0;
+   struct ms_client_listdir_stream stream;
+   
+   memset( &stream, 0, sizeof(struct ms_client_listdir_stream) );
+   
+   stream.client = client;
+   stream.children = children;
+   stream.next_index = -1;
+   
+   url = ms_client_file_listdir_bulk_url( client->url, ms_client_get_volume_id( client ), ms_client_volume_version( client ), ms_client_cert_version( client ), parent_id, start_index );
+   if( url == NULL ) {
+      return -ENOMEM;
+   }
+   
+   // connect 
+   curl = md_curl_pool_get( client->curl_pool, url );
+   if( curl == NULL ) {
+      
+      SG_safe_free( url );
+      return -ENOMEM;
+   }
+   
+   // generate auth header
+   rc = ms_client_auth_header( client, url, &auth_header );
+   if( rc != 0 ) {
+      
+      // failed!
+      md_curl_pool_release( client->curl_pool, curl );
+      SG_safe_free( url );
+      return -ENOMEM;
+   }
+   
+   ms_client_init_curl_handle( client, curl, url, auth_header );
+   
+   curl_easy_setopt( curl, CURLOPT_HEADERFUNCTION, ms_client_listdir_stream_header_func );
+   curl_easy_setopt( curl, CURLOPT_WRITEHEADER, &stream );
+   curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, ms_client_listdir_stream_write_func );
+   curl_easy_setopt( curl, CURLOPT_WRITEDATA, &stream );
+   
+   // run 
+   rc = curl_easy_perform( curl );
+   
+   curl_easy_getinfo( curl, CURLINFO_RESPONSE_CODE, &http_status );
+   curl_easy_getinfo( curl, CURLINFO_OS_ERRNO, &os_errno );
+   
+   md_curl_pool_release( client->curl_pool, curl );
+   SG_safe_free( auth_header );
+   
+   if( stream.error != 0 ) {
+      
+      // failed to process the listing 
+      SG_error("bulk listing '%s': error %d\n", url, stream.error );
+      rc = stream.error;
+   }
+   else if( !stream.bulk && (http_status == 200 || http_status == 400) ) {
+      
+      // the MS doesn't know about bulk listings: it either ignored the bulk argument, or rejected it.
+      // any other error (i.e. 401, 403, 404) is a real error, and says nothing about what the MS supports.
+      SG_debug("MS does not support bulk listings (HTTP %ld)\n", http_status );
+      rc = -ENOTSUP;
+   }
+   else if( rc != 0 || http_status >= 400 ) {
+      
+      SG_error("curl_easy_perform('%s') rc = %d, HTTP status = %ld, os_errno = %ld\n", url, rc, http_status, os_errno );
+      
+      rc = md_download_interpret_errors( http_status, rc, os_errno );
+      
+      if( rc <= -400 && rc >= -499 ) {
+         rc = -EPROTO;
+      }
+      else if( rc <= -500 ) {
+         rc = -EREMOTEIO;
+      }
+   }
+   else if( stream.len != 0 || stream.num_frames == 0 ) {
+      
+      // truncated, or empty
+      SG_error("bulk listing '%s': %zu trailing bytes, %d frames\n", url, stream.len, stream.num_frames );
+      rc = -EBADMSG;
+   }
+   else {
+      
+      *next_index = stream.next_index;
+      *max_gen = stream.max_gen;
+   }
+   
+   SG_safe_free( stream.buf );
+   SG_safe_free( url );
+   
+   return rc;
+}
+
+
+// download a directory's children in bulk, following next_index until there are no more children, or we have num_children of them.
+// return 0 on success, and set *query_count to the number of requests made
+// return -ENOTSUP if the MS does not support bulk listings (nothing will have been merged into children)
+// return -EPROTO if the MS stopped serving bulk pages partway through
+// return -EBADMSG if a page's next index does not advance past its start index
+// return negative on download failure, or corruption (children will hold partial results)
+static int ms_client_get_dir_metadata_bulk( struct ms_client* client, uint64_t parent_id, int64_t num_children, ms_client_dir_listing* children, int* query_count ) {
+   
+   int rc = 0;
+   int64_t start_index = 0;
+   int64_t next_index = 0;
+   int64_t max_gen = 0;
+   
+   while( start_index >= 0 && (int64_t)children->size() < num_children ) {
+      
+      (*query_count)++;
+      
+      rc = ms_client_listdir_bulk_download( client, parent_id, start_index, children, &next_index, &max_gen );
+      if( rc == -ENOTSUP && start_index > 0 ) {
+         
+         // the MS served bulk pages a moment ago, so this is not a matter of support
+         SG_error("bulk listdir %" PRIX64 ": MS stopped serving bulk listings at index %" PRId64 "\n", parent_id, start_index );
+         rc = -EPROTO;
+      }
+      
+      if( rc != 0 ) {
+         
+         if( rc != -ENOTSUP ) {
+            SG_error("ms_client_listdir_bulk_download( %" PRIX64 ", %" PRId64 " ) rc = %d\n", parent_id, start_index, rc );
+         }
+         
+         break;
+      }
+      
+      SG_debug("bulk listdir %" PRIX64 ": %zu children so far, next index is %" PRId64 "\n", parent_id, children->size(), next_index );
+      
+      if( next_index >= 0 && next_index <= start_index ) {
+         
+         // we'd loop forever
+         SG_error("bulk listdir %" PRIX64 ": next index %" PRId64 " does not advance past %" PRId64 "\n", parent_id, next_index, start_index );
+         rc = -EBADMSG;
+         break;
+      }
+      
+      start_index = next_index;
+   }
+   
+   return rc;
+}
+
+
 // finish up getting directory metadata, and free up the download handle
 // return 0 on success, and set *batch_id to this download's batch
 //   *ret_num_children to the number of children downloaded, and *max_gen to be the largest generation number seen.
@@ -170,8 +600,6 @@ static int ms_client_get_dir_metadata_end( struct ms_client* client, uint64_t pa
    size_t num_children = 0;
    CURL* curl = NULL;
    
-   int64_t biggest_generation = 0;
-   
    struct ms_client_get_dir_download_state* dlstate = (struct ms_client_get_dir_download_state*)md_download_context_get_cls( dlctx );
    md_download_context_set_cls( dlctx, NULL );
 
@@ -185,11 +613,8 @@ static int ms_client_get_dir_metadata_end( struct ms_client* client, uint64_t pa
          SG_error("ms_client_download_parse_errors( %p ) rc = %d\n", dlctx, rc );
       }
       
-      // TODO: connection pool
       md_download_context_unref_free( dlctx, &curl );
-      if( curl != NULL ) {
-          curl_easy_cleanup( curl );
-      }
+      md_curl_pool_release( client->curl_pool, curl );
 
       ms_client_get_dir_download_state_free( dlstate );
       dlstate = NULL;
@@ -201,11 +626,8 @@ static int ms_client_get_dir_metadata_end( struct ms_client* client, uint64_t pa
    rc = ms_client_listing_read_entries( client, dlctx, &children, &num_children, &listing_error );
    
    // done with the download
-   // TODO: connection pool
    md_download_context_unref_free( dlctx, &curl );
-   if( curl != NULL ) {
-      curl_easy_cleanup( curl );
-   }
+   md_curl_pool_release( client->curl_pool, curl );
 
    ms_client_get_dir_download_state_free( dlstate );
    dlstate = NULL;
@@ -227,44 +649,56 @@ static int ms_client_get_dir_metadata_end( struct ms_client* client, uint64_t pa
    // merge children in 
    for( unsigned int i = 0; i < num_children; i++ ) {
       
-      uint64_t file_id = children[i].file_id;
-      
-      SG_debug("%p: %" PRIX64 "\n", dlctx, file_id );
-      
-      if( dir_listing->count( file_id ) > 0 ) {
-         
-         SG_warn("Duplicate child %" PRIX64 "\n", file_id );
-         md_entry_free( &children[i] );
-         continue;
-      }
-      
-      try {
-         
-         (*dir_listing)[ file_id ] = children[i];
-      }
-      catch( bad_alloc& ba ) {
-         rc = -ENOMEM;
-         break;
-      }
-      
-      // generation?
-      if( children[i].generation > biggest_generation ) {
-         
-         biggest_generation = children[i].generation;
-      }
+      SG_debug("%p: %" PRIX64 "\n", dlctx, children[i].file_id );
    }
    
+   ms_client_dir_listing_merge( dir_listing, children, num_children, max_gen );
+   
    // NOTE: shallow free--we've copied the children into dir_listing
    SG_safe_free( children );
    
    *ret_num_children = num_children;
-   *max_gen = biggest_generation;
    
    return 0;
 }
 
+// coalesce downloaded children into results.
+// rc is the download's status, and is preserved if it is non-zero.
+// return rc on success
+// return -ENOMEM on OOM, if rc is 0
+static int ms_client_dir_listing_coalesce( ms_client_dir_listing* children, int query_count, int rc, struct ms_client_multi_result* results ) {
+   
+   int i = 0;
+   struct md_entry* ents = SG_CALLOC( struct md_entry, children->size() );
+   
+   if( ents == NULL ) {
+      
+      if( rc == 0 ) {
+         rc = -ENOMEM;
+      }
+      
+      // preserve download error, if need be
+      return rc;
+   }
+   
+   for( ms_client_dir_listing::iterator itr = children->begin(); itr != children->end(); itr++ ) {
+      
+      ents[i] = itr->second;
+      i++;
+   }
+   
+   // populate results 
+   results->ents = ents;
+   results->reply_error = 0;
+   results->num_processed = query_count;
+   results->num_ents = children->size();
+   
+   return rc;
+}
+
 // download metadata for a directory, in one of two ways:
-// LISTDIR: fetch num_children entries in parallel by requesting disjoint ranges of them by index, in the range [0, dir_capacity].
+// LISTDIR: fetch num_children entries in bulk (see ms_client_get_dir_metadata_bulk), or if the MS does not support that,
+//   in parallel by requesting disjoint ranges of them by index, in the range [0, dir_capacity].
 // DIFFDIR: query by least unknown generation number until we have num_children entries, or the number of entries in a downloaded batch becomes 0 (i.e. no more entries known).
 // in both cases, stop once the number of children is exceeded.
 // if least_unknown_generation >= 0, then we will DIFFDIR.
@@ -296,8 +730,6 @@ static int ms_client_get_dir_metadata( struct ms_client* client, uint64_t parent
 
    int i = 0;
    
-   struct md_entry* ents = NULL;
-   
    // sanity check 
    if( least_unknown_generation < 0 && dir_capacity < 0 ) {
       return -EINVAL;
@@ -311,6 +743,32 @@ static int ms_client_get_dir_metadata( struct ms_client* client, uint64_t parent
    
    SG_debug("listdir %" PRIX64 ", num_children = %" PRId64 ", l.u.g. = %" PRId64 ", dir_capacity = %" PRId64 "\n", parent_id, num_children, least_unknown_generation, dir_capacity );
    
+   if( dir_capacity >= 0 ) {
+      
+      // try to get the whole listing in bulk, instead of page by page
+      ms_client_rlock( client );
+      bool bulk_listing = client->bulk_listing;
+      ms_client_unlock( client );
+      
+      if( bulk_listing ) {
+         
+         rc = ms_client_get_dir_metadata_bulk( client, parent_id, num_children, &children, &query_count );
+         if( rc != -ENOTSUP ) {
+            
+            return ms_client_dir_listing_coalesce( &children, query_count, rc, results );
+         }
+         
+         // fall back to paging, and don't bother trying again
+         SG_warn("MS does not support bulk listings; falling back to %d-entry pages\n", client->page_size );
+         
+         ms_client_wlock( client );
+         client->bulk_listing = false;
+         ms_client_unlock( client );
+         
+         rc = 0;
+      }
+   }
+   
    try {
       if( least_unknown_generation >= 0 ) {
          
@@ -470,7 +928,7 @@ static int ms_client_get_dir_metadata( struct ms_client* client, uint64_t parent
       }
    }
    
-   md_download_loop_cleanup( dlloop, NULL, NULL );
+   md_download_loop_cleanup( dlloop, md_curl_pool_release_func, client->curl_pool );
    md_download_loop_free( dlloop );
    SG_safe_free( dlloop );
    
@@ -478,32 +936,7 @@ static int ms_client_get_dir_metadata( struct ms_client* client, uint64_t parent
       rc = 0;
    }
    
-   // coalesce what we have into results
-   ents = SG_CALLOC( struct md_entry, children.size() );
-   if( ents == NULL ) {
-      
-      if( rc == 0 ) {
-         rc = -ENOMEM;
-      }
-      
-      // preserve download error, if need be
-      return rc;
-   }
-   
-   i = 0;
-   for( ms_client_dir_listing::iterator itr = children.begin(); itr != children.end(); itr++ ) {
-      
-      ents[i] = itr->second;
-      i++;
-   }
-   
-   // populate results 
-   results->ents = ents;
-   results->reply_error = 0;
-   results->num_processed = query_count;
-   results->num_ents = children.size();
-   
-   return rc;
+   return ms_client_dir_listing_coalesce( &children, query_count, rc, results );
 }
 
 
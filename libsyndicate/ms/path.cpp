@@ -174,9 +174,6 @@ int ms_client_listing_read_entries( struct ms_client* client, struct md_download
    char* dlbuf = NULL;
    off_t dlbuf_len;
    ms::ms_reply reply;
-   struct ms_listing listing;
-   
-   memset( &listing, 0, sizeof(struct ms_listing) );
    
    rc = md_download_context_get_buffer( dlctx, &dlbuf, &dlbuf_len );
    if( rc != 0 ) {
@@ -195,18 +192,34 @@ int ms_client_listing_read_entries( struct ms_client* client, struct md_download
       return rc;
    }
    
+   return ms_client_reply_read_entries( client, &reply, ents, num_ents, listing_error );
+}
+
+// extract multiple entries from an already-parsed and verified reply (see ms_client_parse_reply)
+// return 0 on success, and set *ents to the entries and *num_ents to the number of entries.
+// return -ENOMEM for OOM
+// return -EBADMSG for invalid listing status, or an unverifiable entry
+// return -ENODATA if the listing error is non-zero
+// in all cases, *listing_error will be set to the listing error if we could parse it.  It will be negative on error, otherwise positive.
+int ms_client_reply_read_entries( struct ms_client* client, ms::ms_reply* reply, struct md_entry** ents, size_t* num_ents, int* listing_error ) {
+   
+   int rc = 0;
+   struct ms_listing listing;
+   
+   memset( &listing, 0, sizeof(struct ms_listing) );
+   
    // get listing data 
-   rc = ms_client_parse_listing( client, &listing, &reply );
+   rc = ms_client_parse_listing( client, &listing, reply );
    if( rc != 0 ) {
       
-      SG_error("ms_client_parse_listing(%p) rc = %d\n", dlctx, rc );
+      SG_error("ms_client_parse_listing(%p) rc = %d\n", reply, rc );
       return rc;
    }
    
    // check error status 
    if( listing.error != 0 ) {
       
-      SG_error("listing of %p: error == %d\n", dlctx, listing.error );
+      SG_error("listing of %p: error == %d\n", reply, listing.error );
       ms_client_free_listing( &listing );
       
       *listing_error = listing.error;
@@ -277,7 +290,7 @@ int ms_client_listing_read_entries( struct ms_client* client, struct md_download
    else {
       
       // invalid status 
-      SG_error("download %p: Invalid listing status %d\n", dlctx, listing.status );
+      SG_error("reply %p: Invalid listing status %d\n", reply, listing.status );
       ms_client_free_listing( &listing );
       return -EBADMSG;
    }
@@ -69,6 +69,7 @@ int ms_client_path_download_ent_tail( struct ms_path_ent* path_ent, uint64_t vol
 // list parsing
 int ms_client_listing_read_entry( struct ms_client* client, struct md_download_context* dlctx, struct md_entry* ent, int* listing_error );
 int ms_client_listing_read_entries( struct ms_client* client, struct md_download_context* dlctx, struct md_entry** ents, size_t* num_ents, int* listing_error );
+int ms_client_reply_read_entries( struct ms_client* client, ms::ms_reply* reply, struct md_entry** ents, size_t* num_ents, int* listing_error );
 
 // memory management
 void ms_client_free_listing( struct ms_listing* listing );
@@ -197,6 +197,35 @@ char* ms_client_file_listdir_url( char const* ms_url, uint64_t volume_id, uint64
    return volume_file_url;
 }
 
+// LISTDIR url for a bulk listing, starting at the given directory index
+// return the URL on success 
+// return NULL on OOM
+char* ms_client_file_listdir_bulk_url( char const* ms_url, uint64_t volume_id, uint64_t volume_version, uint64_t cert_version, uint64_t file_id, int64_t start_index ) {
+   
+   char volume_id_str[50];
+   char volume_version_str[50];
+   char cert_version_str[50];
+   char file_id_str[50];
+   char start_index_str[50];
+   
+   sprintf( volume_id_str, "%" PRIu64, volume_id );
+   sprintf( volume_version_str, "%" PRIu64, volume_version );
+   sprintf( cert_version_str, "%" PRIu64, cert_version );
+   sprintf( file_id_str, "%" PRIX64, file_id );
+   sprintf( start_index_str, "%" PRId64, start_index );
+   
+   char* volume_file_url = SG_CALLOC( char, strlen(ms_url) + 1 + strlen("/FILE/LISTDIR/") + 1 + strlen(volume_id_str) + 1 + strlen(volume_version_str) + 1 + strlen(cert_version_str) + 1 + 
+                                            strlen(file_id_str) + 1 + strlen("?bulk=") + strlen(start_index_str) + 1 );
+   
+   if( volume_file_url == NULL ) {
+      return NULL;
+   }
+   
+   sprintf( volume_file_url, "%s/FILE/LISTDIR/%s.%s.%s/%s?bulk=%s", ms_url, volume_id_str, volume_version_str, cert_version_str, file_id_str, start_index_str );
+   
+   return volume_file_url;
+}
+
 // FETCHXATTRS url 
 // return the URL on success 
 // return NULL on OOM
@@ -267,59 +267,77 @@ int ms_client_peek_vacuum_log( struct ms_client* client, uint64_t volume_id, uin
 }
 
 
-// remove a vacuum log entry 
-// NOTE: any gateway can send this, as long as it is the current coordinator of the file.
-// writer_id identifies the gateway that performed the associated write; it can be obtained from the manifest or the vacuum log head.
+// set up a signed request to remove a vacuum log entry.
+// ent is a sentinel entry that will carry the request's information; free it with md_entry_free once the request has been sent.
 // return 0 on success
 // return -ENOMEM on OOM
-// return -EPROTO on MS RPC protocol-level error or HTTP 400-level error
-// return negative on RPC error (see ms_client_single_rpc)
-int ms_client_remove_vacuum_log_entry( struct ms_client* client, uint64_t volume_id, uint64_t writer_id, uint64_t file_id, uint64_t file_version, int64_t manifest_mtime_sec, int32_t manifest_mtime_nsec ) {
+static int ms_client_remove_vacuum_log_entry_request( struct ms_client* client, uint64_t volume_id, uint64_t writer_id, uint64_t file_id, uint64_t file_version, int64_t manifest_mtime_sec, int32_t manifest_mtime_nsec,
+                                                      struct md_entry* ent, struct ms_client_request* request ) {
    
-   struct ms_client_request request;
-   struct ms_client_request_result result;
-   struct md_entry ent;
    int rc = 0;
-   
    unsigned char* ent_sig = NULL;
    size_t ent_sig_len = 0;
    
-   memset( &request, 0, sizeof(struct ms_client_request) );
-   memset( &result, 0, sizeof(struct ms_client_request_result) );
-   memset( &ent, 0, sizeof(ent) );
+   memset( request, 0, sizeof(struct ms_client_request) );
+   memset( ent, 0, sizeof(struct md_entry) );
    
    // sentinel values
-   ent.name = SG_strdup_or_null("");
+   ent->name = SG_strdup_or_null("");
    
-   if( ent.name == NULL ) {
-      SG_safe_free( ent.name );
+   if( ent->name == NULL ) {
       return -ENOMEM;
    }
    
    // sentinel md_entry with all of our given information
-   ent.coordinator = writer_id;
-   ent.volume = volume_id;
-   ent.file_id = file_id;
-   ent.version = file_version;
-   ent.manifest_mtime_sec = manifest_mtime_sec;
-   ent.manifest_mtime_nsec = manifest_mtime_nsec;
+   ent->coordinator = writer_id;
+   ent->volume = volume_id;
+   ent->file_id = file_id;
+   ent->version = file_version;
+   ent->manifest_mtime_sec = manifest_mtime_sec;
+   ent->manifest_mtime_nsec = manifest_mtime_nsec;
    
    // sign...
-   rc = md_entry_sign( client->gateway_key, &ent, &ent_sig, &ent_sig_len );
+   rc = md_entry_sign( client->gateway_key, ent, &ent_sig, &ent_sig_len );
    if( rc != 0 ) {
       
-      md_entry_free( &ent );
+      md_entry_free( ent );
       return -ENOMEM;
    }
    
-   ent.ent_sig = ent_sig;
-   ent.ent_sig_len = ent_sig_len;
+   ent->ent_sig = ent_sig;
+   ent->ent_sig_len = ent_sig_len;
    
    // fill in the request
-   request.op = ms::ms_request::VACUUM;
-   request.flags = 0;
+   request->op = ms::ms_request::VACUUM;
+   request->flags = 0;
+   
+   request->ent = ent;
+   
+   return 0;
+}
+
+
+// remove a vacuum log entry 
+// NOTE: any gateway can send this, as long as it is the current coordinator of the file.
+// writer_id identifies the gateway that performed the associated write; it can be obtained from the manifest or the vacuum log head.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -EPROTO on MS RPC protocol-level error or HTTP 400-level error
+// return negative on RPC error (see ms_client_single_rpc)
+int ms_client_remove_vacuum_log_entry( struct ms_client* client, uint64_t volume_id, uint64_t writer_id, uint64_t file_id, uint64_t file_version, int64_t manifest_mtime_sec, int32_t manifest_mtime_nsec ) {
    
-   request.ent = &ent;
+   struct ms_client_request request;
+   struct ms_client_request_result result;
+   struct md_entry ent;
+   int rc = 0;
+   
+   memset( &result, 0, sizeof(struct ms_client_request_result) );
+   
+   rc = ms_client_remove_vacuum_log_entry_request( client, volume_id, writer_id, file_id, file_version, manifest_mtime_sec, manifest_mtime_nsec, &ent, &request );
+   if( rc != 0 ) {
+      
+      return rc;
+   }
    
    rc = ms_client_single_rpc( client, &request, &result );
    
@@ -342,73 +360,184 @@ int ms_client_remove_vacuum_log_entry( struct ms_client* client, uint64_t volume
 }
 
 
-// Append the vacuum log entry for a file.
-// Do this before replicating the actual data.
-// return 0 on success 
+// remove a batch of vacuum log entries, sending up to client->max_request_batch removals per request to the MS.
+// each entry's writer_id identifies the gateway that performed the associated write (as in ms_client_remove_vacuum_log_entry); affected blocks are ignored.
+// rcs[i] is set to the outcome of removing ves[i]:  0 on success, -EPROTO on MS RPC protocol-level error, -EAGAIN if it was not attempted, or the MS's error code.
+// return 0 if every request to the MS was sent (check rcs for each entry's outcome)
+// return -ENOMEM on OOM
+// return negative on RPC error (see ms_client_multi_rpc); entries that were not sent will have rcs[i] == -EAGAIN
+int ms_client_remove_vacuum_log_entries( struct ms_client* client, struct ms_vacuum_entry* ves, size_t num_ves, int* rcs ) {
+   
+   int rc = 0;
+   size_t batch_size = (client->max_request_batch > 0 ? (size_t)client->max_request_batch : 1);
+   struct ms_client_request* requests = NULL;
+   struct ms_client_request_result* results = NULL;
+   struct md_entry* ents = NULL;
+   
+   for( size_t i = 0; i < num_ves; i++ ) {
+      rcs[i] = -EAGAIN;
+   }
+   
+   requests = SG_CALLOC( struct ms_client_request, batch_size );
+   results = SG_CALLOC( struct ms_client_request_result, batch_size );
+   ents = SG_CALLOC( struct md_entry, batch_size );
+   
+   if( requests == NULL || results == NULL || ents == NULL ) {
+      
+      SG_safe_free( requests );
+      SG_safe_free( results );
+      SG_safe_free( ents );
+      return -ENOMEM;
+   }
+   
+   for( size_t start = 0; start < num_ves; start += batch_size ) {
+      
+      size_t num_requests = 0;
+      
+      for( size_t i = start; i < num_ves && i < start + batch_size; i++ ) {
+         
+         rc = ms_client_remove_vacuum_log_entry_request( client, ves[i].volume_id, ves[i].writer_id, ves[i].file_id, ves[i].file_version, ves[i].manifest_mtime_sec, ves[i].manifest_mtime_nsec,
+                                                         &ents[num_requests], &requests[num_requests] );
+         if( rc != 0 ) {
+            break;
+         }
+         
+         num_requests++;
+      }
+      
+      if( rc == 0 ) {
+         
+         memset( results, 0, sizeof(struct ms_client_request_result) * num_requests );
+         rc = ms_client_multi_rpc( client, requests, num_requests, results );
+      }
+      
+      for( size_t i = 0; i < num_requests; i++ ) {
+         
+         if( rc == 0 ) {
+            
+            if( results[i].reply_error != 0 ) {
+               // protocol-level error 
+               rcs[start + i] = -EPROTO;
+            }
+            else {
+               rcs[start + i] = results[i].rc;
+            }
+         }
+         
+         md_entry_free( &ents[i] );       // frees signature as well
+      }
+      
+      if( rc != 0 ) {
+         
+         SG_error("ms_client_multi_rpc(%zu vacuum log entries) rc = %d\n", num_requests, rc );
+         break;
+      }
+   }
+   
+   SG_safe_free( requests );
+   SG_safe_free( results );
+   SG_safe_free( ents );
+   
+   return rc;
+}
+
+
+// set up a signed request to append a vacuum log entry.
+// ent is a sentinel entry that will carry the request's information, and *vacuum_ticket_sig will hold the vacuum ticket's signature.
+// once the request has been sent, free them with ms_client_append_vacuum_log_entry_request_free.
+// return 0 on success
 // return -ENOMEM on OOM 
-// return negative on RPC error 
-int ms_client_append_vacuum_log_entry( struct ms_client* client, struct ms_vacuum_entry* ve ) {
+// return negative on failure to sign the vacuum ticket
+static int ms_client_append_vacuum_log_entry_request( struct ms_client* client, struct ms_vacuum_entry* ve, struct md_entry* ent, unsigned char** vacuum_ticket_sig, struct ms_client_request* request ) {
    
-   // generate our update 
-   struct md_entry ent;
-   struct ms_client_request request;
-   struct ms_client_request_result result;
    int rc = 0;
    
    unsigned char* ent_sig = NULL;
    size_t ent_sig_len = 0;
    
-   unsigned char* vacuum_ticket_sig = NULL;
    size_t vacuum_ticket_sig_len = 0;
    
-   memset( &ent, 0, sizeof(ent) );
-   memset( &request, 0, sizeof(struct ms_client_request) );
-   memset( &result, 0, sizeof(struct ms_client_request_result) );
+   memset( ent, 0, sizeof(struct md_entry) );
+   memset( request, 0, sizeof(struct ms_client_request) );
    
    // get signature 
-   rc = ms_client_sign_vacuum_ticket( client, ve, &vacuum_ticket_sig, &vacuum_ticket_sig_len );
+   rc = ms_client_sign_vacuum_ticket( client, ve, vacuum_ticket_sig, &vacuum_ticket_sig_len );
    if( rc != 0 ) {
       
       return rc;
    }
    
    // sentinel md_entry with all of our given information
-   ent.volume = ve->volume_id;
-   ent.coordinator = ve->writer_id;     // 'coordinator' carries *this* gateway's ID to the vacuum log
-   ent.file_id = ve->file_id;
-   ent.version = ve->file_version;
-   ent.manifest_mtime_sec = ve->manifest_mtime_sec;
-   ent.manifest_mtime_nsec = ve->manifest_mtime_nsec;
+   ent->volume = ve->volume_id;
+   ent->coordinator = ve->writer_id;     // 'coordinator' carries *this* gateway's ID to the vacuum log
+   ent->file_id = ve->file_id;
+   ent->version = ve->file_version;
+   ent->manifest_mtime_sec = ve->manifest_mtime_sec;
+   ent->manifest_mtime_nsec = ve->manifest_mtime_nsec;
            
    // sign...
-   rc = md_entry_sign( client->gateway_key, &ent, &ent_sig, &ent_sig_len );
+   rc = md_entry_sign( client->gateway_key, ent, &ent_sig, &ent_sig_len );
    if( rc != 0 ) {
       
-      md_entry_free( &ent );
-      SG_safe_free( vacuum_ticket_sig );
+      md_entry_free( ent );
+      SG_safe_free( *vacuum_ticket_sig );
       return -ENOMEM;
    }
    
-   ent.ent_sig = ent_sig;
-   ent.ent_sig_len = ent_sig_len;
+   ent->ent_sig = ent_sig;
+   ent->ent_sig_len = ent_sig_len;
    
    // fill in the request
-   request.op = ms::ms_request::VACUUMAPPEND;
-   request.flags = 0;
+   request->op = ms::ms_request::VACUUMAPPEND;
+   request->flags = 0;
    
-   request.ent = &ent;
-   request.affected_blocks = ve->affected_blocks;
-   request.num_affected_blocks = ve->num_affected_blocks;
-   request.vacuum_signature = vacuum_ticket_sig;
-   request.vacuum_signature_len = vacuum_ticket_sig_len;
+   request->ent = ent;
+   request->affected_blocks = ve->affected_blocks;
+   request->num_affected_blocks = ve->num_affected_blocks;
+   request->vacuum_signature = *vacuum_ticket_sig;
+   request->vacuum_signature_len = vacuum_ticket_sig_len;
    
-   rc = ms_client_single_rpc( client, &request, &result );
+   return 0;
+}
+
+
+// free up the state for a sent vacuum log append request 
+static void ms_client_append_vacuum_log_entry_request_free( struct md_entry* ent, unsigned char** vacuum_ticket_sig, struct ms_client_request* request ) {
    
-   ent.name = NULL;
-   md_entry_free( &ent );       // frees signature as well
+   ent->name = NULL;
+   md_entry_free( ent );       // frees signature as well
+
+   SG_safe_free( *vacuum_ticket_sig );
+   request->vacuum_signature = NULL;
+}
 
-   SG_safe_free( vacuum_ticket_sig );
-   request.vacuum_signature = NULL;
+
+// Append the vacuum log entry for a file.
+// Do this before replicating the actual data.
+// return 0 on success 
+// return -ENOMEM on OOM 
+// return negative on RPC error 
+int ms_client_append_vacuum_log_entry( struct ms_client* client, struct ms_vacuum_entry* ve ) {
+   
+   // generate our update 
+   struct md_entry ent;
+   struct ms_client_request request;
+   struct ms_client_request_result result;
+   int rc = 0;
+   
+   unsigned char* vacuum_ticket_sig = NULL;
+   
+   memset( &result, 0, sizeof(struct ms_client_request_result) );
+   
+   rc = ms_client_append_vacuum_log_entry_request( client, ve, &ent, &vacuum_ticket_sig, &request );
+   if( rc != 0 ) {
+      
+      return rc;
+   }
+   
+   rc = ms_client_single_rpc( client, &request, &result );
+   
+   ms_client_append_vacuum_log_entry_request_free( &ent, &vacuum_ticket_sig, &request );
    
    if( rc != 0 ) {
       return rc;
@@ -427,3 +556,88 @@ int ms_client_append_vacuum_log_entry( struct ms_client* client, struct ms_vacuu
 }
 
 
+// Append a batch of vacuum log entries, sending up to client->max_request_batch appends per request to the MS.
+// Do this before replicating the actual data.
+// rcs[i] is set to the outcome of appending ves[i]:  0 on success, -EPROTO on MS RPC protocol-level error, -EAGAIN if it was not attempted, or the MS's error code.
+// return 0 if every request to the MS was sent (check rcs for each entry's outcome)
+// return -ENOMEM on OOM
+// return negative on RPC error (see ms_client_multi_rpc); entries that were not sent will have rcs[i] == -EAGAIN
+int ms_client_append_vacuum_log_entries( struct ms_client* client, struct ms_vacuum_entry* ves, size_t num_ves, int* rcs ) {
+   
+   int rc = 0;
+   size_t batch_size = (client->max_request_batch > 0 ? (size_t)client->max_request_batch : 1);
+   struct ms_client_request* requests = NULL;
+   struct ms_client_request_result* results = NULL;
+   struct md_entry* ents = NULL;
+   unsigned char** vacuum_ticket_sigs = NULL;
+   
+   for( size_t i = 0; i < num_ves; i++ ) {
+      rcs[i] = -EAGAIN;
+   }
+   
+   requests = SG_CALLOC( struct ms_client_request, batch_size );
+   results = SG_CALLOC( struct ms_client_request_result, batch_size );
+   ents = SG_CALLOC( struct md_entry, batch_size );
+   vacuum_ticket_sigs = SG_CALLOC( unsigned char*, batch_size );
+   
+   if( requests == NULL || results == NULL || ents == NULL || vacuum_ticket_sigs == NULL ) {
+      
+      SG_safe_free( requests );
+      SG_safe_free( results );
+      SG_safe_free( ents );
+      SG_safe_free( vacuum_ticket_sigs );
+      return -ENOMEM;
+   }
+   
+   for( size_t start = 0; start < num_ves; start += batch_size ) {
+      
+      size_t num_requests = 0;
+      
+      for( size_t i = start; i < num_ves && i < start + batch_size; i++ ) {
+         
+         rc = ms_client_append_vacuum_log_entry_request( client, &ves[i], &ents[num_requests], &vacuum_ticket_sigs[num_requests], &requests[num_requests] );
+         if( rc != 0 ) {
+            break;
+         }
+         
+         num_requests++;
+      }
+      
+      if( rc == 0 ) {
+         
+         memset( results, 0, sizeof(struct ms_client_request_result) * num_requests );
+         rc = ms_client_multi_rpc( client, requests, num_requests, results );
+      }
+      
+      for( size_t i = 0; i < num_requests; i++ ) {
+         
+         if( rc == 0 ) {
+            
+            if( results[i].reply_error != 0 ) {
+               // protocol-level error 
+               rcs[start + i] = -EPROTO;
+            }
+            else {
+               rcs[start + i] = results[i].rc;
+            }
+         }
+         
+         ms_client_append_vacuum_log_entry_request_free( &ents[i], &vacuum_ticket_sigs[i], &requests[i] );
+      }
+      
+      if( rc != 0 ) {
+         
+         SG_error("ms_client_multi_rpc(%zu vacuum log entries) rc = %d\n", num_requests, rc );
+         break;
+      }
+   }
+   
+   SG_safe_free( requests );
+   SG_safe_free( results );
+   SG_safe_free( ents );
+   SG_safe_free( vacuum_ticket_sigs );
+   
+   return rc;
+}
+
+
@@ -50,7 +50,9 @@ int ms_client_verify_vacuum_ticket( struct ms_client* client, ms::ms_vacuum_tick
 
 int ms_client_peek_vacuum_log( struct ms_client* client, uint64_t volume_id, uint64_t file_id, struct ms_vacuum_entry* ve );
 int ms_client_remove_vacuum_log_entry( struct ms_client* client, uint64_t volume_id, uint64_t writer_id, uint64_t file_id, uint64_t file_version, int64_t manifest_mtime_sec, int32_t manifest_mtime_nsec );
+int ms_client_remove_vacuum_log_entries( struct ms_client* client, struct ms_vacuum_entry* ves, size_t num_ves, int* rcs );
 int ms_client_append_vacuum_log_entry( struct ms_client* client, struct ms_vacuum_entry* ve );
+int ms_client_append_vacuum_log_entries( struct ms_client* client, struct ms_vacuum_entry* ves, size_t num_ves, int* rcs );
 
 }
 
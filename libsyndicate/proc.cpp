@@ -18,8 +18,14 @@
 
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <signal.h>
 
+// map request IDs to the calls waiting for their replies
+typedef map< uint64_t, struct SG_proc_call* > SG_proc_pending_t;
+
 struct SG_proc {
    
    bool dead;                   // set to true if the process is dead
@@ -35,6 +41,21 @@ struct SG_proc {
    char* exec_arg;              // arg to feed
    char** exec_env;             // environment variables
 
+   struct timespec acquired_at; // when this process last became busy (CLOCK_MONOTONIC)
+   struct timespec idle_since;  // when this process last became idle (CLOCK_MONOTONIC)
+   int inflight;                // number of callers that have acquired this process (guarded by the group lock)
+   int max_inflight;            // how many callers may acquire this process at once (1 unless framed)
+
+   // framed protocol (negotiated in SG_proc_start)
+   bool framed;                 // if true, requests and replies are tagged with request IDs, and many can be in flight
+   pthread_t reader;            // thread that reads replies and hands them to their callers
+   bool reader_running;         // set if reader was started 
+   bool reader_done;            // set once the reader stops (i.e. the worker died or misbehaved)
+   pthread_mutex_t write_lock;  // serializes request frames 
+   pthread_mutex_t pending_lock;        // guards pending, next_request_id, and reader_done
+   SG_proc_pending_t* pending;  // calls awaiting a reply, by request ID
+   uint64_t next_request_id;
+
    struct SG_proc* next;        // next process (linked list)
 };
 
@@ -45,11 +66,33 @@ struct SG_proc_group {
    int num_procs;               // number of actual processes initialized
    int capacity;                // length of procs 
    
-   struct SG_proc* free;        // linked list of free processes
-   sem_t num_free;              // number of free processes
+   struct SG_proc* free;        // linked list of free processes; most-recently-released first
+   sem_t num_free;              // posted to wake up callers waiting for a free process
+   int num_waiters;             // number of callers waiting on num_free
    
    bool active;                 // whether or not we can acquire new processes
    
+   // autoscaling 
+   int min_procs;               // do not reap idle processes below this many
+   int max_procs;               // do not spawn processes beyond this many
+   int num_spawning;            // number of processes being started
+   int64_t acquire_timeout_ms;  // default time SG_proc_group_acquire will wait for a free process (negative means forever)
+   int64_t idle_timeout_ms;     // reap a process beyond min_procs if it has been idle this long (0 means never)
+   
+   // how to start new processes (guarded by spawn_lock)
+   pthread_mutex_t spawn_lock;  // serializes process spawns, and guards the fields below
+   uint64_t generation;         // incremented on reload, so we can discard processes spawned from stale arguments
+   char* exec_str;
+   char* exec_arg;
+   char** exec_env;
+   struct SG_chunk config;
+   struct SG_chunk secrets;     // mlock'ed
+   struct SG_chunk driver;
+   bool can_spawn;              // set once the above are initialized
+   
+   struct timespec started_at;  // when this group was initialized (CLOCK_MONOTONIC)
+   struct SG_proc_group_stats stats;
+   
    pthread_rwlock_t lock;       // lock governing access to this structure 
 };
 
@@ -91,6 +134,12 @@ void SG_proc_free_data( struct SG_proc* proc ) {
          if( proc->fd_in >= 0 ) { 
              close( proc->fd_in );
          }
+         if( proc->reader_running ) {
+             
+             // the worker exits once it sees EOF on stdin, and the reader exits once it sees EOF on stdout
+             pthread_join( proc->reader, NULL );
+             proc->reader_running = false;
+         }
          if( proc->fout != NULL ) {
              fclose( proc->fout );      // closes proc->fd_out
          }
@@ -112,6 +161,13 @@ void SG_proc_free_data( struct SG_proc* proc ) {
           SG_FREE_LIST( proc->exec_env, free );
       }
 
+      if( proc->framed ) {
+          
+          pthread_mutex_destroy( &proc->write_lock );
+          pthread_mutex_destroy( &proc->pending_lock );
+          SG_safe_delete( proc->pending );
+      }
+
       memset( proc, 0, sizeof(struct SG_proc) );
       proc->fd_in = -1;
       proc->fd_out = -1;
@@ -181,12 +237,265 @@ int SG_proc_group_init( struct SG_proc_group* group ) {
       return rc;
    }
 
+   rc = pthread_mutex_init( &group->spawn_lock, NULL );
+   if( rc != 0 ) {
+      
+      SG_error("pthread_mutex_init rc = %d\n", rc );
+      
+      sem_destroy( &group->num_free );
+      pthread_rwlock_destroy( &group->lock );
+      return -ENOMEM;
+   }
+
    group->active = true;
+   group->acquire_timeout_ms = -1;
+   clock_gettime( CLOCK_MONOTONIC, &group->started_at );
+
+   return 0;
+}
+
+
+// free a process group's spawn arguments
+// NOTE: spawn_lock must be held, or the group must not be accessible by anyone but the caller
+static void SG_proc_group_spawn_args_free( struct SG_proc_group* group ) {
+   
+   SG_safe_free( group->exec_str );
+   SG_safe_free( group->exec_arg );
+   
+   if( group->exec_env != NULL ) {
+      SG_FREE_LIST( group->exec_env, free );
+      group->exec_env = NULL;
+   }
+   
+   if( group->secrets.data != NULL ) {
+      memset( group->secrets.data, 0, group->secrets.len );
+      munlock( group->secrets.data, group->secrets.len );
+   }
+   
+   SG_chunk_free( &group->config );
+   SG_chunk_free( &group->secrets );
+   SG_chunk_free( &group->driver );
+   
+   group->can_spawn = false;
+}
+
+
+// remember how to start new processes in this group, replacing the old arguments.
+// config and secrets may be NULL; the group keeps its own (mlock'ed) copy of the secrets.
+// bumps the group's generation, so processes started from the old arguments will be discarded.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -EINVAL if exec_str, exec_arg, exec_env, or driver are missing
+// NOTE: the group must be write-locked
+static int SG_proc_group_set_spawn_args_unlocked( struct SG_proc_group* group, char const* exec_str, char const* exec_arg, char** exec_env, struct SG_chunk* config, struct SG_chunk* secrets, struct SG_chunk* driver ) {
+   
+   int rc = 0;
+   size_t env_len = 0;
+   char* exec_str_dup = NULL;
+   char* exec_arg_dup = NULL;
+   char** exec_env_dup = NULL;
+   struct SG_chunk config_dup;
+   struct SG_chunk secrets_dup;
+   struct SG_chunk driver_dup;
+   
+   if( exec_str == NULL || exec_arg == NULL || exec_env == NULL || driver == NULL || driver->data == NULL ) {
+      return -EINVAL;
+   }
+   
+   memset( &config_dup, 0, sizeof(struct SG_chunk) );
+   memset( &secrets_dup, 0, sizeof(struct SG_chunk) );
+   memset( &driver_dup, 0, sizeof(struct SG_chunk) );
+   
+   exec_str_dup = SG_strdup_or_null( exec_str );
+   exec_arg_dup = SG_strdup_or_null( exec_arg );
+   if( exec_str_dup == NULL || exec_arg_dup == NULL ) {
+      
+      rc = -ENOMEM;
+      goto SG_proc_group_set_spawn_args_fail;
+   }
+   
+   for( env_len = 0; exec_env[env_len] != NULL; env_len++ );
+   
+   exec_env_dup = SG_CALLOC( char*, env_len + 1 );
+   if( exec_env_dup == NULL ) {
+      
+      rc = -ENOMEM;
+      goto SG_proc_group_set_spawn_args_fail;
+   }
+   
+   for( size_t i = 0; i < env_len; i++ ) {
+      
+      exec_env_dup[i] = SG_strdup_or_null( exec_env[i] );
+      if( exec_env_dup[i] == NULL ) {
+         
+         rc = -ENOMEM;
+         goto SG_proc_group_set_spawn_args_fail;
+      }
+   }
+   
+   if( config != NULL && config->data != NULL ) {
+      
+      rc = SG_chunk_dup( &config_dup, config );
+      if( rc != 0 ) {
+         goto SG_proc_group_set_spawn_args_fail;
+      }
+   }
+   
+   if( secrets != NULL && secrets->data != NULL ) {
+      
+      rc = SG_chunk_dup( &secrets_dup, secrets );
+      if( rc != 0 ) {
+         goto SG_proc_group_set_spawn_args_fail;
+      }
+      
+      rc = mlock( secrets_dup.data, secrets_dup.len );
+      if( rc != 0 ) {
+         
+         rc = -errno;
+         SG_warn("mlock(%p) rc = %d\n", secrets_dup.data, rc );
+         rc = 0;
+      }
+   }
+   
+   rc = SG_chunk_dup( &driver_dup, driver );
+   if( rc != 0 ) {
+      goto SG_proc_group_set_spawn_args_fail;
+   }
+   
+   // swap in 
+   pthread_mutex_lock( &group->spawn_lock );
+   
+   SG_proc_group_spawn_args_free( group );
+   
+   group->exec_str = exec_str_dup;
+   group->exec_arg = exec_arg_dup;
+   group->exec_env = exec_env_dup;
+   group->config = config_dup;
+   group->secrets = secrets_dup;
+   group->driver = driver_dup;
+   group->can_spawn = true;
+   group->generation++;
+   
+   pthread_mutex_unlock( &group->spawn_lock );
+   
+   return 0;
+   
+SG_proc_group_set_spawn_args_fail:
+   
+   SG_safe_free( exec_str_dup );
+   SG_safe_free( exec_arg_dup );
+   
+   if( exec_env_dup != NULL ) {
+      SG_FREE_LISTV( exec_env_dup, env_len, free );
+   }
+   
+   if( secrets_dup.data != NULL ) {
+      memset( secrets_dup.data, 0, secrets_dup.len );
+      munlock( secrets_dup.data, secrets_dup.len );
+   }
+   
+   SG_chunk_free( &config_dup );
+   SG_chunk_free( &secrets_dup );
+   SG_chunk_free( &driver_dup );
+   
+   return rc;
+}
+
+
+// remember how to start new processes in this group, so it can grow under load 
+// (see SG_proc_start for the meaning of the arguments; config and secrets may be NULL).
+// return 0 on success
+// return -ENOMEM on OOM
+// return -EINVAL if exec_str, exec_arg, exec_env, or driver are missing
+// NOTE: the group must NOT be locked
+int SG_proc_group_set_spawn_args( struct SG_proc_group* group, char const* exec_str, char const* exec_arg, char** exec_env, struct SG_chunk* config, struct SG_chunk* secrets, struct SG_chunk* driver ) {
+   
+   SG_proc_group_wlock( group );
+   int rc = SG_proc_group_set_spawn_args_unlocked( group, exec_str, exec_arg, exec_env, config, secrets, driver );
+   SG_proc_group_unlock( group );
+   
+   return rc;
+}
+
+
+// set a process group's size limits and timeouts.
+// once its spawn arguments are set, the group starts a new process whenever a caller has waited SG_PROC_GROUP_GROW_WAIT_MS
+// for a free one and there are fewer than max_procs processes.  Processes that have been idle for idle_timeout_ms are 
+// stopped by SG_proc_group_reap_idle, as long as more than min_procs remain (idle_timeout_ms <= 0 disables this).
+// acquire_timeout_ms is how long SG_proc_group_acquire waits for a free process (negative means forever).
+// return 0 on success 
+// return -EINVAL if min_procs is negative or max_procs is less than min_procs
+// NOTE: the group must NOT be locked
+int SG_proc_group_set_limits( struct SG_proc_group* group, int min_procs, int max_procs, int64_t acquire_timeout_ms, int64_t idle_timeout_ms ) {
+   
+   if( min_procs < 0 || max_procs < min_procs ) {
+      return -EINVAL;
+   }
+   
+   SG_proc_group_wlock( group );
+   
+   group->min_procs = min_procs;
+   group->max_procs = max_procs;
+   group->acquire_timeout_ms = acquire_timeout_ms;
+   group->idle_timeout_ms = idle_timeout_ms;
+   
+   SG_proc_group_unlock( group );
+   
+   return 0;
+}
+
 
+// get a snapshot of a process group's statistics 
+// always succeeds 
+// NOTE: the group must NOT be locked
+int SG_proc_group_get_stats( struct SG_proc_group* group, struct SG_proc_group_stats* stats ) {
+   
+   int num_busy = 0;
+   struct timespec now;
+   
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   
+   SG_proc_group_rlock( group );
+   
+   memcpy( stats, &group->stats, sizeof(struct SG_proc_group_stats) );
+   
+   for( int i = 0; i < group->capacity; i++ ) {
+      if( group->procs[i] != NULL && group->procs[i]->inflight > 0 ) {
+         num_busy++;
+      }
+   }
+   
+   stats->num_procs = group->num_procs;
+   stats->num_busy = num_busy;
+   stats->num_waiters = group->num_waiters;
+   stats->uptime_ns = md_timespec_diff( &now, &group->started_at );
+   
+   SG_proc_group_unlock( group );
+   
    return 0;
 }
 
 
+// wake up a caller waiting for a free process, if there are any 
+// NOTE: the group must be write-locked
+static void SG_proc_group_wake_unlocked( struct SG_proc_group* group ) {
+   
+   if( group->num_waiters > 0 ) {
+      sem_post( &group->num_free );
+   }
+}
+
+
+// wake up all callers waiting for a free process (i.e. on deactivation)
+// NOTE: the group must be write-locked
+static void SG_proc_group_wake_all_unlocked( struct SG_proc_group* group ) {
+   
+   for( int i = 0; i < group->num_waiters; i++ ) {
+      sem_post( &group->num_free );
+   }
+}
+
+
 // take a process off a list 
 // return 0 if removed 
 // return -ENOENT if not removed
@@ -256,6 +565,16 @@ int SG_proc_list_insert( struct SG_proc** list, struct SG_proc* insert ) {
 }
 
 
+// add a process to a list's head 
+// always succeeds 
+static int SG_proc_list_push( struct SG_proc** list, struct SG_proc* insert ) {
+   
+   insert->next = *list;
+   *list = insert;
+   return 0;
+}
+
+
 // get a pointer to the head of the process group's freelist 
 struct SG_proc** SG_proc_group_freelist( struct SG_proc_group* group ) {
    return &group->free;
@@ -316,6 +635,7 @@ int SG_proc_group_tryjoin( struct SG_proc_group* group ) {
    SG_debug("join group %p\n", group);
 
    group->active = false;
+   SG_proc_group_wake_all_unlocked( group );
    num_procs = group->num_procs;
    
    for( int i = 0; i < group->capacity; i++ ) {
@@ -368,6 +688,10 @@ int SG_proc_group_stop( struct SG_proc_group* group, int timeout ) {
    
    SG_proc_group_wlock( group );
    
+   // no more acquisitions
+   group->active = false;
+   SG_proc_group_wake_all_unlocked( group );
+   
    if( timeout > 0 ) {
       
       // ask them to die first   
@@ -599,7 +923,10 @@ void SG_proc_group_free( struct SG_proc_group* group ) {
    SG_safe_free( group->procs );
    group->procs = NULL;
    
+   SG_proc_group_spawn_args_free( group );
+   
    pthread_rwlock_destroy( &group->lock );
+   pthread_mutex_destroy( &group->spawn_lock );
    sem_destroy( &group->num_free );
    
    memset( group, 0, sizeof(struct SG_proc_group) );
@@ -680,7 +1007,9 @@ static int SG_proc_group_add_unlocked( struct SG_proc_group* group, struct SG_pr
    if( rc == 0 ) {
 
        // insert into the free list, so it can be acquired later
+       clock_gettime( CLOCK_MONOTONIC, &proc->idle_since );
        SG_proc_list_insert( &group->free, proc );
+       SG_proc_group_wake_unlocked( group );
 
        SG_debug("Process group %p has %p (%d procs)\n", group, proc, group->num_procs );
    }
@@ -798,10 +1127,11 @@ bool SG_proc_is_dead( struct SG_proc* proc ) {
 }
 
 
-// remove a dead process, freeing it
+// remove a dead process, freeing it once no caller is using it
+// (a framed process may still be held by other callers; the last one to release it frees it)
 // return 0 on success
 // return -EINVAL if not dead
-// return -ENOENT if not present in the group
+// return -ENOENT if not present in the group, and still in use
 static int SG_proc_group_remove_dead_unlocked( struct SG_proc_group* group, struct SG_proc* proc ) {
    
    int rc = 0;
@@ -810,7 +1140,7 @@ static int SG_proc_group_remove_dead_unlocked( struct SG_proc_group* group, stru
    }
 
    rc = SG_proc_group_remove_unlocked( group, proc );
-   if( rc != 0 ) {
+   if( proc->inflight > 0 ) {
       return rc;
    }
 
@@ -920,7 +1250,6 @@ int SG_proc_read_chunk( FILE* f, struct SG_chunk* chunk ) {
    SG_debug("Read chunk of %" PRId64 " bytes\n", size );
 
    // set up the chunk
-   // TODO: investigate splice(2)'ing the data, if memory pressure becomes a problem
    if( chunk->data == NULL ) {
 
       // need more space
@@ -945,38 +1274,40 @@ int SG_proc_read_chunk( FILE* f, struct SG_chunk* chunk ) {
       // clear the rest of the chunk
       while( off < size ) {
          
-         len = buf_size - nr;
+         len = MIN( buf_size, size - off );
          nr = fread( buf, 1, len, f );
+         off += nr;
+         
          if( nr < len ) {
             if( feof(f) ) {
 
                SG_error("EOF on fread(%d)\n", fileno(f));
                break;
             }
-         }
-         else { 
-            // error 
-            rc = -errno;
-            if( rc == -EINTR ) {
-               clearerr(f);
-               continue;
-            }
+            else { 
+               // error 
+               if( errno == EINTR ) {
+                  clearerr(f);
+                  continue;
+               }
 
-            SG_error("fread(%d) error: %s\n", fileno(f), strerror(-rc));
-            break;
+               SG_error("fread(%d) error: %s\n", fileno(f), strerror(errno));
+               break;
+            }
          }
-
-         off += nr;
       }
    }
    else {
 
-      // feed it in
+      // feed it in.
+      // stdio reads requests at least as big as its buffer straight into chunk->data, so large chunks are copied only once.
       while( off < size ) {
           
-          len = size - nr;
+          len = size - off;
           SG_debug("Read %zd bytes\n", len);
-          nr = fread( chunk->data + nr, 1, len, f );
+          nr = fread( chunk->data + off, 1, len, f );
+          off += nr;
+          
           if( nr < len ) {
              
              if( feof(f) ) { 
@@ -994,8 +1325,6 @@ int SG_proc_read_chunk( FILE* f, struct SG_chunk* chunk ) {
                 break;
              }
           }
-
-          off += nr;
       }
    }
 
@@ -1009,6 +1338,121 @@ int SG_proc_read_chunk( FILE* f, struct SG_chunk* chunk ) {
 }
 
 
+// write a buffer to a worker's input pipe.
+// buffers of at least SG_PROC_SPLICE_MIN_LEN bytes are vmsplice(2)'ed, so the pipe references the caller's
+// pages instead of copying them.  The caller must not modify or free the buffer until the worker has consumed it 
+// (i.e. until the worker replies).  Falls back to write(2) if fd is not a pipe.
+// *spliced is set to true once any of buf has been vmsplice'd.  If this then fails, the pipe may still reference
+// buf's pages after it returns, so the caller must discard the worker and its pipe (see SG_proc_discard_pipe) before
+// it lets anyone free or reuse buf.
+// masks EINTR 
+// return the number of bytes written on success 
+// return -errno on failure
+static ssize_t SG_proc_write_data( int fd, char const* buf, size_t len, bool* spliced ) {
+   
+   ssize_t nw = 0;
+   size_t num_written = 0;
+   struct iovec iov;
+   
+   if( len < SG_PROC_SPLICE_MIN_LEN ) {
+      return md_write_uninterrupted( fd, buf, len );
+   }
+   
+   while( num_written < len ) {
+      
+      iov.iov_base = (void*)(buf + num_written);
+      iov.iov_len = len - num_written;
+      
+      nw = vmsplice( fd, &iov, 1, 0 );
+      if( nw < 0 ) {
+         
+         nw = -errno;
+         if( nw == -EINTR ) {
+            continue;
+         }
+         
+         if( num_written == 0 && (nw == -EBADF || nw == -EINVAL || nw == -ENOSYS) ) {
+            
+            // not a pipe
+            return md_write_uninterrupted( fd, buf, len );
+         }
+         
+         return nw;
+      }
+      
+      num_written += nw;
+      *spliced = true;
+   }
+   
+   return num_written;
+}
+
+
+// write out a list of buffers, gathering runs of small ones into a single writev(2).
+// if splice is true, large ones are vmsplice(2)'ed (see SG_proc_write_data), and the caller must keep them 
+// alive until the worker replies.  Otherwise, everything is copied into the pipe.
+// *spliced is set to true if anything was vmsplice'd (it is left alone otherwise).
+// masks EINTR 
+// return 0 on success 
+// return -errno on failure
+static int SG_proc_writev( int fd, struct iovec* iov, int iovcnt, bool splice, bool* spliced ) {
+   
+   ssize_t nw = 0;
+   struct iovec run[ SG_PROC_WRITEV_MAX ];
+   int run_len = 0;
+   
+   for( int i = 0; i < iovcnt; ) {
+      
+      if( splice && iov[i].iov_len >= SG_PROC_SPLICE_MIN_LEN ) {
+         
+         nw = SG_proc_write_data( fd, (char const*)iov[i].iov_base, iov[i].iov_len, spliced );
+         if( nw < 0 ) {
+            return (int)nw;
+         }
+         
+         i++;
+         continue;
+      }
+      
+      // gather small buffers 
+      run_len = 0;
+      for( ; i < iovcnt && run_len < SG_PROC_WRITEV_MAX && (!splice || iov[i].iov_len < SG_PROC_SPLICE_MIN_LEN); i++ ) {
+         
+         run[ run_len ] = iov[i];
+         run_len++;
+      }
+      
+      // send them all, even if writev() comes up short 
+      for( int j = 0; j < run_len; ) {
+         
+         nw = writev( fd, run + j, run_len - j );
+         if( nw < 0 ) {
+            
+            nw = -errno;
+            if( nw == -EINTR ) {
+               continue;
+            }
+            
+            return (int)nw;
+         }
+         
+         // skip what got written 
+         while( j < run_len && (size_t)nw >= run[j].iov_len ) {
+            nw -= run[j].iov_len;
+            j++;
+         }
+         
+         if( j < run_len ) {
+            run[j].iov_base = (char*)run[j].iov_base + nw;
+            run[j].iov_len -= nw;
+         }
+      }
+   }
+   
+   return 0;
+}
+
+
 // writes a signed 64-bit integer to a file descriptor, appended by a newline 
 // masks EINTR 
 // return 0 on success 
@@ -1032,7 +1476,8 @@ int SG_proc_write_int64( int fd, int64_t value ) {
 }
 
 
-// send a chunk to a worker
+// send a chunk to a worker: its size, a newline, the data, and a newline.
+// the data is copied into the pipe, so the caller may free the chunk as soon as this returns.
 // NOTE: the caller should try to read a character reply from the worker's output stream--either '0' or something else
 // return 0 on success
 // return -ENOMEM on OOM 
@@ -1040,33 +1485,27 @@ int SG_proc_write_int64( int fd, int64_t value ) {
 int SG_proc_write_chunk( int out_fd, struct SG_chunk* chunk ) {
    
    int rc = 0;
+   char size_buf[100];
+   struct iovec iov[3];
+   bool spliced = false;
    
-   // send chunk size 
-   rc = SG_proc_write_int64( out_fd, (int64_t)chunk->len );
-   if( rc < 0 ) {
-      
-      SG_error("SG_proc_write_int64(%d (%" PRId64 ")) rc = %d\n", out_fd, (int64_t)chunk->len, rc );
-      
-      return -ENODATA;
-   }
+   memset( size_buf, 0, 100 );
+   snprintf( size_buf, 99, "%" PRId64 "\n", (int64_t)chunk->len );
+   
+   iov[0].iov_base = size_buf;
+   iov[0].iov_len = strlen(size_buf);
+   iov[1].iov_base = chunk->data;
+   iov[1].iov_len = chunk->len;
+   iov[2].iov_base = (void*)"\n";
+   iov[2].iov_len = 1;
    
-   // send chunk itself
-   rc = md_write_uninterrupted( out_fd, chunk->data, chunk->len );
+   rc = SG_proc_writev( out_fd, iov, 3, false, &spliced );
    if( rc < 0 ) {
       
-      SG_error("md_write_uninterrupted(%d) rc = %d\n", out_fd, rc );
+      SG_error("SG_proc_writev(%d, %" PRId64 " bytes) rc = %d\n", out_fd, (int64_t)chunk->len, rc );
       
       return -ENODATA;
    }
-
-   // send newline delimiter 
-   rc = md_write_uninterrupted( out_fd, "\n", 1 );
-   if( rc < 0 ) {
-
-      SG_error("md_write_uninterrupted(%d) rc = %d\n", out_fd, rc);
-
-      return -ENODATA;
-   }
    
    return 0;
 }
@@ -1149,29 +1588,486 @@ int SG_proc_write_request( int fd, SG_messages::DriverRequest* dreq ) {
 }
 
 
-// start a (long-running) worker process, and store the relevant information in an SG_proc.
-// if given, feed the worker its config (as a string), its secrets (as a string), and its driver info (as a string)
-// set up pipes to link the worker to the gateway.
-// return 0 on success 
-// return -EINVAL on invalid arguments
-// return -EMFILE if we're out of fds
-// return -ENFILE if the host is out of fds
-// return -ECHILD if the child failed to start
-// return -ENOSYS if the driver does not implement the requested operation mode
-// the caller should try to join with the proc if this method fails
-int SG_proc_start( struct SG_proc* proc, char const* exec_path, char const* exec_arg, char** exec_env, struct SG_chunk* config, struct SG_chunk* secrets, struct SG_chunk* driver ) {
+// reply reader for a framed process: read each reply frame from the worker, and hand it to the call waiting for it.
+// once the worker's output ends or becomes unparsable, mark the process dead and fail all outstanding calls with -EIO.
+static void* SG_proc_framed_reader_main( void* arg ) {
    
    int rc = 0;
-   pid_t pid = 0;
-   int child_input[2];
-   int child_output[2];
-   char ready_buf[10];
-   FILE* fout = NULL;
-   size_t env_len = 0;
+   int64_t request_id = 0;
+   struct SG_proc* proc = (struct SG_proc*)arg;
+   struct SG_proc_call* call = NULL;
+   struct SG_chunk reply;
    
-   struct SG_chunk empty_json;
-   empty_json.data = (char*)"{}";
-   empty_json.len = 2;
+   while( true ) {
+      
+      // request ID, then the reply as a chunk
+      rc = SG_proc_read_int64( proc->fout, &request_id );
+      if( rc != 0 ) {
+         
+         if( rc != -ENODATA ) {
+            SG_error("SG_proc_read_int64('REQUEST ID', %d) rc = %d\n", proc->pid, rc );
+         }
+         break;
+      }
+      
+      memset( &reply, 0, sizeof(struct SG_chunk) );
+      rc = SG_proc_read_chunk( proc->fout, &reply );
+      if( rc != 0 ) {
+         
+         SG_error("SG_proc_read_chunk('REPLY', %d) rc = %d\n", proc->pid, rc );
+         SG_chunk_free( &reply );
+         break;
+      }
+      
+      pthread_mutex_lock( &proc->pending_lock );
+      
+      SG_proc_pending_t::iterator itr = proc->pending->find( (uint64_t)request_id );
+      if( itr != proc->pending->end() ) {
+         
+         call = itr->second;
+         proc->pending->erase( itr );
+         
+         call->reply_data = reply.data;
+         call->reply_len = reply.len;
+         call->rc = 0;
+         sem_post( &call->done );
+      }
+      else {
+         
+         SG_warn("Worker %d replied to unknown request %" PRId64 "\n", proc->pid, request_id );
+         SG_chunk_free( &reply );
+      }
+      
+      pthread_mutex_unlock( &proc->pending_lock );
+   }
+   
+   // no more replies will come 
+   pthread_mutex_lock( &proc->pending_lock );
+   
+   proc->reader_done = true;
+   proc->dead = true;
+   
+   for( SG_proc_pending_t::iterator itr = proc->pending->begin(); itr != proc->pending->end(); itr++ ) {
+      
+      itr->second->rc = -EIO;
+      sem_post( &itr->second->done );
+   }
+   
+   proc->pending->clear();
+   
+   pthread_mutex_unlock( &proc->pending_lock );
+   
+   SG_debug("Reply reader for worker %d exits\n", proc->pid );
+   return NULL;
+}
+
+
+// switch a freshly-started process over to the framed protocol.
+// the worker has written "3\n"; the next line is the number of requests it will handle at once.
+// start the thread that reads its replies.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -ECHILD if the worker did not send a valid pipeline depth
+// NOTE: only call from SG_proc_start
+static int SG_proc_framed_start( struct SG_proc* proc ) {
+   
+   int rc = 0;
+   char depth_buf[21];
+   char* tmp = NULL;
+   long depth = 0;
+   
+   memset( depth_buf, 0, 21 );
+   
+   // read the depth one byte at a time, so we don't read ahead of it
+   for( int i = 0; i < 20; i++ ) {
+      
+      rc = md_read_uninterrupted( proc->fd_out, depth_buf + i, 1 );
+      if( rc != 1 ) {
+         
+         SG_error("read(%d) rc = %d\n", proc->fd_out, rc );
+         return -ECHILD;
+      }
+      
+      if( depth_buf[i] == '\n' ) {
+         depth_buf[i] = '\0';
+         break;
+      }
+   }
+   
+   depth = strtol( depth_buf, &tmp, 10 );
+   if( depth_buf[0] == '\0' || *tmp != '\0' || depth < 1 ) {
+      
+      SG_error("Invalid pipeline depth '%s'\n", depth_buf );
+      return -ECHILD;
+   }
+   
+   if( depth > SG_PROC_MAX_PIPELINE_DEPTH ) {
+      depth = SG_PROC_MAX_PIPELINE_DEPTH;
+   }
+   
+   proc->pending = SG_safe_new( SG_proc_pending_t() );
+   if( proc->pending == NULL ) {
+      return -ENOMEM;
+   }
+   
+   pthread_mutex_init( &proc->write_lock, NULL );
+   pthread_mutex_init( &proc->pending_lock, NULL );
+   
+   proc->framed = true;
+   proc->max_inflight = depth;
+   proc->next_request_id = 1;
+   
+   rc = pthread_create( &proc->reader, NULL, SG_proc_framed_reader_main, proc );
+   if( rc != 0 ) {
+      
+      SG_error("pthread_create rc = %d\n", rc );
+      return -ENOMEM;
+   }
+   
+   proc->reader_running = true;
+   
+   SG_debug("Worker %d (%s) accepts up to %ld requests at once\n", proc->pid, proc->exec_arg, depth );
+   return 0;
+}
+
+
+// does a process speak the framed protocol?
+bool SG_proc_is_framed( struct SG_proc* proc ) {
+   return proc->framed;
+}
+
+
+// begin a request/reply exchange with a process the caller has acquired.
+// use SG_proc_call_write_request and SG_proc_call_write_chunk to send the request, SG_proc_call_send to 
+// finish it, and SG_proc_call_reply to read the reply.
+// in the original protocol, the request goes straight to the worker and the reply is read from its output;
+// in the framed protocol, the request is gathered up (referencing, not copying, the caller's chunks), sent as 
+// one frame, and matched to its reply by request ID.
+// return 0 on success 
+// return -ENOMEM on OOM, in which case call is left zeroed (so SG_proc_call_free on it is a no-op)
+int SG_proc_call_init( struct SG_proc_call* call, struct SG_proc* proc ) {
+   
+   memset( call, 0, sizeof(struct SG_proc_call) );
+   
+   if( proc->framed ) {
+      
+      call->request = SG_safe_new( vector<struct iovec>() );
+      call->request_bufs = SG_safe_new( vector<char*>() );
+      
+      if( call->request == NULL || call->request_bufs == NULL ) {
+         
+         SG_safe_delete( call->request );
+         SG_safe_delete( call->request_bufs );
+         return -ENOMEM;
+      }
+      
+      if( sem_init( &call->done, 0, 0 ) != 0 ) {
+         
+         SG_safe_delete( call->request );
+         SG_safe_delete( call->request_bufs );
+         return -ENOMEM;
+      }
+   }
+   
+   // only now is there anything for SG_proc_call_free to tear down
+   call->proc = proc;
+   
+   return 0;
+}
+
+
+// free up a call's buffers 
+// always succeeds 
+void SG_proc_call_free( struct SG_proc_call* call ) {
+   
+   if( call->proc != NULL && call->proc->framed ) {
+      
+      if( call->reply != NULL ) {
+         fclose( call->reply );
+         call->reply = NULL;
+      }
+      
+      if( call->request_bufs != NULL ) {
+         
+         for( size_t i = 0; i < call->request_bufs->size(); i++ ) {
+            free( call->request_bufs->at(i) );
+         }
+      }
+      
+      SG_safe_delete( call->request );
+      SG_safe_delete( call->request_bufs );
+      SG_safe_free( call->reply_data );
+      sem_destroy( &call->done );
+   }
+   
+   memset( call, 0, sizeof(struct SG_proc_call) );
+}
+
+
+// append a chunk to a framed call's request, as its size, a newline, the data, and a newline.
+// if owned is true, the call takes ownership of the data; otherwise it must remain valid (and unmodified) until the reply arrives.
+// return 0 on success 
+// return -ENOMEM on OOM
+static int SG_proc_call_append( struct SG_proc_call* call, char* data, size_t len, bool owned ) {
+   
+   struct iovec iov;
+   size_t size_len = 0;
+   char* size_buf = SG_CALLOC( char, 50 );
+   
+   if( size_buf == NULL ) {
+      return -ENOMEM;
+   }
+   
+   snprintf( size_buf, 49, "%zu\n", len );
+   size_len = strlen( size_buf );
+   
+   try {
+      
+      // make sure the push_back()s below can't fail, so ownership is all-or-nothing
+      call->request->reserve( call->request->size() + 3 );
+      call->request_bufs->reserve( call->request_bufs->size() + 2 );
+   }
+   catch( bad_alloc& ba ) {
+      
+      SG_safe_free( size_buf );
+      return -ENOMEM;
+   }
+   
+   call->request_bufs->push_back( size_buf );
+   if( owned ) {
+      call->request_bufs->push_back( data );
+   }
+   
+   iov.iov_base = size_buf;
+   iov.iov_len = size_len;
+   call->request->push_back( iov );
+   
+   iov.iov_base = data;
+   iov.iov_len = len;
+   call->request->push_back( iov );
+   
+   iov.iov_base = (void*)"\n";
+   iov.iov_len = 1;
+   call->request->push_back( iov );
+   
+   call->request_len += size_len + len + 1;
+   return 0;
+}
+
+
+// append a chunk to a call's request.
+// the chunk must not be modified or freed until the reply arrives (i.e. SG_proc_call_send returns)
+// return 0 on success 
+// return -ENOMEM on OOM (framed)
+// return -ENODATA if we could not write (e.g. SIGPIPE)
+int SG_proc_call_write_chunk( struct SG_proc_call* call, struct SG_chunk* chunk ) {
+   
+   if( !call->proc->framed ) {
+      return SG_proc_write_chunk( call->proc->fd_in, chunk );
+   }
+   
+   return SG_proc_call_append( call, chunk->data, chunk->len, false );
+}
+
+
+// append a driver request to a call's request 
+// return 0 on success 
+// return -ENOMEM on OOM 
+// return -ENODATA if we could not write (e.g. SIGPIPE)
+int SG_proc_call_write_request( struct SG_proc_call* call, SG_messages::DriverRequest* dreq ) {
+   
+   int rc = 0;
+   struct SG_chunk chunk;
+   char* buf = NULL;
+   size_t len = 0;
+
+   rc = md_serialize< SG_messages::DriverRequest >( dreq, &buf, &len );
+   if( rc != 0 ) {
+      return rc;
+   }
+
+   if( call->proc->framed ) {
+      
+      // call owns buf now
+      rc = SG_proc_call_append( call, buf, len, true );
+      if( rc != 0 ) {
+         SG_safe_free( buf );
+      }
+      
+      return rc;
+   }
+   
+   SG_chunk_init( &chunk, buf, len );
+
+   rc = SG_proc_call_write_chunk( call, &chunk );
+   SG_chunk_free( &chunk );
+
+   return rc;
+}
+
+
+// give up on a worker whose input pipe may still reference pages we vmsplice'd into it.
+// kill the worker so it never reads them, and close our end so the pipe (and its page references) goes away.
+// the process is marked dead; the reply reader fails any other outstanding calls once it sees EOF.
+// NOTE: proc->write_lock must be held
+static void SG_proc_discard_pipe( struct SG_proc* proc ) {
+   
+   SG_warn("Discarding worker %d and its input pipe\n", proc->pid );
+   
+   SG_proc_kill( proc, SIGKILL );
+   
+   if( proc->fd_in >= 0 ) {
+      close( proc->fd_in );
+      proc->fd_in = -1;
+   }
+   
+   proc->dead = true;
+}
+
+
+// finish sending a call's request.  In the framed protocol, send the request frame and wait for the reply frame.
+// if sending fails after part of the request was vmsplice'd, the worker is killed and its pipe closed before this
+// returns, so the caller may free the request's buffers as usual.
+// return 0 on success
+// return -ENOMEM on OOM 
+// return -ENODATA if we could not write (e.g. SIGPIPE)
+// return -EIO if the worker died or misbehaved before replying
+int SG_proc_call_send( struct SG_proc_call* call ) {
+   
+   int rc = 0;
+   uint64_t request_id = 0;
+   struct SG_proc* proc = call->proc;
+   char header[100];
+   struct iovec iov;
+   bool spliced = false;
+   
+   if( !proc->framed ) {
+      
+      // already sent 
+      call->reply = proc->fout;
+      return 0;
+   }
+   
+   // register for the reply 
+   pthread_mutex_lock( &proc->pending_lock );
+   
+   if( proc->reader_done ) {
+      
+      pthread_mutex_unlock( &proc->pending_lock );
+      return -EIO;
+   }
+   
+   request_id = proc->next_request_id;
+   proc->next_request_id++;
+   
+   try {
+      
+      // frame: request ID, then the request as a chunk
+      memset( header, 0, 100 );
+      snprintf( header, 99, "%" PRIu64 "\n%zu\n", request_id, call->request_len );
+      
+      iov.iov_base = header;
+      iov.iov_len = strlen(header);
+      call->request->insert( call->request->begin(), iov );
+      
+      iov.iov_base = (void*)"\n";
+      iov.iov_len = 1;
+      call->request->push_back( iov );
+      
+      (*proc->pending)[ request_id ] = call;
+   }
+   catch( bad_alloc& ba ) {
+      
+      pthread_mutex_unlock( &proc->pending_lock );
+      return -ENOMEM;
+   }
+   
+   pthread_mutex_unlock( &proc->pending_lock );
+   
+   pthread_mutex_lock( &proc->write_lock );
+   
+   // the call holds onto its request buffers until the reply arrives, so large ones can be spliced
+   rc = SG_proc_writev( proc->fd_in, &(*call->request)[0], call->request->size(), true, &spliced );
+   if( rc != 0 && spliced ) {
+      
+      // the pipe may still reference the caller's pages, which it is about to free
+      SG_proc_discard_pipe( proc );
+   }
+   
+   pthread_mutex_unlock( &proc->write_lock );
+   
+   if( rc != 0 ) {
+      
+      SG_error("Failed to send request %" PRIu64 " to worker %d, rc = %d\n", request_id, proc->pid, rc );
+      
+      pthread_mutex_lock( &proc->pending_lock );
+      
+      if( proc->pending->erase( request_id ) == 0 ) {
+         
+         // the reader already failed us; consume its wakeup
+         pthread_mutex_unlock( &proc->pending_lock );
+         while( sem_wait( &call->done ) != 0 && errno == EINTR );
+      }
+      else {
+         pthread_mutex_unlock( &proc->pending_lock );
+      }
+      
+      proc->dead = true;
+      return -ENODATA;
+   }
+   
+   // wait for the reply
+   while( sem_wait( &call->done ) != 0 && errno == EINTR );
+   
+   if( call->rc != 0 ) {
+      return call->rc;
+   }
+   
+   if( call->reply_len == 0 ) {
+      
+      SG_error("Empty reply to request %" PRIu64 " from worker %d\n", request_id, proc->pid );
+      return -EIO;
+   }
+   
+   call->reply = fmemopen( call->reply_data, call->reply_len, "r" );
+   if( call->reply == NULL ) {
+      return -ENOMEM;
+   }
+   
+   return 0;
+}
+
+
+// get the stream to read a call's reply from, once it has been sent.
+// read it with SG_proc_read_int64 and SG_proc_read_chunk, as in the original protocol.
+FILE* SG_proc_call_reply( struct SG_proc_call* call ) {
+   return call->reply;
+}
+
+
+// start a (long-running) worker process, and store the relevant information in an SG_proc.
+// if given, feed the worker its config (as a string), its secrets (as a string), and its driver info (as a string)
+// set up pipes to link the worker to the gateway.
+// return 0 on success 
+// return -EINVAL on invalid arguments
+// return -EMFILE if we're out of fds
+// return -ENFILE if the host is out of fds
+// return -ECHILD if the child failed to start
+// return -ENOSYS if the driver does not implement the requested operation mode
+// the caller should try to join with the proc if this method fails
+int SG_proc_start( struct SG_proc* proc, char const* exec_path, char const* exec_arg, char** exec_env, struct SG_chunk* config, struct SG_chunk* secrets, struct SG_chunk* driver ) {
+   
+   int rc = 0;
+   pid_t pid = 0;
+   int child_input[2];
+   int child_output[2];
+   char ready_buf[10];
+   FILE* fout = NULL;
+   size_t env_len = 0;
+   
+   struct SG_chunk empty_json;
+   empty_json.data = (char*)"{}";
+   empty_json.len = 2;
 
    proc->pid = 0;   // in case we return, don't do anything on join
 
@@ -1248,6 +2144,14 @@ int SG_proc_start( struct SG_proc* proc, char const* exec_path, char const* exec
       return rc;
    }
    
+   // make room for whole blocks in the pipes, so the worker and gateway don't ping-pong on 64KB at a time (best-effort)
+   if( fcntl( child_input[1], F_SETPIPE_SZ, SG_PROC_PIPE_SIZE ) < 0 || fcntl( child_output[0], F_SETPIPE_SZ, SG_PROC_PIPE_SIZE ) < 0 ) {
+      
+      rc = -errno;
+      SG_debug("fcntl(F_SETPIPE_SZ, %d) rc = %d\n", SG_PROC_PIPE_SIZE, rc );
+      rc = 0;
+   }
+   
    fout = fdopen( child_output[0], "r" );
    if( fout == NULL ) {
       
@@ -1332,6 +2236,7 @@ int SG_proc_start( struct SG_proc* proc, char const* exec_path, char const* exec
       proc->exec_str = exec_str_dup;
       proc->exec_env = exec_env_dup;
       proc->fout = fout;
+      proc->max_inflight = 1;
 
       if( config == NULL ) {
          config = &empty_json;
@@ -1378,7 +2283,7 @@ int SG_proc_start( struct SG_proc* proc, char const* exec_path, char const* exec
          return rc;
       }
       
-      // wait for "0\n" or "1\n"
+      // wait for "0\n", "1\n", "2\n", or "3\n" (followed by the pipeline depth)
       rc = md_read_uninterrupted( child_output[0], ready_buf, 2 );
       if( rc < 0 ) {
          
@@ -1404,7 +2309,19 @@ int SG_proc_start( struct SG_proc* proc, char const* exec_path, char const* exec
          return rc;
       }
       
-      if( ready_buf[0] != '0' ) {
+      if( ready_buf[0] == '3' ) {
+         
+         // worker speaks the framed protocol 
+         rc = SG_proc_framed_start( proc );
+         if( rc != 0 ) {
+            
+            SG_error("SG_proc_framed_start('%s') rc = %d\n", exec_arg, rc );
+            SG_proc_free_data( proc );
+            proc->pid = pid;       // so the caller can join
+            return rc;
+         }
+      }
+      else if( ready_buf[0] != '0' ) {
 
          if( ready_buf[0] == '2' ) {
             // fall back to built-in 
@@ -1587,42 +2504,224 @@ int SG_proc_group_reload( struct SG_proc_group* group, char const* new_exec_str,
       }
    }
    
+   if( group->can_spawn ) {
+      
+      // processes started from now on should run the new driver 
+      int spawn_rc = SG_proc_group_set_spawn_args_unlocked( group, new_exec_str, group->exec_arg, group->exec_env, new_config, new_secrets, new_driver );
+      if( spawn_rc != 0 ) {
+         
+         SG_error("SG_proc_group_set_spawn_args_unlocked(exec_arg='%s') rc = %d\n", group->exec_arg, spawn_rc );
+         if( rc == 0 ) {
+            rc = spawn_rc;
+         }
+      }
+   }
+   
    return rc;
 }
 
 
-// get a free process, and prevent it from receiving I/O from anyone else (i.e. take it off the free list)
-// return the non-NULL proc on success
-// return NULL if there are no free processess
+// start a new process from the group's spawn arguments, and add it to the free list.
+// the caller must have incremented group->num_spawning while holding the write lock; this method decrements it.
+// spawns are serialized by the group's spawn_lock.
+// return 0 on success 
+// return -ENOMEM on OOM
+// return -ENOSYS if the driver does not implement this role (the group will not try to grow again)
+// return -EAGAIN if the group was reloaded or deactivated while the process was starting
+// return -EINVAL if the group has no spawn arguments
+// return -errno on failure to start the process
 // NOTE: group must NOT be locked
-// NOTE; this call blocks if there are available processes
-struct SG_proc* SG_proc_group_acquire( struct SG_proc_group* group ) {
+static int SG_proc_group_grow( struct SG_proc_group* group ) {
    
    int rc = 0;
-   bool active = true;
-   while( active ) {
+   uint64_t generation = 0;
+   struct SG_proc* proc = SG_proc_alloc( 1 );
+   
+   if( proc == NULL ) {
+      rc = -ENOMEM;
+   }
+   else {
       
-      SG_proc_group_wlock( group );
-      active = group->active;
-      if( !active ) {
-         break;
+      pthread_mutex_lock( &group->spawn_lock );
+      
+      generation = group->generation;
+      if( group->can_spawn ) {
+         
+         SG_debug("Grow process group %p: start '%s %s'\n", group, group->exec_str, group->exec_arg );
+         rc = SG_proc_start( proc, group->exec_str, group->exec_arg, group->exec_env, (group->config.data != NULL ? &group->config : NULL), (group->secrets.data != NULL ? &group->secrets : NULL), &group->driver );
+      }
+      else {
+         rc = -EINVAL;
       }
       
-      struct SG_proc* proc = SG_proc_list_pop( &group->free );
-      if( proc == NULL ) {
+      pthread_mutex_unlock( &group->spawn_lock );
+      
+      if( rc != 0 ) {
          
-         // out of processes
-         if( group->free == NULL ) {
+         SG_proc_stop( proc, 0 );
+         SG_proc_free( proc );
+         proc = NULL;
+      }
+   }
+   
+   SG_proc_group_wlock( group );
+   
+   group->num_spawning--;
+   
+   if( rc == -ENOSYS ) {
+      
+      // don't try again 
+      group->max_procs = group->num_procs;
+   }
+   else if( rc == 0 ) {
+      
+      if( !group->active || generation != group->generation ) {
+         
+         // started from stale arguments, or no longer needed
+         rc = -EAGAIN;
+      }
+      else {
+         
+         rc = SG_proc_group_add_unlocked( group, proc );
+         if( rc == 0 ) {
             
-            // ...because there are none in the first place
-            SG_warn("No free process in group %p\n", group );
+            group->stats.num_spawned++;
+            proc = NULL;
          }
+      }
+   }
+   
+   if( rc != 0 ) {
+      
+      // let waiters re-evaluate 
+      SG_proc_group_wake_unlocked( group );
+   }
+   
+   SG_proc_group_unlock( group );
+   
+   if( proc != NULL ) {
+      
+      SG_proc_stop( proc, 0 );
+      SG_proc_free( proc );
+   }
+   
+   return rc;
+}
+
+
+// find the longest-idle process that has been idle for too long, and take it out of the group.
+// return the process on success; the caller must stop and free it
+// return NULL if there is no such process, or if the group is down to min_procs
+// NOTE: the group must be write-locked
+static struct SG_proc* SG_proc_group_reap_idle_unlocked( struct SG_proc_group* group, struct timespec* now ) {
+   
+   struct SG_proc* idle = NULL;
+   
+   if( group->idle_timeout_ms <= 0 || group->num_procs <= group->min_procs ) {
+      return NULL;
+   }
+   
+   for( struct SG_proc* p = group->free; p != NULL; p = p->next ) {
+      
+      if( p->inflight > 0 || md_timespec_diff_ms( now, &p->idle_since ) < group->idle_timeout_ms ) {
+         continue;
+      }
+      
+      if( idle == NULL || md_timespec_diff( &p->idle_since, &idle->idle_since ) < 0 ) {
+         idle = p;
+      }
+   }
+   
+   if( idle == NULL ) {
+      return NULL;
+   }
+   
+   SG_proc_group_remove_unlocked( group, idle );
+   group->stats.num_reaped++;
+   
+   return idle;
+}
+
+
+// stop every process that has been idle for the group's idle timeout, down to the group's min_procs.
+// call this periodically; acquiring and releasing processes never shrinks the group.
+// return the number of processes stopped
+// NOTE: the group must NOT be locked
+int SG_proc_group_reap_idle( struct SG_proc_group* group ) {
+   
+   struct SG_proc* reaped = NULL;
+   struct SG_proc* idle = NULL;
+   struct timespec now;
+   int num_reaped = 0;
+   
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   
+   SG_proc_group_wlock( group );
+   
+   while( (idle = SG_proc_group_reap_idle_unlocked( group, &now )) != NULL ) {
+      SG_proc_list_insert( &reaped, idle );
+   }
+   
+   SG_proc_group_unlock( group );
+   
+   // stop them outside the lock
+   while( (idle = SG_proc_list_pop( &reaped )) != NULL ) {
+      
+      SG_debug("Stop idle process %d in group %p\n", SG_proc_pid( idle ), group );
+      SG_proc_stop( idle, 0 );
+      SG_proc_free( idle );
+      
+      num_reaped++;
+   }
+   
+   return num_reaped;
+}
+
+
+// get a free process, and prevent it from receiving I/O from anyone else (i.e. take it off the free list).
+// if there are no free processes, wait up to timeout_ms milliseconds for one to be released (negative means wait forever).
+// if we have waited SG_PROC_GROUP_GROW_WAIT_MS and the group is below its maximum size, start a new process.
+// a framed process stays on the free list until it has as many callers as its pipeline depth.
+// return the non-NULL proc on success
+// return NULL if the deadline passed, if the group is inactive, or if the group has no processes and cannot start any
+// NOTE: group must NOT be locked
+struct SG_proc* SG_proc_group_acquire_timeout( struct SG_proc_group* group, int64_t timeout_ms ) {
+   
+   int rc = 0;
+   struct SG_proc* proc = NULL;
+   struct timespec start;
+   struct timespec now;
+   struct timespec wake;
+   int64_t waited_ns = 0;
+   int64_t wait_ns = 0;
+   bool waiting = false;
+   bool waited = false;
+   bool grown = false;
+   bool can_grow = false;
+   
+   clock_gettime( CLOCK_MONOTONIC, &start );
+   
+   while( true ) {
+      
+      SG_proc_group_wlock( group );
+      
+      if( waiting ) {
+         group->num_waiters--;
+         waiting = false;
+      }
+      
+      if( !group->active ) {
          
          SG_proc_group_unlock( group );
+         SG_warn("Inactive process group %p\n", group );
          return NULL;
       }
       
-      else {
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      waited_ns = md_timespec_diff( &now, &start );
+      
+      proc = SG_proc_list_pop( &group->free );
+      if( proc != NULL ) {
          
          // acquired! verify its still alive 
          rc = SG_proc_group_remove_if_dead_unlocked( group, proc );
@@ -1637,50 +2736,178 @@ struct SG_proc* SG_proc_group_acquire( struct SG_proc_group* group ) {
             SG_proc_group_unlock( group );
             continue;
          }
-
+         
          // success! 
+         if( proc->inflight == 0 ) {
+            proc->acquired_at = now;
+         }
+         
+         proc->inflight++;
+         if( proc->inflight < proc->max_inflight ) {
+            
+            // framed process with room for more requests; let others acquire it too
+            SG_proc_list_insert( &group->free, proc );
+         }
+         
+         group->stats.num_acquired++;
+         group->stats.total_wait_ns += waited_ns;
+         if( waited_ns > group->stats.max_wait_ns ) {
+            group->stats.max_wait_ns = waited_ns;
+         }
+         
          SG_proc_group_unlock( group );
          return proc;
       }
-   }
-
-   if( !group->active ) {
-      SG_warn("Inactive process group %p\n", group );
+      
+      // no free processes.  can we start one?
+      can_grow = (!grown && group->can_spawn && group->num_procs + group->num_spawning < group->max_procs);
+      
+      if( group->num_procs + group->num_spawning == 0 && !can_grow ) {
+         
+         // ...there are none in the first place, and there never will be 
+         SG_proc_group_unlock( group );
+         SG_warn("No free process in group %p\n", group );
+         return NULL;
+      }
+      
+      if( timeout_ms >= 0 && waited_ns >= timeout_ms * 1000000LL ) {
+         
+         group->stats.num_timeouts++;
+         
+         SG_proc_group_unlock( group );
+         SG_warn("Timed out waiting for a free process in group %p (%" PRId64 " ms)\n", group, timeout_ms );
+         return NULL;
+      }
+      
+      if( can_grow && (group->num_procs == 0 || waited_ns >= SG_PROC_GROUP_GROW_WAIT_MS * 1000000LL) ) {
+         
+         // waited long enough; add a process (at most once per caller)
+         group->num_spawning++;
+         grown = true;
+         
+         SG_proc_group_unlock( group );
+         
+         rc = SG_proc_group_grow( group );
+         if( rc != 0 && rc != -EAGAIN ) {
+            SG_error("SG_proc_group_grow(%p) rc = %d\n", group, rc );
+         }
+         
+         continue;
+      }
+      
+      // wait for a release, for our deadline, or for when we may grow the group 
+      if( !waited ) {
+         group->stats.num_waited++;
+         waited = true;
+      }
+      
+      group->num_waiters++;
+      waiting = true;
+      
+      SG_proc_group_unlock( group );
+      
+      wait_ns = -1;
+      if( timeout_ms >= 0 ) {
+         wait_ns = timeout_ms * 1000000LL - waited_ns;
+      }
+      if( can_grow && (wait_ns < 0 || wait_ns > SG_PROC_GROUP_GROW_WAIT_MS * 1000000LL - waited_ns) ) {
+         wait_ns = SG_PROC_GROUP_GROW_WAIT_MS * 1000000LL - waited_ns;
+      }
+      
+      if( wait_ns < 0 ) {
+         
+         // no deadline 
+         rc = sem_wait( &group->num_free );
+      }
+      else {
+         
+         clock_gettime( CLOCK_REALTIME, &wake );
+         wake.tv_sec += wait_ns / 1000000000LL;
+         wake.tv_nsec += wait_ns % 1000000000LL;
+         if( wake.tv_nsec >= 1000000000L ) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000L;
+         }
+         
+         rc = sem_timedwait( &group->num_free, &wake );
+      }
+      
+      if( rc != 0 ) {
+         
+         rc = -errno;
+         if( rc != -ETIMEDOUT && rc != -EINTR ) {
+            SG_error("sem_timedwait rc = %d\n", rc );
+         }
+      }
    }
    
-   // if we reach here, then it means our process group is dead
+   // not reached 
    return NULL;
 }
 
 
+// get a free process, waiting up to the group's acquisition timeout for one to become available.
+// return the non-NULL proc on success 
+// return NULL if no process could be acquired in time (see SG_proc_group_acquire_timeout)
+// NOTE: group must NOT be locked
+struct SG_proc* SG_proc_group_acquire( struct SG_proc_group* group ) {
+   
+   SG_proc_group_rlock( group );
+   int64_t timeout_ms = group->acquire_timeout_ms;
+   SG_proc_group_unlock( group );
+   
+   return SG_proc_group_acquire_timeout( group, timeout_ms );
+}
+
+
 // release a process now that we've used it (i.e. adding it back to the free list)
+// wakes up a waiting caller.  Idle processes are stopped by SG_proc_group_reap_idle.
 // return 0 on success 
 // NOTE: group must NOT be locked 
 int SG_proc_group_release( struct SG_proc_group* group, struct SG_proc* proc ) {
  
+   int rc = 0;
+   bool was_full = false;
+   
+   SG_proc_group_wlock( group );
+   
+   // a process is on the free list only while it has room for another caller 
+   was_full = (proc->inflight >= proc->max_inflight);
+   proc->inflight--;
+   
    if( proc->dead ) {
-      SG_proc_group_wlock( group );
       SG_proc_group_remove_dead_unlocked( group, proc );
+      SG_proc_group_wake_unlocked( group );
       SG_proc_group_unlock( group );
       return 0;
    }
 
-   SG_proc_group_wlock( group );
-  
-   int rc = SG_proc_group_remove_if_dead_unlocked( group, proc );
-   if( rc < 0 ) {
+   rc = SG_proc_group_remove_if_dead_unlocked( group, proc );
+   if( rc < 0 && rc != -ENOENT ) {
       SG_proc_group_unlock( group );
       SG_error("SG_proc_group_remove_if_dead_unlocked(%p, %p) rc = %d\n", group, proc, rc );
       return rc;
    }
-   if( rc > 0 ) {
-      // dead 
+   if( rc != 0 ) {
+      // dead; waiters may need to grow the group
+      SG_proc_group_wake_unlocked( group );
       SG_proc_group_unlock( group );
       return 0;
    }
+   
+   if( proc->inflight == 0 ) {
       
-   SG_proc_list_insert( &group->free, proc );
-   sem_post( &group->num_free );
+      clock_gettime( CLOCK_MONOTONIC, &proc->idle_since );
+      group->stats.total_busy_ns += md_timespec_diff( &proc->idle_since, &proc->acquired_at );
+   }
+   
+   if( was_full ) {
+      
+      // most-recently-used first, so idle processes collect at the tail
+      SG_proc_list_push( &group->free, proc );
+   }
+   
+   SG_proc_group_wake_unlocked( group );
    
    SG_proc_group_unlock( group );
    
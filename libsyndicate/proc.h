@@ -22,9 +22,61 @@
 #include "libsyndicate/libsyndicate.h"
 #include "libsyndicate/gateway.h"
 
-extern "C" {
+#include <sys/uio.h>
+
+// how long a caller waits for a free process before starting a new one (if the group may grow)
+#define SG_PROC_GROUP_GROW_WAIT_MS      50
+
+// process group statistics 
+struct SG_proc_group_stats {
+   
+   uint64_t num_acquired;       // number of processes handed out
+   uint64_t num_waited;         // number of acquisitions that found no free process, and had to wait
+   uint64_t num_timeouts;       // number of acquisitions that gave up waiting
+   uint64_t num_spawned;        // number of processes started to absorb load
+   uint64_t num_reaped;         // number of idle processes stopped
+   int64_t total_wait_ns;       // total time spent waiting for a free process
+   int64_t max_wait_ns;         // longest time spent waiting for a free process
+   int64_t total_busy_ns;       // total time processes spent acquired 
+   int64_t uptime_ns;           // time since the group was initialized
+   int num_procs;               // number of processes in the group 
+   int num_busy;                // number of processes currently acquired
+   int num_waiters;             // number of callers currently waiting for a free process
+};
+
+// most requests a framed driver process may have in flight at once
+#define SG_PROC_MAX_PIPELINE_DEPTH      256
+
+// framed request payloads at least this big are vmsplice(2)'ed into a worker's pipe instead of copied
+#define SG_PROC_SPLICE_MIN_LEN          65536
+
+// most small buffers to gather into one writev(2)
+#define SG_PROC_WRITEV_MAX              16
+
+// requested capacity of the pipes to and from a worker
+#define SG_PROC_PIPE_SIZE               1048576
 
 struct SG_proc;
+
+// one request/reply exchange with a driver process (see SG_proc_call_init)
+struct SG_proc_call {
+   
+   struct SG_proc* proc;        // process we're talking to
+   
+   // framed protocol only
+   vector<struct iovec>* request;     // request segments; these reference the caller's chunks, which must outlive the call
+   vector<char*>* request_bufs;       // request segments owned by the call
+   size_t request_len;
+   sem_t done;                  // posted once the reply arrives (or the worker dies)
+   int rc;                      // result of waiting for the reply 
+   char* reply_data;            // reply bytes 
+   size_t reply_len;
+   
+   FILE* reply;                 // where to read the reply from 
+};
+
+extern "C" {
+
 struct SG_proc_group;
 
 // allocators and freers
@@ -39,6 +91,7 @@ void SG_proc_group_free( struct SG_proc_group* group );
 pid_t SG_proc_pid( struct SG_proc* p );
 char const* SG_proc_exec_arg( struct SG_proc* p );
 struct SG_proc** SG_proc_group_freelist( struct SG_proc_group* group );
+int SG_proc_group_get_stats( struct SG_proc_group* group, struct SG_proc_group_stats* stats );
 
 int SG_proc_stdin( struct SG_proc* p );
 int SG_proc_stdout( struct SG_proc* p );
@@ -63,8 +116,14 @@ int SG_proc_group_add( struct SG_proc_group* group, struct SG_proc* proc );
 int SG_proc_group_remove( struct SG_proc_group* group, struct SG_proc* proc );
 int SG_proc_group_size( struct SG_proc_group* group );
 
+// autoscaling 
+int SG_proc_group_set_spawn_args( struct SG_proc_group* group, char const* exec_str, char const* exec_arg, char** exec_env, struct SG_chunk* config, struct SG_chunk* secrets, struct SG_chunk* driver );
+int SG_proc_group_set_limits( struct SG_proc_group* group, int min_procs, int max_procs, int64_t acquire_timeout_ms, int64_t idle_timeout_ms );
+int SG_proc_group_reap_idle( struct SG_proc_group* group );
+
 // acquisition/release
 struct SG_proc* SG_proc_group_acquire( struct SG_proc_group* group );
+struct SG_proc* SG_proc_group_acquire_timeout( struct SG_proc_group* group, int64_t timeout_ms );
 int SG_proc_group_release( struct SG_proc_group* group, struct SG_proc* proc );
 
 // locking 
@@ -80,6 +139,15 @@ int SG_proc_write_chunk( int out_fd, struct SG_chunk* chunk );
 int SG_proc_request_init( struct ms_client* ms, struct SG_request_data* reqdat, SG_messages::DriverRequest* dreq );
 int SG_proc_write_request( int fd, SG_messages::DriverRequest* dreq );
 bool SG_proc_is_dead( struct SG_proc* proc );
+bool SG_proc_is_framed( struct SG_proc* proc );
+
+// request/reply exchanges (work with both the original and the framed protocol)
+int SG_proc_call_init( struct SG_proc_call* call, struct SG_proc* proc );
+int SG_proc_call_write_request( struct SG_proc_call* call, SG_messages::DriverRequest* dreq );
+int SG_proc_call_write_chunk( struct SG_proc_call* call, struct SG_chunk* chunk );
+int SG_proc_call_send( struct SG_proc_call* call );
+FILE* SG_proc_call_reply( struct SG_proc_call* call );
+void SG_proc_call_free( struct SG_proc_call* call );
 
 // one-off subprocess in a subshell with bound output 
 int SG_proc_subprocess( char const* cmd_path, char* const argv[], char* const env[], char const* input, size_t input_len, char** output, size_t* output_len, size_t max_output, int* exit_status );
@@ -0,0 +1,1324 @@
+/*
+   Copyright 2014 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "libsyndicate/segstore.h"
+#include "libsyndicate/storage.h"
+#include "libsyndicate/util.h"
+
+#include <sys/mman.h>
+
+// lock primitives for the segment store
+static int md_segstore_rlock( struct md_segstore* store ) {
+   return pthread_rwlock_rdlock( &store->lock );
+}
+
+static int md_segstore_wlock( struct md_segstore* store ) {
+   return pthread_rwlock_wrlock( &store->lock );
+}
+
+static int md_segstore_unlock( struct md_segstore* store ) {
+   return pthread_rwlock_unlock( &store->lock );
+}
+
+
+// length of a record on disk, given the length of its data
+static uint64_t md_segstore_record_len( uint64_t len ) {
+   return sizeof(struct md_segstore_record_header) + len;
+}
+
+
+// crc32 of a block's data
+static uint32_t md_segstore_crc( char const* data, uint64_t len ) {
+
+   uLong crc = crc32( 0L, Z_NULL, 0 );
+
+   while( len > 0 ) {
+
+      uInt n = (uInt)MIN( len, (uint64_t)(1 << 30) );
+
+      crc = crc32( crc, (Bytef const*)data, n );
+
+      data += n;
+      len -= n;
+   }
+
+   return (uint32_t)crc;
+}
+
+
+// read len bytes at a given offset, retrying on interruption
+// return the number of bytes read on success (short only on EOF)
+// return -errno on error
+static ssize_t md_segstore_pread( int fd, char* buf, size_t len, off_t offset ) {
+
+   ssize_t num_read = 0;
+   while( (size_t)num_read < len ) {
+
+      ssize_t nr = pread( fd, buf + num_read, len - num_read, offset + num_read );
+      if( nr < 0 ) {
+
+         int errsv = -errno;
+         if( errsv == -EINTR ) {
+            continue;
+         }
+
+         return errsv;
+      }
+      if( nr == 0 ) {
+         break;
+      }
+
+      num_read += nr;
+   }
+
+   return num_read;
+}
+
+
+// write len bytes at a given offset, retrying on interruption
+// return 0 on success
+// return -errno on error
+static int md_segstore_pwrite( int fd, char const* buf, size_t len, off_t offset ) {
+
+   size_t num_written = 0;
+   while( num_written < len ) {
+
+      ssize_t nw = pwrite( fd, buf + num_written, len - num_written, offset + num_written );
+      if( nw < 0 ) {
+
+         int errsv = -errno;
+         if( errsv == -EINTR ) {
+            continue;
+         }
+
+         return errsv;
+      }
+
+      num_written += nw;
+   }
+
+   return 0;
+}
+
+
+// fill in a record header for a block
+static void md_segstore_header_init( struct md_segstore_record_header* hdr, struct md_cache_entry_key* key, uint64_t len, uint32_t data_crc ) {
+
+   memset( hdr, 0, sizeof(struct md_segstore_record_header) );
+
+   hdr->magic = MD_SEGSTORE_RECORD_MAGIC;
+   hdr->data_crc = data_crc;
+   hdr->file_id = key->file_id;
+   hdr->file_version = key->file_version;
+   hdr->block_id = key->block_id;
+   hdr->block_version = key->block_version;
+   hdr->len = len;
+}
+
+
+// find a segment by ID.
+// store must be read-locked
+// return the segment on success
+// return NULL if there is no such segment
+static struct md_segstore_segment* md_segstore_segment_lookup( struct md_segstore* store, uint64_t segment_id ) {
+
+   md_segstore_segments_t::iterator itr = store->segments->find( segment_id );
+   if( itr == store->segments->end() ) {
+      return NULL;
+   }
+
+   return itr->second;
+}
+
+
+// mark a reserved record as dead, so scans and compaction can step over it.
+// return 0 on success
+// return -errno on I/O error
+static int md_segstore_mark_dead( struct md_segstore_segment* seg, off_t offset, uint64_t len ) {
+
+   struct md_segstore_record_header hdr;
+
+   memset( &hdr, 0, sizeof(hdr) );
+   hdr.magic = MD_SEGSTORE_RECORD_MAGIC;
+   hdr.flags = MD_SEGSTORE_RECORD_DEAD;
+   hdr.len = len;
+
+   return md_segstore_pwrite( seg->fd, (char const*)&hdr, sizeof(hdr), offset );
+}
+
+
+// get the path to a segment file
+// return the path on success
+// return NULL on OOM
+static char* md_segstore_segment_path( struct md_segstore* store, uint64_t segment_id ) {
+
+   char* path = SG_CALLOC( char, strlen(store->root) + 1 + 16 + strlen(MD_SEGSTORE_SEGMENT_SUFFIX) + 1 );
+   if( path == NULL ) {
+      return NULL;
+   }
+
+   sprintf( path, "%s/%016" PRIX64 "%s", store->root, segment_id, MD_SEGSTORE_SEGMENT_SUFFIX );
+   return path;
+}
+
+
+// open (or create) a segment file, and add it to the store.
+// store must be write-locked, or not yet shared.
+// return the segment on success
+// return NULL on error, and set *_rc to -ENOMEM on OOM or -errno on open(2) failure
+static struct md_segstore_segment* md_segstore_segment_open( struct md_segstore* store, uint64_t segment_id, int flags, int* _rc ) {
+
+   struct md_segstore_segment* seg = NULL;
+   char* path = NULL;
+   int fd = -1;
+
+   path = md_segstore_segment_path( store, segment_id );
+   if( path == NULL ) {
+
+      *_rc = -ENOMEM;
+      return NULL;
+   }
+
+   seg = SG_CALLOC( struct md_segstore_segment, 1 );
+   if( seg == NULL ) {
+
+      SG_safe_free( path );
+      *_rc = -ENOMEM;
+      return NULL;
+   }
+
+   fd = open( path, flags | O_RDWR, 0600 );
+   if( fd < 0 ) {
+
+      *_rc = -errno;
+      SG_error("open(%s) rc = %d\n", path, *_rc );
+
+      SG_safe_free( seg );
+      SG_safe_free( path );
+      return NULL;
+   }
+
+   SG_safe_free( path );
+
+   seg->id = segment_id;
+   seg->fd = fd;
+
+   try {
+      (*store->segments)[ segment_id ] = seg;
+   }
+   catch( bad_alloc& ba ) {
+
+      close( fd );
+      SG_safe_free( seg );
+      *_rc = -ENOMEM;
+      return NULL;
+   }
+
+   *_rc = 0;
+   return seg;
+}
+
+
+// close and unlink a segment, and remove it from the store.
+// store must be write-locked, or not yet shared.
+// always succeeds
+static void md_segstore_segment_remove( struct md_segstore* store, struct md_segstore_segment* seg ) {
+
+   char* path = md_segstore_segment_path( store, seg->id );
+   if( path != NULL ) {
+
+      if( unlink( path ) != 0 ) {
+         SG_warn("unlink(%s) errno = %d\n", path, -errno );
+      }
+
+      SG_safe_free( path );
+   }
+
+   store->segments->erase( seg->id );
+   store->total_bytes -= seg->size;
+
+   if( store->active == seg ) {
+      store->active = NULL;
+   }
+
+   close( seg->fd );
+   SG_safe_free( seg );
+}
+
+
+// reserve space for a record at the end of the log, starting a new segment if the active one is full.
+// store must be write-locked.
+// return 0 on success, and set *ret_seg and *ret_offset to where the record goes
+// return -ENOMEM on OOM
+// return -errno if we could not create a new segment
+static int md_segstore_append_reserve( struct md_segstore* store, uint64_t record_len, struct md_segstore_segment** ret_seg, off_t* ret_offset ) {
+
+   int rc = 0;
+   struct md_segstore_segment* seg = store->active;
+
+   if( seg == NULL || (seg->size > 0 && seg->size + (off_t)record_len > store->segment_size) ) {
+
+      // roll over to a new segment; the old one is sealed
+      seg = md_segstore_segment_open( store, store->next_segment_id, O_CREAT | O_EXCL, &rc );
+      if( seg == NULL ) {
+
+         SG_error("md_segstore_segment_open(%" PRIX64 ") rc = %d\n", store->next_segment_id, rc );
+         return rc;
+      }
+
+      store->next_segment_id++;
+      store->active = seg;
+   }
+
+   *ret_seg = seg;
+   *ret_offset = seg->size;
+
+   seg->size += record_len;
+   seg->pending_writes++;
+   store->total_bytes += record_len;
+
+   return 0;
+}
+
+
+// scan a segment's records into the index, recovering the blocks it holds.
+// stop at the first torn or invalid header, and truncate the segment there.
+// records whose data does not match its CRC (i.e. the header reached the disk but the data did not) are marked dead.
+// store must not yet be shared.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int md_segstore_segment_scan( struct md_segstore* store, struct md_segstore_segment* seg, md_cache_lru_t* recovered ) {
+
+   int rc = 0;
+   struct stat sb;
+   off_t offset = 0;
+   ssize_t nr = 0;
+   struct md_segstore_record_header hdr;
+   struct md_cache_entry_key key;
+   struct md_segstore_extent extent;
+   char* data = NULL;
+
+   rc = fstat( seg->fd, &sb );
+   if( rc != 0 ) {
+
+      rc = -errno;
+      SG_error("fstat(%d) rc = %d\n", seg->fd, rc );
+      return rc;
+   }
+
+   while( offset + (off_t)sizeof(hdr) <= sb.st_size ) {
+
+      nr = md_segstore_pread( seg->fd, (char*)&hdr, sizeof(hdr), offset );
+      if( nr < 0 ) {
+
+         SG_error("md_segstore_pread(%" PRIX64 " @%jd) rc = %zd\n", seg->id, (intmax_t)offset, nr );
+         return (int)nr;
+      }
+
+      if( (size_t)nr < sizeof(hdr) || hdr.magic != MD_SEGSTORE_RECORD_MAGIC || hdr.len > (uint64_t)(sb.st_size - offset - (off_t)sizeof(hdr)) ) {
+
+         // torn append
+         break;
+      }
+
+      if( hdr.flags & MD_SEGSTORE_RECORD_DEAD ) {
+
+         // aborted append, or evicted block
+         offset += md_segstore_record_len( hdr.len );
+         continue;
+      }
+
+      data = SG_CALLOC( char, hdr.len + 1 );
+      if( data == NULL ) {
+         return -ENOMEM;
+      }
+
+      nr = md_segstore_pread( seg->fd, data, hdr.len, offset + sizeof(hdr) );
+      if( nr < 0 ) {
+
+         SG_error("md_segstore_pread(%" PRIX64 " @%jd) rc = %zd\n", seg->id, (intmax_t)offset, nr );
+         SG_safe_free( data );
+         return (int)nr;
+      }
+
+      if( (uint64_t)nr != hdr.len || md_segstore_crc( data, hdr.len ) != hdr.data_crc ) {
+
+         // header without its data
+         SG_warn("Segment %" PRIX64 " has a corrupt record at %jd; dropping it\n", seg->id, (intmax_t)offset );
+
+         SG_safe_free( data );
+
+         rc = md_segstore_mark_dead( seg, offset, hdr.len );
+         if( rc != 0 ) {
+
+            SG_error("md_segstore_mark_dead(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)offset, rc );
+            return rc;
+         }
+
+         offset += md_segstore_record_len( hdr.len );
+         continue;
+      }
+
+      SG_safe_free( data );
+
+      memset( &key, 0, sizeof(key) );
+      key.file_id = hdr.file_id;
+      key.file_version = hdr.file_version;
+      key.block_id = hdr.block_id;
+      key.block_version = hdr.block_version;
+
+      // a later copy of a block (i.e. from compaction) supersedes an earlier one
+      md_segstore_index_t::iterator itr = store->index->find( key );
+      if( itr != store->index->end() ) {
+
+         struct md_segstore_segment* old_seg = md_segstore_segment_lookup( store, itr->second.segment_id );
+         if( old_seg != NULL ) {
+            old_seg->live_bytes -= md_segstore_record_len( itr->second.len );
+         }
+
+         store->live_bytes -= md_segstore_record_len( itr->second.len );
+      }
+
+      extent.segment_id = seg->id;
+      extent.offset = offset;
+      extent.len = hdr.len;
+      extent.data_crc = hdr.data_crc;
+      extent.ready = true;
+
+      try {
+         (*store->index)[ key ] = extent;
+
+         if( recovered != NULL ) {
+            recovered->push_back( key );
+         }
+      }
+      catch( bad_alloc& ba ) {
+         return -ENOMEM;
+      }
+
+      seg->live_bytes += md_segstore_record_len( hdr.len );
+      store->live_bytes += md_segstore_record_len( hdr.len );
+
+      offset += md_segstore_record_len( hdr.len );
+   }
+
+   if( offset < sb.st_size ) {
+
+      SG_warn("Segment %" PRIX64 " has a torn record at %jd; truncating\n", seg->id, (intmax_t)offset );
+
+      rc = ftruncate( seg->fd, offset );
+      if( rc != 0 ) {
+
+         rc = -errno;
+         SG_error("ftruncate(%d) rc = %d\n", seg->fd, rc );
+         return rc;
+      }
+   }
+
+   seg->size = offset;
+   store->total_bytes += offset;
+
+   return 0;
+}
+
+
+// set up a segment store in a directory, recovering the blocks in any segments already there.
+// recovered blocks are appended to *recovered (if not NULL) in the order they were written.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -EINVAL if segment_size is not positive
+// return -errno if we could not create or read the directory, or read a segment
+int md_segstore_init( struct md_segstore* store, char const* root, off_t segment_size, md_cache_lru_t* recovered ) {
+
+   int rc = 0;
+   DIR* dir = NULL;
+   struct dirent* dent = NULL;
+   uint64_t segment_id = 0;
+   char suffix[32];
+   set<uint64_t> segment_ids;
+
+   if( segment_size <= 0 ) {
+      return -EINVAL;
+   }
+
+   memset( store, 0, sizeof(struct md_segstore) );
+
+   rc = pthread_rwlock_init( &store->lock, NULL );
+   if( rc != 0 ) {
+      return -rc;
+   }
+
+   store->segment_size = segment_size;
+   store->root = SG_strdup_or_null( root );
+   store->index = SG_safe_new( md_segstore_index_t() );
+   store->segments = SG_safe_new( md_segstore_segments_t() );
+
+   if( store->root == NULL || store->index == NULL || store->segments == NULL ) {
+
+      md_segstore_shutdown( store );
+      return -ENOMEM;
+   }
+
+   rc = md_mkdirs3( store->root, 0700 );
+   if( rc != 0 ) {
+
+      SG_error("md_mkdirs3(%s) rc = %d\n", store->root, rc );
+      md_segstore_shutdown( store );
+      return rc;
+   }
+
+   // find existing segments
+   dir = opendir( store->root );
+   if( dir == NULL ) {
+
+      rc = -errno;
+      SG_error("opendir(%s) rc = %d\n", store->root, rc );
+      md_segstore_shutdown( store );
+      return rc;
+   }
+
+   while( (dent = readdir( dir )) != NULL ) {
+
+      if( sscanf( dent->d_name, "%" SCNx64 "%31s", &segment_id, suffix ) != 2 || strcmp( suffix, MD_SEGSTORE_SEGMENT_SUFFIX ) != 0 ) {
+         continue;
+      }
+
+      try {
+         segment_ids.insert( segment_id );
+      }
+      catch( bad_alloc& ba ) {
+
+         closedir( dir );
+         md_segstore_shutdown( store );
+         return -ENOMEM;
+      }
+   }
+
+   closedir( dir );
+
+   // replay them, oldest first
+   for( set<uint64_t>::iterator itr = segment_ids.begin(); itr != segment_ids.end(); itr++ ) {
+
+      struct md_segstore_segment* seg = md_segstore_segment_open( store, *itr, 0, &rc );
+      if( seg == NULL ) {
+
+         SG_error("md_segstore_segment_open(%" PRIX64 ") rc = %d\n", *itr, rc );
+         md_segstore_shutdown( store );
+         return rc;
+      }
+
+      rc = md_segstore_segment_scan( store, seg, recovered );
+      if( rc != 0 ) {
+
+         SG_error("md_segstore_segment_scan(%" PRIX64 ") rc = %d\n", *itr, rc );
+         md_segstore_shutdown( store );
+         return rc;
+      }
+
+      store->next_segment_id = *itr + 1;
+   }
+
+   // drop segments with nothing left in them
+   for( set<uint64_t>::iterator itr = segment_ids.begin(); itr != segment_ids.end(); itr++ ) {
+
+      struct md_segstore_segment* seg = (*store->segments)[ *itr ];
+      if( seg->live_bytes == 0 ) {
+
+         md_segstore_segment_remove( store, seg );
+      }
+   }
+
+   // new appends always go to a new segment, so they never follow a truncated tail
+   store->active = NULL;
+
+   SG_debug("Segment store %s: %zu segments, %zu blocks, %" PRIu64 " bytes (%" PRIu64 " live)\n",
+            store->root, store->segments->size(), store->index->size(), store->total_bytes, store->live_bytes );
+
+   return 0;
+}
+
+
+// shut down a segment store, syncing and closing its segments.
+// the cache must not be using it anymore.
+// always succeeds
+int md_segstore_shutdown( struct md_segstore* store ) {
+
+   if( store->segments != NULL ) {
+
+      for( md_segstore_segments_t::iterator itr = store->segments->begin(); itr != store->segments->end(); itr++ ) {
+
+         struct md_segstore_segment* seg = itr->second;
+
+         fdatasync( seg->fd );
+         close( seg->fd );
+         SG_safe_free( seg );
+      }
+   }
+
+   SG_safe_delete( store->segments );
+   SG_safe_delete( store->index );
+   SG_safe_free( store->root );
+
+   store->active = NULL;
+
+   pthread_rwlock_destroy( &store->lock );
+
+   return 0;
+}
+
+
+// reserve space at the end of the log for a block's data.
+// the block is indexed, but is not readable until it is committed with md_segstore_commit.
+// the caller writes the len bytes at data to *fd at *data_offset; the fd belongs to the store and must not be closed.
+// return 0 on success
+// return -EEXIST if the block is already present (or being appended)
+// return -ENOMEM on OOM
+// return -errno if we could not create a new segment
+int md_segstore_reserve( struct md_segstore* store, struct md_cache_entry_key* key, char const* data, size_t len, int* fd, off_t* data_offset ) {
+
+   int rc = 0;
+   struct md_segstore_segment* seg = NULL;
+   off_t offset = 0;
+   struct md_segstore_extent extent;
+   uint32_t data_crc = md_segstore_crc( data, len );
+
+   md_segstore_wlock( store );
+
+   if( store->index->find( *key ) != store->index->end() ) {
+
+      md_segstore_unlock( store );
+      return -EEXIST;
+   }
+
+   rc = md_segstore_append_reserve( store, md_segstore_record_len( len ), &seg, &offset );
+   if( rc != 0 ) {
+
+      md_segstore_unlock( store );
+      return rc;
+   }
+
+   extent.segment_id = seg->id;
+   extent.offset = offset;
+   extent.len = len;
+   extent.data_crc = data_crc;
+   extent.ready = false;
+
+   try {
+      (*store->index)[ *key ] = extent;
+   }
+   catch( bad_alloc& ba ) {
+
+      // the reserved space is simply dead
+      md_segstore_mark_dead( seg, offset, len );
+      seg->pending_writes--;
+      md_segstore_unlock( store );
+      return -ENOMEM;
+   }
+
+   *fd = seg->fd;
+   *data_offset = offset + sizeof(struct md_segstore_record_header);
+
+   md_segstore_unlock( store );
+
+   return 0;
+}
+
+
+// commit a reserved block, once its data has been written.
+// write its record header, and make it readable.
+// return 0 on success
+// return -ENOENT if the block was not reserved
+// return -errno if we failed to write the header (in which case the reservation is aborted)
+int md_segstore_commit( struct md_segstore* store, struct md_cache_entry_key* key ) {
+
+   int rc = 0;
+   struct md_segstore_extent extent;
+   struct md_segstore_segment* seg = NULL;
+   struct md_segstore_record_header hdr;
+
+   md_segstore_rlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->find( *key );
+   if( itr == store->index->end() || itr->second.ready ) {
+
+      md_segstore_unlock( store );
+      return -ENOENT;
+   }
+
+   extent = itr->second;
+   seg = md_segstore_segment_lookup( store, extent.segment_id );
+
+   md_segstore_unlock( store );
+
+   if( seg == NULL ) {
+
+      SG_error("BUG: no segment %" PRIX64 "\n", extent.segment_id );
+      exit(1);
+   }
+
+   // the segment can't go away while it has pending writes.
+   // the data may not be on disk yet; if it never gets there, the CRC will say so on restart
+   md_segstore_header_init( &hdr, key, extent.len, extent.data_crc );
+
+   rc = md_segstore_pwrite( seg->fd, (char const*)&hdr, sizeof(hdr), extent.offset );
+   if( rc != 0 ) {
+
+      SG_error("md_segstore_pwrite(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)extent.offset, rc );
+
+      md_segstore_abort( store, key );
+      return rc;
+   }
+
+   md_segstore_wlock( store );
+
+   itr = store->index->find( *key );
+   if( itr != store->index->end() ) {
+
+      itr->second.ready = true;
+
+      seg->live_bytes += md_segstore_record_len( extent.len );
+      store->live_bytes += md_segstore_record_len( extent.len );
+   }
+
+   seg->pending_writes--;
+
+   md_segstore_unlock( store );
+
+   return 0;
+}
+
+
+// abort a reserved block, i.e. because its data could not be written.
+// its space becomes dead, and will be reclaimed by compaction.
+// return 0 on success
+// return -ENOENT if the block was not reserved
+int md_segstore_abort( struct md_segstore* store, struct md_cache_entry_key* key ) {
+
+   int rc = 0;
+
+   md_segstore_wlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->find( *key );
+   if( itr == store->index->end() || itr->second.ready ) {
+
+      md_segstore_unlock( store );
+      return -ENOENT;
+   }
+
+   struct md_segstore_segment* seg = md_segstore_segment_lookup( store, itr->second.segment_id );
+   if( seg != NULL ) {
+
+      rc = md_segstore_mark_dead( seg, itr->second.offset, itr->second.len );
+      if( rc != 0 ) {
+
+         // a restart will truncate the segment here
+         SG_warn("md_segstore_mark_dead(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)itr->second.offset, rc );
+      }
+
+      seg->pending_writes--;
+   }
+
+   store->index->erase( itr );
+
+   md_segstore_unlock( store );
+
+   return 0;
+}
+
+
+// read a block in its entirety, and check it against its CRC.
+// return the number of bytes read on success, and set *buf to a newly-allocated buffer with the data
+// return -ENOENT if the block is not present (or not yet committed)
+// return -ENOMEM on OOM
+// return -ENODATA if the segment is shorter than the index says
+// return -EBADMSG if the data does not match its CRC
+// return -errno on I/O error
+ssize_t md_segstore_read( struct md_segstore* store, struct md_cache_entry_key* key, char** buf ) {
+
+   ssize_t nr = 0;
+   char* block_buf = NULL;
+   struct md_segstore_extent extent;
+
+   // hold the lock across the read, so compaction can't unlink the segment out from under us
+   md_segstore_rlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->find( *key );
+   if( itr == store->index->end() || !itr->second.ready ) {
+
+      md_segstore_unlock( store );
+      return -ENOENT;
+   }
+
+   extent = itr->second;
+   struct md_segstore_segment* seg = md_segstore_segment_lookup( store, extent.segment_id );
+
+   if( seg == NULL ) {
+
+      SG_error("BUG: no segment %" PRIX64 "\n", extent.segment_id );
+      exit(1);
+   }
+
+   block_buf = SG_CALLOC( char, extent.len + 1 );
+   if( block_buf == NULL ) {
+
+      md_segstore_unlock( store );
+      return -ENOMEM;
+   }
+
+   nr = md_segstore_pread( seg->fd, block_buf, extent.len, extent.offset + sizeof(struct md_segstore_record_header) );
+   if( nr >= 0 && (uint64_t)nr != extent.len ) {
+
+      SG_error("Segment %" PRIX64 " is truncated: expected %" PRIu64 " bytes at %jd, got %zd\n", seg->id, extent.len, (intmax_t)extent.offset, nr );
+      nr = -ENODATA;
+   }
+
+   md_segstore_unlock( store );
+
+   if( nr >= 0 && md_segstore_crc( block_buf, extent.len ) != extent.data_crc ) {
+
+      SG_error("Segment %" PRIX64 " has a corrupt block at %jd\n", extent.segment_id, (intmax_t)extent.offset );
+      nr = -EBADMSG;
+   }
+
+   if( nr < 0 ) {
+
+      SG_safe_free( block_buf );
+      return nr;
+   }
+
+   *buf = block_buf;
+   return nr;
+}
+
+
+// make an anonymous, seekable file descriptor
+// return the fd on success
+// return -errno on failure
+static int md_segstore_anon_fd( struct md_segstore* store ) {
+
+   int fd = -1;
+
+#ifdef MFD_CLOEXEC
+   fd = memfd_create( "syndicate-block", MFD_CLOEXEC );
+#else
+   fd = open( store->root, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600 );
+#endif
+
+   if( fd < 0 ) {
+      fd = -errno;
+   }
+
+   return fd;
+}
+
+
+// open a block, for callers that need a file descriptor to it.
+// the fd refers to a private, anonymous copy of the block, which starts at offset 0 and is as long as the block.
+// return the fd on success
+// return -ENOENT if the block is not present
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int md_segstore_open( struct md_segstore* store, struct md_cache_entry_key* key ) {
+
+   int rc = 0;
+   int fd = -1;
+   char* buf = NULL;
+   ssize_t len = 0;
+
+   len = md_segstore_read( store, key, &buf );
+   if( len < 0 ) {
+      return (int)len;
+   }
+
+   fd = md_segstore_anon_fd( store );
+   if( fd < 0 ) {
+
+      SG_error("md_segstore_anon_fd rc = %d\n", fd );
+      SG_safe_free( buf );
+      return fd;
+   }
+
+   rc = md_segstore_pwrite( fd, buf, len, 0 );
+   SG_safe_free( buf );
+
+   if( rc != 0 ) {
+
+      SG_error("md_segstore_pwrite(%d) rc = %d\n", fd, rc );
+      close( fd );
+      return rc;
+   }
+
+   return fd;
+}
+
+
+// stat a block.  Only st_mode, st_nlink, st_size, st_blksize, and st_blocks are filled in.
+// return 0 on success
+// return -ENOENT if the block is not present
+int md_segstore_stat( struct md_segstore* store, struct md_cache_entry_key* key, struct stat* sb ) {
+
+   md_segstore_rlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->find( *key );
+   if( itr == store->index->end() || !itr->second.ready ) {
+
+      md_segstore_unlock( store );
+      return -ENOENT;
+   }
+
+   memset( sb, 0, sizeof(struct stat) );
+
+   sb->st_mode = S_IFREG | 0600;
+   sb->st_nlink = 1;
+   sb->st_size = itr->second.len;
+   sb->st_blksize = 4096;
+   sb->st_blocks = (itr->second.len + 511) / 512;
+
+   md_segstore_unlock( store );
+
+   return 0;
+}
+
+
+// the first possible key for a file
+static void md_segstore_file_key_lower( struct md_cache_entry_key* key, uint64_t file_id, int64_t file_version ) {
+
+   memset( key, 0, sizeof(struct md_cache_entry_key) );
+   key->file_id = file_id;
+   key->file_version = file_version;
+   key->block_id = 0;
+   key->block_version = INT64_MIN;
+}
+
+
+// get the list of a file's committed blocks, in block order
+// return 0 on success, and append them to *blocks
+// return -ENOENT if no blocks of this file are present
+// return -ENOMEM on OOM
+int md_segstore_file_blocks( struct md_segstore* store, uint64_t file_id, int64_t file_version, md_cache_lru_t* blocks ) {
+
+   int rc = -ENOENT;
+   struct md_cache_entry_key lower;
+
+   md_segstore_file_key_lower( &lower, file_id, file_version );
+
+   md_segstore_rlock( store );
+
+   for( md_segstore_index_t::iterator itr = store->index->lower_bound( lower ); itr != store->index->end(); itr++ ) {
+
+      if( itr->first.file_id != file_id || itr->first.file_version != file_version ) {
+         break;
+      }
+
+      if( !itr->second.ready ) {
+         continue;
+      }
+
+      try {
+         blocks->push_back( itr->first );
+      }
+      catch( bad_alloc& ba ) {
+
+         rc = -ENOMEM;
+         break;
+      }
+
+      rc = 0;
+   }
+
+   md_segstore_unlock( store );
+
+   return rc;
+}
+
+
+// drop an indexed, committed block, and mark its record dead so it stays gone after a restart.
+// store must be write-locked.
+static void md_segstore_evict_locked( struct md_segstore* store, md_segstore_index_t::iterator itr ) {
+
+   int rc = 0;
+   uint64_t record_len = md_segstore_record_len( itr->second.len );
+
+   struct md_segstore_segment* seg = md_segstore_segment_lookup( store, itr->second.segment_id );
+   if( seg != NULL ) {
+
+      rc = md_segstore_mark_dead( seg, itr->second.offset, itr->second.len );
+      if( rc != 0 ) {
+
+         // the block comes back on restart, which is harmless
+         SG_warn("md_segstore_mark_dead(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)itr->second.offset, rc );
+      }
+
+      seg->live_bytes -= record_len;
+   }
+
+   store->live_bytes -= record_len;
+   store->index->erase( itr );
+}
+
+
+// evict a block.  Its space will be reclaimed by compaction.
+// return 0 on success
+// return -ENOENT if the block is not present (or not yet committed)
+int md_segstore_evict( struct md_segstore* store, struct md_cache_entry_key* key ) {
+
+   md_segstore_wlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->find( *key );
+   if( itr == store->index->end() || !itr->second.ready ) {
+
+      md_segstore_unlock( store );
+      return -ENOENT;
+   }
+
+   md_segstore_evict_locked( store, itr );
+
+   md_segstore_unlock( store );
+
+   return 0;
+}
+
+
+// evict all of a file's committed blocks
+// return the number of blocks evicted
+int md_segstore_evict_file( struct md_segstore* store, uint64_t file_id, int64_t file_version ) {
+
+   int count = 0;
+   struct md_cache_entry_key lower;
+
+   md_segstore_file_key_lower( &lower, file_id, file_version );
+
+   md_segstore_wlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->lower_bound( lower );
+   while( itr != store->index->end() && itr->first.file_id == file_id && itr->first.file_version == file_version ) {
+
+      md_segstore_index_t::iterator next = itr;
+      next++;
+
+      if( itr->second.ready ) {
+
+         md_segstore_evict_locked( store, itr );
+         count++;
+      }
+
+      itr = next;
+   }
+
+   md_segstore_unlock( store );
+
+   return count;
+}
+
+
+// move a file's committed blocks to a new file version.
+// rewrite each block's record header in place, so the new version survives a restart.
+// blocks already present under the new version are left alone.
+// return 0 on success, and append the new keys to *new_keys
+// return -ENOMEM on OOM
+int md_segstore_reversion_file( struct md_segstore* store, uint64_t file_id, int64_t old_file_version, int64_t new_file_version, md_cache_lru_t* new_keys ) {
+
+   int rc = 0;
+   struct md_cache_entry_key lower;
+   struct md_segstore_record_header hdr;
+
+   md_segstore_file_key_lower( &lower, file_id, old_file_version );
+
+   md_segstore_wlock( store );
+
+   md_segstore_index_t::iterator itr = store->index->lower_bound( lower );
+   while( itr != store->index->end() && itr->first.file_id == file_id && itr->first.file_version == old_file_version ) {
+
+      md_segstore_index_t::iterator next = itr;
+      next++;
+
+      if( !itr->second.ready ) {
+
+         itr = next;
+         continue;
+      }
+
+      struct md_cache_entry_key new_key = itr->first;
+      struct md_segstore_extent extent = itr->second;
+
+      new_key.file_version = new_file_version;
+
+      if( store->index->find( new_key ) != store->index->end() ) {
+
+         itr = next;
+         continue;
+      }
+
+      try {
+         (*store->index)[ new_key ] = extent;
+         new_keys->push_back( new_key );
+      }
+      catch( bad_alloc& ba ) {
+
+         rc = -ENOMEM;
+         break;
+      }
+
+      store->index->erase( itr );
+
+      // if this fails, the block reverts to its old version on restart, which is harmless
+      struct md_segstore_segment* seg = md_segstore_segment_lookup( store, extent.segment_id );
+      if( seg == NULL ) {
+
+         SG_error("BUG: no segment %" PRIX64 "\n", extent.segment_id );
+         exit(1);
+      }
+
+      md_segstore_header_init( &hdr, &new_key, extent.len, extent.data_crc );
+
+      int write_rc = md_segstore_pwrite( seg->fd, (char const*)&hdr, sizeof(hdr), extent.offset );
+      if( write_rc != 0 ) {
+
+         SG_warn("md_segstore_pwrite(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)extent.offset, write_rc );
+      }
+
+      itr = next;
+   }
+
+   md_segstore_unlock( store );
+
+   return rc;
+}
+
+
+// copy a live record to the end of the log, and point the index at the copy if the block is still there.
+// only the compactor calls this.
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+static int md_segstore_compact_record( struct md_segstore* store, struct md_segstore_segment* victim, struct md_segstore_record_header* hdr, off_t offset ) {
+
+   int rc = 0;
+   char* buf = NULL;
+   ssize_t nr = 0;
+   uint64_t record_len = md_segstore_record_len( hdr->len );
+   struct md_segstore_segment* seg = NULL;
+   off_t new_offset = 0;
+
+   struct md_cache_entry_key key;
+   memset( &key, 0, sizeof(key) );
+
+   key.file_id = hdr->file_id;
+   key.file_version = hdr->file_version;
+   key.block_id = hdr->block_id;
+   key.block_version = hdr->block_version;
+
+   buf = SG_CALLOC( char, record_len );
+   if( buf == NULL ) {
+      return -ENOMEM;
+   }
+
+   // only we remove segments, so no lock is needed to read the victim
+   nr = md_segstore_pread( victim->fd, buf, record_len, offset );
+   if( nr < 0 || (uint64_t)nr != record_len ) {
+
+      SG_error("md_segstore_pread(%" PRIX64 " @%jd) rc = %zd\n", victim->id, (intmax_t)offset, nr );
+      SG_safe_free( buf );
+      return nr < 0 ? (int)nr : -ENODATA;
+   }
+
+   md_segstore_wlock( store );
+
+   rc = md_segstore_append_reserve( store, record_len, &seg, &new_offset );
+
+   md_segstore_unlock( store );
+
+   if( rc != 0 ) {
+
+      SG_safe_free( buf );
+      return rc;
+   }
+
+   // data first, then the header (which carries the data's CRC, so a copy torn by a crash is dropped on restart)
+   rc = md_segstore_pwrite( seg->fd, buf + sizeof(struct md_segstore_record_header), hdr->len, new_offset + sizeof(struct md_segstore_record_header) );
+   if( rc == 0 ) {
+      rc = md_segstore_pwrite( seg->fd, buf, sizeof(struct md_segstore_record_header), new_offset );
+   }
+
+   SG_safe_free( buf );
+
+   md_segstore_wlock( store );
+
+   seg->pending_writes--;
+
+   if( rc == 0 ) {
+
+      md_segstore_index_t::iterator itr = store->index->find( key );
+      if( itr != store->index->end() && itr->second.ready && itr->second.segment_id == victim->id && itr->second.offset == offset ) {
+
+         // still live; move it
+         itr->second.segment_id = seg->id;
+         itr->second.offset = new_offset;
+
+         victim->live_bytes -= record_len;
+         seg->live_bytes += record_len;
+
+         // if we crash before the victim is unlinked, only the copy comes back (so a later eviction of it sticks)
+         int dead_rc = md_segstore_mark_dead( victim, offset, hdr->len );
+         if( dead_rc != 0 ) {
+            SG_warn("md_segstore_mark_dead(%" PRIX64 " @%jd) rc = %d\n", victim->id, (intmax_t)offset, dead_rc );
+         }
+      }
+      else {
+
+         // evicted while we copied it; don't let the copy come back on restart
+         int dead_rc = md_segstore_mark_dead( seg, new_offset, hdr->len );
+         if( dead_rc != 0 ) {
+            SG_warn("md_segstore_mark_dead(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)new_offset, dead_rc );
+         }
+      }
+   }
+   else {
+
+      SG_error("md_segstore_pwrite(%" PRIX64 " @%jd) rc = %d\n", seg->id, (intmax_t)new_offset, rc );
+   }
+
+   md_segstore_unlock( store );
+
+   return rc;
+}
+
+
+// compact at most one segment: copy its live blocks to the end of the log, and unlink it.
+// how much dead space a segment needs before it is worth compacting depends on how full the store is:
+// any dead space at all once we're past the hard limit, a quarter of it past the soft limit, and half of it otherwise.
+// only one thread may call this at a time.
+// return the number of bytes reclaimed on success
+// return -ENOMEM on OOM
+// return -errno on I/O error
+int md_segstore_compact( struct md_segstore* store, uint64_t soft_limit, uint64_t hard_limit ) {
+
+   int rc = 0;
+   struct md_segstore_segment* victim = NULL;
+   uint64_t victim_dead = 0;
+   off_t offset = 0;
+   off_t victim_size = 0;
+   ssize_t nr = 0;
+   struct md_segstore_record_header hdr;
+
+   md_segstore_rlock( store );
+
+   for( md_segstore_segments_t::iterator itr = store->segments->begin(); itr != store->segments->end(); itr++ ) {
+
+      struct md_segstore_segment* seg = itr->second;
+
+      if( seg == store->active || seg->pending_writes > 0 || seg->size == 0 ) {
+         continue;
+      }
+
+      uint64_t dead = seg->size - seg->live_bytes;
+      uint64_t min_dead = 0;
+
+      if( hard_limit > 0 && store->total_bytes > hard_limit ) {
+         min_dead = 1;
+      }
+      else if( soft_limit > 0 && store->total_bytes > soft_limit ) {
+         min_dead = MAX( (uint64_t)seg->size / 4, 1 );
+      }
+      else {
+         min_dead = MAX( (uint64_t)seg->size / 2, 1 );
+      }
+
+      if( dead >= min_dead && dead > victim_dead ) {
+
+         victim = seg;
+         victim_dead = dead;
+      }
+   }
+
+   if( victim != NULL ) {
+      victim_size = victim->size;
+   }
+
+   md_segstore_unlock( store );
+
+   if( victim == NULL ) {
+      return 0;
+   }
+
+   SG_debug("Compact segment %" PRIX64 ": %jd bytes, %" PRIu64 " dead\n", victim->id, (intmax_t)victim_size, victim_dead );
+
+   // sealed segments are immutable, so walk its records without the lock
+   while( offset < victim_size ) {
+
+      nr = md_segstore_pread( victim->fd, (char*)&hdr, sizeof(hdr), offset );
+      if( nr < 0 || (size_t)nr != sizeof(hdr) || hdr.magic != MD_SEGSTORE_RECORD_MAGIC ) {
+
+         // torn append.  Nothing else in this segment can be found.
+         break;
+      }
+
+      uint64_t record_len = md_segstore_record_len( hdr.len );
+      bool live = false;
+
+      if( hdr.flags & MD_SEGSTORE_RECORD_DEAD ) {
+
+         offset += record_len;
+         continue;
+      }
+
+      struct md_cache_entry_key key;
+      memset( &key, 0, sizeof(key) );
+
+      key.file_id = hdr.file_id;
+      key.file_version = hdr.file_version;
+      key.block_id = hdr.block_id;
+      key.block_version = hdr.block_version;
+
+      md_segstore_rlock( store );
+
+      md_segstore_index_t::iterator itr = store->index->find( key );
+      if( itr != store->index->end() && itr->second.ready && itr->second.segment_id == victim->id && itr->second.offset == offset ) {
+         live = true;
+      }
+
+      md_segstore_unlock( store );
+
+      if( live ) {
+
+         rc = md_segstore_compact_record( store, victim, &hdr, offset );
+         if( rc != 0 ) {
+
+            SG_error("md_segstore_compact_record(%" PRIX64 " @%jd) rc = %d\n", victim->id, (intmax_t)offset, rc );
+            return rc;
+         }
+      }
+
+      offset += record_len;
+   }
+
+   md_segstore_wlock( store );
+
+   if( victim->live_bytes != 0 ) {
+
+      // blocks in this segment were indexed past a record we couldn't read; keep it
+      SG_warn("Segment %" PRIX64 " still has %" PRIu64 " live bytes after compaction\n", victim->id, victim->live_bytes );
+      md_segstore_unlock( store );
+      return 0;
+   }
+
+   md_segstore_segment_remove( store, victim );
+
+   md_segstore_unlock( store );
+
+   return (int)MIN( victim_size, (off_t)INT_MAX );
+}
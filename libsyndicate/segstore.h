@@ -0,0 +1,122 @@
+/*
+   Copyright 2014 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Packed, log-structured block store for the on-disk cache.
+ * Blocks are appended to large segment files, and found through an in-memory index.
+ * Each record on disk is a fixed-size header followed by the block data.  The header
+ * is written once the data write completes, and carries a CRC of the data, so a record whose
+ * data did not make it to disk before a crash is found (and dropped) when the segment is scanned
+ * on restart; a restart truncates a segment at its first torn header.
+ * Evicted records are marked dead on disk, so they do not come back after a restart.
+ * Segments whose blocks have mostly been evicted are compacted by copying their live
+ * blocks to the end of the log and unlinking them.
+ */
+
+#ifndef _LIBSYNDICATE_SEGSTORE_H_
+#define _LIBSYNDICATE_SEGSTORE_H_
+
+#include <map>
+
+#include "libsyndicate/libsyndicate.h"
+#include "libsyndicate/cache.h"
+
+#define MD_SEGSTORE_RECORD_MAGIC        0x53474232      // "SGB2"
+#define MD_SEGSTORE_SEGMENT_SUFFIX      ".seg"
+
+#define MD_SEGSTORE_RECORD_DEAD         0x1             // record is the remains of an aborted append
+
+// on-disk record header
+struct md_segstore_record_header {
+
+   uint32_t magic;
+   uint32_t flags;              // MD_SEGSTORE_RECORD_* flags
+   uint32_t data_crc;           // crc32 of the data that follows
+   uint32_t reserved;
+   uint64_t file_id;
+   int64_t file_version;
+   uint64_t block_id;
+   int64_t block_version;
+   uint64_t len;                // length of the data that follows
+};
+
+// where a block lives
+struct md_segstore_extent {
+
+   uint64_t segment_id;
+   off_t offset;                // offset of the record header
+   uint64_t len;                // length of the block data
+   uint32_t data_crc;           // crc32 of the block data
+   bool ready;                  // if false, the block is still being appended
+};
+
+// a segment file
+struct md_segstore_segment {
+
+   uint64_t id;
+   int fd;
+
+   off_t size;                  // number of bytes appended (or reserved for appending)
+   uint64_t live_bytes;         // number of bytes that belong to indexed blocks
+   int pending_writes;          // number of appends that have not been committed or aborted
+};
+
+typedef map<struct md_cache_entry_key, struct md_segstore_extent, md_cache_entry_key_comp> md_segstore_index_t;
+typedef map<uint64_t, struct md_segstore_segment*> md_segstore_segments_t;
+
+struct md_segstore {
+
+   char* root;                                  // directory holding the segment files
+   off_t segment_size;                          // size at which we stop appending to a segment
+
+   md_segstore_index_t* index;                  // block --> extent, ordered by file so per-file operations are range scans
+   md_segstore_segments_t* segments;            // segment ID --> segment
+   struct md_segstore_segment* active;          // segment being appended to
+   uint64_t next_segment_id;
+
+   uint64_t total_bytes;                        // bytes on disk, across all segments
+   uint64_t live_bytes;                         // bytes that belong to indexed blocks
+
+   pthread_rwlock_t lock;                       // guards all of the above
+};
+
+extern "C" {
+
+int md_segstore_init( struct md_segstore* store, char const* root, off_t segment_size, md_cache_lru_t* recovered );
+int md_segstore_shutdown( struct md_segstore* store );
+
+// appends
+int md_segstore_reserve( struct md_segstore* store, struct md_cache_entry_key* key, char const* data, size_t len, int* fd, off_t* data_offset );
+int md_segstore_commit( struct md_segstore* store, struct md_cache_entry_key* key );
+int md_segstore_abort( struct md_segstore* store, struct md_cache_entry_key* key );
+
+// reads
+ssize_t md_segstore_read( struct md_segstore* store, struct md_cache_entry_key* key, char** buf );
+int md_segstore_open( struct md_segstore* store, struct md_cache_entry_key* key );
+int md_segstore_stat( struct md_segstore* store, struct md_cache_entry_key* key, struct stat* sb );
+int md_segstore_file_blocks( struct md_segstore* store, uint64_t file_id, int64_t file_version, md_cache_lru_t* blocks );
+
+// evictions and renames
+int md_segstore_evict( struct md_segstore* store, struct md_cache_entry_key* key );
+int md_segstore_evict_file( struct md_segstore* store, uint64_t file_id, int64_t file_version );
+int md_segstore_reversion_file( struct md_segstore* store, uint64_t file_id, int64_t old_file_version, int64_t new_file_version, md_cache_lru_t* new_keys );
+
+// space reclamation
+int md_segstore_compact( struct md_segstore* store, uint64_t soft_limit, uint64_t hard_limit );
+
+}
+
+#endif
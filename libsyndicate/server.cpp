@@ -19,6 +19,42 @@
 #include "libsyndicate/manifest.h"
 #include "libsyndicate/url.h"
 
+#include <list>
+
+// a signed, serialized manifest, shared between the cache and the responses that are sending it
+struct SG_server_manifest_buf {
+   
+   char* data;
+   off_t len;
+   int refcount;                                // the cache holds one ref, and each response holds one
+};
+
+// a signed, serialized manifest, exactly as we last served it 
+struct SG_server_manifest_cache_entry {
+   
+   int64_t file_version;
+   int64_t mtime_sec;
+   int32_t mtime_nsec;
+   struct SG_server_manifest_buf* manifest;     // signed, serialized manifest
+   list< uint64_t >::iterator lru_itr;          // where this file ID is in the LRU list
+};
+
+typedef map< uint64_t, struct SG_server_manifest_cache_entry > SG_server_manifest_cache_map_t;
+
+// in-RAM cache of the most recently-served signed manifest of each file, so we don't re-sign unchanged manifests
+struct SG_server_manifest_cache {
+   
+   SG_server_manifest_cache_map_t* manifests;   // file ID to its manifest 
+   list< uint64_t >* lru;                       // file IDs, most-recently-used first
+   uint64_t num_bytes;                          // total size of all cached manifests
+   
+   // invalidation counts, indexed by file ID modulo SG_SERVER_MANIFEST_CACHE_GENERATIONS.
+   // a manifest can only be cached if its file's count has not changed since the GET that produced it started.
+   uint64_t generations[ SG_SERVER_MANIFEST_CACHE_GENERATIONS ];
+   
+   pthread_mutex_t lock;
+};
+
 // connection initialization handler for embedded HTTP server
 // return 0 on success 
 // return -ENOMEM on OOM
@@ -465,8 +501,6 @@ static int SG_server_reply_populate( struct SG_gateway* gateway, SG_messages::Re
    uint64_t cert_version = ms_client_cert_version( ms );
    uint64_t user_id = conf->owner;
    
-   EVP_PKEY* gateway_private_key = SG_gateway_private_key( gateway );
-   
    try {
       
       reply->set_volume_version( volume_version );
@@ -483,7 +517,7 @@ static int SG_server_reply_populate( struct SG_gateway* gateway, SG_messages::Re
       return -ENOMEM;
    }
    
-   rc = md_sign< SG_messages::Reply >( gateway_private_key, reply );
+   rc = SG_gateway_sign< SG_messages::Reply >( gateway, reply );
    if( rc != 0 ) {
       
       return rc;
@@ -500,9 +534,8 @@ static int SG_server_reply_populate( struct SG_gateway* gateway, SG_messages::Re
 static int SG_server_reply_sign( struct SG_gateway* gateway, SG_messages::Reply* reply ) {
    
    int rc = 0;
-   EVP_PKEY* gateway_private_key = SG_gateway_private_key( gateway );
    
-   rc = md_sign< SG_messages::Reply >( gateway_private_key, reply );
+   rc = SG_gateway_sign< SG_messages::Reply >( gateway, reply );
    if( rc != 0 ) {
       
       return rc;
@@ -723,6 +756,7 @@ int SG_server_HTTP_GET_listxattr( struct SG_gateway* gateway, struct SG_request_
 // GET a block, as part of an I/O complection.
 // try the cache first, then the implementation.
 // on cache miss, run the block through the "put block" driver method and cache it for next time.
+// the driver is told this is a read, unless the requester said it was a prefetch (see SG_server_HTTP_GET_handler).
 // return 0 on success
 // return -ENOMEM on OOM
 int SG_server_HTTP_GET_block( struct SG_gateway* gateway, struct SG_request_data* reqdat, SG_messages::Request* ignored, struct md_HTTP_connection_data* ignored2, struct md_HTTP_response* resp ) {
@@ -766,7 +800,7 @@ int SG_server_HTTP_GET_block( struct SG_gateway* gateway, struct SG_request_data
    SG_debug("CACHE MISS %" PRIX64 ".%" PRId64 "[block %" PRIu64 ".%" PRId64 "]\n", reqdat->file_id, reqdat->file_version, reqdat->block_id, reqdat->block_version );
    
    // get raw block from the implementation, but don't deserialize
-   SG_IO_hints_init( &io_hints, SG_IO_READ, reqdat->block_id * block_size, block_size );
+   SG_IO_hints_init( &io_hints, reqdat->io_hints.io_type == SG_IO_PREFETCH ? SG_IO_PREFETCH : SG_IO_READ, reqdat->block_id * block_size, block_size );
    SG_request_data_set_IO_hints( reqdat, &io_hints );
 
    rc = SG_gateway_impl_block_get( gateway, reqdat, &block, 0 );
@@ -815,8 +849,265 @@ int SG_server_HTTP_GET_block( struct SG_gateway* gateway, struct SG_request_data
 
 
 
+// allocate and set up a signed manifest cache
+// return the new cache on success 
+// return NULL on OOM
+struct SG_server_manifest_cache* SG_server_manifest_cache_new(void) {
+   
+   struct SG_server_manifest_cache* mcache = SG_CALLOC( struct SG_server_manifest_cache, 1 );
+   if( mcache == NULL ) {
+      return NULL;
+   }
+   
+   mcache->manifests = SG_safe_new( SG_server_manifest_cache_map_t() );
+   mcache->lru = SG_safe_new( list< uint64_t >() );
+   
+   if( mcache->manifests == NULL || mcache->lru == NULL ) {
+      
+      SG_safe_delete( mcache->manifests );
+      SG_safe_delete( mcache->lru );
+      SG_safe_free( mcache );
+      return NULL;
+   }
+   
+   pthread_mutex_init( &mcache->lock, NULL );
+   return mcache;
+}
+
+
+// release a reference to a shared manifest buffer, freeing it on the last one.
+// always succeeds
+static void SG_server_manifest_buf_unref( void* cls ) {
+   
+   struct SG_server_manifest_buf* buf = (struct SG_server_manifest_buf*)cls;
+   
+   if( __sync_sub_and_fetch( &buf->refcount, 1 ) == 0 ) {
+      
+      SG_safe_free( buf->data );
+      SG_safe_free( buf );
+   }
+}
+
+
+// MHD reader for a shared manifest buffer: copy out the bytes at pos, straight from the cached buffer.
+// return the number of bytes copied
+// return MHD_CONTENT_READER_END_OF_STREAM once the manifest has been sent
+static ssize_t SG_server_manifest_buf_read( void* cls, uint64_t pos, char* out, size_t max ) {
+   
+   struct SG_server_manifest_buf* buf = (struct SG_server_manifest_buf*)cls;
+   size_t len = 0;
+   
+   if( pos >= (uint64_t)buf->len ) {
+      return MHD_CONTENT_READER_END_OF_STREAM;
+   }
+   
+   len = MIN( max, (uint64_t)buf->len - pos );
+   memcpy( out, buf->data + pos, len );
+   
+   return len;
+}
+
+
+// free a signed manifest cache 
+// always succeeds
+void SG_server_manifest_cache_free( struct SG_server_manifest_cache* mcache ) {
+   
+   if( mcache->manifests != NULL ) {
+      
+      for( SG_server_manifest_cache_map_t::iterator itr = mcache->manifests->begin(); itr != mcache->manifests->end(); itr++ ) {
+         SG_server_manifest_buf_unref( itr->second.manifest );
+      }
+   }
+   
+   SG_safe_delete( mcache->manifests );
+   SG_safe_delete( mcache->lru );
+   pthread_mutex_destroy( &mcache->lock );
+}
+
+
+// remove a file's entry from the signed manifest cache 
+// mcache must be locked
+static void SG_server_manifest_cache_erase( struct SG_server_manifest_cache* mcache, SG_server_manifest_cache_map_t::iterator itr ) {
+   
+   mcache->num_bytes -= itr->second.manifest->len;
+   mcache->lru->erase( itr->second.lru_itr );
+   SG_server_manifest_buf_unref( itr->second.manifest );
+   mcache->manifests->erase( itr );
+}
+
+
+// drop a file's signed manifest from the cache, and keep any GET that is already running from putting back what it read.
+// call this whenever the file's manifest changes, since it may keep its modtime.
+// return 0 on success (even if it was not cached)
+int SG_server_manifest_cache_invalidate( struct SG_gateway* gateway, uint64_t file_id ) {
+   
+   struct SG_server_manifest_cache* mcache = gateway->manifest_cache;
+   
+   if( mcache == NULL ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &mcache->lock );
+   
+   mcache->generations[ file_id % SG_SERVER_MANIFEST_CACHE_GENERATIONS ]++;
+   
+   SG_server_manifest_cache_map_t::iterator itr = mcache->manifests->find( file_id );
+   if( itr != mcache->manifests->end() ) {
+      
+      SG_server_manifest_cache_erase( mcache, itr );
+   }
+   
+   pthread_mutex_unlock( &mcache->lock );
+   return 0;
+}
+
+
+// get a file's invalidation generation.  Sample it before reading the manifest, and pass it to SG_server_manifest_cache_put.
+// return the generation (0 if there is no cache)
+static uint64_t SG_server_manifest_cache_generation( struct SG_gateway* gateway, uint64_t file_id ) {
+   
+   uint64_t generation = 0;
+   struct SG_server_manifest_cache* mcache = gateway->manifest_cache;
+   
+   if( mcache == NULL ) {
+      return 0;
+   }
+   
+   pthread_mutex_lock( &mcache->lock );
+   
+   generation = mcache->generations[ file_id % SG_SERVER_MANIFEST_CACHE_GENERATIONS ];
+   
+   pthread_mutex_unlock( &mcache->lock );
+   return generation;
+}
+
+
+// look up a signed manifest in the cache, and get a reference to its buffer.
+// the caller must release it with SG_server_manifest_buf_unref (i.e. by handing it to the response).
+// return 0 on success, and set *manifest
+// return -ENOENT if not cached (or cached for a different version or modtime)
+static int SG_server_manifest_cache_get( struct SG_gateway* gateway, struct SG_request_data* reqdat, struct SG_server_manifest_buf** manifest ) {
+   
+   struct SG_server_manifest_cache* mcache = gateway->manifest_cache;
+   
+   if( mcache == NULL ) {
+      return -ENOENT;
+   }
+   
+   pthread_mutex_lock( &mcache->lock );
+   
+   SG_server_manifest_cache_map_t::iterator itr = mcache->manifests->find( reqdat->file_id );
+   if( itr == mcache->manifests->end() ||
+       itr->second.file_version != reqdat->file_version ||
+       itr->second.mtime_sec != reqdat->manifest_timestamp.tv_sec ||
+       itr->second.mtime_nsec != reqdat->manifest_timestamp.tv_nsec ) {
+      
+      pthread_mutex_unlock( &mcache->lock );
+      return -ENOENT;
+   }
+   
+   __sync_fetch_and_add( &itr->second.manifest->refcount, 1 );
+   *manifest = itr->second.manifest;
+   
+   // most-recently used
+   mcache->lru->splice( mcache->lru->begin(), *mcache->lru, itr->second.lru_itr );
+   
+   pthread_mutex_unlock( &mcache->lock );
+   return 0;
+}
+
+
+// cache a copy of a signed manifest for a file, replacing whatever we had for it.
+// generation is the file's generation from before the manifest was read (see SG_server_manifest_cache_generation).
+// evict least-recently-used manifests to stay within SG_SERVER_MANIFEST_CACHE_MAX_ENTRIES and SG_SERVER_MANIFEST_CACHE_MAX_BYTES
+// return 0 on success 
+// return -ENOMEM on OOM
+// return -ESTALE if the file's manifest was invalidated since generation was sampled
+static int SG_server_manifest_cache_put( struct SG_gateway* gateway, struct SG_request_data* reqdat, uint64_t generation, struct SG_chunk* manifest ) {
+   
+   struct SG_server_manifest_cache* mcache = gateway->manifest_cache;
+   struct SG_server_manifest_cache_entry entry;
+   
+   if( mcache == NULL || (uint64_t)manifest->len > SG_SERVER_MANIFEST_CACHE_MAX_BYTES ) {
+      return 0;
+   }
+   
+   entry.manifest = SG_CALLOC( struct SG_server_manifest_buf, 1 );
+   if( entry.manifest == NULL ) {
+      return -ENOMEM;
+   }
+   
+   entry.manifest->data = SG_CALLOC( char, manifest->len );
+   if( entry.manifest->data == NULL ) {
+      
+      SG_safe_free( entry.manifest );
+      return -ENOMEM;
+   }
+   
+   memcpy( entry.manifest->data, manifest->data, manifest->len );
+   entry.manifest->len = manifest->len;
+   entry.manifest->refcount = 1;
+   
+   entry.file_version = reqdat->file_version;
+   entry.mtime_sec = reqdat->manifest_timestamp.tv_sec;
+   entry.mtime_nsec = reqdat->manifest_timestamp.tv_nsec;
+   
+   pthread_mutex_lock( &mcache->lock );
+   
+   if( mcache->generations[ reqdat->file_id % SG_SERVER_MANIFEST_CACHE_GENERATIONS ] != generation ) {
+      
+      // invalidated while we were reading it; it may be stale 
+      pthread_mutex_unlock( &mcache->lock );
+      SG_server_manifest_buf_unref( entry.manifest );
+      return -ESTALE;
+   }
+   
+   SG_server_manifest_cache_map_t::iterator itr = mcache->manifests->find( reqdat->file_id );
+   if( itr != mcache->manifests->end() ) {
+      
+      SG_server_manifest_cache_erase( mcache, itr );
+   }
+   
+   try {
+      
+      mcache->lru->push_front( reqdat->file_id );
+   }
+   catch( bad_alloc& ba ) {
+      
+      pthread_mutex_unlock( &mcache->lock );
+      SG_server_manifest_buf_unref( entry.manifest );
+      return -ENOMEM;
+   }
+   
+   entry.lru_itr = mcache->lru->begin();
+   
+   try {
+      
+      (*mcache->manifests)[ reqdat->file_id ] = entry;
+   }
+   catch( bad_alloc& ba ) {
+      
+      mcache->lru->pop_front();
+      pthread_mutex_unlock( &mcache->lock );
+      SG_server_manifest_buf_unref( entry.manifest );
+      return -ENOMEM;
+   }
+   
+   mcache->num_bytes += entry.manifest->len;
+   
+   // evict 
+   while( mcache->manifests->size() > SG_SERVER_MANIFEST_CACHE_MAX_ENTRIES || mcache->num_bytes > SG_SERVER_MANIFEST_CACHE_MAX_BYTES ) {
+      
+      SG_server_manifest_cache_erase( mcache, mcache->manifests->find( mcache->lru->back() ) );
+   }
+   
+   pthread_mutex_unlock( &mcache->lock );
+   return 0;
+}
+
+
 // GET a manifest, as part of an I/O completion
-// try the cache first, then the implementation.
+// try the in-RAM signed manifest cache first, then the on-disk cache, then the implementation.
 // on cache miss, run the serialized signed manifest through the "put manifest" driver method and cache it for next time.
 // return 0 on success
 // return -ENOMEM on OOM
@@ -842,9 +1133,9 @@ int SG_server_HTTP_GET_manifest( struct SG_gateway* gateway, struct SG_request_d
    size_t protobuf_manifest_len = 0;
    
    struct md_cache_block_future* manifest_fut = NULL;
+   struct SG_server_manifest_buf* cached_manifest = NULL;
+   uint64_t generation = 0;
    
-   EVP_PKEY* gateway_private_key = SG_gateway_private_key( gateway );
-
    SG_IO_hints io_hints;
    
    // sanity check 
@@ -856,11 +1147,32 @@ int SG_server_HTTP_GET_manifest( struct SG_gateway* gateway, struct SG_request_d
       return md_HTTP_create_response_builtin( resp, 501 );
    }
 
+   // already signed and serialized this version?
+   rc = SG_server_manifest_cache_get( gateway, reqdat, &cached_manifest );
+   if( rc == 0 ) {
+      
+      // reply straight from the cached buffer; the response takes our reference
+      rc = md_HTTP_create_response_stream( resp, "application/octet-stream", 200, cached_manifest->len, SG_SERVER_MANIFEST_RESPONSE_BLKSIZE,
+                                           SG_server_manifest_buf_read, cached_manifest, SG_server_manifest_buf_unref );
+      if( rc != 0 ) {
+         
+         SG_server_manifest_buf_unref( cached_manifest );
+      }
+      
+      return rc;
+   }
+   
+   // anything we read from here on can only be cached if no one invalidates it in the mean time
+   generation = SG_server_manifest_cache_generation( gateway, reqdat->file_id );
+   
    // try the cache
    rc = SG_gateway_cached_manifest_get_raw( gateway, reqdat, &raw_serialized_manifest );
    
    if( rc == 0 ) {
       
+      // keep it in RAM for next time (best-effort)
+      SG_server_manifest_cache_put( gateway, reqdat, generation, &raw_serialized_manifest );
+      
       // reply
       return md_HTTP_create_response_ram_nocopy( resp, "application/octet-stream", 200, raw_serialized_manifest.data, raw_serialized_manifest.len );
    }
@@ -911,11 +1223,11 @@ int SG_server_HTTP_GET_manifest( struct SG_gateway* gateway, struct SG_request_d
    }
 
    // sign manifest 
-   rc = md_sign< SG_messages::Manifest >( gateway_private_key, &manifest_message );
+   rc = SG_gateway_sign< SG_messages::Manifest >( gateway, &manifest_message );
    if( rc != 0 ) {
       
       // failed to sign 
-      SG_error("md_sign( %" PRIX64 ".%" PRId64 "[manifest %" PRId64 ".%ld] ) rc = %d\n",
+      SG_error("SG_gateway_sign( %" PRIX64 ".%" PRId64 "[manifest %" PRId64 ".%ld] ) rc = %d\n",
                reqdat->file_id, reqdat->file_version, reqdat->manifest_timestamp.tv_sec, reqdat->manifest_timestamp.tv_nsec, rc );
       
       return md_HTTP_create_response_builtin( resp, 500 );
@@ -977,6 +1289,9 @@ int SG_server_HTTP_GET_manifest( struct SG_gateway* gateway, struct SG_request_d
       return md_HTTP_create_response_builtin( resp, 500 );
    }
    
+   // keep it in RAM for next time (best-effort)
+   SG_server_manifest_cache_put( gateway, reqdat, generation, &serialized_manifest_resp );
+   
    // reply with the signed, serialized manifest!
    return md_HTTP_create_response_ram_nocopy( resp, "application/octet-stream", 200, serialized_manifest_resp.data, serialized_manifest_resp.len );
 }
@@ -1039,6 +1354,12 @@ int SG_server_HTTP_GET_handler( struct md_HTTP_connection_data* con_data, struct
    // block request?
    else if( SG_request_is_block( reqdat ) ) {
 
+      // remember whether or not the requester is prefetching
+      char const* io_type_str = md_HTTP_header_lookup( con_data->headers, SG_IO_TYPE_HEADER );
+      if( io_type_str != NULL && strtol( io_type_str, NULL, 10 ) == SG_IO_PREFETCH ) {
+         reqdat->io_hints.io_type = SG_IO_PREFETCH;
+      }
+      
       rc = SG_server_HTTP_IO_start( gateway, SG_SERVER_IO_READ, SG_server_HTTP_GET_block, reqdat, NULL, con_data, resp );
    }
    
@@ -1068,6 +1389,8 @@ int SG_server_HTTP_GET_handler( struct md_HTTP_connection_data* con_data, struct
 
 
 // extract and verify a request's authenticity
+// signatures are checked on the gateway's crypto workers.  Requests from peer gateways that we have already 
+// verified (e.g. retransmissions) are recognized by the hash of the signed message, and are not re-verified.
 // return 0 on success
 // return -EINVAL if the message could not be parsed or verified 
 // return -ENOMEM on OOM
@@ -1077,6 +1400,8 @@ static int SG_request_message_parse( struct SG_gateway* gateway, SG_messages::Re
    
    int rc = 0;
    struct ms_client* ms = SG_gateway_ms( gateway );
+   unsigned char msg_hash[SG_BLOCK_HASH_LEN];
+   uint64_t cert_version = 0;
    
    // de-serialize 
    rc = md_parse< SG_messages::Request >( msg, msg_buf, msg_sz );
@@ -1092,7 +1417,7 @@ static int SG_request_message_parse( struct SG_gateway* gateway, SG_messages::Re
       ms_client_config_rlock( ms );
       
       // from the admin tool.  verify that it's from the volume owner  
-      rc = md_verify< SG_messages::Request >( ms->volume->volume_public_key, msg );
+      rc = SG_gateway_verify< SG_messages::Request >( gateway, ms->volume->volume_public_key, msg );
       
       ms_client_config_unlock( ms );
       
@@ -1105,14 +1430,29 @@ static int SG_request_message_parse( struct SG_gateway* gateway, SG_messages::Re
    
    else {
       
-      // from a gateway 
-      rc = ms_client_verify_gateway_message< SG_messages::Request >( ms, msg->volume_id(), msg->src_gateway_id(), msg );
+      // from a gateway.  have we seen this exact message before?
+      sha256_hash_buf( msg_buf, msg_sz, msg_hash );
+      cert_version = ms_client_get_gateway_cert_version( ms, msg->src_gateway_id() );
+      
+      if( cert_version != SG_INVALID_GATEWAY_ID && SG_gateway_sigcache_lookup( gateway, msg->src_gateway_id(), cert_version, msg_hash ) ) {
+         
+         // already verified it (under this certificate), and it's byte-for-byte identical
+         return 0;
+      }
+      
+      rc = ms_client_verify_gateway_message_ex< SG_messages::Request >( ms, msg->volume_id(), msg->src_gateway_id(), msg, SG_gateway_crypto_verify_signature, gateway );
             
       if( rc != 0 ) {
             
           SG_error("ms_client_verify_gateway_message(from=%" PRIu64 ") rc = %d\n", msg->src_gateway_id(), rc );
           return -EPERM;
       }
+      
+      if( cert_version != SG_INVALID_GATEWAY_ID ) {
+         
+         // remember this, so retransmissions skip verification.  best-effort.
+         SG_gateway_sigcache_insert( gateway, msg->src_gateway_id(), cert_version, msg_hash );
+      }
    }
    
    return 0;
@@ -1774,232 +2114,1111 @@ SG_server_HTTP_POST_DELETECHUNKS_finish:
 }
 
 
-// handle a PUTCHUNKS request: deserialize each chunk into a block or manifest, and feed them into the implementation's "put block" and "put manifest" callbacks.
-// this is called as part of an IO completion.
+// shared state for handing a PUTCHUNKS request's chunks to the driver from several I/O workers at once.
+// the request's own thread puts chunks too, so it never depends on a helper getting scheduled.
+// helpers that start after it has finished do nothing.
+struct SG_server_putchunks_ctx {
+   
+   struct SG_gateway* gateway;
+   struct SG_request_data* reqdat;              // request template; each thread works on its own copy
+   SG_messages::Request* request_msg;
+   char* chunks_mmap;                           // the data plane
+   int64_t io_context;
+   
+   int next_chunk;                              // index of the next chunk to put (atomically incremented)
+   int rc;                                      // first error encountered (0 if none)
+   
+   pthread_mutex_t lock;
+   pthread_cond_t idle;                         // signaled when the last active helper finishes
+   bool done;                                   // if true, the request's thread is done; helpers must not touch the request
+   int num_active;                              // number of helpers putting chunks right now
+   int refcount;                                // the request's thread, plus each queued helper
+};
+
+
+// deserialize one chunk from a PUTCHUNKS request and feed it into the implementation's "put block" or "put manifest" callback.
+// chunk_data is the chunk's (already verified) serialized data.
+// reqdat will be modified to describe the chunk.
 // return 0 on success
-// return -ENOSYS if not implemented 
-// return -EINVAL if the request does not contain block information
-// return -EBADMSG if the block's hash does not match the hash given on the control plane
 // return -ENODATA if we failed to load the data into the gateway
-// return -EPERM on internal error
-// return -errno on fchmod, lseek, mmap failure
-static int SG_server_HTTP_POST_PUTCHUNKS( struct SG_gateway* gateway, struct SG_request_data* reqdat, SG_messages::Request* request_msg, struct md_HTTP_connection_data* con_data, struct md_HTTP_response* ignored ) {
+static int SG_server_HTTP_POST_PUTCHUNKS_put_chunk( struct SG_gateway* gateway, struct SG_request_data* reqdat, SG_messages::Request* request_msg, int i, char* chunk_data, int64_t io_context ) {
    
    int rc = 0;
-   int chunks_fd = 0;
-   struct stat sb;
    int chunk_type = 0;
-   char* chunks_mmap = NULL;
-   struct SG_chunk chunk;
-   struct SG_manifest_block chunk_info;
-   unsigned char chunk_hash[SG_BLOCK_HASH_LEN];
    uint64_t offset = 0;
    uint64_t size = 0;
+   struct SG_chunk chunk;
    struct SG_chunk deserialized_chunk;
    struct SG_IO_hints io_hints;
-   struct ms_client* ms = SG_gateway_ms( gateway );
-   uint64_t blocksize = ms_client_get_volume_blocksize( ms );
-   int64_t io_context = md_random64();
+   uint64_t blocksize = ms_client_get_volume_blocksize( SG_gateway_ms( gateway ) );
    
-   // sanity check 
-   if( gateway->impl_put_block == NULL || gateway->impl_put_manifest == NULL ) {
-      
-      return -ENOSYS;
+   memset( &deserialized_chunk, 0, sizeof(struct SG_chunk) );
+   
+   // type, offset and size of chunk
+   chunk_type = request_msg->blocks(i).chunk_type();
+   offset = request_msg->blocks(i).offset();
+   size = request_msg->blocks(i).size();
+
+   SG_debug("Load chunk %d [offset %" PRIu64 ", size %" PRIu64 "]\n", i, offset, size );
+
+   // set up a chunk 
+   SG_chunk_init( &chunk, chunk_data, size );
+
+   // deserialize 
+   rc = SG_gateway_impl_deserialize( gateway, reqdat, &chunk, &deserialized_chunk );
+   if( rc != 0 ) {
+
+      SG_error("SG_gateway_impl_deserialize(%d) rc = %d\n", i, rc );
+      return -ENODATA;
    }
 
-   // sanity check: need chunk type, offset, hash, and size for each block 
-   for( int i = 0; i < request_msg->blocks_size(); i++ ) {
-      
-      if( !request_msg->blocks(i).has_chunk_type() ) {
-         SG_error("Chunk %d is missing 'chunk_type'\n", i);
-         return -EINVAL;
-      }
+   if( chunk_type == SG_messages::ManifestBlock::BLOCK ) {
 
-      if( !request_msg->blocks(i).has_offset() ) {
-         SG_error("Chunk %d is missing 'offset'\n", i);
-         return -EINVAL;
-      }
+      // block 
+      // fill in request details....
+      reqdat->manifest_timestamp.tv_sec = -1;
+      reqdat->manifest_timestamp.tv_nsec = -1;
+      reqdat->block_id = request_msg->blocks(i).block_id();
+      reqdat->block_version = request_msg->blocks(i).block_version();
 
-      if( !request_msg->blocks(i).has_size() ) {
-         SG_error("Chunk %d is missing 'size'\n", i);
-         return -EINVAL;
-      }
+      SG_IO_hints_init( &io_hints, SG_IO_WRITE, reqdat->block_id * blocksize, blocksize );
+      io_hints.io_context = io_context;
+      SG_request_data_set_IO_hints( reqdat, &io_hints );
 
-      if( !request_msg->blocks(i).has_hash() ) {
-         SG_error("Chunk %d is missing 'hash'\n", i);
-         return -EINVAL;
+      // pass along
+      rc = SG_gateway_impl_block_put( gateway, reqdat, &deserialized_chunk, 0 );
+      SG_chunk_free( &deserialized_chunk );
+
+      if( rc != 0 ) {
+         
+         SG_error("SG_gateway_impl_block_put(chunk %d) rc = %d\n", i, rc );
+         return -ENODATA;
       }
+   }
+   else {
 
-      chunk_type = request_msg->blocks(i).chunk_type();
-      if( chunk_type != SG_messages::ManifestBlock::BLOCK && chunk_type != SG_messages::ManifestBlock::MANIFEST ) {
-         SG_error("Chunk type %d is not BLOCK or MANIFEST\n", chunk_type );
-         return -EINVAL;
+      // manifest
+      // fill in request details
+      reqdat->manifest_timestamp.tv_sec = request_msg->blocks(i).block_id(); 
+      reqdat->manifest_timestamp.tv_nsec = request_msg->blocks(i).block_version();
+      reqdat->block_id = SG_INVALID_BLOCK_ID;
+      reqdat->block_version = 0;
+      
+      SG_IO_hints_init( &io_hints, SG_IO_WRITE, 0, 0 );
+      io_hints.io_context = io_context;
+      SG_request_data_set_IO_hints( reqdat, &io_hints );
+
+      // put into the gateway 
+      rc = SG_gateway_impl_manifest_put( gateway, reqdat, &deserialized_chunk, 0 );
+      SG_chunk_free( &deserialized_chunk );
+
+      if( rc != 0 ) {
+
+         SG_error("SG_gateway_impl_manifest_put(chunk %d) rc = %d\n", i, rc );
+         return -ENODATA;
       }
    }
    
-   // fetch the serialized chunks from the request 
-   rc = md_HTTP_upload_get_field_tmpfile( con_data, SG_SERVER_POST_FIELD_DATA_PLANE, NULL, &chunks_fd );
+   return 0;
+}
+
+
+// PUTCHUNKS worker: put chunks until there are none left, or until some thread fails.
+// the first error is recorded in ctx->rc.
+// always returns NULL
+static void* SG_server_HTTP_POST_PUTCHUNKS_worker( void* arg ) {
+   
+   int rc = 0;
+   int i = 0;
+   struct SG_server_putchunks_ctx* ctx = (struct SG_server_putchunks_ctx*)arg;
+   struct SG_request_data reqdat;
+   
+   rc = SG_request_data_dup( &reqdat, ctx->reqdat );
    if( rc != 0 ) {
       
-      SG_error("md_HTTP_upload_get_field_buffer( '%s' ) rc = %d\n", SG_SERVER_POST_FIELD_DATA_PLANE, rc );
-      return -EPERM;
+      __sync_bool_compare_and_swap( &ctx->rc, 0, rc );
+      return NULL;
    }
    
-   // read-only...
-   rc = fchmod( chunks_fd, 0400 );
-   if( rc != 0 ) {
+   while( __sync_fetch_and_add( &ctx->rc, 0 ) == 0 ) {
       
-      rc = -errno;
-      SG_error("fchmod rc = %d\n", rc );
-      return -EPERM;
+      i = __sync_fetch_and_add( &ctx->next_chunk, 1 );
+      if( i >= ctx->request_msg->blocks_size() ) {
+         break;
+      }
+      
+      rc = SG_server_HTTP_POST_PUTCHUNKS_put_chunk( ctx->gateway, &reqdat, ctx->request_msg, i, ctx->chunks_mmap + ctx->request_msg->blocks(i).offset(), ctx->io_context );
+      if( rc != 0 ) {
+         
+         __sync_bool_compare_and_swap( &ctx->rc, 0, rc );
+         break;
+      }
    }
+   
+   SG_request_data_free( &reqdat );
+   return NULL;
+}
 
-   rc = fstat( chunks_fd, &sb );
-   if( rc != 0 ) {
 
-      rc = -errno;
-      SG_error("fstat rc = %d\n", rc );
-      return -EPERM;
-   }
+// release a reference to a PUTCHUNKS context, and free it on the last one
+// always succeeds
+static void SG_server_putchunks_ctx_unref( struct SG_server_putchunks_ctx* ctx ) {
+   
+   int refcount = 0;
+   
+   pthread_mutex_lock( &ctx->lock );
+   
+   ctx->refcount--;
+   refcount = ctx->refcount;
+   
+   pthread_mutex_unlock( &ctx->lock );
+   
+   if( refcount == 0 ) {
+      
+      pthread_cond_destroy( &ctx->idle );
+      pthread_mutex_destroy( &ctx->lock );
+      SG_safe_free( ctx );
+   }
+}
+
+
+// PUTCHUNKS helper, run on an I/O worker: help put the request's chunks, unless the request has already finished.
+// always returns 0
+static int SG_server_HTTP_POST_PUTCHUNKS_helper( struct md_wreq* wreq, void* cls ) {
+   
+   struct SG_server_putchunks_ctx* ctx = (struct SG_server_putchunks_ctx*)wreq->work_data;
+   
+   pthread_mutex_lock( &ctx->lock );
+   
+   if( ctx->done ) {
+      
+      // too late 
+      pthread_mutex_unlock( &ctx->lock );
+      SG_server_putchunks_ctx_unref( ctx );
+      return 0;
+   }
+   
+   ctx->num_active++;
+   pthread_mutex_unlock( &ctx->lock );
+   
+   SG_server_HTTP_POST_PUTCHUNKS_worker( ctx );
+   
+   pthread_mutex_lock( &ctx->lock );
+   
+   ctx->num_active--;
+   if( ctx->num_active == 0 ) {
+      pthread_cond_broadcast( &ctx->idle );
+   }
+   
+   pthread_mutex_unlock( &ctx->lock );
+   
+   SG_server_putchunks_ctx_unref( ctx );
+   return 0;
+}
+
+
+// put all of a PUTCHUNKS request's chunks, with the help of up to num_helpers of the gateway's I/O workers.
+// return 0 on success 
+// return -ENOMEM on OOM 
+// return -ENODATA if we failed to load a chunk into the gateway
+static int SG_server_HTTP_POST_PUTCHUNKS_put_chunks( struct SG_gateway* gateway, struct SG_request_data* reqdat, SG_messages::Request* request_msg, char* chunks_mmap, int num_helpers ) {
+   
+   int rc = 0;
+   struct md_wreq wreq;
+   struct SG_server_putchunks_ctx* ctx = SG_CALLOC( struct SG_server_putchunks_ctx, 1 );
+   
+   if( ctx == NULL ) {
+      return -ENOMEM;
+   }
+   
+   ctx->gateway = gateway;
+   ctx->reqdat = reqdat;
+   ctx->request_msg = request_msg;
+   ctx->chunks_mmap = chunks_mmap;
+   ctx->io_context = md_random64();
+   ctx->refcount = 1;
+   
+   pthread_mutex_init( &ctx->lock, NULL );
+   pthread_cond_init( &ctx->idle, NULL );
+   
+   for( int i = 0; i < num_helpers; i++ ) {
+      
+      pthread_mutex_lock( &ctx->lock );
+      ctx->refcount++;
+      pthread_mutex_unlock( &ctx->lock );
+      
+      md_wreq_init( &wreq, SG_server_HTTP_POST_PUTCHUNKS_helper, ctx, 0 );
+      
+      rc = SG_gateway_io_start( gateway, &wreq );
+      if( rc != 0 ) {
+         
+         // run with what we have 
+         SG_warn("SG_gateway_io_start rc = %d; putting chunks with %d helpers\n", rc, i );
+         
+         md_wreq_free( &wreq );
+         SG_server_putchunks_ctx_unref( ctx );
+         break;
+      }
+   }
+   
+   // this thread is one of the workers
+   SG_server_HTTP_POST_PUTCHUNKS_worker( ctx );
+   
+   // wait for the helpers that got started, and keep the rest from starting
+   pthread_mutex_lock( &ctx->lock );
+   
+   ctx->done = true;
+   while( ctx->num_active > 0 ) {
+      pthread_cond_wait( &ctx->idle, &ctx->lock );
+   }
+   
+   rc = ctx->rc;
+   
+   pthread_mutex_unlock( &ctx->lock );
+   
+   SG_server_putchunks_ctx_unref( ctx );
+   return rc;
+}
+
+
+// a received data-plane chunk, waiting to be handed to the driver
+struct SG_server_ingest_chunk {
+   
+   int index;                                   // index into the request's blocks
+   char* data;                                  // serialized chunk (not yet verified)
+};
+
+typedef list< struct SG_server_ingest_chunk > SG_server_ingest_chunk_list_t;
+
+// a PUTCHUNKS data plane that is verified and fed to the driver chunk by chunk as it arrives, instead of being staged to disk
+struct SG_server_ingest {
+   
+   struct SG_gateway* gateway;
+   struct md_HTTP_connection_data* con_data;    // connection the data plane arrives on
+   struct SG_request_data reqdat;               // request template; each put works on its own copy
+   SG_messages::Request* request_msg;           // verified control plane
+   int64_t io_context;
+   
+   // receive state (only touched by the HTTP server thread, and by SG_server_ingest_finish once the upload is complete)
+   int* order;                                  // chunk indexes, by data-plane offset
+   int num_chunks;
+   int next;                                    // position in order of the chunk being received
+   char* chunk_buf;                             // data received so far for that chunk
+   uint64_t received;                           // number of data-plane bytes received
+   
+   // dispatch state
+   SG_server_ingest_chunk_list_t* ready;        // received chunks, waiting to be put
+   int running;                                 // number of chunks being put right now
+   int max_running;                             // most chunks put at once
+   uint64_t queued;                             // bytes of chunks that are ready or being put
+   bool throttled;                              // the connection is suspended until queued drains
+   int rc;                                      // first error (0 if none)
+   bool cancelled;                              // the connection went away; put no more chunks
+   int refcount;                                // the connection, plus each queued I/O work request
+   
+   pthread_mutex_t lock;
+   pthread_cond_t cond;
+};
+
+
+// order data-plane chunks by offset
+struct SG_server_ingest_offset_cmp {
+   
+   SG_messages::Request* request_msg;
+   
+   bool operator()( int a, int b ) const {
+      return request_msg->blocks(a).offset() < request_msg->blocks(b).offset();
+   }
+};
+
+
+// free an ingest 
+// always succeeds
+static void SG_server_ingest_free( struct SG_server_ingest* ingest ) {
+   
+   if( ingest->ready != NULL ) {
+      
+      for( SG_server_ingest_chunk_list_t::iterator itr = ingest->ready->begin(); itr != ingest->ready->end(); itr++ ) {
+         SG_pool_safe_free( itr->data );
+      }
+      
+      SG_safe_delete( ingest->ready );
+   }
+   
+   SG_safe_free( ingest->order );
+   SG_pool_safe_free( ingest->chunk_buf );
+   SG_safe_delete( ingest->request_msg );
+   SG_request_data_free( &ingest->reqdat );
+   
+   pthread_mutex_destroy( &ingest->lock );
+   pthread_cond_destroy( &ingest->cond );
+   
+   SG_safe_free( ingest );
+}
+
+
+// release a reference to an ingest, freeing it with the last one 
+// always succeeds
+static void SG_server_ingest_unref( struct SG_server_ingest* ingest ) {
+   
+   int refcount = 0;
+   
+   pthread_mutex_lock( &ingest->lock );
+   
+   ingest->refcount--;
+   refcount = ingest->refcount;
+   
+   pthread_mutex_unlock( &ingest->lock );
+   
+   if( refcount == 0 ) {
+      SG_server_ingest_free( ingest );
+   }
+}
+
+
+// decide whether or not a POST's data plane can be processed as it arrives, and if so, set up to do so.
+// it can if it is an authentic, permitted PUTCHUNKS request whose control plane has fully arrived, and whose chunks do not overlap
+// and fit within the upload limit.
+// at most SG_SERVER_INGEST_MAX_QUEUED bytes of received chunks (plus the chunk being received) are held in RAM at once;
+// past that, the connection is suspended until the driver catches up.
+// nothing has been consumed when this fails, so the caller can stage the upload as usual (SG_server_HTTP_POST_finish will report any errors).
+// return 0 on success, and set *ret_ingest
+// return -ENOTSUP if the request cannot be ingested this way
+// return -ENOMEM on OOM
+static int SG_server_ingest_new( struct SG_gateway* gateway, struct md_HTTP_connection_data* con_data, struct SG_server_ingest** ret_ingest ) {
+   
+   int rc = 0;
+   char* request_message_str = NULL;
+   size_t request_message_len = 0;
+   struct ms_client* ms = SG_gateway_ms( gateway );
+   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   SG_messages::Request* request_msg = NULL;
+   struct SG_server_ingest* ingest = NULL;
+   struct SG_server_ingest_offset_cmp offset_cmp;
+   int num_chunks = 0;
+   uint64_t end = 0;
+   
+   if( gateway->impl_put_block == NULL || gateway->impl_put_manifest == NULL ) {
+      return -ENOTSUP;
+   }
+   
+   // the control plane precedes the data plane
+   rc = md_HTTP_upload_get_field_buffer( con_data, SG_SERVER_POST_FIELD_CONTROL_PLANE, &request_message_str, &request_message_len );
+   if( rc != 0 ) {
+      return (rc == -ENOMEM ? rc : -ENOTSUP);
+   }
+   
+   request_msg = SG_safe_new( SG_messages::Request );
+   if( request_msg == NULL ) {
+      
+      SG_safe_free( request_message_str );
+      return -ENOMEM;
+   }
+   
+   rc = SG_request_message_parse( gateway, request_msg, request_message_str, request_message_len );
+   SG_safe_free( request_message_str );
+   
+   if( rc != 0 || request_msg->request_type() != SG_messages::Request::PUTCHUNKS ) {
+      
+      SG_safe_delete( request_msg );
+      return -ENOTSUP;
+   }
+   
+   rc = SG_server_check_capabilities( gateway, request_msg );
+   if( rc != 0 ) {
+      
+      SG_safe_delete( request_msg );
+      return -ENOTSUP;
+   }
+   
+   rc = ms_client_need_reload( ms, ms_client_get_volume_id( ms ), request_msg->volume_version(), request_msg->cert_version() );
+   if( rc > 0 ) {
+      
+      SG_safe_delete( request_msg );
+      return -ENOTSUP;
+   }
+   
+   num_chunks = request_msg->blocks_size();
+   for( int i = 0; i < num_chunks; i++ ) {
+      
+      if( !request_msg->blocks(i).has_chunk_type() || !request_msg->blocks(i).has_offset() || !request_msg->blocks(i).has_size() || !request_msg->blocks(i).has_hash() ) {
+         
+         SG_safe_delete( request_msg );
+         return -ENOTSUP;
+      }
+      
+      if( request_msg->blocks(i).chunk_type() != SG_messages::ManifestBlock::BLOCK && request_msg->blocks(i).chunk_type() != SG_messages::ManifestBlock::MANIFEST ) {
+         
+         SG_safe_delete( request_msg );
+         return -ENOTSUP;
+      }
+      
+      if( request_msg->blocks(i).size() > (uint64_t)(-1) - request_msg->blocks(i).offset() ) {
+         
+         SG_safe_delete( request_msg );
+         return -ENOTSUP;
+      }
+   }
+   
+   ingest = SG_CALLOC( struct SG_server_ingest, 1 );
+   if( ingest == NULL ) {
+      
+      SG_safe_delete( request_msg );
+      return -ENOMEM;
+   }
+   
+   ingest->order = SG_CALLOC( int, num_chunks + 1 );
+   ingest->ready = SG_safe_new( SG_server_ingest_chunk_list_t() );
+   
+   if( ingest->order == NULL || ingest->ready == NULL ) {
+      
+      SG_safe_free( ingest->order );
+      SG_safe_delete( ingest->ready );
+      SG_safe_free( ingest );
+      SG_safe_delete( request_msg );
+      return -ENOMEM;
+   }
+   
+   pthread_mutex_init( &ingest->lock, NULL );
+   pthread_cond_init( &ingest->cond, NULL );
+   
+   ingest->gateway = gateway;
+   ingest->con_data = con_data;
+   ingest->request_msg = request_msg;
+   ingest->io_context = md_random64();
+   ingest->num_chunks = num_chunks;
+   ingest->max_running = MAX( conf->putchunks_concurrency, 1 );
+   ingest->refcount = 1;
+   
+   rc = SG_request_data_from_message( &ingest->reqdat, request_msg );
+   if( rc != 0 ) {
+      
+      SG_server_ingest_free( ingest );
+      return (rc == -ENOMEM ? rc : -ENOTSUP);
+   }
+   
+   // receive chunks in data-plane order; they must not overlap
+   for( int i = 0; i < num_chunks; i++ ) {
+      ingest->order[i] = i;
+   }
+   
+   offset_cmp.request_msg = request_msg;
+   sort( ingest->order, ingest->order + num_chunks, offset_cmp );
+   
+   for( int i = 0; i < num_chunks; i++ ) {
+      
+      if( request_msg->blocks( ingest->order[i] ).offset() < end ) {
+         
+         SG_server_ingest_free( ingest );
+         return -ENOTSUP;
+      }
+      
+      end = request_msg->blocks( ingest->order[i] ).offset() + request_msg->blocks( ingest->order[i] ).size();
+   }
+   
+   // hold the data plane to the upload limit, as if it were staged
+   if( end > con_data->http->max_disk_upload_size ) {
+      
+      SG_server_ingest_free( ingest );
+      return -ENOTSUP;
+   }
+   
+   *ret_ingest = ingest;
+   return 0;
+}
+
+
+// verify a received chunk against its hash in the control plane, and feed it to the driver.
+// return 0 on success 
+// return -EBADMSG on hash mismatch 
+// return -ENODATA if we failed to load the data into the gateway
+// return -ENOMEM on OOM
+static int SG_server_ingest_put( struct SG_server_ingest* ingest, struct SG_server_ingest_chunk* chunk ) {
+   
+   int rc = 0;
+   unsigned char chunk_hash[SG_BLOCK_HASH_LEN];
+   struct SG_request_data reqdat;
+   SG_messages::ManifestBlock const& chunk_info = ingest->request_msg->blocks( chunk->index );
+   
+   sha256_hash_buf( chunk->data, chunk_info.size(), chunk_hash );
+   
+   if( chunk_info.hash().size() != SG_BLOCK_HASH_LEN || memcmp( chunk_hash, chunk_info.hash().data(), SG_BLOCK_HASH_LEN ) != 0 ) {
+      
+      char expected[ 2*SG_BLOCK_HASH_LEN + 1 ];
+      char actual[ 2*SG_BLOCK_HASH_LEN + 1 ];
+      
+      memset( expected, 0, 2*SG_BLOCK_HASH_LEN + 1 );
+      memset( actual, 0, 2*SG_BLOCK_HASH_LEN + 1 );
+      
+      md_sprintf_data( expected, (unsigned char const*)chunk_info.hash().data(), MIN( chunk_info.hash().size(), SG_BLOCK_HASH_LEN ) );
+      md_sprintf_data( actual, chunk_hash, SG_BLOCK_HASH_LEN );
+      
+      SG_error("%" PRIX64 ".%" PRId64 "[chunk %d] (%" PRIu64 "): expected '%s', got '%s'\n", ingest->reqdat.file_id, ingest->reqdat.file_version, chunk->index, (uint64_t)chunk_info.size(), expected, actual );
+      return -EBADMSG;
+   }
+   
+   rc = SG_request_data_dup( &reqdat, &ingest->reqdat );
+   if( rc != 0 ) {
+      return rc;
+   }
+   
+   rc = SG_server_HTTP_POST_PUTCHUNKS_put_chunk( ingest->gateway, &reqdat, ingest->request_msg, chunk->index, chunk->data, ingest->io_context );
+   
+   SG_request_data_free( &reqdat );
+   return rc;
+}
+
+
+// account for a chunk that is no longer queued, and resume the connection if it was suspended and enough of the queue has drained.
+// ingest->lock must be held
+// always succeeds
+static void SG_server_ingest_dequeued_locked( struct SG_server_ingest* ingest, struct SG_server_ingest_chunk* chunk ) {
+   
+   int rc = 0;
+   
+   ingest->queued -= ingest->request_msg->blocks( chunk->index ).size();
+   
+   if( ingest->throttled && ingest->queued <= SG_SERVER_INGEST_MAX_QUEUED / 2 ) {
+      
+      ingest->throttled = false;
+      
+      // the connection cannot be cleaned up while suspended, so it is still there
+      rc = md_HTTP_connection_resume( ingest->con_data, NULL );
+      if( rc != 0 ) {
+         SG_error("md_HTTP_connection_resume rc = %d\n", rc );
+      }
+   }
+}
+
+
+// put ready chunks until there are none left, or until enough chunks are being put at once.
+// once a chunk fails (or the connection goes away), the rest are discarded.
+// always succeeds
+static void SG_server_ingest_drain( struct SG_server_ingest* ingest ) {
+   
+   int rc = 0;
+   struct SG_server_ingest_chunk chunk;
+   
+   pthread_mutex_lock( &ingest->lock );
+   
+   while( ingest->ready->size() > 0 && ingest->running < ingest->max_running ) {
+      
+      chunk = ingest->ready->front();
+      ingest->ready->pop_front();
+      
+      if( ingest->rc != 0 || ingest->cancelled ) {
+         
+         SG_pool_safe_free( chunk.data );
+         SG_server_ingest_dequeued_locked( ingest, &chunk );
+         continue;
+      }
+      
+      ingest->running++;
+      pthread_mutex_unlock( &ingest->lock );
+      
+      rc = SG_server_ingest_put( ingest, &chunk );
+      SG_pool_safe_free( chunk.data );
+      
+      pthread_mutex_lock( &ingest->lock );
+      
+      ingest->running--;
+      if( rc != 0 && ingest->rc == 0 ) {
+         ingest->rc = rc;
+      }
+      
+      SG_server_ingest_dequeued_locked( ingest, &chunk );
+      pthread_cond_broadcast( &ingest->cond );
+   }
+   
+   pthread_mutex_unlock( &ingest->lock );
+}
+
+
+// I/O worker: put ready chunks 
+// always succeeds
+static int SG_server_ingest_work( struct md_wreq* wreq, void* cls ) {
+   
+   struct SG_server_ingest* ingest = (struct SG_server_ingest*)cls;
+   
+   SG_server_ingest_drain( ingest );
+   SG_server_ingest_unref( ingest );
+   
+   return 0;
+}
+
+
+// queue a fully-received chunk, and have an I/O worker put it.
+// if no I/O worker can take it, put it on this thread (so a suspended connection is never left waiting on a queue nobody drains).
+// always succeeds
+static void SG_server_ingest_dispatch( struct SG_server_ingest* ingest, int index, char* data ) {
+   
+   int rc = 0;
+   struct md_wreq wreq;
+   struct SG_server_ingest_chunk chunk;
+   
+   chunk.index = index;
+   chunk.data = data;
+   
+   pthread_mutex_lock( &ingest->lock );
+   
+   try {
+      ingest->ready->push_back( chunk );
+   }
+   catch( bad_alloc& ba ) {
+      
+      SG_pool_safe_free( data );
+      if( ingest->rc == 0 ) {
+         ingest->rc = -ENOMEM;
+      }
+      
+      pthread_mutex_unlock( &ingest->lock );
+      return;
+   }
+   
+   ingest->queued += ingest->request_msg->blocks( index ).size();
+   ingest->refcount++;
+   pthread_mutex_unlock( &ingest->lock );
+   
+   md_wreq_init( &wreq, SG_server_ingest_work, ingest, 0 );
+   
+   rc = SG_gateway_io_start( ingest->gateway, &wreq );
+   if( rc != 0 ) {
+      
+      SG_warn("SG_gateway_io_start rc = %d\n", rc );
+      md_wreq_free( &wreq );
+      
+      SG_server_ingest_drain( ingest );
+      SG_server_ingest_unref( ingest );
+   }
+}
+
+
+// dispatch the empty chunks at the current receive position 
+// always succeeds
+static void SG_server_ingest_dispatch_empty( struct SG_server_ingest* ingest ) {
+   
+   int index = 0;
+   char* data = NULL;
+   
+   while( ingest->next < ingest->num_chunks ) {
+      
+      index = ingest->order[ ingest->next ];
+      
+      if( ingest->request_msg->blocks(index).size() > 0 || ingest->request_msg->blocks(index).offset() > ingest->received ) {
+         break;
+      }
+      
+      data = SG_CALLOC( char, 1 );
+      if( data == NULL ) {
+         
+         pthread_mutex_lock( &ingest->lock );
+         if( ingest->rc == 0 ) {
+            ingest->rc = -ENOMEM;
+         }
+         pthread_mutex_unlock( &ingest->lock );
+         
+         return;
+      }
+      
+      SG_server_ingest_dispatch( ingest, index, data );
+      ingest->next++;
+   }
+}
 
-   // integrity/authenticity check
-   for( int i = 0; i < request_msg->blocks_size(); i++ ) {
 
-       // get the chunk information
-       rc = SG_manifest_block_load_from_protobuf( &chunk_info, &request_msg->blocks(i) );
-       if( rc != 0 ) {
+// receive the next piece of the data plane: copy out the bytes that belong to chunks, and dispatch each chunk once it is complete.
+// errors are recorded in ingest->rc, for SG_server_ingest_finish to report.
+// always succeeds
+static void SG_server_ingest_data( struct SG_server_ingest* ingest, char const* data, uint64_t offset, size_t len ) {
+   
+   int rc = 0;
+   uint64_t pos = offset;
+   uint64_t end = offset + len;
+   uint64_t chunk_start = 0;
+   uint64_t chunk_size = 0;
+   uint64_t n = 0;
+   int index = 0;
+   
+   if( offset != ingest->received ) {
       
-          SG_error("SG_manifest_block_load_from_protobuf rc = %d\n", rc );
-          return -EPERM;
-       }
+      SG_error("Data plane out of order: expected offset %" PRIu64 ", got %" PRIu64 "\n", ingest->received, offset );
+      
+      pthread_mutex_lock( &ingest->lock );
+      if( ingest->rc == 0 ) {
+         ingest->rc = -EBADMSG;
+      }
+      pthread_mutex_unlock( &ingest->lock );
+      
+      return;
+   }
    
-       // offset and size of chunk
-       offset = request_msg->blocks(i).offset();
-       size = request_msg->blocks(i).size();
-
-       rc = lseek( chunks_fd, offset, SEEK_SET );
-       if( rc < 0 ) {
-          rc = -errno;
-          SG_error("lseek(%d) rc = %d\n", chunks_fd, rc );
-
-          SG_manifest_block_free( &chunk_info );
-          return -ENODATA;
-       }
-
-       // integrity/authenticity check on each chunk 
-       sha256_fd_buf( chunks_fd, size, chunk_hash );
-       if( sha256_cmp( chunk_hash, chunk_info.hash ) != 0 ) {
- 
-            char expected[ 2*SG_BLOCK_HASH_LEN + 1 ];
-            char actual[ 2*SG_BLOCK_HASH_LEN + 1 ];
-            
-            memset( expected, 0, 2*SG_BLOCK_HASH_LEN + 1 );
-            memset( actual, 0, 2*SG_BLOCK_HASH_LEN + 1 );
-            
-            md_sprintf_data( expected, chunk_info.hash, chunk_info.hash_len );
-            md_sprintf_data( actual, chunk_hash, SG_BLOCK_HASH_LEN );
+   while( pos < end ) {
+      
+      SG_server_ingest_dispatch_empty( ingest );
+      
+      if( ingest->next >= ingest->num_chunks ) {
+         
+         // trailing data 
+         break;
+      }
+      
+      index = ingest->order[ ingest->next ];
+      chunk_start = ingest->request_msg->blocks(index).offset();
+      chunk_size = ingest->request_msg->blocks(index).size();
+      
+      if( pos < chunk_start ) {
+         
+         // between chunks 
+         pos = MIN( end, chunk_start );
+         ingest->received = pos;
+         continue;
+      }
+      
+      if( ingest->chunk_buf == NULL ) {
+         
+         // every byte gets overwritten, so a recycled block buffer will do
+         ingest->chunk_buf = md_bufpool_alloc( chunk_size );
+         if( ingest->chunk_buf == NULL ) {
             
-            SG_error("%" PRIX64 ".%" PRId64 "[chunk %d] (%" PRIu64 "): expected '%s', got '%s'\n", reqdat->file_id, reqdat->file_version, i, size, expected, actual );
+            pthread_mutex_lock( &ingest->lock );
+            if( ingest->rc == 0 ) {
+               ingest->rc = -ENOMEM;
+            }
+            pthread_mutex_unlock( &ingest->lock );
             
-            SG_manifest_block_free( &chunk_info );
-            return -EBADMSG;
-       }
-
-       SG_manifest_block_free( &chunk_info );
+            break;
+         }
+      }
+      
+      n = MIN( end - pos, chunk_start + chunk_size - pos );
+      memcpy( ingest->chunk_buf + (pos - chunk_start), data + (pos - offset), n );
+      
+      pos += n;
+      ingest->received = pos;
+      
+      if( pos == chunk_start + chunk_size ) {
+         
+         // have the whole chunk
+         SG_server_ingest_dispatch( ingest, index, ingest->chunk_buf );
+         
+         ingest->chunk_buf = NULL;
+         ingest->next++;
+      }
    }
    
-   lseek( chunks_fd, 0, SEEK_SET );
-
-   // it all checks out.
-   // feed manifests and blocks to the driver
-   chunks_mmap = (char*)mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, chunks_fd, 0 );
-   if( chunks_mmap == MAP_FAILED ) {
+   ingest->received = end;
+   SG_server_ingest_dispatch_empty( ingest );
+   
+   // backpressure: stop reading from the client until the driver catches up.
+   // the queue is non-empty, so an I/O worker (or this thread, above) will drain it and resume the connection.
+   pthread_mutex_lock( &ingest->lock );
+   
+   if( !ingest->throttled && !ingest->cancelled && ingest->queued > SG_SERVER_INGEST_MAX_QUEUED ) {
+      
+      rc = md_HTTP_connection_suspend( ingest->con_data );
+      if( rc != 0 ) {
+         SG_error("md_HTTP_connection_suspend rc = %d\n", rc );
+      }
+      else {
+         ingest->throttled = true;
+      }
+   }
+   
+   pthread_mutex_unlock( &ingest->lock );
+}
 
-      rc = -errno;
-      SG_error("mmap rc = %d\n", rc );
 
-      rc = -ENODATA;
-      goto SG_server_HTTP_POST_PUTCHUNKS_finish;
+// wait for every chunk of an ingested data plane to be put, helping to put them.
+// call this once the upload is complete.
+// return 0 if every chunk was received, verified, and put 
+// return -EBADMSG if a chunk's hash did not match, or the data plane was missing chunks 
+// return -ENODATA if we failed to load the data into the gateway
+// return -ENOMEM on OOM
+static int SG_server_ingest_finish( struct SG_server_ingest* ingest ) {
+   
+   int rc = 0;
+   
+   // hold the ingest while we wait on it, in case the connection gets cleaned up meanwhile
+   pthread_mutex_lock( &ingest->lock );
+   ingest->refcount++;
+   pthread_mutex_unlock( &ingest->lock );
+   
+   SG_server_ingest_dispatch_empty( ingest );
+   
+   if( ingest->next < ingest->num_chunks ) {
+      
+      SG_error("%" PRIX64 ".%" PRId64 ": data plane ended after %" PRIu64 " bytes, missing %d chunk(s)\n", ingest->reqdat.file_id, ingest->reqdat.file_version, ingest->received, ingest->num_chunks - ingest->next );
+      
+      pthread_mutex_lock( &ingest->lock );
+      if( ingest->rc == 0 ) {
+         ingest->rc = -EBADMSG;
+      }
+      pthread_mutex_unlock( &ingest->lock );
    }
+   
+   pthread_mutex_lock( &ingest->lock );
+   
+   while( ingest->ready->size() > 0 || ingest->running > 0 ) {
+      
+      if( ingest->ready->size() > 0 && ingest->running < ingest->max_running ) {
+         
+         // help out 
+         pthread_mutex_unlock( &ingest->lock );
+         SG_server_ingest_drain( ingest );
+         pthread_mutex_lock( &ingest->lock );
+         
+         continue;
+      }
+      
+      pthread_cond_wait( &ingest->cond, &ingest->lock );
+   }
+   
+   rc = ingest->rc;
+   
+   pthread_mutex_unlock( &ingest->lock );
+   
+   SG_server_ingest_unref( ingest );
+   return rc;
+}
 
-   for( int i = 0; i < request_msg->blocks_size(); i++ ) {
-
-      // type, offset and size of chunk
-      chunk_type = request_msg->blocks(i).chunk_type();
-      offset = request_msg->blocks(i).offset();
-      size = request_msg->blocks(i).size();
 
-      SG_debug("Load chunk %d [offset %" PRIu64 ", size %" PRIu64 "]\n", i, offset, size );
+// see the data plane of a POST as it arrives.  If it belongs to a PUTCHUNKS request, verify each chunk and hand it
+// to the driver as soon as it has been received, instead of staging the whole data plane to disk first.
+// return 1 if the data was consumed
+// return 0 if it should be staged as usual
+int SG_server_HTTP_POST_stream( struct md_HTTP_connection_data* con_data, char const* field_name, char const* data, uint64_t offset, size_t len ) {
+   
+   int rc = 0;
+   struct SG_server_connection* sgcon = (struct SG_server_connection*)con_data->cls;
+   
+   if( sgcon == NULL || strcmp( field_name, SG_SERVER_POST_FIELD_DATA_PLANE ) != 0 ) {
+      return 0;
+   }
+   
+   if( !sgcon->ingest_tried ) {
+      
+      sgcon->ingest_tried = true;
+      
+      if( offset == 0 ) {
+         
+         rc = SG_server_ingest_new( sgcon->gateway, con_data, &sgcon->ingest );
+         if( rc != 0 && rc != -ENOTSUP ) {
+            
+            SG_warn("SG_server_ingest_new rc = %d; staging data plane\n", rc );
+         }
+      }
+   }
+   
+   if( sgcon->ingest == NULL ) {
+      return 0;
+   }
+   
+   SG_server_ingest_data( sgcon->ingest, data, offset, len );
+   return 1;
+}
 
-      // set up a chunk 
-      SG_chunk_init( &chunk, chunks_mmap + offset, size );
 
-      // deserialize 
-      rc = SG_gateway_impl_deserialize( gateway, reqdat, &chunk, &deserialized_chunk );
-      if( rc != 0 ) {
+// handle a PUTCHUNKS request: deserialize each chunk into a block or manifest, and feed them into the implementation's "put block" and "put manifest" callbacks.
+// chunk hashes are checked in parallel on the crypto workers, and up to conf->putchunks_concurrency chunks are handed to the 
+// driver at once, by this thread and idle I/O workers.  The request fails if any chunk fails.
+// this is called as part of an IO completion.
+// return 0 on success
+// return -ENOSYS if not implemented 
+// return -EINVAL if the request does not contain block information
+// return -EBADMSG if the block's hash does not match the hash given on the control plane
+// return -ENODATA if we failed to load the data into the gateway
+// return -ENOMEM on OOM
+// return -EPERM on internal error
+static int SG_server_HTTP_POST_PUTCHUNKS( struct SG_gateway* gateway, struct SG_request_data* reqdat, SG_messages::Request* request_msg, struct md_HTTP_connection_data* con_data, struct md_HTTP_response* ignored ) {
+   
+   int rc = 0;
+   int chunks_fd = 0;
+   struct stat sb;
+   int chunk_type = 0;
+   char* chunks_mmap = (char*)MAP_FAILED;
+   struct SG_manifest_block chunk_info;
+   uint64_t offset = 0;
+   uint64_t size = 0;
+   struct md_syndicate_conf* conf = SG_gateway_conf( gateway );
+   struct SG_server_connection* sgcon = (struct SG_server_connection*)con_data->cls;
+   int num_chunks = request_msg->blocks_size();
+   struct SG_crypto_job* hash_jobs = NULL;
+   
+   int num_helpers = 0;
+   
+   // sanity check 
+   if( gateway->impl_put_block == NULL || gateway->impl_put_manifest == NULL ) {
+      
+      return -ENOSYS;
+   }
 
-         SG_error("SG_gateway_impl_deserialize(%d) rc = %d\n", i, rc );
-         rc = -ENODATA;
-         goto SG_server_HTTP_POST_PUTCHUNKS_finish;
+   // sanity check: need chunk type, offset, hash, and size for each block 
+   for( int i = 0; i < num_chunks; i++ ) {
+      
+      if( !request_msg->blocks(i).has_chunk_type() ) {
+         SG_error("Chunk %d is missing 'chunk_type'\n", i);
+         return -EINVAL;
       }
 
-      if( chunk_type == SG_messages::ManifestBlock::BLOCK ) {
-
-         // block 
-         // fill in request details....
-         reqdat->manifest_timestamp.tv_sec = -1;
-         reqdat->manifest_timestamp.tv_nsec = -1;
-         reqdat->block_id = request_msg->blocks(i).block_id();
-         reqdat->block_version = request_msg->blocks(i).block_version();
+      if( !request_msg->blocks(i).has_offset() ) {
+         SG_error("Chunk %d is missing 'offset'\n", i);
+         return -EINVAL;
+      }
 
-         SG_IO_hints_init( &io_hints, SG_IO_WRITE, reqdat->block_id * blocksize, blocksize );
-         io_hints.io_context = io_context;
-         SG_request_data_set_IO_hints( reqdat, &io_hints );
+      if( !request_msg->blocks(i).has_size() ) {
+         SG_error("Chunk %d is missing 'size'\n", i);
+         return -EINVAL;
+      }
 
-         // pass along
-         rc = SG_gateway_impl_block_put( gateway, reqdat, &deserialized_chunk, 0 );
-         SG_chunk_free( &deserialized_chunk );
+      if( !request_msg->blocks(i).has_hash() ) {
+         SG_error("Chunk %d is missing 'hash'\n", i);
+         return -EINVAL;
+      }
 
-         if( rc != 0 ) {
-            
-            SG_error("SG_gateway_impl_block_put(chunk %d) rc = %d\n", i, rc );
-            rc = -ENODATA;
-            goto SG_server_HTTP_POST_PUTCHUNKS_finish;
-         }
+      chunk_type = request_msg->blocks(i).chunk_type();
+      if( chunk_type != SG_messages::ManifestBlock::BLOCK && chunk_type != SG_messages::ManifestBlock::MANIFEST ) {
+         SG_error("Chunk type %d is not BLOCK or MANIFEST\n", chunk_type );
+         return -EINVAL;
       }
-      else {
+   }
+   
+   // already processed the data plane as it arrived?
+   if( sgcon != NULL && sgcon->ingest != NULL ) {
+      
+      rc = SG_server_ingest_finish( sgcon->ingest );
+      if( rc != 0 ) {
+         SG_error("SG_server_ingest_finish( %" PRIX64 ".%" PRId64 " ) rc = %d\n", reqdat->file_id, reqdat->file_version, rc );
+      }
+      
+      return rc;
+   }
+   
+   // fetch the serialized chunks from the request 
+   rc = md_HTTP_upload_get_field_tmpfile( con_data, SG_SERVER_POST_FIELD_DATA_PLANE, NULL, &chunks_fd );
+   if( rc != 0 ) {
+      
+      SG_error("md_HTTP_upload_get_field_buffer( '%s' ) rc = %d\n", SG_SERVER_POST_FIELD_DATA_PLANE, rc );
+      return -EPERM;
+   }
+   
+   // read-only...
+   rc = fchmod( chunks_fd, 0400 );
+   if( rc != 0 ) {
+      
+      rc = -errno;
+      SG_error("fchmod rc = %d\n", rc );
+      return -EPERM;
+   }
 
-         // manifest
-         // fill in request details
-         reqdat->manifest_timestamp.tv_sec = request_msg->blocks(i).block_id(); 
-         reqdat->manifest_timestamp.tv_nsec = request_msg->blocks(i).block_version();
-         reqdat->block_id = SG_INVALID_BLOCK_ID;
-         reqdat->block_version = 0;
+   rc = fstat( chunks_fd, &sb );
+   if( rc != 0 ) {
+
+      rc = -errno;
+      SG_error("fstat rc = %d\n", rc );
+      return -EPERM;
+   }
+   
+   if( num_chunks == 0 ) {
+      return 0;
+   }
+   
+   // every chunk must be in the data plane
+   for( int i = 0; i < num_chunks; i++ ) {
+      
+      offset = request_msg->blocks(i).offset();
+      size = request_msg->blocks(i).size();
+      
+      if( offset > (uint64_t)sb.st_size || size > (uint64_t)sb.st_size - offset ) {
          
-         SG_IO_hints_init( &io_hints, SG_IO_WRITE, 0, 0 );
-         io_hints.io_context = io_context;
-         SG_request_data_set_IO_hints( reqdat, &io_hints );
+         SG_error("%" PRIX64 ".%" PRId64 "[chunk %d]: offset %" PRIu64 " + size %" PRIu64 " exceeds data plane length %jd\n", reqdat->file_id, reqdat->file_version, i, offset, size, (intmax_t)sb.st_size );
+         return -EBADMSG;
+      }
+   }
+   
+   if( sb.st_size == 0 ) {
+      
+      // only empty chunks; nothing to map
+      chunks_mmap = NULL;
+   }
+   else {
+   
+      chunks_mmap = (char*)mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, chunks_fd, 0 );
+      if( chunks_mmap == MAP_FAILED ) {
 
-         // put into the gateway 
-         rc = SG_gateway_impl_manifest_put( gateway, reqdat, &deserialized_chunk, 0 );
-         SG_chunk_free( &deserialized_chunk );
+         rc = -errno;
+         SG_error("mmap rc = %d\n", rc );
 
-         if( rc != 0 ) {
+         return -ENODATA;
+      }
+   }
+   
+   // integrity/authenticity check on each chunk, in parallel 
+   hash_jobs = SG_CALLOC( struct SG_crypto_job, num_chunks );
+   if( hash_jobs == NULL ) {
+      
+      rc = -ENOMEM;
+      goto SG_server_HTTP_POST_PUTCHUNKS_finish;
+   }
+   
+   for( int i = 0; i < num_chunks; i++ ) {
+      
+      hash_jobs[i].type = SG_CRYPTO_HASH;
+      hash_jobs[i].data = chunks_mmap + request_msg->blocks(i).offset();
+      hash_jobs[i].len = request_msg->blocks(i).size();
+   }
+   
+   SG_gateway_crypto_run( gateway, hash_jobs, num_chunks );
+   
+   for( int i = 0; i < num_chunks; i++ ) {
 
-            SG_error("SG_gateway_impl_manifest_put(chunk %d) rc = %d\n", i, rc );
-            rc = -ENODATA;
-            goto SG_server_HTTP_POST_PUTCHUNKS_finish;
-         }
+      // get the chunk information
+      rc = SG_manifest_block_load_from_protobuf( &chunk_info, &request_msg->blocks(i) );
+      if( rc != 0 ) {
+      
+         SG_error("SG_manifest_block_load_from_protobuf rc = %d\n", rc );
+         rc = -EPERM;
+         goto SG_server_HTTP_POST_PUTCHUNKS_finish;
+      }
+      
+      if( sha256_cmp( hash_jobs[i].hash, chunk_info.hash ) != 0 ) {
+ 
+         char expected[ 2*SG_BLOCK_HASH_LEN + 1 ];
+         char actual[ 2*SG_BLOCK_HASH_LEN + 1 ];
+         
+         memset( expected, 0, 2*SG_BLOCK_HASH_LEN + 1 );
+         memset( actual, 0, 2*SG_BLOCK_HASH_LEN + 1 );
+         
+         md_sprintf_data( expected, chunk_info.hash, chunk_info.hash_len );
+         md_sprintf_data( actual, hash_jobs[i].hash, SG_BLOCK_HASH_LEN );
+         
+         SG_error("%" PRIX64 ".%" PRId64 "[chunk %d] (%" PRIu64 "): expected '%s', got '%s'\n", reqdat->file_id, reqdat->file_version, i, (uint64_t)hash_jobs[i].len, expected, actual );
+         
+         SG_manifest_block_free( &chunk_info );
+         rc = -EBADMSG;
+         goto SG_server_HTTP_POST_PUTCHUNKS_finish;
       }
 
-      memset( &chunk, 0, sizeof(struct SG_chunk) );
+      SG_manifest_block_free( &chunk_info );
+   }
+   
+   // it all checks out.
+   // feed manifests and blocks to the driver, several at a time, on the I/O workers
+   num_helpers = MIN( MAX( conf->putchunks_concurrency, 1 ), num_chunks ) - 1;
+   
+   rc = SG_server_HTTP_POST_PUTCHUNKS_put_chunks( gateway, reqdat, request_msg, chunks_mmap, num_helpers );
+   if( rc != 0 && rc != -ENODATA ) {
+      
+      // failed to copy the request 
+      SG_error("PUTCHUNKS %" PRIX64 ".%" PRId64 " rc = %d\n", reqdat->file_id, reqdat->file_version, rc );
    }
 
 SG_server_HTTP_POST_PUTCHUNKS_finish:
 
-   if( chunks_mmap != MAP_FAILED ) {
+   SG_safe_free( hash_jobs );
+   
+   if( chunks_mmap != MAP_FAILED && chunks_mmap != NULL ) {
        
-       int unmap_rc = munmap( chunks_mmap, size );
+       int unmap_rc = munmap( chunks_mmap, sb.st_size );
        if( unmap_rc != 0 ) {
 
            unmap_rc = -errno;
@@ -2530,6 +3749,17 @@ void SG_server_HTTP_cleanup( void *cls ) {
    
    struct SG_server_connection* sgcon = (struct SG_server_connection*)cls;
    
+   if( sgcon->ingest != NULL ) {
+      
+      // don't put chunks that are still waiting
+      pthread_mutex_lock( &sgcon->ingest->lock );
+      sgcon->ingest->cancelled = true;
+      pthread_mutex_unlock( &sgcon->ingest->lock );
+      
+      SG_server_ingest_unref( sgcon->ingest );
+      sgcon->ingest = NULL;
+   }
+   
    SG_safe_free( sgcon );
 }
 
@@ -2542,6 +3772,7 @@ int SG_server_HTTP_install_handlers( struct md_HTTP* http ) {
    md_HTTP_GET( *http, SG_server_HTTP_GET_handler );
    md_HTTP_HEAD( *http, SG_server_HTTP_HEAD_handler );
    md_HTTP_POST_finish( *http, SG_server_HTTP_POST_finish );
+   md_HTTP_POST_stream( *http, SG_server_HTTP_POST_stream );
    md_HTTP_close( *http, SG_server_HTTP_cleanup );
    
    // install special field handlers 
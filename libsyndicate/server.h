@@ -27,10 +27,24 @@
 #define SG_SERVER_IO_READ                       1       // I/O completion will take a name and return a record 
 #define SG_SERVER_IO_WRITE                      2       // I/O completion will take a record and return a status code
 
+// limits on the in-RAM cache of signed, serialized manifests 
+#define SG_SERVER_MANIFEST_CACHE_MAX_ENTRIES    1024
+#define SG_SERVER_MANIFEST_CACHE_MAX_BYTES      (64 * 1024 * 1024)
+#define SG_SERVER_MANIFEST_CACHE_GENERATIONS    4096
+#define SG_SERVER_MANIFEST_RESPONSE_BLKSIZE     65536
+
+#define SG_SERVER_INGEST_MAX_QUEUED             (8 * 1024 * 1024)       // most bytes of streamed PUTCHUNKS chunks a connection may have waiting to be put
+
+struct SG_server_manifest_cache;
+struct SG_server_ingest;
+
 // server connection state
 struct SG_server_connection {
    
    struct SG_gateway* gateway;
+   
+   struct SG_server_ingest* ingest;             // PUTCHUNKS data plane being processed as it arrives (NULL if staged instead)
+   bool ingest_tried;                           // if true, we already decided whether or not to process the data plane as it arrives
 };
 
 typedef int (*SG_server_IO_completion)( struct SG_gateway*, struct SG_request_data*, SG_messages::Request*, struct md_HTTP_connection_data* con_data, struct md_HTTP_response* resp );
@@ -55,6 +69,7 @@ int SG_server_HTTP_connect( struct md_HTTP_connection_data* con_data, void** cls
 int SG_server_HTTP_HEAD_handler( struct md_HTTP_connection_data* con_data, struct md_HTTP_response* resp );
 int SG_server_HTTP_GET_handler( struct md_HTTP_connection_data* con_data, struct md_HTTP_response* resp );
 int SG_server_HTTP_POST_finish( struct md_HTTP_connection_data* con_data, struct md_HTTP_response* resp );
+int SG_server_HTTP_POST_stream( struct md_HTTP_connection_data* con_data, char const* field_name, char const* data, uint64_t offset, size_t len );
 void SG_server_HTTP_cleanup( void *con_cls );
 
 // populate an HTTP server with our Syndicate Gateway methods 
@@ -65,6 +80,11 @@ int SG_server_HTTP_IO_start( struct SG_gateway* gateway, int type, SG_server_IO_
                              struct md_HTTP_connection_data* con_data, struct md_HTTP_response* resp );
 int SG_server_HTTP_IO_finish( struct md_wreq* wreq, void* cls );
 
+// signed manifest cache 
+struct SG_server_manifest_cache* SG_server_manifest_cache_new(void);
+void SG_server_manifest_cache_free( struct SG_server_manifest_cache* mcache );
+int SG_server_manifest_cache_invalidate( struct SG_gateway* gateway, uint64_t file_id );
+
 }
 
 #endif 
\ No newline at end of file
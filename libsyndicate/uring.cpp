@@ -0,0 +1,338 @@
+/*
+   Copyright 2014 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "libsyndicate/uring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define MD_URING_SUPPORTED 1
+#endif
+#endif
+#endif
+
+#ifdef MD_URING_SUPPORTED
+
+// is an opcode supported by the running kernel?
+// return true if so
+// return false if not, or if the kernel can't tell us
+static bool md_uring_op_supported( int ring_fd, int op ) {
+
+   bool ret = false;
+   size_t probe_len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+
+   struct io_uring_probe* probe = (struct io_uring_probe*)SG_CALLOC( char, probe_len );
+   if( probe == NULL ) {
+      return false;
+   }
+
+   int rc = syscall( __NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256 );
+   if( rc == 0 && op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) ) {
+      ret = true;
+   }
+
+   SG_safe_free( probe );
+   return ret;
+}
+
+
+// set up a ring with room for at least the given number of submissions
+// return 0 on success
+// return -ENOSYS if io_uring (or the opcodes we use) is not available
+// return -errno on failure to set up or map the ring
+int md_uring_init( struct md_uring* ring, unsigned entries ) {
+
+   int rc = 0;
+   struct io_uring_params params;
+
+   memset( ring, 0, sizeof(struct md_uring) );
+   memset( &params, 0, sizeof(params) );
+
+   ring->fd = syscall( __NR_io_uring_setup, entries, &params );
+   if( ring->fd < 0 ) {
+
+      rc = -errno;
+      ring->fd = -1;
+      SG_debug("io_uring_setup(%u) rc = %d\n", entries, rc );
+      return rc == -EPERM ? -ENOSYS : rc;
+   }
+
+   if( !md_uring_op_supported( ring->fd, IORING_OP_WRITE ) || !md_uring_op_supported( ring->fd, IORING_OP_READ ) ) {
+
+      SG_debug("%s", "io_uring lacks IORING_OP_READ/IORING_OP_WRITE\n");
+      close( ring->fd );
+      ring->fd = -1;
+      return -ENOSYS;
+   }
+
+   ring->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+   ring->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+   ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+   if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+
+      // one mapping covers both rings
+      ring->sq_ring_len = MAX( ring->sq_ring_len, ring->cq_ring_len );
+      ring->cq_ring_len = ring->sq_ring_len;
+   }
+
+   ring->sq_ring = mmap( NULL, ring->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+   if( ring->sq_ring == MAP_FAILED ) {
+
+      rc = -errno;
+      ring->sq_ring = NULL;
+      goto md_uring_init_fail;
+   }
+
+   if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+      ring->cq_ring = ring->sq_ring;
+   }
+   else {
+
+      ring->cq_ring = mmap( NULL, ring->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+      if( ring->cq_ring == MAP_FAILED ) {
+
+         rc = -errno;
+         ring->cq_ring = NULL;
+         goto md_uring_init_fail;
+      }
+   }
+
+   ring->sqes = mmap( NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+   if( ring->sqes == MAP_FAILED ) {
+
+      rc = -errno;
+      ring->sqes = NULL;
+      goto md_uring_init_fail;
+   }
+
+   ring->sq_head = (unsigned*)((char*)ring->sq_ring + params.sq_off.head);
+   ring->sq_tail = (unsigned*)((char*)ring->sq_ring + params.sq_off.tail);
+   ring->sq_mask = (unsigned*)((char*)ring->sq_ring + params.sq_off.ring_mask);
+   ring->sq_array = (unsigned*)((char*)ring->sq_ring + params.sq_off.array);
+   ring->sq_entries = params.sq_entries;
+   ring->sq_queued_tail = *ring->sq_tail;
+
+   ring->cq_head = (unsigned*)((char*)ring->cq_ring + params.cq_off.head);
+   ring->cq_tail = (unsigned*)((char*)ring->cq_ring + params.cq_off.tail);
+   ring->cq_mask = (unsigned*)((char*)ring->cq_ring + params.cq_off.ring_mask);
+   ring->cqes = (char*)ring->cq_ring + params.cq_off.cqes;
+
+   SG_debug("io_uring ready: %u submission entries, %u completion entries\n", params.sq_entries, params.cq_entries );
+
+   return 0;
+
+md_uring_init_fail:
+
+   SG_error("io_uring mmap rc = %d\n", rc );
+   md_uring_shutdown( ring );
+   return rc;
+}
+
+
+// tear down a ring.  Operations still in flight are cancelled by the kernel.
+// always succeeds
+int md_uring_shutdown( struct md_uring* ring ) {
+
+   if( ring->sqes != NULL ) {
+      munmap( ring->sqes, ring->sqes_len );
+   }
+
+   if( ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring ) {
+      munmap( ring->cq_ring, ring->cq_ring_len );
+   }
+
+   if( ring->sq_ring != NULL ) {
+      munmap( ring->sq_ring, ring->sq_ring_len );
+   }
+
+   if( ring->fd >= 0 ) {
+      close( ring->fd );
+   }
+
+   memset( ring, 0, sizeof(struct md_uring) );
+   ring->fd = -1;
+
+   return 0;
+}
+
+
+// get the next free submission entry, and queue it (it goes to the kernel on the next md_uring_submit)
+// return the entry on success
+// return NULL if the submission queue is full
+static struct io_uring_sqe* md_uring_get_sqe( struct md_uring* ring ) {
+
+   unsigned head = __atomic_load_n( ring->sq_head, __ATOMIC_ACQUIRE );
+
+   if( ring->sq_queued_tail - head >= ring->sq_entries ) {
+      return NULL;
+   }
+
+   unsigned idx = ring->sq_queued_tail & *ring->sq_mask;
+   struct io_uring_sqe* sqe = &((struct io_uring_sqe*)ring->sqes)[ idx ];
+
+   memset( sqe, 0, sizeof(struct io_uring_sqe) );
+
+   ring->sq_array[ idx ] = idx;
+   ring->sq_queued_tail++;
+
+   return sqe;
+}
+
+
+// queue a read or write
+// return 0 on success
+// return -EAGAIN if the submission queue is full (submit, and try again)
+static int md_uring_prep_rw( struct md_uring* ring, int op, int fd, void const* buf, size_t len, off_t offset, uint64_t user_data ) {
+
+   struct io_uring_sqe* sqe = md_uring_get_sqe( ring );
+   if( sqe == NULL ) {
+      return -EAGAIN;
+   }
+
+   sqe->opcode = op;
+   sqe->fd = fd;
+   sqe->addr = (uint64_t)(uintptr_t)buf;
+   sqe->len = len;
+   sqe->off = offset;
+   sqe->user_data = user_data;
+
+   return 0;
+}
+
+
+// queue a write of len bytes from buf to fd at offset
+// return 0 on success
+// return -EAGAIN if the submission queue is full (submit, and try again)
+int md_uring_prep_write( struct md_uring* ring, int fd, char const* buf, size_t len, off_t offset, uint64_t user_data ) {
+   return md_uring_prep_rw( ring, IORING_OP_WRITE, fd, buf, len, offset, user_data );
+}
+
+
+// queue a read of len bytes from fd at offset into buf
+// return 0 on success
+// return -EAGAIN if the submission queue is full (submit, and try again)
+int md_uring_prep_read( struct md_uring* ring, int fd, char* buf, size_t len, off_t offset, uint64_t user_data ) {
+   return md_uring_prep_rw( ring, IORING_OP_READ, fd, buf, len, offset, user_data );
+}
+
+
+// submit all queued entries in one system call, optionally waiting for wait_nr completions
+// return the number of entries submitted on success
+// return -errno on failure
+int md_uring_submit( struct md_uring* ring, unsigned wait_nr ) {
+
+   int rc = 0;
+
+   // publish the new entries
+   __atomic_store_n( ring->sq_tail, ring->sq_queued_tail, __ATOMIC_RELEASE );
+
+   // includes any entries the kernel did not consume last time
+   unsigned to_submit = ring->sq_queued_tail - __atomic_load_n( ring->sq_head, __ATOMIC_ACQUIRE );
+
+   if( to_submit == 0 && wait_nr == 0 ) {
+      return 0;
+   }
+
+   while( true ) {
+
+      rc = syscall( __NR_io_uring_enter, ring->fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0 );
+      if( rc < 0 ) {
+
+         rc = -errno;
+         if( rc == -EINTR ) {
+
+            // nothing was submitted
+            continue;
+         }
+
+         SG_error("io_uring_enter(%u, %u) rc = %d\n", to_submit, wait_nr, rc );
+         return rc;
+      }
+
+      break;
+   }
+
+   ring->inflight += rc;
+
+   return rc;
+}
+
+
+// reap all available completions, calling cb on each
+// return the number of completions reaped
+int md_uring_reap( struct md_uring* ring, md_uring_completion_func_t cb, void* cls ) {
+
+   int count = 0;
+   unsigned head = *ring->cq_head;
+   unsigned tail = __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE );
+
+   while( head != tail ) {
+
+      struct io_uring_cqe* cqe = &((struct io_uring_cqe*)ring->cqes)[ head & *ring->cq_mask ];
+
+      (*cb)( cqe->user_data, cqe->res, cls );
+
+      head++;
+      count++;
+   }
+
+   __atomic_store_n( ring->cq_head, head, __ATOMIC_RELEASE );
+
+   ring->inflight -= count;
+
+   return count;
+}
+
+#else
+
+int md_uring_init( struct md_uring* ring, unsigned entries ) {
+
+   memset( ring, 0, sizeof(struct md_uring) );
+   ring->fd = -1;
+   return -ENOSYS;
+}
+
+int md_uring_shutdown( struct md_uring* ring ) {
+   return 0;
+}
+
+int md_uring_prep_write( struct md_uring* ring, int fd, char const* buf, size_t len, off_t offset, uint64_t user_data ) {
+   return -ENOSYS;
+}
+
+int md_uring_prep_read( struct md_uring* ring, int fd, char* buf, size_t len, off_t offset, uint64_t user_data ) {
+   return -ENOSYS;
+}
+
+int md_uring_submit( struct md_uring* ring, unsigned wait_nr ) {
+   return -ENOSYS;
+}
+
+int md_uring_reap( struct md_uring* ring, md_uring_completion_func_t cb, void* cls ) {
+   return 0;
+}
+
+#endif
+
+// how many submitted operations have not been reaped?
+unsigned md_uring_inflight( struct md_uring* ring ) {
+   return ring->inflight;
+}
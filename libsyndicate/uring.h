@@ -0,0 +1,78 @@
+/*
+   Copyright 2014 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Minimal io_uring submission/completion ring, driven through the raw system calls.
+ * A ring is not thread-safe: one thread queues, submits, and reaps.
+ * If the kernel (or the headers we were built against) lack io_uring, or lack
+ * the opcodes we need, md_uring_init fails with -ENOSYS and callers fall back.
+ */
+
+#ifndef _LIBSYNDICATE_URING_H_
+#define _LIBSYNDICATE_URING_H_
+
+#include "libsyndicate/libsyndicate.h"
+
+#define MD_URING_DEFAULT_ENTRIES        256
+
+// completion callback: user data, and the operation's result (bytes transferred, or -errno)
+typedef void (*md_uring_completion_func_t)( uint64_t user_data, int res, void* cls );
+
+struct md_uring {
+
+   int fd;
+
+   // submission queue (shared with the kernel)
+   unsigned* sq_head;
+   unsigned* sq_tail;
+   unsigned* sq_mask;
+   unsigned* sq_array;
+   unsigned sq_entries;
+   void* sqes;                  // struct io_uring_sqe[ sq_entries ]
+   unsigned sq_queued_tail;     // tail including queued, unsubmitted entries
+
+   // completion queue (shared with the kernel)
+   unsigned* cq_head;
+   unsigned* cq_tail;
+   unsigned* cq_mask;
+   void* cqes;                  // struct io_uring_cqe[]
+
+   // mappings
+   void* sq_ring;
+   size_t sq_ring_len;
+   void* cq_ring;
+   size_t cq_ring_len;
+   size_t sqes_len;
+
+   unsigned inflight;           // submitted operations that have not been reaped
+};
+
+extern "C" {
+
+int md_uring_init( struct md_uring* ring, unsigned entries );
+int md_uring_shutdown( struct md_uring* ring );
+
+int md_uring_prep_write( struct md_uring* ring, int fd, char const* buf, size_t len, off_t offset, uint64_t user_data );
+int md_uring_prep_read( struct md_uring* ring, int fd, char* buf, size_t len, off_t offset, uint64_t user_data );
+
+int md_uring_submit( struct md_uring* ring, unsigned wait_nr );
+int md_uring_reap( struct md_uring* ring, md_uring_completion_func_t cb, void* cls );
+
+unsigned md_uring_inflight( struct md_uring* ring );
+
+}
+
+#endif
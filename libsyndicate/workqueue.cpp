@@ -17,13 +17,133 @@
 #include "workqueue.h"
 #include "util.h"
 
+// carry out a single work request, and account for it 
+static int md_wq_run_wreq( struct md_wq* wq, struct md_wreq* wreq ) {
+   
+   int rc = 0;
+   struct timespec run_start;
+   struct timespec run_end;
+   
+   clock_gettime( CLOCK_MONOTONIC, &run_start );
+   
+   pthread_mutex_lock( &wq->work_lock );
+   wq->busy = true;
+   pthread_mutex_unlock( &wq->work_lock );
+   
+   // carry out work 
+   rc = (*wreq->work)( wreq, wreq->work_data );
+   
+   clock_gettime( CLOCK_MONOTONIC, &run_end );
+   
+   SG_debug("Processed work %p (arg %p), rc = %d\n", wreq->work, wreq->work_data, rc );
+   
+   pthread_mutex_lock( &wq->work_lock );
+   
+   wq->busy = false;
+   wq->stats.num_processed++;
+   wq->stats.total_run_ns += md_timespec_diff( &run_end, &run_start );
+   
+   pthread_mutex_unlock( &wq->work_lock );
+   
+   // is this a promise?  if so, tell the caller that we've fulfilled it 
+   if( wreq->flags & MD_WQ_PROMISE ) {
+      wreq->promise_ret = rc;
+      sem_post( &wreq->promise_sem );
+   }
+   else {
+      
+      // done with this 
+      md_wreq_free( wreq );
+   }
+   
+   return rc;
+}
+
+
+// account for a work request leaving a workqueue's buffer
+// wq->work_lock must be held
+static void md_wq_dequeued( struct md_wq* wq, struct md_wreq* wreq ) {
+   
+   struct timespec now;
+   int64_t wait_ns = 0;
+   
+   clock_gettime( CLOCK_MONOTONIC, &now );
+   
+   wait_ns = md_timespec_diff( &now, &wreq->enqueue_time );
+   
+   wq->stats.depth--;
+   wq->stats.total_wait_ns += wait_ns;
+   
+   if( wait_ns > wq->stats.max_wait_ns ) {
+      wq->stats.max_wait_ns = wait_ns;
+   }
+}
+
+
+// pop the oldest work request from a workqueue's pending buffer 
+// return 0 on success, and fill in *wreq 
+// return -ENOENT if there is no work
+static int md_wq_pop( struct md_wq* wq, struct md_wreq* wreq ) {
+   
+   int rc = -ENOENT;
+   
+   pthread_mutex_lock( &wq->work_lock );
+   
+   if( wq->work->size() > 0 ) {
+      
+      *wreq = wq->work->front();
+      wq->work->pop();
+      
+      md_wq_dequeued( wq, wreq );
+      rc = 0;
+   }
+   
+   pthread_mutex_unlock( &wq->work_lock );
+   
+   return rc;
+}
+
+
+// get the next work request for a grouped workqueue.
+// try our own buffer first, and if it's empty, steal from our peers (starting with our right-hand neighbor)
+// return 0 on success, and fill in *wreq 
+// return -ENOENT if there's no work anywhere in the group 
+static int md_wq_group_next( struct md_wq* wq, struct md_wreq* wreq ) {
+   
+   int rc = 0;
+   int self = wq - wq->group;
+   
+   rc = md_wq_pop( wq, wreq );
+   if( rc == 0 ) {
+      return 0;
+   }
+   
+   for( int i = 1; i < wq->group_size; i++ ) {
+      
+      struct md_wq* victim = &wq->group[ (self + i) % wq->group_size ];
+      
+      rc = md_wq_pop( victim, wreq );
+      if( rc == 0 ) {
+         
+         pthread_mutex_lock( &wq->work_lock );
+         wq->stats.num_stolen++;
+         pthread_mutex_unlock( &wq->work_lock );
+         
+         SG_debug("workqueue %p stole work %p from workqueue %p\n", wq, wreq->work, victim );
+         return 0;
+      }
+   }
+   
+   return -ENOENT;
+}
+
+
 // work queue main method 
 static void* md_wq_main( void* cls ) {
    
    struct md_wq* wq = (struct md_wq*)cls;
    md_wq_queue_t* work = NULL;
    struct md_wreq wreq;
-   int rc = 0;
    
    SG_debug("workqueue %p start\n", wq );
    
@@ -37,6 +157,22 @@ static void* md_wq_main( void* cls ) {
          break;
       }
       
+      if( wq->group != NULL ) {
+         
+         // grouped: take one request at a time, so a slow request doesn't hold up the ones behind it.
+         // our peers can take them instead.
+         while( wq->running ) {
+            
+            if( md_wq_group_next( wq, &wreq ) != 0 ) {
+               break;
+            }
+            
+            md_wq_run_wreq( wq, &wreq );
+         }
+         
+         continue;
+      }
+      
       // exchange buffers--we have work 
       pthread_mutex_lock( &wq->work_lock );
       
@@ -58,21 +194,11 @@ static void* md_wq_main( void* cls ) {
          wreq = work->front();
          work->pop();
          
-         // carry out work 
-         rc = (*wreq.work)( &wreq, wreq.work_data );
+         pthread_mutex_lock( &wq->work_lock );
+         md_wq_dequeued( wq, &wreq );
+         pthread_mutex_unlock( &wq->work_lock );
          
-         SG_debug("Processed work %p (arg %p), rc = %d\n", wreq.work, wreq.work_data, rc );
-         
-         // is this a promise?  if so, tell the caller that we've fulfilled it 
-         if( wreq.flags & MD_WQ_PROMISE ) {
-            wreq.promise_ret = rc;
-            sem_post( &wreq.promise_sem );
-         }
-         else {
-            
-            // done with this 
-            md_wreq_free( &wreq );
-         }
+         md_wq_run_wreq( wq, &wreq );
       }
    }
    
@@ -291,26 +417,138 @@ int md_wreq_promise_ret( struct md_wreq* wreq ) {
 int md_wq_add( struct md_wq* wq, struct md_wreq* wreq ) {
    
    int rc = 0;
+   bool busy = false;
+   bool peer_idle = false;
+   
+   clock_gettime( CLOCK_MONOTONIC, &wreq->enqueue_time );
    
    pthread_mutex_lock( &wq->work_lock );
    
    try {
       wq->work->push( *wreq );
+      
+      wq->stats.num_added++;
+      wq->stats.depth++;
+      
+      if( wq->stats.depth > wq->stats.max_depth ) {
+         wq->stats.max_depth = wq->stats.depth;
+      }
    }
    catch( bad_alloc& ba ) {
       rc = -ENOMEM;
    }
    
+   busy = wq->busy;
+   
    pthread_mutex_unlock( &wq->work_lock );
    
    if( rc == 0 ) {
       // have work 
       sem_post( &wq->work_sem );
+      
+      if( wq->group != NULL && busy ) {
+         
+         // this workqueue's thread is occupied.
+         // wake up an idle peer so it can steal the request.
+         for( int i = 0; i < wq->group_size; i++ ) {
+            
+            if( !wq->group[i].running || &wq->group[i] == wq ) {
+               continue;
+            }
+            
+            pthread_mutex_lock( &wq->group[i].work_lock );
+            peer_idle = !wq->group[i].busy;
+            pthread_mutex_unlock( &wq->group[i].work_lock );
+            
+            if( peer_idle ) {
+               
+               sem_post( &wq->group[i].work_sem );
+               break;
+            }
+         }
+      }
    }
    
    return rc;
 }
 
+
+// set up a group of work queues that share work, but don't start them.
+// return 0 on success
+// return negative on failure:
+// * -ENOMEM if OOM
+int md_wq_group_init( struct md_wq* wqs, int count, void* cls ) {
+   
+   int rc = 0;
+   
+   for( int i = 0; i < count; i++ ) {
+      
+      rc = md_wq_init( &wqs[i], cls );
+      if( rc != 0 ) {
+         
+         for( int j = 0; j < i; j++ ) {
+            md_wq_free( &wqs[j], NULL );
+         }
+         
+         return rc;
+      }
+   }
+   
+   for( int i = 0; i < count; i++ ) {
+      
+      wqs[i].group = wqs;
+      wqs[i].group_size = count;
+   }
+   
+   return 0;
+}
+
+
+// enqueue work on a group of work queues.
+// pick the less-loaded of two randomly-chosen workqueues (idle ones first).
+// return 0 on success
+// return -ENOMEM on OOM
+int md_wq_group_add( struct md_wq* wqs, int count, struct md_wreq* wreq ) {
+   
+   struct md_wq* wq1 = &wqs[ md_random64() % count ];
+   struct md_wq* wq2 = &wqs[ md_random64() % count ];
+   struct md_wq* wq = wq1;
+   
+   uint64_t load1 = 0;
+   uint64_t load2 = 0;
+   
+   if( wq1 != wq2 ) {
+      
+      pthread_mutex_lock( &wq1->work_lock );
+      load1 = wq1->stats.depth + (wq1->busy ? 1 : 0);
+      pthread_mutex_unlock( &wq1->work_lock );
+      
+      pthread_mutex_lock( &wq2->work_lock );
+      load2 = wq2->stats.depth + (wq2->busy ? 1 : 0);
+      pthread_mutex_unlock( &wq2->work_lock );
+      
+      if( load2 < load1 ) {
+         wq = wq2;
+      }
+   }
+   
+   return md_wq_add( wq, wreq );
+}
+
+
+// get a snapshot of a workqueue's statistics 
+// return 0 on success
+int md_wq_get_stats( struct md_wq* wq, struct md_wq_stats* stats ) {
+   
+   pthread_mutex_lock( &wq->work_lock );
+   
+   *stats = wq->stats;
+   
+   pthread_mutex_unlock( &wq->work_lock );
+   
+   return 0;
+}
+
 // wake up the work queue 
 int md_wq_wakeup( struct md_wq* wq ) {
    return sem_post( &wq->work_sem );
@@ -46,6 +46,22 @@ struct md_wreq {
    // only initialized of MD_WQ_PROMISE is specified
    sem_t promise_sem;
    int promise_ret;
+   
+   // when this request was enqueued (for latency accounting)
+   struct timespec enqueue_time;
+};
+
+// workqueue statistics, for sizing workqueue groups
+struct md_wq_stats {
+   
+   uint64_t num_added;          // number of work requests enqueued on this workqueue
+   uint64_t num_processed;      // number of work requests this workqueue's thread carried out
+   uint64_t num_stolen;         // number of work requests this workqueue's thread took from its peers
+   uint64_t depth;              // number of work requests currently waiting
+   uint64_t max_depth;          // largest value depth has taken
+   int64_t total_wait_ns;       // total time work requests spent waiting to be carried out
+   int64_t max_wait_ns;         // longest time a work request spent waiting
+   int64_t total_run_ns;        // total time spent carrying out work requests
 };
 
 // workqueue type 
@@ -74,6 +90,17 @@ struct md_wq {
    
    // semaphore to signal the availability of work
    sem_t work_sem;
+   
+   // group of workqueues this workqueue belongs to (NULL if ungrouped).
+   // grouped workqueues take one request at a time, and steal work from their peers when idle.
+   struct md_wq* group;
+   int group_size;
+   
+   // is the thread carrying out work right now? (guarded by work_lock)
+   bool busy;
+   
+   // statistics (guarded by work_lock)
+   struct md_wq_stats stats;
 };
 
 extern "C" {
@@ -92,6 +119,11 @@ int md_wreq_promise_ret( struct md_wreq* wreq );
 
 int md_wq_add( struct md_wq* wq, struct md_wreq* wreq );
 
+int md_wq_group_init( struct md_wq* wqs, int count, void* cls );
+int md_wq_group_add( struct md_wq* wqs, int count, struct md_wreq* wreq );
+
+int md_wq_get_stats( struct md_wq* wq, struct md_wq_stats* stats );
+
 int md_wq_wakeup( struct md_wq* wq );
 
 void* md_wq_cls( struct md_wq* wq );
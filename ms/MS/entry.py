@@ -2418,6 +2418,61 @@ class MSEntry( storagetypes.Object ):
       return (0, children)
    
    
+   @classmethod
+   def ListDirRange( cls, volume, file_id, start_index, count ):
+      """
+      Generate a listing of the directory entries whose dir_indexes are in the range [start_index, start_index + count), for bulk listings.
+      The range is clipped to the directory's capacity.
+      
+      Return (rc, listing, next_index), where rc is 0 on success, or negative on error.
+      next_index is the first dir_index after the range, or -1 if the range reached the directory's capacity.
+      """
+      
+      if start_index < 0 or count <= 0:
+         return (-errno.EINVAL, None, -1)
+      
+      if MSEntry.is_serialized_id( file_id ):
+         file_id = MSEntry.unserialize_id( file_id )
+      
+      # get the directory 
+      dirent = MSEntry.Read( volume, file_id )
+   
+      # must exist
+      if dirent is None:
+         return (-errno.ENOENT, None, -1)
+      
+      # this had better be a directory...
+      if dirent.ftype != MSENTRY_TYPE_DIR:
+         logging.debug("Not a directory: %s" % file_id)
+         return (-errno.ENOTDIR, None, -1)
+      
+      end_index = min( start_index + count, dirent.capacity )
+      next_index = end_index
+      if end_index >= dirent.capacity:
+         next_index = -1
+      
+      # resolve an index node into the MSEntry, and cache both 
+      @storagetypes.concurrent 
+      def walk_index( dir_index ):
+         
+         dir_index_node = yield MSEntryIndex.Read( dirent.volume_id, dirent.file_id, dir_index, async=True )
+         
+         if dir_index_node is None:
+            storagetypes.concurrent_return( None )
+         
+         msentry = yield MSEntry.__read_msentry_from_index_async( dir_index_node, volume.num_shards )
+         storagetypes.concurrent_return( msentry )
+      
+      children_futs = [ walk_index(i) for i in xrange( start_index, end_index ) ]
+      storagetypes.wait_futures( children_futs )
+      
+      children = filter( lambda x: x is not None, [ c.get_result() for c in children_futs ] )
+      
+      logging.info("/%s/%s range=[%s, %s): num_children=%s capacity=%s" % (dirent.volume_id, dirent.file_id, start_index, end_index, len(children), dirent.capacity) )
+      
+      return (0, children, next_index)
+   
+   
    @classmethod
    def SetCache( cls, ent ):
       ent_cache_key_name = MSEntry.make_key_name( ent.volume_id, ent.file_id )
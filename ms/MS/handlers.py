@@ -218,7 +218,8 @@ class MSFileHandler(webapp2.RequestHandler):
    cgi_args = {
       "LISTDIR": {
          "page_id":        lambda arg: int(arg),
-         "lug":            lambda arg: int(arg)
+         "lug":            lambda arg: int(arg),
+         "bulk":           lambda arg: int(arg)
        }
    }
    
@@ -227,10 +228,13 @@ class MSFileHandler(webapp2.RequestHandler):
       "FETCHXATTRS":    lambda gateway, volume, file_id, args, kw: file_xattr_fetchxattrs( gateway, volume, file_id, *args, **kw ), # args == []
       "GETATTR":        lambda gateway, volume, file_id, args, kw: file_getattr( gateway, volume, file_id, *args, **kw ),           # args == [file_version_str, write_nonce]
       "GETCHILD":       lambda gateway, volume, file_id, args, kw: file_getchild( gateway, volume, file_id, *args, **kw ),          # args == [name]
-      "LISTDIR":        lambda gateway, volume, file_id, args, kw: file_listdir( gateway, volume, file_id, *args, **kw ),           # args == [], kw={page_id, lug}
+      "LISTDIR":        lambda gateway, volume, file_id, args, kw: file_listdir( gateway, volume, file_id, *args, **kw ),           # args == [], kw={page_id, lug, bulk}
       "VACUUM":         lambda gateway, volume, file_id, args, kw: file_vacuum_log_peek( gateway, volume, file_id, *args, **kw )    # args == []
    }
    
+   # set on responses that carry a bulk listing (a sequence of length-prefixed, signed ms_reply frames)
+   bulk_listing_header = "X-Syndicate-Bulk-Listing"
+   
    get_benchmark_headers = {
       "FETCHXATTRS":            "X-Fetchxattr-Time",
       "GETATTR":                "X-Getattr-Time",
@@ -402,6 +406,10 @@ class MSFileHandler(webapp2.RequestHandler):
       timing_headers = benchmark_headers( timing )
       timing_headers.update( response_timing )
       
+      # tell the client it got a bulk listing (older MSs ignore the bulk argument, and reply with a single ms_reply)
+      if operation == "LISTDIR" and "bulk" in kw:
+         timing_headers[ MSFileHandler.bulk_listing_header ] = "1"
+      
       response_end( self, 200, data, "application/octet-stream", timing_headers )
       return
    
@@ -34,6 +34,8 @@ import base64
 import traceback
 import logging
 
+from google.protobuf.internal import encoder
+
 # ----------------------------------
 def make_ms_reply( volume, error ):
    """
@@ -303,6 +305,51 @@ def _listdir( owner_id, volume, file_id, page_id=None, least_unknown_generation=
    return (error, file_update_complete_response( volume, reply ))
    
 
+# ----------------------------------
+def _listdir_bulk( owner_id, volume, file_id, start_index ):
+   """
+   Generate a bulk listing: a sequence of signed ms_reply frames, each prefixed with its varint-encoded length.
+   Each frame carries up to RESOLVE_BULK_FRAME_SIZE children.  Every frame's listing has next_index set to
+   the dir_index to resume from once this response is consumed (or -1 if there are no more children).
+   On error, the response is a single frame with the error code set.
+   """
+   
+   error, listing, next_index = MSEntry.ListDirRange( volume, file_id, start_index, msconfig.RESOLVE_MAX_BULK_LISTING )
+   
+   frames = []
+   
+   if error == 0:
+      # only give back visible entries
+      listing = filter( lambda ent: file_read_allowed( owner_id, ent ) == 0, listing )
+   
+   else:
+      listing = []
+   
+   # always send at least one frame, so the caller learns next_index (or the error)
+   for i in xrange( 0, max( len(listing), 1 ), msconfig.RESOLVE_BULK_FRAME_SIZE ):
+      
+      reply = make_ms_reply( volume, error )
+      
+      if error == 0:
+         
+         reply.listing.ftype = MSENTRY_TYPE_DIR
+         reply.listing.status = ms_pb2.ms_listing.NEW
+         reply.listing.next_index = next_index
+         
+         for ent in listing[i:i + msconfig.RESOLVE_BULK_FRAME_SIZE]:
+            ent_pb = reply.listing.entries.add()
+            MSEntry.protobuf( ent, ent_pb )
+      
+      else:
+         reply.listing.ftype = 0
+         reply.listing.status = ms_pb2.ms_listing.NONE
+      
+      frame = file_update_complete_response( volume, reply )
+      frames.append( encoder._VarintBytes( len(frame) ) + frame )
+   
+   return (error, "".join( frames ))
+
+
 # ----------------------------------
 def file_getattr( gateway, volume, file_id, file_version_str, write_nonce_str ):
    """
@@ -352,15 +399,24 @@ def file_getchild( gateway, volume, parent_id, name ):
 
 
 # ----------------------------------
-def file_listdir( gateway, volume, file_id, page_id=None, lug=None ):
+def file_listdir( gateway, volume, file_id, page_id=None, lug=None, bulk=None ):
    """
    Get up to RESOLVE_MAX_PAGE_SIZE of (type, file ID) pairs.
    when the caller last called listdir (or -1 if this is the first call to listdir).
+   If bulk is given, then instead stream up to RESOLVE_MAX_BULK_LISTING entries starting at dir_index bulk (see _listdir_bulk).
    """
    
-   logging.info("listdir /%s/%s, page_id=%s, l.u.g.=%s" % (volume.volume_id, file_id, page_id, lug) )
+   logging.info("listdir /%s/%s, page_id=%s, l.u.g.=%s, bulk=%s" % (volume.volume_id, file_id, page_id, lug, bulk) )
+   
+   if bulk is not None:
+      
+      owner_id = msconfig.GATEWAY_ID_ANON
+      if gateway != None:
+         owner_id = gateway.owner_id
+      
+      rc, reply = _listdir_bulk( owner_id, volume, file_id, bulk )
    
-   if page_id is not None or lug is not None:
+   elif page_id is not None or lug is not None:
         
       owner_id = msconfig.GATEWAY_ID_ANON
       if gateway != None:
@@ -376,7 +432,7 @@ def file_listdir( gateway, volume, file_id, page_id=None, lug=None ):
       reply.listing.ftype = 0
       reply.listing.status = ms_pb2.ms_listing.NONE 
    
-   logging.info("listdir /%s/%s, page_id=%s, l.u.g.=%s rc = %d" % (volume.volume_id, file_id, page_id, lug, rc) )
+   logging.info("listdir /%s/%s, page_id=%s, l.u.g.=%s, bulk=%s rc = %d" % (volume.volume_id, file_id, page_id, lug, bulk, rc) )
    
    return reply
 
@@ -112,6 +112,8 @@ PASSWORD_SALT_LENGTH = 32
 
 # rate-limiting 
 RESOLVE_MAX_PAGE_SIZE = 10 
+RESOLVE_BULK_FRAME_SIZE = 100           # number of entries in each signed frame of a bulk listing
+RESOLVE_MAX_BULK_LISTING = 5000         # number of directory indexes a single bulk listing request covers
 MAX_NUM_CONNECTIONS = 50 
 MAX_BATCH_REQUEST_SIZE = 6
 MAX_BATCH_ASYNC_REQUEST_SIZE = 100
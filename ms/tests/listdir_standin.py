@@ -0,0 +1,299 @@
+#!/usr/bin/env python
+
+"""
+   Copyright 2015 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+"""
+
+"""
+Local stand-in MS for benchmarking directory listings.
+
+Serves LISTDIR for a single synthetic directory, both page by page (?page_id=N)
+and in bulk (?bulk=N), using the same wire formats as MS/methods/file.py.
+Signatures are filler of realistic size, so this measures protocol cost
+(requests, bytes, wall-clock time), not signing or verification cost.
+
+Usage:
+   listdir_standin.py serve [--port P] [--children N] [--no-bulk]
+   listdir_standin.py bench [--port P] [--children N] [--connections C]
+
+"bench" starts a stand-in in the background and lists the directory both ways.
+--no-bulk makes the stand-in behave like an MS that predates bulk listings.
+"""
+
+import sys
+import time
+import getopt
+import threading
+import urllib2
+import urlparse
+import BaseHTTPServer
+import SocketServer
+
+from google.protobuf.internal import encoder
+from google.protobuf.internal import decoder
+
+import protobufs.ms_pb2 as ms_pb2
+
+# keep in sync with common/msconfig.py
+RESOLVE_MAX_PAGE_SIZE = 10
+RESOLVE_BULK_FRAME_SIZE = 100
+RESOLVE_MAX_BULK_LISTING = 5000
+
+BULK_LISTING_HEADER = "X-Syndicate-Bulk-Listing"
+
+VOLUME_ID = 1
+PARENT_ID = 0x1234
+SIGNATURE = "S" * 684      # base64 of a 4096-bit RSA signature
+
+# ----------------------------------
+def make_entry( ent_pb, dir_index ):
+   """
+   Fill in a synthetic child entry for the given directory index.
+   """
+   ent_pb.type = ms_pb2.ms_entry.MS_ENTRY_TYPE_FILE
+   ent_pb.file_id = 0x10000 + dir_index
+   ent_pb.ctime_sec = ent_pb.mtime_sec = ent_pb.manifest_mtime_sec = 1420070400
+   ent_pb.ctime_nsec = ent_pb.mtime_nsec = ent_pb.manifest_mtime_nsec = 0
+   ent_pb.owner = 1
+   ent_pb.coordinator = 1
+   ent_pb.volume = VOLUME_ID
+   ent_pb.mode = 0644
+   ent_pb.size = 4096
+   ent_pb.version = 1
+   ent_pb.max_read_freshness = ent_pb.max_write_freshness = 5000
+   ent_pb.name = "file-%08d" % dir_index
+   ent_pb.write_nonce = ent_pb.xattr_nonce = 1
+   ent_pb.generation = dir_index + 1
+   ent_pb.signature = SIGNATURE
+   ent_pb.parent_id = PARENT_ID
+   ent_pb.num_children = 0
+   ent_pb.capacity = 0
+
+
+# ----------------------------------
+def make_reply( start, end, next_index=None ):
+   """
+   Make a signed-looking ms_reply listing the children in [start, end).
+   """
+   reply = ms_pb2.ms_reply()
+   reply.volume_version = 1
+   reply.cert_version = 1
+   reply.error = 0
+   reply.signature = SIGNATURE
+   reply.listing.ftype = ms_pb2.ms_entry.MS_ENTRY_TYPE_DIR
+   reply.listing.status = ms_pb2.ms_listing.NEW
+
+   if next_index is not None:
+      reply.listing.next_index = next_index
+
+   for i in xrange( start, end ):
+      make_entry( reply.listing.entries.add(), i )
+
+   return reply.SerializeToString()
+
+
+# ----------------------------------
+class StandinMSHandler( BaseHTTPServer.BaseHTTPRequestHandler ):
+
+   def log_message( self, fmt, *args ):
+      pass
+
+   def do_GET( self ):
+      args = urlparse.parse_qs( urlparse.urlparse( self.path ).query )
+      num_children = self.server.num_children
+      headers = {}
+
+      if "bulk" in args and self.server.bulk:
+
+         # same framing as _listdir_bulk
+         start = int( args["bulk"][0] )
+         end = min( start + RESOLVE_MAX_BULK_LISTING, num_children )
+         next_index = end if end < num_children else -1
+
+         frames = []
+         for i in xrange( start, max( end, start + 1 ), RESOLVE_BULK_FRAME_SIZE ):
+            frame = make_reply( i, min( i + RESOLVE_BULK_FRAME_SIZE, end ), next_index )
+            frames.append( encoder._VarintBytes( len(frame) ) + frame )
+
+         data = "".join( frames )
+         headers[ BULK_LISTING_HEADER ] = "1"
+
+      elif "page_id" in args:
+
+         start = int( args["page_id"][0] ) * RESOLVE_MAX_PAGE_SIZE
+         data = make_reply( min( start, num_children ), min( start + RESOLVE_MAX_PAGE_SIZE, num_children ) )
+
+      else:
+
+         # what an MS without bulk listings does with ?bulk=
+         reply = ms_pb2.ms_reply()
+         reply.volume_version = 1
+         reply.cert_version = 1
+         reply.error = 0
+         reply.signature = SIGNATURE
+         reply.listing.ftype = 0
+         reply.listing.status = ms_pb2.ms_listing.NONE
+         data = reply.SerializeToString()
+
+      self.send_response( 200 )
+      self.send_header( "Content-Type", "application/octet-stream" )
+      self.send_header( "Content-Length", str(len(data)) )
+      for (k, v) in headers.items():
+         self.send_header( k, v )
+      self.end_headers()
+      self.wfile.write( data )
+
+
+class StandinMS( SocketServer.ThreadingMixIn, BaseHTTPServer.HTTPServer ):
+   daemon_threads = True
+
+   def __init__( self, port, num_children, bulk ):
+      BaseHTTPServer.HTTPServer.__init__( self, ("localhost", port), StandinMSHandler )
+      self.num_children = num_children
+      self.bulk = bulk
+
+
+# ----------------------------------
+def listdir_url( port, qs ):
+   return "http://localhost:%d/FILE/LISTDIR/%d.1.1/%X?%s" % (port, VOLUME_ID, PARENT_ID, qs)
+
+
+def bench_paged( port, num_children, connections ):
+   """
+   List the directory page by page, with up to `connections` requests in flight (like md_download_loop).
+   Return (num_requests, num_bytes, num_entries).
+   """
+   num_pages = (num_children + RESOLVE_MAX_PAGE_SIZE - 1) / RESOLVE_MAX_PAGE_SIZE
+   pages = range( 0, num_pages )
+   totals = [0, 0, 0]
+   lock = threading.Lock()
+
+   def worker():
+      while True:
+         with lock:
+            if len(pages) == 0:
+               return
+            page_id = pages.pop()
+
+         data = urllib2.urlopen( listdir_url( port, "page_id=%d" % page_id ) ).read()
+         reply = ms_pb2.ms_reply()
+         reply.ParseFromString( data )
+
+         with lock:
+            totals[0] += 1
+            totals[1] += len(data)
+            totals[2] += len(reply.listing.entries)
+
+   threads = [threading.Thread( target=worker ) for i in xrange( 0, connections )]
+   for t in threads:
+      t.start()
+   for t in threads:
+      t.join()
+
+   return tuple(totals)
+
+
+def bench_bulk( port ):
+   """
+   List the directory in bulk, following next_index, decoding frames as in ms_client_listdir_bulk_download.
+   Return (num_requests, num_bytes, num_entries), or None if the stand-in doesn't do bulk listings.
+   """
+   num_requests = 0
+   num_bytes = 0
+   num_entries = 0
+   start_index = 0
+
+   while start_index >= 0:
+
+      resp = urllib2.urlopen( listdir_url( port, "bulk=%d" % start_index ) )
+      data = resp.read()
+      num_requests += 1
+      num_bytes += len(data)
+
+      if resp.info().getheader( BULK_LISTING_HEADER ) is None:
+         return None
+
+      off = 0
+      while off < len(data):
+         (frame_len, off) = decoder._DecodeVarint32( data, off )
+         reply = ms_pb2.ms_reply()
+         reply.ParseFromString( data[off:off + frame_len] )
+         off += frame_len
+
+         num_entries += len(reply.listing.entries)
+         start_index = reply.listing.next_index
+
+   return (num_requests, num_bytes, num_entries)
+
+
+# ----------------------------------
+def usage( progname ):
+   print >> sys.stderr, __doc__.replace( "listdir_standin.py", progname )
+   sys.exit(1)
+
+
+if __name__ == "__main__":
+
+   if len(sys.argv) < 2 or sys.argv[1] not in ["serve", "bench"]:
+      usage( sys.argv[0] )
+
+   port = 32780
+   num_children = 200000
+   connections = 100           # MS_CLIENT_DEFAULT_MAX_CONNECTIONS
+   bulk = True
+
+   try:
+      opts, _ = getopt.getopt( sys.argv[2:], "", ["port=", "children=", "connections=", "no-bulk"] )
+   except getopt.GetoptError, e:
+      usage( sys.argv[0] )
+
+   for (opt, val) in opts:
+      if opt == "--port":
+         port = int(val)
+      elif opt == "--children":
+         num_children = int(val)
+      elif opt == "--connections":
+         connections = int(val)
+      elif opt == "--no-bulk":
+         bulk = False
+
+   server = StandinMS( port, num_children, bulk )
+
+   if sys.argv[1] == "serve":
+      print "stand-in MS on port %d: directory %X has %d children (bulk listings %s)" % (port, PARENT_ID, num_children, "on" if bulk else "off")
+      server.serve_forever()
+      sys.exit(0)
+
+   t = threading.Thread( target=server.serve_forever )
+   t.daemon = True
+   t.start()
+
+   start = time.time()
+   paged = bench_paged( port, num_children, connections )
+   paged_time = time.time() - start
+
+   start = time.time()
+   bulk_result = bench_bulk( port )
+   bulk_time = time.time() - start
+
+   print "%-6s %10s %14s %10s %10s" % ("mode", "requests", "bytes", "entries", "seconds")
+   print "%-6s %10d %14d %10d %10.3f" % (("paged",) + paged + (paged_time,))
+
+   if bulk_result is not None:
+      print "%-6s %10d %14d %10d %10.3f" % (("bulk",) + bulk_result + (bulk_time,))
+   else:
+      print "%-6s (not supported by the stand-in; the client would fall back to paging)" % "bulk"
+
+   server.shutdown()
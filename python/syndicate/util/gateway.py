@@ -24,6 +24,7 @@ import traceback
 import signal
 import json
 import threading
+import Queue
 import cPickle as pickle
 import imp
 from syndicate.protobufs.sg_pb2 import DriverRequest, Manifest
@@ -100,24 +101,26 @@ def read_data( f, size ):
    Return None on error
    """
    
-   chunk = f.read( size+1 )
-   if len(chunk) == 0:
+   # read the data and its trailer separately, so large chunks
+   # don't get copied again just to strip the newline
+   chunk = f.read( size )
+   trailer = f.read( 1 )
+   if len(chunk) == 0 and len(trailer) == 0:
        # gateway exit
        do_driver_shutdown()
    
-   if len(chunk) != size+1:
+   if len(chunk) != size or len(trailer) != 1:
       
       # invalid chunk 
       print >> sys.stderr, "Data too short"
       return None 
    
-   if chunk[-1] != '\n':
+   if trailer != '\n':
       
       # invalid chunk 
       print >> sys.stderr, "Data too long"
       return None 
    
-   chunk = chunk[:len(chunk)-1]
    return chunk
 
 
@@ -199,7 +202,100 @@ def write_chunk( f, data ):
    Send back a length, followed by a newline, followed by a string
    of data to Syndicate.
    """
-   f.write( "%s\n%s\n" % (len(data), data))
+   f.write( "%s\n" % len(data) )
+   f.write( data )
+   f.write( "\n" )
+
+
+def driver_pipeline_depth( driver_mod ):
+   """
+   Get the number of requests the driver wants to handle at once.
+   A driver opts into the framed protocol by setting PIPELINE_DEPTH
+   to an integer greater than 1 (its callbacks must then be thread-safe).
+   Return the depth; 1 means one request at a time.
+   """
+   depth = getattr( driver_mod, "PIPELINE_DEPTH", 1 )
+   if type(depth) not in [int, long] or depth < 1:
+      log_error("Invalid PIPELINE_DEPTH '%s'; handling one request at a time" % depth)
+      return 1
+
+   return depth
+
+
+def driver_ready( depth ):
+   """
+   Tell the gateway that we're ready for requests.
+   Send "0" to handle one request at a time, or "3" followed
+   by the depth to use the framed protocol.
+   """
+   if depth > 1:
+      print "3"
+      print "%s" % depth
+   else:
+      print "0"
+
+   sys.stdout.flush()
+
+
+def serve_framed( handler, depth ):
+   """
+   Serve requests forever using the framed protocol.
+   Each request is:
+      request ID (int)\n
+      request size (int)\n
+      request (string)\n
+   where the request is what the gateway sends in the original protocol.
+   Each reply has the same form, and carries the request's ID.
+   Up to depth requests are handled at once, and replies are sent
+   as soon as they are ready (i.e. possibly out of order).
+
+   handler( fin, fout ) reads one request from fin and writes the reply to fout.
+   """
+
+   requests = Queue.Queue( depth )
+   reply_lock = threading.Lock()
+
+   def serve_requests():
+      while True:
+
+         request_id, request_data = requests.get()
+         fin = cStringIO.StringIO( request_data )
+         fout = cStringIO.StringIO()
+
+         try:
+            handler( fin, fout )
+         except SystemExit, se:
+            # the handler wants to stop the worker
+            sys.stderr.flush()
+            os._exit( se.code if type(se.code) in [int, long] else 4 )
+         except:
+            log_error("Request %s failed" % request_id)
+            log_error(traceback.format_exc())
+            sys.stderr.flush()
+            os._exit(4)
+
+         with reply_lock:
+            write_int( sys.stdout, request_id )
+            write_chunk( sys.stdout, fout.getvalue() )
+            sys.stdout.flush()
+            sys.stderr.flush()
+
+   for i in xrange(0, depth):
+      t = threading.Thread( target=serve_requests )
+      t.daemon = True
+      t.start()
+
+   while True:
+
+      request_id = read_int( sys.stdin )
+      if request_id is None:
+         sys.exit(3)
+
+      request_data = read_chunk( sys.stdin )
+      if request_data is None:
+         sys.exit(3)
+
+      requests.put( (request_id, request_data) )
 
 
 def request_byte_offset( request ):
@@ -210,7 +306,7 @@ def request_byte_offset( request ):
    Return None if the request is not for a block
    """
    
-   if hasattr(request, "io_type") and hasattr(request, "offset") and request.io_type in [DriverRequest.READ, DriverRequest.WRITE]:
+   if hasattr(request, "io_type") and hasattr(request, "offset") and request.io_type in [DriverRequest.READ, DriverRequest.WRITE, DriverRequest.PREFETCH]:
        # gateway-given offset hint
        return request.offset
 
@@ -225,7 +321,7 @@ def request_byte_len( request ):
    Return None if the request is not for a block
    """
    
-   if hasattr(request, "io_type") and hasattr(request, "len") and request.io_type in [DriverRequest.READ, DriverRequest.WRITE]:
+   if hasattr(request, "io_type") and hasattr(request, "len") and request.io_type in [DriverRequest.READ, DriverRequest.WRITE, DriverRequest.PREFETCH]:
        # gateway-given offset hint
        return request.len
 
@@ -0,0 +1,252 @@
+/*
+   Copyright 2015 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Microbenchmark for the block cache's LRU maintenance.
+ *
+ * Builds an LRU of N cached blocks, then times the work the cache thread does on each pass of its loop:
+ * merging new writes, promoting recently-read blocks, demoting blocks scheduled for eviction, and evicting
+ * from the front.  The hashed LRU (md_cache_promote_blocks/md_cache_demote_blocks) is compared against the
+ * old linear scan, which is re-implemented here for reference.
+ *
+ * Usage: cache-lru-bench [-n MAX_ENTRIES] [-p PROMOTES_PER_PASS] [-r PASSES] [-l MAX_LINEAR_ENTRIES]
+ */
+
+#include <libsyndicate/libsyndicate.h>
+#include <libsyndicate/cache.h>
+#include <libsyndicate/util.h>
+
+#include <getopt.h>
+
+// make the key for the ith cached block (64 blocks per file)
+static struct md_cache_entry_key cache_lru_bench_key( uint64_t i ) {
+
+   struct md_cache_entry_key c;
+
+   c.file_id = 0x1000 + (i / 64);
+   c.file_version = 1;
+   c.block_id = i % 64;
+   c.block_version = (int64_t)(i * 2654435761ULL);
+
+   return c;
+}
+
+
+// the old linear-time promotion, for comparison
+static void cache_lru_bench_linear_promote( md_cache_lru_t* cache_lru, md_cache_lru_t* promotes ) {
+
+   for( md_cache_lru_t::iterator pitr = promotes->begin(); pitr != promotes->end(); pitr++ ) {
+
+      for( md_cache_lru_t::iterator citr = cache_lru->begin(); citr != cache_lru->end(); ) {
+
+         if( md_cache_entry_key_comp::equal( *pitr, *citr ) ) {
+            citr = cache_lru->erase( citr );
+         }
+         else {
+            citr++;
+         }
+      }
+   }
+
+   cache_lru->splice( cache_lru->end(), *promotes );
+}
+
+
+// the old linear-time demotion, for comparison
+static void cache_lru_bench_linear_demote( md_cache_lru_t* cache_lru, md_cache_lru_t* demotes ) {
+
+   for( md_cache_lru_t::iterator ditr = demotes->begin(); ditr != demotes->end(); ditr++ ) {
+
+      for( md_cache_lru_t::iterator citr = cache_lru->begin(); citr != cache_lru->end(); ) {
+
+         if( md_cache_entry_key_comp::equal( *ditr, *citr ) ) {
+            citr = cache_lru->erase( citr );
+         }
+         else {
+            citr++;
+         }
+      }
+   }
+
+   cache_lru->splice( cache_lru->begin(), *demotes );
+}
+
+
+// run passes of the cache thread's LRU work over an LRU of num_entries blocks.
+// each pass adds num_promotes/4 new writes, promotes num_promotes random blocks, demotes num_promotes/10 random blocks,
+// and evicts from the front to keep the LRU at num_entries.
+// return the average nanoseconds per pass on success
+// return -ENOMEM on OOM
+static int64_t cache_lru_bench_run( uint64_t num_entries, uint64_t num_promotes, int num_passes, bool linear ) {
+
+   int rc = 0;
+   md_cache_lru_t cache_lru;
+   md_cache_lru_index_t cache_lru_index;
+   md_cache_lru_t new_writes;
+   md_cache_lru_t promotes;
+   md_cache_lru_t demotes;
+   uint64_t next_key = 0;
+   struct timespec start, end;
+   int64_t total_ns = 0;
+
+   try {
+
+      // fill the cache
+      for( next_key = 0; next_key < num_entries; next_key++ ) {
+         new_writes.push_back( cache_lru_bench_key( next_key ) );
+      }
+
+      if( linear ) {
+         cache_lru.splice( cache_lru.end(), new_writes );
+      }
+      else {
+
+         rc = md_cache_promote_blocks( &cache_lru, &cache_lru_index, &new_writes );
+         if( rc != 0 ) {
+            return rc;
+         }
+      }
+
+      for( int pass = 0; pass < num_passes; pass++ ) {
+
+         // this pass's work, as the cache thread would find it in its buffers
+         for( uint64_t i = 0; i < num_promotes / 4; i++ ) {
+            new_writes.push_back( cache_lru_bench_key( next_key ) );
+            next_key++;
+         }
+
+         for( uint64_t i = 0; i < num_promotes; i++ ) {
+            promotes.push_back( cache_lru_bench_key( next_key - 1 - (md_random64() % num_entries) ) );
+         }
+
+         for( uint64_t i = 0; i < num_promotes / 10; i++ ) {
+            demotes.push_back( cache_lru_bench_key( next_key - 1 - (md_random64() % num_entries) ) );
+         }
+
+         clock_gettime( CLOCK_MONOTONIC, &start );
+
+         if( linear ) {
+
+            cache_lru.splice( cache_lru.end(), new_writes );
+            cache_lru_bench_linear_promote( &cache_lru, &promotes );
+            cache_lru_bench_linear_demote( &cache_lru, &demotes );
+
+            while( cache_lru.size() > num_entries ) {
+               cache_lru.pop_front();
+            }
+         }
+         else {
+
+            md_cache_promote_blocks( &cache_lru, &cache_lru_index, &new_writes );
+            md_cache_promote_blocks( &cache_lru, &cache_lru_index, &promotes );
+            md_cache_demote_blocks( &cache_lru, &cache_lru_index, &demotes );
+
+            while( cache_lru.size() > num_entries ) {
+
+               cache_lru_index.erase( cache_lru.front() );
+               cache_lru.pop_front();
+            }
+         }
+
+         clock_gettime( CLOCK_MONOTONIC, &end );
+
+         total_ns += md_timespec_diff( &end, &start );
+      }
+   }
+   catch( bad_alloc& ba ) {
+      return -ENOMEM;
+   }
+
+   return total_ns / num_passes;
+}
+
+
+static void usage( char const* progname ) {
+
+   fprintf(stderr, "Usage: %s [-n MAX_ENTRIES] [-p PROMOTES_PER_PASS] [-r PASSES] [-l MAX_LINEAR_ENTRIES]\n", progname );
+   exit(1);
+}
+
+
+int main( int argc, char** argv ) {
+
+   uint64_t max_entries = 1000000;
+   uint64_t max_linear_entries = 100000;     // the linear scan takes minutes past this
+   uint64_t num_promotes = 1000;
+   int num_passes = 10;
+   int c = 0;
+   int64_t hashed_ns = 0;
+   int64_t linear_ns = 0;
+
+   while( (c = getopt( argc, argv, "n:p:r:l:" )) != -1 ) {
+
+      switch( c ) {
+
+         case 'n':
+            max_entries = strtoull( optarg, NULL, 10 );
+            break;
+
+         case 'p':
+            num_promotes = strtoull( optarg, NULL, 10 );
+            break;
+
+         case 'r':
+            num_passes = atoi( optarg );
+            break;
+
+         case 'l':
+            max_linear_entries = strtoull( optarg, NULL, 10 );
+            break;
+
+         default:
+            usage( argv[0] );
+      }
+   }
+
+   if( max_entries == 0 || num_promotes == 0 || num_passes <= 0 ) {
+      usage( argv[0] );
+   }
+
+   printf("%12s %10s %16s %16s\n", "entries", "promotes", "hashed ns/pass", "linear ns/pass");
+
+   for( uint64_t num_entries = 1000; num_entries <= max_entries; num_entries *= 10 ) {
+
+      hashed_ns = cache_lru_bench_run( num_entries, num_promotes, num_passes, false );
+      if( hashed_ns < 0 ) {
+
+         fprintf(stderr, "cache_lru_bench_run(%" PRIu64 ") rc = %" PRId64 "\n", num_entries, hashed_ns );
+         exit(1);
+      }
+
+      if( num_entries <= max_linear_entries ) {
+
+         linear_ns = cache_lru_bench_run( num_entries, num_promotes, num_passes, true );
+         if( linear_ns < 0 ) {
+
+            fprintf(stderr, "cache_lru_bench_run(%" PRIu64 ", linear) rc = %" PRId64 "\n", num_entries, linear_ns );
+            exit(1);
+         }
+
+         printf("%12" PRIu64 " %10" PRIu64 " %16" PRId64 " %16" PRId64 "\n", num_entries, num_promotes, hashed_ns, linear_ns );
+      }
+      else {
+
+         printf("%12" PRIu64 " %10" PRIu64 " %16" PRId64 " %16s\n", num_entries, num_promotes, hashed_ns, "-" );
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,634 @@
+/*
+   Copyright 2015 The Trustees of Princeton University
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * Benchmark for the downloader's idle CPU use and per-request latency.
+ *
+ * Serves a fixed-size body from a loopback HTTP server in this process.  Then, for the event-driven downloader
+ * (md_downloader) and for the old polling loop (curl_multi_perform and a select() capped at 5ms, re-implemented
+ * here for reference), it measures:
+ *   * idle CPU:  process CPU time spent while the downloader runs with nothing to do, as a percentage of wall time
+ *   * latency:  wall time from starting a download to its waiter waking up, over sequential requests on one handle
+ *
+ * Usage: downloader-bench [-i IDLE_SECONDS] [-n REQUESTS] [-s BODY_SIZE]
+ */
+
+#include <libsyndicate/libsyndicate.h>
+#include <libsyndicate/download.h>
+#include <libsyndicate/util.h>
+
+#include <getopt.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/select.h>
+
+// who to wake up when a handle finishes
+typedef map<CURL*, sem_t*> downloader_bench_waiters_t;
+
+// loopback HTTP server
+struct downloader_bench_server {
+
+   int sock;
+   int port;
+   char* response;              // headers and body
+   size_t response_len;
+};
+
+// the old polling downloader loop, for comparison
+struct downloader_bench_poll_loop {
+
+   CURLM* curlm;
+   pthread_t thread;
+
+   pthread_mutex_t lock;        // governs pending and waiters
+   list<CURL*>* pending;        // handles to add to curlm on the next pass
+   downloader_bench_waiters_t* waiters;   // semaphores of callers waiting on handles
+
+   volatile bool running;
+};
+
+
+// discard downloaded data (for the polling loop)
+static size_t downloader_bench_discard( char* ptr, size_t size, size_t nmemb, void* userdata ) {
+   return size * nmemb;
+}
+
+
+// serve one connection:  answer each request on it with the canned response, until the client hangs up
+static void* downloader_bench_server_conn( void* arg ) {
+
+   int fd = (int)(intptr_t)((void**)arg)[0];
+   struct downloader_bench_server* srv = (struct downloader_bench_server*)((void**)arg)[1];
+   char buf[4096];
+   size_t have = 0;
+   ssize_t nr = 0;
+
+   SG_safe_free( arg );
+
+   while( true ) {
+
+      nr = read( fd, buf + have, sizeof(buf) - 1 - have );
+      if( nr <= 0 ) {
+         break;
+      }
+
+      have += nr;
+      buf[have] = '\0';
+
+      // answer each complete request header (requests have no bodies)
+      char* end = NULL;
+      while( (end = strstr( buf, "\r\n\r\n" )) != NULL ) {
+
+         size_t used = (end + 4) - buf;
+
+         if( md_write_uninterrupted( fd, srv->response, srv->response_len ) != (ssize_t)srv->response_len ) {
+
+            close( fd );
+            return NULL;
+         }
+
+         memmove( buf, buf + used, have - used );
+         have -= used;
+         buf[have] = '\0';
+      }
+
+      if( have == sizeof(buf) - 1 ) {
+         // header too big; not from us
+         break;
+      }
+   }
+
+   close( fd );
+   return NULL;
+}
+
+
+// accept connections, and serve each in its own thread
+static void* downloader_bench_server_main( void* arg ) {
+
+   struct downloader_bench_server* srv = (struct downloader_bench_server*)arg;
+
+   while( true ) {
+
+      int fd = accept( srv->sock, NULL, NULL );
+      if( fd < 0 ) {
+
+         if( errno == EINTR ) {
+            continue;
+         }
+
+         break;
+      }
+
+      void** conn_arg = SG_CALLOC( void*, 2 );
+      if( conn_arg == NULL ) {
+
+         close( fd );
+         continue;
+      }
+
+      conn_arg[0] = (void*)(intptr_t)fd;
+      conn_arg[1] = srv;
+
+      pthread_t conn_thread;
+      if( md_start_thread( &conn_thread, downloader_bench_server_conn, conn_arg, true ) < 0 ) {
+
+         SG_safe_free( conn_arg );
+         close( fd );
+      }
+   }
+
+   return NULL;
+}
+
+
+// start the loopback server, answering every request with body_size bytes
+// return 0 on success
+// return -ENOMEM on OOM
+// return -errno on socket error
+static int downloader_bench_server_start( struct downloader_bench_server* srv, size_t body_size ) {
+
+   int rc = 0;
+   struct sockaddr_in addr;
+   socklen_t addr_len = sizeof(addr);
+   pthread_t thread;
+   char headers[256];
+
+   memset( srv, 0, sizeof(struct downloader_bench_server) );
+
+   snprintf( headers, sizeof(headers), "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %zu\r\n\r\n", body_size );
+
+   srv->response_len = strlen(headers) + body_size;
+   srv->response = SG_CALLOC( char, srv->response_len );
+   if( srv->response == NULL ) {
+      return -ENOMEM;
+   }
+
+   memcpy( srv->response, headers, strlen(headers) );
+   memset( srv->response + strlen(headers), 'x', body_size );
+
+   srv->sock = socket( AF_INET, SOCK_STREAM, 0 );
+   if( srv->sock < 0 ) {
+
+      rc = -errno;
+      SG_safe_free( srv->response );
+      return rc;
+   }
+
+   memset( &addr, 0, sizeof(addr) );
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+   addr.sin_port = 0;
+
+   if( bind( srv->sock, (struct sockaddr*)&addr, sizeof(addr) ) != 0 || listen( srv->sock, 16 ) != 0 || getsockname( srv->sock, (struct sockaddr*)&addr, &addr_len ) != 0 ) {
+
+      rc = -errno;
+      close( srv->sock );
+      SG_safe_free( srv->response );
+      return rc;
+   }
+
+   srv->port = ntohs( addr.sin_port );
+
+   if( md_start_thread( &thread, downloader_bench_server_main, srv, true ) < 0 ) {
+
+      close( srv->sock );
+      SG_safe_free( srv->response );
+      return -EPERM;
+   }
+
+   return 0;
+}
+
+
+// the old downloader loop: add pending handles, run curl_multi_perform, and select() on curl's fds for at most 5ms
+static void* downloader_bench_poll_main( void* arg ) {
+
+   struct downloader_bench_poll_loop* loop = (struct downloader_bench_poll_loop*)arg;
+   int still_running = 0;
+   int msgs_left = 0;
+   CURLMsg* msg = NULL;
+
+   while( loop->running ) {
+
+      fd_set fdread;
+      fd_set fdwrite;
+      fd_set fdexcep;
+      int maxfd = -1;
+      long curl_timeo = -1;
+      struct timeval timeout;
+
+      pthread_mutex_lock( &loop->lock );
+
+      for( list<CURL*>::iterator itr = loop->pending->begin(); itr != loop->pending->end(); itr++ ) {
+         curl_multi_add_handle( loop->curlm, *itr );
+      }
+
+      loop->pending->clear();
+      pthread_mutex_unlock( &loop->lock );
+
+      curl_multi_perform( loop->curlm, &still_running );
+
+      // don't wait more than 5ms
+      timeout.tv_sec = 0;
+      timeout.tv_usec = 5000;
+
+      curl_multi_timeout( loop->curlm, &curl_timeo );
+      if( curl_timeo > 0 ) {
+         timeout.tv_usec = MIN( (curl_timeo % 1000) * 1000, 5000 );
+      }
+
+      FD_ZERO( &fdread );
+      FD_ZERO( &fdwrite );
+      FD_ZERO( &fdexcep );
+
+      curl_multi_fdset( loop->curlm, &fdread, &fdwrite, &fdexcep, &maxfd );
+      select( maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout );
+
+      curl_multi_perform( loop->curlm, &still_running );
+
+      // finalize completed downloads
+      while( (msg = curl_multi_info_read( loop->curlm, &msgs_left )) != NULL ) {
+
+         if( msg->msg != CURLMSG_DONE ) {
+            continue;
+         }
+
+         CURL* curl = msg->easy_handle;
+         curl_multi_remove_handle( loop->curlm, curl );
+
+         pthread_mutex_lock( &loop->lock );
+
+         downloader_bench_waiters_t::iterator itr = loop->waiters->find( curl );
+         if( itr != loop->waiters->end() ) {
+
+            sem_post( itr->second );
+            loop->waiters->erase( itr );
+         }
+
+         pthread_mutex_unlock( &loop->lock );
+      }
+   }
+
+   return NULL;
+}
+
+
+// start the old polling loop
+// return 0 on success
+// return -ENOMEM on OOM
+// return -EPERM if the thread could not be started
+static int downloader_bench_poll_start( struct downloader_bench_poll_loop* loop ) {
+
+   memset( loop, 0, sizeof(struct downloader_bench_poll_loop) );
+
+   loop->curlm = curl_multi_init();
+   loop->pending = SG_safe_new( list<CURL*>() );
+   loop->waiters = SG_safe_new( downloader_bench_waiters_t() );
+
+   if( loop->curlm == NULL || loop->pending == NULL || loop->waiters == NULL ) {
+
+      if( loop->curlm != NULL ) {
+         curl_multi_cleanup( loop->curlm );
+      }
+
+      SG_safe_delete( loop->pending );
+      SG_safe_delete( loop->waiters );
+      return -ENOMEM;
+   }
+
+   pthread_mutex_init( &loop->lock, NULL );
+   loop->running = true;
+
+   if( md_start_thread( &loop->thread, downloader_bench_poll_main, loop, false ) < 0 ) {
+
+      loop->running = false;
+      curl_multi_cleanup( loop->curlm );
+      SG_safe_delete( loop->pending );
+      SG_safe_delete( loop->waiters );
+      pthread_mutex_destroy( &loop->lock );
+      return -EPERM;
+   }
+
+   return 0;
+}
+
+
+// stop and free the old polling loop
+static void downloader_bench_poll_stop( struct downloader_bench_poll_loop* loop ) {
+
+   loop->running = false;
+   pthread_join( loop->thread, NULL );
+
+   curl_multi_cleanup( loop->curlm );
+   SG_safe_delete( loop->pending );
+   SG_safe_delete( loop->waiters );
+   pthread_mutex_destroy( &loop->lock );
+}
+
+
+// download once with the old polling loop, and wait for it
+// return 0 on success
+// return -ENOMEM on OOM
+static int downloader_bench_poll_get( struct downloader_bench_poll_loop* loop, CURL* curl ) {
+
+   sem_t sem;
+
+   sem_init( &sem, 0, 0 );
+
+   pthread_mutex_lock( &loop->lock );
+
+   try {
+
+      (*loop->waiters)[ curl ] = &sem;
+      loop->pending->push_back( curl );
+   }
+   catch( bad_alloc& ba ) {
+
+      loop->waiters->erase( curl );
+      pthread_mutex_unlock( &loop->lock );
+      sem_destroy( &sem );
+      return -ENOMEM;
+   }
+
+   pthread_mutex_unlock( &loop->lock );
+
+   md_download_sem_wait( &sem, -1 );
+   sem_destroy( &sem );
+
+   return 0;
+}
+
+
+// download once with the event-driven downloader, and wait for it
+// return 0 on success
+// return -ENOMEM on OOM
+// return -EREMOTEIO if the download failed
+// return negative if the download could not be started
+static int downloader_bench_dl_get( struct md_downloader* dl, CURL* curl, size_t body_size ) {
+
+   int rc = 0;
+   struct md_download_context* dlctx = md_download_context_new();
+
+   if( dlctx == NULL ) {
+      return -ENOMEM;
+   }
+
+   rc = md_download_context_init( dlctx, curl, body_size, NULL );
+   if( rc != 0 ) {
+
+      SG_safe_free( dlctx );
+      return rc;
+   }
+
+   rc = md_download_context_start( dl, dlctx );
+   if( rc != 0 ) {
+
+      md_download_context_free( dlctx, NULL );
+      SG_safe_free( dlctx );
+      return rc;
+   }
+
+   md_download_context_wait( dlctx, -1 );
+
+   if( !md_download_context_succeeded( dlctx, 200 ) ) {
+      rc = -EREMOTEIO;
+   }
+
+   if( md_download_context_unref_free( dlctx, NULL ) > 0 ) {
+      SG_safe_free( dlctx );
+   }
+
+   return rc;
+}
+
+
+// measure idle CPU over idle_secs, as a percentage of one core
+static double downloader_bench_idle_cpu( int idle_secs ) {
+
+   struct timespec cpu_start, cpu_end, wall_start, wall_end;
+
+   clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &cpu_start );
+   clock_gettime( CLOCK_MONOTONIC, &wall_start );
+
+   sleep( idle_secs );
+
+   clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &cpu_end );
+   clock_gettime( CLOCK_MONOTONIC, &wall_end );
+
+   return 100.0 * (double)md_timespec_diff( &cpu_end, &cpu_start ) / (double)md_timespec_diff( &wall_end, &wall_start );
+}
+
+
+static int downloader_bench_int64_cmp( const void* a, const void* b ) {
+
+   int64_t x = *(int64_t*)a;
+   int64_t y = *(int64_t*)b;
+
+   return (x > y) - (x < y);
+}
+
+
+// time num_requests sequential downloads on one handle, with either the downloader or the polling loop.
+// fills in the mean, median, and 99th-percentile latency in microseconds.
+// return 0 on success
+// return -ENOMEM on OOM
+// return negative if a download failed
+static int downloader_bench_latency( struct md_downloader* dl, struct downloader_bench_poll_loop* loop, char const* url, size_t body_size, int num_requests,
+                                     double* mean_us, double* p50_us, double* p99_us ) {
+
+   int rc = 0;
+   int64_t* samples = NULL;
+   int64_t total = 0;
+   struct timespec start, end;
+   CURL* curl = NULL;
+
+   samples = SG_CALLOC( int64_t, num_requests );
+   if( samples == NULL ) {
+      return -ENOMEM;
+   }
+
+   curl = curl_easy_init();
+   if( curl == NULL ) {
+
+      SG_safe_free( samples );
+      return -ENOMEM;
+   }
+
+   md_init_curl_handle2( curl, url, 30, false );
+
+   if( loop != NULL ) {
+
+      curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, downloader_bench_discard );
+   }
+
+   for( int i = 0; i < num_requests; i++ ) {
+
+      clock_gettime( CLOCK_MONOTONIC, &start );
+
+      if( loop != NULL ) {
+         rc = downloader_bench_poll_get( loop, curl );
+      }
+      else {
+         rc = downloader_bench_dl_get( dl, curl, body_size );
+      }
+
+      clock_gettime( CLOCK_MONOTONIC, &end );
+
+      if( rc != 0 ) {
+
+         fprintf(stderr, "Download %d of '%s' rc = %d\n", i, url, rc );
+         break;
+      }
+
+      samples[i] = md_timespec_diff( &end, &start );
+      total += samples[i];
+   }
+
+   curl_easy_cleanup( curl );
+
+   if( rc == 0 ) {
+
+      qsort( samples, num_requests, sizeof(int64_t), downloader_bench_int64_cmp );
+
+      *mean_us = (double)total / num_requests / 1000.0;
+      *p50_us = (double)samples[ num_requests / 2 ] / 1000.0;
+      *p99_us = (double)samples[ MIN( num_requests - 1, (num_requests * 99) / 100 ) ] / 1000.0;
+   }
+
+   SG_safe_free( samples );
+
+   return rc;
+}
+
+
+static void usage( char const* progname ) {
+
+   fprintf(stderr, "Usage: %s [-i IDLE_SECONDS] [-n REQUESTS] [-s BODY_SIZE]\n", progname );
+   exit(1);
+}
+
+
+int main( int argc, char** argv ) {
+
+   int rc = 0;
+   int idle_secs = 5;
+   int num_requests = 1000;
+   size_t body_size = 4096;
+   int c = 0;
+   char url[256];
+   struct downloader_bench_server srv;
+   struct downloader_bench_poll_loop loop;
+   struct md_downloader* dl = NULL;
+   double idle_pct = 0, mean_us = 0, p50_us = 0, p99_us = 0;
+
+   while( (c = getopt( argc, argv, "i:n:s:" )) != -1 ) {
+
+      switch( c ) {
+
+         case 'i':
+            idle_secs = atoi( optarg );
+            break;
+
+         case 'n':
+            num_requests = atoi( optarg );
+            break;
+
+         case 's':
+            body_size = strtoull( optarg, NULL, 10 );
+            break;
+
+         default:
+            usage( argv[0] );
+      }
+   }
+
+   if( idle_secs <= 0 || num_requests <= 0 ) {
+      usage( argv[0] );
+   }
+
+   curl_global_init( CURL_GLOBAL_ALL );
+
+   rc = downloader_bench_server_start( &srv, body_size );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "downloader_bench_server_start rc = %d\n", rc );
+      exit(1);
+   }
+
+   snprintf( url, sizeof(url), "http://127.0.0.1:%d/", srv.port );
+
+   printf("%-10s %10s %12s %12s %12s\n", "loop", "idle CPU %", "mean us", "p50 us", "p99 us");
+
+   // event-driven downloader
+   dl = md_downloader_new();
+   if( dl == NULL ) {
+
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+   }
+
+   rc = md_downloader_init( dl, "downloader-bench" );
+   if( rc == 0 ) {
+      rc = md_downloader_start( dl );
+   }
+
+   if( rc != 0 ) {
+
+      fprintf(stderr, "Failed to start downloader: rc = %d\n", rc );
+      exit(1);
+   }
+
+   idle_pct = downloader_bench_idle_cpu( idle_secs );
+
+   rc = downloader_bench_latency( dl, NULL, url, body_size, num_requests, &mean_us, &p50_us, &p99_us );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "downloader_bench_latency(epoll) rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("%-10s %10.2f %12.1f %12.1f %12.1f\n", "epoll", idle_pct, mean_us, p50_us, p99_us );
+
+   md_downloader_stop( dl );
+   md_downloader_shutdown( dl );
+   SG_safe_free( dl );
+
+   // old polling loop
+   rc = downloader_bench_poll_start( &loop );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "downloader_bench_poll_start rc = %d\n", rc );
+      exit(1);
+   }
+
+   idle_pct = downloader_bench_idle_cpu( idle_secs );
+
+   rc = downloader_bench_latency( NULL, &loop, url, body_size, num_requests, &mean_us, &p50_us, &p99_us );
+   if( rc != 0 ) {
+
+      fprintf(stderr, "downloader_bench_latency(select) rc = %d\n", rc );
+      exit(1);
+   }
+
+   printf("%-10s %10.2f %12.1f %12.1f %12.1f\n", "select", idle_pct, mean_us, p50_us, p99_us );
+
+   downloader_bench_poll_stop( &loop );
+
+   curl_global_cleanup();
+
+   return 0;
+}